@@ -24,6 +24,10 @@
 #ifndef IGRAPH_BENCH_H
 #define IGRAPH_BENCH_H
 
+#include <stdio.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
 static inline void igraph_get_cpu_time(igraph_real_t *data) {
 
 	struct rusage self, children;
@@ -39,14 +43,51 @@ static inline void igraph_get_cpu_time(igraph_real_t *data) {
 		1e-3 * (children.ru_stime.tv_usec/1000);
 }
 
+/* The peak resident set size of the process, in megabytes. It is
+   the peak since the start of the process, or since the last call to
+   igraph_reset_peak_memory(), where that is supported. */
+
+static inline double igraph_get_peak_memory(void) {
+
+	struct rusage self;
+	getrusage(RUSAGE_SELF, &self);
+#ifdef __APPLE__
+	return self.ru_maxrss / 1048576.0;
+#else
+	return self.ru_maxrss / 1024.0;
+#endif
+}
+
+/* Resets the peak resident set size to the current one, so that the
+   peak of a single function can be measured. This works on Linux
+   only, elsewhere the peak of the whole process is reported. */
+
+static inline void igraph_reset_peak_memory(void) {
+#ifdef __linux__
+	FILE *f = fopen("/proc/self/clear_refs", "w");
+	if (f) {
+		fputs("5", f);
+		fclose(f);
+	}
+#endif
+}
+
+/* Prints the CPU time, and the elapsed time, which is shorter for
+   code running in several threads */
+
 #define BENCH(NAME, ...)	do {														 \
 	double start[4], stop[4];																 \
+	struct timeval wstart, wstop;														 \
 	igraph_get_cpu_time(start);															 \
+	gettimeofday(&wstart, 0);																 \
 	{ __VA_ARGS__; };																				 \
+	gettimeofday(&wstop, 0);																 \
 	igraph_get_cpu_time(stop);															 \
-	printf("%s %.3gs\n", NAME,															 \
+	printf("%s %.3gs (%.3gs elapsed)\n", NAME,								 \
 				 stop[0]+stop[1]+stop[2]+stop[3] -								 \
-				 start[0]-start[1]-start[2]-start[3]);						 \
+				 start[0]-start[1]-start[2]-start[3],							 \
+				 (wstop.tv_sec-wstart.tv_sec) +										 \
+				 1e-6 * (wstop.tv_usec-wstart.tv_usec));					 \
 	} while (0)
 
 #endif
@@ -0,0 +1,66 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2013  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard st, Cambridge MA, 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+#include "bench.h"
+
+#define BATCHES 100
+#define BATCH_SIZE 1000
+
+/* Time of adding BATCHES batches of BATCH_SIZE random edges each, to
+   graphs of increasing size. This should grow much slower than the
+   size of the graph. */
+
+void bench_add_edges(const char *name, long int n, long int m) {
+	igraph_t g;
+	igraph_vector_t batch;
+	long int b, i;
+
+	igraph_erdos_renyi_game(&g, IGRAPH_ERDOS_RENYI_GNM, n, m,
+													IGRAPH_DIRECTED, IGRAPH_LOOPS);
+	igraph_vector_init(&batch, BATCH_SIZE * 2);
+
+	BENCH(name,
+				for (b = 0; b < BATCHES; b++) {
+					for (i = 0; i < BATCH_SIZE * 2; i++) {
+						VECTOR(batch)[i] = RNG_INTEGER(0, n - 1);
+					}
+					igraph_add_edges(&g, &batch, 0);
+				}
+				);
+
+	igraph_vector_destroy(&batch);
+	igraph_destroy(&g);
+}
+
+int main() {
+
+	igraph_rng_seed(igraph_rng_default(), 42);
+
+	bench_add_edges("1 Add 100x1000 edges, |V|=10^4, |E|=10^5", 10000, 100000);
+	bench_add_edges("2 Add 100x1000 edges, |V|=10^5, |E|=10^6", 100000, 1000000);
+	bench_add_edges("3 Add 100x1000 edges, |V|=10^6, |E|=10^7", 1000000, 10000000);
+
+	return 0;
+}
@@ -0,0 +1,66 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2013  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard st, Cambridge MA, 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+#include "bench.h"
+
+/* Set OMP_NUM_THREADS to compare different numbers of threads */
+
+int main() {
+
+	igraph_t g;
+	igraph_vector_t res, weights;
+	long int i;
+
+	igraph_rng_seed(igraph_rng_default(), 42);
+	igraph_barabasi_game(&g, 10000, /*power=*/ 1, 5, /*outseq=*/ 0,
+											 /*outpref=*/ 0, /*A=*/ 1, IGRAPH_UNDIRECTED,
+											 IGRAPH_BARABASI_PSUMTREE, /*start_from=*/ 0);
+	igraph_vector_init(&res, 0);
+	igraph_vector_init(&weights, igraph_ecount(&g));
+	for (i=0; i<igraph_vector_size(&weights); i++) {
+		VECTOR(weights)[i]=igraph_rng_get_unif(igraph_rng_default(), 1, 10);
+	}
+
+	BENCH("1 Vertex betweenness, unweighted",
+				igraph_betweenness(&g, &res, igraph_vss_all(), IGRAPH_UNDIRECTED,
+													 /*weights=*/ 0, /*nobigint=*/ 1);
+				);
+	BENCH("2 Vertex betweenness, weighted  ",
+				igraph_betweenness(&g, &res, igraph_vss_all(), IGRAPH_UNDIRECTED,
+													 &weights, /*nobigint=*/ 1);
+				);
+	BENCH("3 Edge betweenness, unweighted  ",
+				igraph_edge_betweenness(&g, &res, IGRAPH_UNDIRECTED, /*weights=*/ 0);
+				);
+	BENCH("4 Edge betweenness, weighted    ",
+				igraph_edge_betweenness(&g, &res, IGRAPH_UNDIRECTED, &weights);
+				);
+
+	igraph_vector_destroy(&weights);
+	igraph_vector_destroy(&res);
+	igraph_destroy(&g);
+
+	return 0;
+}
@@ -0,0 +1,86 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2013  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard st, Cambridge MA, 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+#include "bench.h"
+
+int main() {
+
+	igraph_t g;
+	igraph_vector_t res;
+	igraph_matrix_t dist;
+	igraph_real_t apl;
+	igraph_integer_t diam;
+
+	igraph_rng_seed(igraph_rng_default(), 42);
+	igraph_barabasi_game(&g, 5000, /*power=*/ 1, 10, /*outseq=*/ 0,
+											 /*outpref=*/ 0, /*A=*/ 1, IGRAPH_UNDIRECTED,
+											 IGRAPH_BARABASI_PSUMTREE, /*start_from=*/ 0);
+	igraph_vector_init(&res, 0);
+	igraph_matrix_init(&dist, 0, 0);
+
+	igraph_set_bfs_engine(IGRAPH_BFS_TOPDOWN);
+	BENCH("1 Eccentricity, top-down                  ",
+				igraph_eccentricity(&g, &res, igraph_vss_all(), IGRAPH_ALL);
+				);
+	igraph_set_bfs_engine(IGRAPH_BFS_DIRECTION_OPTIMIZING);
+	BENCH("2 Eccentricity, direction-optimizing      ",
+				igraph_eccentricity(&g, &res, igraph_vss_all(), IGRAPH_ALL);
+				);
+
+	igraph_set_bfs_engine(IGRAPH_BFS_TOPDOWN);
+	BENCH("3 Average path length, top-down           ",
+				igraph_average_path_length(&g, &apl, IGRAPH_UNDIRECTED, 1);
+				);
+	igraph_set_bfs_engine(IGRAPH_BFS_DIRECTION_OPTIMIZING);
+	BENCH("4 Average path length, direction-optimizing",
+				igraph_average_path_length(&g, &apl, IGRAPH_UNDIRECTED, 1);
+				);
+
+	igraph_set_bfs_engine(IGRAPH_BFS_TOPDOWN);
+	BENCH("5 Diameter, top-down                      ",
+				igraph_diameter(&g, &diam, 0, 0, 0, IGRAPH_UNDIRECTED, 1);
+				);
+	igraph_set_bfs_engine(IGRAPH_BFS_DIRECTION_OPTIMIZING);
+	BENCH("6 Diameter, direction-optimizing          ",
+				igraph_diameter(&g, &diam, 0, 0, 0, IGRAPH_UNDIRECTED, 1);
+				);
+
+	igraph_set_bfs_engine(IGRAPH_BFS_TOPDOWN);
+	BENCH("7 Shortest paths, 1000 sources, top-down  ",
+				igraph_shortest_paths(&g, &dist, igraph_vss_seq(0, 999),
+															igraph_vss_all(), IGRAPH_ALL);
+				);
+	igraph_set_bfs_engine(IGRAPH_BFS_DIRECTION_OPTIMIZING);
+	BENCH("8 Shortest paths, 1000 sources, dir.-opt. ",
+				igraph_shortest_paths(&g, &dist, igraph_vss_seq(0, 999),
+															igraph_vss_all(), IGRAPH_ALL);
+				);
+
+	igraph_matrix_destroy(&dist);
+	igraph_vector_destroy(&res);
+	igraph_destroy(&g);
+
+	return 0;
+}
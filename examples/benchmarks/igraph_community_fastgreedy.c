@@ -0,0 +1,59 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+#include "bench.h"
+
+int main() {
+
+	igraph_t g;
+	igraph_vector_t membership, modularity;
+	double before;
+
+	/* A sparse scale-free graph, 100 thousand vertices, 300 thousand
+	   edges */
+	igraph_rng_seed(igraph_rng_default(), 42);
+	igraph_barabasi_game(&g, 100000, /*power=*/ 1, /*m=*/ 3, 0, 0,
+											 /*A=*/ 1, IGRAPH_UNDIRECTED, IGRAPH_BARABASI_PSUMTREE,
+											 /*start_from=*/ 0);
+	igraph_simplify(&g, /*multiple=*/ 1, /*loops=*/ 1, /*edge_comb=*/ 0);
+	igraph_vector_init(&membership, 0);
+	igraph_vector_init(&modularity, 0);
+
+	igraph_reset_peak_memory();
+	before = igraph_get_peak_memory();
+	BENCH("1 Fast greedy, BA graph, 100k vertices, 300k edges",
+				igraph_community_fastgreedy(&g, 0, 0, &modularity, &membership);
+				);
+	printf("  modularity %g, %g communities, peak memory %.0fMB "
+				 "(%.0fMB at start)\n", igraph_vector_max(&modularity),
+				 igraph_vector_max(&membership) + 1, igraph_get_peak_memory(),
+				 before);
+
+	igraph_vector_destroy(&modularity);
+	igraph_vector_destroy(&membership);
+	igraph_destroy(&g);
+
+	return 0;
+}
@@ -0,0 +1,80 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard st, Cambridge MA, 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+#include "bench.h"
+
+/* Set OMP_NUM_THREADS to compare different numbers of threads, the
+   result of the parallel version does not depend on it */
+
+int main() {
+
+	igraph_t g;
+	igraph_vector_t membership, modularity, pref, types;
+	igraph_matrix_t prefmat;
+	igraph_real_t q;
+	long int i, j;
+
+	/* A planted partition graph, 100 groups of about 2000 vertices */
+	igraph_rng_seed(igraph_rng_default(), 42);
+	igraph_vector_init(&types, 100);
+	igraph_vector_fill(&types, 0.01);
+	igraph_matrix_init(&prefmat, 100, 100);
+	for (i = 0; i < 100; i++) {
+		for (j = 0; j < 100; j++) {
+			MATRIX(prefmat, i, j) = i == j ? 4e-3 : 2e-5;
+		}
+	}
+	igraph_vector_init(&pref, 0);
+	igraph_preference_game(&g, 200000, 100, &types, /*fixed_sizes=*/ 0,
+												 &prefmat, &pref, IGRAPH_UNDIRECTED, IGRAPH_NO_LOOPS);
+	igraph_vector_init(&membership, 0);
+	igraph_vector_init(&modularity, 0);
+
+	BENCH("1 Multilevel, sequential         ",
+				igraph_community_multilevel(&g, 0, &membership, 0, &modularity);
+				);
+	printf("  modularity %g, %g communities\n", igraph_vector_tail(&modularity),
+				 igraph_vector_max(&membership) + 1);
+	BENCH("2 Multilevel, parallel           ",
+				igraph_community_multilevel_parallel(&g, 0, &membership, 0,
+																						 &modularity);
+				);
+	printf("  modularity %g, %g communities\n", igraph_vector_tail(&modularity),
+				 igraph_vector_max(&membership) + 1);
+	BENCH("3 Leiden, until stable           ",
+				igraph_community_leiden(&g, 0, &membership, /*n_iterations=*/ -1, &q);
+				);
+	printf("  modularity %g, %g communities\n", q,
+				 igraph_vector_max(&membership) + 1);
+
+	igraph_vector_destroy(&modularity);
+	igraph_vector_destroy(&membership);
+	igraph_vector_destroy(&pref);
+	igraph_matrix_destroy(&prefmat);
+	igraph_vector_destroy(&types);
+	igraph_destroy(&g);
+
+	return 0;
+}
@@ -0,0 +1,69 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard st, Cambridge MA, 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+#include "bench.h"
+
+/* The running time is dominated by the heat bath sweeps, a quick
+   cooling schedule keeps the number of sweeps small */
+
+int main() {
+
+	igraph_t g;
+	igraph_vector_t membership;
+	igraph_real_t modularity;
+
+	/* A connected scale-free graph with 100000 vertices */
+	igraph_rng_seed(igraph_rng_default(), 42);
+	igraph_barabasi_game(&g, 100000, /*power=*/ 1, /*m=*/ 5, 0, 0, /*A=*/ 1,
+											 IGRAPH_UNDIRECTED, IGRAPH_BARABASI_PSUMTREE, 0);
+	igraph_vector_init(&membership, 0);
+
+	igraph_rng_seed(igraph_rng_default(), 42);
+	BENCH("1 Spinglass, original, sequential ",
+				igraph_community_spinglass(&g, 0, &modularity, 0, &membership, 0,
+																	 /*spins=*/ 10, /*parupdate=*/ 0,
+																	 /*starttemp=*/ 1.0, /*stoptemp=*/ 0.1,
+																	 /*coolfact=*/ 0.5,
+																	 IGRAPH_SPINCOMM_UPDATE_CONFIG, 1.0,
+																	 IGRAPH_SPINCOMM_IMP_ORIG, 1.0);
+				);
+	printf("  modularity %g\n", modularity);
+
+	igraph_rng_seed(igraph_rng_default(), 42);
+	BENCH("2 Spinglass, negative weights     ",
+				igraph_community_spinglass(&g, 0, &modularity, 0, &membership, 0,
+																	 /*spins=*/ 10, /*parupdate=*/ 0,
+																	 /*starttemp=*/ 1.0, /*stoptemp=*/ 0.1,
+																	 /*coolfact=*/ 0.5,
+																	 IGRAPH_SPINCOMM_UPDATE_CONFIG, 1.0,
+																	 IGRAPH_SPINCOMM_IMP_NEG, 1.0);
+				);
+	printf("  modularity %g\n", modularity);
+
+	igraph_vector_destroy(&membership);
+	igraph_destroy(&g);
+
+	return 0;
+}
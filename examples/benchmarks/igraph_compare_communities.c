@@ -0,0 +1,77 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+#include "bench.h"
+
+#define NO_COMMS 10
+#define SIZE 100000
+
+int main() {
+
+	igraph_vector_t v[NO_COMMS];
+	igraph_vector_ptr_t comms;
+	igraph_matrix_t res;
+	igraph_real_t r;
+	long int i, j, k;
+
+	/* Random partitions of 100 thousand elements, with 20 to 9000
+	   clusters */
+	igraph_rng_seed(igraph_rng_default(), 42);
+	igraph_vector_ptr_init(&comms, NO_COMMS);
+	for (i = 0; i < NO_COMMS; i++) {
+		long int nc = i % 2 ? 10 * (i + 1) : 1000 * (i + 1);
+		igraph_vector_init(&v[i], SIZE);
+		for (k = 0; k < SIZE; k++) {
+			VECTOR(v[i])[k] = RNG_INTEGER(0, nc - 1);
+		}
+		VECTOR(comms)[i] = &v[i];
+	}
+	igraph_matrix_init(&res, 0, 0);
+
+	BENCH("1 NMI, 10 partitions, 100k elements, pair by pair",
+				for (i = 0; i < NO_COMMS; i++) {
+					for (j = i; j < NO_COMMS; j++) {
+						igraph_compare_communities(&v[i], &v[j], &r,
+																			 IGRAPH_COMMCMP_NMI);
+					}
+				}
+				);
+	BENCH("2 NMI, 10 partitions, 100k elements, all pairs at once",
+				igraph_compare_communities_matrix(&comms, &res,
+																					IGRAPH_COMMCMP_NMI);
+				);
+	BENCH("3 Adjusted Rand, 10 partitions, 100k elements, all pairs at once",
+				igraph_compare_communities_matrix(&comms, &res,
+																					IGRAPH_COMMCMP_ADJUSTED_RAND);
+				);
+
+	igraph_matrix_destroy(&res);
+	for (i = 0; i < NO_COMMS; i++) {
+		igraph_vector_destroy(&v[i]);
+	}
+	igraph_vector_ptr_destroy(&comms);
+
+	return 0;
+}
@@ -0,0 +1,90 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2013  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard st, Cambridge MA, 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+#include "bench.h"
+
+#define N 200000
+#define M 10
+
+int main() {
+
+	igraph_t g;
+	igraph_csr_t csr;
+	igraph_vector_t res;
+	igraph_matrix_t dist;
+	igraph_vector_int_t from;
+	igraph_vs_t vs;
+	long int i;
+
+	igraph_rng_seed(igraph_rng_default(), 42);
+	igraph_barabasi_game(&g, N, /*power=*/ 1, M, /*outseq=*/ 0,
+											 /*outpref=*/ 0, /*A=*/ 1, IGRAPH_UNDIRECTED,
+											 IGRAPH_BARABASI_PSUMTREE, /*start_from=*/ 0);
+	igraph_vector_init(&res, 0);
+	igraph_matrix_init(&dist, 0, 0);
+	igraph_vector_int_init(&from, 10);
+	for (i = 0; i < 10; i++) {
+		VECTOR(from)[i] = i * 1000;
+	}
+	igraph_vs_vector_small(&vs, 0, 1000, 2000, 3000, 4000, 5000, 6000, 7000,
+												 8000, 9000, -1);
+
+	BENCH("1 CSR snapshot creation         ",
+				igraph_csr_init(&g, &csr, IGRAPH_ALL);
+				);
+
+	BENCH("2 Shortest paths, 10 sources    ",
+				igraph_shortest_paths(&g, &dist, vs, igraph_vss_all(), IGRAPH_ALL);
+				);
+	BENCH("3 Shortest paths, 10 sources CSR",
+				igraph_shortest_paths_csr(&csr, &dist, &from);
+				);
+
+	BENCH("4 PageRank (PRPACK)             ",
+				igraph_pagerank(&g, IGRAPH_PAGERANK_ALGO_PRPACK, &res, 0,
+												igraph_vss_all(), 0, 0.85, 0, 0);
+				);
+	BENCH("5 PageRank CSR                  ",
+				igraph_pagerank_csr(&csr, &res, 0, 0.85, 0);
+				);
+
+	BENCH("6 Transitivity                  ",
+				igraph_transitivity_local_undirected(&g, &res, igraph_vss_all(),
+																						 IGRAPH_TRANSITIVITY_NAN);
+				);
+	BENCH("7 Transitivity CSR              ",
+				igraph_transitivity_local_undirected_csr(&csr, &res,
+																								 IGRAPH_TRANSITIVITY_NAN);
+				);
+
+	igraph_vs_destroy(&vs);
+	igraph_vector_int_destroy(&from);
+	igraph_matrix_destroy(&dist);
+	igraph_vector_destroy(&res);
+	igraph_csr_destroy(&csr);
+	igraph_destroy(&g);
+
+	return 0;
+}
@@ -0,0 +1,127 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2013  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard st, Cambridge MA, 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+#include "bench.h"
+
+/* Set OMP_NUM_THREADS to compare different numbers of threads */
+
+int main() {
+
+	igraph_t g;
+	igraph_vector_t res, prev;
+	igraph_pagerank_power_options_t options = { 1000, 1e-10 };
+	igraph_pagerank_state_t state;
+	igraph_vector_t add, remove;
+	igraph_matrix_t resets, batch;
+	long int i;
+
+	igraph_rng_seed(igraph_rng_default(), 42);
+	igraph_barabasi_game(&g, 200000, /*power=*/ 1, 10, /*outseq=*/ 0,
+											 /*outpref=*/ 0, /*A=*/ 1, IGRAPH_DIRECTED,
+											 IGRAPH_BARABASI_PSUMTREE, /*start_from=*/ 0);
+	igraph_rewire(&g, 100000, IGRAPH_REWIRING_SIMPLE);
+	igraph_vector_init(&res, 0);
+	igraph_vector_init(&prev, 0);
+	igraph_vector_init(&add, 20);
+	igraph_vector_init(&remove, 10);
+	igraph_matrix_init(&resets, 200000, 16);
+	igraph_matrix_init(&batch, 0, 0);
+
+	BENCH("1 PageRank, PRPACK               ",
+				igraph_pagerank(&g, IGRAPH_PAGERANK_ALGO_PRPACK, &res, 0,
+												igraph_vss_all(), IGRAPH_DIRECTED, 0.85, 0, 0);
+				);
+	BENCH("2 PageRank, power iteration      ",
+				igraph_pagerank(&g, IGRAPH_PAGERANK_ALGO_POWER, &prev, 0,
+												igraph_vss_all(), IGRAPH_DIRECTED, 0.85, 0, &options);
+				);
+
+	/* Warm start after a small change */
+	igraph_rewire(&g, 1000, IGRAPH_REWIRING_SIMPLE);
+	BENCH("3 PageRank, power iteration, warm",
+				igraph_pagerank_power(&g, &res, 0, igraph_vss_all(), IGRAPH_DIRECTED,
+															0.85, 0, 0, &options, &prev);
+				);
+
+	/* Incremental updates: ten new edges, then ten edges are rewired.
+		 Removing edges rebuilds the indices of the graph, this takes most
+		 of the time of the second update. */
+	BENCH("4 PageRank, incremental, init    ",
+				igraph_pagerank_state_init(&g, &state, IGRAPH_DIRECTED, 0.85, 0, 0,
+																	 1e-10);
+				);
+	for (i = 0; i < 10; i++) {
+		VECTOR(remove)[i] = igraph_rng_get_integer(igraph_rng_default(), 0,
+																							 igraph_ecount(&g) - 1);
+		VECTOR(add)[2 * i] = igraph_rng_get_integer(igraph_rng_default(), 0,
+																								igraph_vcount(&g) - 1);
+		VECTOR(add)[2 * i + 1] = igraph_rng_get_integer(igraph_rng_default(), 0,
+																										igraph_vcount(&g) - 1);
+	}
+	BENCH("5 PageRank, incremental, add     ",
+				igraph_pagerank_state_update(&g, &state, &add, 0, igraph_ess_none());
+				);
+	BENCH("6 PageRank, incremental, rewire  ",
+				igraph_pagerank_state_update(&g, &state, &add, 0,
+																		 igraph_ess_vector(&remove));
+				);
+	igraph_pagerank_state_destroy(&state);
+
+	/* Personalized PageRank for 16 seed sets of 10 vertices */
+	for (i = 0; i < 16 * 10; i++) {
+		MATRIX(resets, igraph_rng_get_integer(igraph_rng_default(), 0,
+																					igraph_vcount(&g) - 1), i / 10) += 1;
+	}
+	BENCH("7 Personalized PageRank, PRPACK, 16",
+				for (i = 0; i < 16; i++) {
+					igraph_matrix_get_col(&resets, &prev, i);
+					igraph_personalized_pagerank(&g, IGRAPH_PAGERANK_ALGO_PRPACK, &res,
+																			 0, igraph_vss_all(), IGRAPH_DIRECTED,
+																			 0.85, &prev, 0, 0);
+				}
+				);
+	BENCH("8 Personalized PageRank, power, 16 ",
+				for (i = 0; i < 16; i++) {
+					igraph_matrix_get_col(&resets, &prev, i);
+					igraph_pagerank_power(&g, &res, 0, igraph_vss_all(),
+																IGRAPH_DIRECTED, 0.85, &prev, 0, &options, 0);
+				}
+				);
+	BENCH("9 Personalized PageRank, batch, 16 ",
+				igraph_personalized_pagerank_batch(&g, &batch, igraph_vss_all(),
+																					 IGRAPH_DIRECTED, 0.85, &resets, 0,
+																					 &options);
+				);
+
+	igraph_matrix_destroy(&batch);
+	igraph_matrix_destroy(&resets);
+	igraph_vector_destroy(&remove);
+	igraph_vector_destroy(&add);
+	igraph_vector_destroy(&prev);
+	igraph_vector_destroy(&res);
+	igraph_destroy(&g);
+
+	return 0;
+}
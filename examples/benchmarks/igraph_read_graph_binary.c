@@ -0,0 +1,65 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+#include "bench.h"
+
+int main() {
+
+	igraph_t g, g2;
+	FILE *text, *binary;
+
+	/* A scale-free graph with one million vertices and 10 million
+		 edges, written to temporary files */
+	igraph_rng_seed(igraph_rng_default(), 42);
+	igraph_barabasi_game(&g, 1000000, /*power=*/ 1, /*m=*/ 10, 0, 0,
+											 /*A=*/ 1, IGRAPH_DIRECTED, IGRAPH_BARABASI_PSUMTREE,
+											 /*start_from=*/ 0);
+	text = tmpfile();
+	igraph_write_graph_edgelist(&g, text);
+	binary = tmpfile();
+	BENCH("1 Write binary file, 1M vertices, 10M edges",
+				igraph_write_graph_binary(&g, binary);
+				);
+	printf("  edge list %.0f MB, binary %.0f MB\n", ftell(text) / 1048576.0,
+				 ftell(binary) / 1048576.0);
+
+	rewind(text);
+	BENCH("2 Read edge list, 1M vertices, 10M edges",
+				igraph_read_graph_edgelist(&g2, text, 0, IGRAPH_DIRECTED);
+				);
+	igraph_destroy(&g2);
+
+	rewind(binary);
+	BENCH("3 Read binary file, 1M vertices, 10M edges",
+				igraph_read_graph_binary(&g2, binary);
+				);
+	igraph_destroy(&g2);
+
+	fclose(binary);
+	fclose(text);
+	igraph_destroy(&g);
+
+	return 0;
+}
@@ -0,0 +1,65 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+#include "bench.h"
+
+int main() {
+
+	igraph_t g, g2;
+	igraph_vector_t edges;
+	FILE *f;
+	long int size;
+
+	/* A scale-free graph with one million vertices and 10 million
+		 edges, written to a temporary file */
+	igraph_rng_seed(igraph_rng_default(), 42);
+	igraph_barabasi_game(&g, 1000000, /*power=*/ 1, /*m=*/ 10, 0, 0,
+											 /*A=*/ 1, IGRAPH_DIRECTED, IGRAPH_BARABASI_PSUMTREE,
+											 /*start_from=*/ 0);
+	f = tmpfile();
+	igraph_write_graph_edgelist(&g, f);
+	size = ftell(f);
+	printf("Edge list file of %.0f MB\n", size / 1048576.0);
+
+	rewind(f);
+	BENCH("1 Read edge list, 1M vertices, 10M edges",
+				igraph_read_graph_edgelist(&g2, f, 0, IGRAPH_DIRECTED);
+				);
+	igraph_destroy(&g2);
+	fclose(f);
+
+	/* The part of the time that is not parsing */
+	igraph_vector_init(&edges, 0);
+	igraph_get_edgelist(&g, &edges, 0);
+	BENCH("2 Create graph from edge vector, 1M vertices, 10M edges",
+				igraph_create(&g2, &edges, 0, IGRAPH_DIRECTED);
+				);
+	igraph_destroy(&g2);
+
+	igraph_vector_destroy(&edges);
+	igraph_destroy(&g);
+
+	return 0;
+}
@@ -0,0 +1,99 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+#include "bench.h"
+
+/* A GraphML file with a string and a numeric vertex attribute, and
+   a numeric and a boolean edge attribute, plus edge ids. The edges
+   are random, written without creating the graph. */
+
+FILE *write_graphml(long int no_of_nodes, long int no_of_edges) {
+	FILE *f = tmpfile();
+	long int i;
+
+	fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+					"<graphml xmlns=\"http://graphml.graphdrawing.org/xmlns\">\n"
+					"  <key id=\"v_label\" for=\"node\" attr.name=\"label\" "
+					"attr.type=\"string\"/>\n"
+					"  <key id=\"v_size\" for=\"node\" attr.name=\"size\" "
+					"attr.type=\"double\"/>\n"
+					"  <key id=\"e_weight\" for=\"edge\" attr.name=\"weight\" "
+					"attr.type=\"double\"/>\n"
+					"  <key id=\"e_seen\" for=\"edge\" attr.name=\"seen\" "
+					"attr.type=\"boolean\"/>\n"
+					"  <graph id=\"G\" edgedefault=\"undirected\">\n");
+	for (i = 0; i < no_of_nodes; i++) {
+		fprintf(f, "    <node id=\"n%li\">\n"
+						"      <data key=\"v_label\">vertex %li</data>\n"
+						"      <data key=\"v_size\">%g</data>\n"
+						"    </node>\n", i, i, RNG_UNIF01());
+	}
+	for (i = 0; i < no_of_edges; i++) {
+		fprintf(f, "    <edge id=\"e%li\" source=\"n%li\" target=\"n%li\">\n"
+						"      <data key=\"e_weight\">%g</data>\n"
+						"      <data key=\"e_seen\">%s</data>\n"
+						"    </edge>\n", i,
+						(long int) RNG_INTEGER(0, no_of_nodes - 1),
+						(long int) RNG_INTEGER(0, no_of_nodes - 1), RNG_UNIF01(),
+						RNG_UNIF01() < 0.5 ? "true" : "false");
+	}
+	fprintf(f, "  </graph>\n</graphml>\n");
+	rewind(f);
+
+	return f;
+}
+
+int main() {
+
+	igraph_t g;
+	FILE *f;
+	long int size, n;
+	double before;
+
+	igraph_i_set_attribute_table(&igraph_cattribute_table);
+	igraph_rng_seed(igraph_rng_default(), 42);
+
+	/* The peak memory should grow linearly with the file size */
+	for (n = 100000; n <= 400000; n *= 2) {
+		char name[100];
+		f = write_graphml(n, 5 * n);
+		fseek(f, 0, SEEK_END);
+		size = ftell(f);
+		rewind(f);
+		sprintf(name, "%li Read GraphML, %liK vertices, %liK edges",
+						n / 100000, n / 1000, 5 * n / 1000);
+		igraph_reset_peak_memory();
+		before = igraph_get_peak_memory();
+		BENCH(name,
+					igraph_read_graph_graphml(&g, f, 0);
+					);
+		printf("  file %.0fMB, peak memory %.0fMB (%.0fMB at start)\n",
+					 size / 1048576.0, igraph_get_peak_memory(), before);
+		igraph_destroy(&g);
+		fclose(f);
+	}
+
+	return 0;
+}
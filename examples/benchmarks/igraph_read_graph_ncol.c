@@ -0,0 +1,72 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+#include "bench.h"
+
+int main() {
+
+	igraph_t g, g2;
+	igraph_integer_t from, to;
+	FILE *f, *f2;
+	long int i, no_of_edges;
+
+	igraph_i_set_attribute_table(&igraph_cattribute_table);
+
+	/* A scale-free graph with 500 thousand vertices and 5 million
+		 edges, the vertices have long names */
+	igraph_rng_seed(igraph_rng_default(), 42);
+	igraph_barabasi_game(&g, 500000, /*power=*/ 1, /*m=*/ 10, 0, 0,
+											 /*A=*/ 1, IGRAPH_UNDIRECTED, IGRAPH_BARABASI_PSUMTREE,
+											 /*start_from=*/ 0);
+	no_of_edges = igraph_ecount(&g);
+	f = tmpfile();
+	for (i = 0; i < no_of_edges; i++) {
+		igraph_edge(&g, i, &from, &to);
+		fprintf(f, "protein-%08li protein-%08li\n", (long int) from,
+						(long int) to);
+	}
+	f2 = tmpfile();
+	igraph_write_graph_lgl(&g, f2, 0, 0, /*isolates=*/ 1);
+
+	rewind(f);
+	BENCH("1 Read NCOL file, 500K named vertices, 5M edges",
+				igraph_read_graph_ncol(&g2, f, 0, /*names=*/ 1,
+															 IGRAPH_ADD_WEIGHTS_NO, IGRAPH_UNDIRECTED);
+				);
+	igraph_destroy(&g2);
+	fclose(f);
+
+	rewind(f2);
+	BENCH("2 Read LGL file, 500K named vertices, 5M edges",
+				igraph_read_graph_lgl(&g2, f2, /*names=*/ 1,
+															IGRAPH_ADD_WEIGHTS_NO, IGRAPH_UNDIRECTED);
+				);
+	igraph_destroy(&g2);
+	fclose(f2);
+
+	igraph_destroy(&g);
+
+	return 0;
+}
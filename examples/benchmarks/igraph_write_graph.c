@@ -0,0 +1,100 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+#include "bench.h"
+
+int main() {
+
+	igraph_t g;
+	igraph_vector_t weights;
+	FILE *f;
+	char name[32];
+	long int i;
+
+	igraph_i_set_attribute_table(&igraph_cattribute_table);
+
+	/* A scale-free graph with 500 thousand named vertices and 5
+		 million weighted edges */
+	igraph_rng_seed(igraph_rng_default(), 42);
+	igraph_barabasi_game(&g, 500000, /*power=*/ 1, /*m=*/ 10, 0, 0,
+											 /*A=*/ 1, IGRAPH_UNDIRECTED, IGRAPH_BARABASI_PSUMTREE,
+											 /*start_from=*/ 0);
+	for (i = 0; i < igraph_vcount(&g); i++) {
+		snprintf(name, sizeof(name), "protein-%08li", i);
+		SETVAS(&g, "name", i, name);
+	}
+	igraph_vector_init(&weights, igraph_ecount(&g));
+	for (i = 0; i < igraph_ecount(&g); i++) {
+		VECTOR(weights)[i] = i % 4 ? RNG_UNIF01() : RNG_INTEGER(1, 100);
+	}
+	SETEANV(&g, "weight", &weights);
+	igraph_vector_destroy(&weights);
+
+	f = tmpfile();
+	BENCH("1 Write edge list, 5M edges",
+				igraph_write_graph_edgelist(&g, f);
+				);
+	fclose(f);
+
+	f = tmpfile();
+	BENCH("2 Write NCOL file, names and weights, 5M edges",
+				igraph_write_graph_ncol(&g, f, "name", "weight");
+				);
+	fclose(f);
+
+	f = tmpfile();
+	BENCH("3 Write LGL file, names, 5M edges",
+				igraph_write_graph_lgl(&g, f, "name", 0, /*isolates=*/ 1);
+				);
+	fclose(f);
+
+	f = tmpfile();
+	BENCH("4 Write Pajek file, names and weights, 5M edges",
+				igraph_write_graph_pajek(&g, f);
+				);
+	fclose(f);
+
+	f = tmpfile();
+	BENCH("5 Write GML file, names and weights, 5M edges",
+				igraph_write_graph_gml(&g, f, 0, "bench");
+				);
+	fclose(f);
+
+	f = tmpfile();
+	BENCH("6 Write DOT file, names and weights, 5M edges",
+				igraph_write_graph_dot(&g, f);
+				);
+	fclose(f);
+
+	f = tmpfile();
+	BENCH("7 Write GraphML file, names and weights, 5M edges",
+				igraph_write_graph_graphml(&g, f, /*prefixattr=*/ 0);
+				);
+	fclose(f);
+
+	igraph_destroy(&g);
+
+	return 0;
+}
@@ -67,6 +67,16 @@ void dump_vertex_attribute_string(const char* name, const igraph_t* g) {
   printf("\n");
 }
 
+void dump_edge_attribute_string(const char* name, const igraph_t* g) {
+  long int i, n = igraph_ecount(g);
+
+  printf("Edge attribute '%s':", name);
+  for (i = 0; i < n; i++) {
+    printf(" %s", EAS(g, name, i));
+  }
+  printf("\n");
+}
+
 int main(int argc, char **argv) {
   igraph_t g;
   igraph_error_handler_t* oldhandler;
@@ -126,6 +136,8 @@ int main(int argc, char **argv) {
   dump_vertex_attribute_string("gender", &g);
   dump_vertex_attribute_numeric("age", &g);
   dump_vertex_attribute_bool("retired", &g);
+  dump_vertex_attribute_string("id", &g);
+  dump_edge_attribute_string("id", &g);
   igraph_destroy(&g);
 
   /* Test a GraphML file with namespaces */
@@ -0,0 +1,85 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2006-2012  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+/* Adds random edges in small batches, including multi-edges and
+   loops, and checks that the indices are the same as for a graph
+   created in one step. */
+
+int check(igraph_bool_t directed) {
+
+  igraph_t g, g2;
+  igraph_vector_t all, batch;
+  long int n=50, i, b;
+
+  igraph_vector_init(&all, 0);
+  igraph_vector_init(&batch, 0);
+  igraph_empty(&g, (igraph_integer_t) n, directed);
+
+  for (b=0; b<40; b++) {
+    long int size=RNG_INTEGER(0, 20);
+    igraph_vector_resize(&batch, size*2);
+    for (i=0; i<size*2; i++) {
+      VECTOR(batch)[i] = RNG_INTEGER(0, n-1);
+    }
+    if (b % 10 == 0 && size > 0) {
+      /* multiple edges with the same endpoints in the same batch */
+      VECTOR(batch)[0] = VECTOR(batch)[2*size-2];
+      VECTOR(batch)[1] = VECTOR(batch)[2*size-1];
+    }
+    igraph_add_edges(&g, &batch, 0);
+    igraph_vector_append(&all, &batch);
+
+    igraph_create(&g2, &all, (igraph_integer_t) n, directed);
+    if (!igraph_vector_all_e(&g.from, &g2.from) ||
+	!igraph_vector_all_e(&g.to, &g2.to) ||
+	!igraph_vector_all_e(&g.oi, &g2.oi) ||
+	!igraph_vector_all_e(&g.ii, &g2.ii) ||
+	!igraph_vector_all_e(&g.os, &g2.os) ||
+	!igraph_vector_all_e(&g.is, &g2.is)) {
+      return 1;
+    }
+    igraph_destroy(&g2);
+  }
+
+  igraph_destroy(&g);
+  igraph_vector_destroy(&batch);
+  igraph_vector_destroy(&all);
+
+  return 0;
+}
+
+int main() {
+
+  igraph_rng_seed(igraph_rng_default(), 42);
+
+  if (check(IGRAPH_DIRECTED)) {
+    return 1;
+  }
+  if (check(IGRAPH_UNDIRECTED)) {
+    return 2;
+  }
+
+  return 0;
+}
@@ -0,0 +1,118 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2008-2012  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+#include <math.h>
+
+/* Returns the largest error, relative to the number of vertex pairs */
+
+igraph_real_t max_error(const igraph_t *g, igraph_bool_t directed,
+			const igraph_vector_t *weights, 
+			igraph_real_t epsilon, igraph_integer_t *samples) {
+  igraph_vector_t exact, approx;
+  long int i, n=igraph_vcount(g);
+  igraph_real_t pairs, maxerr=0.0;
+
+  directed=directed && igraph_is_directed(g);
+  pairs= directed ? n*(n-1.0) : n*(n-1.0)/2;
+
+  igraph_vector_init(&exact, 0);
+  igraph_vector_init(&approx, 0);
+  igraph_betweenness(g, &exact, igraph_vss_all(), directed, weights, 1);
+  igraph_betweenness_approx(g, &approx, igraph_vss_all(), directed, weights,
+			    epsilon, /*delta=*/ 0.1, samples);
+  for (i=0; i<n; i++) {
+    igraph_real_t err=fabs(VECTOR(exact)[i]-VECTOR(approx)[i]) / pairs;
+    if (err > maxerr) { maxerr=err; }
+  }
+  igraph_vector_destroy(&approx);
+  igraph_vector_destroy(&exact);
+  return maxerr;
+}
+
+int main() {
+  igraph_t g;
+  igraph_vector_t weights, res, res2;
+  igraph_vs_t vs;
+  igraph_integer_t samples;
+  long int i;
+  int ret;
+
+  igraph_rng_seed(igraph_rng_default(), 42);
+
+  /* Undirected and directed, unweighted and weighted */
+  igraph_barabasi_game(&g, 500, /*power=*/ 1, 2, /*outseq=*/ 0,
+		       /*outpref=*/ 0, /*A=*/ 1, IGRAPH_UNDIRECTED,
+		       IGRAPH_BARABASI_PSUMTREE, /*start_from=*/ 0);
+  if (max_error(&g, 0, 0, 0.02, &samples) > 0.02) { return 1; }
+  if (samples <= 0) { return 2; }
+  igraph_vector_init(&weights, igraph_ecount(&g));
+  for (i=0; i<igraph_ecount(&g); i++) {
+    VECTOR(weights)[i]=igraph_rng_get_unif(igraph_rng_default(), 1, 5);
+  }
+  if (max_error(&g, 0, &weights, 0.02, 0) > 0.02) { return 3; }
+  igraph_vector_destroy(&weights);
+  igraph_destroy(&g);
+
+  igraph_erdos_renyi_game(&g, IGRAPH_ERDOS_RENYI_GNM, 300, 900,
+			  IGRAPH_DIRECTED, IGRAPH_NO_LOOPS);
+  if (max_error(&g, 1, 0, 0.02, 0) > 0.02) { return 4; }
+  if (max_error(&g, 0, 0, 0.02, 0) > 0.02) { return 5; }
+
+  /* Same seed, same result; subsets */
+  igraph_vector_init(&res, 0);
+  igraph_vector_init(&res2, 0);
+  igraph_rng_seed(igraph_rng_default(), 1);
+  igraph_betweenness_approx(&g, &res, igraph_vss_all(), 1, 0, 0.05, 0.1, 0);
+  igraph_rng_seed(igraph_rng_default(), 1);
+  igraph_vs_vector_small(&vs, 10, 2, -1);
+  igraph_betweenness_approx(&g, &res2, vs, 1, 0, 0.05, 0.1, 0);
+  igraph_vs_destroy(&vs);
+  if (igraph_vector_size(&res2) != 2 || VECTOR(res2)[0] != VECTOR(res)[10] ||
+      VECTOR(res2)[1] != VECTOR(res)[2]) {
+    return 6;
+  }
+  igraph_destroy(&g);
+
+  /* No paths with inner vertices */
+  igraph_empty(&g, 10, IGRAPH_UNDIRECTED);
+  igraph_betweenness_approx(&g, &res, igraph_vss_all(), 0, 0, 0.05, 0.1, 
+			    &samples);
+  if (samples != 0 || igraph_vector_size(&res) != 10 || 
+      !igraph_vector_isnull(&res)) {
+    return 7;
+  }
+
+  /* Invalid arguments */
+  igraph_set_error_handler(igraph_error_handler_ignore);
+  ret=igraph_betweenness_approx(&g, &res, igraph_vss_all(), 0, 0, 0, 0.1, 0);
+  if (ret != IGRAPH_EINVAL) { return 8; }
+  ret=igraph_betweenness_approx(&g, &res, igraph_vss_all(), 0, 0, 0.1, 1, 0);
+  if (ret != IGRAPH_EINVAL) { return 9; }
+  igraph_destroy(&g);
+
+  igraph_vector_destroy(&res2);
+  igraph_vector_destroy(&res);
+
+  return 0;
+}
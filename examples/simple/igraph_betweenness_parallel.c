@@ -0,0 +1,177 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2008-2012  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+#include <math.h>
+
+/* The vertex and edge betweenness scores are computed by several
+   threads if igraph was compiled with OpenMP support. Check them
+   against identities that hold for every graph, and against each
+   other: the unweighted, the unit-weighted and the big integer
+   variants must agree. */
+
+int close_to(const igraph_vector_t *v1, const igraph_vector_t *v2) {
+  long int i, n=igraph_vector_size(v1);
+  if (igraph_vector_size(v2) != n) { return 0; }
+  for (i=0; i<n; i++) {
+    igraph_real_t a=VECTOR(*v1)[i], b=VECTOR(*v2)[i];
+    if (fabs(a-b) > 1e-6 * (1 + fabs(a))) { return 0; }
+  }
+  return 1;
+}
+
+/* With all paths counted, the sum of the vertex betweenness scores
+   is the sum of (d(s,t)-1), the sum of the edge betweenness scores
+   is the sum of d(s,t), over all connected ordered (or unordered, in
+   the undirected case) pairs of vertices. */
+
+int check_sums(const igraph_t *g, igraph_bool_t directed,
+	       const igraph_vector_t *vbet, const igraph_vector_t *ebet) {
+  igraph_matrix_t dist;
+  long int i, j, n=igraph_vcount(g);
+  igraph_real_t vsum=0.0, esum=0.0;
+  directed=directed && igraph_is_directed(g);
+  igraph_matrix_init(&dist, 0, 0);
+  igraph_shortest_paths(g, &dist, igraph_vss_all(), igraph_vss_all(),
+			directed ? IGRAPH_OUT : IGRAPH_ALL);
+  for (i=0; i<n; i++) {
+    for (j=0; j<n; j++) {
+      igraph_real_t d=MATRIX(dist, i, j);
+      if (i==j || d==IGRAPH_INFINITY) { continue; }
+      vsum += d-1;
+      esum += d;
+    }
+  }
+  if (!directed) { vsum /= 2; esum /= 2; }
+  igraph_matrix_destroy(&dist);
+  return fabs(vsum-igraph_vector_sum(vbet)) < 1e-6 &&
+    fabs(esum-igraph_vector_sum(ebet)) < 1e-6;
+}
+
+int check(const igraph_t *g, igraph_bool_t directed) {
+  igraph_vector_t vbet, vbet2, ebet, ebet2, weights, sub;
+  igraph_vs_t vs;
+  long int i;
+  int ret=0;
+
+  igraph_vector_init(&vbet, 0);
+  igraph_vector_init(&vbet2, 0);
+  igraph_vector_init(&ebet, 0);
+  igraph_vector_init(&ebet2, 0);
+  igraph_vector_init(&sub, 0);
+  igraph_vector_init(&weights, igraph_ecount(g));
+  igraph_vector_fill(&weights, 1.0);
+
+  igraph_betweenness(g, &vbet, igraph_vss_all(), directed, 0, 
+		     /*nobigint=*/ 1);
+  igraph_edge_betweenness(g, &ebet, directed, 0);
+  if (!check_sums(g, directed, &vbet, &ebet)) { ret=1; goto done; }
+
+  /* Running it again gives the very same result */
+  igraph_betweenness(g, &vbet2, igraph_vss_all(), directed, 0, 1);
+  igraph_edge_betweenness(g, &ebet2, directed, 0);
+  if (!igraph_vector_all_e(&vbet, &vbet2) ||
+      !igraph_vector_all_e(&ebet, &ebet2)) { ret=2; goto done; }
+
+  /* Unit weights */
+  igraph_betweenness(g, &vbet2, igraph_vss_all(), directed, &weights, 1);
+  igraph_edge_betweenness(g, &ebet2, directed, &weights);
+  if (!close_to(&vbet, &vbet2) || !close_to(&ebet, &ebet2)) {
+    ret=3; goto done;
+  }
+
+  /* Big integers, these truncate the ratios of the path counts */
+  igraph_betweenness(g, &vbet2, igraph_vss_all(), directed, 0, 
+		     /*nobigint=*/ 0);
+  if (!close_to(&vbet, &vbet2)) { ret=4; goto done; }
+
+  /* A subset of the vertices */
+  igraph_vs_vector_small(&vs, 5, 3, 1, -1);
+  igraph_betweenness(g, &sub, vs, directed, 0, 1);
+  igraph_vs_destroy(&vs);
+  if (igraph_vector_size(&sub) != 3 || VECTOR(sub)[0] != VECTOR(vbet)[5] ||
+      VECTOR(sub)[1] != VECTOR(vbet)[3] || VECTOR(sub)[2] != VECTOR(vbet)[1]) {
+    ret=5; goto done;
+  }
+
+  /* Cutoff, unweighted and unit weights agree */
+  igraph_betweenness_estimate(g, &vbet, igraph_vss_all(), directed, 2, 0, 1);
+  igraph_betweenness_estimate(g, &vbet2, igraph_vss_all(), directed, 2, 
+			      &weights, 1);
+  if (!close_to(&vbet, &vbet2)) { ret=6; goto done; }
+  igraph_edge_betweenness_estimate(g, &ebet, directed, 2, 0);
+  igraph_edge_betweenness_estimate(g, &ebet2, directed, 2, &weights);
+  if (!close_to(&ebet, &ebet2)) { ret=7; goto done; }
+
+  /* Random weights, the scores must be non-negative */
+  for (i=0; i<igraph_vector_size(&weights); i++) {
+    VECTOR(weights)[i]=igraph_rng_get_unif(igraph_rng_default(), 1, 10);
+  }
+  igraph_betweenness(g, &vbet, igraph_vss_all(), directed, &weights, 1);
+  igraph_edge_betweenness(g, &ebet, directed, &weights);
+  if (igraph_vector_min(&vbet) < 0 || igraph_vector_min(&ebet) < 0) {
+    ret=8; goto done;
+  }
+
+ done:
+  igraph_vector_destroy(&weights);
+  igraph_vector_destroy(&sub);
+  igraph_vector_destroy(&ebet2);
+  igraph_vector_destroy(&ebet);
+  igraph_vector_destroy(&vbet2);
+  igraph_vector_destroy(&vbet);
+  return ret;
+}
+
+int main() {
+  igraph_t g;
+  igraph_vector_t dim;
+  int ret;
+
+  igraph_rng_seed(igraph_rng_default(), 42);
+
+  /* Undirected, with multi-edges and loops */
+  igraph_erdos_renyi_game(&g, IGRAPH_ERDOS_RENYI_GNM, 200, 600,
+			  IGRAPH_UNDIRECTED, IGRAPH_LOOPS);
+  igraph_add_edge(&g, 0, 1);
+  igraph_add_edge(&g, 0, 1);
+  if ((ret=check(&g, 0))) { return ret; }
+  igraph_destroy(&g);
+
+  /* Directed, not strongly connected */
+  igraph_erdos_renyi_game(&g, IGRAPH_ERDOS_RENYI_GNM, 200, 500,
+			  IGRAPH_DIRECTED, IGRAPH_NO_LOOPS);
+  if ((ret=check(&g, 1))) { return 10+ret; }
+  if ((ret=check(&g, 0))) { return 20+ret; }
+  igraph_destroy(&g);
+
+  /* A lattice has many shortest paths */
+  igraph_vector_init_int(&dim, 2, 15, 15);
+  igraph_lattice(&g, &dim, /*nei=*/ 1, IGRAPH_UNDIRECTED, /*mutual=*/ 0,
+		 /*circular=*/ 0);
+  igraph_vector_destroy(&dim);
+  if ((ret=check(&g, 0))) { return 30+ret; }
+  igraph_destroy(&g);
+
+  return 0;
+}
@@ -0,0 +1,131 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+/* The direction-optimizing BFS must give the same distances as the
+   classic one. */
+
+int check(const igraph_t *g, igraph_neimode_t mode) {
+  igraph_matrix_t m1, m2;
+  igraph_vector_t e1, e2, v;
+  igraph_real_t a1, a2, r1, r2;
+  igraph_integer_t d1, d2, from1, from2, to1, to2;
+  igraph_bool_t directed= mode != IGRAPH_ALL;
+  int ret=0;
+
+  igraph_matrix_init(&m1, 0, 0);
+  igraph_matrix_init(&m2, 0, 0);
+  igraph_vector_init(&e1, 0);
+  igraph_vector_init(&e2, 0);
+  igraph_vector_init_seq(&v, 0, igraph_vcount(g) / 2);
+
+  igraph_set_bfs_engine(IGRAPH_BFS_TOPDOWN);
+  igraph_shortest_paths(g, &m1, igraph_vss_all(), igraph_vss_all(), mode);
+  igraph_eccentricity(g, &e1, igraph_vss_all(), mode);
+  igraph_radius(g, &r1, mode);
+  igraph_diameter(g, &d1, &from1, &to1, 0, directed, /*unconn=*/ 1);
+  igraph_average_path_length(g, &a1, directed, /*unconn=*/ 1);
+
+  igraph_set_bfs_engine(IGRAPH_BFS_DIRECTION_OPTIMIZING);
+  igraph_shortest_paths(g, &m2, igraph_vss_all(), igraph_vss_all(), mode);
+  igraph_eccentricity(g, &e2, igraph_vss_all(), mode);
+  igraph_radius(g, &r2, mode);
+  igraph_diameter(g, &d2, &from2, &to2, 0, directed, /*unconn=*/ 1);
+  igraph_average_path_length(g, &a2, directed, /*unconn=*/ 1);
+
+  if (!igraph_matrix_all_e(&m1, &m2)) { ret=1; }
+  if (!igraph_vector_all_e(&e1, &e2)) { ret=2; }
+  if (r1 != r2) { ret=3; }
+  if (d1 != d2 || from1 != from2) { ret=4; }
+  if (a1 != a2 && !(igraph_is_nan(a1) && igraph_is_nan(a2))) { ret=5; }
+
+  /* The same, to a subset of the vertices, in another order */
+  igraph_vector_reverse(&v);
+  igraph_shortest_paths(g, &m2, igraph_vss_all(), igraph_vss_vector(&v), 
+			mode);
+  igraph_set_bfs_engine(IGRAPH_BFS_TOPDOWN);
+  igraph_shortest_paths(g, &m1, igraph_vss_all(), igraph_vss_vector(&v), 
+			mode);
+  if (!igraph_matrix_all_e(&m1, &m2)) { ret=6; }
+
+  /* Not connected, diameter and average path length */
+  igraph_diameter(g, &d1, &from1, &to1, 0, directed, /*unconn=*/ 0);
+  igraph_average_path_length(g, &a1, directed, /*unconn=*/ 0);
+  igraph_set_bfs_engine(IGRAPH_BFS_DIRECTION_OPTIMIZING);
+  igraph_diameter(g, &d2, &from2, &to2, 0, directed, /*unconn=*/ 0);
+  igraph_average_path_length(g, &a2, directed, /*unconn=*/ 0);
+  if (d1 != d2 || from1 != from2 || to1 != to2) { ret=7; }
+  if (a1 != a2 && !(igraph_is_nan(a1) && igraph_is_nan(a2))) { ret=8; }
+
+  igraph_set_bfs_engine(IGRAPH_BFS_TOPDOWN);
+  igraph_vector_destroy(&v);
+  igraph_vector_destroy(&e2);
+  igraph_vector_destroy(&e1);
+  igraph_matrix_destroy(&m2);
+  igraph_matrix_destroy(&m1);
+  return ret;
+}
+
+int main() {
+  igraph_t g;
+  int ret;
+
+  if (igraph_set_bfs_engine(IGRAPH_BFS_DIRECTION_OPTIMIZING) != 
+      IGRAPH_BFS_TOPDOWN) {
+    return 1;
+  }
+  if (igraph_set_bfs_engine(IGRAPH_BFS_TOPDOWN) != 
+      IGRAPH_BFS_DIRECTION_OPTIMIZING) {
+    return 2;
+  }
+
+  igraph_rng_seed(igraph_rng_default(), 42);
+
+  /* Scale-free, the bottom-up steps are used here */
+  igraph_barabasi_game(&g, 1000, /*power=*/ 1, 3, /*outseq=*/ 0, 
+		       /*outpref=*/ 0, /*A=*/ 1, IGRAPH_UNDIRECTED,
+		       IGRAPH_BARABASI_PSUMTREE, /*start_from=*/ 0);
+  if ((ret=check(&g, IGRAPH_ALL))) { return 10+ret; }
+  igraph_destroy(&g);
+
+  /* Directed, not strongly connected */
+  igraph_erdos_renyi_game(&g, IGRAPH_ERDOS_RENYI_GNM, 500, 2500,
+			  IGRAPH_DIRECTED, IGRAPH_NO_LOOPS);
+  if ((ret=check(&g, IGRAPH_OUT))) { return 20+ret; }
+  if ((ret=check(&g, IGRAPH_IN))) { return 30+ret; }
+  if ((ret=check(&g, IGRAPH_ALL))) { return 40+ret; }
+  igraph_destroy(&g);
+
+  /* Long paths, and more components */
+  igraph_ring(&g, 300, IGRAPH_UNDIRECTED, /*mutual=*/ 0, /*circular=*/ 0);
+  igraph_add_vertices(&g, 3, 0);
+  if ((ret=check(&g, IGRAPH_ALL))) { return 50+ret; }
+  igraph_destroy(&g);
+
+  igraph_empty(&g, 1, IGRAPH_DIRECTED);
+  if ((ret=check(&g, IGRAPH_OUT))) { return 60+ret; }
+  igraph_destroy(&g);
+
+  return 0;
+}
@@ -0,0 +1,78 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2007-2012  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+/* The order of the edge removals must not depend on the number of
+   threads, see tests/community.at, where this is run with different
+   OMP_NUM_THREADS values. Lattices have many ties between the edge
+   betweenness scores, so they are sensitive to rounding. */
+
+void print_removed(const igraph_t *g, const igraph_vector_t *weights) {
+  igraph_vector_t removed;
+  long int i;
+  igraph_vector_init(&removed, 0);
+  igraph_community_edge_betweenness(g, &removed, 0, 0, 0, 0, 0,
+				    IGRAPH_DIRECTED, weights);
+  for (i=0; i<igraph_vector_size(&removed); i++) {
+    printf("%li ", (long int) VECTOR(removed)[i]);
+  }
+  printf("\n");
+  igraph_vector_destroy(&removed);
+}
+
+int main() {
+  igraph_t g;
+  igraph_vector_t dim, weights;
+  long int i, size;
+
+  igraph_vector_init(&dim, 2);
+  for (size = 8; size <= 12; size += 2) {
+    VECTOR(dim)[0] = VECTOR(dim)[1] = size;
+    igraph_lattice(&g, &dim, 1, IGRAPH_UNDIRECTED, 0, 0);
+    print_removed(&g, 0);
+    igraph_destroy(&g);
+  }
+  igraph_vector_destroy(&dim);
+
+  igraph_rng_seed(igraph_rng_default(), 42);
+  for (i = 0; i < 3; i++) {
+    igraph_erdos_renyi_game(&g, IGRAPH_ERDOS_RENYI_GNM, 150, 300, 
+			    i == 2 ? IGRAPH_DIRECTED : IGRAPH_UNDIRECTED,
+			    IGRAPH_NO_LOOPS);
+    print_removed(&g, 0);
+    igraph_destroy(&g);
+  }
+
+  /* Weighted, with many equal weights */
+  igraph_ring(&g, 100, IGRAPH_UNDIRECTED, 0, 1);
+  igraph_vector_init(&weights, igraph_ecount(&g));
+  for (i = 0; i < igraph_ecount(&g); i++) {
+    VECTOR(weights)[i] = i % 3 + 1;
+  }
+  print_removed(&g, &weights);
+  igraph_vector_destroy(&weights);
+  igraph_destroy(&g);
+
+  return 0;
+}
@@ -0,0 +1,77 @@
+/* -*- mode: C -*-  */
+/*
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+int main() {
+  igraph_t g;
+  igraph_vector_t membership, membership2;
+  igraph_real_t codelength, codelength2;
+  long int i;
+
+  igraph_famous(&g, "Zachary");
+  igraph_vector_init(&membership, 0);
+  igraph_vector_init(&membership2, 0);
+
+  igraph_rng_seed(igraph_rng_default(), 42);
+  igraph_community_infomap_parallel(&g, 0, 0, /*nb_trials=*/ 10,
+				    &membership, &codelength);
+
+  /* The same seed gives the same result */
+  igraph_rng_seed(igraph_rng_default(), 42);
+  igraph_community_infomap_parallel(&g, 0, 0, /*nb_trials=*/ 10,
+				    &membership2, &codelength2);
+  if (codelength != codelength2 ||
+      !igraph_vector_all_e(&membership, &membership2)) {
+    return 1;
+  }
+
+  /* It is not worse than the serial version */
+  igraph_rng_seed(igraph_rng_default(), 42);
+  igraph_community_infomap(&g, 0, 0, /*nb_trials=*/ 10,
+			   &membership2, &codelength2);
+  if (codelength > codelength2 + 1e-10) {
+    return 2;
+  }
+
+  printf("Codelength: %0.5f (in %d modules)\n", codelength,
+	 (int) igraph_vector_max(&membership) + 1);
+  printf("Membership: ");
+  for (i=0; i < igraph_vector_size(&membership); i++) {
+    printf("%li ", (long int) VECTOR(membership)[i]);
+  }
+  printf("\n");
+
+  /* Invalid number of trials */
+  igraph_set_error_handler(igraph_error_handler_ignore);
+  if (igraph_community_infomap_parallel(&g, 0, 0, 0, &membership,
+					&codelength) != IGRAPH_EINVAL) {
+    return 3;
+  }
+
+  igraph_vector_destroy(&membership2);
+  igraph_vector_destroy(&membership);
+  igraph_destroy(&g);
+
+  return 0;
+}
@@ -0,0 +1,173 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+/* Every vertex must have a dominant label among its neighbors */
+
+int check_stable(const igraph_t *g, const igraph_vector_t *membership) {
+  long int i, j, n=igraph_vcount(g);
+  int stable=1;
+  igraph_vector_t neis, count;
+  igraph_vector_init(&neis, 0);
+  igraph_vector_init(&count, n);
+  for (i=0; stable && i<n; i++) {
+    igraph_neighbors(g, &neis, i, IGRAPH_ALL);
+    if (igraph_vector_size(&neis) == 0) { continue; }
+    igraph_vector_null(&count);
+    for (j=0; j<igraph_vector_size(&neis); j++) {
+      VECTOR(count)[ (long int) VECTOR(*membership)[ (long int) VECTOR(neis)[j] ] ] += 1;
+    }
+    if (VECTOR(count)[ (long int) VECTOR(*membership)[i] ] != 
+	igraph_vector_max(&count)) {
+      stable=0;
+    }
+  }
+  igraph_vector_destroy(&count);
+  igraph_vector_destroy(&neis);
+  return stable;
+}
+
+int main() {
+  igraph_t g;
+  igraph_vector_t membership, membership2, weights, initial, changes;
+  igraph_vector_bool_t fixed;
+  igraph_real_t modularity;
+  long int i;
+
+  igraph_vector_init(&membership, 0);
+  igraph_vector_init(&membership2, 0);
+  igraph_vector_init(&changes, 0);
+
+  /* Zachary Karate club */
+  igraph_famous(&g, "Zachary");
+  igraph_rng_seed(igraph_rng_default(), 42);
+  igraph_community_label_propagation_parallel(&g, &membership, 0, 0, 0,
+					      &modularity, &changes);
+  if (igraph_vector_max(&membership) > 4 || !check_stable(&g, &membership)) {
+    return 1;
+  }
+  if (igraph_vector_size(&changes) < 2 || VECTOR(changes)[0] == 0) {
+    return 2;
+  }
+  igraph_destroy(&g);
+
+  /* Ten cliques connected in a ring by single edges */
+  {
+    igraph_vector_t edges;
+    long int c, j, k;
+    igraph_vector_init(&edges, 0);
+    for (c = 0; c < 10; c++) {
+      for (j = 0; j < 200; j++) {
+	for (k = j+1; k < 200; k++) {
+	  igraph_vector_push_back(&edges, c*200+j);
+	  igraph_vector_push_back(&edges, c*200+k);
+	}
+      }
+      igraph_vector_push_back(&edges, c*200);
+      igraph_vector_push_back(&edges, ((c+1)*200 + 1) % 2000);
+    }
+    igraph_create(&g, &edges, 2000, IGRAPH_UNDIRECTED);
+    igraph_vector_destroy(&edges);
+  }
+  igraph_rng_seed(igraph_rng_default(), 42);
+  igraph_community_label_propagation_parallel(&g, &membership, 0, 0, 0,
+					      &modularity, &changes);
+  if (igraph_vector_max(&membership) != 9 || !check_stable(&g, &membership)) {
+    return 3;
+  }
+  for (i = 0; i < 2000; i++) {
+    if (VECTOR(membership)[i] != VECTOR(membership)[i / 200 * 200]) { 
+      return 4;
+    }
+  }
+  /* The same seed gives the same result */
+  igraph_rng_seed(igraph_rng_default(), 42);
+  igraph_community_label_propagation_parallel(&g, &membership2, 0, 0, 0,
+					      0, 0);
+  if (!igraph_vector_all_e(&membership, &membership2)) {
+    return 5;
+  }
+  igraph_destroy(&g);
+
+  /* Sparse random graphs, with many ties between the labels */
+  igraph_rng_seed(igraph_rng_default(), 42);
+  for (i = 0; i < 100; i++) {
+    igraph_erdos_renyi_game(&g, IGRAPH_ERDOS_RENYI_GNM, 2000, 3000 + 40*i,
+			    IGRAPH_UNDIRECTED, IGRAPH_NO_LOOPS);
+    igraph_community_label_propagation_parallel(&g, &membership, 0, 0, 0,
+						0, 0);
+    if (!check_stable(&g, &membership)) {
+      return 10;
+    }
+    igraph_destroy(&g);
+  }
+  
+  /* Star graph with weights and fixed labels */
+  igraph_small(&g, 0, IGRAPH_UNDIRECTED, 
+               0,  1,  0,  2,  0,  3,  0,  4,  0,  5,
+               2,  3,  2,  4,  3,  4,  3,  5,  4,  5,  -1);
+  igraph_vector_init_int_end(&weights, -1, 5, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1);
+  igraph_vector_init_int_end(&initial, -1, 0, 0, 1, 1, 1, 1, -1);
+  igraph_vector_bool_init(&fixed, 6);
+  VECTOR(fixed)[3] = 1;
+  VECTOR(fixed)[4] = 1;
+  VECTOR(fixed)[5] = 1;
+  igraph_community_label_propagation_parallel(&g, &membership, &weights,
+					      &initial, &fixed, 0, 0);
+  for (i=0; i<igraph_vcount(&g); i++)
+    if (VECTOR(membership)[i] != (i < 2 ? 0 : 1)) return 6;
+  igraph_community_label_propagation_parallel(&g, &membership, 0,
+					      &initial, &fixed, 0, 0);
+  for (i=0; i<igraph_vcount(&g); i++)
+    if (VECTOR(membership)[i] != 0) return 7;
+
+  /* Unlabeled vertices get the label of their neighbors */
+  VECTOR(initial)[2] = -1;
+  VECTOR(fixed)[2] = 0;
+  igraph_community_label_propagation_parallel(&g, &membership, &weights,
+					      &initial, &fixed, 0, &changes);
+  if (VECTOR(membership)[2] != VECTOR(membership)[3]) return 8;
+
+  igraph_vector_bool_destroy(&fixed);
+  igraph_vector_destroy(&weights);
+  igraph_vector_destroy(&initial);
+  igraph_destroy(&g);
+
+  /* Errors */
+  igraph_set_error_handler(igraph_error_handler_ignore);
+  igraph_ring(&g, 5, IGRAPH_UNDIRECTED, 0, 1);
+  igraph_vector_init_int(&weights, 2, 1, 1);
+  if (igraph_community_label_propagation_parallel(&g, &membership, &weights,
+						  0, 0, 0, 0) != IGRAPH_EINVAL) {
+    return 9;
+  }
+  igraph_vector_destroy(&weights);
+  igraph_destroy(&g);
+
+  igraph_vector_destroy(&changes);
+  igraph_vector_destroy(&membership2);
+  igraph_vector_destroy(&membership);
+
+  return 0;
+}
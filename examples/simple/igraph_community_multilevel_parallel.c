@@ -0,0 +1,196 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+#include <math.h>
+
+/* Checks that the modularity scores and the membership vectors of
+   the levels are consistent, returns the number of communities */
+
+int check(const igraph_t *g, const igraph_vector_t *weights,
+	  igraph_vector_t *membership, igraph_matrix_t *memberships,
+	  igraph_vector_t *modularity) {
+  long int i, j, n=igraph_vcount(g), levels=igraph_matrix_nrow(memberships);
+  igraph_vector_t row;
+  igraph_real_t q;
+
+  if (igraph_vector_size(modularity) != (levels ? levels : 1)) {
+    return -1;
+  }
+  igraph_vector_init(&row, n);
+  for (i=0; i<levels; i++) {
+    igraph_matrix_get_row(memberships, &row, i);
+    igraph_modularity(g, &row, &q, weights);
+    if (fabs(q - VECTOR(*modularity)[i]) > 1e-10) { return -2; }
+    if (i > 0 && VECTOR(*modularity)[i] < VECTOR(*modularity)[i-1]) {
+      return -3;
+    }
+  }
+  if (levels > 0) {
+    for (j=0; j<n; j++) {
+      if (VECTOR(*membership)[j] != MATRIX(*memberships, levels-1, j)) {
+	return -4;
+      }
+    }
+  }
+  igraph_vector_destroy(&row);
+  return igraph_vector_max(membership) + 1;
+}
+
+int main() {
+  igraph_t g;
+  igraph_vector_t modularity, modularity2, membership, membership2;
+  igraph_vector_t edges, weights;
+  igraph_matrix_t memberships;
+  int i, j, k, ret;
+
+  igraph_vector_init(&modularity, 0);
+  igraph_vector_init(&modularity2, 0);
+  igraph_vector_init(&membership, 0);
+  igraph_vector_init(&membership2, 0);
+  igraph_matrix_init(&memberships, 0, 0);
+
+  /* Unweighted test graph from the paper of Blondel et al */
+  igraph_small(&g, 16, IGRAPH_UNDIRECTED,
+      0, 2, 0, 3, 0, 4, 0, 5,
+      1, 2, 1, 4, 1, 7,
+      2, 4, 2, 5, 2, 6,
+      3, 7,
+      4, 10,
+      5, 7, 5, 11,
+      6, 7, 6, 11,
+      8, 9, 8, 10, 8, 11, 8, 14, 8, 15,
+      9, 12, 9, 14,
+      10, 11, 10, 12, 10, 13, 10, 14,
+      11, 13,
+      -1);
+  igraph_community_multilevel_parallel(&g, 0, &membership, &memberships,
+				       &modularity);
+  if (check(&g, 0, &membership, &memberships, &modularity) < 2) {
+    return 1;
+  }
+  igraph_destroy(&g);
+
+  /* Ring of 30 cliques, the cliques are not split */
+  igraph_vector_init(&edges, 0);
+  for (i = 0; i < 30; i++) {
+    for (j = 0; j < 5; j++) {
+      for (k = j+1; k < 5; k++) {
+        igraph_vector_push_back(&edges, i*5+j);
+        igraph_vector_push_back(&edges, i*5+k);
+      }
+    }
+  }
+  for (i = 0; i < 30; i++) {
+    igraph_vector_push_back(&edges, i*5 % 150);
+    igraph_vector_push_back(&edges, (i*5+6) % 150);
+  }
+  igraph_create(&g, &edges, 150, 0);
+  igraph_community_multilevel_parallel(&g, 0, &membership, &memberships,
+				       &modularity);
+  if (check(&g, 0, &membership, &memberships, &modularity) < 2) {
+    return 2;
+  }
+  for (i = 0; i < 150; i++) {
+    if (VECTOR(membership)[i] != VECTOR(membership)[i/5*5]) { return 3; }
+  }
+  igraph_destroy(&g);
+
+  /* Weighted random graph with multiple and loop edges, the result
+     must be the same in repeated runs and close to the one of the
+     sequential method */
+  igraph_rng_seed(igraph_rng_default(), 42);
+  igraph_erdos_renyi_game(&g, IGRAPH_ERDOS_RENYI_GNM, 2000, 8000,
+			  IGRAPH_UNDIRECTED, IGRAPH_LOOPS);
+  igraph_vector_clear(&edges);
+  for (i = 0; i < 1000; i++) {
+    igraph_vector_push_back(&edges, i);
+    igraph_vector_push_back(&edges, i % 50);
+  }
+  igraph_add_edges(&g, &edges, 0);
+  igraph_vector_init(&weights, igraph_ecount(&g));
+  for (i = 0; i < igraph_ecount(&g); i++) {
+    VECTOR(weights)[i] = RNG_INTEGER(1, 10);
+  }
+  igraph_community_multilevel_parallel(&g, &weights, &membership,
+				       &memberships, &modularity);
+  if ((ret=check(&g, &weights, &membership, &memberships, &modularity)) < 2) {
+    printf("%d\n", ret);
+    return 4;
+  }
+  igraph_community_multilevel_parallel(&g, &weights, &membership2, 0,
+				       &modularity2);
+  if (!igraph_vector_all_e(&membership, &membership2) ||
+      !igraph_vector_all_e(&modularity, &modularity2)) {
+    return 5;
+  }
+  igraph_community_multilevel(&g, &weights, &membership2, 0, &modularity2);
+  if (fabs(igraph_vector_tail(&modularity) - 
+	   igraph_vector_tail(&modularity2)) > 0.05) {
+    return 6;
+  }
+  igraph_vector_destroy(&weights);
+  igraph_destroy(&g);
+
+  /* Isolated vertices only */
+  igraph_empty(&g, 25, IGRAPH_UNDIRECTED);
+  igraph_community_multilevel_parallel(&g, 0, &membership, 0, &modularity);
+  if (igraph_vector_size(&modularity) != 1 || 
+      igraph_vector_size(&membership) != 25 ||
+      igraph_vector_max(&membership) != 24) {
+    return 7;
+  }
+  igraph_destroy(&g);
+
+  /* Errors */
+  igraph_set_error_handler(igraph_error_handler_ignore);
+  igraph_small(&g, 3, IGRAPH_DIRECTED, 0, 1, 1, 2, -1);
+  if (igraph_community_multilevel_parallel(&g, 0, &membership, 0, 0) !=
+      IGRAPH_UNIMPLEMENTED) {
+    return 8;
+  }
+  igraph_destroy(&g);
+  igraph_small(&g, 3, IGRAPH_UNDIRECTED, 0, 1, 1, 2, -1);
+  igraph_vector_init_int(&weights, 1, 1);
+  if (igraph_community_multilevel_parallel(&g, &weights, &membership, 0, 0) !=
+      IGRAPH_EINVAL) {
+    return 9;
+  }
+  igraph_vector_destroy(&weights);
+  igraph_vector_init_int(&weights, 2, 1, -1);
+  if (igraph_community_multilevel_parallel(&g, &weights, &membership, 0, 0) !=
+      IGRAPH_EINVAL) {
+    return 10;
+  }
+  igraph_vector_destroy(&weights);
+  igraph_destroy(&g);
+
+  igraph_vector_destroy(&edges);
+  igraph_vector_destroy(&modularity);
+  igraph_vector_destroy(&modularity2);
+  igraph_vector_destroy(&membership);
+  igraph_vector_destroy(&membership2);
+  igraph_matrix_destroy(&memberships);
+
+  return 0;
+}
@@ -0,0 +1,113 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+int main() {
+  igraph_t g, clique;
+  igraph_vector_t membership, membership2, csize, edges;
+  igraph_real_t modularity, modularity2, temperature;
+  long int i, j;
+
+  /* Four cliques of ten vertices, connected into a ring */
+  igraph_full(&clique, 10, IGRAPH_UNDIRECTED, IGRAPH_NO_LOOPS);
+  igraph_vector_init(&edges, 0);
+  igraph_get_edgelist(&clique, &edges, 0);
+  for (i = 1; i < 4; i++) {
+    for (j = 0; j < 90; j++) {
+      igraph_vector_push_back(&edges, VECTOR(edges)[j] + 10 * i);
+    }
+  }
+  for (i = 0; i < 4; i++) {
+    igraph_vector_push_back(&edges, 10 * i);
+    igraph_vector_push_back(&edges, (10 * i + 15) % 40);
+  }
+  igraph_create(&g, &edges, 40, IGRAPH_UNDIRECTED);
+  igraph_destroy(&clique);
+
+  igraph_vector_init(&membership, 0);
+  igraph_vector_init(&membership2, 0);
+  igraph_vector_init(&csize, 0);
+
+  igraph_rng_seed(igraph_rng_default(), 42);
+  igraph_community_spinglass_replicas(&g, /*weights=*/ 0, &modularity,
+				      &temperature, &membership, &csize,
+				      /*spins=*/ 8, /*starttemp=*/ 1.0,
+				      /*stoptemp=*/ 0.01,
+				      IGRAPH_SPINCOMM_UPDATE_CONFIG,
+				      /*gamma=*/ 1.0, /*replicas=*/ 4,
+				      /*rounds=*/ 20);
+
+  /* The four cliques are found */
+  if (igraph_vector_size(&csize) != 4) {
+    return 1;
+  }
+  for (i = 0; i < 4; i++) {
+    if (VECTOR(csize)[i] != 10) {
+      return 2;
+    }
+    for (j = 1; j < 10; j++) {
+      if (VECTOR(membership)[10 * i + j] != VECTOR(membership)[10 * i]) {
+	return 3;
+      }
+    }
+  }
+  printf("%.4f\n", modularity);
+
+  /* The same seed gives the same result */
+  igraph_rng_seed(igraph_rng_default(), 42);
+  igraph_community_spinglass_replicas(&g, /*weights=*/ 0, &modularity2,
+				      /*temperature=*/ 0, &membership2,
+				      /*csize=*/ 0, /*spins=*/ 8,
+				      /*starttemp=*/ 1.0, /*stoptemp=*/ 0.01,
+				      IGRAPH_SPINCOMM_UPDATE_CONFIG,
+				      /*gamma=*/ 1.0, /*replicas=*/ 4,
+				      /*rounds=*/ 20);
+  if (modularity != modularity2 ||
+      !igraph_vector_all_e(&membership, &membership2)) {
+    return 4;
+  }
+
+  /* Invalid arguments */
+  igraph_set_error_handler(igraph_error_handler_ignore);
+  if (igraph_community_spinglass_replicas(&g, 0, 0, 0, &membership, 0, 8,
+					  1.0, 0.01,
+					  IGRAPH_SPINCOMM_UPDATE_CONFIG, 1.0,
+					  /*replicas=*/ 1, 20) != IGRAPH_EINVAL) {
+    return 5;
+  }
+  if (igraph_community_spinglass_replicas(&g, 0, 0, 0, &membership, 0, 8,
+					  1.0, /*stoptemp=*/ 0.0,
+					  IGRAPH_SPINCOMM_UPDATE_CONFIG, 1.0,
+					  4, 20) != IGRAPH_EINVAL) {
+    return 6;
+  }
+
+  igraph_vector_destroy(&csize);
+  igraph_vector_destroy(&membership2);
+  igraph_vector_destroy(&membership);
+  igraph_vector_destroy(&edges);
+  igraph_destroy(&g);
+
+  return 0;
+}
@@ -0,0 +1,81 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+
+int main() {
+  igraph_t g;
+  igraph_matrix_t merges, merges2;
+  igraph_vector_t modularity, modularity2, membership, membership2;
+  igraph_integer_t computations, recomputations;
+  igraph_real_t limits[2];
+  int i;
+
+  igraph_famous(&g, "Zachary");
+  igraph_matrix_init(&merges, 0, 0);
+  igraph_matrix_init(&merges2, 0, 0);
+  igraph_vector_init(&modularity, 0);
+  igraph_vector_init(&modularity2, 0);
+  igraph_vector_init(&membership, 0);
+  igraph_vector_init(&membership2, 0);
+
+  /* Without a limit this is the same as igraph_community_walktrap */
+  igraph_community_walktrap(&g, 0, 4, &merges, &modularity, &membership);
+  igraph_community_walktrap_bounded(&g, 0, 4, &merges2, &modularity2,
+				    &membership2, /*max_memory=*/ -1,
+				    &computations, &recomputations);
+  if (!igraph_matrix_all_e(&merges, &merges2) ||
+      !igraph_vector_all_e(&modularity, &modularity2) ||
+      !igraph_vector_all_e(&membership, &membership2)) {
+    return 1;
+  }
+  printf("%li %li\n", (long int) computations, (long int) recomputations);
+
+  /* With a limit the probability vectors are computed again, the
+     communities are the same on this graph. The first limit is a
+     fraction of what the vectors of the unbounded run need, at least
+     one float per vertex each, the second one certainly forces the
+     deletion of every vector. The memory used depends on the
+     platform, so only the second run checks the recomputations. */
+  limits[0] = computations * igraph_vcount(&g) * sizeof(float) / 4.0;
+  limits[1] = 1;
+  for (i = 0; i < 2; i++) {
+    igraph_community_walktrap_bounded(&g, 0, 4, &merges2, &modularity2,
+				      &membership2, limits[i],
+				      &computations, &recomputations);
+    if ((i == 1 && recomputations == 0) ||
+	!igraph_vector_all_e(&membership, &membership2)) {
+      return 2;
+    }
+  }
+
+  igraph_vector_destroy(&membership2);
+  igraph_vector_destroy(&membership);
+  igraph_vector_destroy(&modularity2);
+  igraph_vector_destroy(&modularity);
+  igraph_matrix_destroy(&merges2);
+  igraph_matrix_destroy(&merges);
+  igraph_destroy(&g);
+
+  return 0;
+}
@@ -0,0 +1,122 @@
+/* -*- mode: C -*-  */
+/*
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+#include <math.h>
+
+int main() {
+  igraph_real_t m1[] = { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2 };
+  igraph_real_t m2[] = { 5, 5, 5, 5, 3, 3, 3, 3, 7, 7, 7, 7 };
+  igraph_real_t m3[] = { 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0 };
+  igraph_real_t m4[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+  igraph_real_t m5[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+  igraph_real_t *mm[] = { m1, m2, m3, m4, m5 };
+  const char *names[] = { "VI", "NMI", "split-join", "Rand", "adjusted Rand" };
+  igraph_vector_t v[5], bad;
+  igraph_vector_ptr_t comms;
+  igraph_matrix_t res;
+  igraph_real_t r;
+  long int i, j, k, n = 12;
+  int method;
+
+  igraph_vector_ptr_init(&comms, 5);
+  for (i = 0; i < 5; i++) {
+    igraph_vector_view(&v[i], mm[i], n);
+    VECTOR(comms)[i] = &v[i];
+  }
+  igraph_matrix_init(&res, 0, 0);
+
+  for (method = IGRAPH_COMMCMP_VI; method <= IGRAPH_COMMCMP_ADJUSTED_RAND;
+       method++) {
+    igraph_compare_communities_matrix(&comms, &res, method);
+    printf("%s:\n", names[method]);
+    for (i = 0; i < 3; i++) {
+      for (j = 0; j < 3; j++) {
+        printf(" %.4f", MATRIX(res, i, j));
+      }
+      printf("\n");
+    }
+    /* Same as comparing the pairs one by one */
+    for (i = 0; i < 5; i++) {
+      for (j = 0; j < 5; j++) {
+        igraph_compare_communities(&v[i], &v[j], &r, method);
+        if (!(fabs(r - MATRIX(res, i, j)) < 1e-12) &&
+            !(isnan(r) && isnan(MATRIX(res, i, j)))) {
+          printf("%s differs for %li and %li: %g vs %g\n", names[method],
+                 i, j, r, MATRIX(res, i, j));
+          return 1;
+        }
+      }
+    }
+  }
+
+  /* Random partitions of a larger set */
+  n = 1000;
+  igraph_rng_seed(igraph_rng_default(), 42);
+  for (i = 0; i < 5; i++) {
+    igraph_vector_init(&v[i], n);
+    for (k = 0; k < n; k++) {
+      VECTOR(v[i])[k] = RNG_INTEGER(0, 3 + 10 * i);
+    }
+  }
+  for (method = IGRAPH_COMMCMP_VI; method <= IGRAPH_COMMCMP_ADJUSTED_RAND;
+       method++) {
+    igraph_compare_communities_matrix(&comms, &res, method);
+    for (i = 0; i < 5; i++) {
+      for (j = 0; j < 5; j++) {
+        igraph_compare_communities(&v[i], &v[j], &r, method);
+        if (fabs(r - MATRIX(res, i, j)) > 1e-12) {
+          printf("%s differs for %li and %li: %g vs %g\n", names[method],
+                 i, j, r, MATRIX(res, i, j));
+          return 2;
+        }
+      }
+    }
+  }
+
+  /* Empty set of community structures */
+  igraph_vector_ptr_clear(&comms);
+  igraph_compare_communities_matrix(&comms, &res, IGRAPH_COMMCMP_NMI);
+  if (igraph_matrix_nrow(&res) != 0 || igraph_matrix_ncol(&res) != 0) {
+    return 3;
+  }
+
+  /* Different lengths */
+  igraph_set_error_handler(igraph_error_handler_ignore);
+  igraph_vector_init(&bad, n - 1);
+  igraph_vector_ptr_push_back(&comms, &v[0]);
+  igraph_vector_ptr_push_back(&comms, &bad);
+  if (igraph_compare_communities_matrix(&comms, &res,
+                                        IGRAPH_COMMCMP_NMI) != IGRAPH_EINVAL) {
+    return 4;
+  }
+
+  igraph_vector_destroy(&bad);
+  for (i = 0; i < 5; i++) {
+    igraph_vector_destroy(&v[i]);
+  }
+  igraph_matrix_destroy(&res);
+  igraph_vector_ptr_destroy(&comms);
+
+  return 0;
+}
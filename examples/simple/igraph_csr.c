@@ -0,0 +1,161 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2006-2012  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+#include <math.h>
+
+void print_csr(const igraph_csr_t *csr) {
+  long int i, j;
+  for (i=0; i<csr->length; i++) {
+    int *neis=igraph_csr_neighbors(csr, i);
+    int *eids=igraph_csr_incident(csr, i);
+    printf("%li:", i);
+    for (j=0; j<igraph_csr_degree(csr, i); j++) {
+      printf(" %i(%i)", neis[j], eids[j]);
+    }
+    printf("\n");
+  }
+}
+
+/* Compare the CSR based functions to the ones that work on igraph_t */
+
+int check(const igraph_t *g, igraph_neimode_t mode) {
+  igraph_csr_t csr;
+  igraph_matrix_t m1, m2;
+  igraph_vector_t v1, v2, weights;
+  igraph_vector_int_t dist;
+  igraph_bool_t directed=igraph_is_directed(g) && mode != IGRAPH_ALL;
+  long int i, n=igraph_vcount(g);
+
+  igraph_csr_init(g, &csr, mode);
+  igraph_matrix_init(&m1, 0, 0);
+  igraph_matrix_init(&m2, 0, 0);
+  igraph_vector_init(&v1, 0);
+  igraph_vector_init(&v2, 0);
+  igraph_vector_int_init(&dist, 0);
+
+  /* shortest paths & BFS */
+  igraph_shortest_paths(g, &m1, igraph_vss_all(), igraph_vss_all(), mode);
+  igraph_shortest_paths_csr(&csr, &m2, 0);
+  if (!igraph_matrix_all_e(&m1, &m2)) {
+    return 1;
+  }
+  igraph_bfs_csr(&csr, 0, 0, 0, &dist);
+  for (i=0; i<n; i++) {
+    if ((VECTOR(dist)[i] < 0 && MATRIX(m1, 0, i) != IGRAPH_INFINITY) ||
+	(VECTOR(dist)[i] >= 0 && MATRIX(m1, 0, i) != VECTOR(dist)[i])) {
+      return 2;
+    }
+  }
+
+  /* PageRank, unweighted and weighted */
+  igraph_pagerank(g, IGRAPH_PAGERANK_ALGO_PRPACK, &v1, 0, igraph_vss_all(),
+		  directed, 0.85, 0, 0);
+  igraph_pagerank_csr(&csr, &v2, 0, 0.85, 0);
+  for (i=0; i<n; i++) {
+    if (fabs(VECTOR(v1)[i]-VECTOR(v2)[i]) > 1e-8) {
+      return 3;
+    }
+  }
+  igraph_vector_init(&weights, igraph_ecount(g));
+  for (i=0; i<igraph_ecount(g); i++) {
+    VECTOR(weights)[i] = (i % 5) + 1;
+  }
+  igraph_pagerank(g, IGRAPH_PAGERANK_ALGO_PRPACK, &v1, 0, igraph_vss_all(),
+		  directed, 0.85, &weights, 0);
+  igraph_pagerank_csr(&csr, &v2, 0, 0.85, &weights);
+  for (i=0; i<n; i++) {
+    if (fabs(VECTOR(v1)[i]-VECTOR(v2)[i]) > 1e-8) {
+      return 4;
+    }
+  }
+  igraph_vector_destroy(&weights);
+
+  /* Transitivity */
+  if (!directed) {
+    igraph_transitivity_local_undirected(g, &v1, igraph_vss_all(),
+					 IGRAPH_TRANSITIVITY_ZERO);
+    igraph_transitivity_local_undirected_csr(&csr, &v2,
+					     IGRAPH_TRANSITIVITY_ZERO);
+    for (i=0; i<n; i++) {
+      if (fabs(VECTOR(v1)[i]-VECTOR(v2)[i]) > 1e-12) {
+	return 5;
+      }
+    }
+  }
+
+  igraph_vector_int_destroy(&dist);
+  igraph_vector_destroy(&v2);
+  igraph_vector_destroy(&v1);
+  igraph_matrix_destroy(&m2);
+  igraph_matrix_destroy(&m1);
+  igraph_csr_destroy(&csr);
+
+  return 0;
+}
+
+int main() {
+
+  igraph_t g;
+  igraph_csr_t csr;
+  igraph_vector_int_t order, father, dist;
+  int ret;
+
+  /* Small graph with a loop and a multiple edge */
+  igraph_small(&g, 5, IGRAPH_DIRECTED, 0,1, 1,2, 2,0, 2,3, 3,3, 0,1, 4,0, -1);
+  igraph_csr_init(&g, &csr, IGRAPH_OUT);
+  print_csr(&csr);
+  igraph_csr_destroy(&csr);
+  igraph_csr_init(&g, &csr, IGRAPH_ALL);
+  print_csr(&csr);
+
+  igraph_vector_int_init(&order, 0);
+  igraph_vector_int_init(&father, 0);
+  igraph_vector_int_init(&dist, 0);
+  igraph_bfs_csr(&csr, 3, &order, &father, &dist);
+  igraph_vector_int_print(&order);
+  igraph_vector_int_print(&father);
+  igraph_vector_int_print(&dist);
+  igraph_vector_int_destroy(&dist);
+  igraph_vector_int_destroy(&father);
+  igraph_vector_int_destroy(&order);
+  igraph_csr_destroy(&csr);
+  igraph_destroy(&g);
+
+  igraph_rng_seed(igraph_rng_default(), 42);
+
+  igraph_erdos_renyi_game(&g, IGRAPH_ERDOS_RENYI_GNM, 200, 600,
+			  IGRAPH_DIRECTED, IGRAPH_LOOPS);
+  if ((ret=check(&g, IGRAPH_OUT))) { return ret; }
+  if ((ret=check(&g, IGRAPH_IN))) { return ret+10; }
+  if ((ret=check(&g, IGRAPH_ALL))) { return ret+20; }
+  igraph_destroy(&g);
+
+  igraph_barabasi_game(&g, 300, /*power=*/ 1, 3, /*outseq=*/ 0,
+		       /*outpref=*/ 0, /*A=*/ 1, IGRAPH_UNDIRECTED,
+		       IGRAPH_BARABASI_PSUMTREE_MULTIPLE, /*start_from=*/ 0);
+  if ((ret=check(&g, IGRAPH_ALL))) { return ret+30; }
+  igraph_destroy(&g);
+
+  return 0;
+}
@@ -0,0 +1,148 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+#include <math.h>
+
+/* The power iteration must agree with PRPACK */
+
+int close_to(const igraph_vector_t *v1, const igraph_vector_t *v2, 
+	     igraph_real_t tol) {
+  long int i, n=igraph_vector_size(v1);
+  if (igraph_vector_size(v2) != n) { return 0; }
+  for (i=0; i<n; i++) {
+    if (fabs(VECTOR(*v1)[i]-VECTOR(*v2)[i]) > tol) { return 0; }
+  }
+  return 1;
+}
+
+int check(const igraph_t *g, igraph_bool_t directed, igraph_real_t damping,
+	  igraph_vector_t *reset, const igraph_vector_t *weights) {
+  igraph_vector_t v1, v2;
+  igraph_pagerank_power_options_t options;
+  igraph_real_t value;
+  int ret=0;
+
+  igraph_vector_init(&v1, 0);
+  igraph_vector_init(&v2, 0);
+  options.niter=10000;
+  options.eps=1e-12;
+  igraph_personalized_pagerank(g, IGRAPH_PAGERANK_ALGO_PRPACK, &v1, 0,
+			       igraph_vss_all(), directed, damping, reset,
+			       weights, 0);
+  igraph_personalized_pagerank(g, IGRAPH_PAGERANK_ALGO_POWER, &v2, &value,
+			       igraph_vss_all(), directed, damping, reset,
+			       weights, &options);
+  if (!close_to(&v1, &v2, 1e-9) || value != 1.0) { ret=1; }
+
+  /* From the solution, a single iteration is enough */
+  options.niter=1;
+  igraph_set_warning_handler(igraph_warning_handler_ignore);
+  igraph_pagerank_power(g, &v2, 0, igraph_vss_all(), directed, damping,
+			reset, weights, &options, /*start=*/ &v1);
+  if (!close_to(&v1, &v2, 1e-9)) { ret=2; }
+
+  /* But not from the uniform distribution */
+  igraph_pagerank_power(g, &v2, 0, igraph_vss_all(), directed, damping,
+			reset, weights, &options, /*start=*/ 0);
+  if (close_to(&v1, &v2, 1e-9)) { ret=3; }
+  igraph_set_warning_handler(igraph_warning_handler_print);
+
+  /* Default options, some vertices only */
+  igraph_pagerank_power(g, &v2, 0, igraph_vss_1(2), directed, damping,
+			reset, weights, 0, 0);
+  if (igraph_vector_size(&v2) != 1 || fabs(VECTOR(v1)[2]-VECTOR(v2)[0]) > 1e-9) {
+    ret=4;
+  }
+
+  igraph_vector_destroy(&v2);
+  igraph_vector_destroy(&v1);
+  return ret;
+}
+
+int main() {
+  igraph_t g;
+  igraph_vector_t weights, reset, start;
+  igraph_pagerank_power_options_t options;
+  long int i;
+  int ret;
+
+  igraph_rng_seed(igraph_rng_default(), 42);
+
+  igraph_barabasi_game(&g, 1000, /*power=*/ 1, 3, /*outseq=*/ 0, 
+		       /*outpref=*/ 0, /*A=*/ 1, IGRAPH_UNDIRECTED,
+		       IGRAPH_BARABASI_PSUMTREE, /*start_from=*/ 0);
+  if ((ret=check(&g, 0, 0.85, 0, 0))) { return 10+ret; }
+  igraph_destroy(&g);
+
+  /* Directed, with dangling vertices, weighted and personalized */
+  igraph_erdos_renyi_game(&g, IGRAPH_ERDOS_RENYI_GNM, 500, 1000,
+			  IGRAPH_DIRECTED, IGRAPH_NO_LOOPS);
+  igraph_vector_init(&weights, igraph_ecount(&g));
+  for (i=0; i<igraph_ecount(&g); i++) {
+    VECTOR(weights)[i]=igraph_rng_get_unif(igraph_rng_default(), 0, 5);
+  }
+  VECTOR(weights)[0]=0;
+  igraph_vector_init(&reset, igraph_vcount(&g));
+  VECTOR(reset)[2]=1; VECTOR(reset)[10]=3;
+  if ((ret=check(&g, 1, 0.85, 0, 0))) { return 20+ret; }
+  if ((ret=check(&g, 0, 0.85, 0, 0))) { return 30+ret; }
+  if ((ret=check(&g, 1, 0.85, 0, &weights))) { return 40+ret; }
+  if ((ret=check(&g, 1, 0.5, &reset, 0))) { return 50+ret; }
+  if ((ret=check(&g, 1, 0.85, &reset, &weights))) { return 60+ret; }
+
+  /* Errors */
+  igraph_set_error_handler(igraph_error_handler_ignore);
+  igraph_vector_init(&start, 3);
+  if (igraph_pagerank_power(&g, &reset, 0, igraph_vss_all(), 1, 0.85, 0, 0,
+			    0, &start) != IGRAPH_EINVAL) {
+    return 2;
+  }
+  igraph_vector_resize(&start, igraph_vcount(&g));
+  igraph_vector_null(&start);
+  if (igraph_pagerank_power(&g, &reset, 0, igraph_vss_all(), 1, 0.85, 0, 0,
+			    0, &start) != IGRAPH_EINVAL) {
+    return 3;
+  }
+  options.niter=0; options.eps=1e-10;
+  if (igraph_pagerank_power(&g, &reset, 0, igraph_vss_all(), 1, 0.85, 0, 0,
+			    &options, 0) != IGRAPH_EINVAL) {
+    return 4;
+  }
+  igraph_set_error_handler(igraph_error_handler_abort);
+
+  igraph_vector_destroy(&start);
+  igraph_vector_destroy(&reset);
+  igraph_vector_destroy(&weights);
+  igraph_destroy(&g);
+
+  /* Empty graph */
+  igraph_empty(&g, 0, IGRAPH_DIRECTED);
+  igraph_vector_init(&reset, 1);
+  igraph_pagerank_power(&g, &reset, 0, igraph_vss_all(), 1, 0.85, 0, 0, 0, 0);
+  if (igraph_vector_size(&reset) != 0) { return 5; }
+  igraph_vector_destroy(&reset);
+  igraph_destroy(&g);
+
+  return 0;
+}
@@ -0,0 +1,79 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+#include <stdio.h>
+#include <string.h>
+
+/* The scores of the power iteration must not depend on the number of
+   threads, see tests/structural_properties.at, where this is run with
+   different OMP_NUM_THREADS values, and the printed scores are
+   compared. The graph is large enough to be split into several
+   parts. The CSR version must give exactly the same scores, for
+   both snapshot modes. */
+
+int main(int argc, char **argv) {
+  igraph_t g;
+  igraph_vector_t pr, csrpr, weights;
+  igraph_csr_t csr;
+  long int i, n=100000;
+  igraph_bool_t print= argc > 1 && !strcmp(argv[1], "print");
+  igraph_pagerank_power_options_t options={ 10000, 1e-10 };
+  igraph_integer_t mode[2]={ IGRAPH_IN, IGRAPH_OUT };
+  int m;
+
+  igraph_rng_seed(igraph_rng_default(), 42);
+  igraph_erdos_renyi_game(&g, IGRAPH_ERDOS_RENYI_GNM, n, 4*n, 
+			  IGRAPH_DIRECTED, IGRAPH_NO_LOOPS);
+  igraph_vector_init(&weights, igraph_ecount(&g));
+  for (i=0; i<igraph_ecount(&g); i++) {
+    VECTOR(weights)[i]=igraph_rng_get_unif(igraph_rng_default(), 0, 2);
+  }
+
+  igraph_vector_init(&pr, 0);
+  igraph_vector_init(&csrpr, 0);
+  igraph_pagerank_power(&g, &pr, 0, igraph_vss_all(), IGRAPH_DIRECTED,
+			0.85, 0, &weights, &options, 0);
+
+  for (m=0; m<2; m++) {
+    igraph_csr_init(&g, &csr, mode[m]);
+    igraph_pagerank_csr(&csr, &csrpr, 0, 0.85, &weights);
+    igraph_csr_destroy(&csr);
+    if (!igraph_vector_all_e(&pr, &csrpr)) {
+      return 1;
+    }
+  }
+
+  if (print) {
+    for (i=0; i<n; i += 997) {
+      printf("%li %.17g\n", i, VECTOR(pr)[i]);
+    }
+  }
+
+  igraph_vector_destroy(&csrpr);
+  igraph_vector_destroy(&pr);
+  igraph_vector_destroy(&weights);
+  igraph_destroy(&g);
+
+  return 0;
+}
@@ -0,0 +1,215 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+#include <math.h>
+
+/* The incremental updates must agree with a full calculation on the
+   new graph */
+
+int check(const igraph_t *g, const igraph_pagerank_state_t *state,
+	  igraph_vector_t *reset) {
+  igraph_vector_t v1, v2;
+  igraph_pagerank_power_options_t options = { 10000, 1e-13 };
+  long int i, n=igraph_vcount(g);
+  int ret=0;
+
+  igraph_vector_init(&v1, 0);
+  igraph_vector_init(&v2, 0);
+  igraph_pagerank_power(g, &v1, 0, igraph_vss_all(), state->directed, 
+			state->damping, reset,
+			state->weighted ? &state->weights : 0, &options, 0);
+  igraph_pagerank_state_get(g, state, &v2, igraph_vss_all());
+  for (i=0; i<n; i++) {
+    if (fabs(VECTOR(v1)[i]-VECTOR(v2)[i]) > 1e-8) { ret=1; }
+  }
+  igraph_vector_destroy(&v2);
+  igraph_vector_destroy(&v1);
+  return ret;
+}
+
+/* Removes 'nrem' random edges and adds 'nadd' random edges */
+
+int update(igraph_t *g, igraph_pagerank_state_t *state, 
+	   long int nrem, long int nadd) {
+  igraph_vector_t add, weights, remove;
+  long int i, n=igraph_vcount(g), m=igraph_ecount(g);
+  int ret;
+
+  igraph_vector_init(&add, 2*nadd);
+  igraph_vector_init(&weights, nadd);
+  igraph_vector_init(&remove, nrem);
+  for (i=0; i<2*nadd; i++) {
+    VECTOR(add)[i]=igraph_rng_get_integer(igraph_rng_default(), 0, n-1);
+  }
+  for (i=0; i<nadd; i++) {
+    VECTOR(weights)[i]=igraph_rng_get_unif(igraph_rng_default(), 0.1, 2);
+  }
+  for (i=0; i<nrem; i++) {
+    VECTOR(remove)[i]=igraph_rng_get_integer(igraph_rng_default(), 0, m-1);
+  }
+  ret=igraph_pagerank_state_update(g, state, &add, 
+				   state->weighted ? &weights : 0,
+				   igraph_ess_vector(&remove));
+  igraph_vector_destroy(&remove);
+  igraph_vector_destroy(&weights);
+  igraph_vector_destroy(&add);
+  return ret;
+}
+
+int interrupt(void *data) {
+  return 1;
+}
+
+int run(igraph_t *g, igraph_bool_t directed, igraph_vector_t *reset, 
+	igraph_vector_t *weights) {
+  igraph_pagerank_state_t state;
+  igraph_es_t es;
+  long int i, m;
+  igraph_integer_t from, to;
+  int ret;
+
+  if (igraph_pagerank_state_init(g, &state, directed, 0.85, reset, 
+				 weights, 1e-10)) {
+    return 1;
+  }
+  if (check(g, &state, reset)) { return 2; }
+
+  for (i=0; i<20; i++) {
+    if (update(g, &state, i % 3, i % 4)) { return 3; }
+    if (check(g, &state, reset)) { return 4; }
+  }
+
+  /* An interrupted update changes neither the graph nor the state,
+     the update makes a vertex dangling, so it is always interrupted */
+  m=igraph_ecount(g);
+  igraph_edge(g, 0, &from, &to);
+  igraph_set_error_handler(igraph_error_handler_ignore);
+  igraph_set_interruption_handler(interrupt);
+  igraph_es_incident(&es, from, IGRAPH_ALL);
+  ret=igraph_pagerank_state_update(g, &state, 0, 0, es);
+  igraph_es_destroy(&es);
+  igraph_set_interruption_handler(0);
+  igraph_set_error_handler(igraph_error_handler_abort);
+  if (ret != IGRAPH_INTERRUPTED || igraph_ecount(g) != m) { return 8; }
+  if (check(g, &state, reset)) { return 9; }
+
+  /* Make vertex 0 dangling, then give it an edge again */
+  igraph_es_incident(&es, 0, IGRAPH_ALL);
+  igraph_pagerank_state_update(g, &state, 0, 0, es);
+  igraph_es_destroy(&es);
+  if (check(g, &state, reset)) { return 5; }
+  if (update(g, &state, 0, 10)) { return 6; }
+  if (check(g, &state, reset)) { return 7; }
+
+  igraph_pagerank_state_destroy(&state);
+  return 0;
+}
+
+int main() {
+
+  igraph_t g;
+  igraph_vector_t weights, reset, edges;
+  igraph_pagerank_state_t state;
+  long int i;
+  int ret;
+
+  igraph_rng_seed(igraph_rng_default(), 42);
+
+  /* Directed */
+  igraph_erdos_renyi_game(&g, IGRAPH_ERDOS_RENYI_GNM, 100, 300, 
+			  IGRAPH_DIRECTED, IGRAPH_LOOPS);
+  if ((ret=run(&g, IGRAPH_DIRECTED, 0, 0))) { return ret; }
+  if ((ret=run(&g, IGRAPH_UNDIRECTED, 0, 0))) { return 10+ret; }
+
+  /* Weighted and personalized */
+  igraph_vector_init(&weights, igraph_ecount(&g));
+  for (i=0; i<igraph_ecount(&g); i++) {
+    VECTOR(weights)[i]=igraph_rng_get_unif(igraph_rng_default(), 0, 2);
+  }
+  VECTOR(weights)[0]=-1;
+  igraph_vector_init(&reset, igraph_vcount(&g));
+  for (i=0; i<10; i++) {
+    VECTOR(reset)[i]=i+1;
+  }
+  if ((ret=run(&g, IGRAPH_DIRECTED, &reset, &weights))) { return 20+ret; }
+  igraph_vector_destroy(&reset);
+  igraph_vector_destroy(&weights);
+  igraph_destroy(&g);
+
+  /* Undirected */
+  igraph_barabasi_game(&g, 100, /*power=*/ 1, 2, /*outseq=*/ 0, 
+		       /*outpref=*/ 0, /*A=*/ 1, IGRAPH_UNDIRECTED,
+		       IGRAPH_BARABASI_PSUMTREE, /*start_from=*/ 0);
+  if ((ret=run(&g, IGRAPH_DIRECTED, 0, 0))) { return 30+ret; }
+  igraph_destroy(&g);
+
+  /* Errors */
+  igraph_set_error_handler(igraph_error_handler_ignore);
+  igraph_small(&g, 3, IGRAPH_DIRECTED, 0,1, 1,2, -1);
+  if (igraph_pagerank_state_init(&g, &state, IGRAPH_DIRECTED, 0.85, 0, 0,
+				 0.0) != IGRAPH_EINVAL) {
+    return 41;
+  }
+  if (igraph_pagerank_state_init(&g, &state, IGRAPH_DIRECTED, 1.5, 0, 0,
+				 1e-10) != IGRAPH_EINVAL) {
+    return 42;
+  }
+  if (igraph_pagerank_state_init(&g, &state, IGRAPH_DIRECTED, 1.0, 0, 0,
+				 1e-10) != IGRAPH_EINVAL) {
+    return 47;
+  }
+  igraph_pagerank_state_init(&g, &state, IGRAPH_DIRECTED, 0.85, 0, 0, 1e-10);
+  igraph_vector_init_int(&edges, 2, 0, 3);
+  if (igraph_pagerank_state_update(&g, &state, &edges, 0, 
+				   igraph_ess_none()) != IGRAPH_EINVVID) {
+    return 43;
+  }
+  igraph_vector_resize(&edges, 1);
+  if (igraph_pagerank_state_update(&g, &state, &edges, 0, 
+				   igraph_ess_none()) != IGRAPH_EINVEVECTOR) {
+    return 44;
+  }
+  if (igraph_pagerank_state_update(&g, &state, 0, &edges,
+				   igraph_ess_none()) != IGRAPH_EINVAL) {
+    return 45;
+  }
+  igraph_vector_destroy(&edges);
+  igraph_pagerank_state_destroy(&state);
+  igraph_destroy(&g);
+
+  /* Empty graph */
+  igraph_empty(&g, 0, IGRAPH_DIRECTED);
+  igraph_pagerank_state_init(&g, &state, IGRAPH_DIRECTED, 0.85, 0, 0, 1e-10);
+  igraph_vector_init(&edges, 1);
+  if (igraph_pagerank_state_update(&g, &state, 0, 0, igraph_ess_none()) ||
+      igraph_pagerank_state_get(&g, &state, &edges, igraph_vss_all()) ||
+      igraph_vector_size(&edges) != 0) {
+    return 46;
+  }
+  igraph_vector_destroy(&edges);
+  igraph_pagerank_state_destroy(&state);
+  igraph_destroy(&g);
+
+  return 0;
+}
@@ -0,0 +1,138 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+#include <math.h>
+
+/* Every column must agree with the single reset vector version */
+
+int check(const igraph_t *g, igraph_bool_t directed, 
+	  const igraph_matrix_t *resets, const igraph_vector_t *weights) {
+  igraph_matrix_t res;
+  igraph_vector_t reset, v;
+  long int i, j, n=igraph_vcount(g), k=igraph_matrix_ncol(resets);
+  int ret=0;
+
+  igraph_matrix_init(&res, 0, 0);
+  igraph_vector_init(&reset, 0);
+  igraph_vector_init(&v, 0);
+  igraph_personalized_pagerank_batch(g, &res, igraph_vss_all(), directed,
+				     0.85, resets, weights, 0);
+  if (igraph_matrix_nrow(&res) != n || igraph_matrix_ncol(&res) != k) {
+    ret=1;
+  }
+  for (j=0; !ret && j<k; j++) {
+    igraph_matrix_get_col(resets, &reset, j);
+    igraph_pagerank_power(g, &v, 0, igraph_vss_all(), directed, 0.85,
+			  &reset, weights, 0, 0);
+    for (i=0; i<n; i++) {
+      if (fabs(VECTOR(v)[i] - MATRIX(res, i, j)) > 1e-9) { ret=2; }
+    }
+  }
+
+  /* Some vertices only */
+  igraph_personalized_pagerank_batch(g, &res, igraph_vss_1(3), directed,
+				     0.85, resets, weights, 0);
+  if (igraph_matrix_nrow(&res) != 1 || igraph_matrix_ncol(&res) != k) {
+    ret=3;
+  }
+  if (!ret && k > 0) {
+    igraph_matrix_get_col(resets, &reset, k-1);
+    igraph_pagerank_power(g, &v, 0, igraph_vss_1(3), directed, 0.85,
+			  &reset, weights, 0, 0);
+    if (fabs(VECTOR(v)[0] - MATRIX(res, 0, k-1)) > 1e-9) { ret=4; }
+  }
+
+  igraph_vector_destroy(&v);
+  igraph_vector_destroy(&reset);
+  igraph_matrix_destroy(&res);
+  return ret;
+}
+
+int main() {
+
+  igraph_t g;
+  igraph_matrix_t resets, res;
+  igraph_vector_t weights;
+  long int i, j, n=100;
+  int ret;
+
+  igraph_rng_seed(igraph_rng_default(), 42);
+  igraph_erdos_renyi_game(&g, IGRAPH_ERDOS_RENYI_GNM, n, 300,
+			  IGRAPH_DIRECTED, IGRAPH_NO_LOOPS);
+
+  /* Seed sets of three vertices, more than one batch */
+  igraph_matrix_init(&resets, n, 40);
+  for (j=0; j<40; j++) {
+    for (i=0; i<3; i++) {
+      MATRIX(resets, igraph_rng_get_integer(igraph_rng_default(), 0, n-1), 
+	     j) += 1;
+    }
+  }
+  if ((ret=check(&g, IGRAPH_DIRECTED, &resets, 0))) { return ret; }
+  if ((ret=check(&g, IGRAPH_UNDIRECTED, &resets, 0))) { return 10+ret; }
+
+  igraph_vector_init(&weights, igraph_ecount(&g));
+  for (i=0; i<igraph_ecount(&g); i++) {
+    VECTOR(weights)[i]=igraph_rng_get_unif(igraph_rng_default(), 0, 2);
+  }
+  if ((ret=check(&g, IGRAPH_DIRECTED, &resets, &weights))) { return 20+ret; }
+
+  /* Single column, and no columns */
+  igraph_matrix_resize(&resets, n, 1);
+  if ((ret=check(&g, IGRAPH_DIRECTED, &resets, &weights))) { return 30+ret; }
+  igraph_matrix_resize(&resets, n, 0);
+  if ((ret=check(&g, IGRAPH_DIRECTED, &resets, &weights))) { return 40+ret; }
+
+  /* Errors */
+  igraph_set_error_handler(igraph_error_handler_ignore);
+  igraph_matrix_init(&res, 0, 0);
+  igraph_matrix_resize(&resets, n, 2);
+  igraph_matrix_null(&resets);
+  MATRIX(resets, 0, 0)=1;
+  if (igraph_personalized_pagerank_batch(&g, &res, igraph_vss_all(), 
+					 IGRAPH_DIRECTED, 0.85, &resets, 0, 
+					 0) != IGRAPH_EINVAL) {
+    return 51;
+  }
+  MATRIX(resets, 0, 1)=-1;
+  MATRIX(resets, 1, 1)=2;
+  if (igraph_personalized_pagerank_batch(&g, &res, igraph_vss_all(), 
+					 IGRAPH_DIRECTED, 0.85, &resets, 0, 
+					 0) != IGRAPH_EINVAL) {
+    return 52;
+  }
+  igraph_matrix_resize(&resets, n-1, 2);
+  if (igraph_personalized_pagerank_batch(&g, &res, igraph_vss_all(), 
+					 IGRAPH_DIRECTED, 0.85, &resets, 0, 
+					 0) != IGRAPH_EINVAL) {
+    return 53;
+  }
+  igraph_matrix_destroy(&res);
+
+  igraph_vector_destroy(&weights);
+  igraph_matrix_destroy(&resets);
+  igraph_destroy(&g);
+
+  return 0;
+}
@@ -0,0 +1,213 @@
+/* -*- mode: C -*-  */
+/*
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+#include <stdio.h>
+
+int print_graph(const igraph_t *g) {
+  long int i;
+  printf("%s, %li vertices, name: %s, weighted: %d\n",
+	 igraph_is_directed(g) ? "directed" : "undirected",
+	 (long int) igraph_vcount(g), GAS(g, "name"), (int) GAB(g, "weighted"));
+  for (i = 0; i < igraph_vcount(g); i++) {
+    printf("%s ", VAS(g, "label", i));
+  }
+  printf("\n");
+  for (i = 0; i < igraph_ecount(g); i++) {
+    igraph_integer_t from, to;
+    igraph_edge(g, i, &from, &to);
+    printf("%li-%li %g %d\n", (long int) from, (long int) to,
+	   EAN(g, "weight", i), (int) EAB(g, "heavy", i));
+  }
+  return 0;
+}
+
+/* Writes the graph and reads it back */
+int write_and_read(const igraph_t *g, igraph_t *g2) {
+  FILE *f = tmpfile();
+  int ret;
+  igraph_write_graph_binary(g, f);
+  rewind(f);
+  ret = igraph_read_graph_binary(g2, f);
+  fclose(f);
+  return ret;
+}
+
+int same_graph(const igraph_t *g1, const igraph_t *g2) {
+  igraph_vector_t e1, e2, n1, n2;
+  long int i;
+  int same;
+  igraph_vector_init(&e1, 0);
+  igraph_vector_init(&e2, 0);
+  igraph_vector_init(&n1, 0);
+  igraph_vector_init(&n2, 0);
+  igraph_get_edgelist(g1, &e1, 0);
+  igraph_get_edgelist(g2, &e2, 0);
+  same = igraph_is_directed(g1) == igraph_is_directed(g2) &&
+    igraph_vcount(g1) == igraph_vcount(g2) && igraph_vector_all_e(&e1, &e2);
+  /* The indices are the same, too */
+  for (i = 0; same && i < igraph_vcount(g1); i++) {
+    igraph_incident(g1, &n1, i, IGRAPH_ALL);
+    igraph_incident(g2, &n2, i, IGRAPH_ALL);
+    same = igraph_vector_all_e(&n1, &n2);
+  }
+  igraph_vector_destroy(&n2);
+  igraph_vector_destroy(&n1);
+  igraph_vector_destroy(&e2);
+  igraph_vector_destroy(&e1);
+  return same;
+}
+
+int main() {
+  igraph_t g, g2;
+  FILE *f;
+  char buf[1000];
+  size_t len;
+  long int i;
+
+  igraph_i_set_attribute_table(&igraph_cattribute_table);
+
+  /* A small graph with all kinds of attributes */
+  igraph_small(&g, 4, IGRAPH_UNDIRECTED, 0, 1, 1, 2, 2, 3, 3, 0, 0, 2, 2, 0, -1);
+  SETGAS(&g, "name", "diamond");
+  SETGAB(&g, "weighted", 1);
+  for (i = 0; i < igraph_vcount(&g); i++) {
+    char label[20];
+    sprintf(label, "v%li", i);
+    SETVAS(&g, "label", i, label);
+  }
+  SETVAS(&g, "label", 3, "");
+  for (i = 0; i < igraph_ecount(&g); i++) {
+    SETEAN(&g, "weight", i, i / 2.0);
+    SETEAB(&g, "heavy", i, i % 2);
+  }
+  write_and_read(&g, &g2);
+  if (!same_graph(&g, &g2)) {
+    return 1;
+  }
+  print_graph(&g2);
+  igraph_destroy(&g2);
+
+  /* Directed graph without attributes, and a null graph */
+  igraph_destroy(&g);
+  igraph_i_set_attribute_table(0);
+  igraph_rng_seed(igraph_rng_default(), 42);
+  igraph_erdos_renyi_game(&g, IGRAPH_ERDOS_RENYI_GNM, 1000, 5000,
+			  IGRAPH_DIRECTED, IGRAPH_LOOPS);
+  write_and_read(&g, &g2);
+  if (!same_graph(&g, &g2)) {
+    return 2;
+  }
+  igraph_destroy(&g2);
+  igraph_destroy(&g);
+  igraph_empty(&g, 0, IGRAPH_UNDIRECTED);
+  write_and_read(&g, &g2);
+  if (!same_graph(&g, &g2)) {
+    return 3;
+  }
+  igraph_destroy(&g2);
+
+  /* Invalid files: not a binary graph, truncated, corrupted */
+  igraph_set_error_handler(igraph_error_handler_ignore);
+  f = tmpfile();
+  fputs("0 1\n1 2\n", f);
+  rewind(f);
+  if (igraph_read_graph_binary(&g2, f) != IGRAPH_PARSEERROR) {
+    return 4;
+  }
+  fclose(f);
+
+  igraph_destroy(&g);
+  igraph_ring(&g, 10, IGRAPH_DIRECTED, 0, 1);
+  f = tmpfile();
+  igraph_write_graph_binary(&g, f);
+  len = (size_t) ftell(f);
+  rewind(f);
+  if (fread(buf, 1, len, f) != len) {
+    return 5;
+  }
+  fclose(f);
+
+  f = tmpfile();
+  fwrite(buf, 1, len - 1, f);
+  rewind(f);
+  if (igraph_read_graph_binary(&g2, f) != IGRAPH_PARSEERROR) {
+    return 6;
+  }
+  fclose(f);
+
+  /* Make the first edge point to vertex 3, instead of vertex 1 */
+  ((igraph_real_t*) (buf + 8))[8 + 10] = 3;
+  f = tmpfile();
+  fwrite(buf, 1, len, f);
+  rewind(f);
+  if (igraph_read_graph_binary(&g2, f) != IGRAPH_PARSEERROR) {
+    return 7;
+  }
+  fclose(f);
+  ((igraph_real_t*) (buf + 8))[8 + 10] = 1;
+
+  /* Make the out-index of vertex 0 end after the last edge */
+  ((igraph_real_t*) (buf + 8))[8 + 40 + 1] = 1000;
+  f = tmpfile();
+  fwrite(buf, 1, len, f);
+  rewind(f);
+  if (igraph_read_graph_binary(&g2, f) != IGRAPH_PARSEERROR) {
+    return 8;
+  }
+  fclose(f);
+  ((igraph_real_t*) (buf + 8))[8 + 40 + 1] = 1;
+
+  /* Number of vertices that is not an integer, or too large */
+  ((igraph_real_t*) (buf + 8))[3] = 10.5;
+  f = tmpfile();
+  fwrite(buf, 1, len, f);
+  rewind(f);
+  if (igraph_read_graph_binary(&g2, f) != IGRAPH_PARSEERROR) {
+    return 9;
+  }
+  fclose(f);
+  ((igraph_real_t*) (buf + 8))[3] = 1e300;
+  f = tmpfile();
+  fwrite(buf, 1, len, f);
+  rewind(f);
+  if (igraph_read_graph_binary(&g2, f) != IGRAPH_PARSEERROR) {
+    return 10;
+  }
+  fclose(f);
+  ((igraph_real_t*) (buf + 8))[3] = 10;
+
+  /* The restored file is valid again */
+  f = tmpfile();
+  fwrite(buf, 1, len, f);
+  rewind(f);
+  if (igraph_read_graph_binary(&g2, f) != 0 || !same_graph(&g, &g2)) {
+    return 11;
+  }
+  fclose(f);
+  igraph_destroy(&g2);
+
+  igraph_destroy(&g);
+
+  return 0;
+}
@@ -0,0 +1,101 @@
+/* -*- mode: C -*-  */
+/*
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+#include <stdio.h>
+
+int read_string(igraph_t *g, const char *str, igraph_bool_t directed) {
+  FILE *f = tmpfile();
+  int ret;
+  fputs(str, f);
+  rewind(f);
+  ret = igraph_read_graph_edgelist(g, f, 0, directed);
+  fclose(f);
+  return ret;
+}
+
+int print_and_destroy(igraph_t *g) {
+  printf("%li vertices:\n", (long int) igraph_vcount(g));
+  igraph_write_graph_edgelist(g, stdout);
+  igraph_destroy(g);
+  return 0;
+}
+
+int main() {
+  igraph_t g;
+  FILE *f;
+  igraph_vector_t edges;
+  long int i, n = 1500000;
+
+  /* Simple cases, whitespace, signs, octal and hexadecimal numbers */
+  read_string(&g, "0 1\n1 2\n2 0\n", IGRAPH_DIRECTED);
+  print_and_destroy(&g);
+  read_string(&g, "  \n\t0 1 1\r\n2\v\f\n  3 4", IGRAPH_UNDIRECTED);
+  print_and_destroy(&g);
+  read_string(&g, "+1 010 0x1a 00", IGRAPH_DIRECTED);
+  print_and_destroy(&g);
+  read_string(&g, "", IGRAPH_DIRECTED);
+  print_and_destroy(&g);
+  read_string(&g, " \n \n", IGRAPH_DIRECTED);
+  print_and_destroy(&g);
+
+  /* Errors */
+  igraph_set_error_handler(igraph_error_handler_ignore);
+  if (read_string(&g, "0 1 2", IGRAPH_DIRECTED) != IGRAPH_PARSEERROR) {
+    return 1;
+  }
+  if (read_string(&g, "0 1 2 x", IGRAPH_DIRECTED) != IGRAPH_PARSEERROR) {
+    return 2;
+  }
+  if (read_string(&g, "0 1 2 3.5", IGRAPH_DIRECTED) != IGRAPH_PARSEERROR) {
+    return 3;
+  }
+  if (read_string(&g, "0 1 2 -3", IGRAPH_DIRECTED) != IGRAPH_EINVVID) {
+    return 4;
+  }
+  igraph_set_error_handler(igraph_error_handler_abort);
+
+  /* A file that is larger than the blocks of the reader */
+  f = tmpfile();
+  for (i = 0; i < n; i++) {
+    fprintf(f, "%li %li\n", i, (i * 7919) % n);
+  }
+  rewind(f);
+  igraph_read_graph_edgelist(&g, f, 0, IGRAPH_DIRECTED);
+  fclose(f);
+  igraph_vector_init(&edges, 0);
+  igraph_get_edgelist(&g, &edges, 0);
+  if (igraph_vcount(&g) != n || igraph_ecount(&g) != n) {
+    return 5;
+  }
+  for (i = 0; i < n; i++) {
+    if (VECTOR(edges)[2 * i] != i ||
+	VECTOR(edges)[2 * i + 1] != (i * 7919) % n) {
+      return 6;
+    }
+  }
+  igraph_vector_destroy(&edges);
+  igraph_destroy(&g);
+
+  return 0;
+}
@@ -0,0 +1,180 @@
+/* -*- mode: C -*-  */
+/* 
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+   
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA 
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+#include <math.h>
+
+/* Print the rows */
+
+igraph_bool_t print_row(igraph_integer_t source, 
+			const igraph_vector_t *distances, void *arg) {
+  printf("%li:", (long int) source);
+  igraph_vector_print(distances);
+  return 1;
+}
+
+/* Collect the rows into a matrix, stop after 'limit' rows */
+
+typedef struct {
+  igraph_matrix_t *res;
+  long int row, limit;
+  int error;
+} collect_t;
+
+igraph_bool_t collect_row(igraph_integer_t source,
+			  const igraph_vector_t *distances, void *arg) {
+  collect_t *data=(collect_t*) arg;
+  long int j, n=igraph_vector_size(distances);
+  if (n != igraph_matrix_ncol(data->res)) { data->error=1; return 0; }
+  for (j=0; j<n; j++) {
+    MATRIX(*data->res, data->row, j) = VECTOR(*distances)[j];
+  }
+  data->row++;
+  return data->row < data->limit;
+}
+
+/* Compare the callback results to the matrix versions */
+
+int check(const igraph_t *g, igraph_vs_t from, igraph_vs_t to,
+	  const igraph_vector_t *weights, igraph_neimode_t mode, 
+	  igraph_bool_t johnson) {
+  igraph_matrix_t m1, m2;
+  collect_t data;
+  long int i, j;
+  int ret=0;
+
+  igraph_matrix_init(&m1, 0, 0);
+  if (johnson) {
+    igraph_shortest_paths_johnson(g, &m1, from, to, weights);
+  } else {
+    igraph_shortest_paths_dijkstra(g, &m1, from, to, weights, mode);
+  }
+  igraph_matrix_init(&m2, igraph_matrix_nrow(&m1), igraph_matrix_ncol(&m1));
+  data.res=&m2; data.row=0; data.limit=igraph_matrix_nrow(&m1); data.error=0;
+  igraph_shortest_paths_callback(g, from, to, weights, mode, 
+				 collect_row, &data);
+  if (data.error || data.row != igraph_matrix_nrow(&m1)) { ret=1; }
+  for (i=0; i<igraph_matrix_nrow(&m1) && !ret; i++) {
+    for (j=0; j<igraph_matrix_ncol(&m1); j++) {
+      igraph_real_t a=MATRIX(m1, i, j), b=MATRIX(m2, i, j);
+      if (a != b && fabs(a-b) > 1e-10 * (1+fabs(a))) { ret=2; break; }
+    }
+  }
+  igraph_matrix_destroy(&m2);
+  igraph_matrix_destroy(&m1);
+  return ret;
+}
+
+int main() {
+  igraph_t g;
+  igraph_vector_t weights, v, p;
+  igraph_matrix_t m;
+  collect_t data;
+  long int i;
+  int ret;
+
+  /* A small example, a ring with a chord */
+  igraph_ring(&g, 6, IGRAPH_DIRECTED, /*mutual=*/ 0, /*circular=*/ 1);
+  igraph_add_edge(&g, 0, 3);
+  igraph_shortest_paths_callback(&g, igraph_vss_all(), igraph_vss_all(),
+				 /*weights=*/ 0, IGRAPH_OUT, print_row, 0);
+  igraph_vector_init_int(&weights, 7, 1, 1, 1, 1, 1, 1, -2);
+  igraph_shortest_paths_callback(&g, igraph_vss_1(0), igraph_vss_all(),
+				 &weights, IGRAPH_OUT, print_row, 0);
+  igraph_shortest_paths_callback(&g, igraph_vss_1(4), igraph_vss_all(),
+				 &weights, IGRAPH_IN, print_row, 0);
+  igraph_vector_init_int(&v, 3, 3, 1, 3);
+  igraph_shortest_paths_callback(&g, igraph_vss_vector(&v), 
+				 igraph_vss_vector(&v),
+				 &weights, IGRAPH_OUT, print_row, 0);
+  
+  /* Negative weights with undirected paths */
+  igraph_set_error_handler(igraph_error_handler_ignore);
+  if (igraph_shortest_paths_callback(&g, igraph_vss_all(), igraph_vss_all(),
+				     &weights, IGRAPH_ALL, print_row, 0) !=
+      IGRAPH_EINVAL) {
+    return 1;
+  }
+  igraph_set_error_handler(igraph_error_handler_abort);
+  igraph_vector_destroy(&v);
+  igraph_vector_destroy(&weights);
+  igraph_destroy(&g);
+
+  /* Stopping early */
+  igraph_ring(&g, 10, IGRAPH_UNDIRECTED, 0, 1);
+  igraph_matrix_init(&m, 10, 10);
+  data.res=&m; data.row=0; data.limit=3; data.error=0;
+  igraph_shortest_paths_callback(&g, igraph_vss_all(), igraph_vss_all(),
+				 0, IGRAPH_ALL, collect_row, &data);
+  if (data.error || data.row != 3) { return 2; }
+  igraph_matrix_destroy(&m);
+  igraph_destroy(&g);
+
+  /* Random graphs, compared to the matrix versions */
+  igraph_rng_seed(igraph_rng_default(), 42);
+  igraph_erdos_renyi_game(&g, IGRAPH_ERDOS_RENYI_GNM, 300, 900, 
+			  IGRAPH_DIRECTED, IGRAPH_NO_LOOPS);
+  igraph_vector_init(&weights, igraph_ecount(&g));
+  for (i=0; i<igraph_ecount(&g); i++) {
+    VECTOR(weights)[i] = igraph_rng_get_integer(igraph_rng_default(), 1, 10);
+  }
+  igraph_vector_init_seq(&v, 100, 199);
+
+  if ((ret=check(&g, igraph_vss_all(), igraph_vss_all(), 0, IGRAPH_OUT, 0))) {
+    return 10+ret;
+  }
+  if ((ret=check(&g, igraph_vss_vector(&v), igraph_vss_all(), 0, 
+		 IGRAPH_ALL, 0))) {
+    return 20+ret;
+  }
+  if ((ret=check(&g, igraph_vss_all(), igraph_vss_vector(&v), &weights, 
+		 IGRAPH_OUT, 0))) {
+    return 30+ret;
+  }
+  if ((ret=check(&g, igraph_vss_vector(&v), igraph_vss_all(), &weights, 
+		 IGRAPH_IN, 0))) {
+    return 40+ret;
+  }
+
+  /* Negative weights, but no negative cycles: add p(to)-p(from) to
+     the weight of each edge, this does not change the cycle lengths */
+  igraph_vector_init(&p, igraph_vcount(&g));
+  for (i=0; i<igraph_vcount(&g); i++) {
+    VECTOR(p)[i] = igraph_rng_get_integer(igraph_rng_default(), 0, 20);
+  }
+  for (i=0; i<igraph_ecount(&g); i++) {
+    VECTOR(weights)[i] += VECTOR(p)[ (long int) IGRAPH_TO(&g, i) ] - 
+      VECTOR(p)[ (long int) IGRAPH_FROM(&g, i) ];
+  }
+  igraph_vector_destroy(&p);
+  if ((ret=check(&g, igraph_vss_all(), igraph_vss_vector(&v), &weights, 
+		 IGRAPH_OUT, 1))) {
+    return 50+ret;
+  }
+
+  igraph_vector_destroy(&v);
+  igraph_vector_destroy(&weights);
+  igraph_destroy(&g);
+
+  return 0;
+}
@@ -31,6 +31,7 @@ int main() {
   long int id;
   int i;
   char *str;
+  const igraph_strvector_t *keys;
 
   /* init */
   igraph_trie_init(&trie, 0);
@@ -92,6 +93,28 @@ int main() {
   }
   igraph_trie_destroy(&trie);
 
+  /* many keys, keys that are not zero terminated, and all keys */
+  igraph_trie_init(&trie, 1);
+  for (i=0; i<10000; i++) {
+    char key[20];
+    sprintf(key, "key%d", i);
+    igraph_trie_get(&trie, key, &id);
+    if (id != i) return 2;
+  }
+  igraph_trie_get2(&trie, "key1234567", 7, &id);  printf("key1234: %li\n", id);
+  igraph_trie_get2(&trie, "key12x", 5, &id);      printf("key12x:  %li\n", id);
+  igraph_trie_check(&trie, "key12x", &id);        printf("key12x:  %li\n", id);
+  igraph_trie_get(&trie, "", &id);                printf("(empty): %li\n", id);
+  igraph_trie_get2(&trie, "", 0, &id);            printf("(empty): %li\n", id);
+  igraph_trie_getkeys(&trie, &keys);
+  printf("size: %li, keys: %li\n", igraph_trie_size(&trie), 
+	 igraph_strvector_size(keys));
+  for (i=9998; i<igraph_strvector_size(keys); i++) {
+    igraph_strvector_get(keys, i, &str);
+    printf("%d: %s\n", i, str);
+  }
+  igraph_trie_destroy(&trie);
+
   if (!IGRAPH_FINALLY_STACK_EMPTY) return 1;
   
   return 0;
@@ -0,0 +1,109 @@
+/* -*- mode: C -*-  */
+/*
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301 USA
+
+*/
+
+#include <igraph.h>
+#include <stdio.h>
+
+/* Writes the same graph in all text formats. The numbers include
+   negative zero, integers around 1e15, where the writers stop
+   formatting them as integers, and non-finite values. The LGL writer
+   only supports string weights. */
+
+int write_all(const igraph_t *g) {
+  printf("--- edgelist\n");
+  if (igraph_write_graph_edgelist(g, stdout)) { return 1; }
+  printf("--- ncol\n");
+  if (igraph_write_graph_ncol(g, stdout, "name", "weight")) { return 2; }
+  printf("--- lgl\n");
+  if (igraph_write_graph_lgl(g, stdout, "name", "sweight", 1)) { return 3; }
+  printf("--- pajek\n");
+  if (igraph_write_graph_pajek(g, stdout)) { return 4; }
+  printf("--- gml\n");
+  if (igraph_write_graph_gml(g, stdout, 0, "formats")) { return 5; }
+  printf("--- dot\n");
+  if (igraph_write_graph_dot(g, stdout)) { return 6; }
+  printf("--- graphml\n");
+  if (igraph_write_graph_graphml(g, stdout, 0)) { return 7; }
+  fflush(stdout);
+  return 0;
+}
+
+int main() {
+  igraph_t g;
+  igraph_real_t edges[] = { 0,1, 2,1, 1,3, 3,0, 4,2, 2,4, 5,5, 1,0, 5,3 };
+  igraph_vector_t v;
+  igraph_real_t inf=IGRAPH_INFINITY;
+  igraph_real_t values[] = { 0, -0.0, 1, -2, 0.5, 1.0/3, -1e15+1, 1e15-1,
+			     1e15, -1e15, 9007199254740994.0, 1e20,
+			     inf, -inf, inf-inf };
+  const char *strings[] = { "plain", "with space", "q\"uote", "a&b<c>",
+			    "back\\slash", "" };
+  long int nvalues=sizeof(values)/sizeof(values[0]);
+  long int nstrings=sizeof(strings)/sizeof(strings[0]);
+  long int i;
+  int directed, ret;
+  char name[20];
+
+  igraph_i_set_attribute_table(&igraph_cattribute_table);
+  /* GML and DOT warn about writing the booleans as numbers */
+  igraph_set_warning_handler(igraph_warning_handler_ignore);
+
+  for (directed=0; directed<2; directed++) {
+    igraph_vector_view(&v, edges, sizeof(edges)/sizeof(edges[0]));
+    igraph_create(&g, &v, 0, directed);
+
+    SETGAN(&g, "gnum", -0.0);
+    SETGAN(&g, "gbig", 1e15);
+    SETGAS(&g, "gstr", "graph \"attribute\"");
+    SETGAB(&g, "gbool", 1);
+
+    for (i=0; i<igraph_vcount(&g); i++) {
+      sprintf(name, "v%li", i);
+      SETVAS(&g, "name", i, name);
+      SETVAN(&g, "x", i, values[i % nvalues]);
+      SETVAN(&g, "y", i, values[(i+6) % nvalues]);
+      SETVAN(&g, "size", i, values[(i+10) % nvalues]);
+      SETVAS(&g, "color", i, strings[i % nstrings]);
+      SETVAB(&g, "flag", i, i % 2);
+    }
+
+    for (i=0; i<igraph_ecount(&g); i++) {
+      SETEAN(&g, "weight", i, values[(i+5) % nvalues]);
+      sprintf(name, "%li.5", i);
+      SETEAS(&g, "sweight", i, name);
+      SETEAN(&g, "num", i, values[(i*2) % nvalues]);
+      SETEAS(&g, "label", i, strings[(i+1) % nstrings]);
+      SETEAB(&g, "ok", i, i % 3 == 0);
+    }
+
+    printf("=== %s\n", directed ? "directed" : "undirected");
+    ret=write_all(&g);
+    if (ret) {
+      return ret + 10*directed;
+    }
+
+    igraph_destroy(&g);
+  }
+
+  return 0;
+}
@@ -41,6 +41,22 @@ int main() {
     return 3;
   }
 
+  /* igraph_vector_reserve and igraph_vector_resize never shrink the
+     allocated storage */
+  igraph_vector_reserve(&v, 3000);
+  igraph_vector_reserve(&v, 2000);
+  if (igraph_vector_capacity(&v) != 3000) {
+    return 4;
+  }
+  igraph_vector_resize(&v, 1500);
+  if (igraph_vector_capacity(&v) != 3000 || igraph_vector_size(&v) != 1500) {
+    return 5;
+  }
+  igraph_vector_resize(&v, 2500);
+  if (igraph_vector_capacity(&v) != 3000 || igraph_vector_size(&v) != 2500) {
+    return 6;
+  }
+
   igraph_vector_destroy(&v);
   return 0;
 }
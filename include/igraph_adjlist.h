@@ -179,6 +179,87 @@ DECLDIR void igraph_lazy_inclist_clear(igraph_lazy_inclist_t *il);
 DECLDIR igraph_vector_t *igraph_lazy_inclist_get_real(igraph_lazy_inclist_t *al,
                             igraph_integer_t no);
 
+/**
+ * \struct igraph_csr_t
+ * \brief Read-only CSR snapshot of a graph
+ *
+ * The neighbors and incident edges of all vertices, in contiguous
+ * arrays, see \ref igraph_csr_init(). The snapshot stores vertex and
+ * edge ids as 32 bit integers, so it can only be created for graphs
+ * with less than 2^31 vertices and 2^31 neighbor slots; every
+ * undirected edge and every edge in an \c IGRAPH_ALL snapshot uses
+ * two slots.
+ *
+ * \member length The number of vertices.
+ * \member ecount The number of edges of the graph.
+ * \member directed Whether the graph is directed.
+ * \member mode The type of the neighbors in the snapshot.
+ * \member start The first neighbor slot of every vertex, and the
+ *        total number of slots at the end.
+ * \member nei The neighbors, for every slot.
+ * \member eid The edge ids, for every slot.
+ */
+
+typedef struct igraph_csr_t {
+  igraph_integer_t length;
+  igraph_integer_t ecount;
+  igraph_bool_t directed;
+  igraph_neimode_t mode;
+  igraph_vector_long_t start;
+  igraph_vector_int_t nei;
+  igraph_vector_int_t eid;
+} igraph_csr_t;
+
+DECLDIR int igraph_csr_init(const igraph_t *graph, igraph_csr_t *csr,
+                igraph_neimode_t mode);
+DECLDIR void igraph_csr_destroy(igraph_csr_t *csr);
+
+/**
+ * \define igraph_csr_degree
+ * The number of neighbors of a vertex in a CSR snapshot
+ *
+ * \param csr Pointer to the CSR snapshot.
+ * \param no The vertex id.
+ * \return The length of the neighbor list of the vertex, multiple
+ *   edges are counted multiple times, and loop edges twice, if the
+ *   snapshot ignores edge directions.
+ *
+ * Time complexity: O(1).
+ */
+#define igraph_csr_degree(csr,no) \
+  (VECTOR((csr)->start)[(long int)(no)+1] - VECTOR((csr)->start)[(long int)(no)])
+
+/**
+ * \define igraph_csr_neighbors
+ * Neighbors of a vertex in a CSR snapshot
+ *
+ * \param csr Pointer to the CSR snapshot.
+ * \param no The vertex id.
+ * \return Pointer to the first element of the (sorted) neighbor list
+ *   of the vertex, an <type>int</type> array of length \ref
+ *   igraph_csr_degree(). It must not be modified.
+ *
+ * Time complexity: O(1).
+ */
+#define igraph_csr_neighbors(csr,no) \
+  (VECTOR((csr)->nei) + VECTOR((csr)->start)[(long int)(no)])
+
+/**
+ * \define igraph_csr_incident
+ * Incident edges of a vertex in a CSR snapshot
+ *
+ * \param csr Pointer to the CSR snapshot.
+ * \param no The vertex id.
+ * \return Pointer to the first element of the list of incident
+ *   edge ids, an <type>int</type> array of length \ref
+ *   igraph_csr_degree(). The i-th edge leads to the i-th vertex of
+ *   \ref igraph_csr_neighbors(). It must not be modified.
+ *
+ * Time complexity: O(1).
+ */
+#define igraph_csr_incident(csr,no) \
+  (VECTOR((csr)->eid) + VECTOR((csr)->start)[(long int)(no)])
+
 /************************************************************************* 
  * DEPRECATED TYPES AND FUNCTIONS
  */
@@ -29,6 +29,7 @@
 #include "igraph_types.h"
 #include "igraph_datatype.h"
 #include "igraph_iterators.h"
+#include "igraph_adjlist.h"
 #include "igraph_arpack.h"
 
 __BEGIN_DECLS
@@ -54,6 +55,11 @@ DECLDIR int igraph_betweenness_estimate(const igraph_t *graph, igraph_vector_t *
                 igraph_real_t cutoff, 
                 const igraph_vector_t *weights, 
                 igraph_bool_t nobigint);
+DECLDIR int igraph_betweenness_approx(const igraph_t *graph, igraph_vector_t *res,
+                const igraph_vs_t vids, igraph_bool_t directed,
+                const igraph_vector_t *weights,
+                igraph_real_t epsilon, igraph_real_t delta,
+                igraph_integer_t *samples);
 DECLDIR int igraph_edge_betweenness(const igraph_t *graph, igraph_vector_t *result,
                 igraph_bool_t directed, 
                 const igraph_vector_t *weigths);
@@ -71,7 +77,12 @@ DECLDIR int igraph_pagerank_old(const igraph_t *graph, igraph_vector_t *res,
  *
  * Algorithms to calculate PageRank.
  * \enumval IGRAPH_PAGERANK_ALGO_POWER Use a simple power iteration,
- *   as it was implemented before igraph version 0.5.
+ *   in parallel, see \ref igraph_pagerank_power(). Before igraph
+ *   0.8 this value selected the power iteration that is now \ref
+ *   igraph_pagerank_old(), and the results are different: the edge
+ *   weights and the reset vector are used now, the walkers of the
+ *   dangling vertices restart uniformly, and the iteration stops
+ *   when no score changes by more than the \c eps option.
  * \enumval IGRAPH_PAGERANK_ALGO_ARPACK Use the ARPACK library, this
  *   was the PageRank implementation in igraph from version 0.5, until
  *   version 0.7.
@@ -105,6 +116,71 @@ DECLDIR int igraph_pagerank(const igraph_t *graph, igraph_pagerank_algo_t algo,
                 igraph_real_t *value, const igraph_vs_t vids,
                 igraph_bool_t directed, igraph_real_t damping, 
                 const igraph_vector_t *weights, void *options);
+DECLDIR int igraph_pagerank_csr(const igraph_csr_t *csr, igraph_vector_t *vector,
+                igraph_real_t *value, igraph_real_t damping,
+                const igraph_vector_t *weights);
+DECLDIR int igraph_pagerank_power(const igraph_t *graph, 
+                igraph_vector_t *vector,
+                igraph_real_t *value, const igraph_vs_t vids,
+                igraph_bool_t directed, igraph_real_t damping,
+                const igraph_vector_t *reset,
+                const igraph_vector_t *weights,
+                const igraph_pagerank_power_options_t *options,
+                const igraph_vector_t *start);
+
+/**
+ * \struct igraph_pagerank_state_t
+ * \brief PageRank scores that can be updated after edge changes
+ *
+ * It is created by \ref igraph_pagerank_state_init(), and it is
+ * updated by \ref igraph_pagerank_state_update(), the scores can be
+ * queried by \ref igraph_pagerank_state_get(). The members should
+ * not be modified directly.
+ *
+ * \member directed Whether the directedness of the edges is
+ *        considered.
+ * \member weighted Whether the edges are weighted.
+ * \member damping The damping factor.
+ * \member eps The precision of the scores.
+ * \member reset The normalized reset vector, or an empty vector for
+ *        the original PageRank measure.
+ * \member weights The edge weights, if the edges are weighted.
+ * \member rank The scores of the vertices, they are not normalized.
+ * \member residual The residual of the PageRank equation, without
+ *        its uniform part.
+ * \member uniform The uniform part of the residual.
+ * \member pushes The number of local update steps in the last
+ *        update, this shows the amount of work it needed.
+ */
+
+typedef struct igraph_pagerank_state_t {
+  igraph_bool_t directed;
+  igraph_bool_t weighted;
+  igraph_real_t damping;
+  igraph_real_t eps;
+  igraph_vector_t reset;
+  igraph_vector_t weights;
+  igraph_vector_t rank;
+  igraph_vector_t residual;
+  igraph_real_t uniform;
+  igraph_integer_t pushes;
+} igraph_pagerank_state_t;
+
+DECLDIR int igraph_pagerank_state_init(const igraph_t *graph,
+                igraph_pagerank_state_t *state,
+                igraph_bool_t directed, igraph_real_t damping,
+                const igraph_vector_t *reset,
+                const igraph_vector_t *weights,
+                igraph_real_t eps);
+DECLDIR void igraph_pagerank_state_destroy(igraph_pagerank_state_t *state);
+DECLDIR int igraph_pagerank_state_update(igraph_t *graph,
+                igraph_pagerank_state_t *state,
+                const igraph_vector_t *add,
+                const igraph_vector_t *add_weights,
+                const igraph_es_t remove);
+DECLDIR int igraph_pagerank_state_get(const igraph_t *graph,
+                const igraph_pagerank_state_t *state,
+                igraph_vector_t *vector, const igraph_vs_t vids);
 DECLDIR int igraph_personalized_pagerank(const igraph_t *graph, 
                 igraph_pagerank_algo_t algo, igraph_vector_t *vector,
                 igraph_real_t *value, const igraph_vs_t vids,
@@ -118,6 +194,12 @@ DECLDIR int igraph_personalized_pagerank_vs(const igraph_t *graph,
                 igraph_bool_t directed, igraph_real_t damping,
                 igraph_vs_t reset_vids,
                 const igraph_vector_t *weights, void *options);
+DECLDIR int igraph_personalized_pagerank_batch(const igraph_t *graph,
+                igraph_matrix_t *res, const igraph_vs_t vids,
+                igraph_bool_t directed, igraph_real_t damping,
+                const igraph_matrix_t *resets,
+                const igraph_vector_t *weights,
+                const igraph_pagerank_power_options_t *options);
 
 DECLDIR int igraph_eigenvector_centrality(const igraph_t *graph, igraph_vector_t *vector,
                 igraph_real_t *value,
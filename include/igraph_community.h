@@ -73,6 +73,20 @@ DECLDIR int igraph_community_spinglass(const igraph_t *graph,
 /* 			          igraph_real_t *polarization, */
                 igraph_real_t lambda);
 
+DECLDIR int igraph_community_spinglass_replicas(const igraph_t *graph,
+                const igraph_vector_t *weights,
+                igraph_real_t *modularity,
+                igraph_real_t *temperature,
+                igraph_vector_t *membership, 
+                igraph_vector_t *csize, 
+                igraph_integer_t spins,
+                igraph_real_t starttemp,
+                igraph_real_t stoptemp,
+                igraph_spincomm_update_t update_rule,
+                igraph_real_t gamma,
+                igraph_integer_t replicas,
+                igraph_integer_t rounds);
+
 DECLDIR int igraph_community_spinglass_single(const igraph_t *graph,
                 const igraph_vector_t *weights,
                 igraph_integer_t vertex,
@@ -92,12 +106,28 @@ DECLDIR int igraph_community_walktrap(const igraph_t *graph,
                 igraph_vector_t *modularity, 
                 igraph_vector_t *membership);
 
+DECLDIR int igraph_community_walktrap_bounded(const igraph_t *graph, 
+                const igraph_vector_t *weights,
+                int steps,
+                igraph_matrix_t *merges,
+                igraph_vector_t *modularity, 
+                igraph_vector_t *membership,
+                igraph_real_t max_memory,
+                igraph_integer_t *computations,
+                igraph_integer_t *recomputations);
+
 DECLDIR int igraph_community_infomap(const igraph_t * graph,
                 const igraph_vector_t *e_weights,
                 const igraph_vector_t *v_weights,
                 int nb_trials,
                 igraph_vector_t *membership,
                 igraph_real_t *codelength);
+DECLDIR int igraph_community_infomap_parallel(const igraph_t * graph,
+                const igraph_vector_t *e_weights,
+                const igraph_vector_t *v_weights,
+                int nb_trials,
+                igraph_vector_t *membership,
+                igraph_real_t *codelength);
 
 DECLDIR int igraph_community_edge_betweenness(const igraph_t *graph, 
                 igraph_vector_t *result,
@@ -208,11 +238,28 @@ DECLDIR int igraph_community_label_propagation(const igraph_t *graph,
                 const igraph_vector_t *initial,
                 igraph_vector_bool_t *fixed,
                 igraph_real_t *modularity);
+DECLDIR int igraph_community_label_propagation_parallel(const igraph_t *graph,
+                igraph_vector_t *membership,
+                const igraph_vector_t *weights,
+                const igraph_vector_t *initial,
+                igraph_vector_bool_t *fixed,
+                igraph_real_t *modularity,
+                igraph_vector_t *changes);
 DECLDIR int igraph_community_multilevel(const igraph_t *graph,
                 const igraph_vector_t *weights,
                 igraph_vector_t *membership,
                 igraph_matrix_t *memberships,
                 igraph_vector_t *modularity);
+DECLDIR int igraph_community_multilevel_parallel(const igraph_t *graph,
+                const igraph_vector_t *weights,
+                igraph_vector_t *membership,
+                igraph_matrix_t *memberships,
+                igraph_vector_t *modularity);
+DECLDIR int igraph_community_leiden(const igraph_t *graph,
+                const igraph_vector_t *weights,
+                igraph_vector_t *membership,
+                igraph_integer_t n_iterations,
+                igraph_real_t *modularity);
 
 /* -------------------------------------------------- */
 /* Community Structure Comparison                     */
@@ -226,6 +273,9 @@ DECLDIR int igraph_split_join_distance(const igraph_vector_t *comm1,
                 const igraph_vector_t *comm2,
                 igraph_integer_t* distance12,
                 igraph_integer_t* distance21);
+DECLDIR int igraph_compare_communities_matrix(const igraph_vector_ptr_t *comms,
+                igraph_matrix_t *res,
+                igraph_community_comparison_t method);
 
 __END_DECLS
 
@@ -31,6 +31,7 @@
 #include "igraph_vector_ptr.h"
 #include "igraph_matrix.h"
 #include "igraph_iterators.h"
+#include "igraph_adjlist.h"
 
 __BEGIN_DECLS
 
@@ -50,6 +51,8 @@ DECLDIR int igraph_diameter_dijkstra(const igraph_t *graph,
 DECLDIR int igraph_shortest_paths(const igraph_t *graph, igraph_matrix_t *res, 
                 const igraph_vs_t from, const igraph_vs_t to, 
                 igraph_neimode_t mode);
+DECLDIR int igraph_shortest_paths_csr(const igraph_csr_t *csr, 
+                igraph_matrix_t *res, const igraph_vector_int_t *from);
 DECLDIR int igraph_get_shortest_paths(const igraph_t *graph, 
                 igraph_vector_ptr_t *vertices,
                 igraph_vector_ptr_t *edges,
@@ -109,6 +112,34 @@ DECLDIR int igraph_shortest_paths_johnson(const igraph_t *graph,
 				        const igraph_vs_t to,
 				        const igraph_vector_t *weights);
 
+/**
+ * \typedef igraph_shortest_paths_handler_t
+ * \brief Type of callback functions for shortest path lengths
+ *
+ * Callback type, called by \ref igraph_shortest_paths_callback() for
+ * each source vertex.
+ *
+ * \param source The id of the source vertex.
+ * \param distances The shortest path lengths from \p source to the
+ *   target vertices, in the order of the targets. Unreachable
+ *   vertices have distance \c IGRAPH_INFINITY. The vector is only
+ *   valid during the call and it must not be modified.
+ * \param arg This extra argument was passed to \ref
+ *   igraph_shortest_paths_callback() when it was called.
+ * \return Boolean, whether to continue with the next source vertex.
+ */
+typedef igraph_bool_t igraph_shortest_paths_handler_t(igraph_integer_t source,
+				        const igraph_vector_t *distances,
+				        void *arg);
+
+DECLDIR int igraph_shortest_paths_callback(const igraph_t *graph,
+				        const igraph_vs_t from,
+				        const igraph_vs_t to,
+				        const igraph_vector_t *weights,
+				        igraph_neimode_t mode,
+				        igraph_shortest_paths_handler_t *callback,
+				        void *arg);
+
 DECLDIR int igraph_average_path_length(const igraph_t *graph, igraph_real_t *res,
                 igraph_bool_t directed, igraph_bool_t unconn);
 DECLDIR int igraph_path_length_hist(const igraph_t *graph, igraph_vector_t *res,
@@ -28,6 +28,7 @@
 #include "igraph_datatype.h"
 #include "igraph_constants.h"
 #include "igraph_iterators.h"
+#include "igraph_adjlist.h"
 
 __BEGIN_DECLS
 
@@ -38,6 +39,9 @@ DECLDIR int igraph_transitivity_local_undirected(const igraph_t *graph,
 					 igraph_vector_t *res,
 					 const igraph_vs_t vids,
 					 igraph_transitivity_mode_t mode);
+DECLDIR int igraph_transitivity_local_undirected_csr(const igraph_csr_t *csr,
+					     igraph_vector_t *res,
+					     igraph_transitivity_mode_t mode);
 DECLDIR int igraph_transitivity_local_undirected1(const igraph_t *graph, 
 					  igraph_vector_t *res,
 					  const igraph_vs_t vids,
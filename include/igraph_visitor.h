@@ -28,6 +28,7 @@
 #include "igraph_constants.h"
 #include "igraph_types.h"
 #include "igraph_datatype.h"
+#include "igraph_adjlist.h"
 
 __BEGIN_DECLS
 
@@ -89,6 +90,27 @@ int igraph_i_bfs(igraph_t *graph, igraph_integer_t vid, igraph_neimode_t mode,
 		 igraph_vector_t *vids, igraph_vector_t *layers,
 		 igraph_vector_t *parents);
 
+int igraph_bfs_csr(const igraph_csr_t *csr, igraph_integer_t root,
+		   igraph_vector_int_t *order, igraph_vector_int_t *father,
+		   igraph_vector_int_t *dist);
+
+/**
+ * \typedef igraph_bfs_engine_t
+ * The breadth-first search used for unweighted distances
+ *
+ * See \ref igraph_set_bfs_engine() for details.
+ * \enumval IGRAPH_BFS_TOPDOWN The classic, queue based breadth-first
+ *   search, this is the default.
+ * \enumval IGRAPH_BFS_DIRECTION_OPTIMIZING Direction-optimizing
+ *   breadth-first search, that switches to bottom-up steps for large
+ *   frontiers.
+ */
+
+typedef enum { IGRAPH_BFS_TOPDOWN=0, 
+	       IGRAPH_BFS_DIRECTION_OPTIMIZING } igraph_bfs_engine_t;
+
+igraph_bfs_engine_t igraph_set_bfs_engine(igraph_bfs_engine_t engine);
+
 /**
  * \function igraph_dfshandler_t
  * Callback type for the DFS function
@@ -48,6 +48,49 @@
 #include <cstring>
 #include "NetDataTypes.h"
 
+//#################################################################################
+//###############################################################################
+//Constructor, copies the links of every node of the network
+NetArrays::NetArrays(network *net)
+{
+  DLList_Iter<NNode*> iter;
+  DLList_Iter<NLink*> l_iter;
+  NNode *n_cur;
+  NLink *l_cur;
+  unsigned long i=0, k=0;
+
+  num_nodes=net->node_list->Size();
+  start=new unsigned long[num_nodes+1];
+  neighbour=new unsigned long[2*net->link_list->Size()+1];
+  weight=new double[2*net->link_list->Size()+1];
+  n_cur=iter.First(net->node_list);
+  while (!iter.End())
+  {
+    start[i++]=k;
+    l_cur=l_iter.First(n_cur->Get_Links());
+    while (!l_iter.End())
+    {
+      if (n_cur==l_cur->Get_Start()) {
+        neighbour[k]=l_cur->Get_End()->Get_Index();
+      } else {
+        neighbour[k]=l_cur->Get_Start()->Get_Index();
+      }
+      weight[k++]=l_cur->Get_Weight();
+      l_cur=l_iter.Next();
+    }
+    n_cur=iter.Next();
+  }
+  start[i]=k;
+}
+
+//Destructor
+NetArrays::~NetArrays()
+{
+  delete [] start;
+  delete [] neighbour;
+  delete [] weight;
+}
+
 //#################################################################################
 //###############################################################################
 //Constructor
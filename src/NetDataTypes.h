@@ -341,6 +341,24 @@ struct network
   unsigned long sum_bids;
 } ;
 
+//#####################################################################################################
+// Array-backed copy of the links of a network, for the inner loops of
+// the Monte Carlo sweeps, which would otherwise chase the pointers of
+// the NNode/NLink lists. The links of node i are at positions
+// start[i] .. start[i+1]-1 of 'neighbour' and 'weight', in the order
+// of the link list of the node. The network must not change while
+// the copy is in use.
+class NetArrays
+{
+  public:
+    unsigned long num_nodes;
+    unsigned long *start;
+    unsigned long *neighbour;
+    double *weight;
+    NetArrays(network *net);
+    ~NetArrays();
+};
+
 /*
 struct network
 {
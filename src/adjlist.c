@@ -28,6 +28,7 @@
 #include "config.h"
 
 #include <string.h>   /* memset */
+#include <limits.h>   /* INT_MAX */
 #include <stdio.h>
 
 /**
@@ -66,6 +67,16 @@
  * during the computation.
  * </para>
  *
+ * <para>CSR (compressed sparse row) snapshots are read-only adjacency
+ * lists, stored in a compact form: the neighbors and incident edges of
+ * all vertices are stored in two contiguous integer arrays, and a
+ * third array gives the start of the list of each vertex. They use
+ * considerably less memory than the graph itself, and iterating over
+ * them is faster, so they are a good choice for the repeated
+ * traversals of large graphs. See e.g. \ref igraph_bfs_csr(), \ref
+ * igraph_shortest_paths_csr(), \ref igraph_pagerank_csr() and \ref
+ * igraph_transitivity_local_undirected_csr().</para>
+ *
  * <para>
  * \example examples/simple/adjlist.c
  * </para>
@@ -910,3 +921,121 @@ igraph_vector_t *igraph_lazy_inclist_get_real(igraph_lazy_inclist_t *il,
   }
   return il->incs[no];
 }
+
+/**
+ * \function igraph_csr_init
+ * Create a read-only CSR snapshot of a graph
+ *
+ * The snapshot stores the neighbors and incident edges of all
+ * vertices in contiguous arrays of 32 bit integers, in the same order
+ * as \ref igraph_neighbors() returns them, i.e. sorted by vertex
+ * id. It is independent of the graph after creation. Because of the
+ * 32 bit ids, graphs with 2^31 or more vertices or neighbor slots
+ * are rejected, see \ref igraph_csr_t.
+ * \param graph The input graph.
+ * \param csr Pointer to an uninitialized <type>igraph_csr_t</type> object.
+ * \param mode Constant specifying whether outgoing
+ *   (<code>IGRAPH_OUT</code>), incoming (<code>IGRAPH_IN</code>),
+ *   or both (<code>IGRAPH_ALL</code>) types of neighbors to include
+ *   in the snapshot. It is ignored for undirected networks.
+ * \return Error code.
+ *
+ * Time complexity: O(|V|+|E|), linear in the number of vertices and
+ * edges.
+ */
+
+int igraph_csr_init(const igraph_t *graph, igraph_csr_t *csr,
+		    igraph_neimode_t mode) {
+
+  long int no_of_nodes=igraph_vcount(graph);
+  long int no_of_edges=igraph_ecount(graph);
+  long int i, ptr=0, length;
+  igraph_vector_t out, in;
+
+  if (mode != IGRAPH_OUT && mode != IGRAPH_IN && mode != IGRAPH_ALL) {
+    IGRAPH_ERROR("Cannot create CSR snapshot", IGRAPH_EINVMODE);
+  }
+  if (!igraph_is_directed(graph)) { mode=IGRAPH_ALL; }
+
+  length = mode == IGRAPH_ALL ? 2*no_of_edges : no_of_edges;
+  if (no_of_nodes > INT_MAX || no_of_edges > INT_MAX || length > INT_MAX) {
+    IGRAPH_ERROR("Graph too large for a CSR snapshot", IGRAPH_EOVERFLOW);
+  }
+
+  csr->length=(igraph_integer_t) no_of_nodes;
+  csr->ecount=(igraph_integer_t) no_of_edges;
+  csr->directed=igraph_is_directed(graph);
+  csr->mode=mode;
+  IGRAPH_CHECK(igraph_vector_long_init(&csr->start, no_of_nodes+1));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &csr->start);
+  IGRAPH_CHECK(igraph_vector_int_init(&csr->nei, length));
+  IGRAPH_FINALLY(igraph_vector_int_destroy, &csr->nei);
+  IGRAPH_CHECK(igraph_vector_int_init(&csr->eid, length));
+  IGRAPH_FINALLY(igraph_vector_int_destroy, &csr->eid);
+  IGRAPH_VECTOR_INIT_FINALLY(&out, 0);
+  IGRAPH_VECTOR_INIT_FINALLY(&in, 0);
+
+  for (i=0; i<no_of_nodes; i++) {
+    long int o=0, n=0, no, ni;
+    VECTOR(csr->start)[i]=ptr;
+    IGRAPH_ALLOW_INTERRUPTION();
+    if (!csr->directed) {
+      /* The incident edges are already sorted by the other endpoint */
+      IGRAPH_CHECK(igraph_incident(graph, &out, (igraph_integer_t) i, 
+				   IGRAPH_ALL));
+      no=igraph_vector_size(&out);
+      for (o=0; o<no; o++) {
+	long int e=(long int) VECTOR(out)[o];
+	VECTOR(csr->nei)[ptr]=IGRAPH_OTHER(graph, e, i);
+	VECTOR(csr->eid)[ptr++]=(int) e;
+      }
+      continue;
+    }
+    if (mode & IGRAPH_OUT) {
+      IGRAPH_CHECK(igraph_incident(graph, &out, (igraph_integer_t) i, 
+				   IGRAPH_OUT));
+    }
+    if (mode & IGRAPH_IN) {
+      IGRAPH_CHECK(igraph_incident(graph, &in, (igraph_integer_t) i, 
+				   IGRAPH_IN));
+    }
+    no=igraph_vector_size(&out); ni=igraph_vector_size(&in);
+    /* Both lists are sorted by the other endpoint, merge them */
+    while (o < no || n < ni) {
+      long int e1= o < no ? (long int) VECTOR(out)[o] : -1;
+      long int e2= n < ni ? (long int) VECTOR(in)[n] : -1;
+      long int v1= e1 >= 0 ? IGRAPH_TO(graph, e1) : -1;
+      long int v2= e2 >= 0 ? IGRAPH_FROM(graph, e2) : -1;
+      if (e2 < 0 || (e1 >= 0 && v1 <= v2)) {
+	VECTOR(csr->nei)[ptr]=(int) v1;
+	VECTOR(csr->eid)[ptr++]=(int) e1;
+	o++;
+      } else {
+	VECTOR(csr->nei)[ptr]=(int) v2;
+	VECTOR(csr->eid)[ptr++]=(int) e2;
+	n++;
+      }
+    }
+  }
+  VECTOR(csr->start)[no_of_nodes]=ptr;
+
+  igraph_vector_destroy(&in);
+  igraph_vector_destroy(&out);
+  IGRAPH_FINALLY_CLEAN(5);
+  return 0;
+}
+
+/**
+ * \function igraph_csr_destroy
+ * Frees the memory allocated for a CSR snapshot
+ *
+ * \param csr The CSR snapshot to destroy.
+ *
+ * Time complexity: operating system dependent.
+ */
+
+void igraph_csr_destroy(igraph_csr_t *csr) {
+  igraph_vector_int_destroy(&csr->eid);
+  igraph_vector_int_destroy(&csr->nei);
+  igraph_vector_long_destroy(&csr->start);
+}
@@ -33,7 +33,9 @@
 #include "igraph_interface.h"
 #include "igraph_progress.h"
 #include "igraph_interrupt_internal.h"
+#include "igraph_parallel_internal.h"
 #include "igraph_topology.h"
+#include "igraph_components.h"
 #include "igraph_types_internal.h"
 #include "igraph_stack.h"
 #include "igraph_dqueue.h"
@@ -1040,8 +1042,14 @@ int igraph_i_pagerank2(igraph_real_t *to, const igraph_real_t *from,
  *
  * Starting from version 0.7, igraph has three PageRank implementations,
  * and the user can choose between them. The first implementation is
- * \c IGRAPH_PAGERANK_ALGO_POWER, also available as the (now
- * deprecated) function \ref igraph_pagerank_old(). The second
+ * \c IGRAPH_PAGERANK_ALGO_POWER, a power iteration that runs in
+ * parallel if igraph was compiled with OpenMP support, see \ref
+ * igraph_pagerank_power(). Before version 0.8 this was the power
+ * iteration that is still available as the deprecated function \ref
+ * igraph_pagerank_old(); that one ignored the edge weights and the
+ * reset vector, and handled dangling vertices and convergence
+ * differently, so the results of \c IGRAPH_PAGERANK_ALGO_POWER have
+ * changed. They agree with PRPACK now. The second
  * implementation is based on the ARPACK library, this was the default
  * before igraph version 0.7: \c IGRAPH_PAGERANK_ALGO_ARPACK.
  *
@@ -1088,7 +1096,8 @@ int igraph_i_pagerank2(igraph_real_t *to, const igraph_real_t *from,
  *    as the number of edges.
  * \param options Options to the power method or ARPACK. For the power
  *    method, \c IGRAPH_PAGERANK_ALGO_POWER it must be a pointer to
- *    a \ref igraph_pagerank_power_options_t object.
+ *    a \ref igraph_pagerank_power_options_t object, or a null
+ *    pointer for the defaults.
  *    For \c IGRAPH_PAGERANK_ALGO_ARPACK it must be a pointer to an
  *    \ref igraph_arpack_options_t object. See \ref igraph_arpack_options_t
  *    for details. Note that the function overwrites the
@@ -1166,7 +1175,8 @@ int igraph_pagerank(const igraph_t *graph, igraph_pagerank_algo_t algo,
  *    as the number of edges.
  * \param options Options to the power method or ARPACK. For the power
  *    method, \c IGRAPH_PAGERANK_ALGO_POWER it must be a pointer to
- *    a \ref igraph_pagerank_power_options_t object.
+ *    a \ref igraph_pagerank_power_options_t object, or a null
+ *    pointer for the defaults.
  *    For \c IGRAPH_PAGERANK_ALGO_ARPACK it must be a pointer to an
  *    \ref igraph_arpack_options_t object. See \ref igraph_arpack_options_t
  *    for details. Note that the function overwrites the
@@ -1260,7 +1270,8 @@ int igraph_personalized_pagerank_vs(const igraph_t *graph,
  *    as the number of edges.
  * \param options Options to the power method or ARPACK. For the power
  *    method, \c IGRAPH_PAGERANK_ALGO_POWER it must be a pointer to
- *    a \ref igraph_pagerank_power_options_t object.
+ *    a \ref igraph_pagerank_power_options_t object, or a null
+ *    pointer for the defaults.
  *    For \c IGRAPH_PAGERANK_ALGO_ARPACK it must be a pointer to an
  *    \ref igraph_arpack_options_t object. See \ref igraph_arpack_options_t
  *    for details. Note that the function overwrites the
@@ -1292,25 +1303,1328 @@ int igraph_personalized_pagerank(const igraph_t *graph,
   if (algo == IGRAPH_PAGERANK_ALGO_POWER) {
     igraph_pagerank_power_options_t *o = 
       (igraph_pagerank_power_options_t *) options;
-    if (reset) { 
-      IGRAPH_WARNING("Cannot use weights with power method, "
-		     "weights will be ignored");
+    return igraph_pagerank_power(graph, vector, value, vids, directed,
+				 damping, reset, weights, o, /*start=*/ 0);
+  } else if (algo == IGRAPH_PAGERANK_ALGO_ARPACK) {
+    igraph_arpack_options_t *o= (igraph_arpack_options_t*) options;
+    return igraph_personalized_pagerank_arpack(graph, vector, value, vids,
+					       directed, damping, reset, 
+					       weights, o);
+  } else if (algo == IGRAPH_PAGERANK_ALGO_PRPACK) {
+    return igraph_personalized_pagerank_prpack(graph, vector, value, vids,
+					       directed, damping, reset, 
+					       weights);
+  } else {
+    IGRAPH_ERROR("Unknown PageRank algorithm", IGRAPH_EINVAL);
+  }
+
+  return 0;
+}
+
+/* The vertices are split into parts of about equal work (vertices
+   plus incoming edges), of a fixed size, and the threads process the
+   parts. The partial sums are stored per part and added in part
+   order, so the result does not depend on the number of threads. */
+
+#define IGRAPH_I_PAGERANK_PART (1 << 16)
+
+typedef struct igraph_i_pagerank_power_t {
+  const igraph_csr_t *csr;	/* incoming edges, or all edges */
+  igraph_real_t *rank, *next, *x, *outstr, *coef, *reset;
+  long int nparts, nthreads;
+  long int *bounds;
+  igraph_real_t *dangling, *sum, *maxdiff;
+} igraph_i_pagerank_power_t;
+
+static void igraph_i_pagerank_power_destroy(igraph_i_pagerank_power_t *data) {
+  igraph_Free(data->rank);
+  igraph_Free(data->next);
+  igraph_Free(data->x);
+  igraph_Free(data->outstr);
+  igraph_Free(data->coef);
+  igraph_Free(data->reset);
+  igraph_Free(data->bounds);
+  igraph_Free(data->dangling);
+  igraph_Free(data->sum);
+  igraph_Free(data->maxdiff);
+}
+
+/* The weights in snapshot order, the out-strengths and the parts,
+   for a snapshot of the incoming edges, or all edges. 'ncols' scores
+   are stored for every vertex, next to each other, and also 'ncols'
+   partial sums for every part. */
+
+static int igraph_i_pagerank_power_init(igraph_i_pagerank_power_t *data,
+					const igraph_csr_t *csr,
+					const igraph_vector_t *weights,
+					long int ncols, igraph_bool_t reset) {
+  long int no_of_nodes=csr->length;
+  long int no_of_slots=VECTOR(csr->start)[no_of_nodes];
+  long int nparts, i, p;
+
+  memset(data, 0, sizeof(*data));
+  IGRAPH_FINALLY(igraph_i_pagerank_power_destroy, data);
+  data->csr=csr;
+
+  nparts=(no_of_nodes + no_of_slots + IGRAPH_I_PAGERANK_PART - 1) / 
+    IGRAPH_I_PAGERANK_PART;
+  if (nparts < 1) { nparts=1; }
+  data->nparts=nparts;
+  data->nthreads=IGRAPH_I_MAX_THREADS();
+
+  data->rank=igraph_Calloc(no_of_nodes * ncols, igraph_real_t);
+  data->next=igraph_Calloc(no_of_nodes * ncols, igraph_real_t);
+  data->x=igraph_Calloc(no_of_nodes * ncols, igraph_real_t);
+  data->outstr=igraph_Calloc(no_of_nodes, igraph_real_t);
+  data->bounds=igraph_Calloc(nparts+1, long int);
+  data->dangling=igraph_Calloc(nparts * ncols, igraph_real_t);
+  data->sum=igraph_Calloc(nparts * ncols, igraph_real_t);
+  data->maxdiff=igraph_Calloc(nparts, igraph_real_t);
+  if (!data->rank || !data->next || !data->x || !data->outstr || 
+      !data->bounds || !data->dangling || !data->sum || !data->maxdiff) {
+    IGRAPH_ERROR("Cannot calculate PageRank scores", IGRAPH_ENOMEM);
+  }
+  if (weights) {
+    data->coef=igraph_Calloc(no_of_slots > 0 ? no_of_slots : 1, igraph_real_t);
+    if (!data->coef) {
+      IGRAPH_ERROR("Cannot calculate PageRank scores", IGRAPH_ENOMEM);
+    }
+  }
+  if (reset) {
+    data->reset=igraph_Calloc(no_of_nodes * ncols, igraph_real_t);
+    if (!data->reset) {
+      IGRAPH_ERROR("Cannot calculate PageRank scores", IGRAPH_ENOMEM);
+    }
+  }
+
+  /* The weights are copied to the order of the snapshot, so that the
+     inner loop reads them contiguously. The out-strength of a vertex
+     is the sum of the weights in its slots, as a neighbor. */
+  for (i=0; i<no_of_slots; i++) {
+    long int from=VECTOR(csr->nei)[i];
+    igraph_real_t w=1.0;
+    if (weights) {
+      w=VECTOR(*weights)[ VECTOR(csr->eid)[i] ];
+      if (w < 0) { w=0.0; }
+      data->coef[i]=w;
+    }
+    data->outstr[from] += w;
+  }
+
+  /* Split the vertices */
+  for (p=0, i=0; p<=nparts; p++) {
+    long long int target=(long long int) (no_of_nodes+no_of_slots) * p / nparts;
+    while (i < no_of_nodes && 
+	   (long long int) VECTOR(csr->start)[i] + i < target) {
+      i++;
+    }
+    data->bounds[p]=i;
+  }
+  data->bounds[nparts]=no_of_nodes;
+
+  IGRAPH_FINALLY_CLEAN(1);
+  return 0;
+}
+
+/* A snapshot of the incoming edges, from one of the outgoing edges.
+   The in-neighbors of every vertex are sorted by vertex id, just
+   like in igraph_csr_init(). */
+
+static int igraph_i_csr_transpose(const igraph_csr_t *out, igraph_csr_t *in) {
+  long int no_of_nodes=out->length;
+  long int no_of_slots=VECTOR(out->start)[no_of_nodes];
+  long int i, k;
+  igraph_vector_long_t pos;
+
+  in->length=out->length;
+  in->ecount=out->ecount;
+  in->directed=out->directed;
+  in->mode=IGRAPH_IN;
+  IGRAPH_CHECK(igraph_vector_long_init(&in->start, no_of_nodes+1));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &in->start);
+  IGRAPH_CHECK(igraph_vector_int_init(&in->nei, no_of_slots));
+  IGRAPH_FINALLY(igraph_vector_int_destroy, &in->nei);
+  IGRAPH_CHECK(igraph_vector_int_init(&in->eid, no_of_slots));
+  IGRAPH_FINALLY(igraph_vector_int_destroy, &in->eid);
+
+  for (k=0; k<no_of_slots; k++) {
+    VECTOR(in->start)[ VECTOR(out->nei)[k] + 1 ] += 1;
+  }
+  for (i=0; i<no_of_nodes; i++) {
+    VECTOR(in->start)[i+1] += VECTOR(in->start)[i];
+  }
+  IGRAPH_CHECK(igraph_vector_long_copy(&pos, &in->start));
+  for (i=0; i<no_of_nodes; i++) {
+    for (k=VECTOR(out->start)[i]; k<VECTOR(out->start)[i+1]; k++) {
+      long int to=VECTOR(out->nei)[k], p=VECTOR(pos)[to]++;
+      VECTOR(in->nei)[p]=(int) i;
+      VECTOR(in->eid)[p]=VECTOR(out->eid)[k];
+    }
+  }
+  igraph_vector_long_destroy(&pos);
+
+  IGRAPH_FINALLY_CLEAN(3);
+  return 0;
+}
+
+/* The power iteration of igraph_pagerank_csr() and
+   igraph_pagerank_power(), on a snapshot of the incoming edges, or
+   all edges. 'reset' and 'start' are optional, they are validated
+   by the caller. The scores of all vertices are stored in 'res'. */
+
+static int igraph_i_pagerank_csr(const igraph_csr_t *csr,
+				 igraph_vector_t *res, igraph_real_t damping,
+				 const igraph_vector_t *reset,
+				 const igraph_vector_t *weights,
+				 const igraph_vector_t *start,
+				 long int niter, igraph_real_t eps) {
+
+  long int no_of_nodes=csr->length;
+  igraph_i_pagerank_power_t data;
+  long int nparts, nthreads, i, p, iter;
+  igraph_real_t scale=1.0, maxdiff=0.0;
+
+  IGRAPH_CHECK(igraph_i_pagerank_power_init(&data, csr, weights,
+					    /*ncols=*/ 1, reset != 0));
+  IGRAPH_FINALLY(igraph_i_pagerank_power_destroy, &data);
+  nparts=data.nparts;
+  nthreads=data.nthreads;
+
+  if (reset) {
+    igraph_real_t reset_sum=igraph_vector_sum(reset);
+    for (i=0; i<no_of_nodes; i++) {
+      data.reset[i]=VECTOR(*reset)[i] / reset_sum;
+    }
+  }
+
+  /* 'next' always holds the unnormalized new scores, they are
+     normalized at the start of the next iteration */
+  if (start) {
+    for (i=0; i<no_of_nodes; i++) {
+      data.next[i]=VECTOR(*start)[i];
+    }
+    scale=1.0/igraph_vector_sum(start);
+  } else {
+    for (i=0; i<no_of_nodes; i++) {
+      data.next[i]=1.0/no_of_nodes;
+    }
+  }
+
+  for (iter=0; ; iter++) {
+    igraph_real_t dangling=0.0, sum=0.0;
+    
+    /* Normalize, and divide the scores by the out-strength */
+#pragma omp parallel for num_threads((int) nthreads) private(i) schedule(dynamic, 1) if(nparts > 1)
+    for (p=0; p<nparts; p++) {
+      igraph_real_t pdangling=0.0, pmaxdiff=0.0;
+      for (i=data.bounds[p]; i<data.bounds[p+1]; i++) {
+	igraph_real_t r=data.next[i] * scale;
+	igraph_real_t d=fabs(r - data.rank[i]);
+	if (d > pmaxdiff) { pmaxdiff=d; }
+	data.rank[i]=r;
+	if (data.outstr[i] > 0) {
+	  data.x[i]=r / data.outstr[i];
+	} else {
+	  data.x[i]=0.0;
+	  pdangling += r;
+	}
+      }
+      data.dangling[p]=pdangling;
+      data.maxdiff[p]=pmaxdiff;
+    }
+
+    maxdiff=0.0;
+    for (p=0; p<nparts; p++) {
+      dangling += data.dangling[p];
+      if (data.maxdiff[p] > maxdiff) { maxdiff=data.maxdiff[p]; }
+    }
+    if ((iter > 0 && maxdiff < eps) || iter == niter) { break; }
+
+    IGRAPH_ALLOW_INTERRUPTION();
+
+    /* The new scores: the walkers that arrive along the edges, plus
+       the ones that restart, and the ones from the dangling vertices */
+#pragma omp parallel for num_threads((int) nthreads) private(i) schedule(dynamic, 1) if(nparts > 1)
+    for (p=0; p<nparts; p++) {
+      const long int *st=VECTOR(csr->start);
+      const int *nei=VECTOR(csr->nei);
+      const igraph_real_t *x=data.x, *coef=data.coef;
+      igraph_real_t psum=0.0;
+      igraph_real_t uniform=(damping * dangling + 
+			     (reset ? 0.0 : 1.0-damping)) / no_of_nodes;
+      for (i=data.bounds[p]; i<data.bounds[p+1]; i++) {
+	long int k, kend=st[i+1];
+	igraph_real_t acc=0.0, r;
+	if (coef) {
+	  for (k=st[i]; k<kend; k++) {
+	    acc += x[nei[k]] * coef[k];
+	  }
+	} else {
+	  for (k=st[i]; k<kend; k++) {
+	    acc += x[nei[k]];
+	  }
+	}
+	r=damping * acc + uniform;
+	if (reset) { r += (1.0-damping) * data.reset[i]; }
+	data.next[i]=r;
+	psum += r;
+      }
+      data.sum[p]=psum;
+    }
+
+    for (p=0; p<nparts; p++) {
+      sum += data.sum[p];
+    }
+    scale=1.0/sum;
+  }
+
+  if (maxdiff >= eps) {
+    IGRAPH_WARNING("PageRank power iteration did not converge");
+  }
+
+  IGRAPH_CHECK(igraph_vector_resize(res, no_of_nodes));
+  for (i=0; i<no_of_nodes; i++) {
+    VECTOR(*res)[i]=data.rank[i];
+  }
+
+  igraph_i_pagerank_power_destroy(&data);
+  IGRAPH_FINALLY_CLEAN(1);
+
+  return 0;
+}
+
+/**
+ * \function igraph_pagerank_csr
+ * \brief Calculates the Google PageRank on a CSR snapshot.
+ *
+ * This function calculates the same PageRank scores as \ref
+ * igraph_pagerank() with the PRPACK implementation, but it works
+ * on a read-only CSR snapshot of the graph (see \ref
+ * igraph_csr_init()), using the same power iteration over the
+ * contiguous neighbor arrays of the snapshot as \ref
+ * igraph_pagerank_power(). It stops when the scores change less
+ * than 1e-10, or after 10000 iterations.
+ *
+ * </para><para>
+ * The mode of the snapshot defines how the edges are treated. If it
+ * was created with \c IGRAPH_IN or \c IGRAPH_OUT from a directed
+ * graph, then the PageRank is calculated for the directed graph;
+ * \c IGRAPH_IN snapshots are faster, for \c IGRAPH_OUT snapshots
+ * the incoming edges are collected into a temporary snapshot first.
+ * If the snapshot contains all edges, i.e. the graph is undirected
+ * or the snapshot was created with \c IGRAPH_ALL, then edge
+ * directions are ignored.
+ *
+ * </para><para>
+ * Vertices without outgoing edges distribute their score uniformly
+ * to all vertices. Edges with zero or negative weights are ignored.
+ * \param csr The CSR snapshot of the graph.
+ * \param vector Pointer to an initialized vector, the PageRank
+ *    scores of all vertices are stored here, in the order of vertex
+ *    ids. It is resized as needed.
+ * \param value Pointer to a real variable, the eigenvalue
+ *    corresponding to the PageRank vector is stored here. It is
+ *    always exactly one. It can be a null pointer.
+ * \param damping The damping factor ("d" in the original paper)
+ * \param weights Optional edge weights, it is either a null pointer,
+ *    then the edges are not weighted, or a vector of the same length
+ *    as the number of edges.
+ * \return Error code.
+ *
+ * Time complexity: O(|V|+|E|) for each iteration of the power
+ * method, the number of iterations depends on the damping factor,
+ * typically it is at most a few hundred.
+ *
+ * \sa \ref igraph_pagerank() for the version that works on
+ * <type>igraph_t</type> objects.
+ */
+
+int igraph_pagerank_csr(const igraph_csr_t *csr, igraph_vector_t *vector,
+			igraph_real_t *value, igraph_real_t damping,
+			const igraph_vector_t *weights) {
+
+  igraph_bool_t pull= csr->mode != IGRAPH_OUT || !csr->directed;
+  igraph_csr_t in;
+
+  if (damping < 0 || damping > 1) {
+    IGRAPH_ERROR("The PageRank damping factor must be in [0,1]", 
+		 IGRAPH_EINVAL);
+  }
+  if (weights && igraph_vector_size(weights) != csr->ecount) {
+    IGRAPH_ERROR("Invalid length of weights vector when calculating "
+		 "PageRank scores", IGRAPH_EINVAL);
+  }
+
+  if (value) { *value = 1.0; }
+  if (csr->length == 0) {
+    igraph_vector_clear(vector);
+    return 0;
+  }
+
+  if (pull) {
+    IGRAPH_CHECK(igraph_i_pagerank_csr(csr, vector, damping, 0, weights, 0,
+				       10000, 1e-10));
+  } else {
+    IGRAPH_CHECK(igraph_i_csr_transpose(csr, &in));
+    IGRAPH_FINALLY(igraph_csr_destroy, &in);
+    IGRAPH_CHECK(igraph_i_pagerank_csr(&in, vector, damping, 0, weights, 0,
+				       10000, 1e-10));
+    igraph_csr_destroy(&in);
+    IGRAPH_FINALLY_CLEAN(1);
+  }
+
+  return 0;
+}
+
+/**
+ * \function igraph_pagerank_power
+ * \brief PageRank with a parallel power iteration, with warm start.
+ *
+ * This is the implementation of \ref igraph_personalized_pagerank()
+ * for the \c IGRAPH_PAGERANK_ALGO_POWER algorithm, and it can also
+ * start the iteration from a given vector, typically the PageRank
+ * scores of a previous, slightly different version of the graph.
+ * Then much fewer iterations are needed.
+ *
+ * </para><para>
+ * The scores are calculated by the power iteration of \ref
+ * igraph_pagerank_csr(), over a CSR snapshot of the incoming edges
+ * of the vertices. If igraph was compiled with OpenMP support, then
+ * the vertices are split into parts with about the same number of
+ * incoming edges, and the threads process the parts. The parts do
+ * not depend on the number of threads, and their partial sums are
+ * added in a fixed order, so the result does not depend on the
+ * number of threads either.
+ *
+ * </para><para>
+ * The results are the same as the ones of the PRPACK implementation:
+ * vertices without outgoing edges distribute their score uniformly
+ * to all vertices, and edges with zero or negative weights are
+ * ignored.
+ * \param graph The graph object.
+ * \param vector Pointer to an initialized vector, the result is
+ *    stored here. It is resized as needed.
+ * \param value Pointer to a real variable, the eigenvalue
+ *    corresponding to the PageRank vector is stored here. It is
+ *    always exactly one. It can be a null pointer.
+ * \param vids The vertex ids for which the PageRank is returned.
+ * \param directed Boolean, whether to consider the directedness of
+ *    the edges. This is ignored for undirected graphs.
+ * \param damping The damping factor ("d" in the original paper), it
+ *    must be in [0,1].
+ * \param reset The probability distribution over the vertices used
+ *    when resetting the random walk, it does not need to be
+ *    normalized. It is either a null pointer (denoting a uniform
+ *    choice that results in the original PageRank measure) or a
+ *    vector of the same length as the number of vertices.
+ * \param weights Optional edge weights, it is either a null pointer,
+ *    then the edges are not weighted, or a vector of the same length
+ *    as the number of edges.
+ * \param options The maximum number of iterations and the required
+ *    precision, see \ref igraph_pagerank_power_options_t. The
+ *    iteration stops if the scores change less than \c eps for every
+ *    vertex. If this is a null pointer, then at most 1000 iterations
+ *    are performed, with \c eps set to 1e-10.
+ * \param start The starting point of the iteration, a vector with
+ *    non-negative values, for all vertices, it is normalized by the
+ *    function. If it is a null pointer, then the iteration starts
+ *    from the uniform distribution.
+ * \return Error code:
+ *         \c IGRAPH_ENOMEM, not enough memory for
+ *         temporary data. 
+ *         \c IGRAPH_EINVVID, invalid vertex id in
+ *         \p vids.
+ *         \c IGRAPH_EINVAL, invalid argument.
+ *
+ * Time complexity: O(|V|+|E|) for each iteration of the power
+ * method, the number of iterations depends on the damping factor and
+ * the starting point.
+ *
+ * \sa \ref igraph_pagerank() and \ref igraph_personalized_pagerank()
+ * for the other implementations.
+ */
+
+int igraph_pagerank_power(const igraph_t *graph, igraph_vector_t *vector,
+			  igraph_real_t *value, const igraph_vs_t vids,
+			  igraph_bool_t directed, igraph_real_t damping,
+			  const igraph_vector_t *reset,
+			  const igraph_vector_t *weights,
+			  const igraph_pagerank_power_options_t *options,
+			  const igraph_vector_t *start) {
+
+  long int no_of_nodes=igraph_vcount(graph);
+  long int no_of_edges=igraph_ecount(graph);
+  long int niter= options ? options->niter : 1000;
+  igraph_real_t eps= options ? options->eps : 1e-10;
+  igraph_csr_t csr;
+  igraph_vector_t scores;
+  long int i;
+  igraph_vit_t vit;
+
+  if (niter <= 0) {
+    IGRAPH_ERROR("Invalid iteration count", IGRAPH_EINVAL);
+  }
+  if (eps <= 0) {
+    IGRAPH_ERROR("Invalid epsilon value", IGRAPH_EINVAL);
+  }
+  if (damping < 0 || damping > 1) {
+    IGRAPH_ERROR("The PageRank damping factor must be in [0,1]", 
+		 IGRAPH_EINVAL);
+  }
+  if (weights && igraph_vector_size(weights) != no_of_edges) {
+    IGRAPH_ERROR("Invalid length of weights vector when calculating "
+		 "PageRank scores", IGRAPH_EINVAL);
+  }
+  if (reset) {
+    if (igraph_vector_size(reset) != no_of_nodes) {
+      IGRAPH_ERROR("Invalid length of reset vector when calculating "
+		   "personalized PageRank scores", IGRAPH_EINVAL);
+    }
+    if (no_of_nodes > 0 && igraph_vector_min(reset) < 0) {
+      IGRAPH_ERROR("the reset vector must not contain negative elements",
+		   IGRAPH_EINVAL);
+    }
+    if (no_of_nodes > 0 && igraph_vector_sum(reset) == 0) {
+      IGRAPH_ERROR("the sum of the elements in the reset vector must not "
+		   "be zero", IGRAPH_EINVAL);
+    }
+  }
+  if (start) {
+    if (igraph_vector_size(start) != no_of_nodes) {
+      IGRAPH_ERROR("Invalid length of start vector when calculating "
+		   "PageRank scores", IGRAPH_EINVAL);
+    }
+    if (no_of_nodes > 0 && (igraph_vector_min(start) < 0 || 
+			    igraph_vector_sum(start) == 0)) {
+      IGRAPH_ERROR("The start vector must be non-negative and non-zero",
+		   IGRAPH_EINVAL);
+    }
+  }
+
+  if (value) { *value = 1.0; }
+
+  if (no_of_nodes == 0) {
+    igraph_vector_clear(vector);
+    return 0;
+  }
+
+  IGRAPH_CHECK(igraph_csr_init(graph, &csr, directed && 
+			       igraph_is_directed(graph) ? IGRAPH_IN : 
+			       IGRAPH_ALL));
+  IGRAPH_FINALLY(igraph_csr_destroy, &csr);
+  IGRAPH_VECTOR_INIT_FINALLY(&scores, no_of_nodes);
+  IGRAPH_CHECK(igraph_i_pagerank_csr(&csr, &scores, damping, reset, weights,
+				     start, niter, eps));
+
+  IGRAPH_CHECK(igraph_vit_create(graph, vids, &vit));
+  IGRAPH_FINALLY(igraph_vit_destroy, &vit);
+  IGRAPH_CHECK(igraph_vector_resize(vector, IGRAPH_VIT_SIZE(vit)));
+  for (IGRAPH_VIT_RESET(vit), i=0; !IGRAPH_VIT_END(vit); 
+       IGRAPH_VIT_NEXT(vit), i++) {
+    VECTOR(*vector)[i]=VECTOR(scores)[ (long int) IGRAPH_VIT_GET(vit) ];
+  }
+  igraph_vit_destroy(&vit);
+  igraph_vector_destroy(&scores);
+  igraph_csr_destroy(&csr);
+  IGRAPH_FINALLY_CLEAN(3);
+
+  return 0;
+}
+
+/* The number of reset vectors that are processed together in
+   igraph_personalized_pagerank_batch(). The scores of a vertex for
+   all of them are stored next to each other, in one cache line. */
+
+#define IGRAPH_I_PAGERANK_BATCH 8
+
+/**
+ * \function igraph_personalized_pagerank_batch
+ * \brief Personalized PageRank for many reset vectors at once.
+ *
+ * Calculates the personalized PageRank scores for every column of a
+ * matrix of reset vectors, e.g. for the seed sets of many users.
+ * This is faster than calling \ref igraph_pagerank_power() for each
+ * reset vector: the CSR snapshot of the graph is only created once,
+ * and the power iterations of eight reset vectors are done together,
+ * in one pass over the edges. The scores of a vertex for these
+ * reset vectors are next to each other in memory, so a single memory
+ * access reads all of them. If igraph was compiled with OpenMP
+ * support, then each pass is done in parallel, just like in \ref
+ * igraph_pagerank_power().
+ *
+ * </para><para>
+ * The result is a dense matrix, so for many reset vectors it is
+ * better to call this function for smaller batches of them.
+ * \param graph The graph object.
+ * \param res Pointer to an initialized matrix, the result is stored
+ *    here. It has one row for every vertex in \p vids, and one column
+ *    for every reset vector. It is resized as needed.
+ * \param vids The vertex ids for which the PageRank is returned.
+ * \param directed Boolean, whether to consider the directedness of
+ *    the edges. This is ignored for undirected graphs.
+ * \param damping The damping factor ("d" in the original paper), it
+ *    must be in [0,1].
+ * \param resets The reset vectors, in the columns of a matrix that
+ *    has one row for every vertex. They do not need to be
+ *    normalized, but they must be non-negative, and every column
+ *    must have a positive sum.
+ * \param weights Optional edge weights, it is either a null pointer,
+ *    then the edges are not weighted, or a vector of the same length
+ *    as the number of edges.
+ * \param options The maximum number of iterations and the required
+ *    precision, see \ref igraph_pagerank_power_options_t. If this is
+ *    a null pointer, then at most 1000 iterations are performed, with
+ *    \c eps set to 1e-10.
+ * \return Error code:
+ *         \c IGRAPH_ENOMEM, not enough memory for
+ *         temporary data. 
+ *         \c IGRAPH_EINVVID, invalid vertex id in
+ *         \p vids.
+ *         \c IGRAPH_EINVAL, invalid argument.
+ *
+ * Time complexity: O(k(|V|+|E|)) for each iteration of the power
+ * method, for k reset vectors.
+ *
+ * \sa \ref igraph_personalized_pagerank() for a single reset vector.
+ */
+
+int igraph_personalized_pagerank_batch(const igraph_t *graph,
+				       igraph_matrix_t *res,
+				       const igraph_vs_t vids,
+				       igraph_bool_t directed,
+				       igraph_real_t damping,
+				       const igraph_matrix_t *resets,
+				       const igraph_vector_t *weights,
+				       const igraph_pagerank_power_options_t *options) {
+
+  long int no_of_nodes=igraph_vcount(graph);
+  long int no_of_edges=igraph_ecount(graph);
+  long int no_of_resets=igraph_matrix_ncol(resets);
+  long int niter= options ? options->niter : 1000;
+  igraph_real_t eps= options ? options->eps : 1e-10;
+  igraph_csr_t csr;
+  igraph_i_pagerank_power_t data;
+  const long int bw=IGRAPH_I_PAGERANK_BATCH;
+  long int nparts, nthreads, i, p, c, col, iter;
+  igraph_real_t scale[IGRAPH_I_PAGERANK_BATCH];
+  igraph_real_t dangling[IGRAPH_I_PAGERANK_BATCH];
+  igraph_vit_t vit;
+  igraph_bool_t converged=1;
+
+  if (niter <= 0) {
+    IGRAPH_ERROR("Invalid iteration count", IGRAPH_EINVAL);
+  }
+  if (eps <= 0) {
+    IGRAPH_ERROR("Invalid epsilon value", IGRAPH_EINVAL);
+  }
+  if (damping < 0 || damping > 1) {
+    IGRAPH_ERROR("The PageRank damping factor must be in [0,1]", 
+		 IGRAPH_EINVAL);
+  }
+  if (weights && igraph_vector_size(weights) != no_of_edges) {
+    IGRAPH_ERROR("Invalid length of weights vector when calculating "
+		 "PageRank scores", IGRAPH_EINVAL);
+  }
+  if (igraph_matrix_nrow(resets) != no_of_nodes) {
+    IGRAPH_ERROR("Invalid number of rows in the reset matrix when "
+		 "calculating personalized PageRank scores", IGRAPH_EINVAL);
+  }
+  if (no_of_nodes > 0 && no_of_resets > 0) {
+    if (igraph_matrix_min(resets) < 0) {
+      IGRAPH_ERROR("the reset vectors must not contain negative elements",
+		   IGRAPH_EINVAL);
+    }
+    for (col=0; col<no_of_resets; col++) {
+      igraph_real_t sum=0.0;
+      for (i=0; i<no_of_nodes; i++) {
+	sum += MATRIX(*resets, i, col);
+      }
+      if (sum == 0) {
+	IGRAPH_ERROR("the sum of the elements in a reset vector must not "
+		     "be zero", IGRAPH_EINVAL);
+      }
+    }
+  }
+
+  IGRAPH_CHECK(igraph_vit_create(graph, vids, &vit));
+  IGRAPH_FINALLY(igraph_vit_destroy, &vit);
+  IGRAPH_CHECK(igraph_matrix_resize(res, IGRAPH_VIT_SIZE(vit), 
+				    no_of_resets));
+
+  if (no_of_nodes == 0 || no_of_resets == 0) {
+    igraph_vit_destroy(&vit);
+    IGRAPH_FINALLY_CLEAN(1);
+    return 0;
+  }
+
+  IGRAPH_CHECK(igraph_csr_init(graph, &csr, directed && 
+			       igraph_is_directed(graph) ? IGRAPH_IN : 
+			       IGRAPH_ALL));
+  IGRAPH_FINALLY(igraph_csr_destroy, &csr);
+  IGRAPH_CHECK(igraph_i_pagerank_power_init(&data, &csr, weights,
+					    IGRAPH_I_PAGERANK_BATCH, /*reset=*/ 1));
+  IGRAPH_FINALLY(igraph_i_pagerank_power_destroy, &data);
+  nparts=data.nparts;
+  nthreads=data.nthreads;
+
+  for (col=0; col<no_of_resets; col += bw) {
+    long int last= no_of_resets-col < bw ? no_of_resets-col : bw;
+    igraph_real_t maxdiff=0.0;
+
+    /* The normalized reset vectors of the batch, and the start. The
+       last batch is filled up with copies of its last column, so
+       that the inner loops always have the same length. */
+    for (c=0; c<bw; c++) {
+      long int j= c < last ? col+c : col+last-1;
+      igraph_real_t sum=0.0;
+      for (i=0; i<no_of_nodes; i++) {
+	sum += MATRIX(*resets, i, j);
+      }
+      for (i=0; i<no_of_nodes; i++) {
+	data.reset[i*bw+c]=MATRIX(*resets, i, j) / sum;
+	data.next[i*bw+c]=1.0/no_of_nodes;
+	data.rank[i*bw+c]=0.0;
+      }
+      scale[c]=1.0;
+    }
+
+    for (iter=0; ; iter++) {
+
+      /* Normalize, and divide the scores by the out-strength */
+#pragma omp parallel for num_threads((int) nthreads) private(i, c) schedule(dynamic, 1) if(nparts > 1)
+      for (p=0; p<nparts; p++) {
+	igraph_real_t *pdangling=data.dangling + p*bw, pmaxdiff=0.0;
+	for (c=0; c<bw; c++) { pdangling[c]=0.0; }
+	for (i=data.bounds[p]; i<data.bounds[p+1]; i++) {
+	  igraph_real_t *rank=data.rank + i*bw, *next=data.next + i*bw;
+	  igraph_real_t *x=data.x + i*bw, str=data.outstr[i];
+	  for (c=0; c<bw; c++) {
+	    igraph_real_t r=next[c] * scale[c];
+	    igraph_real_t d=fabs(r - rank[c]);
+	    if (d > pmaxdiff) { pmaxdiff=d; }
+	    rank[c]=r;
+	  }
+	  if (str > 0) {
+	    igraph_real_t inv=1.0 / str;
+	    for (c=0; c<bw; c++) { x[c]=rank[c] * inv; }
+	  } else {
+	    for (c=0; c<bw; c++) { x[c]=0.0; pdangling[c] += rank[c]; }
+	  }
+	}
+	data.maxdiff[p]=pmaxdiff;
+      }
+
+      maxdiff=0.0;
+      for (c=0; c<bw; c++) { dangling[c]=0.0; }
+      for (p=0; p<nparts; p++) {
+	for (c=0; c<bw; c++) { dangling[c] += data.dangling[p*bw+c]; }
+	if (data.maxdiff[p] > maxdiff) { maxdiff=data.maxdiff[p]; }
+      }
+      if ((iter > 0 && maxdiff < eps) || iter == niter) { break; }
+
+      IGRAPH_ALLOW_INTERRUPTION();
+
+      /* The new scores, for all columns of the batch in one pass */
+#pragma omp parallel for num_threads((int) nthreads) private(i, c) schedule(dynamic, 1) if(nparts > 1)
+      for (p=0; p<nparts; p++) {
+	const long int *st=VECTOR(csr.start);
+	const int *nei=VECTOR(csr.nei);
+	const igraph_real_t *coef=data.coef;
+	igraph_real_t *psum=data.sum + p*bw;
+	igraph_real_t acc[IGRAPH_I_PAGERANK_BATCH];
+	for (c=0; c<bw; c++) { psum[c]=0.0; }
+	for (i=data.bounds[p]; i<data.bounds[p+1]; i++) {
+	  long int k, kend=st[i+1];
+	  igraph_real_t *next=data.next + i*bw;
+	  const igraph_real_t *reset=data.reset + i*bw;
+	  for (c=0; c<bw; c++) { acc[c]=0.0; }
+	  if (coef) {
+	    for (k=st[i]; k<kend; k++) {
+	      const igraph_real_t *x=data.x + (long int) nei[k] * bw;
+	      for (c=0; c<bw; c++) { acc[c] += x[c] * coef[k]; }
+	    }
+	  } else {
+	    for (k=st[i]; k<kend; k++) {
+	      const igraph_real_t *x=data.x + (long int) nei[k] * bw;
+	      for (c=0; c<bw; c++) { acc[c] += x[c]; }
+	    }
+	  }
+	  for (c=0; c<bw; c++) {
+	    next[c]=damping * (acc[c] + dangling[c] / no_of_nodes) + 
+	      (1.0-damping) * reset[c];
+	    psum[c] += next[c];
+	  }
+	}
+      }
+
+      for (c=0; c<bw; c++) {
+	igraph_real_t sum=0.0;
+	for (p=0; p<nparts; p++) { sum += data.sum[p*bw+c]; }
+	scale[c]=1.0/sum;
+      }
+    }
+
+    if (maxdiff >= eps) { converged=0; }
+
+    for (IGRAPH_VIT_RESET(vit), i=0; !IGRAPH_VIT_END(vit); 
+	 IGRAPH_VIT_NEXT(vit), i++) {
+      long int v=(long int) IGRAPH_VIT_GET(vit);
+      for (c=0; c<last; c++) {
+	MATRIX(*res, i, col+c)=data.rank[v*bw+c];
+      }
+    }
+  }
+
+  if (!converged) {
+    IGRAPH_WARNING("PageRank power iteration did not converge");
+  }
+
+  igraph_i_pagerank_power_destroy(&data);
+  igraph_csr_destroy(&csr);
+  igraph_vit_destroy(&vit);
+  IGRAPH_FINALLY_CLEAN(3);
+
+  return 0;
+}
+
+/* 
+ * Incremental PageRank. The state keeps the (unnormalized) scores
+ * 'x' and the residual of every vertex,
+ *
+ *   res = (1-d) r + d P x - x,
+ *
+ * where P is the transition matrix of the random walk, including the
+ * uniform jumps from the dangling vertices. An edge change only
+ * modifies the columns of P that belong to its source vertices, so
+ * the residual only changes at their neighbors, and at all vertices
+ * uniformly if a dangling vertex is involved. This is corrected by
+ * local push steps: a vertex with a large residual adds it to its
+ * score, and passes the damped residual to its neighbors. The
+ * uniform part of the residual is kept separately, and it is pushed
+ * from all vertices at once if it gets too large. Both parts are
+ * kept below eps/2, so the residual is less than eps.
+ */
+
+typedef struct igraph_i_pagerank_state_data_t {
+  igraph_vector_t neis;
+  igraph_lazy_inclist_t inclist;
+  igraph_bool_t inclist_init;
+  igraph_dqueue_t queue;
+  char *inq;
+} igraph_i_pagerank_state_data_t;
+
+static void igraph_i_pagerank_state_data_destroy(igraph_i_pagerank_state_data_t *data) {
+  igraph_vector_destroy(&data->neis);
+  igraph_dqueue_destroy(&data->queue);
+  if (data->inclist_init) {
+    igraph_lazy_inclist_destroy(&data->inclist);
+  }
+  igraph_Free(data->inq);
+}
+
+static int igraph_i_pagerank_state_data_init(igraph_i_pagerank_state_data_t *data,
+					     long int no_of_nodes) {
+  memset(data, 0, sizeof(*data));
+  IGRAPH_FINALLY(igraph_i_pagerank_state_data_destroy, data);
+  IGRAPH_CHECK(igraph_vector_init(&data->neis, 0));
+  /* A vertex is never queued twice, so the queue does not grow, and
+     pushing to it cannot fail */
+  IGRAPH_CHECK(igraph_dqueue_init(&data->queue, no_of_nodes+1));
+  data->inq=igraph_Calloc(no_of_nodes > 0 ? no_of_nodes : 1, char);
+  if (!data->inq) {
+    IGRAPH_ERROR("Cannot update PageRank scores", IGRAPH_ENOMEM);
+  }
+  IGRAPH_FINALLY_CLEAN(1);
+  return 0;
+}
+
+/* Passes 'amount' from 'from' along its edges 'neis', and queues the
+   neighbors whose residual gets too large. Without edges, it goes
+   to the uniform part of the residual. */
+
+static int igraph_i_pagerank_state_spread(const igraph_t *graph,
+					  igraph_pagerank_state_t *state,
+					  igraph_i_pagerank_state_data_t *data,
+					  const igraph_vector_t *neis,
+					  long int from, igraph_real_t amount,
+					  igraph_real_t *uniform) {
+  long int i, n=igraph_vector_size(neis);
+  igraph_real_t *res=VECTOR(state->residual);
+  igraph_real_t tol=state->eps / 2, str=0.0;
+
+  for (i=0; i<n; i++) {
+    long int edge=(long int) VECTOR(*neis)[i];
+    igraph_real_t w=state->weighted ? VECTOR(state->weights)[edge] : 1.0;
+    if (w > 0) { str += w; }
+  }
+
+  if (str == 0) {
+    *uniform += state->damping * amount / igraph_vector_size(&state->rank);
+    return 0;
+  }
+
+  amount *= state->damping / str;
+  for (i=0; i<n; i++) {
+    long int edge=(long int) VECTOR(*neis)[i];
+    long int to=IGRAPH_OTHER(graph, edge, from);
+    igraph_real_t w=state->weighted ? VECTOR(state->weights)[edge] : 1.0;
+    if (w <= 0) { continue; }
+    res[to] += amount * w;
+    if (!data->inq[to] && fabs(res[to]) > tol) {
+      IGRAPH_CHECK(igraph_dqueue_push(&data->queue, to));
+      data->inq[to]=1;
+    }
+  }
+
+  return 0;
+}
+
+/* Pushes the queued vertices, until every residual is small. The
+   state is updated in place, and it is consistent whenever this
+   returns, even after an interruption, only the residuals might be
+   too large then. */
+
+static int igraph_i_pagerank_state_push(const igraph_t *graph,
+					igraph_pagerank_state_t *state,
+					igraph_i_pagerank_state_data_t *data) {
+  long int no_of_nodes=igraph_vector_size(&state->rank);
+  igraph_real_t *x=VECTOR(state->rank), *res=VECTOR(state->residual);
+  igraph_real_t *uniform=&state->uniform;
+  igraph_real_t tol=state->eps / 2;
+  long int i;
+
+  state->pushes=0;
+  while (1) {
+    while (!igraph_dqueue_empty(&data->queue)) {
+      long int v=(long int) igraph_dqueue_pop(&data->queue);
+      igraph_real_t amount=res[v];
+      igraph_vector_t *neis;
+      data->inq[v]=0;
+      if (fabs(amount) <= tol) { continue; }
+      x[v] += amount;
+      res[v]=0.0;
+      neis=igraph_lazy_inclist_get(&data->inclist, (igraph_integer_t) v);
+      IGRAPH_CHECK(igraph_i_pagerank_state_spread(graph, state, data, neis,
+						  v, amount, uniform));
+      state->pushes += 1;
+      if ((long int) state->pushes % (1 << 14) == 0) {
+	IGRAPH_ALLOW_INTERRUPTION();
+      }
     }
-    return igraph_pagerank_old(graph, vector, vids, directed, 
-			       o->niter, o->eps, damping, 
-			       /*old=*/ 0);
-  } else if (algo == IGRAPH_PAGERANK_ALGO_ARPACK) {
-    igraph_arpack_options_t *o= (igraph_arpack_options_t*) options;
-    return igraph_personalized_pagerank_arpack(graph, vector, value, vids,
-					       directed, damping, reset, 
-					       weights, o);
-  } else if (algo == IGRAPH_PAGERANK_ALGO_PRPACK) {
-    return igraph_personalized_pagerank_prpack(graph, vector, value, vids,
-					       directed, damping, reset, 
-					       weights);
-  } else {
-    IGRAPH_ERROR("Unknown PageRank algorithm", IGRAPH_EINVAL);
+
+    if (fabs(*uniform) <= tol) { break; }
+
+    /* Push the uniform residual from every vertex */
+    {
+      igraph_real_t amount=*uniform;
+      *uniform=0.0;
+      for (i=0; i<no_of_nodes; i++) {
+	x[i] += amount;
+      }
+      for (i=0; i<no_of_nodes; i++) {
+	igraph_vector_t *neis=
+	  igraph_lazy_inclist_get(&data->inclist, (igraph_integer_t) i);
+	IGRAPH_CHECK(igraph_i_pagerank_state_spread(graph, state, data, neis,
+						    i, amount, uniform));
+      }
+      state->pushes += no_of_nodes;
+      IGRAPH_ALLOW_INTERRUPTION();
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * \function igraph_pagerank_state_init
+ * \brief PageRank scores that can be updated after edge changes.
+ *
+ * Calculates the (personalized) PageRank scores of the vertices, and
+ * keeps them in a state object, together with the information that
+ * is needed to update them after some edges are added to or removed
+ * from the graph, see \ref igraph_pagerank_state_update(). Updates
+ * after small changes are much faster than calculating the scores
+ * from scratch.
+ *
+ * </para><para>
+ * The scores are calculated by \ref igraph_pagerank_power(), and
+ * they are the same as the ones of the other PageRank
+ * implementations.
+ * \param graph The graph object.
+ * \param state Pointer to an uninitialized state object, it must be
+ *    destroyed by \ref igraph_pagerank_state_destroy().
+ * \param directed Boolean, whether to consider the directedness of
+ *    the edges. This is ignored for undirected graphs.
+ * \param damping The damping factor ("d" in the original paper), it
+ *    must be in [0,1). Unlike for the other PageRank functions, 1 is
+ *    not allowed, the local updates would not converge without
+ *    random resets.
+ * \param reset The probability distribution over the vertices used
+ *    when resetting the random walk, it does not need to be
+ *    normalized. It is either a null pointer (denoting a uniform
+ *    choice that results in the original PageRank measure) or a
+ *    vector of the same length as the number of vertices.
+ * \param weights Optional edge weights, it is either a null pointer,
+ *    then the edges are not weighted, or a vector of the same length
+ *    as the number of edges. The state keeps a copy of it.
+ * \param eps The precision of the scores. The residual of the
+ *    PageRank equation, i.e. the change of the score of a vertex in
+ *    a step of the power iteration, is less than this value for
+ *    every vertex. It must be positive, e.g. 1e-10.
+ * \return Error code:
+ *         \c IGRAPH_ENOMEM, not enough memory for
+ *         temporary data. 
+ *         \c IGRAPH_EINVAL, invalid argument.
+ *
+ * Time complexity: the same as for \ref igraph_pagerank_power().
+ */
+
+int igraph_pagerank_state_init(const igraph_t *graph,
+			       igraph_pagerank_state_t *state,
+			       igraph_bool_t directed, igraph_real_t damping,
+			       const igraph_vector_t *reset,
+			       const igraph_vector_t *weights,
+			       igraph_real_t eps) {
+
+  long int no_of_nodes=igraph_vcount(graph);
+  igraph_pagerank_power_options_t options;
+  igraph_i_pagerank_state_data_t data;
+  igraph_real_t *x, *res, dangling=0.0;
+  long int i;
+
+  if (eps <= 0) {
+    IGRAPH_ERROR("Invalid epsilon value", IGRAPH_EINVAL);
+  }
+  if (damping < 0 || damping >= 1) {
+    IGRAPH_ERROR("The PageRank state needs a damping factor in [0, 1)",
+		 IGRAPH_EINVAL);
+  }
+
+  state->directed=directed && igraph_is_directed(graph);
+  state->weighted=weights != 0;
+  state->damping=damping;
+  state->eps=eps;
+  state->uniform=0.0;
+  state->pushes=0;
+  IGRAPH_VECTOR_INIT_FINALLY(&state->rank, 0);
+  IGRAPH_VECTOR_INIT_FINALLY(&state->residual, no_of_nodes);
+  IGRAPH_VECTOR_INIT_FINALLY(&state->reset, 0);
+  IGRAPH_VECTOR_INIT_FINALLY(&state->weights, 0);
+
+  options.niter=1000;
+  options.eps=eps;
+  IGRAPH_CHECK(igraph_pagerank_power(graph, &state->rank, 0, igraph_vss_all(),
+				     directed, damping, reset, weights, 
+				     &options, /*start=*/ 0));
+
+  if (reset) {
+    IGRAPH_CHECK(igraph_vector_update(&state->reset, reset));
+    igraph_vector_scale(&state->reset, 1.0/igraph_vector_sum(reset));
+  }
+  if (weights) {
+    IGRAPH_CHECK(igraph_vector_update(&state->weights, weights));
+  }
+
+  if (no_of_nodes == 0) {
+    IGRAPH_FINALLY_CLEAN(4);
+    return 0;
+  }
+
+  IGRAPH_CHECK(igraph_i_pagerank_state_data_init(&data, no_of_nodes));
+  IGRAPH_FINALLY(igraph_i_pagerank_state_data_destroy, &data);
+  IGRAPH_CHECK(igraph_lazy_inclist_init(graph, &data.inclist, 
+					state->directed ? IGRAPH_OUT : 
+					IGRAPH_ALL));
+  data.inclist_init=1;
+
+  /* The residual of the result of the power iteration */
+  x=VECTOR(state->rank);
+  res=VECTOR(state->residual);
+  for (i=0; i<no_of_nodes; i++) {
+    igraph_vector_t *neis=
+      igraph_lazy_inclist_get(&data.inclist, (igraph_integer_t) i);
+    IGRAPH_CHECK(igraph_i_pagerank_state_spread(graph, state, &data, neis,
+						i, x[i], &dangling));
+  }
+  for (i=0; i<no_of_nodes; i++) {
+    res[i] += (1.0-damping) * (reset ? VECTOR(state->reset)[i] : 
+			       1.0/no_of_nodes) + dangling - x[i];
+    if (!data.inq[i] && fabs(res[i]) > eps / 2) {
+      IGRAPH_CHECK(igraph_dqueue_push(&data.queue, i));
+      data.inq[i]=1;
+    }
+  }
+
+  IGRAPH_CHECK(igraph_i_pagerank_state_push(graph, state, &data));
+
+  igraph_i_pagerank_state_data_destroy(&data);
+  IGRAPH_FINALLY_CLEAN(5);
+
+  return 0;
+}
+
+/**
+ * \function igraph_pagerank_state_destroy
+ * \brief Deallocates the memory used by a PageRank state object.
+ *
+ * \param state The state object to destroy.
+ *
+ * Time complexity: operating system dependent.
+ */
+
+void igraph_pagerank_state_destroy(igraph_pagerank_state_t *state) {
+  igraph_vector_destroy(&state->rank);
+  igraph_vector_destroy(&state->residual);
+  igraph_vector_destroy(&state->reset);
+  igraph_vector_destroy(&state->weights);
+}
+
+/**
+ * \function igraph_pagerank_state_update
+ * \brief Changes the edges of a graph and updates its PageRank scores.
+ *
+ * Removes and adds some edges of the graph, and updates the
+ * PageRank scores in the state object. First the edges in \p remove
+ * are removed, with \ref igraph_delete_edges(), then the edges in
+ * \p add are added, with \ref igraph_add_edges(), so the new edges
+ * get the largest edge ids, and the ids of the other edges are
+ * shifted, just like these functions do it. The edge weights in the
+ * state object are updated accordingly.
+ *
+ * </para><para>
+ * The scores are updated locally: only the source vertices of the
+ * changed edges and their neighborhood is considered, as far as the
+ * change in the scores is larger than the precision of the state.
+ * If a vertex loses or gets its first outgoing edge, then all
+ * vertices are visited, because vertices without outgoing edges
+ * distribute their score uniformly.
+ *
+ * </para><para>
+ * The new graph and the new scores are calculated on copies, and
+ * they only replace the graph and the state if everything succeeded,
+ * so both are unchanged if an error happens or the update is
+ * interrupted.
+ * \param graph The graph object, it must be the same graph the
+ *    state was created for, or the graph of the previous update.
+ * \param state The PageRank state object.
+ * \param add The edges to add, in the same format as for \ref
+ *    igraph_add_edges(). It can be a null pointer if no edges are
+ *    added.
+ * \param add_weights The weights of the new edges, if the state was
+ *    created with weights; it must be a null pointer otherwise, and
+ *    it can also be a null pointer if no edges are added.
+ * \param remove The edges to remove.
+ * \return Error code:
+ *         \c IGRAPH_ENOMEM, not enough memory for
+ *         temporary data. 
+ *         \c IGRAPH_EINVVID, invalid vertex id in \p add.
+ *         \c IGRAPH_EINVAL, invalid argument, e.g. the graph does not
+ *         belong to the state.
+ *
+ * Time complexity: O(|V|+|E|) to copy and change the graph, plus
+ * the degree of the visited vertices for the update of the scores.
+ * The number of visited vertices is typically small if the changed
+ * edges are few, see the \c pushes member of \ref
+ * igraph_pagerank_state_t.
+ */
+
+int igraph_pagerank_state_update(igraph_t *graph, 
+				 igraph_pagerank_state_t *state,
+				 const igraph_vector_t *add,
+				 const igraph_vector_t *add_weights,
+				 const igraph_es_t remove) {
+
+  long int no_of_nodes=igraph_vcount(graph);
+  long int no_of_edges=igraph_ecount(graph);
+  long int no_of_adds= add ? igraph_vector_size(add) / 2 : 0;
+  igraph_neimode_t mode= state->directed ? IGRAPH_OUT : IGRAPH_ALL;
+  igraph_i_pagerank_state_data_t data;
+  igraph_vector_t eids, sources;
+  igraph_t newgraph;
+  igraph_pagerank_state_t newstate;
+  igraph_real_t *x;
+  long int i, j, k, no_of_sources;
+  igraph_eit_t eit;
+
+  if (igraph_vector_size(&state->rank) != no_of_nodes ||
+      (state->weighted && 
+       igraph_vector_size(&state->weights) != no_of_edges)) {
+    IGRAPH_ERROR("The graph does not match the PageRank state",
+		 IGRAPH_EINVAL);
+  }
+  if (add && igraph_vector_size(add) % 2 != 0) {
+    IGRAPH_ERROR("Invalid (odd) length of edges vector", IGRAPH_EINVEVECTOR);
+  }
+  if (add && !igraph_vector_isininterval(add, 0, no_of_nodes-1)) {
+    IGRAPH_ERROR("Invalid vertex id in the edges to add", IGRAPH_EINVVID);
+  }
+  if (state->weighted) {
+    if (add_weights ? igraph_vector_size(add_weights) != no_of_adds : 
+	no_of_adds > 0) {
+      IGRAPH_ERROR("Invalid length of weights vector for the new edges",
+		   IGRAPH_EINVAL);
+    }
+  } else if (add_weights) {
+    IGRAPH_ERROR("The PageRank state has no edge weights", IGRAPH_EINVAL);
+  }
+
+  IGRAPH_CHECK(igraph_i_pagerank_state_data_init(&data, no_of_nodes));
+  IGRAPH_FINALLY(igraph_i_pagerank_state_data_destroy, &data);
+  IGRAPH_VECTOR_INIT_FINALLY(&eids, 0);
+  IGRAPH_VECTOR_INIT_FINALLY(&sources, 0);
+
+  /* The source vertices of the changed edges, data.inq is used
+     temporarily to mark them */
+  IGRAPH_CHECK(igraph_eit_create(graph, remove, &eit));
+  IGRAPH_FINALLY(igraph_eit_destroy, &eit);
+  IGRAPH_CHECK(igraph_vector_reserve(&eids, IGRAPH_EIT_SIZE(eit)));
+  for (; !IGRAPH_EIT_END(eit); IGRAPH_EIT_NEXT(eit)) {
+    long int edge=IGRAPH_EIT_GET(eit);
+    igraph_vector_push_back(&eids, edge); /* reserved */
+  }
+  igraph_eit_destroy(&eit);
+  IGRAPH_FINALLY_CLEAN(1);
+
+  for (k=0; k<2; k++) {
+    long int n= k == 0 ? igraph_vector_size(&eids) : no_of_adds;
+    for (i=0; i<n; i++) {
+      long int from, to;
+      if (k == 0) {
+	long int edge=(long int) VECTOR(eids)[i];
+	from=IGRAPH_FROM(graph, edge);
+	to=IGRAPH_TO(graph, edge);
+      } else {
+	from=(long int) VECTOR(*add)[2*i];
+	to=(long int) VECTOR(*add)[2*i+1];
+      }
+      if (!data.inq[from]) {
+	data.inq[from]=1;
+	IGRAPH_CHECK(igraph_vector_push_back(&sources, from));
+      }
+      if (!state->directed && !data.inq[to]) {
+	data.inq[to]=1;
+	IGRAPH_CHECK(igraph_vector_push_back(&sources, to));
+      }
+    }
+  }
+  no_of_sources=igraph_vector_size(&sources);
+  for (i=0; i<no_of_sources; i++) {
+    data.inq[ (long int) VECTOR(sources)[i] ]=0;
+  }
+
+  /* The changes are made on copies of the graph and of the changing
+     parts of the state, they replace the originals at the end */
+  newstate=*state;
+  IGRAPH_CHECK(igraph_vector_copy(&newstate.rank, &state->rank));
+  IGRAPH_FINALLY(igraph_vector_destroy, &newstate.rank);
+  IGRAPH_CHECK(igraph_vector_copy(&newstate.residual, &state->residual));
+  IGRAPH_FINALLY(igraph_vector_destroy, &newstate.residual);
+  IGRAPH_CHECK(igraph_vector_copy(&newstate.weights, &state->weights));
+  IGRAPH_FINALLY(igraph_vector_destroy, &newstate.weights);
+  x=VECTOR(newstate.rank);
+
+  /* Remove the old contributions of the sources */
+  for (i=0; i<no_of_sources; i++) {
+    long int v=(long int) VECTOR(sources)[i];
+    IGRAPH_CHECK(igraph_incident(graph, &data.neis, (igraph_integer_t) v, 
+				 mode));
+    IGRAPH_CHECK(igraph_i_pagerank_state_spread(graph, &newstate, &data, 
+						&data.neis, v, -x[v],
+						&newstate.uniform));
+  }
+
+  /* Change the graph and the weights */
+  IGRAPH_CHECK(igraph_copy(&newgraph, graph));
+  IGRAPH_FINALLY(igraph_destroy, &newgraph);
+  if (igraph_vector_size(&eids) > 0) {
+    if (state->weighted) {
+      igraph_real_t *w=VECTOR(newstate.weights);
+      for (i=0; i<igraph_vector_size(&eids); i++) {
+	w[ (long int) VECTOR(eids)[i] ] = IGRAPH_NAN;
+      }
+      for (i=0, j=0; i<no_of_edges; i++) {
+	if (!igraph_is_nan(w[i])) { w[j++]=w[i]; }
+      }
+      IGRAPH_CHECK(igraph_vector_resize(&newstate.weights, j));
+    }
+    IGRAPH_CHECK(igraph_delete_edges(&newgraph, igraph_ess_vector(&eids)));
+  }
+  if (no_of_adds > 0) {
+    IGRAPH_CHECK(igraph_add_edges(&newgraph, add, 0));
+    if (state->weighted) {
+      IGRAPH_CHECK(igraph_vector_append(&newstate.weights, add_weights));
+    }
+  }
+
+  /* Add the new contributions, and push */
+  IGRAPH_CHECK(igraph_lazy_inclist_init(&newgraph, &data.inclist, mode));
+  data.inclist_init=1;
+  for (i=0; i<no_of_sources; i++) {
+    long int v=(long int) VECTOR(sources)[i];
+    igraph_vector_t *neis=
+      igraph_lazy_inclist_get(&data.inclist, (igraph_integer_t) v);
+    IGRAPH_CHECK(igraph_i_pagerank_state_spread(&newgraph, &newstate, &data,
+						neis, v, x[v], 
+						&newstate.uniform));
+  }
+
+  IGRAPH_CHECK(igraph_i_pagerank_state_push(&newgraph, &newstate, &data));
+
+  /* Nothing can fail from here */
+  igraph_vector_destroy(&sources);
+  igraph_vector_destroy(&eids);
+  igraph_i_pagerank_state_data_destroy(&data);
+  igraph_destroy(graph);
+  *graph=newgraph;
+  igraph_vector_destroy(&state->rank);
+  igraph_vector_destroy(&state->residual);
+  igraph_vector_destroy(&state->weights);
+  *state=newstate;
+  IGRAPH_FINALLY_CLEAN(7);
+
+  return 0;
+}
+
+/**
+ * \function igraph_pagerank_state_get
+ * \brief The PageRank scores from a state object.
+ *
+ * \param graph The graph object, the one of the state.
+ * \param state The PageRank state object.
+ * \param vector Pointer to an initialized vector, the scores of the
+ *    vertices are stored here, normalized to sum up to one over all
+ *    vertices. It is resized as needed.
+ * \param vids The vertex ids for which the PageRank is returned.
+ * \return Error code:
+ *         \c IGRAPH_EINVVID, invalid vertex id in \p vids.
+ *         \c IGRAPH_EINVAL, the graph does not belong to the state.
+ *
+ * Time complexity: O(|V|), the number of vertices.
+ */
+
+int igraph_pagerank_state_get(const igraph_t *graph, 
+			      const igraph_pagerank_state_t *state,
+			      igraph_vector_t *vector, const igraph_vs_t vids) {
+  igraph_vit_t vit;
+  igraph_real_t sum;
+  long int i;
+
+  if (igraph_vector_size(&state->rank) != igraph_vcount(graph)) {
+    IGRAPH_ERROR("The graph does not match the PageRank state",
+		 IGRAPH_EINVAL);
+  }
+  sum=igraph_vector_sum(&state->rank);
+
+  IGRAPH_CHECK(igraph_vit_create(graph, vids, &vit));
+  IGRAPH_FINALLY(igraph_vit_destroy, &vit);
+  IGRAPH_CHECK(igraph_vector_resize(vector, IGRAPH_VIT_SIZE(vit)));
+  for (IGRAPH_VIT_RESET(vit), i=0; !IGRAPH_VIT_END(vit); 
+       IGRAPH_VIT_NEXT(vit), i++) {
+    long int v=(long int) IGRAPH_VIT_GET(vit);
+    VECTOR(*vector)[i]=VECTOR(state->rank)[v] / sum;
   }
+  igraph_vit_destroy(&vit);
+  IGRAPH_FINALLY_CLEAN(1);
 
   return 0;
 }
@@ -1573,126 +2887,449 @@ int igraph_betweenness(const igraph_t *graph, igraph_vector_t *res,
 				     nobigint);
 }
 
-int igraph_i_betweenness_estimate_weighted(const igraph_t *graph, 
-					 igraph_vector_t *res, 
-					 const igraph_vs_t vids, 
-					 igraph_bool_t directed,
-					 igraph_real_t cutoff, 
-					 const igraph_vector_t *weights, 
-					 igraph_bool_t nobigint) {
+/*
+ * Brandes' algorithm for vertex and edge betweenness, distributed
+ * over the source vertices among the OpenMP threads, see
+ * igraph_parallel_internal.h. Every thread has its own workspace and
+ * its own score vector, for the vertices or for the edges; these are
+ * added up in thread order at the end.
+ */
 
-  igraph_integer_t no_of_nodes=(igraph_integer_t) igraph_vcount(graph);
-  igraph_integer_t no_of_edges=(igraph_integer_t) igraph_ecount(graph);
+typedef struct igraph_i_betweenness_ws_t {
+  long int *dist;		/* unweighted: distance+1, zero if not reached */
+  unsigned long long int *nrgeo; /* must be long long; consider grid
+				    graphs for example */
+  igraph_real_t *wdist;		/* weighted: distance+1, zero if not reached */
+  igraph_real_t *wnrgeo;
+  igraph_real_t *tmpscore;
+  int *order;			/* the vertices in the order they were reached */
+  int *fathers;			/* weighted: the last edges of the shortest */
+  int *nfathers;		/* paths, stored at the in-list offsets */
   igraph_2wheap_t Q;
-  igraph_inclist_t inclist;
-  igraph_adjlist_t fathers;
-  long int source, j;
-  igraph_stack_t S;
-  igraph_neimode_t mode= directed ? IGRAPH_OUT : IGRAPH_ALL;
-  igraph_vector_t dist, nrgeo, tmpscore;
-  igraph_vector_t v_tmpres, *tmpres=&v_tmpres;
-  igraph_vit_t vit;
+  igraph_bool_t Q_init;
+  igraph_real_t *score;
+} igraph_i_betweenness_ws_t;
 
-  IGRAPH_UNUSED(nobigint);
+typedef struct igraph_i_betweenness_data_t {
+  const igraph_t *graph;
+  igraph_bool_t directed;
+  igraph_csr_t csr_out, csr_in;
+  const igraph_csr_t *out, *in;
+  const igraph_vector_t *weights;
+  igraph_real_t cutoff;
+  igraph_bool_t edges;
+  long int nthreads;
+  igraph_i_betweenness_ws_t *ws;
+} igraph_i_betweenness_data_t;
+
+static void igraph_i_betweenness_ws_destroy(igraph_i_betweenness_data_t *data) {
+  long int t;
+  for (t=0; t<data->nthreads && data->ws; t++) {
+    igraph_i_betweenness_ws_t *ws=&data->ws[t];
+    igraph_Free(ws->dist);
+    igraph_Free(ws->nrgeo);
+    igraph_Free(ws->wdist);
+    igraph_Free(ws->wnrgeo);
+    igraph_Free(ws->tmpscore);
+    igraph_Free(ws->order);
+    igraph_Free(ws->fathers);
+    igraph_Free(ws->nfathers);
+    igraph_Free(ws->score);
+    if (ws->Q_init) {
+      igraph_2wheap_destroy(&ws->Q);
+    }
+  }
+  igraph_Free(data->ws);
+}
 
-  if (igraph_vector_size(weights) != no_of_edges) {
-    IGRAPH_ERROR("Weight vector length does not match", IGRAPH_EINVAL);
+static int igraph_i_betweenness_ws_init(igraph_i_betweenness_data_t *data,
+					igraph_i_betweenness_ws_t *ws) {
+  long int no_of_nodes=igraph_vcount(data->graph);
+  long int no_of_edges=igraph_ecount(data->graph);
+  long int no_of_slots=VECTOR(data->in->start)[no_of_nodes];
+
+  /* max(n,1), calloc(0) might return a null pointer */
+  ws->tmpscore=igraph_Calloc(no_of_nodes > 0 ? no_of_nodes : 1, igraph_real_t);
+  ws->order=igraph_Calloc(no_of_nodes > 0 ? no_of_nodes : 1, int);
+  if (data->edges) {
+    ws->score=igraph_Calloc(no_of_edges > 0 ? no_of_edges : 1, igraph_real_t);
+  } else {
+    ws->score=igraph_Calloc(no_of_nodes > 0 ? no_of_nodes : 1, igraph_real_t);
   }
-  if (igraph_vector_min(weights) <= 0) {
-    IGRAPH_ERROR("Weight vector must be positive", IGRAPH_EINVAL);
+  if (!ws->tmpscore || !ws->order || !ws->score) {
+    IGRAPH_ERROR("Betweenness failed", IGRAPH_ENOMEM);
   }
 
-  IGRAPH_CHECK(igraph_2wheap_init(&Q, no_of_nodes));
-  IGRAPH_FINALLY(igraph_2wheap_destroy, &Q);
-  IGRAPH_CHECK(igraph_inclist_init(graph, &inclist, mode));  
-  IGRAPH_FINALLY(igraph_inclist_destroy, &inclist);
-  IGRAPH_CHECK(igraph_adjlist_init_empty(&fathers, no_of_nodes));
-  IGRAPH_FINALLY(igraph_adjlist_destroy, &fathers);
+  if (!data->weights) {
+    ws->dist=igraph_Calloc(no_of_nodes > 0 ? no_of_nodes : 1, long int);
+    ws->nrgeo=igraph_Calloc(no_of_nodes > 0 ? no_of_nodes : 1, 
+			    unsigned long long int);
+    if (!ws->dist || !ws->nrgeo) {
+      IGRAPH_ERROR("Betweenness failed", IGRAPH_ENOMEM);
+    }
+  } else {
+    ws->wdist=igraph_Calloc(no_of_nodes > 0 ? no_of_nodes : 1, igraph_real_t);
+    ws->wnrgeo=igraph_Calloc(no_of_nodes > 0 ? no_of_nodes : 1, igraph_real_t);
+    ws->fathers=igraph_Calloc(no_of_slots > 0 ? no_of_slots : 1, int);
+    ws->nfathers=igraph_Calloc(no_of_nodes > 0 ? no_of_nodes : 1, int);
+    if (!ws->wdist || !ws->wnrgeo || !ws->fathers || !ws->nfathers) {
+      IGRAPH_ERROR("Betweenness failed", IGRAPH_ENOMEM);
+    }
+    /* Reserve the full size, so that the heap never needs to grow
+       in the parallel part */
+    IGRAPH_CHECK(igraph_2wheap_init(&ws->Q, no_of_nodes));
+    ws->Q_init=1;
+    IGRAPH_CHECK(igraph_vector_reserve(&ws->Q.data, no_of_nodes));
+    IGRAPH_CHECK(igraph_vector_long_reserve(&ws->Q.index, no_of_nodes));
+  }
 
-  IGRAPH_CHECK(igraph_stack_init(&S, no_of_nodes));
-  IGRAPH_FINALLY(igraph_stack_destroy, &S);
-  IGRAPH_VECTOR_INIT_FINALLY(&dist, no_of_nodes);
-  IGRAPH_VECTOR_INIT_FINALLY(&tmpscore, no_of_nodes);
-  IGRAPH_VECTOR_INIT_FINALLY(&nrgeo, no_of_nodes);
+  return 0;
+}
 
-  if (igraph_vs_is_all(&vids)) {
-    IGRAPH_CHECK(igraph_vector_resize(res, no_of_nodes));
-    igraph_vector_null(res);
-    tmpres=res;
-  } else {
-    IGRAPH_VECTOR_INIT_FINALLY(tmpres, no_of_nodes);
+static void igraph_i_betweenness_data_destroy(igraph_i_betweenness_data_t *data) {
+  igraph_i_betweenness_ws_destroy(data);
+  if (data->directed) {
+    igraph_csr_destroy(&data->csr_in);
   }
+  igraph_csr_destroy(&data->csr_out);
+}
 
-  for (source=0; source<no_of_nodes; source++) {
-    IGRAPH_PROGRESS("Betweenness centrality: ", 100.0*source/no_of_nodes, 0);
-    IGRAPH_ALLOW_INTERRUPTION();
+/* Creates the CSR snapshots and 'nthreads' workspaces. 'directed' must
+   be false for undirected graphs. */
+
+static int igraph_i_betweenness_data_init(igraph_i_betweenness_data_t *data,
+					  const igraph_t *graph,
+					  igraph_bool_t directed,
+					  igraph_real_t cutoff,
+					  const igraph_vector_t *weights,
+					  igraph_bool_t edges,
+					  long int nthreads) {
+  long int t;
+
+  data->graph=graph;
+  data->directed=directed;
+  data->weights=weights;
+  data->cutoff=cutoff;
+  data->edges=edges;
+  data->nthreads=nthreads;
+  data->ws=0;
+
+  IGRAPH_CHECK(igraph_csr_init(graph, &data->csr_out, 
+			       directed ? IGRAPH_OUT : IGRAPH_ALL));
+  IGRAPH_FINALLY(igraph_csr_destroy, &data->csr_out);
+  if (directed) {
+    IGRAPH_CHECK(igraph_csr_init(graph, &data->csr_in, IGRAPH_IN));
+    IGRAPH_FINALLY(igraph_csr_destroy, &data->csr_in);
+  }
+  data->out=&data->csr_out;
+  data->in= directed ? &data->csr_in : &data->csr_out;
 
-    igraph_2wheap_push_with_index(&Q, source, 0);
-    VECTOR(dist)[source]=1.0;
-    VECTOR(nrgeo)[source]=1;
-    
-    while (!igraph_2wheap_empty(&Q)) {
-      long int minnei=igraph_2wheap_max_index(&Q);
-      igraph_real_t mindist=-igraph_2wheap_delete_max(&Q);
-      igraph_vector_int_t *neis;
-      long int nlen;
-      
-      igraph_stack_push(&S, minnei);
-      
-      if (cutoff >=0 && VECTOR(dist)[minnei] >= cutoff+1.0) { continue; }
-      
-      /* Now check all neighbors of 'minnei' for a shorter path */
-      neis=igraph_inclist_get(&inclist, minnei);
-      nlen=igraph_vector_int_size(neis);
-      for (j=0; j<nlen; j++) {
-	long int edge=(long int) VECTOR(*neis)[j];
-	long int to=IGRAPH_OTHER(graph, edge, minnei);
-	igraph_real_t altdist=mindist + VECTOR(*weights)[edge];
-	igraph_real_t curdist=VECTOR(dist)[to];
-	if (curdist==0) {
-	  /* This is the first non-infinite distance */
-	  igraph_vector_int_t *v=igraph_adjlist_get(&fathers, to);
-	  igraph_vector_int_resize(v,1);
-	  VECTOR(*v)[0]=minnei;
-	  VECTOR(nrgeo)[to] = VECTOR(nrgeo)[minnei];
-
-	  VECTOR(dist)[to]=altdist+1.0;
-	  IGRAPH_CHECK(igraph_2wheap_push_with_index(&Q, to, -altdist));
-	} else if (altdist < curdist-1) {
-	  /* This is a shorter path */
-	  igraph_vector_int_t *v=igraph_adjlist_get(&fathers, to);
-	  igraph_vector_int_resize(v,1);
-	  VECTOR(*v)[0]=minnei;
-	  VECTOR(nrgeo)[to] = VECTOR(nrgeo)[minnei];
+  data->ws=igraph_Calloc(nthreads, igraph_i_betweenness_ws_t);
+  if (!data->ws) {
+    IGRAPH_ERROR("Betweenness failed", IGRAPH_ENOMEM);
+  }
+  IGRAPH_FINALLY(igraph_i_betweenness_ws_destroy, data);
+  for (t=0; t<nthreads; t++) {
+    IGRAPH_CHECK(igraph_i_betweenness_ws_init(data, &data->ws[t]));
+  }
+
+  IGRAPH_FINALLY_CLEAN(directed ? 3 : 2);
+  return 0;
+}
+
+/* The forward phase of the unweighted search: BFS from 'source',
+   computing the distances and the number of shortest paths. It stops
+   after reaching 'target', if that is not negative; the distances and
+   path counts of the vertices up to the distance of 'target' are final
+   at that point. Returns the number of vertices reached, these are
+   the first ones in 'ws->order'. */
+
+static long int igraph_i_betweenness_forward(const igraph_i_betweenness_data_t *data,
+					     igraph_i_betweenness_ws_t *ws,
+					     long int source, long int target) {
+  long int *dist=ws->dist;
+  unsigned long long int *nrgeo=ws->nrgeo;
+  int *order=ws->order;
+  long int head=0, tail=0, j;
+
+  order[tail++]=(int) source;
+  nrgeo[source]=1;
+  dist[source]=1;
+
+  while (head < tail) {
+    long int actnode=order[head++];
+    int *neis=igraph_csr_neighbors(data->out, actnode);
+    long int nneis=igraph_csr_degree(data->out, actnode);
+
+    if (actnode == target) { break; }
+    if (data->cutoff >= 0 && dist[actnode] >= data->cutoff+1) { continue; }
+
+    for (j=0; j<nneis; j++) {
+      long int neighbor=neis[j];
+      if (dist[neighbor]==0) {
+	dist[neighbor]=dist[actnode]+1;
+	order[tail++]=(int) neighbor;
+      }
+      if (dist[neighbor]==dist[actnode]+1) {
+	nrgeo[neighbor]+=nrgeo[actnode];
+      }
+    }
+  }
+
+  return tail;
+}
+
+static void igraph_i_betweenness_source(const igraph_i_betweenness_data_t *data,
+					igraph_i_betweenness_ws_t *ws,
+					long int source) {
+  long int *dist=ws->dist;
+  unsigned long long int *nrgeo=ws->nrgeo;
+  igraph_real_t *tmpscore=ws->tmpscore;
+  int *order=ws->order;
+  long int tail, j;
+
+  tail=igraph_i_betweenness_forward(data, ws, source, /*target=*/ -1);
+
+  /* Ok, we've the distance of each node and also the number of
+     shortest paths to them. Now we do an inverse search, starting
+     with the farthest nodes. The fathers of a node are its
+     in-neighbors that are one step closer to the source. */
+  while (tail > 0) {
+    long int actnode=order[--tail];
+    int *neis=igraph_csr_neighbors(data->in, actnode);
+    int *eids=igraph_csr_incident(data->in, actnode);
+    long int nneis=igraph_csr_degree(data->in, actnode);
+
+    if (actnode != source) {
+      for (j=0; j<nneis; j++) {
+	long int neighbor=neis[j];
+	if (dist[neighbor]==dist[actnode]-1) {
+	  igraph_real_t c=(tmpscore[actnode]+1)*nrgeo[neighbor]/nrgeo[actnode];
+	  tmpscore[neighbor] += c;
+	  if (data->edges) { ws->score[eids[j]] += c; }
+	}
+      }
+      if (!data->edges) { ws->score[actnode] += tmpscore[actnode]; }
+    }
+
+    dist[actnode]=0;
+    nrgeo[actnode]=0;
+    tmpscore[actnode]=0;
+  }
+}
+
+/* The same for weighted graphs, with Dijkstra's algorithm. Returns
+   the number of vertices whose distance is final, in 'ws->order'.
+   If the search stops at 'target', the other vertices are cleared. */
+
+static long int igraph_i_betweenness_forward_weighted(const igraph_i_betweenness_data_t *data,
+						      igraph_i_betweenness_ws_t *ws,
+						      long int source, 
+						      long int target) {
+  igraph_real_t *dist=ws->wdist;
+  igraph_real_t *nrgeo=ws->wnrgeo;
+  igraph_real_t *weights=VECTOR(*data->weights);
+  int *order=ws->order, *fathers=ws->fathers, *nfathers=ws->nfathers;
+  long int *fstart=VECTOR(data->in->start);
+  igraph_2wheap_t *Q=&ws->Q;
+  long int nord=0, j;
+
+  /* The heap has enough space reserved, so pushing cannot fail */
+  igraph_2wheap_push_with_index(Q, source, 0);
+  dist[source]=1.0;
+  nrgeo[source]=1;
+
+  while (!igraph_2wheap_empty(Q)) {
+    long int minnei=igraph_2wheap_max_index(Q);
+    igraph_real_t mindist=-igraph_2wheap_delete_max(Q);
+    int *neis, *eids;
+    long int nlen;
+
+    order[nord++]=(int) minnei;
+
+    if (minnei == target) { break; }
+    if (data->cutoff >= 0 && dist[minnei] >= data->cutoff+1.0) { continue; }
+
+    /* Now check all neighbors of 'minnei' for a shorter path */
+    neis=igraph_csr_neighbors(data->out, minnei);
+    eids=igraph_csr_incident(data->out, minnei);
+    nlen=igraph_csr_degree(data->out, minnei);
+    for (j=0; j<nlen; j++) {
+      long int edge=eids[j];
+      long int to=neis[j];
+      igraph_real_t altdist=mindist + weights[edge];
+      igraph_real_t curdist=dist[to];
+      if (curdist==0) {
+	/* This is the first non-infinite distance */
+	fathers[fstart[to]]=(int) edge;
+	nfathers[to]=1;
+	nrgeo[to]=nrgeo[minnei];
+	dist[to]=altdist+1.0;
+	igraph_2wheap_push_with_index(Q, to, -altdist);
+      } else if (altdist < curdist-1) {
+	/* This is a shorter path */
+	fathers[fstart[to]]=(int) edge;
+	nfathers[to]=1;
+	nrgeo[to]=nrgeo[minnei];
+	dist[to]=altdist+1.0;
+	igraph_2wheap_modify(Q, to, -altdist);
+      } else if (altdist == curdist-1) {
+	fathers[fstart[to]+nfathers[to]]=(int) edge;
+	nfathers[to] += 1;
+	nrgeo[to] += nrgeo[minnei];
+      }
+    }
+  }
+
+  if (!igraph_2wheap_empty(Q)) {
+    long int k, size=igraph_2wheap_size(Q);
+    for (k=0; k<size; k++) {
+      long int idx=VECTOR(Q->index)[k];
+      VECTOR(Q->index2)[idx]=0;
+      dist[idx]=0;
+      nrgeo[idx]=0;
+      nfathers[idx]=0;
+    }
+    igraph_vector_clear(&Q->data);
+    igraph_vector_long_clear(&Q->index);
+  }
+
+  return nord;
+}
+
+static void igraph_i_betweenness_source_weighted(const igraph_i_betweenness_data_t *data,
+						 igraph_i_betweenness_ws_t *ws,
+						 long int source) {
+  igraph_real_t *dist=ws->wdist;
+  igraph_real_t *nrgeo=ws->wnrgeo;
+  igraph_real_t *tmpscore=ws->tmpscore;
+  int *order=ws->order, *fathers=ws->fathers, *nfathers=ws->nfathers;
+  long int *fstart=VECTOR(data->in->start);
+  long int nord, j;
+
+  nord=igraph_i_betweenness_forward_weighted(data, ws, source, /*target=*/ -1);
+
+  while (nord > 0) {
+    long int w=order[--nord];
+    int *fatv=fathers+fstart[w];
+    long int fatv_len=nfathers[w];
+    for (j=0; j<fatv_len; j++) {
+      long int fedge=fatv[j];
+      long int f=IGRAPH_OTHER(data->graph, fedge, w);
+      tmpscore[f] += nrgeo[f]/nrgeo[w] * (1+tmpscore[w]);
+      if (data->edges) { 
+	ws->score[fedge] += ((tmpscore[w]+1) * nrgeo[f]) / nrgeo[w];
+      }
+    }
+    if (!data->edges && w != source) { ws->score[w] += tmpscore[w]; }
+
+    tmpscore[w]=0;
+    dist[w]=0;
+    nrgeo[w]=0;
+    nfathers[w]=0;
+  }
+}
+
+/* Adds the betweenness scores of the vertices or the edges
+   (if 'edges' is true) to 'score'. 'directed' must be false for
+   undirected graphs. */
+
+static int igraph_i_betweenness_brandes(const igraph_t *graph,
+					igraph_real_t *score,
+					igraph_bool_t edges,
+					igraph_bool_t directed,
+					igraph_real_t cutoff,
+					const igraph_vector_t *weights,
+					const char *message) {
+
+  long int no_of_nodes=igraph_vcount(graph);
+  long int no_of_edges=igraph_ecount(graph);
+  long int score_len= edges ? no_of_edges : no_of_nodes;
+  long int nthreads=IGRAPH_I_MAX_THREADS();
+  long int used_threads=1, t, i;
+  volatile int interrupted=0;
+  igraph_i_betweenness_data_t data;
+
+  if (nthreads > no_of_nodes) { nthreads=no_of_nodes; }
+  if (nthreads < 1) { nthreads=1; }
+
+  IGRAPH_CHECK(igraph_i_betweenness_data_init(&data, graph, directed, cutoff,
+					      weights, edges, nthreads));
+  IGRAPH_FINALLY(igraph_i_betweenness_data_destroy, &data);
+
+  IGRAPH_PROGRESS(message, 0.0, 0);
+
+#pragma omp parallel num_threads((int) nthreads)
+  {
+    long int tid=IGRAPH_I_THREAD_NUM(), nt=IGRAPH_I_NUM_THREADS();
+    long int begin=IGRAPH_I_THREAD_BEGIN(no_of_nodes, tid, nt);
+    long int end=IGRAPH_I_THREAD_END(no_of_nodes, tid, nt);
+    long int source;
+    igraph_i_betweenness_ws_t *ws=&data.ws[tid];
+
+    if (tid==0) { used_threads=nt; }
+
+    for (source=begin; source<end && !interrupted; source++) {
+      if (tid==0 && igraph_progress(message, 100.0*(source-begin)/(end-begin),
+				    0) != IGRAPH_SUCCESS) {
+	interrupted=1;
+      }
+      IGRAPH_I_ALLOW_INTERRUPTION_PARALLEL(interrupted);
+      if (weights) {
+	igraph_i_betweenness_source_weighted(&data, ws, source);
+      } else {
+	igraph_i_betweenness_source(&data, ws, source);
+      }
+    }
+  }
+
+  if (interrupted) {
+    IGRAPH_FINALLY_FREE();
+    return IGRAPH_INTERRUPTED;
+  }
+
+#pragma omp parallel for private(t) schedule(static)
+  for (i=0; i<score_len; i++) {
+    for (t=0; t<used_threads; t++) {
+      score[i] += data.ws[t].score[i];
+    }
+  }
+
+  IGRAPH_PROGRESS(message, 100.0, 0);
+
+  igraph_i_betweenness_data_destroy(&data);
+  IGRAPH_FINALLY_CLEAN(1);
+
+  return 0;
+}
+
+/* Vertex betweenness, without big integers */
+
+static int igraph_i_betweenness_estimate(const igraph_t *graph,
+					 igraph_vector_t *res,
+					 const igraph_vs_t vids,
+					 igraph_bool_t directed,
+					 igraph_real_t cutoff,
+					 const igraph_vector_t *weights) {
+
+  long int no_of_nodes=igraph_vcount(graph);
+  igraph_vector_t v_tmpres, *tmpres=&v_tmpres;
+  igraph_vit_t vit;
+  long int j;
 
-	  VECTOR(dist)[to]=altdist+1.0;
-	  IGRAPH_CHECK(igraph_2wheap_modify(&Q, to, -altdist));
-	} else if (altdist == curdist-1) {
-	  igraph_vector_int_t *v=igraph_adjlist_get(&fathers, to);
-	  igraph_vector_int_push_back(v, minnei);
-	  VECTOR(nrgeo)[to] += VECTOR(nrgeo)[minnei];
-	}
-      }
-      
-    } /* !igraph_2wheap_empty(&Q) */
+  directed=directed && igraph_is_directed(graph);
 
-    while (!igraph_stack_empty(&S)) {
-      long int w=(long int) igraph_stack_pop(&S);
-      igraph_vector_int_t *fatv=igraph_adjlist_get(&fathers, w);
-      long int fatv_len=igraph_vector_int_size(fatv);
-      for (j=0; j<fatv_len; j++) {
-	long int f=(long int) VECTOR(*fatv)[j];
-	VECTOR(tmpscore)[f] += VECTOR(nrgeo)[f]/VECTOR(nrgeo)[w] * (1+VECTOR(tmpscore)[w]);
-      }
-      if (w!=source) { VECTOR(*tmpres)[w] += VECTOR(tmpscore)[w]; }
+  if (igraph_vs_is_all(&vids)) {
+    IGRAPH_CHECK(igraph_vector_resize(res, no_of_nodes));
+    igraph_vector_null(res);
+    tmpres=res;
+  } else {
+    IGRAPH_VECTOR_INIT_FINALLY(tmpres, no_of_nodes);
+  }
 
-      VECTOR(tmpscore)[w]=0;
-      VECTOR(dist)[w]=0;
-      VECTOR(nrgeo)[w]=0;
-      igraph_vector_int_clear(igraph_adjlist_get(&fathers, w));
-    }
-    
-  } /* source < no_of_nodes */
+  IGRAPH_CHECK(igraph_i_betweenness_brandes(graph, VECTOR(*tmpres), 
+					    /*edges=*/ 0, directed, cutoff, 
+					    weights, "Betweenness centrality: "));
 
   if (!igraph_vs_is_all(&vids)) {
     IGRAPH_CHECK(igraph_vit_create(graph, vids, &vit));
@@ -1705,30 +3342,19 @@ int igraph_i_betweenness_estimate_weighted(const igraph_t *graph,
       VECTOR(*res)[j] = VECTOR(*tmpres)[node];
     }
     
-    no_of_nodes = (igraph_integer_t) j;
-    
     igraph_vit_destroy(&vit);
     igraph_vector_destroy(tmpres);
     IGRAPH_FINALLY_CLEAN(2);
   }
 
-  if (!directed || !igraph_is_directed(graph)) {
-    for (j=0; j<no_of_nodes; j++) {
+  /* divide by 2 for undirected graph */
+  if (!directed) {
+    long int n=igraph_vector_size(res);
+    for (j=0; j<n; j++) {
       VECTOR(*res)[j] /= 2.0;
     }
   }
-  
-  IGRAPH_PROGRESS("Betweenness centrality: ", 100.0, 0);
 
-  igraph_vector_destroy(&nrgeo);
-  igraph_vector_destroy(&tmpscore);
-  igraph_vector_destroy(&dist);
-  igraph_stack_destroy(&S);
-  igraph_adjlist_destroy(&fathers);
-  igraph_inclist_destroy(&inclist);
-  igraph_2wheap_destroy(&Q);
-  IGRAPH_FINALLY_CLEAN(7);
-  
   return 0;
 }
 
@@ -1755,6 +3381,16 @@ void igraph_i_destroy_biguints(igraph_biguint_t *p) {
  * equal to a prescribed length. Note that the estimated centrality
  * will always be less than the real one.
  *
+ * </para><para>
+ * If igraph was compiled with OpenMP support, the shortest paths
+ * from the different source vertices are explored in parallel; the
+ * number of threads can be set e.g. via the \c OMP_NUM_THREADS
+ * environment variable. The partial scores of the threads are added
+ * up in a fixed order, so the result depends only on the number of
+ * threads, not on their scheduling.
+ * The big integer variant (unweighted graphs, \p nobigint false)
+ * always runs in a single thread.
+ *
  * \param graph The graph object.
  * \param res The result of the computation, a vector containing the
  *        estimated betweenness scores for the specified vertices.
@@ -1796,10 +3432,9 @@ int igraph_betweenness_estimate(const igraph_t *graph, igraph_vector_t *res,
 				igraph_bool_t nobigint) {
 
   long int no_of_nodes=igraph_vcount(graph);
+  long int no_of_edges=igraph_ecount(graph);
   igraph_dqueue_t q=IGRAPH_DQUEUE_NULL;
   long int *distance;
-  unsigned long long int *nrgeo=0;  /* must be long long; consider grid
-				       graphs for example */
   igraph_biguint_t *big_nrgeo=0;
   double *tmpscore;
   igraph_stack_t stack=IGRAPH_STACK_NULL;
@@ -1815,10 +3450,20 @@ int igraph_betweenness_estimate(const igraph_t *graph, igraph_vector_t *res,
   igraph_biguint_t D, R, T;
 
   if (weights) { 
-    return igraph_i_betweenness_estimate_weighted(graph, res, vids, directed,
-						cutoff, weights, nobigint);
+    if (igraph_vector_size(weights) != no_of_edges) {
+      IGRAPH_ERROR("Weight vector length does not match", IGRAPH_EINVAL);
+    }
+    if (no_of_edges > 0 && igraph_vector_min(weights) <= 0) {
+      IGRAPH_ERROR("Weight vector must be positive", IGRAPH_EINVAL);
+    }
+  }
+  if (weights || nobigint) {
+    return igraph_i_betweenness_estimate(graph, res, vids, directed, cutoff,
+					 weights);
   }
 
+  /* The rest is the big integer version, this runs serially */
+
   if (!igraph_vs_is_all(&vids)) {
     /* subset */
     IGRAPH_VECTOR_INIT_FINALLY(tmpres, no_of_nodes);
@@ -1854,30 +3499,22 @@ int igraph_betweenness_estimate(const igraph_t *graph, igraph_vector_t *res,
     IGRAPH_ERROR("betweenness failed", IGRAPH_ENOMEM);
   }
   IGRAPH_FINALLY(igraph_free, distance);
-  if (nobigint) {
-    nrgeo=igraph_Calloc(no_of_nodes, unsigned long long int);
-    if (nrgeo==0) {
-      IGRAPH_ERROR("betweenness failed", IGRAPH_ENOMEM);
-    }
-    IGRAPH_FINALLY(igraph_free, nrgeo);
-  } else {
-    /* +1 is to have one containing zeros, when we free it, we stop
-       at the zero */
-    big_nrgeo=igraph_Calloc(no_of_nodes+1, igraph_biguint_t);
-    if (!big_nrgeo) {
-      IGRAPH_ERROR("betweenness failed", IGRAPH_ENOMEM);
-    }
-    IGRAPH_FINALLY(igraph_i_destroy_biguints, big_nrgeo);
-    for (j=0; j<no_of_nodes; j++) {
-      IGRAPH_CHECK(igraph_biguint_init(&big_nrgeo[j]));
-    }
-    IGRAPH_CHECK(igraph_biguint_init(&D));
-    IGRAPH_FINALLY(igraph_biguint_destroy, &D);
-    IGRAPH_CHECK(igraph_biguint_init(&R));
-    IGRAPH_FINALLY(igraph_biguint_destroy, &R);
-    IGRAPH_CHECK(igraph_biguint_init(&T));
-    IGRAPH_FINALLY(igraph_biguint_destroy, &T);
+  /* +1 is to have one containing zeros, when we free it, we stop
+     at the zero */
+  big_nrgeo=igraph_Calloc(no_of_nodes+1, igraph_biguint_t);
+  if (!big_nrgeo) {
+    IGRAPH_ERROR("betweenness failed", IGRAPH_ENOMEM);
   }
+  IGRAPH_FINALLY(igraph_i_destroy_biguints, big_nrgeo);
+  for (j=0; j<no_of_nodes; j++) {
+    IGRAPH_CHECK(igraph_biguint_init(&big_nrgeo[j]));
+  }
+  IGRAPH_CHECK(igraph_biguint_init(&D));
+  IGRAPH_FINALLY(igraph_biguint_destroy, &D);
+  IGRAPH_CHECK(igraph_biguint_init(&R));
+  IGRAPH_FINALLY(igraph_biguint_destroy, &R);
+  IGRAPH_CHECK(igraph_biguint_init(&T));
+  IGRAPH_FINALLY(igraph_biguint_destroy, &T);
   tmpscore=igraph_Calloc(no_of_nodes, double);
   if (tmpscore==0) {
     IGRAPH_ERROR("betweenness failed", IGRAPH_ENOMEM);
@@ -1895,11 +3532,7 @@ int igraph_betweenness_estimate(const igraph_t *graph, igraph_vector_t *res,
     IGRAPH_ALLOW_INTERRUPTION();
 
     IGRAPH_CHECK(igraph_dqueue_push(&q, source));
-    if (nobigint) { 
-      nrgeo[source]=1;
-    } else {
-      igraph_biguint_set_limb(&big_nrgeo[source], 1);
-    }
+    igraph_biguint_set_limb(&big_nrgeo[source], 1);
     distance[source]=1;
     
     while (!igraph_dqueue_empty(&q)) {
@@ -1920,13 +3553,9 @@ int igraph_betweenness_estimate(const igraph_t *graph, igraph_vector_t *res,
 	  igraph_vector_int_t *v=igraph_adjlist_get(adjlist_in_p, 
 						    neighbor);
 	  igraph_vector_int_push_back(v, actnode);
-	  if (nobigint) { 
-	    nrgeo[neighbor]+=nrgeo[actnode];
-	  } else {
-	    IGRAPH_CHECK(igraph_biguint_add(&big_nrgeo[neighbor],
-					    &big_nrgeo[neighbor], 
-					    &big_nrgeo[actnode]));
-	  }
+	  IGRAPH_CHECK(igraph_biguint_add(&big_nrgeo[neighbor],
+					  &big_nrgeo[neighbor], 
+					  &big_nrgeo[actnode]));
 	}
       }
     } /* while !igraph_dqueue_empty */
@@ -1940,32 +3569,23 @@ int igraph_betweenness_estimate(const igraph_t *graph, igraph_vector_t *res,
       nneis = igraph_vector_int_size(neis);
       for (j=0; j<nneis; j++) {
         long int neighbor=(long int) VECTOR(*neis)[j];
-	if (nobigint) {
-	  tmpscore[neighbor] +=  (tmpscore[actnode]+1)*
-	    ((double)(nrgeo[neighbor]))/nrgeo[actnode];
+	if (!igraph_biguint_compare_limb(&big_nrgeo[actnode], 0)) {
+	  tmpscore[neighbor] = IGRAPH_INFINITY;
 	} else {
-	  if (!igraph_biguint_compare_limb(&big_nrgeo[actnode], 0)) {
-	    tmpscore[neighbor] = IGRAPH_INFINITY;
-	  } else {
-	    double div;
-	    limb_t shift=1000000000L;
-	    IGRAPH_CHECK(igraph_biguint_mul_limb(&T, &big_nrgeo[neighbor], 
-						 shift));	  
-	    igraph_biguint_div(&D, &R, &T, &big_nrgeo[actnode]);
-	    div=igraph_biguint_get(&D) / shift;
-	    tmpscore[neighbor] += (tmpscore[actnode]+1) * div;
-	  }
+	  double div;
+	  limb_t shift=1000000000L;
+	  IGRAPH_CHECK(igraph_biguint_mul_limb(&T, &big_nrgeo[neighbor], 
+					       shift));	  
+	  igraph_biguint_div(&D, &R, &T, &big_nrgeo[actnode]);
+	  div=igraph_biguint_get(&D) / shift;
+	  tmpscore[neighbor] += (tmpscore[actnode]+1) * div;
 	}
       }
       
       if (actnode != source) { VECTOR(*tmpres)[actnode] += tmpscore[actnode]; }
 
       distance[actnode]=0;
-      if (nobigint) { 
-	nrgeo[actnode]=0;
-      } else {
-	igraph_biguint_set_limb(&big_nrgeo[actnode], 0);
-      }
+      igraph_biguint_set_limb(&big_nrgeo[actnode], 0);
       tmpscore[actnode]=0;
       igraph_vector_int_clear(igraph_adjlist_get(adjlist_in_p, actnode));
     }
@@ -1976,15 +3596,11 @@ int igraph_betweenness_estimate(const igraph_t *graph, igraph_vector_t *res,
 
   /* clean  */
   igraph_Free(distance);
-  if (nobigint) {
-    igraph_Free(nrgeo); 
-  } else {
-    igraph_biguint_destroy(&T);
-    igraph_biguint_destroy(&R);
-    igraph_biguint_destroy(&D);
-    IGRAPH_FINALLY_CLEAN(3);
-    igraph_i_destroy_biguints(big_nrgeo);
-  }
+  igraph_biguint_destroy(&T);
+  igraph_biguint_destroy(&R);
+  igraph_biguint_destroy(&D);
+  IGRAPH_FINALLY_CLEAN(3);
+  igraph_i_destroy_biguints(big_nrgeo);
   igraph_Free(tmpscore);
   
   igraph_dqueue_destroy(&q);
@@ -2023,153 +3639,337 @@ int igraph_betweenness_estimate(const igraph_t *graph, igraph_vector_t *res,
   return 0;
 }
 
-int igraph_i_edge_betweenness_estimate_weighted(const igraph_t *graph, 
-					      igraph_vector_t *result,
-					      igraph_bool_t directed, 
-					      igraph_real_t cutoff,
-					      const igraph_vector_t *weights) {
-  igraph_integer_t no_of_nodes=(igraph_integer_t) igraph_vcount(graph);
-  igraph_integer_t no_of_edges=(igraph_integer_t) igraph_ecount(graph);
-  igraph_2wheap_t Q;
-  igraph_inclist_t inclist;
-  igraph_inclist_t fathers;
-  igraph_neimode_t mode= directed ? IGRAPH_OUT : IGRAPH_ALL;
-  igraph_vector_t distance, tmpscore;
-  igraph_vector_long_t nrgeo;
-  long int source, j;
-  igraph_stack_t S;
+/* An upper bound on the vertex diameter, the largest number of
+   vertices on a shortest path. For undirected unweighted graphs the
+   eccentricity of any vertex is at least half of the diameter of its
+   component; otherwise we use the size of the largest weakly
+   connected component. */
 
-  if (igraph_vector_size(weights) != no_of_edges) {
-    IGRAPH_ERROR("Weight vector length does not match", IGRAPH_EINVAL);
+static int igraph_i_betweenness_vertex_diameter(igraph_i_betweenness_data_t *data,
+						long int *vd) {
+  const igraph_t *graph=data->graph;
+  long int no_of_nodes=igraph_vcount(graph);
+  long int i, k;
+
+  *vd=0;
+
+  if (data->directed || data->weights) {
+    igraph_vector_t membership, csize;
+    igraph_integer_t no;
+    IGRAPH_VECTOR_INIT_FINALLY(&membership, 0);
+    IGRAPH_VECTOR_INIT_FINALLY(&csize, 0);
+    IGRAPH_CHECK(igraph_clusters(graph, &membership, &csize, &no, 
+				 IGRAPH_WEAK));
+    if (no > 0) { *vd=(long int) igraph_vector_max(&csize); }
+    igraph_vector_destroy(&csize);
+    igraph_vector_destroy(&membership);
+    IGRAPH_FINALLY_CLEAN(2);
+  } else {
+    igraph_i_betweenness_ws_t *ws=&data->ws[0];
+    char *seen=igraph_Calloc(no_of_nodes > 0 ? no_of_nodes : 1, char);
+    if (!seen) {
+      IGRAPH_ERROR("Cannot estimate vertex diameter", IGRAPH_ENOMEM);
+    }
+    IGRAPH_FINALLY(igraph_free, seen);
+    for (i=0; i<no_of_nodes; i++) {
+      long int tail, ecc=0;
+      if (seen[i]) { continue; }
+      IGRAPH_ALLOW_INTERRUPTION();
+      tail=igraph_i_betweenness_forward(data, ws, i, /*target=*/ -1);
+      for (k=0; k<tail; k++) {
+	long int v=ws->order[k];
+	if (ws->dist[v]-1 > ecc) { ecc=ws->dist[v]-1; }
+	seen[v]=1;
+	ws->dist[v]=0;
+	ws->nrgeo[v]=0;
+      }
+      if (2*ecc+1 > *vd) { *vd=2*ecc+1; }
+    }
+    igraph_Free(seen);
+    IGRAPH_FINALLY_CLEAN(1);
   }
-  if (igraph_vector_min(weights) < 0) {
-    IGRAPH_ERROR("Weight vector must be non-negative", IGRAPH_EINVAL);
+
+  return 0;
+}
+
+/* One random number generator per thread */
+
+typedef struct igraph_i_rngs_t {
+  igraph_rng_t *rngs;
+  long int n;
+} igraph_i_rngs_t;
+
+static void igraph_i_rngs_destroy(igraph_i_rngs_t *rngs) {
+  long int i;
+  for (i=0; i<rngs->n; i++) {
+    igraph_rng_destroy(&rngs->rngs[i]);
   }
-  
-  IGRAPH_CHECK(igraph_inclist_init(graph, &inclist, mode));
-  IGRAPH_FINALLY(igraph_inclist_destroy, &inclist);
-  IGRAPH_CHECK(igraph_inclist_init_empty(&fathers, no_of_nodes));
-  IGRAPH_FINALLY(igraph_inclist_destroy, &fathers);
+  igraph_Free(rngs->rngs);
+}
 
-  IGRAPH_VECTOR_INIT_FINALLY(&distance, no_of_nodes);
-  IGRAPH_VECTOR_INIT_FINALLY(&tmpscore, no_of_nodes);
-  IGRAPH_CHECK(igraph_vector_long_init(&nrgeo, no_of_nodes));
-  IGRAPH_FINALLY(igraph_vector_long_destroy, &nrgeo);
+static int igraph_i_rngs_init(igraph_i_rngs_t *rngs, long int n) {
+  rngs->n=0;
+  rngs->rngs=igraph_Calloc(n, igraph_rng_t);
+  if (!rngs->rngs) {
+    IGRAPH_ERROR("Cannot create random number generators", IGRAPH_ENOMEM);
+  }
+  IGRAPH_FINALLY(igraph_i_rngs_destroy, rngs);
+  for (; rngs->n<n; rngs->n++) {
+    IGRAPH_CHECK(igraph_rng_init(&rngs->rngs[rngs->n], &igraph_rngtype_mt19937));
+  }
+  IGRAPH_FINALLY_CLEAN(1);
+  return 0;
+}
 
-  IGRAPH_CHECK(igraph_2wheap_init(&Q, no_of_nodes));
-  IGRAPH_FINALLY(igraph_2wheap_destroy, &Q);
-  IGRAPH_CHECK(igraph_stack_init(&S, no_of_nodes));
-  IGRAPH_FINALLY(igraph_stack_destroy, &S);
+/* Picks a shortest path from 'source' to 'target' uniformly at random,
+   after the forward search, and adds one to the score of its inner
+   vertices. */
+
+static void igraph_i_betweenness_sample_path(const igraph_i_betweenness_data_t *data,
+					     igraph_i_betweenness_ws_t *ws,
+					     igraph_rng_t *rng,
+					     long int source, long int target) {
+  long int w=target, j;
+
+  while (w != source) {
+    long int pick=-1;
+    if (!data->weights) {
+      int *neis=igraph_csr_neighbors(data->in, w);
+      long int nneis=igraph_csr_degree(data->in, w);
+      igraph_real_t u=igraph_rng_get_unif01(rng) * ws->nrgeo[w], sum=0.0;
+      for (j=0; j<nneis; j++) {
+	long int f=neis[j];
+	if (ws->dist[f] == ws->dist[w]-1) {
+	  pick=f;
+	  sum += ws->nrgeo[f];
+	  if (u < sum) { break; }
+	}
+      }
+    } else {
+      int *fatv=ws->fathers+VECTOR(data->in->start)[w];
+      long int fatv_len=ws->nfathers[w];
+      igraph_real_t u=igraph_rng_get_unif01(rng) * ws->wnrgeo[w], sum=0.0;
+      for (j=0; j<fatv_len; j++) {
+	long int f=IGRAPH_OTHER(data->graph, fatv[j], w);
+	pick=f;
+	sum += ws->wnrgeo[f];
+	if (u < sum) { break; }
+      }
+    }
+    w=pick;
+    if (w != source) { ws->score[w] += 1; }
+  }
+}
 
-  IGRAPH_CHECK(igraph_vector_resize(result, no_of_edges));
-  igraph_vector_null(result);
+/**
+ * \function igraph_betweenness_approx
+ * \brief Approximate betweenness centrality with an error bound.
+ * 
+ * </para><para>
+ * This function estimates the betweenness of the vertices by sampling
+ * shortest paths: it picks random ordered pairs of distinct vertices,
+ * and a random shortest path between them, uniformly among all
+ * shortest paths, and counts how many times each vertex is an inner
+ * vertex of the sampled paths. The number of samples depends only on
+ * \p epsilon, \p delta and (an upper bound of) the largest number of
+ * vertices on a shortest path, see Matteo Riondato and Evgenios M.
+ * Kornaropoulos: Fast approximation of betweenness centrality
+ * through sampling, WSDM 2014. Unlike the cutoff of \ref
+ * igraph_betweenness_estimate(), this does not bias the result.
+ *
+ * </para><para>
+ * With probability at least 1-\p delta, the error of the returned
+ * score is at most \p epsilon times the number of vertex pairs,
+ * i.e. |V|(|V|-1) for directed, |V|(|V|-1)/2 for undirected paths,
+ * for all vertices at the same time.
+ *
+ * </para><para>
+ * The samples are distributed among the OpenMP threads, if igraph was
+ * compiled with OpenMP support. Every sample uses its own random
+ * number generator, seeded from the default igraph random number
+ * generator, so the result is the same for any number of threads.
+ *
+ * \param graph The graph object.
+ * \param res The result of the computation, a vector containing the
+ *        estimated betweenness scores for the specified vertices.
+ * \param vids The vertices of which the betweenness centrality scores
+ *        will be estimated.
+ * \param directed Logical, if true directed paths will be considered
+ *        for directed graphs. It is ignored for undirected graphs.
+ * \param weights An optional vector containing positive edge weights
+ *        for calculating weighted betweenness. Supply a null pointer
+ *        here for unweighted betweenness.
+ * \param epsilon The maximum error, relative to the number of vertex
+ *        pairs, it must be between zero and one.
+ * \param delta The probability of a larger error, it must be between
+ *        zero and one.
+ * \param samples If not a null pointer, the number of sampled paths
+ *        is stored here.
+ * \return Error code:
+ *        \c IGRAPH_ENOMEM, not enough memory for
+ *        temporary data. 
+ *        \c IGRAPH_EINVVID, invalid vertex id passed in
+ *        \p vids. 
+ *        \c IGRAPH_EINVAL, invalid \p epsilon, \p delta or weights.
+ *
+ * Time complexity: O(r(|V|+|E|)) for unweighted, O(r(|V|log|V|+|E|))
+ * for weighted graphs, where r=(log(VD)+log(1/delta))/epsilon^2 is the
+ * number of samples, and VD is the number of vertices on the longest
+ * shortest path. In practice the searches stop at the target vertex
+ * of the sampled pair, and they are much faster.
+ *
+ * \sa \ref igraph_betweenness() for the exact scores.
+ *
+ * \example examples/simple/igraph_betweenness_approx.c
+ */
 
-  for (source=0; source<no_of_nodes; source++) {
-    IGRAPH_PROGRESS("Edge betweenness centrality: ", 100.0*source/no_of_nodes, 0);
-    IGRAPH_ALLOW_INTERRUPTION();
+int igraph_betweenness_approx(const igraph_t *graph, igraph_vector_t *res,
+			      const igraph_vs_t vids, igraph_bool_t directed,
+			      const igraph_vector_t *weights,
+			      igraph_real_t epsilon, igraph_real_t delta,
+			      igraph_integer_t *samples) {
 
-/*     printf("source: %li\n", source); */
-    
-    igraph_vector_null(&distance);
-    igraph_vector_null(&tmpscore);
-    igraph_vector_long_null(&nrgeo);
-    
-    igraph_2wheap_push_with_index(&Q, source, 0);
-    VECTOR(distance)[source]=1.0;
-    VECTOR(nrgeo)[source]=1;
-    
-    while (!igraph_2wheap_empty(&Q)) {
-      long int minnei=igraph_2wheap_max_index(&Q);
-      igraph_real_t mindist=-igraph_2wheap_delete_max(&Q);
-      igraph_vector_int_t *neis;
-      long int nlen;
+  long int no_of_nodes=igraph_vcount(graph);
+  long int no_of_edges=igraph_ecount(graph);
+  long int nthreads=IGRAPH_I_MAX_THREADS();
+  long int used_threads=1, t, i, vd, no_samples=0;
+  unsigned long int seed=0;
+  volatile int interrupted=0;
+  igraph_i_betweenness_data_t data;
+  igraph_i_rngs_t rngs;
+  igraph_vector_t v_tmpres, *tmpres=&v_tmpres;
+  igraph_vit_t vit;
+  igraph_real_t scale;
 
-/*       printf("SP to %li is final, dist: %g, nrgeo: %li\n", minnei, */
-/* 	     VECTOR(distance)[minnei]-1.0, VECTOR(nrgeo)[minnei]); */
-      
-      igraph_stack_push(&S, minnei);
+  if (epsilon <= 0 || epsilon >= 1) {
+    IGRAPH_ERROR("`epsilon' must be between zero and one", IGRAPH_EINVAL);
+  }
+  if (delta <= 0 || delta >= 1) {
+    IGRAPH_ERROR("`delta' must be between zero and one", IGRAPH_EINVAL);
+  }
+  if (weights) {
+    if (igraph_vector_size(weights) != no_of_edges) {
+      IGRAPH_ERROR("Weight vector length does not match", IGRAPH_EINVAL);
+    }
+    if (no_of_edges > 0 && igraph_vector_min(weights) <= 0) {
+      IGRAPH_ERROR("Weight vector must be positive", IGRAPH_EINVAL);
+    }
+  }
 
-      if (cutoff >=0 && VECTOR(distance)[minnei] >= cutoff+1.0) { continue; }
+  directed=directed && igraph_is_directed(graph);
+  if (nthreads < 1) { nthreads=1; }
+
+  IGRAPH_CHECK(igraph_i_betweenness_data_init(&data, graph, directed, 
+					      /*cutoff=*/ -1, weights, 
+					      /*edges=*/ 0, nthreads));
+  IGRAPH_FINALLY(igraph_i_betweenness_data_destroy, &data);
+
+  IGRAPH_CHECK(igraph_i_rngs_init(&rngs, nthreads));
+  IGRAPH_FINALLY(igraph_i_rngs_destroy, &rngs);
+
+  /* The number of samples needed, c=0.5 is the constant from the
+     paper. If there are no paths with inner vertices, then all
+     scores are zero. */
+  IGRAPH_CHECK(igraph_i_betweenness_vertex_diameter(&data, &vd));
+  if (vd > 2) {
+    no_samples=(long int) ceil(0.5 / epsilon / epsilon *
+			       (floor(log(vd-2.0)/log(2.0)) + 1 + log(1/delta)));
+    RNG_BEGIN();
+    seed=(unsigned long int) RNG_INTEGER(0, 2147483646L);
+    RNG_END();
+  }
 
-      neis=igraph_inclist_get(&inclist, minnei);
-      nlen=igraph_vector_int_size(neis);
-      for (j=0; j<nlen; j++) {
-	long int edge=(long int) VECTOR(*neis)[j];
-	long int to=IGRAPH_OTHER(graph, edge, minnei);
-	igraph_real_t altdist=mindist + VECTOR(*weights)[edge];
-	igraph_real_t curdist=VECTOR(distance)[to];
-	
-	if (curdist==0) {
-	  /* This is the first finite distance to 'to' */
-	  igraph_vector_int_t *v=igraph_inclist_get(&fathers, to);
-/* 	  printf("Found first path to %li (from %li)\n", to, minnei); */
-	  igraph_vector_int_resize(v,1);
-	  VECTOR(*v)[0]=edge;
-	  VECTOR(nrgeo)[to] = VECTOR(nrgeo)[minnei];
-	  VECTOR(distance)[to]=altdist+1.0;
-	  IGRAPH_CHECK(igraph_2wheap_push_with_index(&Q, to, -altdist));
-	} else if (altdist < curdist-1) {
-	  /* This is a shorter path */
-	  igraph_vector_int_t *v =igraph_inclist_get(&fathers, to);
-/* 	  printf("Found a shorter path to %li (from %li)\n", to, minnei); */
-	  igraph_vector_int_resize(v,1);
-	  VECTOR(*v)[0]=edge;
-	  VECTOR(nrgeo)[to] = VECTOR(nrgeo)[minnei];
-	  VECTOR(distance)[to] = altdist+1.0;
-	  IGRAPH_CHECK(igraph_2wheap_modify(&Q, to, -altdist));
-	} else if (altdist == curdist-1) {
-	  igraph_vector_int_t *v=igraph_inclist_get(&fathers, to);
-/* 	  printf("Found a second SP to %li (from %li)\n", to, minnei); */
-	  igraph_vector_int_push_back(v, edge);
-	  VECTOR(nrgeo)[to] += VECTOR(nrgeo)[minnei];
-	}
+#pragma omp parallel num_threads((int) nthreads)
+  {
+    long int tid=IGRAPH_I_THREAD_NUM(), nt=IGRAPH_I_NUM_THREADS();
+    long int begin=IGRAPH_I_THREAD_BEGIN(no_samples, tid, nt);
+    long int end=IGRAPH_I_THREAD_END(no_samples, tid, nt);
+    long int sample, k, reached, source, target;
+    igraph_i_betweenness_ws_t *ws=&data.ws[tid];
+    igraph_rng_t *rng=&rngs.rngs[tid];
+
+    if (tid==0) { used_threads=nt; }
+
+    for (sample=begin; sample<end && !interrupted; sample++) {
+      if (tid==0 && sample % 64 == 0) {
+	IGRAPH_I_ALLOW_INTERRUPTION_PARALLEL(interrupted);
       }
-	  
-    } /* igraph_2wheap_empty(&Q) */
-
-    while (!igraph_stack_empty(&S)) {
-      long int w=(long int) igraph_stack_pop(&S);
-      igraph_vector_int_t *fatv=igraph_inclist_get(&fathers, w);
-      long int fatv_len=igraph_vector_int_size(fatv);
-/*       printf("Popping %li.\n", w); */
-      for (j=0; j<fatv_len; j++) {
-	long int fedge=(long int) VECTOR(*fatv)[j];
-	long int neighbor=IGRAPH_OTHER(graph, fedge, w);
-	VECTOR(tmpscore)[neighbor] += ((double)VECTOR(nrgeo)[neighbor]) /
-	  VECTOR(nrgeo)[w] * (1.0+VECTOR(tmpscore)[w]);
-/* 	printf("Scoring %li (edge %li)\n", neighbor, fedge); */
-	VECTOR(*result)[fedge] += 
-	  ((VECTOR(tmpscore)[w]+1) * VECTOR(nrgeo)[neighbor]) / 
-	  VECTOR(nrgeo)[w];
+      igraph_rng_seed(rng, seed + (unsigned long int) sample);
+      source=igraph_rng_get_integer(rng, 0, no_of_nodes-1);
+      target=igraph_rng_get_integer(rng, 0, no_of_nodes-2);
+      if (target >= source) { target++; }
+      if (weights) {
+	reached=igraph_i_betweenness_forward_weighted(&data, ws, source, 
+						      target);
+	if (ws->wdist[target] != 0) {
+	  igraph_i_betweenness_sample_path(&data, ws, rng, source, target);
+	}
+	for (k=0; k<reached; k++) {
+	  long int v=ws->order[k];
+	  ws->wdist[v]=0;
+	  ws->wnrgeo[v]=0;
+	  ws->nfathers[v]=0;
+	}
+      } else {
+	reached=igraph_i_betweenness_forward(&data, ws, source, target);
+	if (ws->dist[target] != 0) {
+	  igraph_i_betweenness_sample_path(&data, ws, rng, source, target);
+	}
+	for (k=0; k<reached; k++) {
+	  long int v=ws->order[k];
+	  ws->dist[v]=0;
+	  ws->nrgeo[v]=0;
+	}
       }
-      
-      VECTOR(tmpscore)[w]=0;
-      VECTOR(distance)[w]=0;
-      VECTOR(nrgeo)[w]=0;
-      igraph_vector_int_clear(fatv);
     }
-    
-  } /* source < no_of_nodes */
+  }
 
-  if (!directed || !igraph_is_directed(graph)) {
-    for (j=0; j<no_of_edges; j++) {
-      VECTOR(*result)[j] /= 2.0;
+  if (interrupted) {
+    IGRAPH_FINALLY_FREE();
+    return IGRAPH_INTERRUPTED;
+  }
+
+  if (igraph_vs_is_all(&vids)) {
+    IGRAPH_CHECK(igraph_vector_resize(res, no_of_nodes));
+    tmpres=res;
+  } else {
+    IGRAPH_VECTOR_INIT_FINALLY(tmpres, no_of_nodes);
+  }
+
+  /* The scores are counts, so the order of the summation does not
+     matter here */
+  scale= no_samples == 0 ? 0.0 : 
+    (directed ? 1.0 : 0.5) * no_of_nodes * (no_of_nodes-1.0) / no_samples;
+  for (i=0; i<no_of_nodes; i++) {
+    igraph_real_t sum=0.0;
+    for (t=0; t<used_threads; t++) {
+      sum += data.ws[t].score[i];
+    }
+    VECTOR(*tmpres)[i] = sum * scale;
+  }
+
+  if (!igraph_vs_is_all(&vids)) {
+    IGRAPH_CHECK(igraph_vit_create(graph, vids, &vit));
+    IGRAPH_FINALLY(igraph_vit_destroy, &vit);
+    IGRAPH_CHECK(igraph_vector_resize(res, IGRAPH_VIT_SIZE(vit)));
+    
+    for (i=0, IGRAPH_VIT_RESET(vit); !IGRAPH_VIT_END(vit);
+	 IGRAPH_VIT_NEXT(vit), i++) {
+      long int node=IGRAPH_VIT_GET(vit);
+      VECTOR(*res)[i] = VECTOR(*tmpres)[node];
     }
+    
+    igraph_vit_destroy(&vit);
+    igraph_vector_destroy(tmpres);
+    IGRAPH_FINALLY_CLEAN(2);
   }
 
-  IGRAPH_PROGRESS("Edge betweenness centrality: ", 100.0, 0);
+  if (samples) { *samples=(igraph_integer_t) no_samples; }
 
-  igraph_stack_destroy(&S);
-  igraph_2wheap_destroy(&Q);
+  igraph_i_rngs_destroy(&rngs);
+  igraph_i_betweenness_data_destroy(&data);
   IGRAPH_FINALLY_CLEAN(2);
-  
-  igraph_inclist_destroy(&inclist);
-  igraph_inclist_destroy(&fathers);  
-  igraph_vector_destroy(&distance);
-  igraph_vector_destroy(&tmpscore);
-  igraph_vector_long_destroy(&nrgeo);
-  IGRAPH_FINALLY_CLEAN(5);
-  
+
   return 0;
 }
 
@@ -2227,6 +4027,14 @@ int igraph_edge_betweenness(const igraph_t *graph, igraph_vector_t *result,
  * takes into consideration only those paths that are shorter than or
  * equal to a prescribed length. Note that the estimated centrality
  * will always be less than the real one.
+ * </para><para>
+ * If igraph was compiled with OpenMP support, the shortest paths
+ * from the different source vertices are explored in parallel; the
+ * number of threads can be set e.g. via the \c OMP_NUM_THREADS
+ * environment variable. The partial scores of the threads are added
+ * up in a fixed order, so the result depends only on the number of
+ * threads, not on their scheduling.
+ *
  * \param graph The graph object.
  * \param result The result of the computation, vector containing the
  *        betweenness scores for the edges.
@@ -2254,158 +4062,34 @@ int igraph_edge_betweenness(const igraph_t *graph, igraph_vector_t *result,
 int igraph_edge_betweenness_estimate(const igraph_t *graph, igraph_vector_t *result,
                                      igraph_bool_t directed, igraph_real_t cutoff,
 				     const igraph_vector_t *weights) {
-  long int no_of_nodes=igraph_vcount(graph);
   long int no_of_edges=igraph_ecount(graph);
-  igraph_dqueue_t q=IGRAPH_DQUEUE_NULL;
-  long int *distance;
-  unsigned long long int *nrgeo;
-  double *tmpscore;
-  igraph_stack_t stack=IGRAPH_STACK_NULL;
-  long int source;
   long int j;
 
-  igraph_inclist_t elist_out, elist_in;
-  igraph_inclist_t *elist_out_p, *elist_in_p;
-  igraph_vector_int_t *neip;
-  long int neino;
-  long int i;
-
-  if (weights) { 
-    return igraph_i_edge_betweenness_estimate_weighted(graph, result, 
-						     directed, cutoff, weights);
+  if (weights) {
+    if (igraph_vector_size(weights) != no_of_edges) {
+      IGRAPH_ERROR("Weight vector length does not match", IGRAPH_EINVAL);
+    }
+    if (no_of_edges > 0 && igraph_vector_min(weights) < 0) {
+      IGRAPH_ERROR("Weight vector must be non-negative", IGRAPH_EINVAL);
+    }
+  } else if (cutoff <= 0) {
+    /* no limit on the path lengths */
+    cutoff=-1;
   }
 
   directed=directed && igraph_is_directed(graph);
-  if (directed) {
-    IGRAPH_CHECK(igraph_inclist_init(graph, &elist_out, IGRAPH_OUT));
-    IGRAPH_FINALLY(igraph_inclist_destroy, &elist_out);
-    IGRAPH_CHECK(igraph_inclist_init(graph, &elist_in, IGRAPH_IN));
-    IGRAPH_FINALLY(igraph_inclist_destroy, &elist_in);
-    elist_out_p=&elist_out;
-    elist_in_p=&elist_in;
-  } else {
-    IGRAPH_CHECK(igraph_inclist_init(graph,&elist_out, IGRAPH_ALL));
-    IGRAPH_FINALLY(igraph_inclist_destroy, &elist_out);
-    elist_out_p=elist_in_p=&elist_out;
-  }
-  
-  distance=igraph_Calloc(no_of_nodes, long int);
-  if (distance==0) {
-    IGRAPH_ERROR("edge betweenness failed", IGRAPH_ENOMEM);
-  }
-  IGRAPH_FINALLY(igraph_free, distance);
-  nrgeo=igraph_Calloc(no_of_nodes, unsigned long long int);
-  if (nrgeo==0) {
-    IGRAPH_ERROR("edge betweenness failed", IGRAPH_ENOMEM);
-  }
-  IGRAPH_FINALLY(igraph_free, nrgeo);
-  tmpscore=igraph_Calloc(no_of_nodes, double);
-  if (tmpscore==0) {
-    IGRAPH_ERROR("edge betweenness failed", IGRAPH_ENOMEM);
-  }
-  IGRAPH_FINALLY(igraph_free, tmpscore);
-
-  IGRAPH_DQUEUE_INIT_FINALLY(&q, 100);
-  IGRAPH_CHECK(igraph_stack_init(&stack, no_of_nodes));
-  IGRAPH_FINALLY(igraph_stack_destroy, &stack);
 
   IGRAPH_CHECK(igraph_vector_resize(result, no_of_edges));
-
   igraph_vector_null(result);
 
-  /* here we go */
-  
-  for (source=0; source<no_of_nodes; source++) {
-    IGRAPH_PROGRESS("Edge betweenness centrality: ", 100.0*source/no_of_nodes, 0);
-    IGRAPH_ALLOW_INTERRUPTION();
-
-    memset(distance, 0, (size_t) no_of_nodes * sizeof(long int));
-    memset(nrgeo, 0, (size_t) no_of_nodes*sizeof(unsigned long long int));
-    memset(tmpscore, 0, (size_t) no_of_nodes*sizeof(double));
-    igraph_stack_clear(&stack); /* it should be empty anyway... */
-    
-    IGRAPH_CHECK(igraph_dqueue_push(&q, source));
-      
-    nrgeo[source]=1;
-    distance[source]=0;
-    
-    while (!igraph_dqueue_empty(&q)) {
-      long int actnode=(long int) igraph_dqueue_pop(&q);
-
-      /* TODO: we could just as well 'break' here, no? */
-      if (cutoff > 0 && distance[actnode] >= cutoff ) continue;
-
-      neip=igraph_inclist_get(elist_out_p, actnode);
-      neino=igraph_vector_int_size(neip);
-      for (i=0; i<neino; i++) {
-	igraph_integer_t edge=(igraph_integer_t) VECTOR(*neip)[i], from, to;
-	long int neighbor;
-	igraph_edge(graph, edge, &from, &to);
-	neighbor = actnode!=from ? from : to;
-	if (nrgeo[neighbor] != 0) {
-	  /* we've already seen this node, another shortest path? */
-	  if (distance[neighbor]==distance[actnode]+1) {
-	    nrgeo[neighbor]+=nrgeo[actnode];
-	  }
-	} else {
-	  /* we haven't seen this node yet */
-	  nrgeo[neighbor]+=nrgeo[actnode];
-	  distance[neighbor]=distance[actnode]+1;
-	  IGRAPH_CHECK(igraph_dqueue_push(&q, neighbor));
-	  IGRAPH_CHECK(igraph_stack_push(&stack, neighbor));
-	}
-      }
-    } /* while !igraph_dqueue_empty */
-    
-    /* Ok, we've the distance of each node and also the number of
-       shortest paths to them. Now we do an inverse search, starting
-       with the farthest nodes. */
-    while (!igraph_stack_empty(&stack)) {
-      long int actnode=(long int) igraph_stack_pop(&stack);
-      if (distance[actnode]<1) { continue; } /* skip source node */
-      
-      /* set the temporary score of the friends */
-      neip=igraph_inclist_get(elist_in_p, actnode);
-      neino=igraph_vector_int_size(neip);
-      for (i=0; i<neino; i++) {
-	igraph_integer_t from, to;
-	long int neighbor;
-	igraph_integer_t edgeno=(igraph_integer_t) VECTOR(*neip)[i];
-	igraph_edge(graph, edgeno, &from, &to);
-	neighbor= actnode != from ? from : to;
-	if (distance[neighbor]==distance[actnode]-1 &&
-	    nrgeo[neighbor] != 0) {
-	  tmpscore[neighbor] +=
-	    (tmpscore[actnode]+1)*nrgeo[neighbor]/nrgeo[actnode];
-	  VECTOR(*result)[edgeno] +=
-	    (tmpscore[actnode]+1)*nrgeo[neighbor]/nrgeo[actnode];
-	}
-      }
-    }
-    /* Ok, we've the scores for this source */
-  } /* for source <= no_of_nodes */
-  IGRAPH_PROGRESS("Edge betweenness centrality: ", 100.0, 0);
-
-  /* clean and return */
-  igraph_Free(distance);
-  igraph_Free(nrgeo);
-  igraph_Free(tmpscore);
-  igraph_dqueue_destroy(&q);
-  igraph_stack_destroy(&stack);
-  IGRAPH_FINALLY_CLEAN(5);
-
-  if (directed) {
-    igraph_inclist_destroy(&elist_out);
-    igraph_inclist_destroy(&elist_in);
-    IGRAPH_FINALLY_CLEAN(2);
-  } else {
-    igraph_inclist_destroy(&elist_out);
-    IGRAPH_FINALLY_CLEAN(1);
-  }
+  IGRAPH_CHECK(igraph_i_betweenness_brandes(graph, VECTOR(*result), 
+					    /*edges=*/ 1, directed, cutoff,
+					    weights, 
+					    "Edge betweenness centrality: "));
 
   /* divide by 2 for undirected graph */
-  if (!directed || !igraph_is_directed(graph)) {
-    for (j=0; j<igraph_vector_size(result); j++) {
+  if (!directed) {
+    for (j=0; j<no_of_edges; j++) {
       VECTOR(*result)[j] /= 2.0;
     }
   }
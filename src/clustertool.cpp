@@ -61,6 +61,7 @@
 #include "igraph_interface.h"
 #include "igraph_components.h"
 #include "igraph_interrupt_internal.h"
+#include "igraph_parallel_internal.h"
 
 int igraph_i_community_spinglass_orig(const igraph_t *graph,
 				      const igraph_vector_t *weights,
@@ -364,6 +365,311 @@ int igraph_i_community_spinglass_orig(const igraph_t *graph,
   return 0;
 }
 
+/* Everything that belongs to the replicas, so that it can be freed
+   on every exit path, including errors and interruptions. The arrays
+   are zeroed first, and only the generators that were initialized
+   are destroyed. */
+
+typedef struct igraph_i_spinglass_replicas_t {
+  long int replicas, nrngs;
+  network **nets;
+  PottsModel **pms;
+  igraph_rng_t *rngs;
+  double *temps, *energy;
+  long int *replica_at;
+  unsigned int *bestspins;
+  igraph_bool_t rng_begun;
+} igraph_i_spinglass_replicas_t;
+
+static void igraph_i_spinglass_replicas_destroy(igraph_i_spinglass_replicas_t *data) {
+  long int r;
+  if (data->rng_begun) {
+    RNG_END();
+    data->rng_begun=0;
+  }
+  for (r=0; r<data->replicas; r++) {
+    network *net=data->nets[r];
+    if (!net) { continue; }
+    if (net->link_list) {
+      while (net->link_list->Size()) delete net->link_list->Pop();
+    }
+    if (net->node_list) {
+      while (net->node_list->Size()) delete net->node_list->Pop();
+    }
+    if (net->cluster_list) {
+      while (net->cluster_list->Size())
+	{
+	  ClusterList<NNode*> *cl_cur=net->cluster_list->Pop();
+	  while (cl_cur->Size()) cl_cur->Pop();
+	  delete cl_cur;
+	}
+    }
+    delete net->link_list;
+    delete net->node_list;
+    delete net->cluster_list;
+    delete net;
+    delete data->pms[r];
+  }
+  for (r=0; r<data->nrngs; r++) {
+    igraph_rng_destroy(&data->rngs[r]);
+  }
+  delete [] data->nets;
+  delete [] data->pms;
+  delete [] data->rngs;
+  delete [] data->temps;
+  delete [] data->energy;
+  delete [] data->replica_at;
+  delete [] data->bestspins;
+}
+
+/**
+ * \function igraph_community_spinglass_replicas
+ * \brief Spinglass community detection with parallel tempering
+ * 
+ * This is a variant of the original implementation of \ref
+ * igraph_community_spinglass(), that, instead of a single simulated
+ * annealing run, simulates several copies (replicas) of the spin
+ * system at different temperatures, and regularly tries to exchange
+ * the configurations of replicas at neighboring temperatures,
+ * see E. Marinari and G. Parisi: Simulated tempering: a new Monte
+ * Carlo scheme, Europhys. Lett. 19, 451 (1992), and K. Hukushima and
+ * K. Nemoto: Exchange Monte Carlo method and application to spin
+ * glass simulations, J. Phys. Soc. Jpn. 65, 1604 (1996).
+ * 
+ * </para><para>The replicas are simulated in parallel threads, if
+ * igraph was compiled with OpenMP support. Each replica has its own
+ * random number generator, seeded from the default one, so the result
+ * does not depend on the number of threads. Note that this function
+ * needs memory for \p replicas copies of the graph.
+ * 
+ * </para><para>The temperatures form a geometric series from the
+ * highest one, which is chosen like the starting temperature of the
+ * simulated annealing, to \p stoptemp. In every round each replica
+ * performs 50 heat bath sweeps at its temperature, then exchanges are
+ * attempted between the pairs of replicas at neighboring
+ * temperatures. The configuration with the highest generalized
+ * modularity seen at the end of any round is returned.
+ * \param graph The input graph, it may be directed but the direction
+ *     of the edge is not used in the algorithm. It must be connected.
+ * \param weights The vector giving the edge weights, it may be \c NULL, 
+ *     in which case all edges are weighted equally. Edge weights
+ *     should be positive.
+ * \param modularity Pointer to a real number, if not \c NULL then the
+ *     modularity score of the solution will be stored here, see
+ *     \ref igraph_community_spinglass().
+ * \param temperature Pointer to a real number, if not \c NULL then
+ *     the temperature of the replica that found the solution will be
+ *     stored here.
+ * \param membership Pointer to an initialized vector or \c NULL. If
+ *     not \c NULL then the result of the clustering will be stored
+ *     here, for each vertex the number of its cluster is given, the 
+ *     first cluster is numbered zero. The vector will be resized as
+ *     needed. 
+ * \param csize Pointer to an initialized vector or \c NULL. If not \c
+ *     NULL then the sizes of the clusters will stored here in cluster
+ *     number order. The vector will be resized as needed.
+ * \param spins Integer giving the number of spins, ie. the maximum
+ *     number of clusters.
+ * \param starttemp Real number, the temperature from which the search
+ *     for the highest temperature starts, see the same argument of
+ *     \ref igraph_community_spinglass().
+ * \param stoptemp Real number, the lowest temperature, it must be
+ *     positive.
+ * \param update_rule The type of the update rule, see \ref
+ *     igraph_community_spinglass().
+ * \param gamma Real number, the gamma parameter of the algorithm, see
+ *     \ref igraph_community_spinglass().
+ * \param replicas Integer, the number of replicas, at least two.
+ * \param rounds Integer, the number of rounds, i.e. the number of
+ *     replica exchanges.
+ * \return Error code.
+ * 
+ * Time complexity: O(r*R*(n*s+m)), r is the number of rounds, R
+ * the number of replicas, s the number of spins, n the number of
+ * vertices and m the number of edges.
+ */
+
+int igraph_community_spinglass_replicas(const igraph_t *graph,
+					const igraph_vector_t *weights,
+					igraph_real_t *modularity,
+					igraph_real_t *temperature,
+					igraph_vector_t *membership, 
+					igraph_vector_t *csize, 
+					igraph_integer_t spins,
+					igraph_real_t starttemp,
+					igraph_real_t stoptemp,
+					igraph_spincomm_update_t update_rule,
+					igraph_real_t gamma,
+					igraph_integer_t replicas,
+					igraph_integer_t rounds) {
+
+  igraph_bool_t use_weights=0;
+  double prob, besttemp=0.0, bestQ=0.0;
+  long int no_of_nodes=igraph_vcount(graph);
+  long int r, t, round, nthreads;
+  igraph_i_spinglass_replicas_t data;
+  network **nets;
+  PottsModel **pms;
+  igraph_rng_t *rngs;
+  double *temps, *energy;
+  long int *replica_at;
+  unsigned int *bestspins;
+  DLList_Iter<NNode*> iter;
+  NNode *n_cur;
+  long int i;
+
+  /* Check arguments */
+
+  if (spins < 2 || spins > 500) {
+    IGRAPH_ERROR("Invalid number of spins", IGRAPH_EINVAL);
+  }
+  if (update_rule != IGRAPH_SPINCOMM_UPDATE_SIMPLE &&
+      update_rule != IGRAPH_SPINCOMM_UPDATE_CONFIG) {
+    IGRAPH_ERROR("Invalid update rule", IGRAPH_EINVAL);
+  }
+  if (weights) {
+    if (igraph_vector_size(weights) != igraph_ecount(graph)) {
+      IGRAPH_ERROR("Invalid weight vector length", IGRAPH_EINVAL);
+    }
+    use_weights=1;
+  }
+  if (gamma < 0.0) {
+    IGRAPH_ERROR("Invalid gamma value", IGRAPH_EINVAL);
+  }
+  if (stoptemp <= 0.0 || starttemp < stoptemp) {
+    IGRAPH_ERROR("stoptemp should be positive and not larger than starttemp",
+		 IGRAPH_EINVAL);
+  }
+  if (replicas < 2) {
+    IGRAPH_ERROR("At least two replicas are needed", IGRAPH_EINVAL);
+  }
+  if (rounds < 1) {
+    IGRAPH_ERROR("Invalid number of rounds", IGRAPH_EINVAL);
+  }
+  
+  /* Check whether we have a single component */
+  igraph_bool_t conn;
+  IGRAPH_CHECK(igraph_is_connected(graph, &conn, IGRAPH_WEAK));
+  if (!conn) {
+    IGRAPH_ERROR("Cannot work with unconnected graph", IGRAPH_EINVAL);
+  }
+
+  /* Every replica needs its own network, as the spins are stored in
+     the nodes */
+  data.replicas=replicas;
+  data.nrngs=0;
+  data.rng_begun=0;
+  data.nets=nets=new network*[replicas]();
+  data.pms=pms=new PottsModel*[replicas]();
+  data.rngs=rngs=new igraph_rng_t[replicas];
+  data.temps=temps=new double[replicas];
+  data.energy=energy=new double[replicas];
+  data.replica_at=replica_at=new long int[replicas];
+  data.bestspins=bestspins=new unsigned int[no_of_nodes];
+  IGRAPH_FINALLY(igraph_i_spinglass_replicas_destroy, &data);
+  for (r=0; r<replicas; r++) {
+    nets[r] = new network();
+    nets[r]->node_list   =new DL_Indexed_List<NNode*>();
+    nets[r]->link_list   =new DL_Indexed_List<NLink*>();
+    nets[r]->cluster_list=new DL_Indexed_List<ClusterList<NNode*>*>();
+    IGRAPH_CHECK(igraph_i_read_network(graph, weights,
+				       nets[r], use_weights, 0));
+    pms[r]=new PottsModel(nets[r],(unsigned int)spins,update_rule);
+  }
+
+  prob=2.0*nets[0]->sum_weights/double(nets[0]->node_list->Size())
+    /double(nets[0]->node_list->Size()-1);
+
+  /* initialize the random number generators, all of them are seeded
+     from the default one */
+  RNG_BEGIN();
+  data.rng_begun=1;
+  for (r=0; r<replicas; r++) {
+    IGRAPH_CHECK(igraph_rng_init(&rngs[r], &igraph_rngtype_mt19937));
+    data.nrngs=r+1;
+    igraph_rng_seed(&rngs[r], RNG_INT31());
+    pms[r]->Set_RNG(&rngs[r]);
+  }
+
+  /* The temperatures, from the hottest to the coldest */
+  temps[0]=pms[0]->FindStartTemp(gamma, prob, starttemp);
+  if (temps[0] < stoptemp) { temps[0]=stoptemp; }
+  for (t=1; t<replicas; t++) {
+    temps[t]=temps[0]*pow(stoptemp/temps[0], t/double(replicas-1));
+  }
+
+  /* assign random initial configurations */
+  for (r=0; r<replicas; r++) {
+    pms[r]->assign_initial_conf(-1);
+    pms[r]->initialize_Qmatrix();
+    replica_at[r]=r;
+  }
+
+  nthreads=IGRAPH_I_MAX_THREADS();
+  if (nthreads > replicas) { nthreads=replicas; }
+
+  for (round=0; round<rounds; round++) {
+
+    /* IGRAPH_ALLOW_INTERRUPTION() would leave the replicas to the
+       caller, so they are freed here */
+    if (igraph_i_interruption_handler &&
+	igraph_allow_interruption(NULL) != IGRAPH_SUCCESS) {
+      igraph_i_spinglass_replicas_destroy(&data);
+      IGRAPH_FINALLY_CLEAN(1);
+      return IGRAPH_INTERRUPTED;
+    }
+
+    /* The replicas are independent between the exchanges */
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+    for (t=0; t<replicas; t++) {
+      pms[replica_at[t]]->HeatBathLookup(gamma, prob, temps[t], 50);
+    }
+
+    /* Keep the best configuration */
+    for (t=0; t<replicas; t++) {
+      PottsModel *pm=pms[replica_at[t]];
+      double Q=pm->calculate_genQ(gamma);
+      if ((round==0 && t==0) || Q > bestQ) {
+	bestQ=Q;
+	besttemp=temps[t];
+	n_cur=iter.First(nets[replica_at[t]]->node_list);
+	i=0;
+	while (!iter.End()) {
+	  bestspins[i++]=n_cur->Get_ClusterIndex();
+	  n_cur=iter.Next();
+	}
+      }
+      energy[replica_at[t]]=pm->calculate_Hamiltonian(gamma, prob);
+    }
+
+    /* Try to exchange the neighboring replicas, alternating between
+       the even and the odd pairs */
+    for (t=round % 2; t+1<replicas; t+=2) {
+      long int a=replica_at[t], b=replica_at[t+1];
+      double d=(1.0/temps[t]-1.0/temps[t+1])*(energy[a]-energy[b]);
+      if (d >= 0 || RNG_UNIF01() < exp(d)) {
+	replica_at[t]=b;
+	replica_at[t+1]=a;
+      }
+    }
+  }
+
+  /* Write the best configuration into the first network */
+  n_cur=iter.First(nets[0]->node_list);
+  i=0;
+  while (!iter.End()) {
+    n_cur->Set_ClusterIndex(bestspins[i++]);
+    n_cur=iter.Next();
+  }
+  pms[0]->WriteClusters(modularity, temperature, csize, membership, 
+			besttemp, gamma);
+
+  igraph_i_spinglass_replicas_destroy(&data);
+  IGRAPH_FINALLY_CLEAN(1);
+
+  return 0;
+}
+
 /**
  * \function igraph_community_spinglass_single
  * \brief Community of a single node based on statistical mechanics
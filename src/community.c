@@ -40,6 +40,7 @@
 #include "igraph_types_internal.h"
 #include "igraph_conversion.h"
 #include "igraph_centrality.h"
+#include "igraph_parallel_internal.h"
 #include "config.h"
 
 #include <string.h>
@@ -308,6 +309,356 @@ long int igraph_i_vector_which_max_not_null(const igraph_vector_t *v,
   return which;
 }
 
+/*
+ * The edge betweenness scores for igraph_community_edge_betweenness.
+ * Removing an edge changes only the scores of the edges in its (weakly)
+ * connected component, and only the shortest paths from the sources
+ * in that component go through these edges. So after a removal only
+ * these sources are searched again, they are distributed among the
+ * OpenMP threads, see igraph_parallel_internal.h. The sources are
+ * processed in blocks: every source of a block stores its scores in
+ * its own row, and then the rows are added to the scores of the
+ * edges one by one, in source order. So every score is the same sum,
+ * in the same order, as in the sequential version.
+ */
+
+typedef struct igraph_i_community_eb_ws_t {
+  double *distance;
+  unsigned long long int *nrgeo;
+  double *tmpscore;
+  long int *order;		/* the vertices in the order they were reached */
+  long int *fathers;		/* weighted: the last edges of the shortest */
+  long int *nfathers;		/* paths, stored at 'fstart' */
+  igraph_2wheap_t heap;
+  igraph_bool_t heap_init;
+} igraph_i_community_eb_ws_t;
+
+typedef struct igraph_i_community_eb_data_t {
+  const igraph_t *graph;
+  igraph_inclist_t *elist_out_p, *elist_in_p;
+  const igraph_vector_t *weights;
+  long int *fstart;
+  long int nthreads;
+  igraph_i_community_eb_ws_t *ws;
+  long int block;		/* the number of sources in a block */
+  igraph_real_t *rows;		/* and their scores, 'block' rows */
+} igraph_i_community_eb_data_t;
+
+static void igraph_i_community_eb_data_destroy(igraph_i_community_eb_data_t *data) {
+  long int t;
+  for (t=0; t<data->nthreads && data->ws; t++) {
+    igraph_i_community_eb_ws_t *ws=&data->ws[t];
+    igraph_Free(ws->distance);
+    igraph_Free(ws->nrgeo);
+    igraph_Free(ws->tmpscore);
+    igraph_Free(ws->order);
+    igraph_Free(ws->fathers);
+    igraph_Free(ws->nfathers);
+    if (ws->heap_init) {
+      igraph_2wheap_destroy(&ws->heap);
+    }
+  }
+  igraph_Free(data->ws);
+  igraph_Free(data->fstart);
+  igraph_Free(data->rows);
+}
+
+/* The rows of a block take at most this many scores, unless one row
+   per thread is more than that */
+
+#define IGRAPH_I_COMMUNITY_EB_ROWS (1L << 22)
+
+/* The incidence lists are only read, and only shrink, after this, so
+   the father slots, which are as many as the in-edges of a vertex,
+   always suffice. */
+
+static int igraph_i_community_eb_data_init(igraph_i_community_eb_data_t *data,
+					   const igraph_t *graph,
+					   igraph_inclist_t *elist_out_p,
+					   igraph_inclist_t *elist_in_p,
+					   const igraph_vector_t *weights,
+					   long int nthreads) {
+  long int no_of_nodes=igraph_vcount(graph);
+  long int no_of_edges=igraph_ecount(graph);
+  long int n1= no_of_nodes > 0 ? no_of_nodes : 1;
+  long int m1= no_of_edges > 0 ? no_of_edges : 1;
+  long int t, i;
+
+  data->graph=graph;
+  data->elist_out_p=elist_out_p;
+  data->elist_in_p=elist_in_p;
+  data->weights=weights;
+  data->nthreads=nthreads;
+  data->fstart=0;
+  data->rows=0;
+  data->ws=igraph_Calloc(nthreads, igraph_i_community_eb_ws_t);
+  if (!data->ws) {
+    IGRAPH_ERROR("edge betweenness community structure failed", IGRAPH_ENOMEM);
+  }
+  IGRAPH_FINALLY(igraph_i_community_eb_data_destroy, data);
+
+  /* The result does not depend on the block size, a few sources per
+     thread keep the threads busy */
+  data->block=8*nthreads;
+  if (data->block * m1 > IGRAPH_I_COMMUNITY_EB_ROWS) {
+    data->block=IGRAPH_I_COMMUNITY_EB_ROWS / m1;
+    if (data->block < nthreads) { data->block=nthreads; }
+  }
+  data->rows=igraph_Calloc(data->block * m1, igraph_real_t);
+  if (!data->rows) {
+    IGRAPH_ERROR("edge betweenness community structure failed", IGRAPH_ENOMEM);
+  }
+
+  if (weights) {
+    data->fstart=igraph_Calloc(no_of_nodes+1, long int);
+    if (!data->fstart) {
+      IGRAPH_ERROR("edge betweenness community structure failed", IGRAPH_ENOMEM);
+    }
+    for (i=0; i<no_of_nodes; i++) {
+      data->fstart[i+1] = data->fstart[i] + 
+	igraph_vector_int_size(igraph_inclist_get(elist_in_p, i));
+    }
+  }
+
+  for (t=0; t<nthreads; t++) {
+    igraph_i_community_eb_ws_t *ws=&data->ws[t];
+    ws->distance=igraph_Calloc(n1, double);
+    ws->nrgeo=igraph_Calloc(n1, unsigned long long int);
+    ws->tmpscore=igraph_Calloc(n1, double);
+    ws->order=igraph_Calloc(n1, long int);
+    if (!ws->distance || !ws->nrgeo || !ws->tmpscore || !ws->order) {
+      IGRAPH_ERROR("edge betweenness community structure failed", IGRAPH_ENOMEM);
+    }
+    if (weights) {
+      long int no_of_slots=data->fstart[no_of_nodes];
+      ws->fathers=igraph_Calloc(no_of_slots > 0 ? no_of_slots : 1, long int);
+      ws->nfathers=igraph_Calloc(n1, long int);
+      if (!ws->fathers || !ws->nfathers) {
+	IGRAPH_ERROR("edge betweenness community structure failed", IGRAPH_ENOMEM);
+      }
+      /* Reserve the full size, so that the heap never needs to grow
+	 in the parallel part */
+      IGRAPH_CHECK(igraph_2wheap_init(&ws->heap, no_of_nodes));
+      ws->heap_init=1;
+      IGRAPH_CHECK(igraph_vector_reserve(&ws->heap.data, no_of_nodes));
+      IGRAPH_CHECK(igraph_vector_long_reserve(&ws->heap.index, no_of_nodes));
+    }
+  }
+
+  IGRAPH_FINALLY_CLEAN(1);
+  return 0;
+}
+
+/* Adds the edge betweenness contributions of the shortest paths from
+   'source' to 'eb'; every edge gets at most one. Leaves the workspace
+   clean for the next source. */
+
+static void igraph_i_community_eb_source(const igraph_i_community_eb_data_t *data,
+					 igraph_i_community_eb_ws_t *ws,
+					 long int source, igraph_real_t *eb) {
+  const igraph_t *graph=data->graph;
+  double *distance=ws->distance;
+  unsigned long long int *nrgeo=ws->nrgeo;
+  double *tmpscore=ws->tmpscore;
+  long int *order=ws->order;
+  long int head=0, tail=0, i;
+
+  order[tail++]=source;
+  nrgeo[source]=1;
+  distance[source]=0;
+
+  while (head < tail) {
+    long int actnode=order[head++];
+    igraph_vector_int_t *neip=igraph_inclist_get(data->elist_out_p, actnode);
+    long int neino=igraph_vector_int_size(neip);
+    for (i=0; i<neino; i++) {
+      long int edge=VECTOR(*neip)[i];
+      long int neighbor=IGRAPH_OTHER(graph, edge, actnode);
+      if (nrgeo[neighbor] != 0) {
+	/* we've already seen this node, another shortest path? */
+	if (distance[neighbor]==distance[actnode]+1) {
+	  nrgeo[neighbor]+=nrgeo[actnode];
+	}
+      } else {
+	/* we haven't seen this node yet */
+	nrgeo[neighbor]+=nrgeo[actnode];
+	distance[neighbor]=distance[actnode]+1;
+	order[tail++]=neighbor;
+      }
+    }
+  }
+
+  /* Ok, we've the distance of each node and also the number of
+     shortest paths to them. Now we do an inverse search, starting
+     with the farthest nodes. */
+  while (tail > 0) {
+    long int actnode=order[--tail];
+    if (actnode != source) {
+      igraph_vector_int_t *neip=igraph_inclist_get(data->elist_in_p, actnode);
+      long int neino=igraph_vector_int_size(neip);
+      for (i=0; i<neino; i++) {
+	long int edge=VECTOR(*neip)[i];
+	long int neighbor=IGRAPH_OTHER(graph, edge, actnode);
+	if (distance[neighbor]==distance[actnode]-1 &&
+	    nrgeo[neighbor] != 0) {
+	  tmpscore[neighbor] +=
+	    (tmpscore[actnode]+1)*nrgeo[neighbor]/nrgeo[actnode];
+	  eb[edge] +=
+	    (tmpscore[actnode]+1)*nrgeo[neighbor]/nrgeo[actnode];
+	}
+      }
+    }
+    distance[actnode]=0;
+    nrgeo[actnode]=0;
+    tmpscore[actnode]=0;
+  }
+}
+
+static void igraph_i_community_eb_source_weighted(const igraph_i_community_eb_data_t *data,
+						  igraph_i_community_eb_ws_t *ws,
+						  long int source,
+						  igraph_real_t *eb) {
+  const igraph_t *graph=data->graph;
+  const igraph_real_t *weights=VECTOR(*data->weights);
+  double *distance=ws->distance;
+  unsigned long long int *nrgeo=ws->nrgeo;
+  double *tmpscore=ws->tmpscore;
+  long int *order=ws->order, *fathers=ws->fathers, *nfathers=ws->nfathers;
+  long int *fstart=data->fstart;
+  igraph_2wheap_t *heap=&ws->heap;
+  long int nord=0, i;
+
+  /* The heap has enough space reserved, so pushing cannot fail */
+  igraph_2wheap_push_with_index(heap, source, 0);
+  distance[source]=1.0;
+  nrgeo[source]=1;
+
+  while (!igraph_2wheap_empty(heap)) {
+    long int minnei=igraph_2wheap_max_index(heap);
+    igraph_real_t mindist=-igraph_2wheap_delete_max(heap);
+    igraph_vector_int_t *neip=igraph_inclist_get(data->elist_out_p, minnei);
+    long int neino=igraph_vector_int_size(neip);
+
+    order[nord++]=minnei;
+
+    for (i=0; i<neino; i++) {
+      long int edge=VECTOR(*neip)[i];
+      long int to=IGRAPH_OTHER(graph, edge, minnei);
+      igraph_real_t altdist=mindist + weights[edge];
+      igraph_real_t curdist=distance[to];
+
+      if (curdist == 0) {
+	/* This is the first finite distance to 'to' */
+	fathers[fstart[to]]=edge;
+	nfathers[to]=1;
+	nrgeo[to]=nrgeo[minnei];
+	distance[to]=altdist + 1.0;
+	igraph_2wheap_push_with_index(heap, to, -altdist);
+      } else if (altdist < curdist-1) {
+	/* This is a shorter path */
+	fathers[fstart[to]]=edge;
+	nfathers[to]=1;
+	nrgeo[to]=nrgeo[minnei];
+	distance[to]=altdist + 1.0;
+	igraph_2wheap_modify(heap, to, -altdist);
+      } else if (altdist == curdist-1) {
+	/* Another path with the same length */
+	fathers[fstart[to]+nfathers[to]]=edge;
+	nfathers[to] += 1;
+	nrgeo[to] += nrgeo[minnei];
+      }
+    }
+  }
+
+  while (nord > 0) {
+    long int w=order[--nord];
+    long int *fatv=fathers+fstart[w];
+    long int fatv_len=nfathers[w];
+
+    for (i=0; i<fatv_len; i++) {
+      long int fedge=fatv[i];
+      long int neighbor=IGRAPH_OTHER(graph, fedge, w);
+      tmpscore[neighbor] += (tmpscore[w] + 1) * nrgeo[neighbor] / nrgeo[w];
+      eb[fedge] += (tmpscore[w] + 1) * nrgeo[neighbor] / nrgeo[w];
+    }
+
+    tmpscore[w]=0;
+    distance[w]=0;
+    nrgeo[w]=0;
+    nfathers[w]=0;
+  }
+}
+
+/* Recalculates the edge betweenness of the edges incident on the
+   'todo' vertices, from these sources, into 'eb'. 'todo' must be a
+   union of (weakly) connected components, in increasing order. */
+
+static int igraph_i_community_eb_update(const igraph_i_community_eb_data_t *data,
+					const igraph_vector_long_t *todo,
+					igraph_vector_t *eb) {
+  const igraph_t *graph=data->graph;
+  long int ntodo=igraph_vector_long_size(todo);
+  long int no_of_edges=igraph_ecount(graph);
+  long int k, i, begin;
+  volatile int interrupted=0;
+
+  for (k=0; k<ntodo; k++) {
+    igraph_vector_int_t *neip=igraph_inclist_get(data->elist_out_p,
+						 VECTOR(*todo)[k]);
+    long int neino=igraph_vector_int_size(neip);
+    for (i=0; i<neino; i++) {
+      VECTOR(*eb)[ (long int) VECTOR(*neip)[i] ] = 0.0;
+    }
+  }
+
+  for (begin=0; begin<ntodo && !interrupted; begin += data->block) {
+    long int end= begin + data->block < ntodo ? begin + data->block : ntodo;
+    long int j;
+
+    /* The scores of the sources of the block, each in its own row */
+#pragma omp parallel for schedule(dynamic, 1) num_threads((int) data->nthreads) if(end-begin > 1)
+    for (j=begin; j<end; j++) {
+      igraph_i_community_eb_ws_t *ws=&data->ws[IGRAPH_I_THREAD_NUM()];
+      igraph_real_t *row=data->rows + (j-begin) * no_of_edges;
+      if (interrupted) { continue; }
+      IGRAPH_I_ALLOW_INTERRUPTION_PARALLEL(interrupted);
+      if (data->weights) {
+	igraph_i_community_eb_source_weighted(data, ws, VECTOR(*todo)[j], row);
+      } else {
+	igraph_i_community_eb_source(data, ws, VECTOR(*todo)[j], row);
+      }
+    }
+
+    /* Add the rows to the scores, in source order. Every edge is
+       added from its 'from' vertex only, so the vertices can be
+       processed in parallel. */
+#pragma omp parallel for schedule(dynamic, 64) num_threads((int) data->nthreads) if(ntodo > 1)
+    for (j=0; j<ntodo; j++) {
+      long int v=VECTOR(*todo)[j], l, r, neino;
+      igraph_vector_int_t *neip;
+      if (interrupted) { continue; }
+      neip=igraph_inclist_get(data->elist_out_p, v);
+      neino=igraph_vector_int_size(neip);
+      for (l=0; l<neino; l++) {
+	long int m=VECTOR(*neip)[l];
+	igraph_real_t *row=data->rows + m;
+	if (IGRAPH_FROM(graph, m) != v) { continue; }
+	for (r=begin; r<end; r++, row += no_of_edges) {
+	  VECTOR(*eb)[m] += *row;
+	  *row = 0.0;
+	}
+      }
+    }
+  }
+
+  if (interrupted) {
+    IGRAPH_FINALLY_FREE();
+    return IGRAPH_INTERRUPTED;
+  }
+
+  return 0;
+}
+
 /**
  * \function igraph_community_edge_betweenness
  * \brief Community finding based on edge betweenness
@@ -364,6 +715,16 @@ long int igraph_i_vector_which_max_not_null(const igraph_vector_t *v,
  * \sa \ref igraph_community_eb_get_merges(), \ref
  * igraph_community_spinglass(), \ref igraph_community_walktrap().
  * 
+ * </para><para>
+ * After an edge removal only the betweenness of the edges in the same
+ * (weakly) connected component is recalculated, from the sources in
+ * that component, so the later steps, when the graph has already
+ * fallen apart into many components, are much faster. If igraph was
+ * compiled with OpenMP support, the sources are searched in parallel,
+ * and their scores are added up in the order of the sources, so the
+ * result is the same as the result of the sequential calculation,
+ * for any number of threads.
+ * 
  * Time complexity: O(|V||E|^2), as the betweenness calculation requires
  * O(|V||E|) and we do it |E|-1 times.
  * 
@@ -382,11 +743,10 @@ int igraph_community_edge_betweenness(const igraph_t *graph,
   
   long int no_of_nodes=igraph_vcount(graph);
   long int no_of_edges=igraph_ecount(graph);
-  double *distance, *tmpscore;
-  unsigned long long int *nrgeo;
-  long int source, i, e;
+  long int nthreads=IGRAPH_I_MAX_THREADS();
+  long int i, e, k;
   
-  igraph_inclist_t elist_out, elist_in, fathers;
+  igraph_inclist_t elist_out, elist_in;
   igraph_inclist_t *elist_out_p, *elist_in_p;
   igraph_vector_int_t *neip;
   long int neino;
@@ -394,17 +754,13 @@ int igraph_community_edge_betweenness(const igraph_t *graph,
   long int maxedge, pos;
   igraph_integer_t from, to;
   igraph_bool_t result_owned = 0;
-  igraph_stack_t stack=IGRAPH_STACK_NULL;
   igraph_real_t steps, steps_done;
+  igraph_i_community_eb_data_t data;
+  igraph_vector_long_t todo;
+  long int *mark;
 
   char *passive;
 
-  /* Needed only for the unweighted case */
-  igraph_dqueue_t q=IGRAPH_DQUEUE_NULL;
-
-  /* Needed only for the weighted case */
-  igraph_2wheap_t heap;
-
   if (result == 0) {
     result = igraph_Calloc(1, igraph_vector_t);
     if (result == 0)
@@ -414,6 +770,10 @@ int igraph_community_edge_betweenness(const igraph_t *graph,
     result_owned = 1;
   }
 
+  if (weights != 0 && no_of_edges > 0 && igraph_vector_min(weights) <= 0) {
+    IGRAPH_ERROR("weights must be strictly positive", IGRAPH_EINVAL);
+  }
+
   directed=directed && igraph_is_directed(graph);
   if (directed) {
     IGRAPH_CHECK(igraph_inclist_init(graph, &elist_out, IGRAPH_OUT));
@@ -427,38 +787,21 @@ int igraph_community_edge_betweenness(const igraph_t *graph,
     IGRAPH_FINALLY(igraph_inclist_destroy, &elist_out);
     elist_out_p=elist_in_p=&elist_out;
   }
-  
-  distance=igraph_Calloc(no_of_nodes, double);
-  if (distance==0) {
-    IGRAPH_ERROR("edge betweenness community structure failed", IGRAPH_ENOMEM);
-  }
-  IGRAPH_FINALLY(igraph_free, distance);
-  nrgeo=igraph_Calloc(no_of_nodes, unsigned long long int);
-  if (nrgeo==0) {
-    IGRAPH_ERROR("edge betweenness community structure failed", IGRAPH_ENOMEM);
-  }
-  IGRAPH_FINALLY(igraph_free, nrgeo);
-  tmpscore=igraph_Calloc(no_of_nodes, double);
-  if (tmpscore==0) {
-    IGRAPH_ERROR("edge betweenness community structure failed", IGRAPH_ENOMEM);
-  }
-  IGRAPH_FINALLY(igraph_free, tmpscore);
 
-  if (weights == 0) {
-    IGRAPH_DQUEUE_INIT_FINALLY(&q, 100);
-  } else {
-    if (igraph_vector_min(weights) <= 0) {
-      IGRAPH_ERROR("weights must be strictly positive", IGRAPH_EINVAL);
-    }
-    IGRAPH_CHECK(igraph_2wheap_init(&heap, no_of_nodes));
-    IGRAPH_FINALLY(igraph_2wheap_destroy, &heap);
-    IGRAPH_CHECK(igraph_inclist_init_empty(&fathers, 
-					   (igraph_integer_t) no_of_nodes));
-    IGRAPH_FINALLY(igraph_inclist_destroy, &fathers);
-  }
+  if (nthreads > no_of_nodes) { nthreads=no_of_nodes; }
+  if (nthreads < 1) { nthreads=1; }
+  IGRAPH_CHECK(igraph_i_community_eb_data_init(&data, graph, elist_out_p,
+					       elist_in_p, weights, nthreads));
+  IGRAPH_FINALLY(igraph_i_community_eb_data_destroy, &data);
 
-  IGRAPH_CHECK(igraph_stack_init(&stack, no_of_nodes));
-  IGRAPH_FINALLY(igraph_stack_destroy, &stack);
+  /* The sources to search from in the next step, all vertices first */
+  IGRAPH_CHECK(igraph_vector_long_init_seq(&todo, 0, no_of_nodes-1));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &todo);
+  mark=igraph_Calloc(no_of_nodes > 0 ? no_of_nodes : 1, long int);
+  if (mark==0) {
+    IGRAPH_ERROR("edge betweenness community structure failed", IGRAPH_ENOMEM);
+  }
+  IGRAPH_FINALLY(igraph_free, mark);
   
   IGRAPH_CHECK(igraph_vector_resize(result, no_of_edges));
   if (edge_betweenness) {
@@ -487,153 +830,9 @@ int igraph_community_edge_betweenness(const igraph_t *graph,
     IGRAPH_PROGRESS("Edge betweenness community detection: ",
         100.0*steps_done/steps, NULL);
 
-    igraph_vector_null(&eb);
-
-    if (weights == 0) {
-      /* Unweighted variant follows */
-
-      /* The following for loop is copied almost intact from
-       * igraph_edge_betweenness_estimate */
-      for (source=0; source<no_of_nodes; source++) {
-
-        IGRAPH_ALLOW_INTERRUPTION();
-
-        memset(distance, 0, (size_t) no_of_nodes*sizeof(double));
-        memset(nrgeo, 0, (size_t) no_of_nodes*sizeof(unsigned long long int));
-        memset(tmpscore, 0, (size_t) no_of_nodes*sizeof(double));
-        igraph_stack_clear(&stack); /* it should be empty anyway... */
-        
-        IGRAPH_CHECK(igraph_dqueue_push(&q, source));
-        
-        nrgeo[source]=1;
-        distance[source]=0;
-        
-        while (!igraph_dqueue_empty(&q)) {
-          long int actnode=(long int) igraph_dqueue_pop(&q);
-          
-          neip=igraph_inclist_get(elist_out_p, actnode);
-          neino=igraph_vector_int_size(neip);
-          for (i=0; i<neino; i++) {
-            igraph_integer_t edge=(igraph_integer_t) VECTOR(*neip)[i], from, to;
-            long int neighbor;
-            igraph_edge(graph, edge, &from, &to);
-            neighbor = actnode!=from ? from : to;
-            if (nrgeo[neighbor] != 0) {
-              /* we've already seen this node, another shortest path? */
-              if (distance[neighbor]==distance[actnode]+1) {
-                nrgeo[neighbor]+=nrgeo[actnode];
-              }
-            } else {
-              /* we haven't seen this node yet */
-              nrgeo[neighbor]+=nrgeo[actnode];
-              distance[neighbor]=distance[actnode]+1;
-              IGRAPH_CHECK(igraph_dqueue_push(&q, neighbor));
-              IGRAPH_CHECK(igraph_stack_push(&stack, neighbor));
-            }
-          }
-        } /* while !igraph_dqueue_empty */
-        
-        /* Ok, we've the distance of each node and also the number of
-           shortest paths to them. Now we do an inverse search, starting
-           with the farthest nodes. */
-        while (!igraph_stack_empty(&stack)) {
-          long int actnode=(long int) igraph_stack_pop(&stack);
-          if (distance[actnode]<1) { continue; } /* skip source node */
-          
-          /* set the temporary score of the friends */
-          neip=igraph_inclist_get(elist_in_p, actnode);
-          neino=igraph_vector_int_size(neip);
-          for (i=0; i<neino; i++) {
-            long int edge = (long int) VECTOR(*neip)[i];
-            long int neighbor = IGRAPH_OTHER(graph, edge, actnode);
-            if (distance[neighbor]==distance[actnode]-1 &&
-                nrgeo[neighbor] != 0) {
-              tmpscore[neighbor] +=
-                (tmpscore[actnode]+1)*nrgeo[neighbor]/nrgeo[actnode];
-              VECTOR(eb)[edge] +=
-                (tmpscore[actnode]+1)*nrgeo[neighbor]/nrgeo[actnode];
-            }
-          }
-        }
-        /* Ok, we've the scores for this source */
-      } /* for source <= no_of_nodes */
-    } else {
-      /* Weighted variant follows */
-
-      /* The following for loop is copied almost intact from
-       * igraph_i_edge_betweenness_estimate_weighted */
-      for (source=0; source<no_of_nodes; source++) {
-        /* This will contain the edge betweenness in the current step */
-        IGRAPH_ALLOW_INTERRUPTION();
-
-        memset(distance, 0, (size_t) no_of_nodes*sizeof(double));
-        memset(nrgeo, 0, (size_t) no_of_nodes*sizeof(unsigned long long int));
-        memset(tmpscore, 0, (size_t) no_of_nodes*sizeof(double));
-
-        igraph_2wheap_push_with_index(&heap, source, 0);
-        distance[source]=1.0;
-        nrgeo[source]=1;
-
-        while (!igraph_2wheap_empty(&heap)) {
-          long int minnei = igraph_2wheap_max_index(&heap);
-          igraph_real_t mindist = -igraph_2wheap_delete_max(&heap);
-
-          igraph_stack_push(&stack, minnei);
-
-          neip=igraph_inclist_get(elist_out_p, minnei);
-          neino=igraph_vector_int_size(neip);
-
-          for (i=0; i<neino; i++) {
-            long int edge=VECTOR(*neip)[i];
-            long int to=IGRAPH_OTHER(graph, edge, minnei);
-            igraph_real_t altdist = mindist + VECTOR(*weights)[edge];
-            igraph_real_t curdist = distance[to];
-            igraph_vector_int_t *v;
-
-            if (curdist == 0) {
-              /* This is the first finite distance to 'to' */
-              v = igraph_inclist_get(&fathers, to);
-              igraph_vector_int_resize(v, 1);
-              VECTOR(*v)[0] = edge;
-              nrgeo[to] = nrgeo[minnei];
-              distance[to] = altdist + 1.0;
-              IGRAPH_CHECK(igraph_2wheap_push_with_index(&heap, to, -altdist));
-            } else if (altdist < curdist-1) {
-              /* This is a shorter path */
-              v = igraph_inclist_get(&fathers, to);
-              igraph_vector_int_resize(v, 1);
-              VECTOR(*v)[0] = edge;
-              nrgeo[to] = nrgeo[minnei];
-              distance[to] = altdist + 1.0;
-              IGRAPH_CHECK(igraph_2wheap_modify(&heap, to, -altdist));
-            } else if (altdist == curdist-1) {
-              /* Another path with the same length */
-              v = igraph_inclist_get(&fathers, to);
-              igraph_vector_int_push_back(v, edge);
-              nrgeo[to] += nrgeo[minnei];
-            }
-          }
-        } /* igraph_2wheap_empty(&Q) */
-
-        while (!igraph_stack_empty(&stack)) {
-          long int w = (long int) igraph_stack_pop(&stack);
-          igraph_vector_int_t *fatv = igraph_inclist_get(&fathers, w);
-          long int fatv_len = igraph_vector_int_size(fatv);
-
-          for (i = 0; i < fatv_len; i++) {
-            long int fedge = (long int) VECTOR(*fatv)[i];
-            long int neighbor = IGRAPH_OTHER(graph, fedge, w);
-            tmpscore[neighbor] += (tmpscore[w] + 1) * nrgeo[neighbor] / nrgeo[w];
-            VECTOR(eb)[fedge] += (tmpscore[w] + 1) * nrgeo[neighbor] / nrgeo[w];
-          }
-
-          tmpscore[w] = 0;
-          distance[w] = 0;
-          nrgeo[w] = 0;
-          igraph_vector_int_clear(fatv);
-        }
-      } /* source < no_of_nodes */
-    }
+    /* Only the scores in the component of the edge removed last
+       have changed */
+    IGRAPH_CHECK(igraph_i_community_eb_update(&data, &todo, &eb));
     
     /* Now look for the smallest edge betweenness */
     /* and eliminate that edge from the network */
@@ -659,27 +858,46 @@ int igraph_community_edge_betweenness(const igraph_t *graph,
     igraph_vector_int_search(neip, 0, maxedge, &pos);
     VECTOR(*neip)[pos]=VECTOR(*neip)[neino-1];
     igraph_vector_int_pop_back(neip);
+
+    /* The component(s) of the endpoints, ignoring the edge directions;
+       'todo' has space for all vertices, so this does not allocate */
+    igraph_vector_long_clear(&todo);
+    mark[(long int) from]=e+1;
+    igraph_vector_long_push_back(&todo, from);
+    if (mark[(long int) to] != e+1) {
+      mark[(long int) to]=e+1;
+      igraph_vector_long_push_back(&todo, to);
+    }
+    for (k=0; k<igraph_vector_long_size(&todo); k++) {
+      long int actnode=VECTOR(todo)[k];
+      igraph_inclist_t *lists[2];
+      long int l;
+      lists[0]=elist_out_p; lists[1]=elist_in_p;
+      for (l=0; l < (directed ? 2 : 1); l++) {
+	neip=igraph_inclist_get(lists[l], actnode);
+	neino=igraph_vector_int_size(neip);
+	for (i=0; i<neino; i++) {
+	  long int neighbor=IGRAPH_OTHER(graph, VECTOR(*neip)[i], actnode);
+	  if (mark[neighbor] != e+1) {
+	    mark[neighbor]=e+1;
+	    igraph_vector_long_push_back(&todo, neighbor);
+	  }
+	}
+      }
+    }
+    /* The contributions of the sources are added in increasing order,
+       as in a full recalculation */
+    igraph_vector_long_sort(&todo);
   }
 
   IGRAPH_PROGRESS("Edge betweenness community detection: ", 100.0, NULL);
 
   igraph_free(passive);
   igraph_vector_destroy(&eb);
-  igraph_stack_destroy(&stack);
-  IGRAPH_FINALLY_CLEAN(3);
-
-  if (weights == 0) {
-    igraph_dqueue_destroy(&q);
-    IGRAPH_FINALLY_CLEAN(1);
-  } else {
-    igraph_2wheap_destroy(&heap);
-    igraph_inclist_destroy(&fathers);
-    IGRAPH_FINALLY_CLEAN(2);
-  }
-  igraph_free(tmpscore);
-  igraph_free(nrgeo);
-  igraph_free(distance);
-  IGRAPH_FINALLY_CLEAN(3);
+  igraph_free(mark);
+  igraph_vector_long_destroy(&todo);
+  igraph_i_community_eb_data_destroy(&data);
+  IGRAPH_FINALLY_CLEAN(5);
 
   if (directed) {
     igraph_inclist_destroy(&elist_out);
@@ -1118,277 +1336,132 @@ int igraph_reindex_membership(igraph_vector_t *membership,
  * </para>
  */
 
+/*
+ * Multiplication by the modularity matrix of a community, for
+ * ARPACK. Before the eigenproblems of a split, the community is
+ * extracted into a CSR graph of local vertex ids, and the part of the
+ * diagonal correction that does not depend on the vector, i.e. the
+ * number (or weight) of the edges within the community minus its
+ * expected value, is calculated. A product is then a single pass over
+ * this graph; for large communities the rows are distributed among
+ * the OpenMP threads, see igraph_parallel_internal.h, the partial sums
+ * of k^Tx are added in thread order.
+ *
+ * ARPACK calls the function with n equal to the size of the community,
+ * or one less, in the latter case the last row and column of the
+ * matrix are deleted.
+ */
+
+/* Communities smaller than this are multiplied in a single thread */
+#define IGRAPH_I_LEVC_PARALLEL_MIN 10000
+
 typedef struct igraph_i_community_leading_eigenvector_data_t {
-  igraph_vector_t *idx;
-  igraph_vector_t *idx2;
-  igraph_adjlist_t *adjlist;
-  igraph_inclist_t *inclist;
-  igraph_vector_t *tmp;
-  long int no_of_edges;
-  igraph_vector_t *mymembership;
-  long int comm;
-  const igraph_vector_t *weights;
-  const igraph_t *graph;
-  igraph_vector_t *strength;
-  igraph_real_t sumweights;
+  long int size;		/* the number of vertices in the community */
+  long int *start;		/* the community, local ids */
+  long int *nei;
+  igraph_real_t *w;		/* the weights of the edges, or null */
+  igraph_real_t *deg;		/* degrees or strengths in the whole graph */
+  igraph_real_t *tmp;		/* internal degree minus its expected value */
+  igraph_real_t m;		/* number of edges, or the total weight */
+  long int nthreads;
+  igraph_real_t *partial;	/* per-thread k^Tx sums */
 } igraph_i_community_leading_eigenvector_data_t;
 
-int igraph_i_community_leading_eigenvector(igraph_real_t *to,
-					   const igraph_real_t *from,
-					   int n, void *extra) {
-  
-  igraph_i_community_leading_eigenvector_data_t *data=extra;
-  long int j, k, nlen, size=n;
-  igraph_vector_t *idx=data->idx;
-  igraph_vector_t *idx2=data->idx2;
-  igraph_vector_t *tmp=data->tmp;
-  igraph_adjlist_t *adjlist=data->adjlist;
-  igraph_real_t ktx, ktx2;
-  long int no_of_edges=data->no_of_edges;
-  igraph_vector_t *mymembership=data->mymembership;
-  long int comm=data->comm;
-
-  /* Ax */
+/* Extracts the community of the 'size' vertices in 'idx'. 'idx2' must
+   map these to their positions in 'idx'. */
+
+static void igraph_i_community_leading_eigenvector_prepare(
+		igraph_i_community_leading_eigenvector_data_t *data,
+		const igraph_csr_t *csr,
+		const igraph_vector_t *weights,
+		const igraph_vector_t *strength,
+		const igraph_vector_t *mymembership,
+		long int comm,
+		const igraph_vector_t *idx,
+		const igraph_vector_t *idx2,
+		long int size) {
+  long int j, k, ptr=0;
+  igraph_real_t ktx2=0.0;
+
+  data->size=size;
   for (j=0; j<size; j++) {
     long int oldid=(long int) VECTOR(*idx)[j];
-    igraph_vector_int_t *neis=igraph_adjlist_get(adjlist, oldid);
-    nlen=igraph_vector_int_size(neis);
-    to[j]=0.0;
-    VECTOR(*tmp)[j]=0.0;
+    const int *neis=igraph_csr_neighbors(csr, oldid);
+    const int *eids=igraph_csr_incident(csr, oldid);
+    long int nlen=igraph_csr_degree(csr, oldid);
+    igraph_real_t internal=0.0;
+    data->start[j]=ptr;
     for (k=0; k<nlen; k++) {
-      long int nei=(long int) VECTOR(*neis)[k];
-      long int neimemb=(long int) VECTOR(*mymembership)[nei];
-      if (neimemb==comm) {
-	to[j] += from[ (long int) VECTOR(*idx2)[nei] ];
-	VECTOR(*tmp)[j] += 1;
+      long int nei=neis[k];
+      if (VECTOR(*mymembership)[nei]==comm) {
+	data->nei[ptr]=(long int) VECTOR(*idx2)[nei];
+	if (weights) {
+	  data->w[ptr]=VECTOR(*weights)[ (long int) eids[k] ];
+	  internal += data->w[ptr];
+	} else {
+	  internal += 1;
+	}
+	ptr++;
       }
     }
+    data->tmp[j]=internal;
+    data->deg[j]= weights ? VECTOR(*strength)[oldid] : nlen;
+    ktx2 += data->deg[j];
   }
-  
-  /* Now calculate k^Tx/2m */
-  ktx=0.0; ktx2=0.0;
-  for (j=0; j<size; j++) {
-    long int oldid=(long int) VECTOR(*idx)[j];
-    igraph_vector_int_t *neis=igraph_adjlist_get(adjlist, oldid);
-    long int degree=igraph_vector_int_size(neis);
-    ktx += from[j] * degree;
-    ktx2 += degree;
-  }
-  ktx = ktx / no_of_edges/2.0;
-  ktx2 = ktx2 / no_of_edges/2.0;
-  
-  /* Now calculate Bx */
-  for (j=0; j<size; j++) {
-    long int oldid=(long int) VECTOR(*idx)[j];
-    igraph_vector_int_t *neis=igraph_adjlist_get(adjlist, oldid);
-    igraph_real_t degree=igraph_vector_int_size(neis);
-    to[j] = to[j] - ktx*degree;
-    VECTOR(*tmp)[j] = VECTOR(*tmp)[j] - ktx2*degree;
-  }
-  
-  /* -d_ij summa l in G B_il */
+  data->start[size]=ptr;
+
+  ktx2 = ktx2 / data->m / 2.0;
   for (j=0; j<size; j++) {
-    to[j] -= VECTOR(*tmp)[j] * from[j];
+    data->tmp[j] = data->tmp[j] - ktx2*data->deg[j];
   }
-
-  return 0;
 }
 
-int igraph_i_community_leading_eigenvector2(igraph_real_t *to,
-					    const igraph_real_t *from,
-					    int n, void *extra) {
+static int igraph_i_community_leading_eigenvector(igraph_real_t *to,
+						  const igraph_real_t *from,
+						  int n, void *extra) {
   
   igraph_i_community_leading_eigenvector_data_t *data=extra;
-  long int j, k, nlen, size=n;
-  igraph_vector_t *idx=data->idx;
-  igraph_vector_t *idx2=data->idx2;
-  igraph_vector_t *tmp=data->tmp;
-  igraph_adjlist_t *adjlist=data->adjlist;
-  igraph_real_t ktx, ktx2;
-  long int no_of_edges=data->no_of_edges;
-  igraph_vector_t *mymembership=data->mymembership;
-  long int comm=data->comm;
-
-  /* Ax */
-  for (j=0; j<size; j++) {
-    long int oldid=(long int) VECTOR(*idx)[j];
-    igraph_vector_int_t *neis=igraph_adjlist_get(adjlist, oldid);
-    nlen=igraph_vector_int_size(neis);
-    to[j]=0.0;
-    VECTOR(*tmp)[j]=0.0;
-    for (k=0; k<nlen; k++) {
-      long int nei=(long int) VECTOR(*neis)[k];
-      long int neimemb=(long int) VECTOR(*mymembership)[nei];
-      if (neimemb==comm) {
-	long int fi=(long int) VECTOR(*idx2)[nei];
-	if (fi < size) {
-	  to[j] += from[fi];
-	}
-	VECTOR(*tmp)[j] += 1;
-      }
-    }
-  }
-  
-  /* Now calculate k^Tx/2m */
-  ktx=0.0; ktx2=0.0;
-  for (j=0; j<size+1; j++) {
-    long int oldid=(long int) VECTOR(*idx)[j];
-    igraph_vector_int_t *neis=igraph_adjlist_get(adjlist, oldid);
-    long int degree=igraph_vector_int_size(neis);
-    if (j<size) {
-      ktx += from[j] * degree;
+  long int nthreads= n >= IGRAPH_I_LEVC_PARALLEL_MIN ? data->nthreads : 1;
+  const long int *start=data->start, *nei=data->nei;
+  const igraph_real_t *w=data->w, *deg=data->deg, *tmp=data->tmp;
+  igraph_real_t ktx=0.0;
+
+#pragma omp parallel num_threads((int) nthreads) if (nthreads > 1)
+  {
+    long int tid=IGRAPH_I_THREAD_NUM(), nt=IGRAPH_I_NUM_THREADS();
+    long int begin=IGRAPH_I_THREAD_BEGIN(n, tid, nt);
+    long int end=IGRAPH_I_THREAD_END(n, tid, nt);
+    long int j, k;
+    igraph_real_t sum=0.0;
+
+    /* k^Tx/2m */
+    for (j=begin; j<end; j++) {
+      sum += from[j] * deg[j];
     }
-    ktx2 += degree;
-  }
-  ktx = ktx / no_of_edges/2.0;
-  ktx2 = ktx2 / no_of_edges/2.0;
-  
-  /* Now calculate Bx */
-  for (j=0; j<size; j++) {
-    long int oldid=(long int) VECTOR(*idx)[j];
-    igraph_vector_int_t *neis=igraph_adjlist_get(adjlist, oldid);
-    igraph_real_t degree=igraph_vector_int_size(neis);
-    to[j] = to[j] - ktx*degree;
-    VECTOR(*tmp)[j] = VECTOR(*tmp)[j] - ktx2*degree;
-  }
-  
-  /* -d_ij summa l in G B_il */
-  for (j=0; j<size; j++) {
-    to[j] -= VECTOR(*tmp)[j] * from[j];
-  }
-
-  return 0;
-}
-
-int igraph_i_community_leading_eigenvector_weighted(igraph_real_t *to,
-					    const igraph_real_t *from,
-					    int n, void *extra) {
-
-  igraph_i_community_leading_eigenvector_data_t *data=extra;
-  long int j, k, nlen, size=n;
-  igraph_vector_t *idx=data->idx;
-  igraph_vector_t *idx2=data->idx2;
-  igraph_vector_t *tmp=data->tmp;
-  igraph_inclist_t *inclist=data->inclist;
-  igraph_real_t ktx, ktx2;
-  igraph_vector_t *mymembership=data->mymembership;
-  long int comm=data->comm;
-  const igraph_vector_t *weights=data->weights;
-  const igraph_t *graph=data->graph;
-  igraph_vector_t *strength=data->strength;
-  igraph_real_t sw=data->sumweights;
-  
-  /* Ax */
-  for (j=0; j<size; j++) {
-    long int oldid=(long int) VECTOR(*idx)[j];
-    igraph_vector_int_t *inc=igraph_inclist_get(inclist, oldid);
-    nlen=igraph_vector_int_size(inc);
-    to[j]=0.0;
-    VECTOR(*tmp)[j]=0.0;
-    for (k=0; k<nlen; k++) {
-      long int edge=(long int) VECTOR(*inc)[k];
-      igraph_real_t w=VECTOR(*weights)[edge];
-      long int nei=IGRAPH_OTHER(graph, edge, oldid);
-      long int neimemb=(long int) VECTOR(*mymembership)[nei];
-      if (neimemb==comm) {
-	to[j] += from[ (long int) VECTOR(*idx2)[nei] ] * w;
-	VECTOR(*tmp)[j] += w;
+    data->partial[tid]=sum;
+#pragma omp barrier
+#pragma omp single
+    {
+      long int t;
+      for (t=0; t<nt; t++) {
+	ktx += data->partial[t];
       }
+      ktx = ktx / data->m / 2.0;
     }
-  }
-
-  /* k^Tx/2m */
-  ktx=0.0; ktx2=0.0;
-  for (j=0; j<size; j++) {
-    long int oldid=(long int) VECTOR(*idx)[j];
-    igraph_real_t str=VECTOR(*strength)[oldid];
-    ktx += from[j] * str;
-    ktx2 += str;
-  }
-  ktx = ktx / sw / 2.0;
-  ktx2 = ktx2 / sw / 2.0;
-
-  /* Bx */
-  for (j=0; j<size; j++) {
-    long int oldid=(long int) VECTOR(*idx)[j];
-    igraph_real_t str=VECTOR(*strength)[oldid];
-    to[j] = to[j] - ktx * str;
-    VECTOR(*tmp)[j] = VECTOR(*tmp)[j] - ktx2*str;
-  }
-
-  /* -d_ij summa l in G B_il */
-  for (j=0; j<size; j++) {
-    to[j] -= VECTOR(*tmp)[j] * from[j];
-  }
 
-  return 0;
-}
-
-int igraph_i_community_leading_eigenvector2_weighted(igraph_real_t *to,
-					    const igraph_real_t *from,
-					    int n, void *extra) {
-  
-  igraph_i_community_leading_eigenvector_data_t *data=extra;
-  long int j, k, nlen, size=n;
-  igraph_vector_t *idx=data->idx;
-  igraph_vector_t *idx2=data->idx2;
-  igraph_vector_t *tmp=data->tmp;
-  igraph_inclist_t *inclist=data->inclist;
-  igraph_real_t ktx, ktx2;
-  igraph_vector_t *mymembership=data->mymembership;
-  long int comm=data->comm;
-  const igraph_vector_t *weights=data->weights;
-  const igraph_t *graph=data->graph;
-  igraph_vector_t *strength=data->strength;
-  igraph_real_t sw=data->sumweights;
-
-  /* Ax */
-  for (j=0; j<size; j++) {
-    long int oldid=(long int) VECTOR(*idx)[j];
-    igraph_vector_int_t *inc=igraph_inclist_get(inclist, oldid);
-    nlen=igraph_vector_int_size(inc);
-    to[j]=0.0;
-    VECTOR(*tmp)[j]=0.0;
-    for (k=0; k<nlen; k++) {
-      long int edge=(long int) VECTOR(*inc)[k];
-      igraph_real_t w=VECTOR(*weights)[edge];
-      long int nei=IGRAPH_OTHER(graph, edge, oldid);
-      long int neimemb=(long int) VECTOR(*mymembership)[nei];
-      if (neimemb==comm) {
-	long int fi=(long int) VECTOR(*idx2)[nei];
-	if (fi < size) {
-	  to[j] += from[fi] * w;
+    /* Bx = Ax - k k^Tx/2m - diag(tmp) x */
+    for (j=begin; j<end; j++) {
+      igraph_real_t ax=0.0;
+      for (k=start[j]; k<start[j+1]; k++) {
+	long int fi=nei[k];
+	if (fi < n) {
+	  ax += w ? from[fi] * w[k] : from[fi];
 	}
-	VECTOR(*tmp)[j] += w;
       }
+      to[j] = ax - ktx*deg[j];
+      to[j] -= tmp[j] * from[j];
     }
   }
-  
-  /* k^Tx/2m */
-  ktx=0.0; ktx2=0.0;
-  for (j=0; j<size+1; j++) {
-    long int oldid=(long int) VECTOR(*idx)[j];
-    igraph_real_t str=VECTOR(*strength)[oldid];
-    if (j<size) { 
-      ktx += from[j] * str;
-    } 
-    ktx2 += str;
-  }
-  ktx = ktx / sw / 2.0;
-  ktx2 = ktx2 / sw / 2.0;
-
-  /* Bx */
-  for (j=0; j<size; j++) {
-    long int oldid=(long int) VECTOR(*idx)[j];
-    igraph_real_t str=VECTOR(*strength)[oldid];
-    to[j] = to[j] - ktx * str;
-    VECTOR(*tmp)[j] = VECTOR(*tmp)[j] - ktx2 * str;
-  }
-
-  /* -d_ij summa l in G B_il */
-  for (j=0; j<size; j++) {
-    to[j] -= VECTOR(*tmp)[j] * from[j];
-  }
 
   return 0;
 }
@@ -1505,6 +1578,13 @@ void igraph_i_error_handler_none(const char *reason, const char *file,
  *    function.
  * \return Error code.
  * 
+ * </para><para>
+ * If igraph was compiled with OpenMP support, the multiplications by
+ * the modularity matrix of large communities (at least ten thousand
+ * vertices) run in parallel. The sums in them are then rounded
+ * differently, so the results may differ slightly with the number of
+ * threads.
+ * 
  * \sa \ref igraph_community_walktrap() and \ref
  * igraph_community_spinglass() for other community structure
  * detection methods.
@@ -1532,23 +1612,20 @@ int igraph_community_leading_eigenvector(const igraph_t *graph,
   long int no_of_edges=igraph_ecount(graph);
   igraph_dqueue_t tosplit;
   igraph_vector_t idx, idx2, mymerges;
-  igraph_vector_t strength, tmp;
+  igraph_vector_t strength, tmp, deg, w, partial;
+  igraph_vector_long_t lstart, lnei, next, head;
   long int staken=0;
-  igraph_adjlist_t adjlist;
-  igraph_inclist_t inclist;
+  igraph_csr_t csr;
   long int i, j, k, l;
   long int communities;
   igraph_vector_t vmembership, *mymembership=membership;
   igraph_i_community_leading_eigenvector_data_t extra;
   igraph_arpack_storage_t storage;
   igraph_real_t mod=0;
-  igraph_arpack_function_t *arpcb1 = 
-    weights ? igraph_i_community_leading_eigenvector_weighted : 
-    igraph_i_community_leading_eigenvector;
-  igraph_arpack_function_t *arpcb2 = 
-    weights ? igraph_i_community_leading_eigenvector2_weighted : 
-    igraph_i_community_leading_eigenvector2;
+  igraph_arpack_function_t *arpcb1 = igraph_i_community_leading_eigenvector;
+  igraph_arpack_function_t *arpcb2 = igraph_i_community_leading_eigenvector;
   igraph_real_t sumweights=0.0;
+  long int nthreads=IGRAPH_I_MAX_THREADS();
 
   if (weights && no_of_edges != igraph_vector_size(weights)) {
     IGRAPH_ERROR("Invalid weight vector length", IGRAPH_EINVAL);
@@ -1652,17 +1729,36 @@ int igraph_community_leading_eigenvector(const igraph_t *graph,
   }
   staken = communities - 1;
 
+  /* The members of each community, in increasing order, as linked
+     lists, so that a split does not need to look at all vertices */
+  IGRAPH_CHECK(igraph_vector_long_init(&head, communities));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &head);
+  IGRAPH_CHECK(igraph_vector_long_reserve(&head, communities+no_of_nodes));
+  igraph_vector_long_fill(&head, -1);
+  IGRAPH_CHECK(igraph_vector_long_init(&next, no_of_nodes));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &next);
+  for (i=no_of_nodes-1; i>=0; i--) {
+    long int c=(long int) VECTOR(*mymembership)[i];
+    VECTOR(next)[i]=VECTOR(head)[c];
+    VECTOR(head)[c]=i;
+  }
+
   IGRAPH_VECTOR_INIT_FINALLY(&tmp, no_of_nodes);
   IGRAPH_CHECK(igraph_vector_resize(&idx, no_of_nodes));
   igraph_vector_null(&idx);
   IGRAPH_VECTOR_INIT_FINALLY(&idx2, no_of_nodes);
-  if (!weights) { 
-    IGRAPH_CHECK(igraph_adjlist_init(graph, &adjlist, IGRAPH_ALL));
-    IGRAPH_FINALLY(igraph_adjlist_destroy, &adjlist);
-  } else {
-    IGRAPH_CHECK(igraph_inclist_init(graph, &inclist, IGRAPH_ALL));
-    IGRAPH_FINALLY(igraph_inclist_destroy, &inclist);
-    IGRAPH_VECTOR_INIT_FINALLY(&strength, no_of_nodes);
+  IGRAPH_CHECK(igraph_csr_init(graph, &csr, IGRAPH_ALL));
+  IGRAPH_FINALLY(igraph_csr_destroy, &csr);
+  IGRAPH_VECTOR_INIT_FINALLY(&deg, no_of_nodes);
+  IGRAPH_CHECK(igraph_vector_long_init(&lstart, no_of_nodes+1));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &lstart);
+  IGRAPH_CHECK(igraph_vector_long_init(&lnei, 
+			       igraph_vector_int_size(&csr.nei)));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &lnei);
+  IGRAPH_VECTOR_INIT_FINALLY(&w, weights ? igraph_vector_int_size(&csr.nei) : 0);
+  IGRAPH_VECTOR_INIT_FINALLY(&partial, nthreads);
+  IGRAPH_VECTOR_INIT_FINALLY(&strength, 0);
+  if (weights) {
     IGRAPH_CHECK(igraph_strength(graph, &strength, igraph_vss_all(), 
 				 IGRAPH_ALL, IGRAPH_LOOPS, weights));
     sumweights=igraph_vector_sum(weights);
@@ -1678,17 +1774,15 @@ int igraph_community_leading_eigenvector(const igraph_t *graph,
   IGRAPH_CHECK(igraph_arpack_storage_init(&storage, (int) no_of_nodes, 20,
 					  (int) no_of_nodes, 1));
   IGRAPH_FINALLY(igraph_arpack_storage_destroy, &storage);
-  extra.idx=&idx;
-  extra.idx2=&idx2;
-  extra.tmp=&tmp;
-  extra.adjlist=&adjlist;
-  extra.inclist=&inclist;
-  extra.weights=weights;
-  extra.sumweights=sumweights;
-  extra.graph=graph;
-  extra.strength=&strength;
-  extra.no_of_edges=no_of_edges;
-  extra.mymembership=mymembership;
+  extra.size=0;
+  extra.start=VECTOR(lstart);
+  extra.nei=VECTOR(lnei);
+  extra.w= weights ? VECTOR(w) : 0;
+  extra.deg=VECTOR(deg);
+  extra.tmp=VECTOR(tmp);
+  extra.m= weights ? sumweights : no_of_edges;
+  extra.nthreads=nthreads;
+  extra.partial=VECTOR(partial);
 
   while (!igraph_dqueue_empty(&tosplit) && staken < steps) {
     long int comm=(long int) igraph_dqueue_pop_back(&tosplit); 
@@ -1699,11 +1793,9 @@ int igraph_community_leading_eigenvector(const igraph_t *graph,
     IGRAPH_STATUSF(("Trying to split community %li... ", 0, comm));
     IGRAPH_ALLOW_INTERRUPTION();
 
-    for (i=0; i<no_of_nodes; i++) {
-      if (VECTOR(*mymembership)[i]==comm) {
-        VECTOR(idx)[size]=i;
-        VECTOR(idx2)[i]=size++;
-      }
+    for (i=VECTOR(head)[comm]; i>=0; i=VECTOR(next)[i]) {
+      VECTOR(idx)[size]=i;
+      VECTOR(idx2)[i]=size++;
     }
 
     staken++;
@@ -1711,6 +1803,10 @@ int igraph_community_leading_eigenvector(const igraph_t *graph,
       continue;
     }
 
+    igraph_i_community_leading_eigenvector_prepare(&extra, &csr, weights,
+						   &strength, mymembership,
+						   comm, &idx, &idx2, size);
+
     /* We solve two eigenproblems, one for the original modularity
        matrix, and one for the modularity matrix after deleting the
        last row and last column from it. This is a trick to find
@@ -1727,7 +1823,6 @@ int igraph_community_leading_eigenvector(const igraph_t *graph,
     options->ncv = 0;   /* 0 means "automatic" in igraph_arpack_rssolve */
     options->nconv = 0;
     options->lworkl = 0;		/* we surely have enough space */
-    extra.comm=comm;
 
     /* We try calling the solver twice, once from a random starting
        point, once from a fixed one. This is because for some hard
@@ -1918,11 +2013,24 @@ int igraph_community_leading_eigenvector(const igraph_t *graph,
     communities++;
     IGRAPH_STATUS("split.\n", 0);
     
-    /* Rewrite the mymembership vector */
-    for (j=0; j<size; j++) {
-      if (storage.v[j] < 0) {
-        long int oldid=(long int) VECTOR(idx)[j];
-        VECTOR(*mymembership)[oldid]=communities-1;
+    /* Rewrite the mymembership vector and the member lists */
+    {
+      long int last[2];
+      IGRAPH_CHECK(igraph_vector_long_push_back(&head, -1));
+      VECTOR(head)[comm]=-1;
+      last[0]=last[1]=-1;
+      for (j=0; j<size; j++) {
+	long int oldid=(long int) VECTOR(idx)[j];
+	long int c= storage.v[j] < 0 ? communities-1 : comm;
+	long int s= storage.v[j] < 0 ? 1 : 0;
+	VECTOR(*mymembership)[oldid]=c;
+	VECTOR(next)[oldid]=-1;
+	if (last[s] < 0) {
+	  VECTOR(head)[c]=oldid;
+	} else {
+	  VECTOR(next)[ last[s] ]=oldid;
+	}
+	last[s]=oldid;
       }
     }
 
@@ -1945,19 +2053,20 @@ int igraph_community_leading_eigenvector(const igraph_t *graph,
   }
   
   igraph_arpack_storage_destroy(&storage);
-  IGRAPH_FINALLY_CLEAN(1);
-  if (!weights) { 
-    igraph_adjlist_destroy(&adjlist);
-    IGRAPH_FINALLY_CLEAN(1);
-  } else {
-    igraph_inclist_destroy(&inclist);
-    igraph_vector_destroy(&strength);
-    IGRAPH_FINALLY_CLEAN(2);
-  }
-  igraph_dqueue_destroy(&tosplit);
-  igraph_vector_destroy(&tmp);
+  igraph_vector_destroy(&strength);
+  igraph_vector_destroy(&partial);
+  igraph_vector_destroy(&w);
+  igraph_vector_long_destroy(&lnei);
+  igraph_vector_long_destroy(&lstart);
+  igraph_vector_destroy(&deg);
+  igraph_csr_destroy(&csr);
+  IGRAPH_FINALLY_CLEAN(8);
   igraph_vector_destroy(&idx2);
-  IGRAPH_FINALLY_CLEAN(3);
+  igraph_vector_destroy(&tmp);
+  igraph_vector_long_destroy(&next);
+  igraph_vector_long_destroy(&head);
+  igraph_dqueue_destroy(&tosplit);
+  IGRAPH_FINALLY_CLEAN(5);
 
   IGRAPH_STATUS("Done.\n", 0);
 
@@ -2087,69 +2196,22 @@ int igraph_le_community_to_membership(const igraph_matrix_t *merges,
 
 /********************************************************************/
 
-/**
- * \ingroup communities
- * \function igraph_community_label_propagation
- * \brief Community detection based on label propagation
- *
- * This function implements the community detection method described in:
- * Raghavan, U.N. and Albert, R. and Kumara, S.: Near linear time algorithm
- * to detect community structures in large-scale networks. Phys Rev E
- * 76, 036106. (2007). This version extends the original method by
- * the ability to take edge weights into consideration and also
- * by allowing some labels to be fixed.
- * 
- * </para><para>
- * Weights are taken into account as follows: when the new label of node
- * i is determined, the algorithm iterates over all edges incident on
- * node i and calculate the total weight of edges leading to other
- * nodes with label 0, 1, 2, ..., k-1 (where k is the number of possible
- * labels). The new label of node i will then be the label whose edges
- * (among the ones incident on node i) have the highest total weight.
- * 
- * \param graph The input graph, should be undirected to make sense.
- * \param membership The membership vector, the result is returned here.
- *    For each vertex it gives the ID of its community (label).
- * \param weights The weight vector, it should contain a positive
- *    weight for all the edges.
- * \param initial The initial state. If NULL, every vertex will have
- *   a different label at the beginning. Otherwise it must be a vector
- *   with an entry for each vertex. Non-negative values denote different
- *   labels, negative entries denote vertices without labels.
- * \param fixed Boolean vector denoting which labels are fixed. Of course
- *   this makes sense only if you provided an initial state, otherwise
- *   this element will be ignored. Also note that vertices without labels
- *   cannot be fixed.
- * \param modularity If not a null pointer, then it must be a pointer
- *   to a real number. The modularity score of the detected community
- *   structure is stored here.
- * \return Error code.
- * 
- * Time complexity: O(m+n)
- * 
- * \example examples/simple/igraph_community_label_propagation.c
- */
-int igraph_community_label_propagation(const igraph_t *graph,
-                                       igraph_vector_t *membership,
-                                       const igraph_vector_t *weights,
-                                       const igraph_vector_t *initial,
-                                       igraph_vector_bool_t *fixed, 
-				       igraph_real_t *modularity) {
+/* Checks the arguments of label propagation and initializes the
+ * membership vector. The labels are shifted by one, so that zero
+ * denotes unlabeled vertices. Returns the number of vertices that
+ * are not fixed in 'no_of_not_fixed_nodes'. */
+
+static int igraph_i_label_propagation_init(const igraph_t *graph,
+					   igraph_vector_t *membership,
+					   const igraph_vector_t *weights,
+					   const igraph_vector_t *initial,
+					   igraph_vector_bool_t *fixed,
+					   long int *no_of_not_fixed_nodes) {
   long int no_of_nodes=igraph_vcount(graph);
   long int no_of_edges=igraph_ecount(graph);
-  long int no_of_not_fixed_nodes=no_of_nodes;
-  long int i, j, k;
-  igraph_adjlist_t al;
-  igraph_inclist_t il;
-  igraph_bool_t running = 1;
+  long int i;
 
-  igraph_vector_t label_counters, dominant_labels, nonzero_labels, node_order;
-
-  /* The implementation uses a trick to avoid negative array indexing:
-   * elements of the membership vector are increased by 1 at the start
-   * of the algorithm; this to allow us to denote unlabeled vertices
-   * (if any) by zeroes. The membership vector is shifted back in the end
-   */
+  *no_of_not_fixed_nodes=no_of_nodes;
 
   /* Do some initial checks */
   if (fixed && igraph_vector_bool_size(fixed) != no_of_nodes) {
@@ -2187,7 +2249,7 @@ int igraph_community_label_propagation(const igraph_t *graph,
             IGRAPH_WARNING("Fixed nodes cannot be unlabeled, ignoring them");
             VECTOR(*fixed)[i] = 0;
           } else {
-            no_of_not_fixed_nodes--;
+            (*no_of_not_fixed_nodes)--;
           }
         }
       }
@@ -2206,6 +2268,111 @@ int igraph_community_label_propagation(const igraph_t *graph,
     }
   }
 
+  return 0;
+}
+
+/* Shifts back the membership vector and permutes the labels in
+ * increasing order. */
+
+static int igraph_i_label_propagation_relabel(igraph_vector_t *membership) {
+  long int no_of_nodes=igraph_vector_size(membership);
+  long int i, j, k;
+  igraph_vector_t label_counters;
+
+  IGRAPH_VECTOR_INIT_FINALLY(&label_counters, no_of_nodes+1);
+
+  igraph_vector_fill(&label_counters, -1);
+  j = 0;
+  for (i=0; i<no_of_nodes; i++) {
+    k = (long)VECTOR(*membership)[i]-1;
+    if (k >= 0) {
+      if (VECTOR(label_counters)[k] == -1) {
+        /* We have seen this label for the first time */
+        VECTOR(label_counters)[k] = j;
+        k = j;
+        j++;
+      } else {
+        k = (long int) VECTOR(label_counters)[k];
+      }
+    } else {
+      /* This is an unlabeled vertex */
+    }
+    VECTOR(*membership)[i] = k;
+  }
+
+  igraph_vector_destroy(&label_counters);
+  IGRAPH_FINALLY_CLEAN(1);
+
+  return 0;
+}
+
+/**
+ * \ingroup communities
+ * \function igraph_community_label_propagation
+ * \brief Community detection based on label propagation
+ *
+ * This function implements the community detection method described in:
+ * Raghavan, U.N. and Albert, R. and Kumara, S.: Near linear time algorithm
+ * to detect community structures in large-scale networks. Phys Rev E
+ * 76, 036106. (2007). This version extends the original method by
+ * the ability to take edge weights into consideration and also
+ * by allowing some labels to be fixed.
+ * 
+ * </para><para>
+ * Weights are taken into account as follows: when the new label of node
+ * i is determined, the algorithm iterates over all edges incident on
+ * node i and calculate the total weight of edges leading to other
+ * nodes with label 0, 1, 2, ..., k-1 (where k is the number of possible
+ * labels). The new label of node i will then be the label whose edges
+ * (among the ones incident on node i) have the highest total weight.
+ * 
+ * \param graph The input graph, should be undirected to make sense.
+ * \param membership The membership vector, the result is returned here.
+ *    For each vertex it gives the ID of its community (label).
+ * \param weights The weight vector, it should contain a positive
+ *    weight for all the edges.
+ * \param initial The initial state. If NULL, every vertex will have
+ *   a different label at the beginning. Otherwise it must be a vector
+ *   with an entry for each vertex. Non-negative values denote different
+ *   labels, negative entries denote vertices without labels.
+ * \param fixed Boolean vector denoting which labels are fixed. Of course
+ *   this makes sense only if you provided an initial state, otherwise
+ *   this element will be ignored. Also note that vertices without labels
+ *   cannot be fixed.
+ * \param modularity If not a null pointer, then it must be a pointer
+ *   to a real number. The modularity score of the detected community
+ *   structure is stored here.
+ * \return Error code.
+ * 
+ * Time complexity: O(m+n)
+ * 
+ * \example examples/simple/igraph_community_label_propagation.c
+ */
+int igraph_community_label_propagation(const igraph_t *graph,
+                                       igraph_vector_t *membership,
+                                       const igraph_vector_t *weights,
+                                       const igraph_vector_t *initial,
+                                       igraph_vector_bool_t *fixed, 
+				       igraph_real_t *modularity) {
+  long int no_of_nodes=igraph_vcount(graph);
+  long int no_of_not_fixed_nodes=no_of_nodes;
+  long int i, j, k;
+  igraph_adjlist_t al;
+  igraph_inclist_t il;
+  igraph_bool_t running = 1;
+
+  igraph_vector_t label_counters, dominant_labels, nonzero_labels, node_order;
+
+  /* The implementation uses a trick to avoid negative array indexing:
+   * elements of the membership vector are increased by 1 at the start
+   * of the algorithm; this to allow us to denote unlabeled vertices
+   * (if any) by zeroes. The membership vector is shifted back in the end
+   */
+
+  IGRAPH_CHECK(igraph_i_label_propagation_init(graph, membership, weights,
+					       initial, fixed,
+					       &no_of_not_fixed_nodes));
+
   /* Create an adjacency/incidence list representation for efficiency.
    * For the unweighted case, the adjacency list is enough. For the
    * weighted case, we need the incidence list */
@@ -2326,25 +2493,7 @@ int igraph_community_label_propagation(const igraph_t *graph,
   RNG_END();
 
   /* Shift back the membership vector, permute labels in increasing order */
-  /* We recycle label_counters here :) */
-  igraph_vector_fill(&label_counters, -1);
-  j = 0;
-  for (i=0; i<no_of_nodes; i++) {
-    k = (long)VECTOR(*membership)[i]-1;
-    if (k >= 0) {
-      if (VECTOR(label_counters)[k] == -1) {
-        /* We have seen this label for the first time */
-        VECTOR(label_counters)[k] = j;
-        k = j;
-        j++;
-      } else {
-        k = (long int) VECTOR(label_counters)[k];
-      }
-    } else {
-      /* This is an unlabeled vertex */
-    }
-    VECTOR(*membership)[i] = k;
-  }
+  IGRAPH_CHECK(igraph_i_label_propagation_relabel(membership));
 
   if (weights)
     igraph_inclist_destroy(&il);
@@ -2366,272 +2515,934 @@ int igraph_community_label_propagation(const igraph_t *graph,
   return 0;
 }
 
-/********************************************************************/
+/* A map from labels or community ids to sums, for the parallel
+ * passes of the label propagation and the multi-level method. Every
+ * thread has one, with room for the distinct keys of the largest
+ * neighborhood only, instead of a dense array with an entry for
+ * every vertex. The keys are hashed into an open addressing table,
+ * the entries are stored in the order of their insertion. */
+
+typedef struct igraph_i_count_map_t {
+  long int size;		/* of the table, a power of two */
+  int shift;
+  long int *table;		/* entry index plus one, or zero */
+  long int *keys, *slots;	/* the key and table slot of each entry */
+  igraph_real_t *vals;
+  long int n;			/* the number of entries */
+} igraph_i_count_map_t;
+
+static void igraph_i_count_map_destroy(igraph_i_count_map_t *map) {
+  igraph_Free(map->table);
+  igraph_Free(map->keys);
+  igraph_Free(map->slots);
+  igraph_Free(map->vals);
+  map->size=0;
+  map->n=0;
+}
 
-/* Structure storing a community */
-typedef struct {
-  igraph_integer_t size;           /* Size of the community */
-  igraph_real_t weight_inside;     /* Sum of edge weights inside community */
-  igraph_real_t weight_all;        /* Sum of edge weights starting/ending
-                                      in the community */
-} igraph_i_multilevel_community;
-
-/* Global community list structure */
-typedef struct {
-  long int communities_no, vertices_no;  /* Number of communities, number of vertices */
-  igraph_real_t weight_sum;              /* Sum of edges weight in the whole graph */
-  igraph_i_multilevel_community *item;   /* List of communities */
-  igraph_vector_t *membership;           /* Community IDs */
-  igraph_vector_t *weights;        /* Graph edge weights */
-} igraph_i_multilevel_community_list;
+/* Makes room for 'maxkeys' distinct keys, the table is kept at
+   most half full. */
+
+static int igraph_i_count_map_reserve(igraph_i_count_map_t *map,
+				      long int maxkeys) {
+  long int size=16;
+  int bits=4;
+  while (size < 2*maxkeys) { size *= 2; bits++; }
+  if (size <= map->size) { return 0; }
+
+  igraph_i_count_map_destroy(map);
+  map->table=igraph_Calloc(size, long int);
+  map->keys=igraph_Calloc(size/2, long int);
+  map->slots=igraph_Calloc(size/2, long int);
+  map->vals=igraph_Calloc(size/2, igraph_real_t);
+  if (!map->table || !map->keys || !map->slots || !map->vals) {
+    IGRAPH_ERROR("Cannot allocate workspace", IGRAPH_ENOMEM);
+  }
+  map->size=size;
+  map->shift=64-bits;
+  return 0;
+}
 
-/* Computes the modularity of a community partitioning */
-igraph_real_t igraph_i_multilevel_community_modularity(
-  const igraph_i_multilevel_community_list *communities) {
-  igraph_real_t result = 0;
-  long int i;
-  igraph_real_t m = communities->weight_sum;
-  
-  for (i = 0; i < communities->vertices_no; i++) {
-    if (communities->item[i].size > 0) {
-      result += (communities->item[i].weight_inside - communities->item[i].weight_all*communities->item[i].weight_all/m)/m;
-    } 
+static long int igraph_i_count_map_slot(const igraph_i_count_map_t *map,
+					long int key) {
+  return (long int) (((unsigned long long) key * 0x9e3779b97f4a7c15ULL) >> 
+		     map->shift);
+}
+
+/* The entry of 'key', a new one with zero sum if it is not in the
+   map yet */
+
+static long int igraph_i_count_map_entry(igraph_i_count_map_t *map,
+					 long int key) {
+  long int s=igraph_i_count_map_slot(map, key), e;
+  while ((e=map->table[s]) != 0) {
+    if (map->keys[e-1] == key) { return e-1; }
+    s=(s+1) & (map->size-1);
+  }
+  e=map->n++;
+  map->keys[e]=key;
+  map->slots[e]=s;
+  map->vals[e]=0.0;
+  map->table[s]=e+1;
+  return e;
+}
+
+/* The sum of 'key', zero if it is not in the map */
+
+static igraph_real_t igraph_i_count_map_get(const igraph_i_count_map_t *map,
+					    long int key) {
+  long int s=igraph_i_count_map_slot(map, key), e;
+  while ((e=map->table[s]) != 0) {
+    if (map->keys[e-1] == key) { return map->vals[e-1]; }
+    s=(s+1) & (map->size-1);
   }
+  return 0.0;
+}
 
-  return result;
+static void igraph_i_count_map_clear(igraph_i_count_map_t *map) {
+  long int e;
+  for (e=0; e<map->n; e++) {
+    map->table[ map->slots[e] ]=0;
+  }
+  map->n=0;
 }
 
-typedef struct {
-  long int from;
-  long int to;
-  long int id;
-} igraph_i_multilevel_link;
+/* Workspace of the parallel label propagation, the label counters
+ * for each thread */
+
+typedef struct igraph_i_label_propagation_ws_t {
+  long int nthreads;
+  igraph_i_count_map_t *maps;
+  long int *batch;
+  long int *newlabel;
+  char *active, *unstable;
+} igraph_i_label_propagation_ws_t;
+
+static void igraph_i_label_propagation_ws_destroy(igraph_i_label_propagation_ws_t *ws) {
+  long int t;
+  for (t=0; t<ws->nthreads && ws->maps; t++) {
+    igraph_i_count_map_destroy(&ws->maps[t]);
+  }
+  igraph_Free(ws->maps);
+  igraph_Free(ws->batch);
+  igraph_Free(ws->newlabel);
+  igraph_Free(ws->active);
+  igraph_Free(ws->unstable);
+}
 
-int igraph_i_multilevel_link_cmp(const void *a, const void *b)
-{
-  long int r = (((igraph_i_multilevel_link*)a)->from -
-                ((igraph_i_multilevel_link*)b)->from);
-  if (r != 0) return (int) r;
-  
-  return (int) (((igraph_i_multilevel_link*)a)->to -
-		((igraph_i_multilevel_link*)b)->to);
+/* Pseudo-random ordering of the labels, for breaking the ties. It
+ * depends on the vertex, the label and the salt of the sweep only,
+ * so it gives the same result in any thread. */
+
+static unsigned long long igraph_i_label_propagation_hash(long int v, 
+							   long int label,
+							   unsigned long long salt) {
+  unsigned long long x= salt ^ ((unsigned long long) v << 32) ^ 
+    (unsigned long long) label;
+  x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
 }
 
-/* removes multiple edges and returns new edge id's for each edge in |E|log|E| */
-int igraph_i_multilevel_simplify_multiple(igraph_t *graph, igraph_vector_t *eids) {
-  long int ecount = igraph_ecount(graph);
-  long int i, l = -1, last_from = -1, last_to = -1;
-  igraph_bool_t directed = igraph_is_directed(graph);
-  igraph_integer_t from, to;
-  igraph_vector_t edges;
-  igraph_i_multilevel_link *links;
+/* Greedy coloring of the vertices, so that two vertices have
+ * different colors if one is the in-neighbor of the other. The
+ * vertices that are not fixed are listed by color in 'order', the
+ * ones of color 'c' are from position cstart[c] to cstart[c+1]-1. */
+
+static int igraph_i_label_propagation_coloring(const igraph_csr_t *in,
+					       const igraph_csr_t *out,
+					       const igraph_vector_bool_t *fixed,
+					       igraph_vector_long_t *order,
+					       igraph_vector_long_t *cstart) {
+  long int n=in->length, i, j, c, ncol=0, p=0;
+  igraph_vector_long_t color, mark;
+  
+  IGRAPH_CHECK(igraph_vector_long_init(&color, n));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &color);
+  IGRAPH_CHECK(igraph_vector_long_init(&mark, 2*n+1));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &mark);
+  igraph_vector_long_fill(&color, -1);
+  igraph_vector_long_fill(&mark, -1);
 
-  /* Make sure there's enough space in eids to store the new edge IDs */
-  IGRAPH_CHECK(igraph_vector_resize(eids, ecount));
+  for (i=0; i<n; i++) {
+    const igraph_csr_t *csr[2];
+    int k;
+    csr[0]=in; csr[1]=out;
+    for (k=0; k < (in == out ? 1 : 2); k++) {
+      long int deg=igraph_csr_degree(csr[k], i);
+      const int *neis=igraph_csr_neighbors(csr[k], i);
+      for (j=0; j<deg; j++) {
+	c=VECTOR(color)[ neis[j] ];
+	if (c >= 0) { VECTOR(mark)[c]=i; }
+      }
+    }
+    for (c=0; VECTOR(mark)[c] == i; c++) ;
+    VECTOR(color)[i]=c;
+    if (c >= ncol) { ncol=c+1; }
+  }
 
-  links = igraph_Calloc(ecount, igraph_i_multilevel_link);
-  if (links == 0) {
-    IGRAPH_ERROR("multi-level community structure detection failed", IGRAPH_ENOMEM);
+  IGRAPH_CHECK(igraph_vector_long_resize(cstart, ncol+1));
+  igraph_vector_long_null(cstart);
+  for (i=0; i<n; i++) {
+    if (!fixed || !VECTOR(*fixed)[i]) { 
+      VECTOR(*cstart)[ VECTOR(color)[i] + 1 ] += 1;
+      p++;
+    }
+  }
+  for (c=0; c<ncol; c++) {
+    VECTOR(*cstart)[c+1] += VECTOR(*cstart)[c];
+  }
+  IGRAPH_CHECK(igraph_vector_long_update(&mark, cstart));
+  IGRAPH_CHECK(igraph_vector_long_resize(order, p));
+  for (i=0; i<n; i++) {
+    if (!fixed || !VECTOR(*fixed)[i]) { 
+      VECTOR(*order)[ VECTOR(mark)[ VECTOR(color)[i] ]++ ]=i;
+    }
   }
-  IGRAPH_FINALLY(free, links);
 
-  for (i = 0; i < ecount; i++) {
-    igraph_edge(graph, (igraph_integer_t) i, &from, &to);
-    links[i].from = from;
-    links[i].to = to;
-    links[i].id = i;
-  }  
+  igraph_vector_long_destroy(&mark);
+  igraph_vector_long_destroy(&color);
+  IGRAPH_FINALLY_CLEAN(2);
 
-  qsort((void*)links, (size_t) ecount, sizeof(igraph_i_multilevel_link),
-      igraph_i_multilevel_link_cmp);
+  return 0;
+}
 
-  IGRAPH_VECTOR_INIT_FINALLY(&edges, 0);
-  for (i = 0; i < ecount; i++) {
-    if (links[i].from == last_from && links[i].to == last_to) {
-      VECTOR(*eids)[links[i].id] = l;
-      continue;
-    }
+#define IGRAPH_I_LABEL_PROPAGATION_MIN_PARALLEL 1000
 
-    last_from = links[i].from;
-    last_to = links[i].to;
+/**
+ * \function igraph_community_label_propagation_parallel
+ * \brief Label propagation in parallel, revisiting the changed regions only
+ *
+ * This is a variant of \ref igraph_community_label_propagation()
+ * that updates the labels in parallel, if igraph was compiled with
+ * OpenMP support, and stops early in the parts of the graph where
+ * the labels are already stable.
+ *
+ * </para><para>
+ * The vertices are colored greedily, so that adjacent vertices have
+ * different colors. A sweep goes over the colors, and the new labels
+ * of the vertices of a color are computed in parallel, then they are
+ * updated together. Only the active vertices are visited: at the
+ * beginning every vertex that is not fixed is active, later only the
+ * ones with a neighbor (in-neighbor, for directed graphs) whose
+ * label changed since their last visit. A vertex keeps its label
+ * if it is among the dominant ones. The algorithm stops when every
+ * vertex visited in a sweep already had a dominant label, so every
+ * vertex has a dominant label at the end.
+ *
+ * </para><para>
+ * Ties between the dominant labels are broken pseudo-randomly,
+ * using the random number generator of igraph once for each sweep;
+ * the result only depends on its state, and not on the number of
+ * threads.
+ *
+ * </para><para>
+ * Besides the CSR snapshots of the graph, the function needs O(n)
+ * memory, and every thread counts the labels of the neighbors in a
+ * hash table of O(d) size, where d is the maximum (in-)degree.
+ *
+ * \param graph The input graph, should be undirected to make sense.
+ * \param membership The membership vector, the result is returned here.
+ *    For each vertex it gives the ID of its community (label).
+ * \param weights The weight vector, it should contain a positive
+ *    weight for all the edges.
+ * \param initial The initial state. If NULL, every vertex will have
+ *   a different label at the beginning. Otherwise it must be a vector
+ *   with an entry for each vertex. Non-negative values denote different
+ *   labels, negative entries denote vertices without labels.
+ * \param fixed Boolean vector denoting which labels are fixed. Of course
+ *   this makes sense only if you provided an initial state, otherwise
+ *   this element will be ignored. Also note that vertices without labels
+ *   cannot be fixed.
+ * \param modularity If not a null pointer, then it must be a pointer
+ *   to a real number. The modularity score of the detected community
+ *   structure is stored here.
+ * \param changes If not a null pointer, then it must be an initialized
+ *   vector, the number of changed labels in each sweep is stored
+ *   here. Its length is the number of sweeps.
+ * \return Error code.
+ * 
+ * Time complexity: O(m+n) for a sweep, usually much less after the
+ * first few sweeps.
+ * 
+ * \example examples/simple/igraph_community_label_propagation_parallel.c
+ */
 
-    igraph_vector_push_back(&edges, last_from);
-    igraph_vector_push_back(&edges, last_to);
+int igraph_community_label_propagation_parallel(const igraph_t *graph,
+						igraph_vector_t *membership,
+						const igraph_vector_t *weights,
+						const igraph_vector_t *initial,
+						igraph_vector_bool_t *fixed,
+						igraph_real_t *modularity,
+						igraph_vector_t *changes) {
 
-    l++;
+  long int no_of_nodes=igraph_vcount(graph);
+  long int no_of_not_fixed_nodes;
+  long int nthreads=IGRAPH_I_MAX_THREADS();
+  long int i, ncolors, changed, unstable, maxdeg=0;
+  igraph_csr_t in, out, *outp=&in;
+  igraph_vector_long_t order, cstart;
+  igraph_i_label_propagation_ws_t ws;
+  igraph_real_t *label=0;
+
+  IGRAPH_CHECK(igraph_i_label_propagation_init(graph, membership, weights,
+					       initial, fixed,
+					       &no_of_not_fixed_nodes));
+  if (!initial) { fixed=0; }
+  label=VECTOR(*membership);
+
+  /* The labels of the in-neighbors are counted, the out-neighbors are
+     activated when a label changes */
+  IGRAPH_CHECK(igraph_csr_init(graph, &in, IGRAPH_IN));
+  IGRAPH_FINALLY(igraph_csr_destroy, &in);
+  if (igraph_is_directed(graph)) {
+    IGRAPH_CHECK(igraph_csr_init(graph, &out, IGRAPH_OUT));
+    IGRAPH_FINALLY(igraph_csr_destroy, &out);
+    outp=&out;
+  }
+
+  IGRAPH_CHECK(igraph_vector_long_init(&order, 0));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &order);
+  IGRAPH_CHECK(igraph_vector_long_init(&cstart, 0));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &cstart);
+  IGRAPH_CHECK(igraph_i_label_propagation_coloring(&in, outp, fixed, &order,
+						   &cstart));
+  ncolors=igraph_vector_long_size(&cstart)-1;
+
+  memset(&ws, 0, sizeof(ws));
+  IGRAPH_FINALLY(igraph_i_label_propagation_ws_destroy, &ws);
+  ws.maps=igraph_Calloc(nthreads, igraph_i_count_map_t);
+  ws.batch=igraph_Calloc(no_of_nodes+1, long int);
+  ws.newlabel=igraph_Calloc(no_of_nodes+1, long int);
+  ws.active=igraph_Calloc(no_of_nodes+1, char);
+  ws.unstable=igraph_Calloc(no_of_nodes+1, char);
+  if (!ws.maps || !ws.batch || !ws.newlabel || !ws.active || 
+      !ws.unstable) {
+    IGRAPH_ERROR("Label propagation failed", IGRAPH_ENOMEM);
+  }
+  ws.nthreads=nthreads;
+  /* A vertex sees at most as many labels as its in-degree */
+  for (i=0; i<no_of_nodes; i++) {
+    long int deg=igraph_csr_degree(&in, i);
+    if (deg > maxdeg) { maxdeg=deg; }
+  }
+  if (maxdeg > no_of_nodes) { maxdeg=no_of_nodes; }
+  for (i=0; i<nthreads; i++) {
+    IGRAPH_CHECK(igraph_i_count_map_reserve(&ws.maps[i], maxdeg));
+  }
+  for (i=0; i<no_of_nodes; i++) {
+    ws.active[i]= !fixed || !VECTOR(*fixed)[i];
+  }
 
-    VECTOR(*eids)[links[i].id] = l;
+  if (changes) {
+    igraph_vector_clear(changes);
   }
 
-  free(links);
-  IGRAPH_FINALLY_CLEAN(1);
+  RNG_BEGIN();
 
-  igraph_destroy(graph);
-  IGRAPH_CHECK(igraph_create(graph, &edges, igraph_vcount(graph), directed));
+  do {
+    unsigned long long salt;
+    long int col;
 
-  igraph_vector_destroy(&edges);
-  IGRAPH_FINALLY_CLEAN(1);
+    salt=(unsigned long long) RNG_INTEGER(0, 0x7fffffff) << 31 | 
+      (unsigned long long) RNG_INTEGER(0, 0x7fffffff);
+    changed=0;
+    unstable=0;
 
-  return 0;
-}
+    for (col=0; col<ncolors; col++) {
+      long int j, nb=0;
 
-typedef struct {
-  long int community;
-  igraph_real_t weight;
-} igraph_i_multilevel_community_link;
+      /* The active vertices of this color */
+      for (j=VECTOR(cstart)[col]; j<VECTOR(cstart)[col+1]; j++) {
+	long int v=VECTOR(order)[j];
+	if (ws.active[v]) {
+	  ws.active[v]=0;
+	  ws.batch[nb++]=v;
+	}
+      }
 
-int igraph_i_multilevel_community_link_cmp(const void *a, const void *b)
-{
-  return (int) (((igraph_i_multilevel_community_link*)a)->community -
-		((igraph_i_multilevel_community_link*)b)->community);
-}
+      /* Their new labels; they are not neighbors, so they can be
+	 computed independently */
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 256) if(nb >= IGRAPH_I_LABEL_PROPAGATION_MIN_PARALLEL)
+      for (j=0; j<nb; j++) {
+	igraph_i_count_map_t *map=&ws.maps[ IGRAPH_I_THREAD_NUM() ];
+	long int v=ws.batch[j], own=(long int) label[v], best=own;
+	long int deg=igraph_csr_degree(&in, v), k;
+	const int *neis=igraph_csr_neighbors(&in, v);
+	const int *eids=igraph_csr_incident(&in, v);
+	igraph_real_t max_count=0.0;
+	unsigned long long best_hash=0;
+
+	for (k=0; k<deg; k++) {
+	  long int l=(long int) label[ neis[k] ], e;
+	  if (l == 0) { continue; } /* no label yet */
+	  e=igraph_i_count_map_entry(map, l);
+	  map->vals[e] += weights ? VECTOR(*weights)[ eids[k] ] : 1.0;
+	  if (map->vals[e] > max_count) { max_count=map->vals[e]; }
+	}
 
-/**
- * Given a graph, a community structure and a vertex ID, this method
- * calculates:
- *
- * - edges: the list of edge IDs that are incident on the vertex
- * - weight_all: the total weight of these edges
- * - weight_inside: the total weight of edges that stay within the same
- *   community where the given vertex is right now, excluding loop edges
- * - weight_loop: the total weight of loop edges
- * - links_community and links_weight: together these two vectors list the
- *   communities incident on this vertex and the total weight of edges
- *   pointing to these communities
- */
-int igraph_i_multilevel_community_links(const igraph_t *graph,
-  const igraph_i_multilevel_community_list *communities,
-  igraph_integer_t vertex, igraph_vector_t *edges,
-  igraph_real_t *weight_all, igraph_real_t *weight_inside, igraph_real_t *weight_loop,
-  igraph_vector_t *links_community, igraph_vector_t *links_weight) {
-  
-  long int i, n, last = -1, c = -1;
-  igraph_real_t weight = 1;
-  long int to, to_community;
-  long int community = (long int) VECTOR(*(communities->membership))[(long int)vertex];
-  igraph_i_multilevel_community_link *links;
+	/* Keep the current label if it is dominant, otherwise choose
+	   one of the dominant labels. So a label only changes if the
+	   vertex is unstable, and a sweep without unstable vertices
+	   does not activate any. The labels with zero weight only do
+	   not count. */
+	if (max_count > 0) {
+	  ws.unstable[v]= own == 0 || 
+	    igraph_i_count_map_get(map, own) != max_count;
+	  for (k=0; ws.unstable[v] && k<map->n; k++) {
+	    long int l=map->keys[k];
+	    if (map->vals[k] == max_count) {
+	      unsigned long long h=igraph_i_label_propagation_hash(v, l, salt);
+	      if (best_hash == 0 || h < best_hash) {
+		best=l;
+		best_hash=h | 1;
+	      }
+	    }
+	  }
+	} else {
+	  ws.unstable[v]=0;
+	}
+	ws.newlabel[v]=best;
+
+	igraph_i_count_map_clear(map);
+      }
+
+      /* Update them, and activate their out-neighbors */
+      for (j=0; j<nb; j++) {
+	long int v=ws.batch[j], k, deg;
+	const int *neis;
+	unstable += ws.unstable[v];
+	if (ws.newlabel[v] == (long int) label[v]) { continue; }
+	label[v]=ws.newlabel[v];
+	changed++;
+	deg=igraph_csr_degree(outp, v);
+	neis=igraph_csr_neighbors(outp, v);
+	for (k=0; k<deg; k++) {
+	  long int u=neis[k];
+	  if (!fixed || !VECTOR(*fixed)[u]) { ws.active[u]=1; }
+	}
+      }
+    }
 
-  *weight_all = *weight_inside = *weight_loop = 0;
+    if (changes) {
+      IGRAPH_CHECK(igraph_vector_push_back(changes, changed));
+    }
 
-  igraph_vector_clear(links_community);
-  igraph_vector_clear(links_weight);
+    IGRAPH_ALLOW_INTERRUPTION();
+  } while (unstable > 0);
 
-  /* Get the list of incident edges */
-  igraph_incident(graph, edges, vertex, IGRAPH_ALL);
+  RNG_END();
 
-  n = igraph_vector_size(edges);
-  links = igraph_Calloc(n, igraph_i_multilevel_community_link);
-  if (links == 0) {
-    IGRAPH_ERROR("multi-level community structure detection failed", IGRAPH_ENOMEM);
+  igraph_i_label_propagation_ws_destroy(&ws);
+  igraph_vector_long_destroy(&cstart);
+  igraph_vector_long_destroy(&order);
+  if (outp != &in) {
+    igraph_csr_destroy(&out);
+    IGRAPH_FINALLY_CLEAN(1);
   }
-  IGRAPH_FINALLY(igraph_free, links);
+  igraph_csr_destroy(&in);
+  IGRAPH_FINALLY_CLEAN(4);
 
-  for (i = 0; i < n; i++) {
-    long int eidx = (long int) VECTOR(*edges)[i];
-    weight = VECTOR(*communities->weights)[eidx];
+  /* Shift back the membership vector, permute labels in increasing order */
+  IGRAPH_CHECK(igraph_i_label_propagation_relabel(membership));
 
-    to = IGRAPH_OTHER(graph, eidx, vertex);
+  if (modularity) {
+    IGRAPH_CHECK(igraph_modularity(graph, membership, modularity,
+				   weights));
+  }
 
-    *weight_all += weight;
-    if (to == vertex) {
-      *weight_loop += weight;
-      
-      links[i].community = community;
-      links[i].weight = 0;
-      continue;
+  return 0;
+}
+
+/********************************************************************/
+
+/* The graph of a level of the multi-level method, in compact
+ * adjacency arrays. Every edge is stored at both of its endpoints,
+ * except for the loop edges: their weight is added to 'loop', twice,
+ * just like to 'degree'. After each level the communities are
+ * aggregated into the vertices of the next level, directly on these
+ * arrays, see igraph_i_multilevel_graph_aggregate(). */
+
+typedef struct igraph_i_multilevel_graph_t {
+  long int vcount;
+  igraph_real_t weight_sum;     /* twice the total edge weight */
+  igraph_vector_long_t start;   /* where the neighbors of a vertex start */
+  igraph_vector_long_t nei;     /* the neighbors */
+  igraph_vector_t weight;       /* and the weights of the edges to them */
+  igraph_vector_t loop;         /* weight of the loop edges, twice */
+  igraph_vector_t degree;       /* weight of all incident edges */
+} igraph_i_multilevel_graph_t;
+
+static void igraph_i_multilevel_graph_destroy(igraph_i_multilevel_graph_t *g) {
+  igraph_vector_long_destroy(&g->start);
+  igraph_vector_long_destroy(&g->nei);
+  igraph_vector_destroy(&g->weight);
+  igraph_vector_destroy(&g->loop);
+  igraph_vector_destroy(&g->degree);
+}
+
+static int igraph_i_multilevel_graph_init(igraph_i_multilevel_graph_t *g,
+					  const igraph_t *graph,
+					  const igraph_vector_t *weights) {
+  long int no_of_nodes=igraph_vcount(graph);
+  long int no_of_edges=igraph_ecount(graph);
+  long int i;
+  igraph_vector_long_t pos;
+
+  memset(g, 0, sizeof(*g));
+  IGRAPH_FINALLY(igraph_i_multilevel_graph_destroy, g);
+  IGRAPH_CHECK(igraph_vector_long_init(&g->start, no_of_nodes+1));
+  IGRAPH_CHECK(igraph_vector_long_init(&g->nei, 0));
+  IGRAPH_CHECK(igraph_vector_init(&g->weight, 0));
+  IGRAPH_CHECK(igraph_vector_init(&g->loop, no_of_nodes));
+  IGRAPH_CHECK(igraph_vector_init(&g->degree, no_of_nodes));
+  g->vcount=no_of_nodes;
+  g->weight_sum=0.0;
+
+  for (i=0; i<no_of_edges; i++) {
+    long int from=IGRAPH_FROM(graph, i), to=IGRAPH_TO(graph, i);
+    igraph_real_t w= weights ? VECTOR(*weights)[i] : 1.0;
+    VECTOR(g->degree)[from] += w;
+    VECTOR(g->degree)[to] += w;
+    g->weight_sum += 2*w;
+    if (from == to) {
+      VECTOR(g->loop)[from] += 2*w;
+    } else {
+      VECTOR(g->start)[from+1] += 1;
+      VECTOR(g->start)[to+1] += 1;
+    }
+  }
+  for (i=0; i<no_of_nodes; i++) {
+    VECTOR(g->start)[i+1] += VECTOR(g->start)[i];
+  }
+
+  IGRAPH_CHECK(igraph_vector_long_resize(&g->nei, VECTOR(g->start)[no_of_nodes]));
+  IGRAPH_CHECK(igraph_vector_resize(&g->weight, VECTOR(g->start)[no_of_nodes]));
+  IGRAPH_CHECK(igraph_vector_long_copy(&pos, &g->start));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &pos);
+  for (i=0; i<no_of_edges; i++) {
+    long int from=IGRAPH_FROM(graph, i), to=IGRAPH_TO(graph, i);
+    igraph_real_t w= weights ? VECTOR(*weights)[i] : 1.0;
+    if (from != to) {
+      long int p1=VECTOR(pos)[from]++, p2=VECTOR(pos)[to]++;
+      VECTOR(g->nei)[p1]=to;
+      VECTOR(g->weight)[p1]=w;
+      VECTOR(g->nei)[p2]=from;
+      VECTOR(g->weight)[p2]=w;
     }
+  }
+  igraph_vector_long_destroy(&pos);
+  IGRAPH_FINALLY_CLEAN(2);
 
-    to_community = (long int)VECTOR(*(communities->membership))[to];
-    if (community == to_community)
-      *weight_inside += weight;
+  return 0;
+}
 
-    /* debug("Link %ld (C: %ld) <-> %ld (C: %ld)\n", vertex, community, to, to_community); */
-    
-    links[i].community = to_community;
-    links[i].weight = weight;
+/* Collects the communities of the neighbors of 'v', and the total
+   weight of the edges to each of them. The weights are summed in
+   'acc', indexed by community, the communities are listed in
+   'touched', and their number is returned. 'acc' and 'seen' must be
+   cleared by the caller. This does not allocate memory, so it can
+   run in a parallel region, with a workspace for each thread. */
+
+static long int igraph_i_multilevel_links(const igraph_i_multilevel_graph_t *g,
+					  const igraph_real_t *membership,
+					  long int v, igraph_real_t *acc,
+					  char *seen, long int *touched) {
+  long int k, kend=VECTOR(g->start)[v+1], n=0;
+  const long int *nei=VECTOR(g->nei);
+  const igraph_real_t *weight=VECTOR(g->weight);
+  for (k=VECTOR(g->start)[v]; k<kend; k++) {
+    long int c=(long int) membership[ nei[k] ];
+    if (!seen[c]) {
+      seen[c]=1;
+      touched[n++]=c;
+    }
+    acc[c] += weight[k];
   }
+  return n;
+}
 
-  /* Sort links by community ID and merge the same */
-  qsort((void*)links, (size_t) n, sizeof(igraph_i_multilevel_community_link),
-      igraph_i_multilevel_community_link_cmp);
-  for (i = 0; i < n; i++) {
-    to_community = links[i].community;
-    if (to_community != last) {
-      igraph_vector_push_back(links_community, to_community);
-      igraph_vector_push_back(links_weight, links[i].weight);
-      last = to_community;
-      c++;
-    } else {    
-      VECTOR(*links_weight)[c] += links[i].weight;
+/* The community that gives the largest modularity gain for 'v', if
+   it is positive; otherwise its own community 'own'. 'own_tot' is
+   the total degree of the own community, without 'v'. Ties are
+   broken towards the smaller community id, so the result does not
+   depend on the order of the neighbors. */
+
+static long int igraph_i_multilevel_best(const igraph_i_multilevel_graph_t *g,
+					 const igraph_real_t *tot, long int own,
+					 igraph_real_t own_tot, igraph_real_t degree,
+					 const igraph_real_t *acc,
+					 const long int *touched, long int n) {
+  long int j, best=own;
+  igraph_real_t best_gain=0.0;
+  for (j=0; j<n; j++) {
+    long int c=touched[j];
+    igraph_real_t ctot= c == own ? own_tot : tot[c];
+    igraph_real_t gain=acc[c] - ctot * degree / g->weight_sum;
+    if (gain > best_gain || (gain == best_gain && gain > 0 && c < best)) {
+      best=c;
+      best_gain=gain;
     }
   }
+  return best;
+}
+
+/* The same for the parallel pass, where the weights of the links to
+   the neighboring communities are in a count map. */
+
+static long int igraph_i_multilevel_links_map(const igraph_i_multilevel_graph_t *g,
+					      const igraph_real_t *membership,
+					      long int v, 
+					      igraph_i_count_map_t *map) {
+  long int k, kend=VECTOR(g->start)[v+1];
+  const long int *nei=VECTOR(g->nei);
+  const igraph_real_t *weight=VECTOR(g->weight);
+  for (k=VECTOR(g->start)[v]; k<kend; k++) {
+    long int c=(long int) membership[ nei[k] ];
+    map->vals[ igraph_i_count_map_entry(map, c) ] += weight[k];
+  }
+  return map->n;
+}
 
-  igraph_free(links);
+static long int igraph_i_multilevel_best_map(const igraph_i_multilevel_graph_t *g,
+					     const igraph_real_t *tot, long int own,
+					     igraph_real_t own_tot, 
+					     igraph_real_t degree,
+					     const igraph_i_count_map_t *map) {
+  long int j, best=own;
+  igraph_real_t best_gain=0.0;
+  for (j=0; j<map->n; j++) {
+    long int c=map->keys[j];
+    igraph_real_t ctot= c == own ? own_tot : tot[c];
+    igraph_real_t gain=map->vals[j] - ctot * degree / g->weight_sum;
+    if (gain > best_gain || (gain == best_gain && gain > 0 && c < best)) {
+      best=c;
+      best_gain=gain;
+    }
+  }
+  return best;
+}
+
+/* Renumbers the communities to 0, 1, 2, ..., keeping their order,
+   and returns the number of communities in 'no'. */
+
+static int igraph_i_multilevel_reindex(igraph_vector_t *membership, 
+				       long int *no) {
+  long int i, n=igraph_vector_size(membership), c=0;
+  igraph_vector_long_t newid;
+
+  IGRAPH_CHECK(igraph_vector_long_init(&newid, n));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &newid);
+  for (i=0; i<n; i++) {
+    VECTOR(newid)[ (long int) VECTOR(*membership)[i] ]=1;
+  }
+  for (i=0; i<n; i++) {
+    if (VECTOR(newid)[i]) { VECTOR(newid)[i]=c++; }
+  }
+  for (i=0; i<n; i++) {
+    VECTOR(*membership)[i]=VECTOR(newid)[ (long int) VECTOR(*membership)[i] ];
+  }
+  igraph_vector_long_destroy(&newid);
   IGRAPH_FINALLY_CLEAN(1);
 
+  *no=c;
   return 0;
 }
 
-igraph_real_t igraph_i_multilevel_community_modularity_gain(
-  const igraph_i_multilevel_community_list *communities,
-  igraph_integer_t community, igraph_integer_t vertex,
-  igraph_real_t weight_all, igraph_real_t weight_inside) {
-  IGRAPH_UNUSED(vertex);
-  return weight_inside -
-      communities->item[(long int)community].weight_all*weight_all/communities->weight_sum;
-}
+/* Replaces the graph with the graph of its communities: the
+   communities become the vertices, the edges between them are
+   merged, and the edges within them become loop edges. */
+
+static int igraph_i_multilevel_graph_aggregate(igraph_i_multilevel_graph_t *g,
+					       const igraph_vector_t *membership,
+					       long int no_comms) {
+  long int n=g->vcount, i, j, c, k, p=0;
+  igraph_vector_long_t order, cstart, touched, start, nei;
+  igraph_vector_t acc, weight, loop, degree;
+  char *seen;
+
+  seen=igraph_Calloc(no_comms > 0 ? no_comms : 1, char);
+  if (!seen) {
+    IGRAPH_ERROR("multi-level community structure detection failed", 
+		 IGRAPH_ENOMEM);
+  }
+  IGRAPH_FINALLY(igraph_free, seen);
+  IGRAPH_CHECK(igraph_vector_long_init(&order, n));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &order);
+  IGRAPH_CHECK(igraph_vector_long_init(&cstart, no_comms+1));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &cstart);
+  IGRAPH_CHECK(igraph_vector_long_init(&touched, no_comms));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &touched);
+  IGRAPH_CHECK(igraph_vector_long_init(&start, no_comms+1));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &start);
+  IGRAPH_CHECK(igraph_vector_long_init(&nei, 0));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &nei);
+  IGRAPH_CHECK(igraph_vector_long_reserve(&nei, igraph_vector_long_size(&g->nei)));
+  IGRAPH_VECTOR_INIT_FINALLY(&acc, no_comms);
+  IGRAPH_VECTOR_INIT_FINALLY(&weight, 0);
+  IGRAPH_CHECK(igraph_vector_reserve(&weight, igraph_vector_size(&g->weight)));
+  IGRAPH_VECTOR_INIT_FINALLY(&loop, no_comms);
+  IGRAPH_VECTOR_INIT_FINALLY(&degree, no_comms);
+
+  /* The vertices, ordered by community */
+  for (i=0; i<n; i++) {
+    VECTOR(cstart)[ (long int) VECTOR(*membership)[i] + 1 ] += 1;
+  }
+  for (c=0; c<no_comms; c++) {
+    VECTOR(cstart)[c+1] += VECTOR(cstart)[c];
+  }
+  for (i=0; i<n; i++) {
+    c=(long int) VECTOR(*membership)[i];
+    VECTOR(order)[ VECTOR(cstart)[c]++ ]=i;
+  }
+  for (c=no_comms; c>0; c--) {
+    VECTOR(cstart)[c]=VECTOR(cstart)[c-1];
+  }
+  VECTOR(cstart)[0]=0;
+
+  for (c=0; c<no_comms; c++) {
+    long int nt=0;
+    VECTOR(start)[c]=p;
+    for (j=VECTOR(cstart)[c]; j<VECTOR(cstart)[c+1]; j++) {
+      long int v=VECTOR(order)[j];
+      VECTOR(loop)[c] += VECTOR(g->loop)[v];
+      VECTOR(degree)[c] += VECTOR(g->degree)[v];
+      for (k=VECTOR(g->start)[v]; k<VECTOR(g->start)[v+1]; k++) {
+	long int d=(long int) VECTOR(*membership)[ VECTOR(g->nei)[k] ];
+	if (d == c) {
+	  VECTOR(loop)[c] += VECTOR(g->weight)[k];
+	  continue;
+	}
+	if (!seen[d]) {
+	  seen[d]=1;
+	  VECTOR(touched)[nt++]=d;
+	}
+	VECTOR(acc)[d] += VECTOR(g->weight)[k];
+      }
+    }
+    for (j=0; j<nt; j++) {
+      long int d=VECTOR(touched)[j];
+      /* reserved, cannot fail */
+      igraph_vector_long_push_back(&nei, d);
+      igraph_vector_push_back(&weight, VECTOR(acc)[d]);
+      VECTOR(acc)[d]=0.0;
+      seen[d]=0;
+    }
+    p += nt;
+  }
+  VECTOR(start)[no_comms]=p;
+
+  igraph_vector_long_destroy(&g->start);
+  igraph_vector_long_destroy(&g->nei);
+  igraph_vector_destroy(&g->weight);
+  igraph_vector_destroy(&g->loop);
+  igraph_vector_destroy(&g->degree);
+  g->start=start;
+  g->nei=nei;
+  g->weight=weight;
+  g->loop=loop;
+  g->degree=degree;
+  g->vcount=no_comms;
+  
+  igraph_vector_destroy(&acc);
+  igraph_vector_long_destroy(&touched);
+  igraph_vector_long_destroy(&cstart);
+  igraph_vector_long_destroy(&order);
+  igraph_Free(seen);
+  IGRAPH_FINALLY_CLEAN(10);
 
-/* Shrinks communities into single vertices, keeping all the edges.
- * This method is internal because it destroys the graph in-place and
- * creates a new one -- this is fine for the multilevel community
- * detection where a copy of the original graph is used anyway.
- * The membership vector will also be rewritten by the underlying
- * igraph_membership_reindex call */
-int igraph_i_multilevel_shrink(igraph_t *graph, igraph_vector_t *membership) {
-  igraph_vector_t edges;
-  long int no_of_nodes = igraph_vcount(graph);
-  long int no_of_edges = igraph_ecount(graph);
-  igraph_bool_t directed = igraph_is_directed(graph);
+  return 0;
+}
 
-  long int i;
-  igraph_eit_t eit;
+/* A greedy coloring of the vertices, so that adjacent vertices have
+   different colors. The vertices are listed by color in 'order',
+   and the vertices of color 'c' are from position cstart[c] to
+   cstart[c+1]-1, in increasing order. Returns the number of colors
+   in 'no'. */
+
+static int igraph_i_multilevel_coloring(const igraph_i_multilevel_graph_t *g,
+					igraph_vector_long_t *order,
+					igraph_vector_long_t *cstart,
+					long int *no) {
+  long int n=g->vcount, i, k, c, ncol=0;
+  igraph_vector_long_t color, mark;
+
+  IGRAPH_CHECK(igraph_vector_long_init(&color, n));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &color);
+  IGRAPH_CHECK(igraph_vector_long_init(&mark, n+1));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &mark);
+  igraph_vector_long_fill(&color, -1);
+  igraph_vector_long_fill(&mark, -1);
 
-  if (no_of_nodes == 0)
-    return 0;
+  for (i=0; i<n; i++) {
+    for (k=VECTOR(g->start)[i]; k<VECTOR(g->start)[i+1]; k++) {
+      c=VECTOR(color)[ VECTOR(g->nei)[k] ];
+      if (c >= 0) { VECTOR(mark)[c]=i; }
+    }
+    for (c=0; VECTOR(mark)[c] == i; c++) ;
+    VECTOR(color)[i]=c;
+    if (c >= ncol) { ncol=c+1; }
+  }
 
-  if (igraph_vector_size(membership) < no_of_nodes) {
-    IGRAPH_ERROR("cannot shrink graph, membership vector too short",
-        IGRAPH_EINVAL);
+  IGRAPH_CHECK(igraph_vector_long_resize(cstart, ncol+1));
+  IGRAPH_CHECK(igraph_vector_long_resize(order, n));
+  igraph_vector_long_null(cstart);
+  for (i=0; i<n; i++) {
+    VECTOR(*cstart)[ VECTOR(color)[i] + 1 ] += 1;
+  }
+  for (c=0; c<ncol; c++) {
+    VECTOR(*cstart)[c+1] += VECTOR(*cstart)[c];
+  }
+  IGRAPH_CHECK(igraph_vector_long_update(&mark, cstart));
+  for (i=0; i<n; i++) {
+    VECTOR(*order)[ VECTOR(mark)[ VECTOR(color)[i] ]++ ]=i;
   }
 
-  IGRAPH_VECTOR_INIT_FINALLY(&edges, no_of_edges * 2);
+  igraph_vector_long_destroy(&mark);
+  igraph_vector_long_destroy(&color);
+  IGRAPH_FINALLY_CLEAN(2);
+
+  *no=ncol;
+  return 0;
+}
 
-  IGRAPH_CHECK(igraph_reindex_membership(membership, 0));
+/* Workspace of a level. The sequential pass uses dense arrays, the
+   parallel one a count map for each thread, with room for the
+   largest neighborhood only. */
+
+typedef struct igraph_i_multilevel_ws_t {
+  long int nthreads;
+  igraph_real_t *acc;
+  char *seen;
+  long int *touched;
+  igraph_i_count_map_t *maps;
+  igraph_real_t *tot, *in;
+  long int *target;
+  igraph_real_t *wown, *wnew;
+} igraph_i_multilevel_ws_t;
+
+static void igraph_i_multilevel_ws_destroy(igraph_i_multilevel_ws_t *ws) {
+  long int t;
+  for (t=0; t<ws->nthreads && ws->maps; t++) {
+    igraph_i_count_map_destroy(&ws->maps[t]);
+  }
+  igraph_Free(ws->maps);
+  igraph_Free(ws->acc);
+  igraph_Free(ws->seen);
+  igraph_Free(ws->touched);
+  igraph_Free(ws->tot);
+  igraph_Free(ws->in);
+  igraph_Free(ws->target);
+  igraph_Free(ws->wown);
+  igraph_Free(ws->wnew);
+}
+
+/* Computes the modularity of a community partitioning */
 
-  /* Create the new edgelist */
-  igraph_eit_create(graph, igraph_ess_all(IGRAPH_EDGEORDER_ID), &eit);
-  IGRAPH_FINALLY(igraph_eit_destroy, &eit);
-  i = 0;
-  while (!IGRAPH_EIT_END(eit)) {
-    igraph_integer_t from, to;
-    IGRAPH_CHECK(igraph_edge(graph, IGRAPH_EIT_GET(eit), &from, &to));
-    VECTOR(edges)[i++] = VECTOR(*membership)[(long int) from];
-    VECTOR(edges)[i++] = VECTOR(*membership)[(long int) to];
-    IGRAPH_EIT_NEXT(eit);
+static igraph_real_t igraph_i_multilevel_modularity(const igraph_i_multilevel_graph_t *g,
+						    const igraph_i_multilevel_ws_t *ws) {
+  igraph_real_t result=0.0, m=g->weight_sum;
+  long int c;
+  for (c=0; c<g->vcount; c++) {
+    result += (ws->in[c] - ws->tot[c]*ws->tot[c]/m)/m;
   }
-  igraph_eit_destroy(&eit);
-  IGRAPH_FINALLY_CLEAN(1);
+  return result;
+}
 
-  /* Create the new graph */
-  igraph_destroy(graph);
-  no_of_nodes = (long int) igraph_vector_max(membership)+1;
-  IGRAPH_CHECK(igraph_create(graph, &edges, (igraph_integer_t) no_of_nodes,
-			     directed));
+/* A pass of the original, sequential method: the vertices are moved
+   one after the other, in the order of their ids. */
+
+static long int igraph_i_multilevel_pass(const igraph_i_multilevel_graph_t *g,
+					 igraph_i_multilevel_ws_t *ws,
+					 igraph_real_t *membership) {
+  long int i, j, changed=0;
+
+  for (i=0; i<g->vcount; i++) {
+    igraph_real_t degree=VECTOR(g->degree)[i], loop=VECTOR(g->loop)[i];
+    long int old_id=(long int) membership[i], new_id, n;
+    igraph_real_t wown, wnew;
+
+    n=igraph_i_multilevel_links(g, membership, i, ws->acc, ws->seen, 
+				ws->touched);
+    wown=ws->seen[old_id] ? ws->acc[old_id] : 0.0;
+
+    /* Exclude the vertex from its current community */
+    ws->tot[old_id] -= degree;
+    ws->in[old_id] -= 2*wown + loop;
+
+    /* And add it to the one with the best modularity gain */
+    new_id=igraph_i_multilevel_best(g, ws->tot, old_id, ws->tot[old_id],
+				    degree, ws->acc, ws->touched, n);
+    wnew=ws->seen[new_id] ? ws->acc[new_id] : 0.0;
+    membership[i]=new_id;
+    ws->tot[new_id] += degree;
+    ws->in[new_id] += 2*wnew + loop;
+    if (new_id != old_id) { changed++; }
+
+    for (j=0; j<n; j++) {
+      ws->acc[ ws->touched[j] ]=0.0;
+      ws->seen[ ws->touched[j] ]=0;
+    }
+  }
 
-  igraph_vector_destroy(&edges);
-  IGRAPH_FINALLY_CLEAN(1);
+  return changed;
+}
 
-  return 0;
+/* A pass of the parallel method. The vertices of the same color are
+   not adjacent, so their best communities are computed in parallel,
+   from the same state of the communities, and then they are moved
+   in the order of their ids. The result does not depend on the
+   number of threads. */
+
+#define IGRAPH_I_MULTILEVEL_MIN_PARALLEL 1000
+
+static long int igraph_i_multilevel_pass_parallel(const igraph_i_multilevel_graph_t *g,
+						  igraph_i_multilevel_ws_t *ws,
+						  igraph_real_t *membership,
+						  const igraph_vector_long_t *order,
+						  const igraph_vector_long_t *cstart,
+						  long int ncolors) {
+  long int col, j, changed=0;
+  int nthreads=(int) ws->nthreads;
+
+  for (col=0; col<ncolors; col++) {
+    long int from=VECTOR(*cstart)[col], to=VECTOR(*cstart)[col+1];
+
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 256) if(to-from >= IGRAPH_I_MULTILEVEL_MIN_PARALLEL)
+    for (j=from; j<to; j++) {
+      igraph_i_count_map_t *map=&ws->maps[ IGRAPH_I_THREAD_NUM() ];
+      long int v=VECTOR(*order)[j], own=(long int) membership[v];
+      igraph_real_t degree=VECTOR(g->degree)[v];
+      igraph_i_multilevel_links_map(g, membership, v, map);
+      ws->target[v]=igraph_i_multilevel_best_map(g, ws->tot, own, 
+						 ws->tot[own] - degree,
+						 degree, map);
+      ws->wown[v]=igraph_i_count_map_get(map, own);
+      ws->wnew[v]=igraph_i_count_map_get(map, ws->target[v]);
+      igraph_i_count_map_clear(map);
+    }
+
+    for (j=from; j<to; j++) {
+      long int v=VECTOR(*order)[j], own=(long int) membership[v];
+      long int new_id=ws->target[v];
+      igraph_real_t degree=VECTOR(g->degree)[v], loop=VECTOR(g->loop)[v];
+      if (new_id == own) { continue; }
+      /* The earlier moves might have made this one worse than staying */
+      if (ws->wnew[v] - ws->tot[new_id] * degree / g->weight_sum <=
+	  ws->wown[v] - (ws->tot[own] - degree) * degree / g->weight_sum) {
+	continue;
+      }
+      ws->tot[own] -= degree;
+      ws->in[own] -= 2*ws->wown[v] + loop;
+      ws->tot[new_id] += degree;
+      ws->in[new_id] += 2*ws->wnew[v] + loop;
+      membership[v]=new_id;
+      changed++;
+    }
+  }
+
+  return changed;
 }
 
 /**
@@ -2646,277 +3457,157 @@ int igraph_i_multilevel_shrink(igraph_t *graph, igraph_vector_t *membership) {
  *
  * This function was contributed by Tom Gregorovic.
  *
- * \param graph   The input graph. It must be an undirected graph.
- * \param weights Numeric vector containing edge weights. If \c NULL, every edge
- *     has equal weight. The weights are expected to be non-negative.
+ * \param g The graph of the level, it is replaced by the graph of its
+ *     communities.
  * \param membership The membership vector, the result is returned here.
  *     For each vertex it gives the ID of its community.
  * \param modularity The modularity of the partition is returned here.
  *     \c NULL means that the modularity is not needed.
+ * \param parallel Whether to move the vertices in parallel, see
+ *     \ref igraph_community_multilevel_parallel().
  * \return Error code.
  *
  * Time complexity: in average near linear on sparse graphs.
  */
-int igraph_i_community_multilevel_step(igraph_t *graph,
-  igraph_vector_t *weights, igraph_vector_t *membership,
-  igraph_real_t *modularity) {
-  
-  long int i, j;
-  long int vcount = igraph_vcount(graph);
-  long int ecount = igraph_ecount(graph);
-  igraph_integer_t ffrom, fto;
+
+static int igraph_i_community_multilevel_step(igraph_i_multilevel_graph_t *g,
+					      igraph_vector_t *membership,
+					      igraph_real_t *modularity,
+					      igraph_bool_t parallel) {
+  long int i, n=g->vcount, no_comms, ncolors=0;
+  long int nthreads= parallel ? IGRAPH_I_MAX_THREADS() : 1;
   igraph_real_t q, pass_q;
-  int pass;
-  igraph_bool_t changed = 0;
-  igraph_vector_t links_community;
-  igraph_vector_t links_weight;
-  igraph_vector_t edges;
+  long int changed;
   igraph_vector_t temp_membership;
-  igraph_i_multilevel_community_list communities;
-
-  /* Initial sanity checks on the input parameters */
-  if (igraph_is_directed(graph)) {
-    IGRAPH_ERROR("multi-level community detection works for undirected graphs only",
-        IGRAPH_UNIMPLEMENTED);
-  }
-  if (igraph_vector_size(weights) < igraph_ecount(graph))
-    IGRAPH_ERROR("multi-level community detection: weight vector too short", IGRAPH_EINVAL);
-  if (igraph_vector_any_smaller(weights, 0))
-    IGRAPH_ERROR("weights must be positive", IGRAPH_EINVAL);
-
-  /* Initialize data structures */
-  IGRAPH_VECTOR_INIT_FINALLY(&links_community, 0);
-  IGRAPH_VECTOR_INIT_FINALLY(&links_weight, 0);
-  IGRAPH_VECTOR_INIT_FINALLY(&edges, 0);
-  IGRAPH_VECTOR_INIT_FINALLY(&temp_membership, vcount);
-  IGRAPH_CHECK(igraph_vector_resize(membership, vcount));
- 
-  /* Initialize list of communities from graph vertices */
-  communities.vertices_no = vcount;
-  communities.communities_no = vcount;
-  communities.weights = weights;
-  communities.weight_sum = 2 * igraph_vector_sum(weights);
-  communities.membership = membership;
-  communities.item = igraph_Calloc(vcount, igraph_i_multilevel_community);
-  if (communities.item == 0) {
-    IGRAPH_ERROR("multi-level community structure detection failed", IGRAPH_ENOMEM);
+  igraph_vector_long_t order, cstart;
+  igraph_i_multilevel_ws_t ws;
+
+  memset(&ws, 0, sizeof(ws));
+  IGRAPH_FINALLY(igraph_i_multilevel_ws_destroy, &ws);
+  ws.tot=igraph_Calloc(n > 0 ? n : 1, igraph_real_t);
+  ws.in=igraph_Calloc(n > 0 ? n : 1, igraph_real_t);
+  if (!ws.tot || !ws.in) {
+    IGRAPH_ERROR("multi-level community structure detection failed", 
+		 IGRAPH_ENOMEM);
+  }
+  if (parallel) {
+    long int maxdeg=0;
+    ws.maps=igraph_Calloc(nthreads, igraph_i_count_map_t);
+    ws.target=igraph_Calloc(n > 0 ? n : 1, long int);
+    ws.wown=igraph_Calloc(n > 0 ? n : 1, igraph_real_t);
+    ws.wnew=igraph_Calloc(n > 0 ? n : 1, igraph_real_t);
+    if (!ws.maps || !ws.target || !ws.wown || !ws.wnew) {
+      IGRAPH_ERROR("multi-level community structure detection failed", 
+		   IGRAPH_ENOMEM);
+    }
+    ws.nthreads=nthreads;
+    for (i=0; i<n; i++) {
+      long int deg=VECTOR(g->start)[i+1] - VECTOR(g->start)[i];
+      if (deg > maxdeg) { maxdeg=deg; }
+    }
+    if (maxdeg > n) { maxdeg=n; }
+    for (i=0; i<nthreads; i++) {
+      IGRAPH_CHECK(igraph_i_count_map_reserve(&ws.maps[i], maxdeg));
+    }
+  } else {
+    ws.acc=igraph_Calloc(n > 0 ? n : 1, igraph_real_t);
+    ws.seen=igraph_Calloc(n > 0 ? n : 1, char);
+    ws.touched=igraph_Calloc(n > 0 ? n : 1, long int);
+    if (!ws.acc || !ws.seen || !ws.touched) {
+      IGRAPH_ERROR("multi-level community structure detection failed", 
+		   IGRAPH_ENOMEM);
+    }
   }
-  IGRAPH_FINALLY(igraph_free, communities.item);
 
-  /* Still initializing the communities data structure */
-  for (i=0; i < vcount; i++) {
-    VECTOR(*communities.membership)[i] = i;
-    communities.item[i].size = 1;
-    communities.item[i].weight_inside = 0;
-    communities.item[i].weight_all = 0;
+  IGRAPH_VECTOR_INIT_FINALLY(&temp_membership, n);
+  IGRAPH_CHECK(igraph_vector_long_init(&order, 0));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &order);
+  IGRAPH_CHECK(igraph_vector_long_init(&cstart, 0));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &cstart);
+  IGRAPH_CHECK(igraph_vector_resize(membership, n));
+  if (parallel) {
+    IGRAPH_CHECK(igraph_i_multilevel_coloring(g, &order, &cstart, &ncolors));
   }
 
-  /* Some more initialization :) */
-  for (i = 0; i < ecount; i++) {
-    igraph_real_t weight = 1;
-    igraph_edge(graph, (igraph_integer_t) i, &ffrom, &fto);
-
-    weight = VECTOR(*weights)[i];
-    communities.item[(long int) ffrom].weight_all += weight;
-    communities.item[(long int) fto].weight_all += weight;
-    if (ffrom == fto)
-      communities.item[(long int) ffrom].weight_inside += 2*weight;
+  /* Every vertex is in its own community */
+  for (i=0; i < n; i++) {
+    VECTOR(*membership)[i] = i;
+    ws.tot[i] = VECTOR(g->degree)[i];
+    ws.in[i] = VECTOR(g->loop)[i];
   }
 
-  q = igraph_i_multilevel_community_modularity(&communities);
-  pass = 1;
+  q = igraph_i_multilevel_modularity(g, &ws);
 
   do { /* Pass begin */
-    long int temp_communities_no = communities.communities_no;
-
     pass_q = q;
-    changed = 0;
     
     /* Save the current membership, it will be restored in case of worse result */
-    IGRAPH_CHECK(igraph_vector_update(&temp_membership, communities.membership));
+    IGRAPH_CHECK(igraph_vector_update(&temp_membership, membership));
 
-    for (i = 0; i < vcount; i++) {
-      /* Exclude vertex from its current community */
-      igraph_real_t weight_all = 0;
-      igraph_real_t weight_inside = 0;
-      igraph_real_t weight_loop = 0;
-      igraph_real_t max_q_gain = 0;
-      igraph_real_t max_weight;
-      long int old_id, new_id, n;
-
-      igraph_i_multilevel_community_links(graph, &communities, 
-					  (igraph_integer_t) i, &edges,
-					  &weight_all, &weight_inside, 
-					  &weight_loop, &links_community,
-					  &links_weight);
-
-      old_id = (long int)VECTOR(*(communities.membership))[i];
-      new_id = old_id;
-
-      /* Update old community */
-      igraph_vector_set(communities.membership, i, -1);
-      communities.item[old_id].size--;
-      if (communities.item[old_id].size == 0) {communities.communities_no--;}
-      communities.item[old_id].weight_all -= weight_all;
-      communities.item[old_id].weight_inside -= 2*weight_inside + weight_loop;
-
-      /* debug("Remove %ld all: %lf Inside: %lf\n", i, -weight_all, -2*weight_inside + weight_loop); */
-
-      /* Find new community to join with the best modification gain */
-      max_q_gain = 0;
-      max_weight = weight_inside;
-      n = igraph_vector_size(&links_community);
-
-      for (j = 0; j < n; j++) {
-        long int c = (long int) VECTOR(links_community)[j];
-        igraph_real_t w = VECTOR(links_weight)[j];
-
-        igraph_real_t q_gain = 
-	  igraph_i_multilevel_community_modularity_gain(&communities, 
-							(igraph_integer_t) c, 
-							(igraph_integer_t) i,
-							weight_all, w);
-        /* debug("Link %ld -> %ld weight: %lf gain: %lf\n", i, c, (double) w, (double) q_gain); */
-        if (q_gain > max_q_gain) {
-          new_id = c;
-          max_q_gain = q_gain;
-          max_weight = w;
-        }
-      }
-
-      /* debug("Added vertex %ld to community %ld (gain %lf).\n", i, new_id, (double) max_q_gain); */
-
-      /* Add vertex to "new" community and update it */
-      igraph_vector_set(communities.membership, i, new_id);
-      if (communities.item[new_id].size == 0) {communities.communities_no++;}
-      communities.item[new_id].size++;
-      communities.item[new_id].weight_all += weight_all;
-      communities.item[new_id].weight_inside += 2*max_weight + weight_loop;
-
-      if (new_id != old_id) {
-        changed++;
-      }
+    if (parallel) {
+      changed=igraph_i_multilevel_pass_parallel(g, &ws, VECTOR(*membership),
+						&order, &cstart, ncolors);
+    } else {
+      changed=igraph_i_multilevel_pass(g, &ws, VECTOR(*membership));
     }
 
-    q = igraph_i_multilevel_community_modularity(&communities);
+    q = igraph_i_multilevel_modularity(g, &ws);
 
-    if (changed && (q > pass_q)) { 
-      /* debug("Pass %d (changed: %d) Communities: %ld Modularity from %lf to %lf\n",
-        pass, changed, communities.communities_no, (double) pass_q, (double) q); */
-      pass++;
-    } else {
+    if (!changed || q <= pass_q) {
       /* No changes or the modularity became worse, restore last membership */
-      IGRAPH_CHECK(igraph_vector_update(communities.membership, &temp_membership));
-      communities.communities_no = temp_communities_no;
+      IGRAPH_CHECK(igraph_vector_update(membership, &temp_membership));
+      q = pass_q;
       break;
     }
 
     IGRAPH_ALLOW_INTERRUPTION();
-  } while (changed && (q > pass_q)); /* Pass end */
-
-  if (modularity) {
-    *modularity = q;
-  }
-
-  /* debug("Result Communities: %ld Modularity: %lf\n",
-    communities.communities_no, (double) q); */
-
-  IGRAPH_CHECK(igraph_reindex_membership(membership, 0));
-
-  /* Shrink the nodes of the graph according to the present community structure
-   * and simplify the resulting graph */
-
-  /* TODO: check if we really need to copy temp_membership */
-  IGRAPH_CHECK(igraph_vector_update(&temp_membership, membership));
-  IGRAPH_CHECK(igraph_i_multilevel_shrink(graph, &temp_membership));
-  igraph_vector_destroy(&temp_membership);
-  IGRAPH_FINALLY_CLEAN(1);  
-  
-  /* Update edge weights after shrinking and simplification */
-  /* Here we reuse the edges vector as we don't need the previous contents anymore */
-  /* TODO: can we use igraph_simplify here? */
-  IGRAPH_CHECK(igraph_i_multilevel_simplify_multiple(graph, &edges));
-
-  /* We reuse the links_weight vector to store the old edge weights */
-  IGRAPH_CHECK(igraph_vector_update(&links_weight, weights));
-  igraph_vector_fill(weights, 0);
-   
-  for (i = 0; i < ecount; i++) {
-    VECTOR(*weights)[(long int)VECTOR(edges)[i]] += VECTOR(links_weight)[i];
-  }
-
-  igraph_free(communities.item);
-  igraph_vector_destroy(&links_community);
-  igraph_vector_destroy(&links_weight);
-  igraph_vector_destroy(&edges);
-  IGRAPH_FINALLY_CLEAN(4);
-  
-  return 0;
-}
-
-/**
- * \ingroup communities
- * \function igraph_community_multilevel
- * \brief Finding community structure by multi-level optimization of modularity
- * 
- * This function implements the multi-level modularity optimization
- * algorithm for finding community structure, see 
- * VD Blondel, J-L Guillaume, R Lambiotte and E Lefebvre: Fast unfolding of
- * community hierarchies in large networks, J Stat Mech P10008 (2008)
- * for the details (preprint: http://arxiv.org/abs/arXiv:0803.0476).
- *
- * It is based on the modularity measure and a hierarchical approach.
- * Initially, each vertex is assigned to a community on its own. In every step,
- * vertices are re-assigned to communities in a local, greedy way: each vertex
- * is moved to the community with which it achieves the highest contribution to
- * modularity. When no vertices can be reassigned, each community is considered
- * a vertex on its own, and the process starts again with the merged communities.
- * The process stops when there is only a single vertex left or when the modularity
- * cannot be increased any more in a step.
- *
- * This function was contributed by Tom Gregorovic.
- *
- * \param graph The input graph. It must be an undirected graph.
- * \param weights Numeric vector containing edge weights. If \c NULL, every edge
- *    has equal weight. The weights are expected to be non-negative.
- * \param membership The membership vector, the result is returned here.
- *    For each vertex it gives the ID of its community. The vector
- *    must be initialized and it will be resized accordingly.
- * \param memberships Numeric matrix that will contain the membership
- *     vector after each level, if not \c NULL. It must be initialized and
- *     it will be resized accordingly.
- * \param modularity Numeric vector that will contain the modularity score
- *     after each level, if not \c NULL. It must be initialized and it
- *     will be resized accordingly.
- * \return Error code.
- *
- * Time complexity: in average near linear on sparse graphs.
- * 
- * \example examples/simple/igraph_community_multilevel.c
- */
+  } while (1); /* Pass end */
 
-int igraph_community_multilevel(const igraph_t *graph,
+  if (modularity) {
+    *modularity = q;
+  }
+
+  /* Shrink the nodes of the graph according to the present community
+     structure */
+  IGRAPH_CHECK(igraph_i_multilevel_reindex(membership, &no_comms));
+  IGRAPH_CHECK(igraph_i_multilevel_graph_aggregate(g, membership, no_comms));
+
+  igraph_vector_long_destroy(&cstart);
+  igraph_vector_long_destroy(&order);
+  igraph_vector_destroy(&temp_membership);
+  igraph_i_multilevel_ws_destroy(&ws);
+  IGRAPH_FINALLY_CLEAN(4);
+
+  return 0;
+}
+
+static int igraph_i_community_multilevel(const igraph_t *graph,
   const igraph_vector_t *weights, igraph_vector_t *membership,
-  igraph_matrix_t *memberships, igraph_vector_t *modularity) {
+  igraph_matrix_t *memberships, igraph_vector_t *modularity,
+  igraph_bool_t parallel) {
  
-  igraph_t g;
-  igraph_vector_t w, m, level_membership;
+  igraph_i_multilevel_graph_t g;
+  igraph_vector_t m, level_membership;
   igraph_real_t prev_q = -1, q = -1;
   int i, level = 1;
   long int vcount = igraph_vcount(graph);
 
-  /* Make a copy of the original graph, we will do the merges on the copy */
-  IGRAPH_CHECK(igraph_copy(&g, graph));
-  IGRAPH_FINALLY(igraph_destroy, &g);
-
+  /* Initial sanity checks on the input parameters */
+  if (igraph_is_directed(graph)) {
+    IGRAPH_ERROR("multi-level community detection works for undirected graphs only",
+        IGRAPH_UNIMPLEMENTED);
+  }
   if (weights) {
-    IGRAPH_CHECK(igraph_vector_copy(&w, weights));   
-    IGRAPH_FINALLY(igraph_vector_destroy, &w);  
-  } else {
-    IGRAPH_VECTOR_INIT_FINALLY(&w, igraph_ecount(&g));
-    igraph_vector_fill(&w, 1);
+    if (igraph_vector_size(weights) < igraph_ecount(graph))
+      IGRAPH_ERROR("multi-level community detection: weight vector too short", IGRAPH_EINVAL);
+    if (igraph_vector_any_smaller(weights, 0))
+      IGRAPH_ERROR("weights must be positive", IGRAPH_EINVAL);
   }
 
+  /* The compact copy of the graph, we will do the merges on it */
+  IGRAPH_CHECK(igraph_i_multilevel_graph_init(&g, graph, weights));
+  IGRAPH_FINALLY(igraph_i_multilevel_graph_destroy, &g);
+
   IGRAPH_VECTOR_INIT_FINALLY(&m, vcount);
   IGRAPH_VECTOR_INIT_FINALLY(&level_membership, vcount);
 
@@ -2937,13 +3628,13 @@ int igraph_community_multilevel(const igraph_t *graph,
   
   while (1) {
     /* Remember the previous modularity and vertex count, do a single step */
-    igraph_integer_t step_vcount = igraph_vcount(&g);
+    long int step_vcount = g.vcount;
 
     prev_q = q;
-    IGRAPH_CHECK(igraph_i_community_multilevel_step(&g, &w, &m, &q));
+    IGRAPH_CHECK(igraph_i_community_multilevel_step(&g, &m, &q, parallel));
 
     /* Were there any merges? If not, we have to stop the process */
-    if (igraph_vcount(&g) == step_vcount || q < prev_q)
+    if (g.vcount == step_vcount || q < prev_q)
       break;
 
     if (memberships || membership) {
@@ -2965,7 +3656,7 @@ int igraph_community_multilevel(const igraph_t *graph,
       IGRAPH_CHECK(igraph_matrix_set_row(memberships, &level_membership, level - 1));
     }
 
-    /* debug("Level: %d Communities: %ld Modularity: %f\n", level, (long int) igraph_vcount(&g),
+    /* debug("Level: %d Communities: %ld Modularity: %f\n", level, (long int) g.vcount,
       (double) q); */
 
     /* Increase the level counter */
@@ -2995,14 +3686,479 @@ int igraph_community_multilevel(const igraph_t *graph,
     }
   }
 
-  /* Destroy the copy of the graph */
-  igraph_destroy(&g);
-
-  /* Destroy the temporary vectors */
+  /* Destroy the compact graph and the temporary vectors */
+  igraph_i_multilevel_graph_destroy(&g);
   igraph_vector_destroy(&m);
-  igraph_vector_destroy(&w);
   igraph_vector_destroy(&level_membership);
-  IGRAPH_FINALLY_CLEAN(4);
+  IGRAPH_FINALLY_CLEAN(3);
+
+  return 0;
+}
+
+/**
+ * \ingroup communities
+ * \function igraph_community_multilevel
+ * \brief Finding community structure by multi-level optimization of modularity
+ * 
+ * This function implements the multi-level modularity optimization
+ * algorithm for finding community structure, see 
+ * VD Blondel, J-L Guillaume, R Lambiotte and E Lefebvre: Fast unfolding of
+ * community hierarchies in large networks, J Stat Mech P10008 (2008)
+ * for the details (preprint: http://arxiv.org/abs/arXiv:0803.0476).
+ *
+ * It is based on the modularity measure and a hierarchical approach.
+ * Initially, each vertex is assigned to a community on its own. In every step,
+ * vertices are re-assigned to communities in a local, greedy way: each vertex
+ * is moved to the community with which it achieves the highest contribution to
+ * modularity. When no vertices can be reassigned, each community is considered
+ * a vertex on its own, and the process starts again with the merged communities.
+ * The process stops when there is only a single vertex left or when the modularity
+ * cannot be increased any more in a step.
+ *
+ * This function was contributed by Tom Gregorovic.
+ *
+ * \param graph The input graph. It must be an undirected graph.
+ * \param weights Numeric vector containing edge weights. If \c NULL, every edge
+ *    has equal weight. The weights are expected to be non-negative.
+ * \param membership The membership vector, the result is returned here.
+ *    For each vertex it gives the ID of its community. The vector
+ *    must be initialized and it will be resized accordingly.
+ * \param memberships Numeric matrix that will contain the membership
+ *     vector after each level, if not \c NULL. It must be initialized and
+ *     it will be resized accordingly.
+ * \param modularity Numeric vector that will contain the modularity score
+ *     after each level, if not \c NULL. It must be initialized and it
+ *     will be resized accordingly.
+ * \return Error code.
+ *
+ * Time complexity: in average near linear on sparse graphs.
+ * 
+ * \example examples/simple/igraph_community_multilevel.c
+ */
+
+int igraph_community_multilevel(const igraph_t *graph,
+  const igraph_vector_t *weights, igraph_vector_t *membership,
+  igraph_matrix_t *memberships, igraph_vector_t *modularity) {
+  return igraph_i_community_multilevel(graph, weights, membership,
+				       memberships, modularity,
+				       /*parallel=*/ 0);
+}
+
+/**
+ * \ingroup communities
+ * \function igraph_community_multilevel_parallel
+ * \brief Multi-level modularity optimization, moving the vertices in parallel
+ * 
+ * This is a variant of \ref igraph_community_multilevel() that
+ * moves the vertices in parallel, if igraph was compiled with OpenMP
+ * support. On every level the vertices are colored greedily, so
+ * that adjacent vertices have different colors. Then the vertices of
+ * a color are processed together: their best communities are
+ * computed in parallel, and then they are moved to them, in the order
+ * of their ids. As the vertices of a color are not adjacent, the
+ * decision of a vertex does not depend on the moves of the others
+ * in the same color, and the result is the same for any number of
+ * threads, and also without OpenMP.
+ *
+ * </para><para>
+ * The result is usually different from the result of \ref
+ * igraph_community_multilevel(), which moves the vertices one by
+ * one, in the order of their ids; the modularity of the two results
+ * is typically very close.
+ *
+ * </para><para>
+ * The number of threads is the OpenMP default, it can be set via
+ * the \c OMP_NUM_THREADS environment variable. Besides O(n+m) memory
+ * for the graph of the level, every thread needs a hash table of
+ * O(d) size, where d is the maximum degree.
+ *
+ * \param graph The input graph. It must be an undirected graph.
+ * \param weights Numeric vector containing edge weights. If \c NULL, every edge
+ *    has equal weight. The weights are expected to be non-negative.
+ * \param membership The membership vector, the result is returned here.
+ *    For each vertex it gives the ID of its community. The vector
+ *    must be initialized and it will be resized accordingly.
+ * \param memberships Numeric matrix that will contain the membership
+ *     vector after each level, if not \c NULL. It must be initialized and
+ *     it will be resized accordingly.
+ * \param modularity Numeric vector that will contain the modularity score
+ *     after each level, if not \c NULL. It must be initialized and it
+ *     will be resized accordingly.
+ * \return Error code.
+ *
+ * Time complexity: in average near linear on sparse graphs.
+ * 
+ * \example examples/simple/igraph_community_multilevel_parallel.c
+ */
+
+int igraph_community_multilevel_parallel(const igraph_t *graph,
+  const igraph_vector_t *weights, igraph_vector_t *membership,
+  igraph_matrix_t *memberships, igraph_vector_t *modularity) {
+  return igraph_i_community_multilevel(graph, weights, membership,
+				       memberships, modularity,
+				       /*parallel=*/ 1);
+}
+
+
+/* Workspace of the Leiden method. The arrays are allocated for the
+   vertices of the input graph, and reused on every level. */
+
+typedef struct igraph_i_leiden_ws_t {
+  igraph_real_t *acc;
+  char *seen;
+  long int *touched;
+  igraph_real_t *tot;		/* total degree of the communities */
+  long int *csize;		/* and the number of their vertices */
+  long int *empty;		/* a stack of the empty community ids */
+  long int *queue;		/* the vertices to visit, a circular buffer */
+  char *queued;
+  igraph_real_t *rtot;		/* total degree of the refined communities */
+  igraph_real_t *rext;		/* weight of their edges to the rest of
+				   the community */
+  long int *rsize;
+} igraph_i_leiden_ws_t;
+
+static void igraph_i_leiden_ws_destroy(igraph_i_leiden_ws_t *ws) {
+  igraph_Free(ws->acc);
+  igraph_Free(ws->seen);
+  igraph_Free(ws->touched);
+  igraph_Free(ws->tot);
+  igraph_Free(ws->csize);
+  igraph_Free(ws->empty);
+  igraph_Free(ws->queue);
+  igraph_Free(ws->queued);
+  igraph_Free(ws->rtot);
+  igraph_Free(ws->rext);
+  igraph_Free(ws->rsize);
+}
+
+/* The fast local moving phase. First all vertices are in the queue,
+   in the order of their ids; a vertex is moved to the community with
+   the largest modularity gain, or to an empty community if it is
+   better off alone, and then those of its neighbors that are not in
+   its new community and not in the queue are added to the end of the
+   queue. This stops when the queue is empty; unlike the passes of the
+   multi-level method, the vertices whose neighborhood did not change
+   are not visited again. Returns the number of moves. */
+
+static long int igraph_i_leiden_move(const igraph_i_multilevel_graph_t *g,
+				     igraph_i_leiden_ws_t *ws,
+				     igraph_real_t *membership) {
+  long int n=g->vcount, head=0, size=n, nempty=0, moved=0, i, c;
+
+  for (c=0; c<n; c++) {
+    ws->tot[c]=0.0;
+    ws->csize[c]=0;
+  }
+  for (i=0; i<n; i++) {
+    c=(long int) membership[i];
+    ws->tot[c] += VECTOR(g->degree)[i];
+    ws->csize[c] += 1;
+    ws->queue[i]=i;
+    ws->queued[i]=1;
+  }
+  for (c=n-1; c>=0; c--) {
+    if (ws->csize[c] == 0) { ws->empty[nempty++]=c; }
+  }
+
+  while (size > 0) {
+    long int v=ws->queue[head], own=(long int) membership[v], best, nt, k;
+    igraph_real_t degree=VECTOR(g->degree)[v];
+    igraph_real_t own_tot=ws->tot[own] - degree;
+
+    head = head+1 == n ? 0 : head+1;
+    size--;
+    ws->queued[v]=0;
+
+    nt=igraph_i_multilevel_links(g, membership, v, ws->acc, ws->seen,
+				 ws->touched);
+    best=igraph_i_multilevel_best(g, ws->tot, own, own_tot, degree, ws->acc,
+				  ws->touched, nt);
+    if (best == own && ws->csize[own] > 1 && nempty > 0) {
+      igraph_real_t wown=ws->seen[own] ? ws->acc[own] : 0.0;
+      if (wown - own_tot * degree / g->weight_sum < 0) {
+	best=ws->empty[nempty-1];
+      }
+    }
+    for (k=0; k<nt; k++) {
+      ws->acc[ ws->touched[k] ]=0.0;
+      ws->seen[ ws->touched[k] ]=0;
+    }
+
+    if (best == own) { continue; }
+
+    if (ws->csize[best] == 0) { nempty--; }
+    ws->tot[own] -= degree;
+    ws->csize[own] -= 1;
+    if (ws->csize[own] == 0) { ws->empty[nempty++]=own; }
+    ws->tot[best] += degree;
+    ws->csize[best] += 1;
+    membership[v]=best;
+    moved++;
+
+    for (k=VECTOR(g->start)[v]; k<VECTOR(g->start)[v+1]; k++) {
+      long int u=VECTOR(g->nei)[k];
+      if (!ws->queued[u] && membership[u] != best) {
+	long int tail=head+size;
+	ws->queue[tail >= n ? tail-n : tail]=u;
+	ws->queued[u]=1;
+	size++;
+      }
+    }
+  }
+
+  return moved;
+}
+
+/* The refinement phase. Every community of 'membership' is split into
+   its vertices, and these are merged again, greedily: in the order of
+   their ids, a vertex that is still alone is merged into the
+   subcommunity in its community that gives the largest modularity
+   gain. Only well-connected vertices and subcommunities take part,
+   i.e. those that have at least as much weight to the rest of the
+   community as expected in a random graph. So the refined
+   communities are connected. The subcommunities are identified by
+   one of their vertices in 'refined'. */
+
+static void igraph_i_leiden_refine(const igraph_i_multilevel_graph_t *g,
+				   igraph_i_leiden_ws_t *ws,
+				   const igraph_real_t *membership,
+				   igraph_real_t *refined) {
+  long int n=g->vcount, v, k, j;
+  igraph_real_t m2=g->weight_sum;
+
+  for (v=0; v<n; v++) {
+    ws->tot[v]=0.0;
+  }
+  for (v=0; v<n; v++) {
+    ws->tot[ (long int) membership[v] ] += VECTOR(g->degree)[v];
+  }
+
+  for (v=0; v<n; v++) {
+    refined[v]=v;
+    ws->rtot[v]=VECTOR(g->degree)[v];
+    ws->rsize[v]=1;
+    ws->rext[v]=0.0;
+    for (k=VECTOR(g->start)[v]; k<VECTOR(g->start)[v+1]; k++) {
+      if (membership[ VECTOR(g->nei)[k] ] == membership[v]) {
+	ws->rext[v] += VECTOR(g->weight)[k];
+      }
+    }
+  }
+
+  for (v=0; v<n; v++) {
+    long int c=(long int) membership[v], best=v, nt=0;
+    igraph_real_t degree=VECTOR(g->degree)[v], ctot=ws->tot[c];
+    igraph_real_t best_gain=0.0;
+
+    if (ws->rsize[v] != 1 || refined[v] != v) { continue; }
+    if (ws->rext[v] < degree * (ctot - degree) / m2) { continue; }
+
+    for (k=VECTOR(g->start)[v]; k<VECTOR(g->start)[v+1]; k++) {
+      long int u=VECTOR(g->nei)[k], s;
+      if (membership[u] != c) { continue; }
+      s=(long int) refined[u];
+      if (!ws->seen[s]) {
+	ws->seen[s]=1;
+	ws->touched[nt++]=s;
+      }
+      ws->acc[s] += VECTOR(g->weight)[k];
+    }
+
+    for (j=0; j<nt; j++) {
+      long int s=ws->touched[j];
+      igraph_real_t gain;
+      if (ws->rext[s] < ws->rtot[s] * (ctot - ws->rtot[s]) / m2) { continue; }
+      gain=ws->acc[s] - ws->rtot[s] * degree / m2;
+      if (gain > best_gain || (gain == best_gain && gain > 0 && s < best)) {
+	best=s;
+	best_gain=gain;
+      }
+    }
+
+    if (best != v) {
+      refined[v]=best;
+      ws->rtot[best] += degree;
+      ws->rsize[best] += 1;
+      ws->rext[best] += ws->rext[v] - 2*ws->acc[best];
+      ws->rsize[v]=0;
+    }
+
+    for (j=0; j<nt; j++) {
+      ws->acc[ ws->touched[j] ]=0.0;
+      ws->seen[ ws->touched[j] ]=0;
+    }
+  }
+}
+
+/**
+ * \ingroup communities
+ * \function igraph_community_leiden
+ * \brief Finding community structure with the Leiden algorithm
+ * 
+ * This function implements the Leiden algorithm for modularity
+ * optimization, see V.A. Traag, L. Waltman and N.J. van Eck: From
+ * Louvain to Leiden: guaranteeing well-connected communities,
+ * Scientific Reports 9, 5233 (2019).
+ *
+ * </para><para>
+ * Like \ref igraph_community_multilevel(), it moves vertices between
+ * communities locally and then aggregates the communities into single
+ * vertices, but with two differences. In the local moving phase only
+ * the vertices whose neighborhood changed are visited again, instead
+ * of all vertices in repeated passes. And before the aggregation the
+ * communities are refined: they are split into well-connected
+ * subcommunities, and these become the vertices of the next level,
+ * in the community they came from. Vertices can still move between
+ * communities on the next level, separately from the rest of their
+ * original community, so badly connected communities are split up,
+ * and all communities of the result are connected.
+ *
+ * </para><para>
+ * This implementation is deterministic: the vertices are visited in
+ * the order of their ids, and the refinement merges the vertices
+ * greedily, into the subcommunity with the largest modularity gain,
+ * instead of randomly.
+ *
+ * \param graph The input graph. It must be an undirected graph.
+ * \param weights Numeric vector containing edge weights. If \c NULL, every edge
+ *    has equal weight. The weights must be non-negative.
+ * \param membership The membership vector, the result is returned here.
+ *    For each vertex it gives the ID of its community. The vector
+ *    must be initialized and it will be resized accordingly.
+ * \param n_iterations The number of iterations of the whole
+ *    algorithm. Every iteration starts from the result of the
+ *    previous one and can only improve it. If negative, the algorithm
+ *    is iterated until the result does not change any more. The
+ *    iterations also stop when this happens earlier.
+ * \param modularity If not \c NULL, the modularity of the result is
+ *    stored here.
+ * \return Error code.
+ *
+ * \sa \ref igraph_community_multilevel().
+ *
+ * Time complexity: in average near linear on sparse graphs, for each
+ * iteration.
+ * 
+ * \example examples/simple/igraph_community_leiden.c
+ */
+
+int igraph_community_leiden(const igraph_t *graph,
+			    const igraph_vector_t *weights,
+			    igraph_vector_t *membership,
+			    igraph_integer_t n_iterations,
+			    igraph_real_t *modularity) {
+
+  long int no_of_nodes=igraph_vcount(graph);
+  long int n1= no_of_nodes > 0 ? no_of_nodes : 1;
+  igraph_i_multilevel_graph_t g;
+  igraph_i_leiden_ws_t ws;
+  igraph_vector_t level, part, refined, newpart;
+  long int i, it;
+
+  if (igraph_is_directed(graph)) {
+    IGRAPH_ERROR("Leiden community detection works for undirected graphs only",
+		 IGRAPH_UNIMPLEMENTED);
+  }
+  if (weights) {
+    if (igraph_vector_size(weights) != igraph_ecount(graph)) {
+      IGRAPH_ERROR("Invalid weight vector length", IGRAPH_EINVAL);
+    }
+    if (igraph_vector_any_smaller(weights, 0)) {
+      IGRAPH_ERROR("weights must be positive", IGRAPH_EINVAL);
+    }
+  }
+
+  memset(&ws, 0, sizeof(ws));
+  IGRAPH_FINALLY(igraph_i_leiden_ws_destroy, &ws);
+  ws.acc=igraph_Calloc(n1, igraph_real_t);
+  ws.seen=igraph_Calloc(n1, char);
+  ws.touched=igraph_Calloc(n1, long int);
+  ws.tot=igraph_Calloc(n1, igraph_real_t);
+  ws.csize=igraph_Calloc(n1, long int);
+  ws.empty=igraph_Calloc(n1, long int);
+  ws.queue=igraph_Calloc(n1, long int);
+  ws.queued=igraph_Calloc(n1, char);
+  ws.rtot=igraph_Calloc(n1, igraph_real_t);
+  ws.rext=igraph_Calloc(n1, igraph_real_t);
+  ws.rsize=igraph_Calloc(n1, long int);
+  if (!ws.acc || !ws.seen || !ws.touched || !ws.tot || !ws.csize ||
+      !ws.empty || !ws.queue || !ws.queued || !ws.rtot || !ws.rext ||
+      !ws.rsize) {
+    IGRAPH_ERROR("Leiden community detection failed", IGRAPH_ENOMEM);
+  }
+
+  IGRAPH_VECTOR_INIT_FINALLY(&level, no_of_nodes);
+  IGRAPH_VECTOR_INIT_FINALLY(&part, no_of_nodes);
+  IGRAPH_VECTOR_INIT_FINALLY(&refined, no_of_nodes);
+  IGRAPH_VECTOR_INIT_FINALLY(&newpart, no_of_nodes);
+
+  /* Start from singletons */
+  IGRAPH_CHECK(igraph_vector_resize(membership, no_of_nodes));
+  for (i=0; i<no_of_nodes; i++) {
+    VECTOR(*membership)[i]=i;
+  }
+
+  for (it=0; n_iterations < 0 || it < n_iterations; it++) {
+    long int no_comms, no_refined;
+
+    IGRAPH_CHECK(igraph_i_multilevel_graph_init(&g, graph, weights));
+    IGRAPH_FINALLY(igraph_i_multilevel_graph_destroy, &g);
+    IGRAPH_CHECK(igraph_vector_resize(&part, no_of_nodes));
+    IGRAPH_CHECK(igraph_vector_update(&part, membership));
+    for (i=0; i<no_of_nodes; i++) {
+      VECTOR(level)[i]=i;
+    }
+
+    while (1) {
+      IGRAPH_ALLOW_INTERRUPTION();
+
+      igraph_i_leiden_move(&g, &ws, VECTOR(part));
+      IGRAPH_CHECK(igraph_i_multilevel_reindex(&part, &no_comms));
+      if (no_comms == g.vcount) { break; }
+
+      IGRAPH_CHECK(igraph_vector_resize(&refined, g.vcount));
+      igraph_i_leiden_refine(&g, &ws, VECTOR(part), VECTOR(refined));
+      IGRAPH_CHECK(igraph_i_multilevel_reindex(&refined, &no_refined));
+      if (no_refined == g.vcount) { break; }
+
+      /* The refined communities are the vertices of the next level,
+	 they start in the community they were refined from */
+      IGRAPH_CHECK(igraph_vector_resize(&newpart, no_refined));
+      for (i=0; i<g.vcount; i++) {
+	VECTOR(newpart)[ (long int) VECTOR(refined)[i] ]=VECTOR(part)[i];
+      }
+      for (i=0; i<no_of_nodes; i++) {
+	VECTOR(level)[i]=VECTOR(refined)[ (long int) VECTOR(level)[i] ];
+      }
+      IGRAPH_CHECK(igraph_i_multilevel_graph_aggregate(&g, &refined, 
+						       no_refined));
+      IGRAPH_CHECK(igraph_vector_update(&part, &newpart));
+    }
+
+    igraph_i_multilevel_graph_destroy(&g);
+    IGRAPH_FINALLY_CLEAN(1);
+
+    /* The communities of the input vertices */
+    IGRAPH_CHECK(igraph_vector_resize(&newpart, no_of_nodes));
+    for (i=0; i<no_of_nodes; i++) {
+      VECTOR(newpart)[i]=VECTOR(part)[ (long int) VECTOR(level)[i] ];
+    }
+    IGRAPH_CHECK(igraph_i_multilevel_reindex(&newpart, &no_comms));
+    if (igraph_vector_all_e(&newpart, membership)) { break; }
+    IGRAPH_CHECK(igraph_vector_update(membership, &newpart));
+  }
+
+  igraph_vector_destroy(&newpart);
+  igraph_vector_destroy(&refined);
+  igraph_vector_destroy(&part);
+  igraph_vector_destroy(&level);
+  igraph_i_leiden_ws_destroy(&ws);
+  IGRAPH_FINALLY_CLEAN(5);
+
+  if (modularity) {
+    IGRAPH_CHECK(igraph_modularity(graph, membership, modularity, weights));
+  }
 
   return 0;
 }
@@ -3526,3 +4682,336 @@ int igraph_i_compare_communities_rand(const igraph_vector_t *v1,
 
   return IGRAPH_SUCCESS;
 }
+
+/* Data shared by the threads of igraph_compare_communities_matrix().
+ * The clusters of all partitions are numbered globally, the clusters
+ * of partition p are coff[p] ... coff[p+1]-1. cstart has k+1 elements
+ * for a partition with k clusters, the members of cluster c of
+ * partition p are at positions cstart[i+c] ... cstart[i+c+1]-1 of
+ * the p-th part of 'order', with i = IGRAPH_I_COMMCMP_CSIDX(d, p, 0). */
+
+typedef struct igraph_i_commcmp_data_t {
+  long int n;
+  igraph_community_comparison_t method;
+  igraph_vector_int_t memb;
+  igraph_vector_int_t order;
+  igraph_vector_long_t coff;
+  igraph_vector_long_t cstart;
+  igraph_vector_t logp;
+  igraph_vector_t entropy;
+  igraph_vector_t pairs;
+} igraph_i_commcmp_data_t;
+
+#define IGRAPH_I_COMMCMP_CSIDX(d, p, c) \
+  (VECTOR((d)->coff)[(p)] + (p) + (c))
+
+static void igraph_i_commcmp_data_destroy(igraph_i_commcmp_data_t *d) {
+  igraph_vector_int_destroy(&d->memb);
+  igraph_vector_int_destroy(&d->order);
+  igraph_vector_long_destroy(&d->coff);
+  igraph_vector_long_destroy(&d->cstart);
+  igraph_vector_destroy(&d->logp);
+  igraph_vector_destroy(&d->entropy);
+  igraph_vector_destroy(&d->pairs);
+}
+
+/* Reindexes all membership vectors and calculates everything that
+   only depends on a single partition: the vertices ordered by
+   cluster, the logarithms of the relative cluster sizes, the entropy
+   and the fraction of vertex pairs within clusters. */
+
+static int igraph_i_commcmp_data_init(igraph_i_commcmp_data_t *d,
+                                      const igraph_vector_ptr_t *comms,
+                                      igraph_community_comparison_t method,
+                                      long int *maxk) {
+  long int np = igraph_vector_ptr_size(comms);
+  long int n = igraph_vector_size(VECTOR(*comms)[0]);
+  long int p, i, c, nc = 0;
+  igraph_vector_t tmp;
+
+  d->n = n;
+  d->method = method;
+  *maxk = 0;
+
+  IGRAPH_VECTOR_INIT_FINALLY(&tmp, 0);
+  IGRAPH_CHECK(igraph_vector_int_init(&d->memb, np * n));
+  IGRAPH_FINALLY(igraph_vector_int_destroy, &d->memb);
+  IGRAPH_CHECK(igraph_vector_int_init(&d->order, np * n));
+  IGRAPH_FINALLY(igraph_vector_int_destroy, &d->order);
+  IGRAPH_CHECK(igraph_vector_long_init(&d->coff, np + 1));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &d->coff);
+  IGRAPH_CHECK(igraph_vector_long_init(&d->cstart, 0));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &d->cstart);
+  IGRAPH_VECTOR_INIT_FINALLY(&d->logp, 0);
+  IGRAPH_VECTOR_INIT_FINALLY(&d->entropy, np);
+  IGRAPH_VECTOR_INIT_FINALLY(&d->pairs, np);
+
+  for (p = 0; p < np; p++) {
+    int *memb = VECTOR(d->memb) + p * n;
+    int *order = VECTOR(d->order) + p * n;
+    long int k, cs, ls;
+    long int *start;
+    double h = 0.0, pairs = 0.0;
+
+    IGRAPH_CHECK(igraph_vector_update(&tmp, VECTOR(*comms)[p]));
+    IGRAPH_CHECK(igraph_reindex_membership(&tmp, 0));
+    k = (long int) igraph_vector_max(&tmp) + 1;
+    if (k > *maxk) {
+      *maxk = k;
+    }
+    VECTOR(d->coff)[p + 1] = nc + k;
+    cs = igraph_vector_long_size(&d->cstart);
+    ls = igraph_vector_size(&d->logp);
+    IGRAPH_CHECK(igraph_vector_long_resize(&d->cstart, cs + k + 1));
+    IGRAPH_CHECK(igraph_vector_resize(&d->logp, ls + k));
+    start = VECTOR(d->cstart) + cs;
+    nc += k;
+
+    /* Counting sort of the vertices by cluster */
+    memset(start, 0, sizeof(long int) * (size_t) (k + 1));
+    for (i = 0; i < n; i++) {
+      memb[i] = (int) VECTOR(tmp)[i];
+      start[memb[i] + 1]++;
+    }
+    for (c = 0; c < k; c++) {
+      double s = start[c + 1];
+      double q = s / n;
+      h -= q * log(q);
+      pairs += q * (s - 1) / (n - 1);
+      VECTOR(d->logp)[ls + c] = log(q);
+      start[c + 1] += start[c];
+    }
+    for (i = 0; i < n; i++) {
+      order[start[memb[i]]++] = (int) i;
+    }
+    for (c = k; c > 0; c--) {
+      start[c] = start[c - 1];
+    }
+    start[0] = 0;
+
+    VECTOR(d->entropy)[p] = h;
+    VECTOR(d->pairs)[p] = pairs;
+  }
+
+  igraph_vector_destroy(&tmp);
+  IGRAPH_FINALLY_CLEAN(8);
+
+  return 0;
+}
+
+/* Compares partitions a and b, the contingency table is built row by
+   row, with the help of 'cnt', 'colmax' and 'touched', each of them
+   must have the size of the largest number of clusters in a
+   partition. 'cnt' and 'colmax' must be all zero and they are left
+   all zero. Must not allocate memory, this runs in parallel. */
+
+static igraph_real_t igraph_i_commcmp_pair(const igraph_i_commcmp_data_t *d,
+                                           long int a, long int b,
+                                           int *cnt, int *colmax,
+                                           int *touched) {
+  long int n = d->n;
+  const int *memb = VECTOR(d->memb) + b * n;
+  const int *order = VECTOR(d->order) + a * n;
+  const long int *start = VECTOR(d->cstart) + IGRAPH_I_COMMCMP_CSIDX(d, a, 0);
+  const igraph_real_t *logpa = VECTOR(d->logp) + VECTOR(d->coff)[a];
+  const igraph_real_t *logpb = VECTOR(d->logp) + VECTOR(d->coff)[b];
+  long int ka = VECTOR(d->coff)[a + 1] - VECTOR(d->coff)[a];
+  long int kb = VECTOR(d->coff)[b + 1] - VECTOR(d->coff)[b];
+  long int c, i, j, nt;
+  long int rowsum = 0, colsum = 0;
+  double acc = 0.0, ha, hb, pa, pb, res;
+
+  for (c = 0; c < ka; c++) {
+    int rowmax = 0;
+    nt = 0;
+    for (i = start[c]; i < start[c + 1]; i++) {
+      int l = memb[order[i]];
+      if (cnt[l] == 0) {
+        touched[nt++] = l;
+      }
+      cnt[l]++;
+    }
+    for (j = 0; j < nt; j++) {
+      int l = touched[j], x = cnt[l];
+      double q = ((double) x) / n;
+      cnt[l] = 0;
+      switch (d->method) {
+      case IGRAPH_COMMCMP_VI:
+      case IGRAPH_COMMCMP_NMI:
+        acc += q * (log(q) - logpa[c] - logpb[l]);
+        break;
+      case IGRAPH_COMMCMP_SPLIT_JOIN:
+        if (x > rowmax) {
+          rowmax = x;
+        }
+        if (x > colmax[l]) {
+          colmax[l] = x;
+        }
+        break;
+      default:
+        acc += q * (x - 1) / (n - 1);
+        break;
+      }
+    }
+    rowsum += rowmax;
+  }
+
+  ha = VECTOR(d->entropy)[a];
+  hb = VECTOR(d->entropy)[b];
+  pa = VECTOR(d->pairs)[a];
+  pb = VECTOR(d->pairs)[b];
+
+  switch (d->method) {
+  case IGRAPH_COMMCMP_VI:
+    res = ha + hb - 2 * acc;
+    break;
+  case IGRAPH_COMMCMP_NMI:
+    res = (ha == 0 && hb == 0) ? 1 : 2 * acc / (ha + hb);
+    break;
+  case IGRAPH_COMMCMP_SPLIT_JOIN:
+    for (c = 0; c < kb; c++) {
+      colsum += colmax[c];
+      colmax[c] = 0;
+    }
+    res = (n - rowsum) + (n - colsum);
+    break;
+  default:
+    res = 1.0 + 2 * acc - pa - pb;
+    if (d->method == IGRAPH_COMMCMP_ADJUSTED_RAND) {
+      double expected = pa * pb + (1 - pa) * (1 - pb);
+      res = (res - expected) / (1 - expected);
+    }
+    break;
+  }
+
+  return res;
+}
+
+/**
+ * \ingroup communities
+ * \function igraph_compare_communities_matrix
+ * \brief Compares all pairs of a set of community structures
+ *
+ * This function gives the same results as calling \ref
+ * igraph_compare_communities() for every pair of the given community
+ * structures, but it is much faster if there are many of them. The
+ * membership vectors are reindexed and sorted only once, and the
+ * contingency table of each pair is built directly, with the help of
+ * a counter array, instead of a sparse matrix. The pairs are compared
+ * in parallel, if igraph was compiled with OpenMP support.
+ *
+ * </para><para>
+ * The function needs about 8k bytes of extra memory per
+ * element, for k community structures: the reindexed membership
+ * vectors and the element orders are kept in memory during the whole
+ * calculation.
+ *
+ * \param comms  Pointer vector, it contains pointers to the
+ *     membership vectors (<type>igraph_vector_t</type> objects) of
+ *     the community structures. All of them must have the same
+ *     non-zero length.
+ * \param res  Pointer to an initialized matrix, the result is stored
+ *     here. It will be a symmetric square matrix, the element in row
+ *     i and column j is the comparison of the i-th and the j-th
+ *     community structure. The diagonal is also calculated.
+ * \param method  The comparison method to use, the same as in \ref
+ *     igraph_compare_communities().
+ * \return Error code.
+ *
+ * \sa \ref igraph_compare_communities() to compare only two
+ * community structures.
+ *
+ * Time complexity: O(k n log(n) + k^2 n) for k community structures
+ * of n elements each.
+ */
+
+int igraph_compare_communities_matrix(const igraph_vector_ptr_t *comms,
+                                      igraph_matrix_t *res,
+                                      igraph_community_comparison_t method) {
+  long int np = igraph_vector_ptr_size(comms);
+  long int npairs = np * (np + 1) / 2;
+  long int p, q, t, n, maxk, nthreads;
+  igraph_i_commcmp_data_t data;
+  igraph_vector_int_t ws;
+  igraph_vector_long_t pa, pb;
+  volatile int interrupted = 0;
+
+  if (method != IGRAPH_COMMCMP_VI && method != IGRAPH_COMMCMP_NMI &&
+      method != IGRAPH_COMMCMP_SPLIT_JOIN && method != IGRAPH_COMMCMP_RAND &&
+      method != IGRAPH_COMMCMP_ADJUSTED_RAND) {
+    IGRAPH_ERROR("unknown community comparison method", IGRAPH_EINVAL);
+  }
+
+  IGRAPH_CHECK(igraph_matrix_resize(res, np, np));
+  if (np == 0) {
+    return 0;
+  }
+
+  n = igraph_vector_size(VECTOR(*comms)[0]);
+  if (n == 0) {
+    IGRAPH_ERROR("community membership vectors are empty", IGRAPH_EINVAL);
+  }
+  for (p = 1; p < np; p++) {
+    if (igraph_vector_size(VECTOR(*comms)[p]) != n) {
+      IGRAPH_ERROR("community membership vectors have different lengths",
+                   IGRAPH_EINVAL);
+    }
+  }
+
+  IGRAPH_CHECK(igraph_i_commcmp_data_init(&data, comms, method, &maxk));
+  IGRAPH_FINALLY(igraph_i_commcmp_data_destroy, &data);
+
+  /* The list of pairs, including the diagonal */
+  IGRAPH_CHECK(igraph_vector_long_init(&pa, npairs));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &pa);
+  IGRAPH_CHECK(igraph_vector_long_init(&pb, npairs));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &pb);
+  for (p = 0, t = 0; p < np; p++) {
+    for (q = p; q < np; q++, t++) {
+      VECTOR(pa)[t] = p;
+      VECTOR(pb)[t] = q;
+    }
+  }
+
+  nthreads = IGRAPH_I_MAX_THREADS();
+  if (nthreads > npairs) {
+    nthreads = npairs;
+  }
+
+  /* cnt, colmax and touched for each thread */
+  IGRAPH_CHECK(igraph_vector_int_init(&ws, 3 * maxk * nthreads));
+  IGRAPH_FINALLY(igraph_vector_int_destroy, &ws);
+
+#pragma omp parallel num_threads(nthreads) private(t)
+  {
+    long int tid = IGRAPH_I_THREAD_NUM();
+    long int nt = IGRAPH_I_NUM_THREADS();
+    long int from = IGRAPH_I_THREAD_BEGIN(npairs, tid, nt);
+    long int to = IGRAPH_I_THREAD_END(npairs, tid, nt);
+    int *cnt = VECTOR(ws) + 3 * maxk * tid;
+    int *colmax = cnt + maxk;
+    int *touched = colmax + maxk;
+
+    for (t = from; t < to && !interrupted; t++) {
+      long int a = VECTOR(pa)[t], b = VECTOR(pb)[t];
+      igraph_real_t r = igraph_i_commcmp_pair(&data, a, b, cnt, colmax,
+                                              touched);
+      MATRIX(*res, a, b) = r;
+      MATRIX(*res, b, a) = r;
+      IGRAPH_I_ALLOW_INTERRUPTION_PARALLEL(interrupted);
+    }
+  }
+
+  if (interrupted) {
+    IGRAPH_FINALLY_FREE();
+    return IGRAPH_INTERRUPTED;
+  }
+
+  igraph_vector_int_destroy(&ws);
+  igraph_vector_long_destroy(&pb);
+  igraph_vector_long_destroy(&pa);
+  igraph_i_commcmp_data_destroy(&data);
+  IGRAPH_FINALLY_CLEAN(4);
+
+  return 0;
+}
@@ -29,6 +29,7 @@
 #include "igraph_vector.h"
 #include "igraph_interface.h"
 #include "igraph_adjlist.h"
+#include "igraph_visitor_internal.h"
 
 int igraph_i_eccentricity(const igraph_t *graph,
 			  igraph_vector_t *res,
@@ -43,6 +44,9 @@ int igraph_i_eccentricity(const igraph_t *graph,
   int i, mark=1;
   igraph_vector_t vneis;
   igraph_vector_int_t *neis;
+  igraph_i_bfs_engine_ws_t engine;
+  igraph_bool_t use_engine=
+    igraph_i_bfs_engine_get() == IGRAPH_BFS_DIRECTION_OPTIMIZING;
 
   IGRAPH_CHECK(igraph_dqueue_long_init(&q, 100));
   IGRAPH_FINALLY(igraph_dqueue_long_destroy, &q);
@@ -53,7 +57,10 @@ int igraph_i_eccentricity(const igraph_t *graph,
   IGRAPH_CHECK(igraph_vector_int_init(&counted, no_of_nodes));
   IGRAPH_FINALLY(igraph_vector_int_destroy, &counted);
 
-  if (!adjlist) {
+  if (use_engine) {
+    IGRAPH_CHECK(igraph_i_bfs_engine_init(graph, &engine, mode));
+    IGRAPH_FINALLY(igraph_i_bfs_engine_destroy, &engine);
+  } else if (!adjlist) {
     IGRAPH_VECTOR_INIT_FINALLY(&vneis, 0);
   }
 
@@ -66,6 +73,15 @@ int igraph_i_eccentricity(const igraph_t *graph,
 
     long int source;
     source=IGRAPH_VIT_GET(vit);
+
+    if (use_engine) {
+      /* The vertices are reached in the order of their distance */
+      long int nreached=igraph_i_bfs_engine_run(&engine, source);
+      VECTOR(*res)[i]=engine.dist[engine.order[nreached-1]];
+      IGRAPH_ALLOW_INTERRUPTION();
+      continue;
+    }
+
     IGRAPH_CHECK(igraph_dqueue_long_push(&q, source));
     IGRAPH_CHECK(igraph_dqueue_long_push(&q, 0));
     VECTOR(counted)[source]=mark;
@@ -109,7 +125,10 @@ int igraph_i_eccentricity(const igraph_t *graph,
 
   } /* for IGRAPH_VIT_NEXT(vit) */
 
-  if (!adjlist) {
+  if (use_engine) {
+    igraph_i_bfs_engine_destroy(&engine);
+    IGRAPH_FINALLY_CLEAN(1);
+  } else if (!adjlist) {
     igraph_vector_destroy(&vneis);
     IGRAPH_FINALLY_CLEAN(1);
   }
@@ -28,9 +28,11 @@
 #include "igraph_progress.h"
 #include "igraph_interrupt_internal.h"
 #include "igraph_structural.h"
-#include "igraph_vector_ptr.h"
+#include "igraph_qsort.h"
 #include "config.h"
 
+#include <string.h>
+
 /* #define IGRAPH_FASTCOMM_DEBUG */
 
 #ifdef _MSC_VER
@@ -81,52 +83,82 @@ void debug(const char* fmt, ...) {
  * the index vector.
  */
 
-/* Structure storing a pair of communities along with their dQ values */
+/* Structure storing a pair of communities. The two pairs belonging to
+ * an edge are stored next to each other in the pair array, they share
+ * the increase in modularity achieved when joining them, which is
+ * stored in the dq vector, see the macros below. */
 typedef struct s_igraph_i_fastgreedy_commpair {
-  long int first;       /* first member of the community pair */
-  long int second;      /* second member of the community pair */
-  igraph_real_t *dq;    /* pointer to a member of the dq vector storing the */
-                        /* increase in modularity achieved when joining */
-  struct s_igraph_i_fastgreedy_commpair *opposite;
+  igraph_integer_t first;   /* first member of the community pair */
+  igraph_integer_t second;  /* second member of the community pair */
 } igraph_i_fastgreedy_commpair;
 
 /* Structure storing a community */
 typedef struct {
   igraph_integer_t id;      /* Identifier of the community (for merges matrix) */
   igraph_integer_t size;    /* Size of the community */
-  igraph_vector_ptr_t neis; /* references to neighboring communities */
+  long int neis;            /* start of the neighbor list in the pool */
+  long int no_of_neis;      /* number of neighboring communities */
   igraph_i_fastgreedy_commpair* maxdq; /* community pair with maximal dq */
 } igraph_i_fastgreedy_community;
 
-/* Global community list structure */
+/* Global community list structure.
+ *
+ * The neighbor lists of the communities, i.e. the indices of their
+ * pairs in the pair array, sorted by the `second` field, are stored in
+ * a common pool. Every list is in a block of the pool that is preceded
+ * by the index of the community and the capacity of the block. When two
+ * communities are joined, the merged list is written into the block of
+ * the first one, which is extended or moved to the end of the pool if
+ * it is too small, and the block of the second community becomes
+ * garbage. If there is no room at the end of the pool, it is compacted
+ * or enlarged. */
 typedef struct {
   long int no_of_communities, n;  /* number of communities, number of vertices */
   igraph_i_fastgreedy_community* e;     /* list of communities */
   igraph_i_fastgreedy_community** heap; /* heap of communities */
   igraph_integer_t *heapindex; /* heap index to speed up lookup by community idx */
+  igraph_i_fastgreedy_commpair *pairs;  /* community pairs, two for each edge */
+  igraph_real_t *dq;                    /* dq values, one for each edge */
+  igraph_integer_t *pool;               /* neighbor lists */
+  long int pool_size, pool_end, pool_garbage;
+  long int merging;       /* community being merged into, or -1, and */
+  long int merging_rest;  /* the not yet merged part of its list */
+  long int merging_rest_size;
 } igraph_i_fastgreedy_community_list;
 
+#define igraph_i_fastgreedy_dq(list, p) \
+  ((list)->dq[((p) - (list)->pairs) / 2])
+#define igraph_i_fastgreedy_opposite(list, p) \
+  ((list)->pairs + (((p) - (list)->pairs) ^ 1))
+#define igraph_i_fastgreedy_nei(list, c, i) \
+  ((list)->pairs + (list)->pool[(list)->e[(c)].neis + (i)])
+
 /* Scans the community neighborhood list for the new maximal dq value.
  * Returns 1 if the maximum is different from the previous one,
  * 0 otherwise. */
 int igraph_i_fastgreedy_community_rescan_max(
+  igraph_i_fastgreedy_community_list* list,
   igraph_i_fastgreedy_community* comm) {
-  long int i, n;
-  igraph_i_fastgreedy_commpair *p, *best;
-  igraph_real_t bestdq, currdq;
-
-  n = igraph_vector_ptr_size(&comm->neis);
-  if (n == 0) {
+  long int i, n, rest = 0, rest_size = 0;
+  igraph_i_fastgreedy_commpair *p, *best = 0;
+  igraph_real_t bestdq = 0, currdq;
+  igraph_integer_t *neis = list->pool + comm->neis;
+
+  n = comm->no_of_neis;
+  if (comm - list->e == list->merging) {
+    /* the list is in two parts during a merge, see igraph_community_fastgreedy */
+    rest = list->merging_rest;
+    rest_size = list->merging_rest_size;
+  }
+  if (n + rest_size == 0) {
     comm->maxdq = 0;
     return 1;
   }
 
-  best = (igraph_i_fastgreedy_commpair*)VECTOR(comm->neis)[0];
-  bestdq = *best->dq;
-  for (i = 1; i < n; i++) {
-	p = (igraph_i_fastgreedy_commpair*)VECTOR(comm->neis)[i];
-    currdq = *p->dq;
-	if (currdq > bestdq) {
+  for (i = 0; i < n + rest_size; i++) {
+	p = list->pairs + (i < n ? neis[i] : list->pool[rest + i - n]);
+    currdq = igraph_i_fastgreedy_dq(list, p);
+	if (best == 0 || currdq > bestdq) {
       best = p;
       bestdq = currdq;
     }
@@ -143,13 +175,110 @@ int igraph_i_fastgreedy_community_rescan_max(
 /* Destroys the global community list object */
 void igraph_i_fastgreedy_community_list_destroy(
   igraph_i_fastgreedy_community_list* list) {
-  long int i;
-  for (i=0; i<list->n; i++) {
-	igraph_vector_ptr_destroy(&list->e[i].neis);
-  }
   free(list->e);
   if (list->heapindex != 0) free(list->heapindex);
   if (list->heap != 0) free(list->heap);
+  if (list->pairs != 0) free(list->pairs);
+  if (list->dq != 0) free(list->dq);
+  if (list->pool != 0) free(list->pool);
+}
+
+/* Moves the neighbor lists to the beginning of the pool, in the order of
+ * their blocks, and drops the unused capacity of the blocks */
+void igraph_i_fastgreedy_community_list_compact(
+  igraph_i_fastgreedy_community_list* list) {
+  long int from = 0, to = 0, c, n, capacity;
+  igraph_integer_t *pool = list->pool;
+
+  while (from < list->pool_end) {
+    c = pool[from];
+    capacity = pool[from+1];
+    if (c >= 0) {
+      n = list->e[c].no_of_neis;
+      memmove(pool + to + 2, pool + from + 2, sizeof(igraph_integer_t) * (size_t) n);
+      pool[to] = (igraph_integer_t) c;
+      pool[to+1] = (igraph_integer_t) n;
+      list->e[c].neis = to + 2;
+      to += n + 2;
+    }
+    from += capacity + 2;
+  }
+  list->pool_end = to;
+  list->pool_garbage = 0;
+}
+
+/* Makes sure that the block of community c can hold `capacity` neighbors.
+ * The block is extended if it is at the end of the pool, otherwise a new
+ * block is allocated at the end, the neighbor list is copied there and
+ * the old block becomes garbage. Note that the pool may be compacted, so
+ * the lists of the other communities may move as well. */
+int igraph_i_fastgreedy_community_list_reserve(
+  igraph_i_fastgreedy_community_list* list, long int c, long int capacity) {
+  igraph_i_fastgreedy_community *comm = &list->e[c];
+  igraph_integer_t *pool = list->pool;
+  long int old_capacity = pool[comm->neis-1], size;
+
+  if (old_capacity >= capacity) return 0;
+
+  if (comm->neis + old_capacity == list->pool_end &&
+      comm->neis + capacity <= list->pool_size) {
+    /* last block, extend it */
+    pool[comm->neis-1] = (igraph_integer_t) capacity;
+    list->pool_end = comm->neis + capacity;
+    return 0;
+  }
+
+  if (list->pool_end + capacity + 2 > list->pool_size) {
+    /* no room at the end; compact the pool if at least the half of it
+     * is garbage, and enlarge it if it is still too small */
+    if (2 * list->pool_garbage >= list->pool_end) {
+      igraph_i_fastgreedy_community_list_compact(list);
+    }
+    if (list->pool_end + capacity + 2 > list->pool_size) {
+      size = list->pool_size + list->pool_size / 2;
+      if (size < list->pool_end + capacity + 2) {
+	size = list->pool_end + capacity + 2;
+      }
+      pool = igraph_Realloc(list->pool, (size_t) size, igraph_integer_t);
+      if (pool == 0) {
+	IGRAPH_ERROR("can't run fast greedy community detection", IGRAPH_ENOMEM);
+      }
+      list->pool = pool;
+      list->pool_size = size;
+    }
+  }
+
+  /* new block at the end, the old one is garbage */
+  pool[comm->neis-2] = -1;
+  list->pool_garbage += pool[comm->neis-1] + 2;
+  pool[list->pool_end] = (igraph_integer_t) c;
+  pool[list->pool_end+1] = (igraph_integer_t) capacity;
+  memcpy(pool + list->pool_end + 2, pool + comm->neis,
+	 sizeof(igraph_integer_t) * (size_t) comm->no_of_neis);
+  comm->neis = list->pool_end + 2;
+  list->pool_end += capacity + 2;
+
+  return 0;
+}
+
+/* Moves the next pair of the not yet merged part of the neighbor list
+ * of the community being merged into to the merged part */
+void igraph_i_fastgreedy_community_list_merge_next(
+  igraph_i_fastgreedy_community_list* list) {
+  igraph_i_fastgreedy_community *comm = &list->e[list->merging];
+  list->pool[comm->neis + comm->no_of_neis] = list->pool[list->merging_rest];
+  comm->no_of_neis++;
+  list->merging_rest++;
+  list->merging_rest_size--;
+}
+
+/* Frees the block of community c, it becomes garbage */
+void igraph_i_fastgreedy_community_list_release(
+  igraph_i_fastgreedy_community_list* list, long int c) {
+  igraph_i_fastgreedy_community *comm = &list->e[c];
+  list->pool[comm->neis-2] = -1;
+  list->pool_garbage += list->pool[comm->neis-1] + 2;
+  comm->no_of_neis = 0;
 }
 
 /* Community list heap maintenance: sift down */
@@ -165,9 +294,9 @@ void igraph_i_fastgreedy_community_list_sift_down(
   while (root*2+1 < list->no_of_communities) {
     child = root*2+1;
 	if (child+1 < list->no_of_communities &&
-		*heap[child]->maxdq->dq < *heap[child+1]->maxdq->dq)
+		igraph_i_fastgreedy_dq(list, heap[child]->maxdq) < igraph_i_fastgreedy_dq(list, heap[child+1]->maxdq))
 	  child++;
-	if (*heap[root]->maxdq->dq < *heap[child]->maxdq->dq) {
+	if (igraph_i_fastgreedy_dq(list, heap[root]->maxdq) < igraph_i_fastgreedy_dq(list, heap[child]->maxdq)) {
 	  c1 = heap[root]->maxdq->first;
 	  c2 = heap[child]->maxdq->first;
 
@@ -196,7 +325,7 @@ void igraph_i_fastgreedy_community_list_sift_up(
   root = idx;
   while (root>0) {
     parent = (root-1)/2;
-	if (*heap[parent]->maxdq->dq < *heap[root]->maxdq->dq) {
+	if (igraph_i_fastgreedy_dq(list, heap[parent]->maxdq) < igraph_i_fastgreedy_dq(list, heap[root]->maxdq)) {
 	  c1 = heap[root]->maxdq->first;
 	  c2 = heap[parent]->maxdq->first;
 	  
@@ -234,8 +363,8 @@ void igraph_i_fastgreedy_community_list_dump_heap(
 	debug("(%ld, %p, %p)", i, list->heap[i],
 	  list->heap[i]->maxdq);
 	if (list->heap[i]->maxdq) {
-	  debug(" (%ld, %ld, %.7f)", list->heap[i]->maxdq->first,
-		list->heap[i]->maxdq->second, *list->heap[i]->maxdq->dq);
+	  debug(" (%ld, %ld, %.7f)", (long int) list->heap[i]->maxdq->first,
+		(long int) list->heap[i]->maxdq->second, igraph_i_fastgreedy_dq(list, list->heap[i]->maxdq));
 	}
 	debug("\n");
   }
@@ -250,8 +379,8 @@ void igraph_i_fastgreedy_community_list_check_heap(
   igraph_i_fastgreedy_community_list* list) {
   long int i;
   for (i=0; i<list->no_of_communities/2; i++) {
-	if ((2*i+1<list->no_of_communities && *list->heap[i]->maxdq->dq < *list->heap[2*i+1]->maxdq->dq) ||
-		(2*i+2<list->no_of_communities && *list->heap[i]->maxdq->dq < *list->heap[2*i+2]->maxdq->dq)) {
+	if ((2*i+1<list->no_of_communities && igraph_i_fastgreedy_dq(list, list->heap[i]->maxdq) < igraph_i_fastgreedy_dq(list, list->heap[2*i+1]->maxdq)) ||
+		(2*i+2<list->no_of_communities && igraph_i_fastgreedy_dq(list, list->heap[i]->maxdq) < igraph_i_fastgreedy_dq(list, list->heap[2*i+2]->maxdq))) {
 	  IGRAPH_WARNING("Heap property violated");
 	  debug("Position: %ld, %ld and %ld\n", i, 2*i+1, 2*i+2);
 	  igraph_i_fastgreedy_community_list_dump_heap(list);
@@ -272,12 +401,12 @@ void igraph_i_fastgreedy_community_list_remove(
   list->heapindex[commidx] = -1;
 
   /* Now remove the element */
-  old=*list->heap[idx]->maxdq->dq;
+  old=igraph_i_fastgreedy_dq(list, list->heap[idx]->maxdq);
   list->heap[idx] = list->heap[list->no_of_communities-1];
   list->no_of_communities--;
   
   /* Recover heap property */
-  if (old > *list->heap[idx]->maxdq->dq)
+  if (old > igraph_i_fastgreedy_dq(list, list->heap[idx]->maxdq))
 	igraph_i_fastgreedy_community_list_sift_down(list, idx);
   else
 	igraph_i_fastgreedy_community_list_sift_up(list, idx);
@@ -322,9 +451,9 @@ void igraph_i_fastgreedy_community_remove_nei(
   igraph_real_t olddq;
 
   comm=&list->e[c];
-  n=igraph_vector_ptr_size(&comm->neis);
+  n=comm->no_of_neis;
   for (i=0; i<n; i++) {
-	p=(igraph_i_fastgreedy_commpair*)VECTOR(comm->neis)[i];
+	p=igraph_i_fastgreedy_nei(list, c, i);
     if (p->second == k) {
 	  /* Check current maxdq */
 	  if (comm->maxdq == p) rescan=1;
@@ -332,13 +461,15 @@ void igraph_i_fastgreedy_community_remove_nei(
 	}
   }
   if (i<n) {
-	olddq = *comm->maxdq->dq;
-	igraph_vector_ptr_remove(&comm->neis, i);
+	olddq = igraph_i_fastgreedy_dq(list, comm->maxdq);
+	memmove(list->pool + comm->neis + i, list->pool + comm->neis + i + 1,
+		sizeof(igraph_integer_t) * (size_t) (n - i - 1));
+	comm->no_of_neis--;
 	if (rescan) {
-	  igraph_i_fastgreedy_community_rescan_max(comm);
+	  igraph_i_fastgreedy_community_rescan_max(list, comm);
       i=igraph_i_fastgreedy_community_list_find_in_heap(list, c);
 	  if (comm->maxdq) {
-        if (*comm->maxdq->dq > olddq)
+        if (igraph_i_fastgreedy_dq(list, comm->maxdq) > olddq)
 		  igraph_i_fastgreedy_community_list_sift_up(list, i);
         else
 		  igraph_i_fastgreedy_community_list_sift_down(list, i);
@@ -352,12 +483,12 @@ void igraph_i_fastgreedy_community_remove_nei(
   }
 }
 
-/* Auxiliary function to sort a community pair list with respect to the
- * `second` field */
-int igraph_i_fastgreedy_commpair_cmp(const void* p1, const void* p2) {
+/* Auxiliary function to sort a neighbor list (pair indices) with respect
+ * to the `second` field of the pairs */
+int igraph_i_fastgreedy_commpair_cmp(void* pairs, const void* p1, const void* p2) {
   igraph_i_fastgreedy_commpair *cp1, *cp2;
-  cp1=*(igraph_i_fastgreedy_commpair**)p1;
-  cp2=*(igraph_i_fastgreedy_commpair**)p2;
+  cp1=(igraph_i_fastgreedy_commpair*)pairs + *(igraph_integer_t*)p1;
+  cp2=(igraph_i_fastgreedy_commpair*)pairs + *(igraph_integer_t*)p2;
   return (int) (cp1->second - cp2->second);
 }
 
@@ -367,19 +498,20 @@ int igraph_i_fastgreedy_commpair_cmp(const void* p1, const void* p2) {
 void igraph_i_fastgreedy_community_sort_neighbors_of(
   igraph_i_fastgreedy_community_list* list, long int index,
   igraph_i_fastgreedy_commpair* changed_pair) {
-  igraph_vector_ptr_t* vec;
+  igraph_integer_t* vec, changed;
   long int i, n;
   igraph_bool_t can_skip_sort = 0;
   igraph_i_fastgreedy_commpair *other_pair;
 
-  vec = &list->e[index].neis;
+  vec = list->pool + list->e[index].neis;
+  n = list->e[index].no_of_neis;
   if (changed_pair != 0) {
     /* Optimized sorting */
 
     /* First we look for changed_pair in vec */
-    n = igraph_vector_ptr_size(vec);
+    changed = (igraph_integer_t) (changed_pair - list->pairs);
     for (i = 0; i < n; i++) {
-      if (VECTOR(*vec)[i] == changed_pair) {
+      if (vec[i] == changed) {
         break;
       }
     }
@@ -399,27 +531,27 @@ void igraph_i_fastgreedy_community_sort_neighbors_of(
 
       /* Shifting to the left */
       while (i > 0) {
-        other_pair = VECTOR(*vec)[i-1];
+        other_pair = list->pairs + vec[i-1];
         if (other_pair->second > changed_pair->second) {
-          VECTOR(*vec)[i] = other_pair;
+          vec[i] = vec[i-1];
           i--;
         } else {
           break;
         }
       }
-      VECTOR(*vec)[i] = changed_pair;
+      vec[i] = changed;
 
       /* Shifting to the right */
       while (i < n-1) {
-        other_pair = VECTOR(*vec)[i+1];
+        other_pair = list->pairs + vec[i+1];
         if (other_pair->second < changed_pair->second) {
-          VECTOR(*vec)[i] = other_pair;
+          vec[i] = vec[i+1];
           i++;
         } else {
           break;
         }
       }
-      VECTOR(*vec)[i] = changed_pair;
+      vec[i] = changed;
 
       /* Mark that we don't need a full sort */
       can_skip_sort = 1;
@@ -428,7 +560,8 @@ void igraph_i_fastgreedy_community_sort_neighbors_of(
 
   if (!can_skip_sort) {
     /* Fallback to full sorting */
-    igraph_vector_ptr_sort(vec, igraph_i_fastgreedy_commpair_cmp);
+    igraph_qsort_r(vec, (size_t) n, sizeof(igraph_integer_t), list->pairs,
+		   igraph_i_fastgreedy_commpair_cmp);
   }
 }
 
@@ -445,19 +578,19 @@ int igraph_i_fastgreedy_community_update_dq(
   to=p->first; from=p->second;
   comm_to=&list->e[to];
   comm_from=&list->e[from];
-  if (comm_to->maxdq == p && newdq >= *p->dq) {
+  if (comm_to->maxdq == p && newdq >= igraph_i_fastgreedy_dq(list, p)) {
 	/* If we are adjusting the current maximum and it is increased, we don't
 	 * have to re-scan for the new maximum */
-	*p->dq = newdq;
+	igraph_i_fastgreedy_dq(list, p) = newdq;
 	/* The maximum was increased, so perform a sift-up in the heap */
 	i = igraph_i_fastgreedy_community_list_find_in_heap(list, to);
 	igraph_i_fastgreedy_community_list_sift_up(list, i);
 	/* Let's check the opposite side. If the pair was not the maximal in
 	 * the opposite side (the other community list)... */
-	if (comm_from->maxdq != p->opposite) {
-	  if (*comm_from->maxdq->dq < newdq) {
+	if (comm_from->maxdq != igraph_i_fastgreedy_opposite(list, p)) {
+	  if (igraph_i_fastgreedy_dq(list, comm_from->maxdq) < newdq) {
 	    /* ...and it will become the maximal, we need to adjust and sift up */
-		comm_from->maxdq = p->opposite;
+		comm_from->maxdq = igraph_i_fastgreedy_opposite(list, p);
 	    j = igraph_i_fastgreedy_community_list_find_in_heap(list, from);
 	    igraph_i_fastgreedy_community_list_sift_up(list, j);
 	  } else {
@@ -471,19 +604,19 @@ int igraph_i_fastgreedy_community_update_dq(
 	  igraph_i_fastgreedy_community_list_sift_up(list, j);
 	}
 	return 1;
-  } else if (comm_to->maxdq != p && (newdq <= *comm_to->maxdq->dq)) {
+  } else if (comm_to->maxdq != p && (newdq <= igraph_i_fastgreedy_dq(list, comm_to->maxdq))) {
 	/* If we are modifying an item which is not the current maximum, and the
 	 * new value is less than the current maximum, we don't
 	 * have to re-scan for the new maximum */
-	olddq = *p->dq;
-	*p->dq = newdq;
+	olddq = igraph_i_fastgreedy_dq(list, p);
+	igraph_i_fastgreedy_dq(list, p) = newdq;
 	/* However, if the item was the maximum on the opposite side, we'd better
 	 * re-scan it */
-	if (comm_from->maxdq == p->opposite) {
+	if (comm_from->maxdq == igraph_i_fastgreedy_opposite(list, p)) {
 	  if (olddq>newdq) {
 		/* Decreased the maximum on the other side, we have to re-scan for the
 		 * new maximum */
-		igraph_i_fastgreedy_community_rescan_max(comm_from);
+		igraph_i_fastgreedy_community_rescan_max(list, comm_from);
   	    j = igraph_i_fastgreedy_community_list_find_in_heap(list, from);
 	    igraph_i_fastgreedy_community_list_sift_down(list, j);
 	  } else {
@@ -502,7 +635,7 @@ int igraph_i_fastgreedy_community_update_dq(
 	     given community, but we increase it so much that it will become
 		 the new maximum
      */
-    *p->dq = newdq;
+    igraph_i_fastgreedy_dq(list, p) = newdq;
     if (comm_to->maxdq != p) {
 	  /* case (2) */
 	  comm_to->maxdq = p;
@@ -511,10 +644,10 @@ int igraph_i_fastgreedy_community_update_dq(
 	  igraph_i_fastgreedy_community_list_sift_up(list, i);
 	  /* Opposite side. Chances are that the new value became the maximum
 	   * in the opposite side, but check it first */
-	  if (comm_from->maxdq != p->opposite) {
-		if (*comm_from->maxdq->dq < newdq) {
+	  if (comm_from->maxdq != igraph_i_fastgreedy_opposite(list, p)) {
+		if (igraph_i_fastgreedy_dq(list, comm_from->maxdq) < newdq) {
 		  /* Yes, it will become the new maximum */
-		  comm_from->maxdq = p->opposite;
+		  comm_from->maxdq = igraph_i_fastgreedy_opposite(list, p);
   	      j = igraph_i_fastgreedy_community_list_find_in_heap(list, from);
 	      igraph_i_fastgreedy_community_list_sift_up(list, j);
 		} else {
@@ -529,17 +662,17 @@ int igraph_i_fastgreedy_community_update_dq(
 	  /* case (1) */
 	  /* This is the worst, we have to re-scan the whole community to find
 	   * the new maximum and update the global maximum as well if necessary */
-      igraph_i_fastgreedy_community_rescan_max(comm_to);
+      igraph_i_fastgreedy_community_rescan_max(list, comm_to);
 	  /* The maximum was decreased, so perform a sift-down in the heap */
 	  i = igraph_i_fastgreedy_community_list_find_in_heap(list, to);
 	  igraph_i_fastgreedy_community_list_sift_down(list, i);
-  	  if (comm_from->maxdq != p->opposite) {
+  	  if (comm_from->maxdq != igraph_i_fastgreedy_opposite(list, p)) {
 		/* The one that we decreased on the opposite side is not the
 		 * maximal one. Nothing to do. */
 	  } else {
 		/* We decreased the maximal on the opposite side as well. Re-scan
 		 * and sift down */
-		igraph_i_fastgreedy_community_rescan_max(comm_from);
+		igraph_i_fastgreedy_community_rescan_max(list, comm_from);
 	    j = igraph_i_fastgreedy_community_list_find_in_heap(list, from);
 	    igraph_i_fastgreedy_community_list_sift_down(list, j);
       }
@@ -604,10 +737,11 @@ int igraph_community_fastgreedy(const igraph_t *graph,
 				igraph_vector_t *modularity, 
 				igraph_vector_t *membership) {
   long int no_of_edges, no_of_nodes, no_of_joins, total_joins;
-  long int i, j, k, n, m, from, to, dummy, best_no_of_joins;
+  long int i, j, k, n, m, from, to, dummy, best_no_of_joins, rest;
   igraph_integer_t ffrom, fto;
   igraph_eit_t edgeit;
   igraph_i_fastgreedy_commpair *pairs, *p1, *p2;
+  igraph_integer_t *tneis, *fneis;
   igraph_i_fastgreedy_community_list communities;
   igraph_vector_t a;
   igraph_real_t q, *dq, bestq, weight_sum, loop_weight_sum;
@@ -687,29 +821,30 @@ int igraph_community_fastgreedy(const igraph_t *graph,
   if (communities.heapindex == 0) {
 	IGRAPH_ERROR("can't run fast greedy community detection", IGRAPH_ENOMEM);
   }
+  communities.pairs = 0;
+  communities.dq = 0;
+  communities.pool = 0;
+  communities.merging = -1;
   IGRAPH_FINALLY_CLEAN(2);
   IGRAPH_FINALLY(igraph_i_fastgreedy_community_list_destroy, &communities);
   for (i=0; i<no_of_nodes; i++) {
-    igraph_vector_ptr_init(&communities.e[i].neis, 0);
     communities.e[i].id = (igraph_integer_t) i;
     communities.e[i].size = 1;
   }
 
   /* Create list of community pairs from edges */
   debug("Allocating dq vector\n");
-  dq = (igraph_real_t*)calloc((size_t) no_of_edges, sizeof(igraph_real_t));
+  dq = communities.dq = (igraph_real_t*)calloc((size_t) no_of_edges, sizeof(igraph_real_t));
   if (dq == 0) {
 	IGRAPH_ERROR("can't run fast greedy community detection", IGRAPH_ENOMEM);
   }
-  IGRAPH_FINALLY(free, dq);
   debug("Creating community pair list\n");
-  IGRAPH_CHECK(igraph_eit_create(graph, igraph_ess_all(0), &edgeit));
-  IGRAPH_FINALLY(igraph_eit_destroy, &edgeit);
-  pairs = (igraph_i_fastgreedy_commpair*)calloc(2*(size_t) no_of_edges, sizeof(igraph_i_fastgreedy_commpair));
+  pairs = communities.pairs = (igraph_i_fastgreedy_commpair*)calloc(2*(size_t) no_of_edges, sizeof(igraph_i_fastgreedy_commpair));
   if (pairs == 0) {
 	IGRAPH_ERROR("can't run fast greedy community detection", IGRAPH_ENOMEM);
   }
-  IGRAPH_FINALLY(free, pairs);
+  IGRAPH_CHECK(igraph_eit_create(graph, igraph_ess_all(0), &edgeit));
+  IGRAPH_FINALLY(igraph_eit_destroy, &edgeit);
   loop_weight_sum = 0;
   for (i=0, j=0; !IGRAPH_EIT_END(edgeit); i+=2, j++, IGRAPH_EIT_NEXT(edgeit)) {
     long int eidx = IGRAPH_EIT_GET(edgeit);
@@ -719,6 +854,7 @@ int igraph_community_fastgreedy(const igraph_t *graph,
 	from = (long int)ffrom; to = (long int)fto;
 	if (from == to) {
       loop_weight_sum += weights ? 2*VECTOR(*weights)[eidx] : 2;
+      pairs[i].first = pairs[i+1].first = -1;
       continue;
     }
 
@@ -730,26 +866,44 @@ int igraph_community_fastgreedy(const igraph_t *graph,
     } else {
 	  dq[j]=2*(1.0/(no_of_edges*2.0) - VECTOR(a)[from]*VECTOR(a)[to]/(4.0*no_of_edges*no_of_edges));
     }
-	pairs[i].first = from;
-	pairs[i].second = to;
-    pairs[i].dq = &dq[j];
-	pairs[i].opposite = &pairs[i+1];
-	pairs[i+1].first = to;
-	pairs[i+1].second = from;
-	pairs[i+1].dq = pairs[i].dq;
-	pairs[i+1].opposite = &pairs[i];
-	/* Link the pair to the communities */
-	igraph_vector_ptr_push_back(&communities.e[from].neis, &pairs[i]);
-	igraph_vector_ptr_push_back(&communities.e[to].neis, &pairs[i+1]);
-	/* Update maximums */
-	if (communities.e[from].maxdq==0 || *communities.e[from].maxdq->dq < *pairs[i].dq)
-	  communities.e[from].maxdq = &pairs[i];
-	if (communities.e[to].maxdq==0 || *communities.e[to].maxdq->dq < *pairs[i+1].dq)
-	  communities.e[to].maxdq = &pairs[i+1];
+	pairs[i].first = (igraph_integer_t) from;
+	pairs[i].second = (igraph_integer_t) to;
+	pairs[i+1].first = (igraph_integer_t) to;
+	pairs[i+1].second = (igraph_integer_t) from;
+	communities.e[from].no_of_neis++;
+	communities.e[to].no_of_neis++;
   }
   igraph_eit_destroy(&edgeit);
   IGRAPH_FINALLY_CLEAN(1);
 
+  /* Allocate the blocks of the neighbor lists in the pool */
+  debug("Creating community neighbor lists\n");
+  communities.pool_size = 2 * (no_of_nodes + no_of_edges);
+  communities.pool = igraph_Calloc(communities.pool_size, igraph_integer_t);
+  if (communities.pool == 0) {
+	IGRAPH_ERROR("can't run fast greedy community detection", IGRAPH_ENOMEM);
+  }
+  for (i=0, j=0; i<no_of_nodes; i++) {
+    communities.pool[j] = (igraph_integer_t) i;
+    communities.pool[j+1] = (igraph_integer_t) communities.e[i].no_of_neis;
+    communities.e[i].neis = j+2;
+    j += communities.e[i].no_of_neis + 2;
+    communities.e[i].no_of_neis = 0;
+  }
+  communities.pool_end = j;
+  communities.pool_garbage = 0;
+
+  /* Link the pairs to the communities, in the order of the edges */
+  for (i=0; i<2*no_of_edges; i++) {
+    if (pairs[i].first < 0) continue;
+    from = pairs[i].first;
+    communities.pool[communities.e[from].neis + communities.e[from].no_of_neis] = (igraph_integer_t) i;
+    communities.e[from].no_of_neis++;
+	/* Update maximums */
+	if (communities.e[from].maxdq==0 || igraph_i_fastgreedy_dq(&communities, communities.e[from].maxdq) < dq[i/2])
+	  communities.e[from].maxdq = &pairs[i];
+  }
+
   /* Sorting community neighbor lists by community IDs */
   debug("Sorting community neighbor lists\n");
   for (i=0, j=0; i<no_of_nodes; i++) {
@@ -813,17 +967,17 @@ int igraph_community_fastgreedy(const igraph_t *graph,
 	    continue;
 	  }
       debug("Community #%ld\n ", i);
-	  for (j=0; j<igraph_vector_ptr_size(&communities.e[i].neis); j++) {
-	    p1=(igraph_i_fastgreedy_commpair*)VECTOR(communities.e[i].neis)[j];
-	    debug(" (%ld,%ld,%.4f)", p1->first, p1->second, *p1->dq);
+	  for (j=0; j<communities.e[i].no_of_neis; j++) {
+	    p1=igraph_i_fastgreedy_nei(&communities, i, j);
+	    debug(" (%ld,%ld,%.4f)", (long int) p1->first, (long int) p1->second, igraph_i_fastgreedy_dq(&communities, p1));
 	  }
 	  p1=communities.e[i].maxdq;
-	  debug("\n  Maxdq: (%ld,%ld,%.4f)\n", p1->first, p1->second, *p1->dq);
+	  debug("\n  Maxdq: (%ld,%ld,%.4f)\n", (long int) p1->first, (long int) p1->second, igraph_i_fastgreedy_dq(&communities, p1));
     }
-	debug("Global maxdq is: (%ld,%ld,%.4f)\n", communities.heap[0]->maxdq->first,
-	    communities.heap[0]->maxdq->second, *communities.heap[0]->maxdq->dq);
+	debug("Global maxdq is: (%ld,%ld,%.4f)\n", (long int) communities.heap[0]->maxdq->first,
+	    (long int) communities.heap[0]->maxdq->second, igraph_i_fastgreedy_dq(&communities, communities.heap[0]->maxdq));
     for (i=0; i<communities.no_of_communities; i++)
-	  debug("(%ld,%ld,%.4f) ", communities.heap[i]->maxdq->first, communities.heap[i]->maxdq->second, *communities.heap[0]->maxdq->dq);
+	  debug("(%ld,%ld,%.4f) ", (long int) communities.heap[i]->maxdq->first, (long int) communities.heap[i]->maxdq->second, igraph_i_fastgreedy_dq(&communities, communities.heap[0]->maxdq));
 	debug("\n");
 #endif
 	if (communities.heap[0] == 0) break; /* no more communities */
@@ -832,122 +986,138 @@ int igraph_community_fastgreedy(const igraph_t *graph,
 	from=communities.heap[0]->maxdq->first;
 
 	debug("Q[%ld] = %.7f\tdQ = %.7f\t |H| = %ld\n",
-	  no_of_joins, q, *communities.heap[0]->maxdq->dq, no_of_nodes-no_of_joins-1);
+	  no_of_joins, q, igraph_i_fastgreedy_dq(&communities, communities.heap[0]->maxdq), no_of_nodes-no_of_joins-1);
 
 	/* DEBUG */
 	/* from=join_order[no_of_joins*2]; to=join_order[no_of_joins*2+1];
 	if (to == -1) break;
-    for (i=0; i<igraph_vector_ptr_size(&communities.e[to].neis); i++) {
-      p1=(igraph_i_fastgreedy_commpair*)VECTOR(communities.e[to].neis)[i];
+    for (i=0; i<communities.e[to].no_of_neis; i++) {
+      p1=igraph_i_fastgreedy_nei(&communities, to, i);
 	  if (p1->second == from) communities.maxdq = p1;
 	} */
 
-	n = igraph_vector_ptr_size(&communities.e[to].neis);
-	m = igraph_vector_ptr_size(&communities.e[from].neis);
+	n = communities.e[to].no_of_neis;
+	m = communities.e[from].no_of_neis;
 	/*if (n>m) {
 	  dummy=n; n=m; m=dummy;
 	  dummy=to; to=from; from=dummy;
 	}*/
 	debug("  joining: %ld <- %ld\n", to, from);
-    q += *communities.heap[0]->maxdq->dq; 
+    q += igraph_i_fastgreedy_dq(&communities, communities.heap[0]->maxdq); 
 	
-	/* Merge the second community into the first */
+	/* Merge the second community into the first. The merged list is
+	 * written into the block of `to`, so its old list is moved to the
+	 * end of the block first. During the merge the list of `to` is the
+	 * merged part followed by the rest of the old list. */
+	IGRAPH_CHECK(igraph_i_fastgreedy_community_list_reserve(&communities, to, n+m));
+	tneis = communities.pool + communities.e[to].neis;
+	fneis = communities.pool + communities.e[from].neis;
+	rest = tneis[-1] - n;
+	memmove(tneis + rest, tneis, sizeof(igraph_integer_t) * (size_t) n);
+	communities.merging = to;
+	communities.merging_rest = communities.e[to].neis + rest;
+	communities.merging_rest_size = n;
+	communities.e[to].no_of_neis = 0;
+
 	i = j = 0;
 	while (i<n && j<m) {
-	  p1 = (igraph_i_fastgreedy_commpair*)VECTOR(communities.e[to].neis)[i];
-	  p2 = (igraph_i_fastgreedy_commpair*)VECTOR(communities.e[from].neis)[j];
-	  debug("Pairs: %ld-%ld and %ld-%ld\n", p1->first, p1->second,
-		  p2->first, p2->second);
+	  p1 = pairs + tneis[rest + i];
+	  p2 = pairs + fneis[j];
+	  debug("Pairs: %ld-%ld and %ld-%ld\n", (long int) p1->first, (long int) p1->second,
+		  (long int) p2->first, (long int) p2->second);
 	  if (p1->second < p2->second) {
 		/* Considering p1 from now on */
-		debug("    Considering: %ld-%ld\n", p1->first, p1->second);
+		debug("    Considering: %ld-%ld\n", (long int) p1->first, (long int) p1->second);
+		igraph_i_fastgreedy_community_list_merge_next(&communities);
 	    if (p1->second == from) {
 		  debug("    WILL REMOVE: %ld-%ld\n", to, from);
 	    } else {
 		  /* chain, case 1 */
 		  debug("    CHAIN(1): %ld-%ld %ld, now=%.7f, adding=%.7f, newdq(%ld,%ld)=%.7f\n",
-		    to, p1->second, from, *p1->dq, -2*VECTOR(a)[from]*VECTOR(a)[p1->second], p1->first, p1->second, *p1->dq-2*VECTOR(a)[from]*VECTOR(a)[p1->second]);
-		  igraph_i_fastgreedy_community_update_dq(&communities, p1, *p1->dq - 2*VECTOR(a)[from]*VECTOR(a)[p1->second]);
+		    to, (long int) p1->second, from, igraph_i_fastgreedy_dq(&communities, p1), -2*VECTOR(a)[from]*VECTOR(a)[p1->second], (long int) p1->first, (long int) p1->second, igraph_i_fastgreedy_dq(&communities, p1)-2*VECTOR(a)[from]*VECTOR(a)[p1->second]);
+		  igraph_i_fastgreedy_community_update_dq(&communities, p1, igraph_i_fastgreedy_dq(&communities, p1) - 2*VECTOR(a)[from]*VECTOR(a)[p1->second]);
 		}
 		i++;
 	  } else if (p1->second == p2->second) {
 	    /* p1->first, p1->second and p2->first form a triangle */
-		debug("    Considering: %ld-%ld and %ld-%ld\n", p1->first, p1->second,
-		  p2->first, p2->second);
+		debug("    Considering: %ld-%ld and %ld-%ld\n", (long int) p1->first, (long int) p1->second,
+		  (long int) p2->first, (long int) p2->second);
+		igraph_i_fastgreedy_community_list_merge_next(&communities);
 		/* Update dq value */
 		debug("    TRIANGLE: %ld-%ld-%ld, now=%.7f, adding=%.7f, newdq(%ld,%ld)=%.7f\n",
-		  to, p1->second, from, *p1->dq, *p2->dq, p1->first, p1->second, *p1->dq+*p2->dq);
-		igraph_i_fastgreedy_community_update_dq(&communities, p1, *p1->dq + *p2->dq);
+		  to, (long int) p1->second, from, igraph_i_fastgreedy_dq(&communities, p1), igraph_i_fastgreedy_dq(&communities, p2), (long int) p1->first, (long int) p1->second, igraph_i_fastgreedy_dq(&communities, p1)+igraph_i_fastgreedy_dq(&communities, p2));
+		igraph_i_fastgreedy_community_update_dq(&communities, p1, igraph_i_fastgreedy_dq(&communities, p1) + igraph_i_fastgreedy_dq(&communities, p2));
         igraph_i_fastgreedy_community_remove_nei(&communities, p1->second, from);
 		i++;
 		j++;
 	  } else {
-		debug("    Considering: %ld-%ld\n", p2->first, p2->second);
+		debug("    Considering: %ld-%ld\n", (long int) p2->first, (long int) p2->second);
 		if (p2->second == to) {
-		  debug("    WILL REMOVE: %ld-%ld\n", p2->second, p2->first);
+		  debug("    WILL REMOVE: %ld-%ld\n", (long int) p2->second, (long int) p2->first);
 		} else {
 		  /* chain, case 2 */
 		  debug("    CHAIN(2): %ld %ld-%ld, newdq(%ld,%ld)=%.7f\n",
-		    to, p2->second, from, to, p2->second, *p2->dq-2*VECTOR(a)[to]*VECTOR(a)[p2->second]);
-		  p2->opposite->second=to;
-		  /* p2->opposite->second changed, so it means that
-		   * communities.e[p2->second].neis (which contains p2->opposite) is
-		   * not sorted any more. We have to find the index of p2->opposite in
-		   * this vector and move it to the correct place. Moving should be an
+		    to, (long int) p2->second, from, to, (long int) p2->second, igraph_i_fastgreedy_dq(&communities, p2)-2*VECTOR(a)[to]*VECTOR(a)[p2->second]);
+		  igraph_i_fastgreedy_opposite(&communities, p2)->second=to;
+		  /* the `second` field of the opposite pair changed, so it means that
+		   * the neighbor list of p2->second (which contains the opposite
+		   * pair) is not sorted any more. We have to find the index of the
+		   * opposite pair in this list and move it to the correct place. Moving should be an
 		   * O(n) operation; re-sorting would be O(n*logn) or even worse,
 		   * depending on the pivoting strategy used by qsort() since the
 		   * vector is nearly sorted */
 		  igraph_i_fastgreedy_community_sort_neighbors_of(
-				  &communities, p2->second, p2->opposite);
+				  &communities, p2->second, igraph_i_fastgreedy_opposite(&communities, p2));
 		  /* link from.neis[j] to the current place in to.neis if
 		   * from.neis[j] != to */
 		  p2->first=to;
-		  IGRAPH_CHECK(igraph_vector_ptr_insert(&communities.e[to].neis,i,p2));
-		  n++; i++;
-		  if (*p2->dq > *communities.e[to].maxdq->dq) {
+		  tneis[communities.e[to].no_of_neis++] = fneis[j];
+		  if (igraph_i_fastgreedy_dq(&communities, p2) > igraph_i_fastgreedy_dq(&communities, communities.e[to].maxdq)) {
 		    communities.e[to].maxdq = p2;
             k=igraph_i_fastgreedy_community_list_find_in_heap(&communities, to);
 		    igraph_i_fastgreedy_community_list_sift_up(&communities, k);
 		  }
-		  igraph_i_fastgreedy_community_update_dq(&communities, p2, *p2->dq - 2*VECTOR(a)[to]*VECTOR(a)[p2->second]);
+		  igraph_i_fastgreedy_community_update_dq(&communities, p2, igraph_i_fastgreedy_dq(&communities, p2) - 2*VECTOR(a)[to]*VECTOR(a)[p2->second]);
 		}
 		j++;
 	  }
 	}
 
 	while (i<n) {
-	  p1 = (igraph_i_fastgreedy_commpair*)VECTOR(communities.e[to].neis)[i];
+	  p1 = pairs + tneis[rest + i];
+	  igraph_i_fastgreedy_community_list_merge_next(&communities);
 	  if (p1->second == from) {
-	    debug("    WILL REMOVE: %ld-%ld\n", p1->first, from);
+	    debug("    WILL REMOVE: %ld-%ld\n", (long int) p1->first, from);
 	  } else {
 	    /* chain, case 1 */
 	    debug("    CHAIN(1): %ld-%ld %ld, now=%.7f, adding=%.7f, newdq(%ld,%ld)=%.7f\n",
-	      to, p1->second, from, *p1->dq, -2*VECTOR(a)[from]*VECTOR(a)[p1->second], p1->first, p1->second, *p1->dq-2*VECTOR(a)[from]*VECTOR(a)[p1->second]);
-	    igraph_i_fastgreedy_community_update_dq(&communities, p1, *p1->dq - 2*VECTOR(a)[from]*VECTOR(a)[p1->second]);
+	      to, (long int) p1->second, from, igraph_i_fastgreedy_dq(&communities, p1), -2*VECTOR(a)[from]*VECTOR(a)[p1->second], (long int) p1->first, (long int) p1->second, igraph_i_fastgreedy_dq(&communities, p1)-2*VECTOR(a)[from]*VECTOR(a)[p1->second]);
+	    igraph_i_fastgreedy_community_update_dq(&communities, p1, igraph_i_fastgreedy_dq(&communities, p1) - 2*VECTOR(a)[from]*VECTOR(a)[p1->second]);
 	  }
 	  i++;
 	}
 	while (j<m) {
-	  p2 = (igraph_i_fastgreedy_commpair*)VECTOR(communities.e[from].neis)[j];
+	  p2 = pairs + fneis[j];
       if (to == p2->second) { j++; continue; }
 	  /* chain, case 2 */
 	  debug("    CHAIN(2): %ld %ld-%ld, newdq(%ld,%ld)=%.7f\n",
-	    to, p2->second, from, p1->first, p2->second, *p2->dq-2*VECTOR(a)[to]*VECTOR(a)[p2->second]);
-	  p2->opposite->second=to;
+	    to, (long int) p2->second, from, (long int) p1->first, (long int) p2->second, igraph_i_fastgreedy_dq(&communities, p2)-2*VECTOR(a)[to]*VECTOR(a)[p2->second]);
+	  igraph_i_fastgreedy_opposite(&communities, p2)->second=to;
 	  /* need to re-sort community nei list `p2->second` */
-      igraph_i_fastgreedy_community_sort_neighbors_of(&communities, p2->second, p2->opposite);
+      igraph_i_fastgreedy_community_sort_neighbors_of(&communities, p2->second, igraph_i_fastgreedy_opposite(&communities, p2));
 	  /* link from.neis[j] to the current place in to.neis if
 	   * from.neis[j] != to */
 	  p2->first=to;
-	  IGRAPH_CHECK(igraph_vector_ptr_push_back(&communities.e[to].neis,p2));
-	  if (*p2->dq > *communities.e[to].maxdq->dq) {
+	  tneis[communities.e[to].no_of_neis++] = fneis[j];
+	  if (igraph_i_fastgreedy_dq(&communities, p2) > igraph_i_fastgreedy_dq(&communities, communities.e[to].maxdq)) {
 	    communities.e[to].maxdq = p2;
         k=igraph_i_fastgreedy_community_list_find_in_heap(&communities, to);
 		igraph_i_fastgreedy_community_list_sift_up(&communities, k);
 	  }
-	  igraph_i_fastgreedy_community_update_dq(&communities, p2, *p2->dq-2*VECTOR(a)[to]*VECTOR(a)[p2->second]);
+	  igraph_i_fastgreedy_community_update_dq(&communities, p2, igraph_i_fastgreedy_dq(&communities, p2)-2*VECTOR(a)[to]*VECTOR(a)[p2->second]);
 	  j++;
 	}
+	communities.merging = -1;
 
 	/* Now, remove community `from` from the neighbors of community `to` */
 	if (communities.no_of_communities > 2) {
@@ -963,10 +1133,7 @@ int igraph_community_fastgreedy(const igraph_t *graph,
     communities.e[from].size = 0;
 
 	/* record what has been merged */
-	/* igraph_vector_ptr_clear is not enough here as it won't free
-	 * the memory consumed by communities.e[from].neis. Thanks
-	 * to Tom Gregorovic for pointing that out. */
-	igraph_vector_ptr_destroy(&communities.e[from].neis);
+	igraph_i_fastgreedy_community_list_release(&communities, from);
 	if (merges) {
 	  MATRIX(*merges, no_of_joins, 0) = communities.e[to].id;
 	  MATRIX(*merges, no_of_joins, 1) = communities.e[from].id;
@@ -1002,11 +1169,9 @@ int igraph_community_fastgreedy(const igraph_t *graph,
   }
 
   debug("Freeing memory\n");
-  free(pairs);
-  free(dq);
   igraph_i_fastgreedy_community_list_destroy(&communities);
   igraph_vector_destroy(&a);
-  IGRAPH_FINALLY_CLEAN(4);
+  IGRAPH_FINALLY_CLEAN(2);
 
   if (membership) {
     IGRAPH_CHECK(igraph_community_to_membership(merges,
@@ -0,0 +1,598 @@
+/* -*- mode: C -*-  */
+/*
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301 USA
+
+*/
+
+#include "igraph_foreign.h"
+#include "config.h"
+#include "igraph_attributes.h"
+#include "igraph_conversion.h"
+#include "igraph_interface.h"
+#include "igraph_memory.h"
+
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+/* The binary format stores the indexed edge list of the graph (see
+ * type_indexededgelist.c) as it is in memory, so reading a graph needs
+ * no parsing and no sorting. Everything is stored in the native byte
+ * order, and all numbers are stored as igraph_real_t values:
+ *
+ * - the magic bytes, see below,
+ * - the header: the format version, a check value to detect a
+ *   different byte order or floating point format, whether the graph
+ *   is directed, the number of vertices (n) and edges (m), and the
+ *   number of graph, vertex and edge attributes,
+ * - the 'from', 'to', 'oi' and 'ii' vectors, m numbers each, and the
+ *   'os' and 'is' vectors, n+1 numbers each,
+ * - the graph, vertex and edge attributes. Each starts with its type
+ *   and the length of its name, followed by the name, without the
+ *   terminating zero, and the values: numbers for numeric attributes,
+ *   one byte per value for boolean attributes, and for string
+ *   attributes the total length of the strings, followed by the
+ *   zero-terminated strings themselves.
+ *
+ * The version must be increased if the format or the representation
+ * of the graph changes. */
+
+static const char igraph_i_binary_magic[8] =
+  { '\211', 'I', 'G', 'R', 'A', 'P', 'H', '\n' };
+
+#define IGRAPH_I_BINARY_VERSION 1
+#define IGRAPH_I_BINARY_CHECK 1234.5
+#define IGRAPH_I_BINARY_HEADER 8
+
+/* The counts and lengths in the file must be below this, so that they
+   can be converted to long int, and the memory needed for them can be
+   calculated without overflow */
+#define IGRAPH_I_BINARY_MAXCOUNT ((igraph_real_t) (LONG_MAX / 16))
+
+static igraph_bool_t igraph_i_binary_valid_count(igraph_real_t x) {
+  return x >= 0 && x < IGRAPH_I_BINARY_MAXCOUNT && x == floor(x);
+}
+
+static int igraph_i_binary_write(FILE *outstream, const void *ptr,
+				 size_t size, long int count) {
+  if (count > 0 && fwrite(ptr, size, (size_t) count, outstream) !=
+      (size_t) count) {
+    IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
+  }
+  return 0;
+}
+
+static int igraph_i_binary_read(FILE *instream, void *ptr,
+				size_t size, long int count) {
+  if (count > 0 && fread(ptr, size, (size_t) count, instream) !=
+      (size_t) count) {
+    IGRAPH_ERROR("unexpected end of binary graph file", IGRAPH_PARSEERROR);
+  }
+  return 0;
+}
+
+/* Writes the attributes of one kind, only numeric, boolean and string
+   attributes are supported, the others were not counted in the
+   header and they are skipped here. */
+
+static int igraph_i_binary_write_attrs(const igraph_t *graph, FILE *outstream,
+				       igraph_attribute_elemtype_t elemtype,
+				       const igraph_strvector_t *names,
+				       const igraph_vector_t *types) {
+  long int i, j, len;
+  igraph_vector_t numv;
+  igraph_vector_bool_t boolv;
+  igraph_strvector_t strv;
+  char *bytes;
+
+  IGRAPH_VECTOR_INIT_FINALLY(&numv, 0);
+  IGRAPH_VECTOR_BOOL_INIT_FINALLY(&boolv, 0);
+  IGRAPH_STRVECTOR_INIT_FINALLY(&strv, 0);
+
+  for (i = 0; i < igraph_vector_size(types); i++) {
+    igraph_attribute_type_t type = (igraph_attribute_type_t) VECTOR(*types)[i];
+    igraph_real_t head[2];
+    char *name;
+
+    if (type != IGRAPH_ATTRIBUTE_NUMERIC && type != IGRAPH_ATTRIBUTE_BOOLEAN &&
+	type != IGRAPH_ATTRIBUTE_STRING) {
+      continue;
+    }
+    igraph_strvector_get(names, i, &name);
+    head[0] = type;
+    head[1] = strlen(name);
+    IGRAPH_CHECK(igraph_i_binary_write(outstream, head, sizeof(igraph_real_t), 2));
+    IGRAPH_CHECK(igraph_i_binary_write(outstream, name, 1, (long int) head[1]));
+
+    if (type == IGRAPH_ATTRIBUTE_NUMERIC) {
+      if (elemtype == IGRAPH_ATTRIBUTE_GRAPH) {
+	IGRAPH_CHECK(igraph_i_attribute_get_numeric_graph_attr(graph, name, &numv));
+      } else if (elemtype == IGRAPH_ATTRIBUTE_VERTEX) {
+	IGRAPH_CHECK(igraph_i_attribute_get_numeric_vertex_attr(graph, name,
+						igraph_vss_all(), &numv));
+      } else {
+	IGRAPH_CHECK(igraph_i_attribute_get_numeric_edge_attr(graph, name,
+	                                        igraph_ess_all(IGRAPH_EDGEORDER_ID), &numv));
+      }
+      IGRAPH_CHECK(igraph_i_binary_write(outstream, VECTOR(numv),
+					 sizeof(igraph_real_t),
+					 igraph_vector_size(&numv)));
+
+    } else if (type == IGRAPH_ATTRIBUTE_BOOLEAN) {
+      if (elemtype == IGRAPH_ATTRIBUTE_GRAPH) {
+	IGRAPH_CHECK(igraph_i_attribute_get_bool_graph_attr(graph, name, &boolv));
+      } else if (elemtype == IGRAPH_ATTRIBUTE_VERTEX) {
+	IGRAPH_CHECK(igraph_i_attribute_get_bool_vertex_attr(graph, name,
+						igraph_vss_all(), &boolv));
+      } else {
+	IGRAPH_CHECK(igraph_i_attribute_get_bool_edge_attr(graph, name,
+	                                        igraph_ess_all(IGRAPH_EDGEORDER_ID), &boolv));
+      }
+      len = igraph_vector_bool_size(&boolv);
+      bytes = igraph_Calloc(len > 0 ? len : 1, char);
+      if (bytes == 0) {
+	IGRAPH_ERROR("cannot write binary graph file", IGRAPH_ENOMEM);
+      }
+      IGRAPH_FINALLY(igraph_free, bytes);
+      for (j = 0; j < len; j++) {
+	bytes[j] = VECTOR(boolv)[j] ? 1 : 0;
+      }
+      IGRAPH_CHECK(igraph_i_binary_write(outstream, bytes, 1, len));
+      igraph_Free(bytes);
+      IGRAPH_FINALLY_CLEAN(1);
+
+    } else {
+      igraph_real_t total = 0;
+      if (elemtype == IGRAPH_ATTRIBUTE_GRAPH) {
+	IGRAPH_CHECK(igraph_i_attribute_get_string_graph_attr(graph, name, &strv));
+      } else if (elemtype == IGRAPH_ATTRIBUTE_VERTEX) {
+	IGRAPH_CHECK(igraph_i_attribute_get_string_vertex_attr(graph, name,
+						igraph_vss_all(), &strv));
+      } else {
+	IGRAPH_CHECK(igraph_i_attribute_get_string_edge_attr(graph, name,
+	                                        igraph_ess_all(IGRAPH_EDGEORDER_ID), &strv));
+      }
+      len = igraph_strvector_size(&strv);
+      for (j = 0; j < len; j++) {
+	char *s;
+	igraph_strvector_get(&strv, j, &s);
+	total += strlen(s) + 1;
+      }
+      IGRAPH_CHECK(igraph_i_binary_write(outstream, &total, sizeof(igraph_real_t), 1));
+      for (j = 0; j < len; j++) {
+	char *s;
+	igraph_strvector_get(&strv, j, &s);
+	IGRAPH_CHECK(igraph_i_binary_write(outstream, s, 1, (long int) strlen(s) + 1));
+      }
+    }
+  }
+
+  igraph_strvector_destroy(&strv);
+  igraph_vector_bool_destroy(&boolv);
+  igraph_vector_destroy(&numv);
+  IGRAPH_FINALLY_CLEAN(3);
+
+  return 0;
+}
+
+/**
+ * \ingroup loadsave
+ * \function igraph_write_graph_binary
+ * \brief Writes a graph to a file in igraph's own binary format.
+ *
+ * </para><para>
+ * The binary format contains the internal representation of the
+ * graph, together with its numeric, boolean and string attributes,
+ * if an attribute handler is installed. Other attributes are ignored.
+ * Reading such a file with \ref igraph_read_graph_binary() is much
+ * faster than parsing any of the text formats, as the edges need not
+ * be sorted again.
+ *
+ * </para><para>
+ * The file is not portable: it uses the byte order and floating point
+ * format of the machine, and it can only be read by an igraph version
+ * that uses the same version of the format.
+ * \param graph The graph to write.
+ * \param outstream The stream object to write to, it should be
+ *        writable and opened in binary mode.
+ * \return Error code:
+ *         \c IGRAPH_EFILE if the file cannot be written.
+ *
+ * Time complexity: O(|V|+|E|), the number of vertices and edges, plus
+ * the size of the attributes.
+ */
+
+int igraph_write_graph_binary(const igraph_t *graph, FILE *outstream) {
+  long int no_of_nodes = igraph_vcount(graph);
+  long int no_of_edges = igraph_ecount(graph);
+  igraph_strvector_t gnames, vnames, enames;
+  igraph_vector_t gtypes, vtypes, etypes;
+  igraph_vector_t *types[3];
+  igraph_real_t header[IGRAPH_I_BINARY_HEADER];
+  long int i, j;
+
+  IGRAPH_STRVECTOR_INIT_FINALLY(&gnames, 0);
+  IGRAPH_STRVECTOR_INIT_FINALLY(&vnames, 0);
+  IGRAPH_STRVECTOR_INIT_FINALLY(&enames, 0);
+  IGRAPH_VECTOR_INIT_FINALLY(&gtypes, 0);
+  IGRAPH_VECTOR_INIT_FINALLY(&vtypes, 0);
+  IGRAPH_VECTOR_INIT_FINALLY(&etypes, 0);
+  IGRAPH_CHECK(igraph_i_attribute_get_info(graph, &gnames, &gtypes,
+					   &vnames, &vtypes,
+					   &enames, &etypes));
+
+  header[0] = IGRAPH_I_BINARY_VERSION;
+  header[1] = IGRAPH_I_BINARY_CHECK;
+  header[2] = igraph_is_directed(graph) ? 1 : 0;
+  header[3] = no_of_nodes;
+  header[4] = no_of_edges;
+  types[0] = &gtypes; types[1] = &vtypes; types[2] = &etypes;
+  for (i = 0; i < 3; i++) {
+    header[5 + i] = 0;
+    for (j = 0; j < igraph_vector_size(types[i]); j++) {
+      igraph_real_t t = VECTOR(*types[i])[j];
+      if (t == IGRAPH_ATTRIBUTE_NUMERIC || t == IGRAPH_ATTRIBUTE_BOOLEAN ||
+	  t == IGRAPH_ATTRIBUTE_STRING) {
+	header[5 + i] += 1;
+      } else {
+	IGRAPH_WARNING("only numeric, boolean and string attributes are "
+		       "written to binary graph files");
+      }
+    }
+  }
+
+  IGRAPH_CHECK(igraph_i_binary_write(outstream, igraph_i_binary_magic, 1,
+				     sizeof(igraph_i_binary_magic)));
+  IGRAPH_CHECK(igraph_i_binary_write(outstream, header, sizeof(igraph_real_t),
+				     IGRAPH_I_BINARY_HEADER));
+  IGRAPH_CHECK(igraph_i_binary_write(outstream, VECTOR(graph->from),
+				     sizeof(igraph_real_t), no_of_edges));
+  IGRAPH_CHECK(igraph_i_binary_write(outstream, VECTOR(graph->to),
+				     sizeof(igraph_real_t), no_of_edges));
+  IGRAPH_CHECK(igraph_i_binary_write(outstream, VECTOR(graph->oi),
+				     sizeof(igraph_real_t), no_of_edges));
+  IGRAPH_CHECK(igraph_i_binary_write(outstream, VECTOR(graph->ii),
+				     sizeof(igraph_real_t), no_of_edges));
+  IGRAPH_CHECK(igraph_i_binary_write(outstream, VECTOR(graph->os),
+				     sizeof(igraph_real_t), no_of_nodes + 1));
+  IGRAPH_CHECK(igraph_i_binary_write(outstream, VECTOR(graph->is),
+				     sizeof(igraph_real_t), no_of_nodes + 1));
+
+  IGRAPH_CHECK(igraph_i_binary_write_attrs(graph, outstream,
+					   IGRAPH_ATTRIBUTE_GRAPH,
+					   &gnames, &gtypes));
+  IGRAPH_CHECK(igraph_i_binary_write_attrs(graph, outstream,
+					   IGRAPH_ATTRIBUTE_VERTEX,
+					   &vnames, &vtypes));
+  IGRAPH_CHECK(igraph_i_binary_write_attrs(graph, outstream,
+					   IGRAPH_ATTRIBUTE_EDGE,
+					   &enames, &etypes));
+
+  igraph_vector_destroy(&etypes);
+  igraph_vector_destroy(&vtypes);
+  igraph_vector_destroy(&gtypes);
+  igraph_strvector_destroy(&enames);
+  igraph_strvector_destroy(&vnames);
+  igraph_strvector_destroy(&gnames);
+  IGRAPH_FINALLY_CLEAN(6);
+
+  return 0;
+}
+
+static void igraph_i_binary_destroy_attrs(igraph_vector_ptr_t **ptr) {
+  long int i, j;
+  for (i = 0; i < 3; i++) {
+    igraph_vector_ptr_t *vec = ptr[i];
+    for (j = 0; j < igraph_vector_ptr_size(vec); j++) {
+      igraph_attribute_record_t *atrec = VECTOR(*vec)[j];
+      if (atrec->value != 0) {
+	if (atrec->type == IGRAPH_ATTRIBUTE_NUMERIC) {
+	  igraph_vector_destroy((igraph_vector_t*) atrec->value);
+	} else if (atrec->type == IGRAPH_ATTRIBUTE_BOOLEAN) {
+	  igraph_vector_bool_destroy((igraph_vector_bool_t*) atrec->value);
+	} else {
+	  igraph_strvector_destroy((igraph_strvector_t*) atrec->value);
+	}
+	igraph_free((void*) atrec->value);
+      }
+      if (atrec->name != 0) {
+	igraph_free((void*) atrec->name);
+      }
+      igraph_Free(atrec);
+    }
+    igraph_vector_ptr_destroy(vec);
+  }
+}
+
+/* Reads 'no' attribute records of 'len' values each. */
+
+static int igraph_i_binary_read_attrs(FILE *instream, igraph_vector_ptr_t *attrs,
+				      long int no, long int len) {
+  long int i, j;
+
+  for (i = 0; i < no; i++) {
+    igraph_attribute_record_t *atrec;
+    igraph_real_t head[2];
+    char *name;
+
+    IGRAPH_CHECK(igraph_i_binary_read(instream, head, sizeof(igraph_real_t), 2));
+    if ((head[0] != IGRAPH_ATTRIBUTE_NUMERIC &&
+	 head[0] != IGRAPH_ATTRIBUTE_BOOLEAN &&
+	 head[0] != IGRAPH_ATTRIBUTE_STRING) ||
+	!igraph_i_binary_valid_count(head[1])) {
+      IGRAPH_ERROR("invalid binary graph file", IGRAPH_PARSEERROR);
+    }
+
+    atrec = igraph_Calloc(1, igraph_attribute_record_t);
+    if (atrec == 0) {
+      IGRAPH_ERROR("cannot read binary graph file", IGRAPH_ENOMEM);
+    }
+    IGRAPH_FINALLY(igraph_free, atrec);
+    IGRAPH_CHECK(igraph_vector_ptr_push_back(attrs, atrec));
+    IGRAPH_FINALLY_CLEAN(1);
+    atrec->type = (igraph_attribute_type_t) head[0];
+
+    name = igraph_Calloc((long int) head[1] + 1, char);
+    if (name == 0) {
+      IGRAPH_ERROR("cannot read binary graph file", IGRAPH_ENOMEM);
+    }
+    atrec->name = name;
+    IGRAPH_CHECK(igraph_i_binary_read(instream, name, 1, (long int) head[1]));
+
+    if (atrec->type == IGRAPH_ATTRIBUTE_NUMERIC) {
+      igraph_vector_t *v = igraph_Calloc(1, igraph_vector_t);
+      if (v == 0) {
+	IGRAPH_ERROR("cannot read binary graph file", IGRAPH_ENOMEM);
+      }
+      IGRAPH_FINALLY(igraph_free, v);
+      IGRAPH_CHECK(igraph_vector_init(v, len));
+      IGRAPH_FINALLY_CLEAN(1);
+      atrec->value = v;
+      IGRAPH_CHECK(igraph_i_binary_read(instream, VECTOR(*v),
+					sizeof(igraph_real_t), len));
+
+    } else if (atrec->type == IGRAPH_ATTRIBUTE_BOOLEAN) {
+      igraph_vector_bool_t *v = igraph_Calloc(1, igraph_vector_bool_t);
+      char *bytes;
+      if (v == 0) {
+	IGRAPH_ERROR("cannot read binary graph file", IGRAPH_ENOMEM);
+      }
+      IGRAPH_FINALLY(igraph_free, v);
+      IGRAPH_CHECK(igraph_vector_bool_init(v, len));
+      IGRAPH_FINALLY_CLEAN(1);
+      atrec->value = v;
+      bytes = igraph_Calloc(len > 0 ? len : 1, char);
+      if (bytes == 0) {
+	IGRAPH_ERROR("cannot read binary graph file", IGRAPH_ENOMEM);
+      }
+      IGRAPH_FINALLY(igraph_free, bytes);
+      IGRAPH_CHECK(igraph_i_binary_read(instream, bytes, 1, len));
+      for (j = 0; j < len; j++) {
+	VECTOR(*v)[j] = bytes[j] != 0;
+      }
+      igraph_Free(bytes);
+      IGRAPH_FINALLY_CLEAN(1);
+
+    } else {
+      igraph_strvector_t *v = igraph_Calloc(1, igraph_strvector_t);
+      igraph_real_t total;
+      char *bytes, *p;
+      if (v == 0) {
+	IGRAPH_ERROR("cannot read binary graph file", IGRAPH_ENOMEM);
+      }
+      IGRAPH_FINALLY(igraph_free, v);
+      IGRAPH_CHECK(igraph_strvector_init(v, len));
+      IGRAPH_FINALLY_CLEAN(1);
+      atrec->value = v;
+      IGRAPH_CHECK(igraph_i_binary_read(instream, &total, sizeof(igraph_real_t), 1));
+      if (!igraph_i_binary_valid_count(total) || total < len) {
+	IGRAPH_ERROR("invalid binary graph file", IGRAPH_PARSEERROR);
+      }
+      bytes = igraph_Calloc(total > 0 ? (long int) total : 1, char);
+      if (bytes == 0) {
+	IGRAPH_ERROR("cannot read binary graph file", IGRAPH_ENOMEM);
+      }
+      IGRAPH_FINALLY(igraph_free, bytes);
+      IGRAPH_CHECK(igraph_i_binary_read(instream, bytes, 1, (long int) total));
+      for (j = 0, p = bytes; j < len; j++) {
+	char *end = memchr(p, '\0', (size_t) (bytes + (long int) total - p));
+	if (end == 0) {
+	  IGRAPH_ERROR("invalid binary graph file", IGRAPH_PARSEERROR);
+	}
+	IGRAPH_CHECK(igraph_strvector_set(v, j, p));
+	p = end + 1;
+      }
+      igraph_Free(bytes);
+      IGRAPH_FINALLY_CLEAN(1);
+    }
+  }
+
+  return 0;
+}
+
+/* Checks that the vectors read from a file form a valid indexed
+   edge list: the vertex ids are valid, each edge is in the index of
+   its endpoint, and the indices are ordered, so that they are
+   permutations. */
+
+static int igraph_i_binary_check_index(const igraph_vector_t *key1,
+				       const igraph_vector_t *key2,
+				       const igraph_vector_t *idx,
+				       const igraph_vector_t *start,
+				       long int no_of_nodes,
+				       long int no_of_edges) {
+  long int v, k;
+
+  if (VECTOR(*start)[0] != 0 || VECTOR(*start)[no_of_nodes] != no_of_edges) {
+    IGRAPH_ERROR("invalid binary graph file", IGRAPH_PARSEERROR);
+  }
+  for (v = 0; v < no_of_nodes; v++) {
+    igraph_real_t from = VECTOR(*start)[v], to = VECTOR(*start)[v + 1];
+    if (!(from <= to && to <= no_of_edges) || from != (long int) from) {
+      IGRAPH_ERROR("invalid binary graph file", IGRAPH_PARSEERROR);
+    }
+    for (k = (long int) from; k < to; k++) {
+      igraph_real_t e = VECTOR(*idx)[k];
+      long int ei = (long int) e;
+      if (!(e >= 0 && e < no_of_edges) || e != ei || VECTOR(*key1)[ei] != v) {
+	IGRAPH_ERROR("invalid binary graph file", IGRAPH_PARSEERROR);
+      }
+      if (k > from) {
+	long int pe = (long int) VECTOR(*idx)[k - 1];
+	if (VECTOR(*key2)[pe] > VECTOR(*key2)[ei] ||
+	    (VECTOR(*key2)[pe] == VECTOR(*key2)[ei] && pe <= ei)) {
+	  IGRAPH_ERROR("invalid binary graph file", IGRAPH_PARSEERROR);
+	}
+      }
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * \ingroup loadsave
+ * \function igraph_read_graph_binary
+ * \brief Reads a graph from a file in igraph's own binary format.
+ *
+ * </para><para>
+ * Reads a file written by \ref igraph_write_graph_binary(). The
+ * internal representation of the graph is read directly, so this is
+ * much faster than reading any of the text formats, only the
+ * consistency of the data is checked, in linear time. The attributes
+ * are added to the graph if an attribute handler is installed.
+ * \param graph Pointer to an uninitialized graph object.
+ * \param instream The stream to read from, it should be readable
+ *        and opened in binary mode.
+ * \return Error code:
+ *         \c IGRAPH_PARSEERROR if the file is not a valid binary
+ *         graph file, or it was written on a machine with a different
+ *         byte order or floating point format, or by an igraph
+ *         version that uses a different version of the format.
+ *
+ * Time complexity: O(|V|+|E|), the number of vertices and edges, plus
+ * the size of the attributes.
+ */
+
+int igraph_read_graph_binary(igraph_t *graph, FILE *instream) {
+  char magic[sizeof(igraph_i_binary_magic)];
+  igraph_real_t header[IGRAPH_I_BINARY_HEADER];
+  long int no_of_nodes, no_of_edges, e;
+  igraph_bool_t directed;
+  igraph_vector_t from, to, oi, ii, os, is;
+  igraph_vector_ptr_t gattrs, vattrs, eattrs;
+  igraph_vector_ptr_t *attrs[3] = { &gattrs, &vattrs, &eattrs };
+
+  IGRAPH_CHECK(igraph_i_binary_read(instream, magic, 1, sizeof(magic)));
+  if (memcmp(magic, igraph_i_binary_magic, sizeof(magic)) != 0) {
+    IGRAPH_ERROR("not a binary igraph file", IGRAPH_PARSEERROR);
+  }
+  IGRAPH_CHECK(igraph_i_binary_read(instream, header, sizeof(igraph_real_t),
+				    IGRAPH_I_BINARY_HEADER));
+  if (header[1] != IGRAPH_I_BINARY_CHECK) {
+    IGRAPH_ERROR("binary graph file has a different byte order or "
+		 "floating point format", IGRAPH_PARSEERROR);
+  }
+  if (header[0] != IGRAPH_I_BINARY_VERSION) {
+    IGRAPH_ERROR("unsupported binary graph file version", IGRAPH_PARSEERROR);
+  }
+  if (!igraph_i_binary_valid_count(header[3]) ||
+      !igraph_i_binary_valid_count(header[4]) ||
+      !igraph_i_binary_valid_count(header[5]) ||
+      !igraph_i_binary_valid_count(header[6]) ||
+      !igraph_i_binary_valid_count(header[7])) {
+    IGRAPH_ERROR("invalid binary graph file", IGRAPH_PARSEERROR);
+  }
+  directed = header[2] != 0;
+  no_of_nodes = (long int) header[3];
+  no_of_edges = (long int) header[4];
+
+  IGRAPH_CHECK(igraph_vector_ptr_init(&gattrs, 0));
+  IGRAPH_FINALLY(igraph_vector_ptr_destroy, &gattrs);
+  IGRAPH_CHECK(igraph_vector_ptr_init(&vattrs, 0));
+  IGRAPH_FINALLY(igraph_vector_ptr_destroy, &vattrs);
+  IGRAPH_CHECK(igraph_vector_ptr_init(&eattrs, 0));
+  IGRAPH_FINALLY_CLEAN(2);
+  IGRAPH_FINALLY(igraph_i_binary_destroy_attrs, attrs);
+
+  IGRAPH_VECTOR_INIT_FINALLY(&from, no_of_edges);
+  IGRAPH_VECTOR_INIT_FINALLY(&to, no_of_edges);
+  IGRAPH_VECTOR_INIT_FINALLY(&oi, no_of_edges);
+  IGRAPH_VECTOR_INIT_FINALLY(&ii, no_of_edges);
+  IGRAPH_VECTOR_INIT_FINALLY(&os, no_of_nodes + 1);
+  IGRAPH_VECTOR_INIT_FINALLY(&is, no_of_nodes + 1);
+  IGRAPH_CHECK(igraph_i_binary_read(instream, VECTOR(from),
+				    sizeof(igraph_real_t), no_of_edges));
+  IGRAPH_CHECK(igraph_i_binary_read(instream, VECTOR(to),
+				    sizeof(igraph_real_t), no_of_edges));
+  IGRAPH_CHECK(igraph_i_binary_read(instream, VECTOR(oi),
+				    sizeof(igraph_real_t), no_of_edges));
+  IGRAPH_CHECK(igraph_i_binary_read(instream, VECTOR(ii),
+				    sizeof(igraph_real_t), no_of_edges));
+  IGRAPH_CHECK(igraph_i_binary_read(instream, VECTOR(os),
+				    sizeof(igraph_real_t), no_of_nodes + 1));
+  IGRAPH_CHECK(igraph_i_binary_read(instream, VECTOR(is),
+				    sizeof(igraph_real_t), no_of_nodes + 1));
+
+  for (e = 0; e < no_of_edges; e++) {
+    if (!directed && VECTOR(from)[e] < VECTOR(to)[e]) {
+      IGRAPH_ERROR("invalid binary graph file", IGRAPH_PARSEERROR);
+    }
+  }
+  IGRAPH_CHECK(igraph_i_binary_check_index(&from, &to, &oi, &os,
+					   no_of_nodes, no_of_edges));
+  IGRAPH_CHECK(igraph_i_binary_check_index(&to, &from, &ii, &is,
+					   no_of_nodes, no_of_edges));
+
+  IGRAPH_CHECK(igraph_i_binary_read_attrs(instream, &gattrs,
+					  (long int) header[5], 1));
+  IGRAPH_CHECK(igraph_i_binary_read_attrs(instream, &vattrs,
+					  (long int) header[6], no_of_nodes));
+  IGRAPH_CHECK(igraph_i_binary_read_attrs(instream, &eattrs,
+					  (long int) header[7], no_of_edges));
+
+  /* Create an empty graph with the graph attributes, and put the
+     vectors into it */
+  IGRAPH_CHECK(igraph_empty_attrs(graph, 0, directed, &gattrs));
+  igraph_vector_destroy(&graph->from); graph->from = from;
+  igraph_vector_destroy(&graph->to);   graph->to = to;
+  igraph_vector_destroy(&graph->oi);   graph->oi = oi;
+  igraph_vector_destroy(&graph->ii);   graph->ii = ii;
+  igraph_vector_destroy(&graph->os);   graph->os = os;
+  igraph_vector_destroy(&graph->is);   graph->is = is;
+  graph->n = no_of_nodes;
+  IGRAPH_FINALLY_CLEAN(6);
+  IGRAPH_FINALLY(igraph_destroy, graph);
+
+  IGRAPH_CHECK(igraph_i_attribute_add_vertices(graph, no_of_nodes, &vattrs));
+  if (graph->attr) {
+    igraph_vector_t edges;
+    IGRAPH_VECTOR_INIT_FINALLY(&edges, 0);
+    IGRAPH_CHECK(igraph_get_edgelist(graph, &edges, 0));
+    IGRAPH_CHECK(igraph_i_attribute_add_edges(graph, &edges, &eattrs));
+    igraph_vector_destroy(&edges);
+    IGRAPH_FINALLY_CLEAN(1);
+  }
+
+  igraph_i_binary_destroy_attrs(attrs);
+  IGRAPH_FINALLY_CLEAN(2);
+
+  return 0;
+}
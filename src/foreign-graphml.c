@@ -28,6 +28,7 @@
 #include "igraph_attributes.h"
 #include "igraph_interface.h"
 #include "igraph_types_internal.h"
+#include "igraph_writer_internal.h"
 
 #include <ctype.h>		/* isspace */
 #include <string.h>
@@ -85,6 +86,19 @@ xmlEntityPtr blankEntity = &blankEntityStruct;
 
 /* TODO: proper error handling */
 
+/* While parsing, the attribute values are collected in typed
+   columns. Numeric and boolean columns are vectors. For string
+   columns all values are stored one after the other, zero
+   terminated, in a single character buffer, and 'offsets' gives
+   where each value starts, -1 stands for the default value. String
+   columns are converted to string vectors only when the graph is
+   created. All columns grow geometrically. */
+
+typedef struct igraph_i_graphml_strcolumn_t {
+  igraph_vector_char_t chars;
+  igraph_vector_long_t offsets;
+} igraph_i_graphml_strcolumn_t;
+
 typedef struct igraph_i_graphml_attribute_record_t {
   const char *id;         	/* GraphML id */
   enum { I_GRAPHML_BOOLEAN, I_GRAPHML_INTEGER, I_GRAPHML_LONG,
@@ -96,6 +110,7 @@ typedef struct igraph_i_graphml_attribute_record_t {
     char* as_string;
   } default_value;   /* Default value of the attribute, if any */
   igraph_attribute_record_t record;
+  igraph_i_graphml_strcolumn_t strcolumn; /* values of string attributes */
 } igraph_i_graphml_attribute_record_t;
 
 struct igraph_i_graphml_parser_state {
@@ -104,6 +119,7 @@ struct igraph_i_graphml_parser_state {
   igraph_t *g;
   igraph_trie_t node_trie;
   igraph_strvector_t edgeids;
+  igraph_i_graphml_strcolumn_t edgeid_column;
   igraph_vector_t edgelist;
   igraph_vector_int_t prev_state_stack;
   unsigned int unknown_depth;
@@ -119,7 +135,8 @@ struct igraph_i_graphml_parser_state {
   xmlChar *data_key;
   igraph_attribute_elemtype_t data_type;
   char *error_message;
-  char *data_char;
+  char *data_char;	/* character data of the current tag, */
+  long int data_char_len, data_char_size; /* the buffer is reused */
   long int act_node;
 };
 
@@ -132,11 +149,13 @@ static void igraph_i_report_unhandled_attribute_target(const char* target,
 igraph_real_t igraph_i_graphml_parse_numeric(const char* char_data,
     igraph_real_t default_value) {
   double result;
+  char *end;
 
   if (char_data == 0)
     return default_value;
 
-  if (sscanf(char_data, "%lf", &result) == 0)
+  result=strtod(char_data, &end);
+  if (end == char_data)
     return default_value;
 
   return result;
@@ -160,6 +179,143 @@ igraph_bool_t igraph_i_graphml_parse_boolean(const char* char_data,
   return value != 0;
 }
 
+/* Grows a vector geometrically, so that it has room for at least
+   'size' elements. */
+
+#define IGRAPH_I_GRAPHML_GROW(type, v, size)				\
+  (type##_capacity(v) >= (size) ? 0 :					\
+   type##_reserve((v), 2*type##_capacity(v) > (size) ?			\
+		  2*type##_capacity(v) : (size)))
+
+static int igraph_i_graphml_strcolumn_init(igraph_i_graphml_strcolumn_t *col) {
+  IGRAPH_CHECK(igraph_vector_char_init(&col->chars, 0));
+  IGRAPH_FINALLY(igraph_vector_char_destroy, &col->chars);
+  IGRAPH_CHECK(igraph_vector_long_init(&col->offsets, 0));
+  IGRAPH_FINALLY_CLEAN(1);
+  return 0;
+}
+
+/* Can be called more than once, and also on a zeroed column */
+
+static void igraph_i_graphml_strcolumn_destroy(igraph_i_graphml_strcolumn_t *col) {
+  igraph_vector_char_destroy(&col->chars);
+  igraph_vector_long_destroy(&col->offsets);
+}
+
+/* Extends the column to at least 'size' values, the new values are
+   the default value. */
+
+static int igraph_i_graphml_strcolumn_extend(igraph_i_graphml_strcolumn_t *col,
+					     long int size) {
+  long int i, n=igraph_vector_long_size(&col->offsets);
+  if (n < size) {
+    IGRAPH_CHECK(IGRAPH_I_GRAPHML_GROW(igraph_vector_long, &col->offsets, 
+				       size));
+    igraph_vector_long_resize(&col->offsets, size); /* reserved */
+    for (i=n; i<size; i++) {
+      VECTOR(col->offsets)[i] = -1;
+    }
+  }
+  return 0;
+}
+
+/* Sets a value, a null 'value' means the default value */
+
+static int igraph_i_graphml_strcolumn_set(igraph_i_graphml_strcolumn_t *col,
+					  long int idx, const char *value,
+					  long int len) {
+  long int n=igraph_vector_char_size(&col->chars);
+  IGRAPH_CHECK(igraph_i_graphml_strcolumn_extend(col, idx+1));
+  if (value == 0) {
+    VECTOR(col->offsets)[idx] = -1;
+    return 0;
+  }
+  IGRAPH_CHECK(IGRAPH_I_GRAPHML_GROW(igraph_vector_char, &col->chars, 
+				     n+len+1));
+  igraph_vector_char_resize(&col->chars, n+len+1); /* reserved */
+  memcpy(VECTOR(col->chars)+n, value, (size_t) len);
+  VECTOR(col->chars)[n+len] = '\0';
+  VECTOR(col->offsets)[idx] = n;
+  return 0;
+}
+
+/* Copies the first 'size' values to a string vector, and frees the
+   column, it cannot be used after this. */
+
+static int igraph_i_graphml_strcolumn_finish(igraph_i_graphml_strcolumn_t *col,
+					     long int size, const char *def,
+					     igraph_strvector_t *sv) {
+  long int i, n=igraph_vector_long_size(&col->offsets);
+  IGRAPH_CHECK(igraph_strvector_resize(sv, size));
+  for (i=0; i<size; i++) {
+    long int off= i < n ? VECTOR(col->offsets)[i] : -1;
+    IGRAPH_CHECK(igraph_strvector_set(sv, i, off < 0 ? def : 
+				      VECTOR(col->chars)+off));
+  }
+  igraph_i_graphml_strcolumn_destroy(col);
+  return 0;
+}
+
+/* Extends the value column of an attribute to at least 'size'
+   values, the new values are the default value. */
+
+static int igraph_i_graphml_attribute_record_extend(
+		     igraph_i_graphml_attribute_record_t *graphmlrec,
+		     long int size) {
+  igraph_attribute_record_t *rec=&graphmlrec->record;
+  long int i, n;
+
+  switch (rec->type) {
+    igraph_vector_bool_t *boolvec;
+    igraph_vector_t *vec;
+  case IGRAPH_ATTRIBUTE_BOOLEAN:
+    boolvec=(igraph_vector_bool_t *)rec->value;
+    n=igraph_vector_bool_size(boolvec);
+    if (n < size) {
+      IGRAPH_CHECK(IGRAPH_I_GRAPHML_GROW(igraph_vector_bool, boolvec, size));
+      igraph_vector_bool_resize(boolvec, size); /* reserved */
+      for (i=n; i<size; i++) {
+	VECTOR(*boolvec)[i] = graphmlrec->default_value.as_boolean;
+      }
+    }
+    break;
+  case IGRAPH_ATTRIBUTE_NUMERIC:
+    vec=(igraph_vector_t *)rec->value;
+    n=igraph_vector_size(vec);
+    if (n < size) {
+      IGRAPH_CHECK(IGRAPH_I_GRAPHML_GROW(igraph_vector, vec, size));
+      igraph_vector_resize(vec, size); /* reserved */
+      for (i=n; i<size; i++) {
+	VECTOR(*vec)[i] = graphmlrec->default_value.as_numeric;
+      }
+    }
+    break;
+  case IGRAPH_ATTRIBUTE_STRING:
+    IGRAPH_CHECK(igraph_i_graphml_strcolumn_extend(&graphmlrec->strcolumn,
+						   size));
+    break;
+  default:
+    break;
+  }
+
+  return 0;
+}
+
+/* Makes the attribute values ready for the attribute handler, there
+   must be exactly 'size' of them. */
+
+static int igraph_i_graphml_attribute_record_finish(
+		     igraph_i_graphml_attribute_record_t *graphmlrec,
+		     long int size) {
+  IGRAPH_CHECK(igraph_i_graphml_attribute_record_extend(graphmlrec, size));
+  if (graphmlrec->record.type == IGRAPH_ATTRIBUTE_STRING) {
+    IGRAPH_CHECK(igraph_i_graphml_strcolumn_finish(&graphmlrec->strcolumn,
+			   size, graphmlrec->default_value.as_string,
+			   (igraph_strvector_t*) graphmlrec->record.value));
+  }
+  return 0;
+}
+
 void igraph_i_graphml_attribute_record_destroy(igraph_i_graphml_attribute_record_t* rec) {
   if (rec->record.type==IGRAPH_ATTRIBUTE_NUMERIC) {
     if (rec->record.value != 0) {
@@ -167,6 +323,7 @@ void igraph_i_graphml_attribute_record_destroy(igraph_i_graphml_attribute_record
       igraph_Free(rec->record.value);
     }
   } else if (rec->record.type==IGRAPH_ATTRIBUTE_STRING) {
+    igraph_i_graphml_strcolumn_destroy(&rec->strcolumn);
     if (rec->record.value != 0) {
       igraph_strvector_destroy((igraph_strvector_t*)rec->record.value);
       if (rec->default_value.as_string != 0) {
@@ -195,15 +352,16 @@ void igraph_i_graphml_destroy_state(struct igraph_i_graphml_parser_state* state)
 
   igraph_trie_destroy(&state->node_trie);
   igraph_strvector_destroy(&state->edgeids);
+  igraph_i_graphml_strcolumn_destroy(&state->edgeid_column);
   igraph_trie_destroy(&state->v_names);
   igraph_trie_destroy(&state->e_names);
   igraph_trie_destroy(&state->g_names);
   igraph_vector_destroy(&state->edgelist);
   igraph_vector_int_destroy(&state->prev_state_stack);
    
-  if (state->error_message) { free(state->error_message); }
-  if (state->data_key) { free(state->data_key); }
-  if (state->data_char) { free(state->data_char); }
+  if (state->error_message) { igraph_Free(state->error_message); }
+  if (state->data_key) { igraph_Free(state->data_key); }
+  if (state->data_char) { igraph_Free(state->data_char); }
 
   igraph_vector_ptr_destroy_all(&state->v_attrs);
   igraph_vector_ptr_destroy_all(&state->e_attrs);
@@ -260,6 +418,8 @@ void igraph_i_graphml_sax_handler_start_document(void *state0) {
   state->data_key=0;
   state->error_message=0;
   state->data_char=0;
+  state->data_char_len=0;
+  state->data_char_size=0;
   state->unknown_depth=0;
 
   ret=igraph_vector_int_init(&state->prev_state_stack, 0);
@@ -314,6 +474,12 @@ void igraph_i_graphml_sax_handler_start_document(void *state0) {
   }
   IGRAPH_FINALLY(igraph_strvector_destroy, &state->edgeids);
 
+  ret=igraph_i_graphml_strcolumn_init(&state->edgeid_column);
+  if (ret) {
+    RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", ret);
+  }
+  IGRAPH_FINALLY(igraph_i_graphml_strcolumn_destroy, &state->edgeid_column);
+
   ret=igraph_trie_init(&state->v_names, 0);
   if (ret) {
     RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", ret);
@@ -332,14 +498,14 @@ void igraph_i_graphml_sax_handler_start_document(void *state0) {
   }
   IGRAPH_FINALLY(igraph_trie_destroy, &state->g_names);
   
-  IGRAPH_FINALLY_CLEAN(10);
+  IGRAPH_FINALLY_CLEAN(11);
   IGRAPH_FINALLY(igraph_i_graphml_destroy_state, state);
 }
 
 void igraph_i_graphml_sax_handler_end_document(void *state0) {
   struct igraph_i_graphml_parser_state *state=
     (struct igraph_i_graphml_parser_state*)state0;
-  long i, l;
+  long i;
   int r;
   igraph_attribute_record_t idrec, eidrec;
   const char *idstr="id";
@@ -351,33 +517,46 @@ void igraph_i_graphml_sax_handler_end_document(void *state0) {
 
     igraph_vector_ptr_t vattr, eattr, gattr;
     long int esize=igraph_vector_ptr_size(&state->e_attrs);
+    long int no_of_nodes=igraph_trie_size(&state->node_trie);
+    long int no_of_edges=igraph_vector_size(&state->edgelist)/2;
+    igraph_bool_t has_edgeids=
+      igraph_vector_long_size(&state->edgeid_column.offsets) != 0;
     const void **tmp;
-    r=igraph_vector_ptr_init(&vattr, 
-			     igraph_vector_ptr_size(&state->v_attrs)+1);
+
+    /* The graph is built in three steps: the graph attributes, the
+       vertices and the edges. The parser state of a step is freed 
+       before the next step, to keep the peak memory usage low. */
+
+    r=igraph_vector_ptr_init(&gattr, igraph_vector_ptr_size(&state->g_attrs));
     if (r) {
-      igraph_error("Cannot parse GraphML file", __FILE__, __LINE__, r);
-      igraph_i_graphml_sax_handler_error(state, "Cannot parse GraphML file");
-      return;
+      RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", r);
     }
-    IGRAPH_FINALLY(igraph_vector_ptr_destroy, &vattr);
-    if (igraph_strvector_size(&state->edgeids) != 0) {
-      esize++;      
+    IGRAPH_FINALLY(igraph_vector_ptr_destroy, &gattr);
+    for (i=0; i<igraph_vector_ptr_size(&state->g_attrs); i++) {
+      igraph_i_graphml_attribute_record_t *graphmlrec=
+	VECTOR(state->g_attrs)[i];
+      r=igraph_i_graphml_attribute_record_finish(graphmlrec, 1);
+      if (r) {
+	RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", r);
+      }
+      VECTOR(gattr)[i]=&graphmlrec->record;
     }
-    r=igraph_vector_ptr_init(&eattr, esize);
+    r=igraph_empty_attrs(state->g, 0, state->edges_directed, &gattr);
     if (r) {
-      igraph_error("Cannot parse GraphML file", __FILE__, __LINE__, r);
-      igraph_i_graphml_sax_handler_error(state, "Cannot parse GraphML file");
-      return;
+      RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", r);
     }
-    IGRAPH_FINALLY(igraph_vector_ptr_destroy, &eattr);
-    r=igraph_vector_ptr_init(&gattr, igraph_vector_ptr_size(&state->g_attrs));
+    igraph_vector_ptr_destroy(&gattr);
+    IGRAPH_FINALLY_CLEAN(1);
+    IGRAPH_FINALLY(igraph_destroy, state->g);
+
+    /* Vertices */
+
+    r=igraph_vector_ptr_init(&vattr, 
+			     igraph_vector_ptr_size(&state->v_attrs)+1);
     if (r) {
-      igraph_error("Cannot parse GraphML file", __FILE__, __LINE__, r);
-      igraph_i_graphml_sax_handler_error(state, "Cannot parse GraphML file");
-      return;
+      RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", r);
     }
-    IGRAPH_FINALLY(igraph_vector_ptr_destroy, &gattr);
-
+    IGRAPH_FINALLY(igraph_vector_ptr_destroy, &vattr);
     for (i=0; i<igraph_vector_ptr_size(&state->v_attrs); i++) {
       igraph_i_graphml_attribute_record_t *graphmlrec=
 	VECTOR(state->v_attrs)[i];
@@ -389,30 +568,9 @@ void igraph_i_graphml_sax_handler_end_document(void *state0) {
 	already_has_vertex_id=1;
       }
 
-      if (rec->type == IGRAPH_ATTRIBUTE_NUMERIC) {
-	igraph_vector_t *vec=(igraph_vector_t*)rec->value;
-	long int origsize=igraph_vector_size(vec);
-	long int nodes=igraph_trie_size(&state->node_trie);
-	igraph_vector_resize(vec, nodes);
-	for (l=origsize; l<nodes; l++) {
-	  VECTOR(*vec)[l] = graphmlrec->default_value.as_numeric;
-	}
-      } else if (rec->type == IGRAPH_ATTRIBUTE_STRING) {
-	igraph_strvector_t *strvec=(igraph_strvector_t*)rec->value;
-	long int origsize=igraph_strvector_size(strvec);
-	long int nodes=igraph_trie_size(&state->node_trie);
-	igraph_strvector_resize(strvec, nodes);
-	for (l=origsize; l<nodes; l++) {
-	  igraph_strvector_set(strvec, l, graphmlrec->default_value.as_string);
-	}
-      } else if (rec->type == IGRAPH_ATTRIBUTE_BOOLEAN) {
-	igraph_vector_bool_t *boolvec=(igraph_vector_bool_t*)rec->value;
-	long int origsize=igraph_vector_bool_size(boolvec);
-	long int nodes=igraph_trie_size(&state->node_trie);
-	igraph_vector_bool_resize(boolvec, nodes);
-	for (l=origsize; l<nodes; l++) {
-	  VECTOR(*boolvec)[l] = graphmlrec->default_value.as_boolean;
-	}
+      r=igraph_i_graphml_attribute_record_finish(graphmlrec, no_of_nodes);
+      if (r) {
+	RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", r);
       }
       VECTOR(vattr)[i]=rec;
     }
@@ -420,12 +578,38 @@ void igraph_i_graphml_sax_handler_end_document(void *state0) {
       idrec.name=idstr;
       idrec.type=IGRAPH_ATTRIBUTE_STRING;
       tmp=&idrec.value;
-      igraph_trie_getkeys(&state->node_trie, (const igraph_strvector_t **)tmp);
+      r=igraph_trie_getkeys(&state->node_trie, 
+			    (const igraph_strvector_t **)tmp);
+      if (r) {
+	RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", r);
+      }
       VECTOR(vattr)[i]=&idrec;
     } else {
       igraph_vector_ptr_pop_back(&vattr);
     }
+    r=igraph_add_vertices(state->g, (igraph_integer_t) no_of_nodes, &vattr);
+    if (r) {
+      RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", r);
+    }
+    igraph_vector_ptr_destroy(&vattr);
+    IGRAPH_FINALLY_CLEAN(1);
+
+    /* The vertex attributes and ids are not needed any more, the
+       destructors can be called again, by igraph_i_graphml_destroy_state */
+    igraph_vector_ptr_free_all(&state->v_attrs);
+    igraph_vector_ptr_clear(&state->v_attrs);
+    igraph_trie_destroy(&state->node_trie);
 
+    /* Edges */
+
+    if (has_edgeids) {
+      esize++;      
+    }
+    r=igraph_vector_ptr_init(&eattr, esize);
+    if (r) {
+      RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", r);
+    }
+    IGRAPH_FINALLY(igraph_vector_ptr_destroy, &eattr);
     for (i=0; i<igraph_vector_ptr_size(&state->e_attrs); i++) {
       igraph_i_graphml_attribute_record_t *graphmlrec=
 	VECTOR(state->e_attrs)[i];
@@ -435,42 +619,20 @@ void igraph_i_graphml_sax_handler_end_document(void *state0) {
 	already_has_edge_id=1;
       }
 
-      if (rec->type == IGRAPH_ATTRIBUTE_NUMERIC) {
-	igraph_vector_t *vec=(igraph_vector_t*)rec->value;
-	long int origsize=igraph_vector_size(vec);
-	long int edges=igraph_vector_size(&state->edgelist)/2;
-	igraph_vector_resize(vec, edges);
-	for (l=origsize; l<edges; l++) {
-	  VECTOR(*vec)[l] = graphmlrec->default_value.as_numeric;
-	}
-      } else if (rec->type == IGRAPH_ATTRIBUTE_STRING) {
-	igraph_strvector_t *strvec=(igraph_strvector_t*)rec->value;
-	long int origsize=igraph_strvector_size(strvec);
-	long int edges=igraph_vector_size(&state->edgelist)/2;
-	igraph_strvector_resize(strvec, edges);
-	for (l=origsize; l<edges; l++) {
-	  igraph_strvector_set(strvec, l, graphmlrec->default_value.as_string);
-	}
-      } else if (rec->type == IGRAPH_ATTRIBUTE_BOOLEAN) {
-	igraph_vector_bool_t *boolvec=(igraph_vector_bool_t*)rec->value;
-	long int origsize=igraph_vector_bool_size(boolvec);
-	long int edges=igraph_vector_size(&state->edgelist)/2;
-	igraph_vector_bool_resize(boolvec, edges);
-	for (l=origsize; l<edges; l++) {
-	  VECTOR(*boolvec)[l] = graphmlrec->default_value.as_boolean;
-	}
+      r=igraph_i_graphml_attribute_record_finish(graphmlrec, no_of_edges);
+      if (r) {
+	RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", r);
       }
       VECTOR(eattr)[i]=rec;
     }
-    if (igraph_strvector_size(&state->edgeids) != 0) {
+    if (has_edgeids) {
       if (!already_has_edge_id) {
-	long int origsize=igraph_strvector_size(&state->edgeids);
 	eidrec.name=idstr;
 	eidrec.type=IGRAPH_ATTRIBUTE_STRING;
-	igraph_strvector_resize(&state->edgeids, 
-				igraph_vector_size(&state->edgelist)/2);
-	for (; origsize < igraph_strvector_size(&state->edgeids); origsize++) {
-	  igraph_strvector_set(&state->edgeids, origsize, "");
+	r=igraph_i_graphml_strcolumn_finish(&state->edgeid_column,
+					    no_of_edges, "", &state->edgeids);
+	if (r) {
+	  RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", r);
 	}
 	eidrec.value=&state->edgeids;
 	VECTOR(eattr)[(long int)igraph_vector_ptr_size(&eattr)-1]=&eidrec;
@@ -480,45 +642,12 @@ void igraph_i_graphml_sax_handler_end_document(void *state0) {
 		       "there is already an 'id' edge attribute");
       }
     }
-
-    for (i=0; i<igraph_vector_ptr_size(&state->g_attrs); i++) {
-      igraph_i_graphml_attribute_record_t *graphmlrec=
-	VECTOR(state->g_attrs)[i];
-      igraph_attribute_record_t *rec=&graphmlrec->record;
-      if (rec->type == IGRAPH_ATTRIBUTE_NUMERIC) {
-	igraph_vector_t *vec=(igraph_vector_t*)rec->value;
-	long int origsize=igraph_vector_size(vec);
-	igraph_vector_resize(vec, 1);
-	for (l=origsize; l<1; l++) {
-	  VECTOR(*vec)[l] = graphmlrec->default_value.as_numeric;
-	}
-      } else if (rec->type == IGRAPH_ATTRIBUTE_STRING) {
-	igraph_strvector_t *strvec=(igraph_strvector_t*)rec->value;
-	long int origsize=igraph_strvector_size(strvec);
-	igraph_strvector_resize(strvec, 1);
-	for (l=origsize; l<1; l++) {
-	  igraph_strvector_set(strvec, l, graphmlrec->default_value.as_string);
-	}
-      } else if (rec->type == IGRAPH_ATTRIBUTE_BOOLEAN) {
-	igraph_vector_bool_t *boolvec=(igraph_vector_bool_t*)rec->value;
-	long int origsize=igraph_vector_bool_size(boolvec);
-	igraph_vector_bool_resize(boolvec, 1);
-	for (l=origsize; l<1; l++) {
-	  VECTOR(*boolvec)[l] = graphmlrec->default_value.as_boolean;
-	}
-      }
-      VECTOR(gattr)[i]=rec;
+    r=igraph_add_edges(state->g, &state->edgelist, &eattr);
+    if (r) {
+      RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", r);
     }
-    
-    igraph_empty_attrs(state->g, 0, state->edges_directed, &gattr);
-    igraph_add_vertices(state->g, (igraph_integer_t) 
-			igraph_trie_size(&state->node_trie), &vattr);
-    igraph_add_edges(state->g, &state->edgelist, &eattr);
-
-    igraph_vector_ptr_destroy(&vattr);
     igraph_vector_ptr_destroy(&eattr);
-    igraph_vector_ptr_destroy(&gattr);
-    IGRAPH_FINALLY_CLEAN(3);     
+    IGRAPH_FINALLY_CLEAN(2);	/* + the graph */
   }
 
   igraph_i_graphml_destroy_state(state);
@@ -532,6 +661,7 @@ void igraph_i_graphml_sax_handler_end_document(void *state0) {
 #define XML_ATTR_URI(it) (*(it+2))
 #define XML_ATTR_VALUE_START(it) (*(it+3))
 #define XML_ATTR_VALUE_END(it) (*(it+4))
+#define XML_ATTR_VALUE_LENGTH(it) ((*(it+4))-(*(it+3)))
 #define XML_ATTR_VALUE(it) *(it+3), (*(it+4))-(*(it+3))
 
 igraph_i_graphml_attribute_record_t* igraph_i_graphml_add_attribute_key(
@@ -715,6 +845,11 @@ igraph_i_graphml_attribute_record_t* igraph_i_graphml_add_attribute_key(
     }
     rec->record.value=strvec;
     igraph_strvector_init(strvec, 0);
+    ret=igraph_i_graphml_strcolumn_init(&rec->strcolumn);
+    if (ret) {
+      GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", ret);
+      return 0;
+    }
     break;
   default: break;
   }
@@ -742,10 +877,7 @@ void igraph_i_graphml_attribute_data_setup(struct igraph_i_graphml_parser_state
 	free(state->data_key);
       }
       state->data_key=xmlStrndup(XML_ATTR_VALUE(it));
-      if (state->data_char) {
-        free(state->data_char);
-      }
-      state->data_char=0;
+      state->data_char_len=0;
       state->data_type=type;
     } else {
       /* ignore */
@@ -755,25 +887,32 @@ void igraph_i_graphml_attribute_data_setup(struct igraph_i_graphml_parser_state
 
 void igraph_i_graphml_append_to_data_char(struct igraph_i_graphml_parser_state *state,
 					  const xmlChar *data, int len) {
-  long int data_char_new_start=0;
+  long int newlen=state->data_char_len+len;
 
   if (!state->successful) return;
 
-  if (state->data_char) {
-    data_char_new_start=(long int) strlen(state->data_char);
-    state->data_char=igraph_Realloc(state->data_char, 
-				    (size_t)(data_char_new_start+len+1), char);
-  } else {
-    state->data_char=igraph_Calloc((size_t) len+1, char);
-  }
-  if (state->data_char==0) {
-    RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", IGRAPH_ENOMEM);
+  if (newlen+1 > state->data_char_size) {
+    long int newsize=2*state->data_char_size > newlen+1 ? 
+      2*state->data_char_size : newlen+1;
+    char *tmp=igraph_Realloc(state->data_char, (size_t) newsize, char);
+    if (tmp==0) {
+      RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", IGRAPH_ENOMEM);
+    }
+    state->data_char=tmp;
+    state->data_char_size=newsize;
   }
-  memcpy(state->data_char+data_char_new_start, data, 
+  memcpy(state->data_char+state->data_char_len, data, 
 	 (size_t) len*sizeof(xmlChar));
-  state->data_char[data_char_new_start+len]='\0';
+  state->data_char[newlen]='\0';
+  state->data_char_len=newlen;
 }
 
+/* The character data of the current tag, or a null pointer if it is
+   empty */
+
+#define GRAPHML_DATA_CHAR(state) \
+  ((state)->data_char_len > 0 ? (state)->data_char : 0)
+
 void igraph_i_graphml_attribute_data_finish(struct igraph_i_graphml_parser_state *state) {
   const char *key=fromXmlChar(state->data_key);
   igraph_attribute_elemtype_t type=state->data_type;
@@ -813,68 +952,37 @@ void igraph_i_graphml_attribute_data_finish(struct igraph_i_graphml_parser_state
         __FILE__, __LINE__, 0,
         key
     );
-    igraph_Free(state->data_char);
+    state->data_char_len=0;
     return;
   }
    
   graphmlrec=VECTOR(*ptrvector)[recid];
   rec=&graphmlrec->record;
 
+  ret=igraph_i_graphml_attribute_record_extend(graphmlrec, id+1);
+  if (ret) {
+    RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", ret);
+  }
+
   switch (rec->type) {
     igraph_vector_bool_t *boolvec;
     igraph_vector_t *vec;
-    igraph_strvector_t *strvec;
-    long int s, i;
-    const char* strvalue;
   case IGRAPH_ATTRIBUTE_BOOLEAN:
     boolvec=(igraph_vector_bool_t *)rec->value;
-    s=igraph_vector_bool_size(boolvec);
-    if (id >= s) {
-      ret=igraph_vector_bool_resize(boolvec, id+1);
-      if (ret) {
-        RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", ret);
-      }
-      for (i=s; i<id; i++) {
-	VECTOR(*boolvec)[i] = graphmlrec->default_value.as_boolean;
-      }
-    }
-    VECTOR(*boolvec)[id] = igraph_i_graphml_parse_boolean(state->data_char,
-	graphmlrec->default_value.as_boolean);
+    VECTOR(*boolvec)[id] = 
+      igraph_i_graphml_parse_boolean(GRAPHML_DATA_CHAR(state),
+				     graphmlrec->default_value.as_boolean);
     break;
   case IGRAPH_ATTRIBUTE_NUMERIC:
     vec=(igraph_vector_t *)rec->value;
-    s=igraph_vector_size(vec);
-    if (id >= s) {
-      ret=igraph_vector_resize(vec, id+1);
-      if (ret) {
-        RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", ret);
-      }
-      for (i=s; i<id; i++) {
-	VECTOR(*vec)[i] = graphmlrec->default_value.as_numeric;
-      }
-    }
-    VECTOR(*vec)[id] = igraph_i_graphml_parse_numeric(state->data_char,
-	graphmlrec->default_value.as_numeric);
+    VECTOR(*vec)[id] = 
+      igraph_i_graphml_parse_numeric(GRAPHML_DATA_CHAR(state),
+				     graphmlrec->default_value.as_numeric);
     break;
   case IGRAPH_ATTRIBUTE_STRING:
-    strvec=(igraph_strvector_t *)rec->value;
-    s=igraph_strvector_size(strvec);
-    if (id >= s) {
-      ret=igraph_strvector_resize(strvec, id+1);
-      if (ret) {
-        RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", ret);
-      }
-      strvalue = graphmlrec->default_value.as_string;
-      for (i=s;i<id;i++) {
-	igraph_strvector_set(strvec, i, strvalue);
-      }
-    }
-    if (state->data_char) {
-      strvalue = state->data_char;
-    } else {
-      strvalue = graphmlrec->default_value.as_string;
-    }
-    ret=igraph_strvector_set(strvec, id, strvalue);
+    ret=igraph_i_graphml_strcolumn_set(&graphmlrec->strcolumn, id,
+				       GRAPHML_DATA_CHAR(state),
+				       state->data_char_len);
     if (ret) {
       RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", ret);
     }
@@ -883,9 +991,7 @@ void igraph_i_graphml_attribute_data_finish(struct igraph_i_graphml_parser_state
     break;
   }
 
-  if (state->data_char) {
-    igraph_Free(state->data_char);
-  }
+  state->data_char_len=0;
 }
 
 void igraph_i_graphml_attribute_default_value_finish(
@@ -899,7 +1005,7 @@ void igraph_i_graphml_attribute_default_value_finish(
     return;
   }
 
-  if (state->data_char == 0)
+  if (state->data_char_len == 0)
     return;
 
   switch (graphmlrec->record.type) {
@@ -912,20 +1018,16 @@ void igraph_i_graphml_attribute_default_value_finish(
 	state->data_char, IGRAPH_NAN);
     break;
   case IGRAPH_ATTRIBUTE_STRING:
-    if (state->data_char) {
-      if (graphmlrec->default_value.as_string != 0) {
-	free(graphmlrec->default_value.as_string);
-      }
-      graphmlrec->default_value.as_string = strdup(state->data_char);
+    if (graphmlrec->default_value.as_string != 0) {
+      free(graphmlrec->default_value.as_string);
     }
+    graphmlrec->default_value.as_string = strdup(state->data_char);
     break;
   default:
     break;
   }
 
-  if (state->data_char) {
-    igraph_Free(state->data_char);
-  }
+  state->data_char_len=0;
 }
 
 void igraph_i_graphml_sax_handler_start_element_ns(
@@ -935,9 +1037,8 @@ void igraph_i_graphml_sax_handler_start_element_ns(
   struct igraph_i_graphml_parser_state *state=
     (struct igraph_i_graphml_parser_state*)state0;
   xmlChar** it;
-  char* attr_value;
   long int id1, id2;
-  int i;
+  int i, ret=0;
 
   if (!state->successful)
     return;
@@ -1015,23 +1116,21 @@ void igraph_i_graphml_sax_handler_start_element_ns(
 	  continue;
 	}
 	if (xmlStrEqual(*it, toXmlChar("source"))) {
-	  attr_value = fromXmlChar(xmlStrndup(XML_ATTR_VALUE(it)));
-	  igraph_trie_get(&state->node_trie, attr_value, &id1);
-	  free(attr_value);
+	  ret=igraph_trie_get2(&state->node_trie, 
+			       fromXmlChar(XML_ATTR_VALUE_START(it)),
+			       XML_ATTR_VALUE_LENGTH(it), &id1);
 	} else if (xmlStrEqual(*it, toXmlChar("target"))) {
-	  attr_value = fromXmlChar(xmlStrndup(XML_ATTR_VALUE(it)));
-	  igraph_trie_get(&state->node_trie, attr_value, &id2);
-	  free(attr_value);
+	  ret=igraph_trie_get2(&state->node_trie, 
+			       fromXmlChar(XML_ATTR_VALUE_START(it)),
+			       XML_ATTR_VALUE_LENGTH(it), &id2);
 	} else if (xmlStrEqual(*it, toXmlChar("id"))) {
-	  long int edges=igraph_vector_size(&state->edgelist)/2+1;
-	  long int origsize=igraph_strvector_size(&state->edgeids);
-	  attr_value = fromXmlChar(xmlStrndup(XML_ATTR_VALUE(it)));
-	  igraph_strvector_resize(&state->edgeids, edges);
-	  for (;origsize < edges-1; origsize++) {
-	    igraph_strvector_set(&state->edgeids, origsize, "");
-	  }
-	  igraph_strvector_set(&state->edgeids, edges-1, attr_value);
-	  free(attr_value);
+	  ret=igraph_i_graphml_strcolumn_set(&state->edgeid_column,
+			     igraph_vector_size(&state->edgelist)/2,
+			     fromXmlChar(XML_ATTR_VALUE_START(it)),
+			     XML_ATTR_VALUE_LENGTH(it));
+	}
+	if (ret) {
+	  RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", ret);
 	}
       }
       if (id1>=0 && id2>=0) {
@@ -1051,9 +1150,12 @@ void igraph_i_graphml_sax_handler_start_element_ns(
 	  continue;
 	}
 	if (xmlStrEqual(XML_ATTR_LOCALNAME(it), toXmlChar("id"))) {
-	  attr_value = fromXmlChar(xmlStrndup(XML_ATTR_VALUE(it)));
-	  igraph_trie_get(&state->node_trie, attr_value, &id1);
-	  free(attr_value);
+	  ret=igraph_trie_get2(&state->node_trie, 
+			       fromXmlChar(XML_ATTR_VALUE_START(it)),
+			       XML_ATTR_VALUE_LENGTH(it), &id1);
+	  if (ret) {
+	    RETURN_GRAPHML_PARSE_ERROR_WITH_CODE(state, "Cannot parse GraphML file", ret);
+	  }
 	  break;
 	}
       }
@@ -1284,6 +1386,12 @@ int igraph_i_xml_escape(char* src, char** dest) {
  * igraph will fall back to the \c id attribute of the \c key tag if
  * \c attr.name is missing.
  *
+ * </para><para>
+ * The file is read in a single pass, and the attribute values are
+ * collected in compact typed columns while reading, so the memory
+ * needed depends on the size of the graph and its attributes, and
+ * not on the size of the XML markup.
+ *
  * \param graph Pointer to an uninitialized graph object.
  * \param instream A stream, it should be readable.
  * \param index If the GraphML file contains more than one graph, the one
@@ -1362,6 +1470,102 @@ int igraph_read_graph_graphml(igraph_t *graph, FILE *instream,
 #endif
 }
 
+/* The same as igraph_i_xml_escape(), but writes the escaped string */
+
+int igraph_i_xml_write_escaped(igraph_i_writer_t *w, const char *src) {
+  const char *s, *run;
+  for (s=run=src; *s; s++) {
+    unsigned char ch=(unsigned char)(*s);
+    const char *entity;
+    switch (ch) {
+    case '&': entity="&amp;"; break;
+    case '<': entity="&lt;"; break;
+    case '>': entity="&gt;"; break;
+    case '"': entity="&quot;"; break;
+    case '\'': entity="&apos;"; break;
+    default:
+      if (IS_FORBIDDEN_CONTROL_CHAR(ch)) {
+	char msg[4096];
+	snprintf(msg, 4096, "Forbidden control character 0x%02X found in igraph_i_xml_escape",
+	    ch);
+	IGRAPH_ERROR(msg, IGRAPH_EINVAL);
+      }
+      continue;
+    }
+    igraph_i_writer_write(w, run, (size_t) (s-run));
+    igraph_i_writer_puts(w, entity);
+    run=s+1;
+  }
+  igraph_i_writer_write(w, run, (size_t) (s-run));
+  return 0;
+}
+
+int igraph_i_xml_escape_all(const igraph_strvector_t *names,
+			    igraph_strvector_t *escaped) {
+  long int i, n=igraph_strvector_size(names);
+  for (i=0; i<n; i++) {
+    char *name, *name_escaped;
+    igraph_strvector_get(names, i, &name);
+    IGRAPH_CHECK(igraph_i_xml_escape(name, &name_escaped));
+    IGRAPH_FINALLY(igraph_free, name_escaped);
+    IGRAPH_CHECK(igraph_strvector_add(escaped, name_escaped));
+    igraph_Free(name_escaped);
+    IGRAPH_FINALLY_CLEAN(1);
+  }
+  return 0;
+}
+
+/* Writes a <data> element for element 'idx' of an attribute column,
+   missing numeric values are not written. */
+
+int igraph_i_graphml_write_attr(igraph_i_writer_t *w, 
+				igraph_i_attr_column_t *col,
+				const char *prefix, const char *name_escaped,
+				long int idx) {
+  IGRAPH_CHECK(igraph_i_attr_column_fetch(col, idx));
+  if (col->type == IGRAPH_ATTRIBUTE_NUMERIC && 
+      isnan(IGRAPH_I_ATTR_COLUMN_NUM(col, idx))) {
+    return 0;
+  }
+  igraph_i_writer_puts(w, "      <data key=\"");
+  igraph_i_writer_puts(w, prefix);
+  igraph_i_writer_puts(w, name_escaped);
+  igraph_i_writer_write(w, "\">", 2);
+  if (col->type == IGRAPH_ATTRIBUTE_NUMERIC) {
+    igraph_i_writer_real(w, IGRAPH_I_ATTR_COLUMN_NUM(col, idx));
+  } else if (col->type == IGRAPH_ATTRIBUTE_STRING) {
+    IGRAPH_CHECK(igraph_i_xml_write_escaped(w, 
+			    IGRAPH_I_ATTR_COLUMN_STR(col, idx)));
+  } else {
+    igraph_i_writer_puts(w, IGRAPH_I_ATTR_COLUMN_BOOL(col, idx) ? 
+			 "true" : "false");
+  }
+  igraph_i_writer_puts(w, "</data>\n");
+  return 0;
+}
+
+/* The <key> elements of the attributes */
+
+void igraph_i_graphml_write_keys(igraph_i_writer_t *w, 
+				 const igraph_vector_t *types,
+				 const igraph_strvector_t *names_escaped,
+				 const char *prefix, const char *elem) {
+  long int i;
+  for (i=0; i<igraph_vector_size(types); i++) {
+    const char *type;
+    if (VECTOR(*types)[i] == IGRAPH_ATTRIBUTE_STRING) {
+      type="string";
+    } else if (VECTOR(*types)[i] == IGRAPH_ATTRIBUTE_NUMERIC) {
+      type="double";
+    } else if (VECTOR(*types)[i] == IGRAPH_ATTRIBUTE_BOOLEAN) {
+      type="boolean";
+    } else {
+      continue;
+    }
+    igraph_i_writer_printf(w, "  <key id=\"%s%s\" for=\"%s\" attr.name=\"%s\" attr.type=\"%s\"/>\n", prefix, STR(*names_escaped, i), elem, STR(*names_escaped, i), type);
+  }
+}
+
 /**
  * \ingroup loadsave
  * \function igraph_write_graph_graphml
@@ -1390,34 +1594,20 @@ int igraph_read_graph_graphml(igraph_t *graph, FILE *instream,
  */
 int igraph_write_graph_graphml(const igraph_t *graph, FILE *outstream, 
 			       igraph_bool_t prefixattr) {
-  int ret;
-  igraph_integer_t l, vc;
-  igraph_eit_t it;
+  long int l, vc, ec;
   igraph_strvector_t gnames, vnames, enames;
   igraph_vector_t gtypes, vtypes, etypes;
+  igraph_strvector_t gnames_escaped, vnames_escaped, enames_escaped;
+  igraph_vector_ptr_t vcols, ecols;
   long int i;
   igraph_vector_t numv;
   igraph_strvector_t strv;
   igraph_vector_bool_t boolv;
+  igraph_i_writer_t w;
   const char *gprefix= prefixattr ? "g_" : "";
   const char *vprefix= prefixattr ? "v_" : "";
   const char *eprefix= prefixattr ? "e_" : "";
   
-  ret=fprintf(outstream, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
-  if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-  ret=fprintf(outstream, "<graphml xmlns=\"" GRAPHML_NAMESPACE_URI "\"\n");
-  if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-  ret=fprintf(outstream, "         xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\"\n");
-  if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-  ret=fprintf(outstream, "         xsi:schemaLocation=\"" GRAPHML_NAMESPACE_URI "\n");
-  if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-  ret=fprintf(outstream, "         " GRAPHML_NAMESPACE_URI "/1.0/graphml.xsd\">\n");
-  if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-  ret=fprintf(outstream, "<!-- Created by igraph -->\n");
-  if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-
-  /* dump the <key> elements if any */
-
   IGRAPH_VECTOR_INIT_FINALLY(&numv, 1);
   IGRAPH_STRVECTOR_INIT_FINALLY(&strv, 1);
   IGRAPH_VECTOR_BOOL_INIT_FINALLY(&boolv, 1);
@@ -1432,228 +1622,122 @@ int igraph_write_graph_graphml(const igraph_t *graph, FILE *outstream,
 			      &gnames, &gtypes,
 			      &vnames, &vtypes,
 			      &enames, &etypes);
-  
-  /* graph attributes */
-  for (i=0; i<igraph_vector_size(&gtypes); i++) {
-    char *name, *name_escaped;
-    igraph_strvector_get(&gnames, i, &name);
-    IGRAPH_CHECK(igraph_i_xml_escape(name, &name_escaped));
-    if (VECTOR(gtypes)[i] == IGRAPH_ATTRIBUTE_STRING) {
-      ret=fprintf(outstream, "  <key id=\"%s%s\" for=\"graph\" attr.name=\"%s\" attr.type=\"string\"/>\n", gprefix, name_escaped, name_escaped);
-      if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);      
-    } else if (VECTOR(gtypes)[i] == IGRAPH_ATTRIBUTE_NUMERIC) {
-      ret=fprintf(outstream, "  <key id=\"%s%s\" for=\"graph\" attr.name=\"%s\" attr.type=\"double\"/>\n", gprefix, name_escaped, name_escaped);
-      if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);            
-    } else if (VECTOR(gtypes)[i] == IGRAPH_ATTRIBUTE_BOOLEAN) {
-      ret=fprintf(outstream, "  <key id=\"%s%s\" for=\"graph\" attr.name=\"%s\" attr.type=\"boolean\"/>\n", gprefix, name_escaped, name_escaped);
-      if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);            
-    }
-    igraph_Free(name_escaped);
-  }
 
-  /* vertex attributes */
-  for (i=0; i<igraph_vector_size(&vtypes); i++) {
-    char *name, *name_escaped;
-    igraph_strvector_get(&vnames, i, &name);
-    IGRAPH_CHECK(igraph_i_xml_escape(name, &name_escaped));
-    if (VECTOR(vtypes)[i] == IGRAPH_ATTRIBUTE_STRING) {
-      ret=fprintf(outstream, "  <key id=\"%s%s\" for=\"node\" attr.name=\"%s\" attr.type=\"string\"/>\n", vprefix, name_escaped, name_escaped);
-      if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);      
-    } else if (VECTOR(vtypes)[i] == IGRAPH_ATTRIBUTE_NUMERIC) {
-      ret=fprintf(outstream, "  <key id=\"%s%s\" for=\"node\" attr.name=\"%s\" attr.type=\"double\"/>\n", vprefix, name_escaped, name_escaped);
-      if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);            
-    } else if (VECTOR(vtypes)[i] == IGRAPH_ATTRIBUTE_BOOLEAN) {
-      ret=fprintf(outstream, "  <key id=\"%s%s\" for=\"node\" attr.name=\"%s\" attr.type=\"boolean\"/>\n", vprefix, name_escaped, name_escaped);
-      if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);            
-    }
-    igraph_Free(name_escaped);
-  }
+  IGRAPH_STRVECTOR_INIT_FINALLY(&gnames_escaped, 0);
+  IGRAPH_STRVECTOR_INIT_FINALLY(&vnames_escaped, 0);
+  IGRAPH_STRVECTOR_INIT_FINALLY(&enames_escaped, 0);
+  IGRAPH_CHECK(igraph_i_xml_escape_all(&gnames, &gnames_escaped));
+  IGRAPH_CHECK(igraph_i_xml_escape_all(&vnames, &vnames_escaped));
+  IGRAPH_CHECK(igraph_i_xml_escape_all(&enames, &enames_escaped));
+
+  IGRAPH_CHECK(igraph_vector_ptr_init(&vcols, 0));
+  IGRAPH_FINALLY(igraph_vector_ptr_destroy_all, &vcols);
+  IGRAPH_CHECK(igraph_i_attr_columns_init(&vcols, graph, 
+			  IGRAPH_ATTRIBUTE_VERTEX, &vnames, &vtypes,
+			  IGRAPH_I_ATTR_COLUMN_CHUNK));
+  IGRAPH_CHECK(igraph_vector_ptr_init(&ecols, 0));
+  IGRAPH_FINALLY(igraph_vector_ptr_destroy_all, &ecols);
+  IGRAPH_CHECK(igraph_i_attr_columns_init(&ecols, graph, 
+			  IGRAPH_ATTRIBUTE_EDGE, &enames, &etypes,
+			  IGRAPH_I_ATTR_COLUMN_CHUNK));
+
+  IGRAPH_CHECK(igraph_i_writer_init(&w, outstream));
+  IGRAPH_FINALLY(igraph_i_writer_destroy, &w);
+
+  igraph_i_writer_puts(&w, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+  igraph_i_writer_puts(&w, "<graphml xmlns=\"" GRAPHML_NAMESPACE_URI "\"\n");
+  igraph_i_writer_puts(&w, "         xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\"\n");
+  igraph_i_writer_puts(&w, "         xsi:schemaLocation=\"" GRAPHML_NAMESPACE_URI "\n");
+  igraph_i_writer_puts(&w, "         " GRAPHML_NAMESPACE_URI "/1.0/graphml.xsd\">\n");
+  igraph_i_writer_puts(&w, "<!-- Created by igraph -->\n");
 
-  /* edge attributes */
-  for (i=0; i<igraph_vector_size(&etypes); i++) {
-    char *name, *name_escaped;
-    igraph_strvector_get(&enames, i, &name);
-    IGRAPH_CHECK(igraph_i_xml_escape(name, &name_escaped));
-    if (VECTOR(etypes)[i] == IGRAPH_ATTRIBUTE_STRING) {
-      ret=fprintf(outstream, "  <key id=\"%s%s\" for=\"edge\" attr.name=\"%s\" attr.type=\"string\"/>\n", eprefix, name_escaped, name_escaped);
-      if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-    } else if (VECTOR(etypes)[i] == IGRAPH_ATTRIBUTE_NUMERIC) {
-      ret=fprintf(outstream, "  <key id=\"%s%s\" for=\"edge\" attr.name=\"%s\" attr.type=\"double\"/>\n", eprefix, name_escaped, name_escaped);
-      if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-    } else if (VECTOR(etypes)[i] == IGRAPH_ATTRIBUTE_BOOLEAN) {
-      ret=fprintf(outstream, "  <key id=\"%s%s\" for=\"edge\" attr.name=\"%s\" attr.type=\"boolean\"/>\n", eprefix, name_escaped, name_escaped);
-      if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-    }
-    igraph_Free(name_escaped);
-  }
+  /* dump the <key> elements if any */
+  igraph_i_graphml_write_keys(&w, &gtypes, &gnames_escaped, gprefix, "graph");
+  igraph_i_graphml_write_keys(&w, &vtypes, &vnames_escaped, vprefix, "node");
+  igraph_i_graphml_write_keys(&w, &etypes, &enames_escaped, eprefix, "edge");
 
-  ret=fprintf(outstream, "  <graph id=\"G\" edgedefault=\"%s\">\n", (igraph_is_directed(graph)?"directed":"undirected"));
-  if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
+  igraph_i_writer_printf(&w, "  <graph id=\"G\" edgedefault=\"%s\">\n", (igraph_is_directed(graph)?"directed":"undirected"));
 
   /* Write the graph atributes before anything else */
   
   for (i=0; i<igraph_vector_size(&gtypes); i++) {
-    char *name, *name_escaped;
+    char *name;
+    const char *name_escaped=STR(gnames_escaped, i);
+    igraph_strvector_get(&gnames, i, &name);
     if (VECTOR(gtypes)[i] == IGRAPH_ATTRIBUTE_NUMERIC) {
-      igraph_strvector_get(&gnames, i, &name);
       IGRAPH_CHECK(igraph_i_attribute_get_numeric_graph_attr(graph, name, &numv));
       if (!isnan(VECTOR(numv)[0])) {
-        IGRAPH_CHECK(igraph_i_xml_escape(name, &name_escaped));
-        ret=fprintf(outstream, "    <data key=\"%s%s\">", gprefix, name_escaped);
-        igraph_Free(name_escaped);
-        if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-        ret=igraph_real_fprintf_precise(outstream, VECTOR(numv)[0]);
-        if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-        ret=fprintf(outstream, "</data>\n");
-        if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
+        igraph_i_writer_printf(&w, "    <data key=\"%s%s\">", gprefix, name_escaped);
+        igraph_i_writer_real(&w, VECTOR(numv)[0]);
+        igraph_i_writer_puts(&w, "</data>\n");
       }
     } else if (VECTOR(gtypes)[i] == IGRAPH_ATTRIBUTE_STRING) {
-      char *s, *s_escaped;
-      igraph_strvector_get(&gnames, i, &name);
-      IGRAPH_CHECK(igraph_i_xml_escape(name, &name_escaped));
-      ret=fprintf(outstream, "    <data key=\"%s%s\">", gprefix, 
-		  name_escaped);
-      igraph_Free(name_escaped);
+      char *s;
+      igraph_i_writer_printf(&w, "    <data key=\"%s%s\">", gprefix, 
+			     name_escaped);
       IGRAPH_CHECK(igraph_i_attribute_get_string_graph_attr(graph, name, &strv));
       igraph_strvector_get(&strv, 0, &s);
-      IGRAPH_CHECK(igraph_i_xml_escape(s, &s_escaped));
-      ret=fprintf(outstream, "%s", s_escaped);
-      igraph_Free(s_escaped);
-      if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-      ret=fprintf(outstream, "</data>\n");
-      if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
+      IGRAPH_CHECK(igraph_i_xml_write_escaped(&w, s));
+      igraph_i_writer_puts(&w, "</data>\n");
     } else if (VECTOR(gtypes)[i] == IGRAPH_ATTRIBUTE_BOOLEAN) {
-      igraph_strvector_get(&gnames, i, &name);
       IGRAPH_CHECK(igraph_i_attribute_get_bool_graph_attr(graph, name, &boolv));
-      IGRAPH_CHECK(igraph_i_xml_escape(name, &name_escaped));
-      ret=fprintf(outstream, "    <data key=\"%s%s\">%s</data>\n",
-                  gprefix, name_escaped, VECTOR(boolv)[0] ? "true" : "false");
-      igraph_Free(name_escaped);
-      if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
+      igraph_i_writer_printf(&w, "    <data key=\"%s%s\">%s</data>\n",
+			     gprefix, name_escaped, 
+			     VECTOR(boolv)[0] ? "true" : "false");
     }
   }
     
   /* Let's dump the nodes first */
   vc=igraph_vcount(graph);
   for (l=0; l<vc; l++) {
-    char *name, *name_escaped;
-    ret=fprintf(outstream, "    <node id=\"n%ld\">\n", (long)l);
-
-    if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
+    igraph_i_writer_puts(&w, "    <node id=\"n");
+    igraph_i_writer_long(&w, l);
+    igraph_i_writer_write(&w, "\">\n", 3);
     
     for (i=0; i<igraph_vector_size(&vtypes); i++) {
-      if (VECTOR(vtypes)[i] == IGRAPH_ATTRIBUTE_NUMERIC) {
-        igraph_strvector_get(&vnames, i, &name);
-        IGRAPH_CHECK(igraph_i_attribute_get_numeric_vertex_attr(graph, name,
-                     igraph_vss_1(l), &numv));
-        if (!isnan(VECTOR(numv)[0])) {
-          IGRAPH_CHECK(igraph_i_xml_escape(name, &name_escaped));
-          ret=fprintf(outstream, "      <data key=\"%s%s\">", vprefix, name_escaped);
-          igraph_Free(name_escaped);
-          if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-          ret=igraph_real_fprintf_precise(outstream, VECTOR(numv)[0]);
-          if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-          ret=fprintf(outstream, "</data>\n");
-          if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-        }
-      } else if (VECTOR(vtypes)[i] == IGRAPH_ATTRIBUTE_STRING) {
-        char *s, *s_escaped;
-        igraph_strvector_get(&vnames, i, &name);
-        IGRAPH_CHECK(igraph_i_xml_escape(name, &name_escaped));
-        ret=fprintf(outstream, "      <data key=\"%s%s\">", vprefix, 
-		    name_escaped);
-        igraph_Free(name_escaped);
-        IGRAPH_CHECK(igraph_i_attribute_get_string_vertex_attr(graph, name,
-                     igraph_vss_1(l), &strv));
-        igraph_strvector_get(&strv, 0, &s);
-        IGRAPH_CHECK(igraph_i_xml_escape(s, &s_escaped));
-        ret=fprintf(outstream, "%s", s_escaped);
-        igraph_Free(s_escaped);
-        if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-        ret=fprintf(outstream, "</data>\n");
-        if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-      } else if (VECTOR(vtypes)[i] == IGRAPH_ATTRIBUTE_BOOLEAN) {
-        igraph_strvector_get(&vnames, i, &name);
-        IGRAPH_CHECK(igraph_i_attribute_get_bool_vertex_attr(graph, name,
-                     igraph_vss_1(l), &boolv));
-        IGRAPH_CHECK(igraph_i_xml_escape(name, &name_escaped));
-        ret=fprintf(outstream, "      <data key=\"%s%s\">%s</data>\n",
-                    vprefix, name_escaped, VECTOR(boolv)[0] ? "true" : "false");
-        igraph_Free(name_escaped);
-        if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
+      igraph_i_attr_column_t *col=VECTOR(vcols)[i];
+      if (col) {
+	IGRAPH_CHECK(igraph_i_graphml_write_attr(&w, col, vprefix, 
+				 STR(vnames_escaped, i), l));
       }
     }
 
-    ret=fprintf(outstream, "    </node>\n");
-    if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);    
+    igraph_i_writer_puts(&w, "    </node>\n");
   }
   
   /* Now the edges */
-  IGRAPH_CHECK(igraph_eit_create(graph, igraph_ess_all(0), &it));
-  IGRAPH_FINALLY(igraph_eit_destroy, &it);
-  while (!IGRAPH_EIT_END(it)) {
+  ec=igraph_ecount(graph);
+  for (l=0; l<ec; l++) {
     igraph_integer_t from, to;
-    char *name, *name_escaped;
-    long int edge=IGRAPH_EIT_GET(it);
-    igraph_edge(graph, (igraph_integer_t) edge, &from, &to);
-    ret=fprintf(outstream, "    <edge source=\"n%ld\" target=\"n%ld\">\n", 
-		(long int)from, (long int)to);
-    if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
+    igraph_edge(graph, (igraph_integer_t) l, &from, &to);
+    igraph_i_writer_puts(&w, "    <edge source=\"n");
+    igraph_i_writer_long(&w, (long int) from);
+    igraph_i_writer_puts(&w, "\" target=\"n");
+    igraph_i_writer_long(&w, (long int) to);
+    igraph_i_writer_write(&w, "\">\n", 3);
 
     for (i=0; i<igraph_vector_size(&etypes); i++) {
-      if (VECTOR(etypes)[i] == IGRAPH_ATTRIBUTE_NUMERIC) {
-        igraph_strvector_get(&enames, i, &name);
-        IGRAPH_CHECK(igraph_i_attribute_get_numeric_edge_attr(graph, name,
-			      igraph_ess_1((igraph_integer_t) edge), &numv));
-        if (!isnan(VECTOR(numv)[0])) {
-          IGRAPH_CHECK(igraph_i_xml_escape(name, &name_escaped));
-          ret=fprintf(outstream, "      <data key=\"%s%s\">", eprefix, name_escaped);
-          igraph_Free(name_escaped);
-          if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-          ret=igraph_real_fprintf_precise(outstream, VECTOR(numv)[0]);
-          if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-          ret=fprintf(outstream, "</data>\n");
-          if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-        }
-      } else if (VECTOR(etypes)[i] == IGRAPH_ATTRIBUTE_STRING) {
-        char *s, *s_escaped;
-        igraph_strvector_get(&enames, i, &name);
-        IGRAPH_CHECK(igraph_i_xml_escape(name, &name_escaped));
-        ret=fprintf(outstream, "      <data key=\"%s%s\">", eprefix, 
-		    name_escaped);
-        igraph_Free(name_escaped);
-        IGRAPH_CHECK(igraph_i_attribute_get_string_edge_attr(graph, name,
-			     igraph_ess_1((igraph_integer_t) edge), &strv));
-        igraph_strvector_get(&strv, 0, &s);
-        IGRAPH_CHECK(igraph_i_xml_escape(s, &s_escaped));
-        ret=fprintf(outstream, "%s", s_escaped);
-        igraph_Free(s_escaped);
-        if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-        ret=fprintf(outstream, "</data>\n");
-        if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-      } else if (VECTOR(etypes)[i] == IGRAPH_ATTRIBUTE_BOOLEAN) {
-        igraph_strvector_get(&enames, i, &name);
-        IGRAPH_CHECK(igraph_i_attribute_get_bool_edge_attr(graph, name,
-			   igraph_ess_1((igraph_integer_t) edge), &boolv));
-        IGRAPH_CHECK(igraph_i_xml_escape(name, &name_escaped));
-        ret=fprintf(outstream, "      <data key=\"%s%s\">%s</data>\n",
-                    eprefix, name_escaped, VECTOR(boolv)[0] ? "true" : "false");
-        igraph_Free(name_escaped);
-        if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
+      igraph_i_attr_column_t *col=VECTOR(ecols)[i];
+      if (col) {
+	IGRAPH_CHECK(igraph_i_graphml_write_attr(&w, col, eprefix, 
+				 STR(enames_escaped, i), l));
       }
     }
 
-    ret=fprintf(outstream, "    </edge>\n");
-    if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-    IGRAPH_EIT_NEXT(it);
+    igraph_i_writer_puts(&w, "    </edge>\n");
   }
-  igraph_eit_destroy(&it);
-  IGRAPH_FINALLY_CLEAN(1);
   
-  ret=fprintf(outstream, "  </graph>\n");
-  if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-  fprintf(outstream, "</graphml>\n");
-  if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
+  igraph_i_writer_puts(&w, "  </graph>\n");
+  igraph_i_writer_puts(&w, "</graphml>\n");
+
+  IGRAPH_CHECK(igraph_i_writer_finish(&w));
+  igraph_i_writer_destroy(&w);
+  igraph_vector_ptr_destroy_all(&ecols);
+  igraph_vector_ptr_destroy_all(&vcols);
+  igraph_strvector_destroy(&enames_escaped);
+  igraph_strvector_destroy(&vnames_escaped);
+  igraph_strvector_destroy(&gnames_escaped);
+  IGRAPH_FINALLY_CLEAN(6);
   
   igraph_strvector_destroy(&gnames);
   igraph_strvector_destroy(&vnames);
@@ -31,8 +31,11 @@
 #include "igraph_interrupt_internal.h"
 #include "igraph_constructors.h"
 #include "igraph_types_internal.h"
+#include "igraph_parallel_internal.h"
+#include "igraph_writer_internal.h"
 
 #include <ctype.h>		/* isspace */
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
@@ -47,6 +50,72 @@
  * operating systems supporting \quote non-standard\endquote streams.</para>
  */
 
+/* The edge list reader reads the file in blocks of this size, and
+   each block is split into parts, with at least
+   IGRAPH_I_EDGELIST_MIN_PART bytes each, that are parsed in
+   parallel. */
+
+#define IGRAPH_I_EDGELIST_BLOCK (1 << 24)
+#define IGRAPH_I_EDGELIST_MIN_PART (1 << 20)
+
+/* Whitespace in the C locale, like isspace() */
+#define IGRAPH_I_EDGELIST_SPACE(c) ((c) == ' ' || ((c) >= '\t' && (c) <= '\r'))
+
+/* Parses the integers in buf[0, len) into res and returns their
+ * number, or -1 for a syntax error. buf must not start or end in the
+ * middle of a number, so a part of len bytes contains at most
+ * (len+1)/2 numbers. Plain decimal numbers are parsed here, everything
+ * else (signs, leading zeros, very long numbers) goes through
+ * strtol(), so the accepted syntax is the same as the "%li" format
+ * of scanf(). This runs in parallel, so it must not allocate memory
+ * or call the error handler. */
+
+static long int igraph_i_read_edgelist_part(const char *buf, long int len,
+					     igraph_real_t *res) {
+  const char *p = buf, *end = buf + len;
+  long int no = 0;
+
+  while (1) {
+    const char *tok;
+    long int val = 0;
+
+    while (p < end && IGRAPH_I_EDGELIST_SPACE(*p)) {
+      p++;
+    }
+    if (p == end) {
+      break;
+    }
+
+    tok = p;
+    if (*p == '0') {
+      p++;
+    } else if (*p >= '1' && *p <= '9') {
+      while (p < end && *p >= '0' && *p <= '9' && p - tok < 18) {
+	val = val * 10 + (*p - '0');
+	p++;
+      }
+    }
+    if (p == tok || (p < end && !IGRAPH_I_EDGELIST_SPACE(*p))) {
+      char tmp[64], *tend;
+      while (p < end && !IGRAPH_I_EDGELIST_SPACE(*p)) {
+	p++;
+      }
+      if (p - tok >= (long int) sizeof(tmp)) {
+	return -1;
+      }
+      memcpy(tmp, tok, (size_t) (p - tok));
+      tmp[p - tok] = '\0';
+      val = strtol(tmp, &tend, 0);
+      if (tend != tmp + (p - tok)) {
+	return -1;
+      }
+    }
+    res[no++] = val;
+  }
+
+  return no;
+}
+
 /**
  * \ingroup loadsave
  * \function igraph_read_graph_edgelist
@@ -57,6 +126,10 @@
  * whitespace. The one edge (ie. two integers) per line format is thus
  * not required (but recommended for readability). Edges of directed
  * graphs are assumed to be in from, to order.
+ * 
+ * </para><para>
+ * The file is read in large blocks, and if igraph was compiled with
+ * OpenMP support, the blocks are parsed in parallel.
  * \param graph Pointer to an uninitialized graph object.
  * \param instream Pointer to a stream, it should be readable.
  * \param n The number of vertices in the graph. If smaller than the
@@ -79,41 +152,111 @@ int igraph_read_graph_edgelist(igraph_t *graph, FILE *instream,
 			       igraph_integer_t n, igraph_bool_t directed) {
 
   igraph_vector_t edges=IGRAPH_VECTOR_NULL;
-  long int from, to;
-  int c;
+  igraph_vector_long_t bounds, counts;
+  long int maxparts = IGRAPH_I_MAX_THREADS();
+  long int size = 0, no = 0;
+  igraph_bool_t last = 0;
+  char *buf;
   
   IGRAPH_VECTOR_INIT_FINALLY(&edges, 0);
-  IGRAPH_CHECK(igraph_vector_reserve(&edges, 100));
+  buf = igraph_Calloc(IGRAPH_I_EDGELIST_BLOCK, char);
+  if (buf == 0) {
+    IGRAPH_ERROR("cannot read edgelist file", IGRAPH_ENOMEM);
+  }
+  IGRAPH_FINALLY(igraph_free, buf);
+  IGRAPH_CHECK(igraph_vector_long_init(&bounds, maxparts + 1));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &bounds);
+  IGRAPH_CHECK(igraph_vector_long_init(&counts, maxparts));
+  IGRAPH_FINALLY(igraph_vector_long_destroy, &counts);
 
-  /* skip all whitespace */
-  do {
-    c = getc (instream);
-  } while (isspace (c));
-  ungetc (c, instream);
-  
-  while (!feof(instream)) {
-    int read;
+  while (!last) {
+    long int len, nparts, i, pos, needed;
 
     IGRAPH_ALLOW_INTERRUPTION();
-    
-    read=fscanf(instream, "%li", &from);
-    if (read != 1) { 
-      IGRAPH_ERROR("parsing edgelist file failed", IGRAPH_PARSEERROR); 
+
+    size += (long int) fread(buf + size, 1,
+			     (size_t) (IGRAPH_I_EDGELIST_BLOCK - size), instream);
+    if (size < IGRAPH_I_EDGELIST_BLOCK) {
+      if (ferror(instream)) {
+	IGRAPH_ERROR("reading edgelist file failed", IGRAPH_EFILE);
+      }
+      last = 1;
     }
-    read=fscanf(instream, "%li", &to);
-    if (read != 1) { 
-      IGRAPH_ERROR("parsing edgelist file failed", IGRAPH_PARSEERROR); 
+
+    /* Parse up to the last whitespace, the rest of the block is
+       the beginning of a number, it is kept for the next block */
+    len = size;
+    if (!last) {
+      while (len > 0 && !IGRAPH_I_EDGELIST_SPACE(buf[len - 1])) {
+	len--;
+      }
+      if (len == 0) {
+	IGRAPH_ERROR("parsing edgelist file failed", IGRAPH_PARSEERROR);
+      }
     }
-    IGRAPH_CHECK(igraph_vector_push_back(&edges, from));
-    IGRAPH_CHECK(igraph_vector_push_back(&edges, to));
-    
-    /* skip all whitespace */
-    do {
-      c = getc (instream);
-    } while (isspace (c));
-    ungetc (c, instream);    
+
+    /* Split the block at whitespace. Part i is parsed into the
+       edge vector from position no + bounds[i]/2 + i, so that
+       the parts cannot overlap, and then they are moved together. */
+    nparts = len / IGRAPH_I_EDGELIST_MIN_PART + 1;
+    if (nparts > maxparts) {
+      nparts = maxparts;
+    }
+    VECTOR(bounds)[0] = 0;
+    for (i = 1; i < nparts; i++) {
+      long int b = len / nparts * i;
+      if (b < VECTOR(bounds)[i - 1]) {
+	b = VECTOR(bounds)[i - 1];
+      }
+      while (b < len && !IGRAPH_I_EDGELIST_SPACE(buf[b])) {
+	b++;
+      }
+      VECTOR(bounds)[i] = b;
+    }
+    VECTOR(bounds)[nparts] = len;
+
+    needed = no + len / 2 + nparts + 1;
+    if (needed > igraph_vector_capacity(&edges)) {
+      long int cap = 2 * igraph_vector_capacity(&edges);
+      IGRAPH_CHECK(igraph_vector_reserve(&edges, needed > cap ? needed : cap));
+    }
+    IGRAPH_CHECK(igraph_vector_resize(&edges, needed));
+
+#pragma omp parallel for num_threads((int) nparts) private(i) schedule(static, 1)
+    for (i = 0; i < nparts; i++) {
+      long int from = VECTOR(bounds)[i], to = VECTOR(bounds)[i + 1];
+      VECTOR(counts)[i] =
+	igraph_i_read_edgelist_part(buf + from, to - from,
+				    VECTOR(edges) + no + from / 2 + i);
+    }
+
+    for (i = 0, pos = no; i < nparts; i++) {
+      long int c = VECTOR(counts)[i];
+      igraph_real_t *part = VECTOR(edges) + no + VECTOR(bounds)[i] / 2 + i;
+      if (c < 0) {
+	IGRAPH_ERROR("parsing edgelist file failed", IGRAPH_PARSEERROR);
+      }
+      if (part != VECTOR(edges) + pos) {
+	memmove(VECTOR(edges) + pos, part, sizeof(igraph_real_t) * (size_t) c);
+      }
+      pos += c;
+    }
+    no = pos;
+
+    memmove(buf, buf + len, (size_t) (size - len));
+    size -= len;
   }
-  
+
+  if (no % 2 != 0) {
+    IGRAPH_ERROR("parsing edgelist file failed", IGRAPH_PARSEERROR);
+  }
+  IGRAPH_CHECK(igraph_vector_resize(&edges, no));
+
+  igraph_vector_long_destroy(&counts);
+  igraph_vector_long_destroy(&bounds);
+  igraph_Free(buf);
+  IGRAPH_FINALLY_CLEAN(3);
+
   IGRAPH_CHECK(igraph_create(graph, &edges, n, directed));
   igraph_vector_destroy(&edges);
   IGRAPH_FINALLY_CLEAN(1);
@@ -254,9 +397,9 @@ int igraph_read_graph_ncol(igraph_t *graph, FILE *instream,
 
   if (names) {
     const igraph_strvector_t *namevec;
+    IGRAPH_CHECK(igraph_trie_getkeys(&trie, &namevec)); /* dirty */
     IGRAPH_CHECK(igraph_vector_ptr_init(&name, 1)); 
     pname=&name;
-    igraph_trie_getkeys(&trie, &namevec); /* dirty */
     namerec.name=namestr;
     namerec.type=IGRAPH_ATTRIBUTE_STRING;
     namerec.value=namevec;
@@ -411,7 +554,7 @@ int igraph_read_graph_lgl(igraph_t *graph, FILE *instream,
     IGRAPH_CHECK(igraph_vector_ptr_init(&name, 1)); 
     IGRAPH_FINALLY(igraph_vector_ptr_destroy, &name);
     pname=&name;
-    igraph_trie_getkeys(&trie, &namevec); /* dirty */
+    IGRAPH_CHECK(igraph_trie_getkeys(&trie, &namevec)); /* dirty */
     namerec.name=namestr;
     namerec.type=IGRAPH_ATTRIBUTE_STRING;
     namerec.value=namevec;
@@ -1448,26 +1591,25 @@ int igraph_read_graph_gml(igraph_t *graph, FILE *instream) {
 
 int igraph_write_graph_edgelist(const igraph_t *graph, FILE *outstream) {
 
-  igraph_eit_t it;
-  
-  IGRAPH_CHECK(igraph_eit_create(graph, igraph_ess_all(IGRAPH_EDGEORDER_FROM), 
-				 &it));
-  IGRAPH_FINALLY(igraph_eit_destroy, &it);
+  long int no_of_edges=igraph_ecount(graph);
+  long int i;
+  igraph_i_writer_t w;
 
-  while (!IGRAPH_EIT_END(it)) {
+  IGRAPH_CHECK(igraph_i_writer_init(&w, outstream));
+  IGRAPH_FINALLY(igraph_i_writer_destroy, &w);
+
+  for (i=0; i<no_of_edges; i++) {
     igraph_integer_t from, to;
-    int ret;
-    igraph_edge(graph, IGRAPH_EIT_GET(it), &from, &to);
-    ret=fprintf(outstream, "%li %li\n", 
-		(long int) from,
-		(long int) to);
-    if (ret < 0) {
-      IGRAPH_ERROR("Write error", IGRAPH_EFILE);
-    }
-    IGRAPH_EIT_NEXT(it);
+    igraph_edge(graph, (igraph_integer_t) IGRAPH_I_EDGEORDER_FROM(graph, i),
+		&from, &to);
+    igraph_i_writer_long(&w, from);
+    IGRAPH_I_WRITER_PUTC(&w, ' ');
+    igraph_i_writer_long(&w, to);
+    IGRAPH_I_WRITER_PUTC(&w, '\n');
   }
-  
-  igraph_eit_destroy(&it);
+
+  IGRAPH_CHECK(igraph_i_writer_finish(&w));
+  igraph_i_writer_destroy(&w);
   IGRAPH_FINALLY_CLEAN(1);
   return 0;
 }
@@ -1506,13 +1648,13 @@ int igraph_write_graph_edgelist(const igraph_t *graph, FILE *outstream) {
 
 int igraph_write_graph_ncol(const igraph_t *graph, FILE *outstream, 
 			    const char *names, const char *weights) {
-  igraph_eit_t it;
+  long int no_of_edges=igraph_ecount(graph);
+  long int i;
   igraph_attribute_type_t nametype, weighttype;
+  igraph_strvector_t nvec;
+  igraph_vector_t wvec;
+  igraph_i_writer_t w;
   
-  IGRAPH_CHECK(igraph_eit_create(graph, igraph_ess_all(IGRAPH_EDGEORDER_FROM), 
-				 &it));
-  IGRAPH_FINALLY(igraph_eit_destroy, &it);
-
   /* Check if we have the names attribute */
   if (names && !igraph_i_attribute_has_attr(graph, IGRAPH_ATTRIBUTE_VERTEX,
 					    names)) {
@@ -1544,106 +1686,47 @@ int igraph_write_graph_ncol(const igraph_t *graph, FILE *outstream,
     weights=0;
   }
 
-  if (names==0 && weights ==0) {
-    /* No names, no weights */
-    while (!IGRAPH_EIT_END(it)) {
-      igraph_integer_t from, to;
-      int ret;
-      igraph_edge(graph, IGRAPH_EIT_GET(it), &from, &to);
-      ret=fprintf(outstream, "%li %li\n",
-		  (long int) from,
-		  (long int) to);
-      if (ret<0) {
-	IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-      }
-      IGRAPH_EIT_NEXT(it);
-    }
-  } else if (weights==0) {
-    /* No weights, but use names */
-    igraph_strvector_t nvec;
-    IGRAPH_CHECK(igraph_strvector_init(&nvec, igraph_vcount(graph)));
-    IGRAPH_FINALLY(igraph_strvector_destroy, &nvec);
+  IGRAPH_STRVECTOR_INIT_FINALLY(&nvec, 0);
+  IGRAPH_VECTOR_INIT_FINALLY(&wvec, 0);
+  if (names) {
     IGRAPH_CHECK(igraph_i_attribute_get_string_vertex_attr(graph, names, 
 							   igraph_vss_all(),
 							   &nvec));
-    while (!IGRAPH_EIT_END(it)) {
-      igraph_integer_t edge=IGRAPH_EIT_GET(it);
-      igraph_integer_t from, to;
-      int ret=0;
-      char *str1, *str2;
-      igraph_edge(graph, edge, &from, &to);
-      igraph_strvector_get(&nvec, from, &str1);
-      igraph_strvector_get(&nvec, to, &str2);
-      ret=fprintf(outstream, "%s %s\n", str1, str2);
-      if (ret<0) {
-        IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-      }
-      IGRAPH_EIT_NEXT(it);
-    }
-    igraph_strvector_destroy(&nvec);
-    IGRAPH_FINALLY_CLEAN(1);
-  } else if (names==0) {
-    /* No names but weights */
-    igraph_vector_t wvec;
-    IGRAPH_VECTOR_INIT_FINALLY(&wvec, igraph_ecount(graph));
+  }
+  if (weights) {
     IGRAPH_CHECK(igraph_i_attribute_get_numeric_edge_attr(graph, weights, 
 							 igraph_ess_all(IGRAPH_EDGEORDER_ID), 
 							 &wvec));
-    while (!IGRAPH_EIT_END(it)) {
-      igraph_integer_t edge=IGRAPH_EIT_GET(it);
-      igraph_integer_t from, to;
-      int ret1, ret2, ret3;
-      igraph_edge(graph, edge, &from, &to);
-      ret1=fprintf(outstream, "%li %li ", 
-		   (long int)from, (long int)to);
-      ret2=igraph_real_fprintf_precise(outstream, VECTOR(wvec)[(long int)edge]);
-      ret3=fputc('\n', outstream);
-      if (ret1 < 0 || ret2 < 0 || ret3 == EOF) {
-        IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-      }
-      IGRAPH_EIT_NEXT(it);      
+  }
+
+  IGRAPH_CHECK(igraph_i_writer_init(&w, outstream));
+  IGRAPH_FINALLY(igraph_i_writer_destroy, &w);
+
+  for (i=0; i<no_of_edges; i++) {
+    long int edge=IGRAPH_I_EDGEORDER_FROM(graph, i);
+    igraph_integer_t from, to;
+    igraph_edge(graph, (igraph_integer_t) edge, &from, &to);
+    if (names) {
+      igraph_i_writer_puts(&w, STR(nvec, (long int) from));
+      IGRAPH_I_WRITER_PUTC(&w, ' ');
+      igraph_i_writer_puts(&w, STR(nvec, (long int) to));
+    } else {
+      igraph_i_writer_long(&w, from);
+      IGRAPH_I_WRITER_PUTC(&w, ' ');
+      igraph_i_writer_long(&w, to);
     }
-    igraph_vector_destroy(&wvec);
-    IGRAPH_FINALLY_CLEAN(1);
-  } else {
-    /* Both names and weights */
-    igraph_strvector_t nvec;
-	igraph_vector_t wvec;
-    IGRAPH_VECTOR_INIT_FINALLY(&wvec, igraph_ecount(graph));
-    IGRAPH_CHECK(igraph_strvector_init(&nvec, igraph_vcount(graph)));
-    IGRAPH_FINALLY(igraph_strvector_destroy, &nvec);
-    IGRAPH_CHECK(igraph_i_attribute_get_numeric_edge_attr(graph, weights, 
-							 igraph_ess_all(IGRAPH_EDGEORDER_ID), 
-							 &wvec));
-    IGRAPH_CHECK(igraph_i_attribute_get_string_vertex_attr(graph, names, 
-							   igraph_vss_all(),
-							   &nvec));
-    while (!IGRAPH_EIT_END(it)) {
-      igraph_integer_t edge=IGRAPH_EIT_GET(it);
-      igraph_integer_t from, to;
-      int ret=0, ret2=0;
-      char *str1, *str2;
-      igraph_edge(graph, edge, &from, &to);
-      igraph_strvector_get(&nvec, from, &str1);
-      igraph_strvector_get(&nvec, to, &str2);
-      ret=fprintf(outstream, "%s %s ", str1, str2);
-      if (ret<0) {
-        IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-      }
-      ret=igraph_real_fprintf_precise(outstream, VECTOR(wvec)[(long int)edge]);
-      ret2=fputc('\n', outstream);
-      if (ret < 0 || ret2 == EOF) {
-        IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-      }
-      IGRAPH_EIT_NEXT(it);
+    if (weights) {
+      IGRAPH_I_WRITER_PUTC(&w, ' ');
+      igraph_i_writer_real(&w, VECTOR(wvec)[edge]);
     }
-    igraph_strvector_destroy(&nvec);
-    igraph_vector_destroy(&wvec);
-    IGRAPH_FINALLY_CLEAN(2);
+    IGRAPH_I_WRITER_PUTC(&w, '\n');
   }
-  
-  igraph_eit_destroy(&it);
-  IGRAPH_FINALLY_CLEAN(1);
+
+  IGRAPH_CHECK(igraph_i_writer_finish(&w));
+  igraph_i_writer_destroy(&w);
+  igraph_vector_destroy(&wvec);
+  igraph_strvector_destroy(&nvec);
+  IGRAPH_FINALLY_CLEAN(3);
   return 0;
 }
 
@@ -1688,14 +1771,13 @@ int igraph_write_graph_ncol(const igraph_t *graph, FILE *outstream,
 int igraph_write_graph_lgl(const igraph_t *graph, FILE *outstream,
 			   const char *names, const char *weights,
 			   igraph_bool_t isolates) {
-  igraph_eit_t it;
+  long int no_of_edges=igraph_ecount(graph);
+  long int i;
   long int actvertex=-1;
   igraph_attribute_type_t nametype, weighttype;
+  igraph_strvector_t nvec, wvec;
+  igraph_i_writer_t w;
   
-  IGRAPH_CHECK(igraph_eit_create(graph, igraph_ess_all(IGRAPH_EDGEORDER_FROM),
-				 &it));
-  IGRAPH_FINALLY(igraph_eit_destroy, &it);
-
   /* Check if we have the names attribute */
   if (names && !igraph_i_attribute_has_attr(graph, IGRAPH_ATTRIBUTE_VERTEX,
 					    names)) {
@@ -1727,158 +1809,76 @@ int igraph_write_graph_lgl(const igraph_t *graph, FILE *outstream,
     IGRAPH_WARNING("ignoring weights attribute, unknown attribute type");
     weights=0;
   }
-  
-  if (names==0 && weights==0) {
-    /* No names, no weights */
-    while (!IGRAPH_EIT_END(it)) {
-      igraph_integer_t from, to;
-      int ret;
-      igraph_edge(graph, IGRAPH_EIT_GET(it), &from, &to);
-      if (from==actvertex) {
-	ret=fprintf(outstream, "%li\n", (long int)to);
-      } else {
-	actvertex=from;
-	ret=fprintf(outstream, "# %li\n%li\n", (long int)from, (long int)to);
-      }
-      if (ret<0) {
-	IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-      }
-      IGRAPH_EIT_NEXT(it);
-    }
-  } else if (weights==0) {
-    /* No weights but use names */
-    igraph_strvector_t nvec;
-    IGRAPH_CHECK(igraph_strvector_init(&nvec, igraph_vcount(graph)));
-    IGRAPH_FINALLY(igraph_strvector_destroy, &nvec);
-    IGRAPH_CHECK(igraph_i_attribute_get_string_vertex_attr(graph, names,
+
+  IGRAPH_STRVECTOR_INIT_FINALLY(&nvec, 0);
+  IGRAPH_STRVECTOR_INIT_FINALLY(&wvec, 0);
+  if (names) {
+    IGRAPH_CHECK(igraph_i_attribute_get_string_vertex_attr(graph, names, 
 							   igraph_vss_all(),
 							   &nvec));
-    while (!IGRAPH_EIT_END(it)) {
-      igraph_integer_t edge=IGRAPH_EIT_GET(it);
-      igraph_integer_t from, to;
-      int ret=0;
-      char *str1, *str2;
-      igraph_edge(graph, edge, &from, &to);
-      igraph_strvector_get(&nvec, to, &str2);
-
-      if (from==actvertex) {
-	ret=fprintf(outstream, "%s\n", str2);
-      } else {
-	actvertex=from;
-	igraph_strvector_get(&nvec, from, &str1);
-	ret=fprintf(outstream, "# %s\n%s\n", str1, str2);
-      }
-      if (ret<0) {
-	IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-      }
-      IGRAPH_EIT_NEXT(it);
-    }
-    IGRAPH_FINALLY_CLEAN(1);
-  } else if (names==0) {
-    igraph_strvector_t wvec;
-    IGRAPH_CHECK(igraph_strvector_init(&wvec, igraph_ecount(graph)));
-    IGRAPH_FINALLY(igraph_strvector_destroy, &wvec);
+  }
+  if (weights) {
     IGRAPH_CHECK(igraph_i_attribute_get_string_edge_attr(graph, weights,
 							 igraph_ess_all(IGRAPH_EDGEORDER_ID),
 							 &wvec));
-    /* No names but weights */
-    while (!IGRAPH_EIT_END(it)) {
-      igraph_integer_t edge=IGRAPH_EIT_GET(it);
-      igraph_integer_t from, to;
-      int ret=0;
-      char *str1;
-      igraph_edge(graph, edge, &from, &to);
-      igraph_strvector_get(&wvec, edge, &str1);
-      if (from==actvertex) {
-	ret=fprintf(outstream, "%li %s\n", (long)to, str1);
+  }
+
+  IGRAPH_CHECK(igraph_i_writer_init(&w, outstream));
+  IGRAPH_FINALLY(igraph_i_writer_destroy, &w);
+
+  for (i=0; i<no_of_edges; i++) {
+    long int edge=IGRAPH_I_EDGEORDER_FROM(graph, i);
+    igraph_integer_t from, to;
+    igraph_edge(graph, (igraph_integer_t) edge, &from, &to);
+    if (from != actvertex) {
+      actvertex=from;
+      igraph_i_writer_write(&w, "# ", 2);
+      if (names) {
+	igraph_i_writer_puts(&w, STR(nvec, (long int) from));
       } else {
-	actvertex=from;
-	ret=fprintf(outstream, "# %li\n%li %s\n", (long)from, (long)to, str1);
+	igraph_i_writer_long(&w, from);
       }
-      if (ret<0) {
-	IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-      }
-      IGRAPH_EIT_NEXT(it);
+      IGRAPH_I_WRITER_PUTC(&w, '\n');
     }
-    igraph_strvector_destroy(&wvec);
-    IGRAPH_FINALLY_CLEAN(1);
-  } else {
-    /* Both names and weights */
-    igraph_strvector_t nvec, wvec;
-    IGRAPH_CHECK(igraph_strvector_init(&wvec, igraph_ecount(graph)));
-    IGRAPH_FINALLY(igraph_strvector_destroy, &wvec);
-    IGRAPH_CHECK(igraph_strvector_init(&nvec, igraph_vcount(graph)));
-    IGRAPH_FINALLY(igraph_strvector_destroy, &nvec);
-    IGRAPH_CHECK(igraph_i_attribute_get_string_edge_attr(graph, weights,
-							 igraph_ess_all(IGRAPH_EDGEORDER_ID),
-							 &wvec));
-    IGRAPH_CHECK(igraph_i_attribute_get_string_vertex_attr(graph, names, 
-							   igraph_vss_all(),
-							   &nvec));
-    while (!IGRAPH_EIT_END(it)) {
-      igraph_integer_t edge=IGRAPH_EIT_GET(it);
-      igraph_integer_t from, to;
-      int ret=0;
-      char *str1, *str2, *str3;
-      igraph_edge(graph, edge, &from, &to);
-      igraph_strvector_get(&nvec, to, &str2);
-      igraph_strvector_get(&wvec, edge, &str3);
-      if (from==actvertex) {
-	ret=fprintf(outstream, "%s ", str2);
-      } else {
-	actvertex=from;
-	igraph_strvector_get(&nvec, from, &str1);
-	ret=fprintf(outstream, "# %s\n%s ", str1, str2);
-      }
-      if (ret<0) {
-	IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-      }
-      ret=fprintf(outstream, "%s\n", str3);
-      if (ret<0) {
-	IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
-      }
-      IGRAPH_EIT_NEXT(it);
+    if (names) {
+      igraph_i_writer_puts(&w, STR(nvec, (long int) to));
+    } else {
+      igraph_i_writer_long(&w, to);
     }
-    igraph_strvector_destroy(&nvec);
-    igraph_strvector_destroy(&wvec);
-    IGRAPH_FINALLY_CLEAN(2);
+    if (weights) {
+      IGRAPH_I_WRITER_PUTC(&w, ' ');
+      igraph_i_writer_puts(&w, STR(wvec, edge));
+    }
+    IGRAPH_I_WRITER_PUTC(&w, '\n');
   }
 
   if (isolates) {
     long int nov=igraph_vcount(graph);
-    long int i;
-    int ret=0;
     igraph_vector_t deg;
-    igraph_strvector_t nvec;
-    char *str;
 
-    IGRAPH_VECTOR_INIT_FINALLY(&deg, 1);
-    IGRAPH_CHECK(igraph_strvector_init(&nvec, 1));
-    IGRAPH_FINALLY(igraph_strvector_destroy, &nvec);
+    IGRAPH_VECTOR_INIT_FINALLY(&deg, nov);
+    IGRAPH_CHECK(igraph_degree(graph, &deg, igraph_vss_all(), 
+			       IGRAPH_ALL, IGRAPH_LOOPS));
     for (i=0; i<nov; i++) {
-      igraph_degree(graph, &deg, igraph_vss_1((igraph_integer_t) i), 
-		    IGRAPH_ALL, IGRAPH_LOOPS);
-      if (VECTOR(deg)[0]==0) {
- 	if (names==0) { 
-	  ret=fprintf(outstream, "# %li\n", i);
+      if (VECTOR(deg)[i]==0) {
+	igraph_i_writer_write(&w, "# ", 2);
+	if (names) {
+	  igraph_i_writer_puts(&w, STR(nvec, i));
 	} else {
-	  IGRAPH_CHECK(igraph_i_attribute_get_string_vertex_attr(graph, names,
-				 igraph_vss_1((igraph_integer_t) i), &nvec));
-	  igraph_strvector_get(&nvec, 0, &str);
-	  ret=fprintf(outstream, "# %s\n", str);
+	  igraph_i_writer_long(&w, i);
 	}
-      }
-      if (ret<0) {
-	IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
+	IGRAPH_I_WRITER_PUTC(&w, '\n');
       }
     }
-    igraph_strvector_destroy(&nvec);
     igraph_vector_destroy(&deg);
-    IGRAPH_FINALLY_CLEAN(2);
+    IGRAPH_FINALLY_CLEAN(1);
   }  
   
-  igraph_eit_destroy(&it);
-  IGRAPH_FINALLY_CLEAN(1);
+  IGRAPH_CHECK(igraph_i_writer_finish(&w));
+  igraph_i_writer_destroy(&w);
+  igraph_strvector_destroy(&wvec);
+  igraph_strvector_destroy(&nvec);
+  IGRAPH_FINALLY_CLEAN(3);
   return 0;
 }
 
@@ -1940,61 +1940,22 @@ int igraph_write_graph_lgl(const igraph_t *graph, FILE *outstream,
 #define E_COLOR            22
 #define E_LAST             23
 
-int igraph_i_pajek_escape(char* src, char** dest) {
-  long int destlen=0;
-  igraph_bool_t need_escape=0;
-
-  /* Determine whether the string contains characters to be escaped */
-  char *s, *d;
-  for (s=src; *s; s++, destlen++) {
-    if (*s == '\\') {
-      need_escape = 1;
-      destlen++;
-    } else if (*s == '"') {
-      need_escape = 1;
-      destlen++;
-    } else if (!isalnum(*s)) {
-      need_escape = 1;
-    }
-  }
-
-  if (!need_escape) {
-    /* At this point, we know that the string does not contain any chars
-     * that would warrant escaping. Therefore, we simply quote it and
-     * return the quoted string. This is necessary because Pajek uses some
-     * reserved words in its format (like 'c' standing for color) and they
-     * have to be quoted as well.
-     */
-    *dest=igraph_Calloc(destlen+3, char);
-    if (!*dest)
-      IGRAPH_ERROR("Not enough memory", IGRAPH_ENOMEM);
-
-    d = *dest;
-    strcpy(d+1, src);
-    d[0] = d[destlen+1] = '"';
-    d[destlen+2] = 0;
-    return IGRAPH_SUCCESS;
-  }
-
-  *dest=igraph_Calloc(destlen+3, char);
-  if (!*dest)
-    IGRAPH_ERROR("Not enough memory", IGRAPH_ENOMEM);
-
-  d=*dest;
-  *d='"'; d++;
-
-  for (s=src; *s; s++, d++) {
-    switch (*s) {
-    case '\\':
-    case '"':
-      *d = '\\'; d++;
-    default:
-      *d = *s;
+/* Strings are always quoted, because Pajek uses some reserved words
+   in its format (like 'c' standing for color) and they have to be
+   quoted as well. Backslashes and quotes are escaped. */
+
+void igraph_i_pajek_write_escaped(igraph_i_writer_t *w, const char *src) {
+  const char *s, *run;
+  IGRAPH_I_WRITER_PUTC(w, '"');
+  for (s=run=src; *s; s++) {
+    if (*s == '\\' || *s == '"') {
+      igraph_i_writer_write(w, run, (size_t) (s-run));
+      IGRAPH_I_WRITER_PUTC(w, '\\');
+      run=s;
     }
   }
-  *d='"'; d++; *d=0;
-
-  return IGRAPH_SUCCESS;
+  igraph_i_writer_write(w, run, (size_t) (s-run));
+  IGRAPH_I_WRITER_PUTC(w, '"');
 }
 
 /**
@@ -2038,6 +1999,7 @@ int igraph_i_pajek_escape(char* src, char** dest) {
 
 int igraph_write_graph_pajek(const igraph_t *graph, FILE *outstream) {
   long int no_of_nodes=igraph_vcount(graph);
+  long int no_of_edges=igraph_ecount(graph);
   long int i, j;
 
   igraph_attribute_type_t vtypes[V_LAST], etypes[E_LAST];
@@ -2081,27 +2043,23 @@ int igraph_write_graph_pajek(const igraph_t *graph, FILE *outstream) {
 
   const char *newline="\x0d\x0a";
   
-  igraph_es_t es;
-  igraph_eit_t eit;
-
-  igraph_vector_t numv;
-  igraph_strvector_t strv;
-
   igraph_vector_t ex_numa;
   igraph_vector_t ex_stra;
   igraph_vector_t vx_numa;
   igraph_vector_t vx_stra;
-  
-  char *s, *escaped;
+
+  igraph_strvector_t vcolnames, ecolnames;
+  igraph_vector_t vcoltypes, ecoltypes;
+  igraph_vector_ptr_t vcols, ecols;
+  igraph_i_attr_column_t **vc, **ec;
+  long int vnuma, vstra, enuma, estra;
+  igraph_i_writer_t w;
   
   igraph_bool_t bipartite=0;
   igraph_vector_int_t bip_index, bip_index2;
   igraph_vector_bool_t bvec;
   long int notop=0, nobottom=0;
 
-  IGRAPH_VECTOR_INIT_FINALLY(&numv, 1);
-  IGRAPH_STRVECTOR_INIT_FINALLY(&strv, 1);
-
   IGRAPH_VECTOR_INIT_FINALLY(&ex_numa, 0);
   IGRAPH_VECTOR_INIT_FINALLY(&ex_stra, 0);
   IGRAPH_VECTOR_INIT_FINALLY(&vx_numa, 0);
@@ -2121,21 +2079,18 @@ int igraph_write_graph_pajek(const igraph_t *graph, FILE *outstream) {
       IGRAPH_FINALLY(igraph_vector_int_destroy, &bip_index);
       IGRAPH_CHECK(igraph_vector_int_init(&bip_index2, no_of_nodes));
       IGRAPH_FINALLY(igraph_vector_int_destroy, &bip_index2);
-      IGRAPH_CHECK(igraph_vector_bool_init(&bvec, 1));
-      IGRAPH_FINALLY(igraph_vector_bool_destroy, &bvec);
+      IGRAPH_VECTOR_BOOL_INIT_FINALLY(&bvec, no_of_nodes);
+      IGRAPH_CHECK(igraph_i_attribute_get_bool_vertex_attr(graph, 
+		     "type", igraph_vss_all(), &bvec));
       for (i=0; i<no_of_nodes; i++) {
-	IGRAPH_CHECK(igraph_i_attribute_get_bool_vertex_attr(graph, 
-		     "type", igraph_vss_1((igraph_integer_t) i), &bvec));
-	if (VECTOR(bvec)[0]) { 
+	if (VECTOR(bvec)[i]) { 
 	  notop++; 
 	} else {
 	  nobottom++;
 	}
       }
       for (i=0, bptr=0, tptr=(int) nobottom; i<no_of_nodes; i++) {
-	IGRAPH_CHECK(igraph_i_attribute_get_bool_vertex_attr(graph, 
-		     "type", igraph_vss_1((igraph_integer_t) i), &bvec));
-	if (VECTOR(bvec)[0]) { 
+	if (VECTOR(bvec)[i]) { 
 	  VECTOR(bip_index)[tptr] = (int) i;
 	  VECTOR(bip_index2)[i] = tptr;
 	  tptr++;
@@ -2150,18 +2105,6 @@ int igraph_write_graph_pajek(const igraph_t *graph, FILE *outstream) {
     }
   }
 
-  /* Write header */
-  if (bipartite) {
-    if (fprintf(outstream, "*Vertices %li %li%s", no_of_nodes, nobottom, 
-		newline) < 0) {
-      IGRAPH_ERROR("Cannot write pajek file", IGRAPH_EFILE);
-    }
-  } else {
-    if (fprintf(outstream, "*Vertices %li%s", no_of_nodes, newline) < 0) {
-      IGRAPH_ERROR("Cannot write pajek file", IGRAPH_EFILE);
-    }
-  }
-
   /* Check the vertex attributes */
   memset(vtypes, 0, sizeof(vtypes[0])*V_LAST);
   for (i=0; i<V_LAST; i++) {
@@ -2197,174 +2140,241 @@ int igraph_write_graph_pajek(const igraph_t *graph, FILE *outstream) {
     }
   }
 
+  /* Check edge attributes */
+  for (i=0; i<E_LAST; i++) {
+    if (igraph_i_attribute_has_attr(graph, IGRAPH_ATTRIBUTE_EDGE,
+				    enames[i])) {
+      igraph_i_attribute_gettype(graph, &etypes[i], IGRAPH_ATTRIBUTE_EDGE,
+				 enames[i]);
+    } else {
+      etypes[i]=(igraph_attribute_type_t) -1;
+    }
+  }
+  for (i=0; i< (long int) (sizeof(enumnames)/sizeof(const char*)); i++) {
+    igraph_attribute_type_t type;
+    if (igraph_i_attribute_has_attr(graph, IGRAPH_ATTRIBUTE_EDGE, 
+				    enumnames[i])) {
+      igraph_i_attribute_gettype(graph, &type, IGRAPH_ATTRIBUTE_EDGE, 
+				 enumnames[i]);
+      if (type==IGRAPH_ATTRIBUTE_NUMERIC) {
+	IGRAPH_CHECK(igraph_vector_push_back(&ex_numa, i));
+      }
+    }
+  }
+  for (i=0; i< (long int) (sizeof(estrnames)/sizeof(const char*)); i++) {
+    igraph_attribute_type_t type;
+    if (igraph_i_attribute_has_attr(graph, IGRAPH_ATTRIBUTE_EDGE, 
+				    estrnames[i])) {
+      igraph_i_attribute_gettype(graph, &type, IGRAPH_ATTRIBUTE_EDGE, 
+				 estrnames[i]);
+      if (type==IGRAPH_ATTRIBUTE_STRING) {
+	IGRAPH_CHECK(igraph_vector_push_back(&ex_stra, i));
+      }
+    }
+  }
+
+  /* The attribute columns: the vertex id, coordinates and shape, 
+     then the numeric and the string parameters. For the edges the
+     weight comes first. */
+  vnuma=igraph_vector_size(&vx_numa); vstra=igraph_vector_size(&vx_stra);
+  enuma=igraph_vector_size(&ex_numa); estra=igraph_vector_size(&ex_stra);
+  IGRAPH_STRVECTOR_INIT_FINALLY(&vcolnames, 0);
+  IGRAPH_VECTOR_INIT_FINALLY(&vcoltypes, 0);
+  for (i=V_ID; i<=V_SHAPE; i++) {
+    IGRAPH_CHECK(igraph_strvector_add(&vcolnames, vnames[i]));
+    IGRAPH_CHECK(igraph_vector_push_back(&vcoltypes, vtypes[i]));
+  }
+  for (j=0; j<vnuma; j++) {
+    IGRAPH_CHECK(igraph_strvector_add(&vcolnames, 
+			      vnumnames[(long int) VECTOR(vx_numa)[j]]));
+    IGRAPH_CHECK(igraph_vector_push_back(&vcoltypes, 
+					 IGRAPH_ATTRIBUTE_NUMERIC));
+  }
+  for (j=0; j<vstra; j++) {
+    IGRAPH_CHECK(igraph_strvector_add(&vcolnames, 
+			      vstrnames[(long int) VECTOR(vx_stra)[j]]));
+    IGRAPH_CHECK(igraph_vector_push_back(&vcoltypes, 
+					 IGRAPH_ATTRIBUTE_STRING));
+  }
+  IGRAPH_STRVECTOR_INIT_FINALLY(&ecolnames, 0);
+  IGRAPH_VECTOR_INIT_FINALLY(&ecoltypes, 0);
+  IGRAPH_CHECK(igraph_strvector_add(&ecolnames, enames[E_WEIGHT]));
+  IGRAPH_CHECK(igraph_vector_push_back(&ecoltypes, etypes[E_WEIGHT]));
+  for (j=0; j<enuma; j++) {
+    IGRAPH_CHECK(igraph_strvector_add(&ecolnames, 
+			      enumnames[(long int) VECTOR(ex_numa)[j]]));
+    IGRAPH_CHECK(igraph_vector_push_back(&ecoltypes, 
+					 IGRAPH_ATTRIBUTE_NUMERIC));
+  }
+  for (j=0; j<estra; j++) {
+    IGRAPH_CHECK(igraph_strvector_add(&ecolnames, 
+			      estrnames[(long int) VECTOR(ex_stra)[j]]));
+    IGRAPH_CHECK(igraph_vector_push_back(&ecoltypes, 
+					 IGRAPH_ATTRIBUTE_STRING));
+  }
+
+  /* Bipartite graphs visit the vertices out of order, so their
+     vertex attributes are queried at once */
+  IGRAPH_CHECK(igraph_vector_ptr_init(&vcols, 0));
+  IGRAPH_FINALLY(igraph_vector_ptr_destroy_all, &vcols);
+  IGRAPH_CHECK(igraph_i_attr_columns_init(&vcols, graph, 
+			  IGRAPH_ATTRIBUTE_VERTEX, &vcolnames, &vcoltypes,
+			  bipartite ? 0 : IGRAPH_I_ATTR_COLUMN_CHUNK));
+  IGRAPH_CHECK(igraph_vector_ptr_init(&ecols, 0));
+  IGRAPH_FINALLY(igraph_vector_ptr_destroy_all, &ecols);
+  IGRAPH_CHECK(igraph_i_attr_columns_init(&ecols, graph, 
+			  IGRAPH_ATTRIBUTE_EDGE, &ecolnames, &ecoltypes,
+			  IGRAPH_I_ATTR_COLUMN_CHUNK));
+  vc=(igraph_i_attr_column_t **) VECTOR(vcols);
+  ec=(igraph_i_attr_column_t **) VECTOR(ecols);
+
+  IGRAPH_CHECK(igraph_i_writer_init(&w, outstream));
+  IGRAPH_FINALLY(igraph_i_writer_destroy, &w);
+
+  /* Write header */
+  igraph_i_writer_puts(&w, "*Vertices ");
+  igraph_i_writer_long(&w, no_of_nodes);
+  if (bipartite) {
+    IGRAPH_I_WRITER_PUTC(&w, ' ');
+    igraph_i_writer_long(&w, nobottom);
+  }
+  igraph_i_writer_puts(&w, newline);
+
   /* Write vertices */
   if (write_vertex_attrs) {
     for (i=0; i<no_of_nodes; i++) {
       long int id=bipartite ? VECTOR(bip_index)[i] : i;
       
       /* vertex id */
-      fprintf(outstream, "%li", i+1);
+      igraph_i_writer_long(&w, i+1);
       if (vtypes[V_ID] == IGRAPH_ATTRIBUTE_NUMERIC) {
-	igraph_i_attribute_get_numeric_vertex_attr(graph, vnames[V_ID], 
-				   igraph_vss_1((igraph_integer_t) id), &numv);
-	fputs(" \"", outstream);
-	igraph_real_fprintf_precise(outstream, VECTOR(numv)[0]);
-	fputc('"', outstream);
+	IGRAPH_CHECK(igraph_i_attr_column_fetch(vc[V_ID], id));
+	igraph_i_writer_write(&w, " \"", 2);
+	igraph_i_writer_real(&w, IGRAPH_I_ATTR_COLUMN_NUM(vc[V_ID], id));
+	IGRAPH_I_WRITER_PUTC(&w, '"');
       } else if (vtypes[V_ID] == IGRAPH_ATTRIBUTE_STRING) {
-	igraph_i_attribute_get_string_vertex_attr(graph, vnames[V_ID],
-				  igraph_vss_1((igraph_integer_t) id), &strv);
-	igraph_strvector_get(&strv, 0, &s);
-	IGRAPH_CHECK(igraph_i_pajek_escape(s, &escaped));
-	fprintf(outstream, " %s", escaped);
-	igraph_Free(escaped);
+	IGRAPH_CHECK(igraph_i_attr_column_fetch(vc[V_ID], id));
+	IGRAPH_I_WRITER_PUTC(&w, ' ');
+	igraph_i_pajek_write_escaped(&w, 
+			     IGRAPH_I_ATTR_COLUMN_STR(vc[V_ID], id));
       } else {
-	fprintf(outstream, " \"%li\"", id+1);
+	igraph_i_writer_write(&w, " \"", 2);
+	igraph_i_writer_long(&w, id+1);
+	IGRAPH_I_WRITER_PUTC(&w, '"');
       }
       
       /* coordinates */
       if (vtypes[V_X] == IGRAPH_ATTRIBUTE_NUMERIC &&
 	  vtypes[V_Y] == IGRAPH_ATTRIBUTE_NUMERIC) {
-	igraph_i_attribute_get_numeric_vertex_attr(graph, vnames[V_X], 
-				   igraph_vss_1((igraph_integer_t) id), &numv);
-	fputc(' ', outstream);
-	igraph_real_fprintf_precise(outstream, VECTOR(numv)[0]);
-	igraph_i_attribute_get_numeric_vertex_attr(graph, vnames[V_Y], 
-				   igraph_vss_1((igraph_integer_t) id), &numv);
-	fputc(' ', outstream);
-	igraph_real_fprintf_precise(outstream, VECTOR(numv)[0]);
+	IGRAPH_CHECK(igraph_i_attr_column_fetch(vc[V_X], id));
+	IGRAPH_CHECK(igraph_i_attr_column_fetch(vc[V_Y], id));
+	IGRAPH_I_WRITER_PUTC(&w, ' ');
+	igraph_i_writer_real(&w, IGRAPH_I_ATTR_COLUMN_NUM(vc[V_X], id));
+	IGRAPH_I_WRITER_PUTC(&w, ' ');
+	igraph_i_writer_real(&w, IGRAPH_I_ATTR_COLUMN_NUM(vc[V_Y], id));
 	if (vtypes[V_Z] == IGRAPH_ATTRIBUTE_NUMERIC) {
-	  igraph_i_attribute_get_numeric_vertex_attr(graph, vnames[V_Z], 
-				   igraph_vss_1((igraph_integer_t) id), &numv);
-	  fputc(' ', outstream);
-	  igraph_real_fprintf_precise(outstream, VECTOR(numv)[0]);
+	  IGRAPH_CHECK(igraph_i_attr_column_fetch(vc[V_Z], id));
+	  IGRAPH_I_WRITER_PUTC(&w, ' ');
+	  igraph_i_writer_real(&w, IGRAPH_I_ATTR_COLUMN_NUM(vc[V_Z], id));
 	}
       }
       
       /* shape */
       if (vtypes[V_SHAPE] == IGRAPH_ATTRIBUTE_STRING) {
-	igraph_i_attribute_get_string_vertex_attr(graph, vnames[V_SHAPE],
-				  igraph_vss_1((igraph_integer_t) id), &strv);
-	igraph_strvector_get(&strv, 0, &s);
-	IGRAPH_CHECK(igraph_i_pajek_escape(s, &escaped));
-	fprintf(outstream, " %s", escaped);
-	igraph_Free(escaped);
+	IGRAPH_CHECK(igraph_i_attr_column_fetch(vc[V_SHAPE], id));
+	IGRAPH_I_WRITER_PUTC(&w, ' ');
+	igraph_i_pajek_write_escaped(&w, 
+			     IGRAPH_I_ATTR_COLUMN_STR(vc[V_SHAPE], id));
       }
       
       /* numeric parameters */
-      for (j=0; j<igraph_vector_size(&vx_numa); j++) {
+      for (j=0; j<vnuma; j++) {
 	int idx=(int) VECTOR(vx_numa)[j];
-	igraph_i_attribute_get_numeric_vertex_attr(graph, vnumnames[idx],
-				   igraph_vss_1((igraph_integer_t) id), &numv);
-	fprintf(outstream, " %s ", vnumnames2[idx]);
-	igraph_real_fprintf_precise(outstream, VECTOR(numv)[0]);
+	igraph_i_attr_column_t *col=vc[V_SHAPE+1+j];
+	IGRAPH_CHECK(igraph_i_attr_column_fetch(col, id));
+	IGRAPH_I_WRITER_PUTC(&w, ' ');
+	igraph_i_writer_puts(&w, vnumnames2[idx]);
+	IGRAPH_I_WRITER_PUTC(&w, ' ');
+	igraph_i_writer_real(&w, IGRAPH_I_ATTR_COLUMN_NUM(col, id));
       }
 
       /* string parameters */
-      for (j=0; j<igraph_vector_size(&vx_stra); j++) {
+      for (j=0; j<vstra; j++) {
 	int idx=(int) VECTOR(vx_stra)[j];
-	igraph_i_attribute_get_string_vertex_attr(graph, vstrnames[idx],
-				  igraph_vss_1((igraph_integer_t) id), &strv);
-	igraph_strvector_get(&strv, 0, &s);
-	IGRAPH_CHECK(igraph_i_pajek_escape(s, &escaped));
-	fprintf(outstream, " %s %s", vstrnames2[idx], escaped);
-	igraph_Free(escaped);
+	igraph_i_attr_column_t *col=vc[V_SHAPE+1+vnuma+j];
+	IGRAPH_CHECK(igraph_i_attr_column_fetch(col, id));
+	IGRAPH_I_WRITER_PUTC(&w, ' ');
+	igraph_i_writer_puts(&w, vstrnames2[idx]);
+	IGRAPH_I_WRITER_PUTC(&w, ' ');
+	igraph_i_pajek_write_escaped(&w, IGRAPH_I_ATTR_COLUMN_STR(col, id));
       }      
       
       /* trailing newline */
-      fprintf(outstream, "%s", newline);
+      igraph_i_writer_puts(&w, newline);
     }
   }
 
   /* edges header */
   if (igraph_is_directed(graph)) {
-    fprintf(outstream, "*Arcs%s", newline);
+    igraph_i_writer_puts(&w, "*Arcs");
   } else {
-    fprintf(outstream, "*Edges%s", newline);
+    igraph_i_writer_puts(&w, "*Edges");
   }
+  igraph_i_writer_puts(&w, newline);
   
-  IGRAPH_CHECK(igraph_es_all(&es, IGRAPH_EDGEORDER_ID));
-  IGRAPH_FINALLY(igraph_es_destroy, &es);
-  IGRAPH_CHECK(igraph_eit_create(graph, es, &eit));
-  IGRAPH_FINALLY(igraph_eit_destroy, &eit);
-
-  /* Check edge attributes */
-  for (i=0; i<E_LAST; i++) {
-    if (igraph_i_attribute_has_attr(graph, IGRAPH_ATTRIBUTE_EDGE,
-				    enames[i])) {
-      igraph_i_attribute_gettype(graph, &etypes[i], IGRAPH_ATTRIBUTE_EDGE,
-				 enames[i]);
-    } else {
-      etypes[i]=(igraph_attribute_type_t) -1;
-    }
-  }
-  for (i=0; i< (long int) (sizeof(enumnames)/sizeof(const char*)); i++) {
-    igraph_attribute_type_t type;
-    if (igraph_i_attribute_has_attr(graph, IGRAPH_ATTRIBUTE_EDGE, 
-				    enumnames[i])) {
-      igraph_i_attribute_gettype(graph, &type, IGRAPH_ATTRIBUTE_EDGE, 
-				 enumnames[i]);
-      if (type==IGRAPH_ATTRIBUTE_NUMERIC) {
-	IGRAPH_CHECK(igraph_vector_push_back(&ex_numa, i));
-      }
-    }
-  }
-  for (i=0; i< (long int) (sizeof(estrnames)/sizeof(const char*)); i++) {
-    igraph_attribute_type_t type;
-    if (igraph_i_attribute_has_attr(graph, IGRAPH_ATTRIBUTE_EDGE, 
-				    estrnames[i])) {
-      igraph_i_attribute_gettype(graph, &type, IGRAPH_ATTRIBUTE_EDGE, 
-				 estrnames[i]);
-      if (type==IGRAPH_ATTRIBUTE_STRING) {
-	IGRAPH_CHECK(igraph_vector_push_back(&ex_stra, i));
-      }
-    }
-  }
-  
-  for (i=0; !IGRAPH_EIT_END(eit); IGRAPH_EIT_NEXT(eit), i++) {
-    long int edge=IGRAPH_EIT_GET(eit);
+  for (i=0; i<no_of_edges; i++) {
     igraph_integer_t from, to;
-    igraph_edge(graph, (igraph_integer_t) edge, &from,  &to);
+    igraph_edge(graph, (igraph_integer_t) i, &from,  &to);
     if (bipartite) { 
-      from=VECTOR(bip_index2)[from];
-      to  =VECTOR(bip_index2)[to];
+      from=VECTOR(bip_index2)[(long int) from];
+      to  =VECTOR(bip_index2)[(long int) to];
     }
-    fprintf(outstream, "%li %li", (long int) from+1, (long int) to+1);
+    igraph_i_writer_long(&w, (long int) from+1);
+    IGRAPH_I_WRITER_PUTC(&w, ' ');
+    igraph_i_writer_long(&w, (long int) to+1);
     
     /* Weights */
     if (etypes[E_WEIGHT] == IGRAPH_ATTRIBUTE_NUMERIC) {
-      igraph_i_attribute_get_numeric_edge_attr(graph, enames[E_WEIGHT],
-			       igraph_ess_1((igraph_integer_t) edge), &numv);
-      fputc(' ', outstream);
-      igraph_real_fprintf_precise(outstream, VECTOR(numv)[0]);
+      IGRAPH_CHECK(igraph_i_attr_column_fetch(ec[0], i));
+      IGRAPH_I_WRITER_PUTC(&w, ' ');
+      igraph_i_writer_real(&w, IGRAPH_I_ATTR_COLUMN_NUM(ec[0], i));
     }
     
     /* numeric parameters */
-    for (j=0; j<igraph_vector_size(&ex_numa); j++) {
+    for (j=0; j<enuma; j++) {
       int idx=(int) VECTOR(ex_numa)[j];
-      igraph_i_attribute_get_numeric_edge_attr(graph, enumnames[idx],
-			       igraph_ess_1((igraph_integer_t) edge), &numv);
-      fprintf(outstream, " %s ", enumnames2[idx]);
-      igraph_real_fprintf_precise(outstream, VECTOR(numv)[0]);
+      igraph_i_attr_column_t *col=ec[1+j];
+      IGRAPH_CHECK(igraph_i_attr_column_fetch(col, i));
+      IGRAPH_I_WRITER_PUTC(&w, ' ');
+      igraph_i_writer_puts(&w, enumnames2[idx]);
+      IGRAPH_I_WRITER_PUTC(&w, ' ');
+      igraph_i_writer_real(&w, IGRAPH_I_ATTR_COLUMN_NUM(col, i));
     }
     
     /* string parameters */
-    for (j=0; j<igraph_vector_size(&ex_stra); j++) {
+    for (j=0; j<estra; j++) {
       int idx=(int) VECTOR(ex_stra)[j];
-      igraph_i_attribute_get_string_edge_attr(graph, estrnames[idx],
-			      igraph_ess_1((igraph_integer_t) edge), &strv);
-      igraph_strvector_get(&strv, 0, &s);
-      IGRAPH_CHECK(igraph_i_pajek_escape(s, &escaped));
-      fprintf(outstream, " %s %s", estrnames2[idx], escaped);
-      igraph_Free(escaped);
+      igraph_i_attr_column_t *col=ec[1+enuma+j];
+      IGRAPH_CHECK(igraph_i_attr_column_fetch(col, i));
+      IGRAPH_I_WRITER_PUTC(&w, ' ');
+      igraph_i_writer_puts(&w, estrnames2[idx]);
+      IGRAPH_I_WRITER_PUTC(&w, ' ');
+      igraph_i_pajek_write_escaped(&w, IGRAPH_I_ATTR_COLUMN_STR(col, i));
     }
 
     /* trailing newline */
-    fprintf(outstream, "%s", newline);
+    igraph_i_writer_puts(&w, newline);
   }
 
-  igraph_eit_destroy(&eit);
-  igraph_es_destroy(&es);
-  IGRAPH_FINALLY_CLEAN(2);
+  IGRAPH_CHECK(igraph_i_writer_finish(&w));
+  igraph_i_writer_destroy(&w);
+  igraph_vector_ptr_destroy_all(&ecols);
+  igraph_vector_ptr_destroy_all(&vcols);
+  igraph_vector_destroy(&ecoltypes);
+  igraph_strvector_destroy(&ecolnames);
+  igraph_vector_destroy(&vcoltypes);
+  igraph_strvector_destroy(&vcolnames);
+  IGRAPH_FINALLY_CLEAN(7);
 
   if (bipartite) {
     igraph_vector_int_destroy(&bip_index2);
@@ -2376,9 +2386,7 @@ int igraph_write_graph_pajek(const igraph_t *graph, FILE *outstream) {
   igraph_vector_destroy(&ex_stra);
   igraph_vector_destroy(&vx_numa);
   igraph_vector_destroy(&vx_stra);
-  igraph_strvector_destroy(&strv);
-  igraph_vector_destroy(&numv);
-  IGRAPH_FINALLY_CLEAN(6);
+  IGRAPH_FINALLY_CLEAN(4);
   return 0;
 }
 
@@ -2483,6 +2491,43 @@ int igraph_i_gml_convert_to_key(const char *orig, char **key) {
   return 0;
 }
 
+int igraph_i_gml_convert_to_keys(const igraph_strvector_t *names,
+				 igraph_strvector_t *keys) {
+  long int i, n=igraph_strvector_size(names);
+  for (i=0; i<n; i++) {
+    char *newname;
+    IGRAPH_CHECK(igraph_i_gml_convert_to_key(STR(*names, i), &newname));
+    IGRAPH_FINALLY(igraph_free, newname);
+    IGRAPH_CHECK(igraph_strvector_add(keys, newname));
+    igraph_Free(newname);
+    IGRAPH_FINALLY_CLEAN(1);
+  }
+  return 0;
+}
+
+/* Writes a '    key value' line for element 'idx' of an attribute
+   column. */
+
+int igraph_i_gml_write_attr(igraph_i_writer_t *w, 
+			    igraph_i_attr_column_t *col,
+			    const char *key, long int idx) {
+  IGRAPH_CHECK(igraph_i_attr_column_fetch(col, idx));
+  igraph_i_writer_puts(w, "    ");
+  igraph_i_writer_puts(w, key);
+  IGRAPH_I_WRITER_PUTC(w, ' ');
+  if (col->type == IGRAPH_ATTRIBUTE_NUMERIC) {
+    igraph_i_writer_real(w, IGRAPH_I_ATTR_COLUMN_NUM(col, idx));
+  } else if (col->type == IGRAPH_ATTRIBUTE_STRING) { 
+    IGRAPH_I_WRITER_PUTC(w, '"');
+    igraph_i_writer_puts(w, IGRAPH_I_ATTR_COLUMN_STR(col, idx));
+    IGRAPH_I_WRITER_PUTC(w, '"');
+  } else {
+    IGRAPH_I_WRITER_PUTC(w, IGRAPH_I_ATTR_COLUMN_BOOL(col, idx) ? '1' : '0');
+  }
+  IGRAPH_I_WRITER_PUTC(w, '\n');
+  return 0;
+}
+
 #define CHECK(cmd) do { ret=cmd; if (ret<0) IGRAPH_ERROR("Write failed", IGRAPH_EFILE); } while (0)
 
 /** 
@@ -2537,13 +2582,16 @@ int igraph_i_gml_convert_to_key(const char *orig, char **key) {
 
 int igraph_write_graph_gml(const igraph_t *graph, FILE *outstream, 
 			   const igraph_vector_t *id, const char *creator) {
-  int ret;
   igraph_strvector_t gnames, vnames, enames;
   igraph_vector_t gtypes, vtypes, etypes;
+  igraph_strvector_t gkeys, vkeys, ekeys;
+  igraph_vector_ptr_t vcols, ecols;
+  igraph_i_attr_column_t **vc, **ec;
   igraph_vector_t numv;
   igraph_strvector_t strv;
   igraph_vector_bool_t boolv;
-  long int i;
+  igraph_i_writer_t w;
+  long int i, j;
   long int no_of_nodes=igraph_vcount(graph);
   long int no_of_edges=igraph_ecount(graph);
 
@@ -2554,10 +2602,6 @@ int igraph_write_graph_gml(const igraph_t *graph, FILE *outstream,
   char *timestr=ctime(&curtime);
   timestr[strlen(timestr)-1]='\0'; /* nicely remove \n */
   
-  CHECK(fprintf(outstream, 
-		"Creator \"igraph version %s %s\"\nVersion 1\ngraph\n[\n", 
-		PACKAGE_VERSION, creator ? creator : timestr));
-  
   IGRAPH_STRVECTOR_INIT_FINALLY(&gnames, 0);
   IGRAPH_STRVECTOR_INIT_FINALLY(&vnames, 0);
   IGRAPH_STRVECTOR_INIT_FINALLY(&enames, 0);
@@ -2573,6 +2617,27 @@ int igraph_write_graph_gml(const igraph_t *graph, FILE *outstream,
   IGRAPH_STRVECTOR_INIT_FINALLY(&strv, 1);
   IGRAPH_VECTOR_BOOL_INIT_FINALLY(&boolv, 1);
 
+  /* The keys are the attribute names, simplified */
+  IGRAPH_STRVECTOR_INIT_FINALLY(&gkeys, 0);
+  IGRAPH_STRVECTOR_INIT_FINALLY(&vkeys, 0);
+  IGRAPH_STRVECTOR_INIT_FINALLY(&ekeys, 0);
+  IGRAPH_CHECK(igraph_i_gml_convert_to_keys(&gnames, &gkeys));
+  IGRAPH_CHECK(igraph_i_gml_convert_to_keys(&vnames, &vkeys));
+  IGRAPH_CHECK(igraph_i_gml_convert_to_keys(&enames, &ekeys));
+
+  IGRAPH_CHECK(igraph_vector_ptr_init(&vcols, 0));
+  IGRAPH_FINALLY(igraph_vector_ptr_destroy_all, &vcols);
+  IGRAPH_CHECK(igraph_i_attr_columns_init(&vcols, graph, 
+			  IGRAPH_ATTRIBUTE_VERTEX, &vnames, &vtypes,
+			  IGRAPH_I_ATTR_COLUMN_CHUNK));
+  IGRAPH_CHECK(igraph_vector_ptr_init(&ecols, 0));
+  IGRAPH_FINALLY(igraph_vector_ptr_destroy_all, &ecols);
+  IGRAPH_CHECK(igraph_i_attr_columns_init(&ecols, graph, 
+			  IGRAPH_ATTRIBUTE_EDGE, &enames, &etypes,
+			  IGRAPH_I_ATTR_COLUMN_CHUNK));
+  vc=(igraph_i_attr_column_t **) VECTOR(vcols);
+  ec=(igraph_i_attr_column_t **) VECTOR(ecols);
+
   /* Check whether there is an 'id' node attribute if the supplied is 0 */
   if (!id) {
     igraph_bool_t found=0; 
@@ -2592,123 +2657,113 @@ int igraph_write_graph_gml(const igraph_t *graph, FILE *outstream,
     }
   }      
 
+  IGRAPH_CHECK(igraph_i_writer_init(&w, outstream));
+  IGRAPH_FINALLY(igraph_i_writer_destroy, &w);
+
+  igraph_i_writer_printf(&w, 
+		"Creator \"igraph version %s %s\"\nVersion 1\ngraph\n[\n", 
+		PACKAGE_VERSION, creator ? creator : timestr);
+
   /* directedness */
-  CHECK(fprintf(outstream, "  directed %i\n", igraph_is_directed(graph) ? 1 : 0));
+  igraph_i_writer_printf(&w, "  directed %i\n", 
+			 igraph_is_directed(graph) ? 1 : 0);
 
   /* Graph attributes first */
   for (i=0; i<igraph_vector_size(&gtypes); i++) {
-    char *name, *newname;
-    igraph_strvector_get(&gnames, i, &name);
-    IGRAPH_CHECK(igraph_i_gml_convert_to_key(name, &newname));
+    const char *name=STR(gnames, i), *newname=STR(gkeys, i);
     if (VECTOR(gtypes)[i] == IGRAPH_ATTRIBUTE_NUMERIC) {
       IGRAPH_CHECK(igraph_i_attribute_get_numeric_graph_attr(graph, name, &numv));
-      CHECK(fprintf(outstream, "  %s ", newname));
-      CHECK(igraph_real_fprintf_precise(outstream, VECTOR(numv)[0]));
-      CHECK(fputc('\n', outstream));
+      igraph_i_writer_printf(&w, "  %s ", newname);
+      igraph_i_writer_real(&w, VECTOR(numv)[0]);
+      IGRAPH_I_WRITER_PUTC(&w, '\n');
     } else if (VECTOR(gtypes)[i] == IGRAPH_ATTRIBUTE_STRING) {
       char *s;
       IGRAPH_CHECK(igraph_i_attribute_get_string_graph_attr(graph, name, &strv));
       igraph_strvector_get(&strv, 0, &s);
-      CHECK(fprintf(outstream, "  %s \"%s\"\n", newname, s));
+      igraph_i_writer_printf(&w, "  %s \"%s\"\n", newname, s);
     } else if (VECTOR(gtypes)[i] == IGRAPH_ATTRIBUTE_BOOLEAN) {
       IGRAPH_CHECK(igraph_i_attribute_get_bool_graph_attr(graph, name, &boolv));
-      CHECK(fprintf(outstream, "  %s %d\n", newname, VECTOR(boolv)[0] ? 1 : 0));
+      igraph_i_writer_printf(&w, "  %s %d\n", newname, 
+			     VECTOR(boolv)[0] ? 1 : 0);
       IGRAPH_WARNING("A boolean graph attribute was converted to numeric");
     } else {
       IGRAPH_WARNING("A non-numeric, non-string, non-boolean graph attribute ignored");
     }
-    igraph_Free(newname);
   } 
   
+  /* The vertex and edge attributes are only checked once */
+  for (j=0; j<igraph_vector_size(&vtypes) && no_of_nodes > 0; j++) {
+    if (!strcmp(STR(vnames, j), "id")) { continue; }
+    if (VECTOR(vtypes)[j] == IGRAPH_ATTRIBUTE_BOOLEAN) {
+      IGRAPH_WARNING("A boolean vertex attribute was converted to numeric");
+    } else if (!vc[j]) {
+      IGRAPH_WARNING("A non-numeric, non-string, non-boolean edge attribute was ignored");
+    }
+  }
+  for (j=0; j<igraph_vector_size(&etypes) && no_of_edges > 0; j++) {
+    if (!strcmp(STR(enames, j), "source") || 
+	!strcmp(STR(enames, j), "target")) { continue; }
+    if (VECTOR(etypes)[j] == IGRAPH_ATTRIBUTE_BOOLEAN) {
+      IGRAPH_WARNING("A boolean edge attribute was converted to numeric");
+    } else if (!ec[j]) {
+      IGRAPH_WARNING("A non-numeric, non-string, non-boolean edge attribute was ignored");
+    }
+  }
+
   /* Now come the vertices */
   for (i=0; i<no_of_nodes; i++) {
-    long int j;
-    CHECK(fprintf(outstream, "  node\n  [\n"));
+    igraph_i_writer_puts(&w, "  node\n  [\n");
     /* id */
-    CHECK(fprintf(outstream, "    id %li\n", myid ? (long int)VECTOR(*myid)[i] : i));
+    igraph_i_writer_puts(&w, "    id ");
+    igraph_i_writer_long(&w, myid ? (long int)VECTOR(*myid)[i] : i);
+    IGRAPH_I_WRITER_PUTC(&w, '\n');
     /* other attributes */
     for (j=0; j<igraph_vector_size(&vtypes); j++) {
-      int type=(int) VECTOR(vtypes)[j];
-      char *name, *newname;
-      igraph_strvector_get(&vnames, j, &name);
-      if (!strcmp(name, "id")) { continue; }	
-      IGRAPH_CHECK(igraph_i_gml_convert_to_key(name, &newname));
-      if (type==IGRAPH_ATTRIBUTE_NUMERIC) {
-	IGRAPH_CHECK(igraph_i_attribute_get_numeric_vertex_attr(graph, name, 
-				igraph_vss_1((igraph_integer_t) i), &numv));
-	CHECK(fprintf(outstream, "    %s ", newname));
-	CHECK(igraph_real_fprintf_precise(outstream, VECTOR(numv)[0]));
-	CHECK(fputc('\n', outstream));
-      } else if (type==IGRAPH_ATTRIBUTE_STRING) { 
-	char *s;
-	IGRAPH_CHECK(igraph_i_attribute_get_string_vertex_attr(graph, name,
-			       igraph_vss_1((igraph_integer_t) i), &strv));
-	igraph_strvector_get(&strv, 0, &s);
-	CHECK(fprintf(outstream, "    %s \"%s\"\n", newname, s));
-      } else if (type==IGRAPH_ATTRIBUTE_BOOLEAN) {
-	IGRAPH_CHECK(igraph_i_attribute_get_bool_vertex_attr(graph, name,
-			     igraph_vss_1((igraph_integer_t) i), &boolv));
-	CHECK(fprintf(outstream, "    %s %d\n", newname, VECTOR(boolv)[0] ? 1 : 0));
-	IGRAPH_WARNING("A boolean vertex attribute was converted to numeric");
-      } else {
-	IGRAPH_WARNING("A non-numeric, non-string, non-boolean edge attribute was ignored");
-      }
-      igraph_Free(newname);
+      igraph_i_attr_column_t *col=vc[j];
+      if (!col || !strcmp(col->name, "id")) { continue; }	
+      IGRAPH_CHECK(igraph_i_gml_write_attr(&w, col, STR(vkeys, j), i));
     }
-    CHECK(fprintf(outstream, "  ]\n"));
+    igraph_i_writer_puts(&w, "  ]\n");
   }
 
   /* The edges too */
   for (i=0; i<no_of_edges; i++) {
     long int from=IGRAPH_FROM(graph, i);
     long int to=IGRAPH_TO(graph, i);
-    long int j;
-    CHECK(fprintf(outstream, "  edge\n  [\n"));
+    igraph_i_writer_puts(&w, "  edge\n  [\n");
     /* source and target */
-    CHECK(fprintf(outstream, "    source %li\n", 
-		  myid ? (long int)VECTOR(*myid)[from] : from));
-    CHECK(fprintf(outstream, "    target %li\n", 
-		  myid ? (long int)VECTOR(*myid)[to] : to));
+    igraph_i_writer_puts(&w, "    source ");
+    igraph_i_writer_long(&w, myid ? (long int)VECTOR(*myid)[from] : from);
+    igraph_i_writer_puts(&w, "\n    target ");
+    igraph_i_writer_long(&w, myid ? (long int)VECTOR(*myid)[to] : to);
+    IGRAPH_I_WRITER_PUTC(&w, '\n');
 
     /* other attributes */
     for (j=0; j<igraph_vector_size(&etypes); j++) {
-      int type=(int) VECTOR(etypes)[j];
-      char *name, *newname;
-      igraph_strvector_get(&enames, j, &name);
-      if (!strcmp(name, "source") || !strcmp(name, "target")) { continue; }	
-      IGRAPH_CHECK(igraph_i_gml_convert_to_key(name, &newname));
-      if (type==IGRAPH_ATTRIBUTE_NUMERIC) {
-	IGRAPH_CHECK(igraph_i_attribute_get_numeric_edge_attr(graph, name, 
-			      igraph_ess_1((igraph_integer_t) i), &numv));
-	CHECK(fprintf(outstream, "    %s ", newname));
-	CHECK(igraph_real_fprintf_precise(outstream, VECTOR(numv)[0]));
-	CHECK(fputc('\n', outstream));
-      } else if (type==IGRAPH_ATTRIBUTE_STRING) { 
-	char *s;
-	IGRAPH_CHECK(igraph_i_attribute_get_string_edge_attr(graph, name,
-			     igraph_ess_1((igraph_integer_t) i), &strv));
-	igraph_strvector_get(&strv, 0, &s);
-	CHECK(fprintf(outstream, "    %s \"%s\"\n", newname, s));
-      } else if (type==IGRAPH_ATTRIBUTE_BOOLEAN) {
-	IGRAPH_CHECK(igraph_i_attribute_get_bool_edge_attr(graph, name,
-			     igraph_ess_1((igraph_integer_t) i), &boolv));
-	CHECK(fprintf(outstream, "    %s %d\n", newname, VECTOR(boolv)[0] ? 1 : 0));
-	IGRAPH_WARNING("A boolean edge attribute was converted to numeric");
-      } else {
-	IGRAPH_WARNING("A non-numeric, non-string, non-boolean edge attribute was ignored");
-      }
-      igraph_Free(newname);
+      igraph_i_attr_column_t *col=ec[j];
+      if (!col || !strcmp(col->name, "source") || 
+	  !strcmp(col->name, "target")) { continue; }	
+      IGRAPH_CHECK(igraph_i_gml_write_attr(&w, col, STR(ekeys, j), i));
     }
-    CHECK(fprintf(outstream, "  ]\n"));
+    igraph_i_writer_puts(&w, "  ]\n");
   }
 
-  CHECK(fprintf(outstream, "]\n"));
+  igraph_i_writer_puts(&w, "]\n");
+
+  IGRAPH_CHECK(igraph_i_writer_finish(&w));
+  igraph_i_writer_destroy(&w);
+  IGRAPH_FINALLY_CLEAN(1);
 
   if (&v_myid == myid) { 
     igraph_vector_destroy(&v_myid);
     IGRAPH_FINALLY_CLEAN(1);
   }
 
+  igraph_vector_ptr_destroy_all(&ecols);
+  igraph_vector_ptr_destroy_all(&vcols);
+  igraph_strvector_destroy(&ekeys);
+  igraph_strvector_destroy(&vkeys);
+  igraph_strvector_destroy(&gkeys);
   igraph_vector_bool_destroy(&boolv);
   igraph_strvector_destroy(&strv);
   igraph_vector_destroy(&numv);
@@ -2718,7 +2773,7 @@ int igraph_write_graph_gml(const igraph_t *graph, FILE *outstream,
   igraph_strvector_destroy(&enames);
   igraph_strvector_destroy(&vnames);
   igraph_strvector_destroy(&gnames);
-  IGRAPH_FINALLY_CLEAN(9);
+  IGRAPH_FINALLY_CLEAN(14);
   
   return 0;
 }
@@ -2781,6 +2836,50 @@ int igraph_i_dot_escape(const char *orig, char **result) {
   return 0;
 }
 
+int igraph_i_dot_escape_all(const igraph_strvector_t *names,
+			    igraph_strvector_t *escaped) {
+  long int i, n=igraph_strvector_size(names);
+  for (i=0; i<n; i++) {
+    char *newname;
+    IGRAPH_CHECK(igraph_i_dot_escape(STR(*names, i), &newname));
+    IGRAPH_FINALLY(igraph_free, newname);
+    IGRAPH_CHECK(igraph_strvector_add(escaped, newname));
+    igraph_Free(newname);
+    IGRAPH_FINALLY_CLEAN(1);
+  }
+  return 0;
+}
+
+/* Writes a '  name=value' line for element 'idx' of an attribute
+   column. Numbers with an integer value are written as integers. */
+
+int igraph_i_dot_write_attr(igraph_i_writer_t *w, 
+			    igraph_i_attr_column_t *col,
+			    const char *name, long int idx) {
+  IGRAPH_CHECK(igraph_i_attr_column_fetch(col, idx));
+  igraph_i_writer_puts(w, "    ");
+  igraph_i_writer_puts(w, name);
+  IGRAPH_I_WRITER_PUTC(w, '=');
+  if (col->type == IGRAPH_ATTRIBUTE_NUMERIC) {
+    igraph_real_t x=IGRAPH_I_ATTR_COLUMN_NUM(col, idx);
+    if (x == (long)x) {
+      igraph_i_writer_long(w, (long)x);
+    } else {
+      igraph_i_writer_real(w, x);
+    }
+  } else if (col->type == IGRAPH_ATTRIBUTE_STRING) {
+    char *news;
+    IGRAPH_CHECK(igraph_i_dot_escape(IGRAPH_I_ATTR_COLUMN_STR(col, idx), 
+				     &news));
+    igraph_i_writer_puts(w, news);
+    igraph_Free(news);
+  } else {
+    IGRAPH_I_WRITER_PUTC(w, IGRAPH_I_ATTR_COLUMN_BOOL(col, idx) ? '1' : '0');
+  }
+  IGRAPH_I_WRITER_PUTC(w, '\n');
+  return 0;
+}
+
 /**
  * \function igraph_write_graph_dot
  * \brief Write the graph to a stream in DOT format
@@ -2804,16 +2903,19 @@ int igraph_i_dot_escape(const char *orig, char **result) {
  * \example examples/simple/dot.c
  */
 int igraph_write_graph_dot(const igraph_t *graph, FILE* outstream) {
-  int ret;
   long int i, j;
   long int no_of_nodes=igraph_vcount(graph);
   long int no_of_edges=igraph_ecount(graph);
   char edgeop[3];
   igraph_strvector_t gnames, vnames, enames;
   igraph_vector_t gtypes, vtypes, etypes;
+  igraph_strvector_t vnames_escaped, enames_escaped;
+  igraph_vector_ptr_t vcols, ecols;
+  igraph_i_attr_column_t **vc, **ec;
   igraph_vector_t numv;
   igraph_strvector_t strv;
   igraph_vector_bool_t boolv;
+  igraph_i_writer_t w;
 
   IGRAPH_STRVECTOR_INIT_FINALLY(&gnames, 0);
   IGRAPH_STRVECTOR_INIT_FINALLY(&vnames, 0);
@@ -2830,144 +2932,143 @@ int igraph_write_graph_dot(const igraph_t *graph, FILE* outstream) {
   IGRAPH_STRVECTOR_INIT_FINALLY(&strv, 1);
   IGRAPH_VECTOR_BOOL_INIT_FINALLY(&boolv, 1);
 
-  CHECK(fprintf(outstream, "/* Created by igraph %s */\n",
-	PACKAGE_VERSION));
+  IGRAPH_STRVECTOR_INIT_FINALLY(&vnames_escaped, 0);
+  IGRAPH_STRVECTOR_INIT_FINALLY(&enames_escaped, 0);
+  IGRAPH_CHECK(igraph_i_dot_escape_all(&vnames, &vnames_escaped));
+  IGRAPH_CHECK(igraph_i_dot_escape_all(&enames, &enames_escaped));
+
+  IGRAPH_CHECK(igraph_vector_ptr_init(&vcols, 0));
+  IGRAPH_FINALLY(igraph_vector_ptr_destroy_all, &vcols);
+  IGRAPH_CHECK(igraph_i_attr_columns_init(&vcols, graph, 
+			  IGRAPH_ATTRIBUTE_VERTEX, &vnames, &vtypes,
+			  IGRAPH_I_ATTR_COLUMN_CHUNK));
+  IGRAPH_CHECK(igraph_vector_ptr_init(&ecols, 0));
+  IGRAPH_FINALLY(igraph_vector_ptr_destroy_all, &ecols);
+  IGRAPH_CHECK(igraph_i_attr_columns_init(&ecols, graph, 
+			  IGRAPH_ATTRIBUTE_EDGE, &enames, &etypes,
+			  IGRAPH_I_ATTR_COLUMN_CHUNK));
+  vc=(igraph_i_attr_column_t **) VECTOR(vcols);
+  ec=(igraph_i_attr_column_t **) VECTOR(ecols);
+
+  IGRAPH_CHECK(igraph_i_writer_init(&w, outstream));
+  IGRAPH_FINALLY(igraph_i_writer_destroy, &w);
+
+  igraph_i_writer_printf(&w, "/* Created by igraph %s */\n",
+			 PACKAGE_VERSION);
 
   if (igraph_is_directed(graph)) {
-	CHECK(fprintf(outstream, "digraph {\n"));
+	igraph_i_writer_puts(&w, "digraph {\n");
 	strcpy(edgeop, "->");
   } else {
-	CHECK(fprintf(outstream, "graph {\n"));
+	igraph_i_writer_puts(&w, "graph {\n");
 	strcpy(edgeop, "--");
   }
 
   /* Write the graph attributes */
   if (igraph_vector_size(&gtypes)>0) {
-	CHECK(fprintf(outstream, "  graph [\n"));
+	igraph_i_writer_puts(&w, "  graph [\n");
 	for (i=0; i<igraph_vector_size(&gtypes); i++) {
 	  char *name, *newname;
 	  igraph_strvector_get(&gnames, i, &name);
 	  IGRAPH_CHECK(igraph_i_dot_escape(name, &newname));
+	  IGRAPH_FINALLY(igraph_free, newname);
 	  if (VECTOR(gtypes)[i] == IGRAPH_ATTRIBUTE_NUMERIC) {
 		IGRAPH_CHECK(igraph_i_attribute_get_numeric_graph_attr(graph, name, &numv));
 		if (VECTOR(numv)[0] == (long)VECTOR(numv)[0]) {
-		  CHECK(fprintf(outstream, "    %s=%ld\n", newname, (long)VECTOR(numv)[0]));
+		  igraph_i_writer_printf(&w, "    %s=%ld\n", newname, (long)VECTOR(numv)[0]);
 		} else {
-		  CHECK(fprintf(outstream, "    %s=", newname));
-		  CHECK(igraph_real_fprintf_precise(outstream, VECTOR(numv)[0]));
-		  CHECK(fputc('\n', outstream));
+		  igraph_i_writer_printf(&w, "    %s=", newname);
+		  igraph_i_writer_real(&w, VECTOR(numv)[0]);
+		  IGRAPH_I_WRITER_PUTC(&w, '\n');
 		}
 	  } else if (VECTOR(gtypes)[i] == IGRAPH_ATTRIBUTE_STRING) {
 		char *s, *news;
 		IGRAPH_CHECK(igraph_i_attribute_get_string_graph_attr(graph, name, &strv));
 		igraph_strvector_get(&strv, 0, &s);
 		IGRAPH_CHECK(igraph_i_dot_escape(s, &news));
-		CHECK(fprintf(outstream, "    %s=%s\n", newname, news));
+		igraph_i_writer_printf(&w, "    %s=%s\n", newname, news);
 		igraph_Free(news);
 	  } else if (VECTOR(gtypes)[i] == IGRAPH_ATTRIBUTE_BOOLEAN) {
 		IGRAPH_CHECK(igraph_i_attribute_get_bool_graph_attr(graph, name, &boolv));
-		CHECK(fprintf(outstream, "    %s=%d\n", newname, VECTOR(boolv)[0] ? 1 : 0));
+		igraph_i_writer_printf(&w, "    %s=%d\n", newname, VECTOR(boolv)[0] ? 1 : 0);
 		IGRAPH_WARNING("A boolean graph attribute was converted to numeric");
 	  } else {
 		IGRAPH_WARNING("A non-numeric, non-string, non-boolean graph attribute ignored");
 	  }
 	  igraph_Free(newname);
+	  IGRAPH_FINALLY_CLEAN(1);
+	}
+	igraph_i_writer_puts(&w, "  ];\n");
+  }
+
+  /* The vertex and edge attributes are only checked once */
+  for (j=0; j<igraph_vector_size(&vtypes) && no_of_nodes > 0; j++) {
+	if (VECTOR(vtypes)[j] == IGRAPH_ATTRIBUTE_BOOLEAN) {
+	  IGRAPH_WARNING("A boolean vertex attribute was converted to numeric");
+	} else if (!vc[j]) {
+	  IGRAPH_WARNING("A non-numeric, non-string, non-boolean vertex attribute was ignored");
+	}
+  }
+  for (j=0; j<igraph_vector_size(&etypes) && no_of_edges > 0; j++) {
+	if (VECTOR(etypes)[j] == IGRAPH_ATTRIBUTE_BOOLEAN) {
+	  IGRAPH_WARNING("A boolean edge attribute was converted to numeric");
+	} else if (!ec[j]) {
+	  IGRAPH_WARNING("A non-numeric, non-string graph attribute ignored");
 	}
-	CHECK(fprintf(outstream, "  ];\n"));
   }
 
   /* Write the vertices */
   if (igraph_vector_size(&vtypes) > 0) {
 	for (i=0; i<no_of_nodes; i++) {
-	  CHECK(fprintf(outstream, "  %ld [\n", i));
+	  igraph_i_writer_puts(&w, "  ");
+	  igraph_i_writer_long(&w, i);
+	  igraph_i_writer_puts(&w, " [\n");
 	  for (j=0; j<igraph_vector_size(&vtypes); j++) {
-		char *name, *newname;
-		igraph_strvector_get(&vnames, j, &name);
-		IGRAPH_CHECK(igraph_i_dot_escape(name, &newname));
-		if (VECTOR(vtypes)[j] == IGRAPH_ATTRIBUTE_NUMERIC) {
-		  IGRAPH_CHECK(igraph_i_attribute_get_numeric_vertex_attr(graph, name, igraph_vss_1((igraph_integer_t) i), &numv));
-		  if (VECTOR(numv)[0] == (long)VECTOR(numv)[0]) {
-			CHECK(fprintf(outstream, "    %s=%ld\n", newname, (long)VECTOR(numv)[0]));
-		  } else {
-		        CHECK(fprintf(outstream, "    %s=", newname));
-			CHECK(igraph_real_fprintf_precise(outstream, 
-						  VECTOR(numv)[0]));
-			CHECK(fputc('\n', outstream));
-		  }
-		} else if (VECTOR(vtypes)[j] == IGRAPH_ATTRIBUTE_STRING) {
-		  char *s, *news;
-		  IGRAPH_CHECK(igraph_i_attribute_get_string_vertex_attr(graph, name, igraph_vss_1((igraph_integer_t) i), &strv));
-		  igraph_strvector_get(&strv, 0, &s);
-		  IGRAPH_CHECK(igraph_i_dot_escape(s, &news));
-		  CHECK(fprintf(outstream, "    %s=%s\n", newname, news));
-		  igraph_Free(news);
-                } else if (VECTOR(vtypes)[j] == IGRAPH_ATTRIBUTE_BOOLEAN) {
-		  IGRAPH_CHECK(igraph_i_attribute_get_bool_vertex_attr(graph, name, igraph_vss_1((igraph_integer_t) i), &boolv));
-		  CHECK(fprintf(outstream, "    %s=%d\n", newname, VECTOR(boolv)[0] ? 1 : 0));
-		  IGRAPH_WARNING("A boolean vertex attribute was converted to numeric");
-		} else {
-		  IGRAPH_WARNING("A non-numeric, non-string, non-boolean vertex attribute was ignored");
+		if (vc[j]) {
+		  IGRAPH_CHECK(igraph_i_dot_write_attr(&w, vc[j], 
+					       STR(vnames_escaped, j), i));
 		}
-		igraph_Free(newname);
 	  }
-	  CHECK(fprintf(outstream, "  ];\n"));
+	  igraph_i_writer_puts(&w, "  ];\n");
 	}
   } else {
-	for (i=0; i<no_of_nodes; i++)
-	  CHECK(fprintf(outstream, "  %ld;\n", i));
+	for (i=0; i<no_of_nodes; i++) {
+	  igraph_i_writer_puts(&w, "  ");
+	  igraph_i_writer_long(&w, i);
+	  igraph_i_writer_puts(&w, ";\n");
+	}
   }
-  CHECK(fprintf(outstream, "\n"));
+  IGRAPH_I_WRITER_PUTC(&w, '\n');
 
   /* Write the edges */
-  if (igraph_vector_size(&etypes) > 0) {
-	for (i=0; i<no_of_edges; i++) {
-	  long int from=IGRAPH_FROM(graph, i);
-	  long int to=IGRAPH_TO(graph, i);
-	  CHECK(fprintf(outstream, "  %ld %s %ld [\n", from, edgeop, to));
+  for (i=0; i<no_of_edges; i++) {
+	igraph_i_writer_puts(&w, "  ");
+	igraph_i_writer_long(&w, IGRAPH_FROM(graph, i));
+	IGRAPH_I_WRITER_PUTC(&w, ' ');
+	igraph_i_writer_puts(&w, edgeop);
+	IGRAPH_I_WRITER_PUTC(&w, ' ');
+	igraph_i_writer_long(&w, IGRAPH_TO(graph, i));
+	if (igraph_vector_size(&etypes) > 0) {
+	  igraph_i_writer_puts(&w, " [\n");
 	  for (j=0; j<igraph_vector_size(&etypes); j++) {
-		char *name, *newname;
-		igraph_strvector_get(&enames, j, &name);
-		IGRAPH_CHECK(igraph_i_dot_escape(name, &newname));
-		if (VECTOR(etypes)[j] == IGRAPH_ATTRIBUTE_NUMERIC) {
-		  IGRAPH_CHECK(igraph_i_attribute_get_numeric_edge_attr(graph, 
-			name, igraph_ess_1((igraph_integer_t) i), &numv));
-		  if (VECTOR(numv)[0] == (long)VECTOR(numv)[0]) {
-			CHECK(fprintf(outstream, "    %s=%ld\n", newname, (long)VECTOR(numv)[0]));
-		  } else {
-		        CHECK(fprintf(outstream, "    %s=", newname));
-			CHECK(igraph_real_fprintf_precise(outstream, VECTOR(numv)[0]));
-			CHECK(fputc('\n', outstream));
-		  }
-		  igraph_Free(newname);
-		} else if (VECTOR(etypes)[j] == IGRAPH_ATTRIBUTE_STRING) {
-		  char *s, *news;
-		  IGRAPH_CHECK(igraph_i_attribute_get_string_edge_attr(graph, 
-		       name, igraph_ess_1((igraph_integer_t) i), &strv));
-		  igraph_strvector_get(&strv, 0, &s);
-		  IGRAPH_CHECK(igraph_i_dot_escape(s, &news));
-		  CHECK(fprintf(outstream, "    %s=%s\n", newname, news));
-		  igraph_Free(newname);
-		  igraph_Free(news);
-                } else if (VECTOR(etypes)[j] == IGRAPH_ATTRIBUTE_BOOLEAN) {
-		  IGRAPH_CHECK(igraph_i_attribute_get_bool_edge_attr(graph, 
-			     name, igraph_ess_1((igraph_integer_t) i), &boolv));
-		  CHECK(fprintf(outstream, "    %s=%d\n", newname, VECTOR(boolv)[0] ? 1 : 0));
-		  IGRAPH_WARNING("A boolean edge attribute was converted to numeric");
-		} else {
-		  IGRAPH_WARNING("A non-numeric, non-string graph attribute ignored");
+		if (ec[j]) {
+		  IGRAPH_CHECK(igraph_i_dot_write_attr(&w, ec[j], 
+					       STR(enames_escaped, j), i));
 		}
 	  }
-	  CHECK(fprintf(outstream, "  ];\n"));
-	}
-  } else {
-	for (i=0; i<no_of_edges; i++) {
-	  long int from=IGRAPH_FROM(graph, i);
-	  long int to=IGRAPH_TO(graph, i);
-	  CHECK(fprintf(outstream, "  %ld %s %ld;\n", from, edgeop, to));
+	  igraph_i_writer_puts(&w, "  ];\n");
+	} else {
+	  igraph_i_writer_puts(&w, ";\n");
 	}
   }
-  CHECK(fprintf(outstream, "}\n"));
+  igraph_i_writer_puts(&w, "}\n");
   
+  IGRAPH_CHECK(igraph_i_writer_finish(&w));
+  igraph_i_writer_destroy(&w);
+  igraph_vector_ptr_destroy_all(&ecols);
+  igraph_vector_ptr_destroy_all(&vcols);
+  igraph_strvector_destroy(&enames_escaped);
+  igraph_strvector_destroy(&vnames_escaped);
   igraph_vector_bool_destroy(&boolv);
   igraph_strvector_destroy(&strv);
   igraph_vector_destroy(&numv);
@@ -2977,8 +3078,8 @@ int igraph_write_graph_dot(const igraph_t *graph, FILE* outstream) {
   igraph_strvector_destroy(&enames);
   igraph_strvector_destroy(&vnames);
   igraph_strvector_destroy(&gnames);
-  IGRAPH_FINALLY_CLEAN(9);
-  
+  IGRAPH_FINALLY_CLEAN(14);
+
   return 0;
 }
 
@@ -3082,7 +3183,7 @@ int igraph_read_graph_dl(igraph_t *graph, FILE *instream,
   if (igraph_strvector_size(&context.labels) != 0) {
     namevec=(const igraph_strvector_t*) &context.labels;
   } else if (igraph_trie_size(&context.trie) != 0) {
-    igraph_trie_getkeys(&context.trie, &namevec);
+    IGRAPH_CHECK(igraph_trie_getkeys(&context.trie, &namevec));
   }
   if (namevec) {
     IGRAPH_CHECK(igraph_vector_ptr_init(&name, 1));
@@ -0,0 +1,107 @@
+/* -*- mode: C -*-  */
+/*
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301 USA
+
+*/
+
+#ifndef IGRAPH_PARALLEL_INTERNAL_H
+#define IGRAPH_PARALLEL_INTERNAL_H
+
+#include "config.h"
+#include "igraph_interrupt_internal.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#undef __BEGIN_DECLS
+#undef __END_DECLS
+#ifdef __cplusplus
+# define __BEGIN_DECLS extern "C" {
+# define __END_DECLS }
+#else
+# define __BEGIN_DECLS /* empty */
+# define __END_DECLS /* empty */
+#endif
+
+__BEGIN_DECLS
+
+/*
+ * Some functions run their inner loops in OpenMP parallel regions if
+ * igraph was configured with OpenMP support; the number of threads
+ * is the OpenMP default, e.g. it can be set via OMP_NUM_THREADS.
+ * Without OpenMP the pragmas are ignored and the same code runs
+ * serially, in a single "thread".
+ *
+ * The error handling, the IGRAPH_FINALLY stack, the RNG and the
+ * progress and interruption handlers are not thread-safe, so code
+ * running in a parallel region must not call IGRAPH_ERROR,
+ * IGRAPH_CHECK, IGRAPH_FINALLY or anything that allocates memory via
+ * the igraph data types. All workspace is allocated before the
+ * parallel region, one per thread. Only thread zero may call the
+ * progress and interruption handlers, see
+ * IGRAPH_I_ALLOW_INTERRUPTION_PARALLEL below.
+ *
+ * Results that are accumulated in parallel are summed per thread,
+ * over a fixed partition of the work, and these partial results are
+ * merged in thread order, so they do not depend on the scheduling,
+ * only on the number of threads. If the result must not depend on
+ * the number of threads either, e.g. because it decides the order of
+ * later steps, the work is split into chunks of a fixed size instead,
+ * and the partial results are merged in chunk order, see
+ * igraph_i_community_eb_update() in community.c.
+ */
+
+#ifdef _OPENMP
+#define IGRAPH_I_MAX_THREADS() (omp_get_max_threads())
+#define IGRAPH_I_NUM_THREADS() (omp_get_num_threads())
+#define IGRAPH_I_THREAD_NUM()  (omp_get_thread_num())
+#else
+#define IGRAPH_I_MAX_THREADS() (1)
+#define IGRAPH_I_NUM_THREADS() (1)
+#define IGRAPH_I_THREAD_NUM()  (0)
+#endif
+
+/* The first and one after the last index of the part of [0,n) that
+   is processed by thread 'tid' of 'nt' threads. */
+
+#define IGRAPH_I_THREAD_BEGIN(n, tid, nt) \
+  ((long int) ((long long int)(n) * (tid) / (nt)))
+#define IGRAPH_I_THREAD_END(n, tid, nt) \
+  ((long int) ((long long int)(n) * ((tid)+1) / (nt)))
+
+/* Call this from a parallel region, instead of IGRAPH_ALLOW_INTERRUPTION.
+   In thread zero it calls the interruption handler and sets 'flag'
+   (a volatile int shared by the threads) to one if the computation
+   should be interrupted. The threads should check 'flag' regularly
+   and leave the parallel region if it is set, the function itself
+   returns IGRAPH_INTERRUPTED after the parallel region. */
+
+#define IGRAPH_I_ALLOW_INTERRUPTION_PARALLEL(flag) \
+  do { \
+    if (IGRAPH_I_THREAD_NUM() == 0 && igraph_i_interruption_handler && \
+	igraph_allow_interruption(NULL) != IGRAPH_SUCCESS) { \
+      (flag) = 1; \
+    } \
+  } while (0)
+
+__END_DECLS
+
+#endif
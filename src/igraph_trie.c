@@ -32,296 +32,203 @@
 #include <string.h> 		/* memcpy & co. */
 #include <stdlib.h>
 
-/**
- * \ingroup igraphtrie
- * \brief Creates a trie node (not to be called directly)
- * \return Error code: errors by igraph_strvector_init(),
- *         igraph_vector_ptr_init() and igraph_vector_init() might be returned.
+/* 
+ * The trie is an open addressing hash table with linear probing. The
+ * table holds key ids, its size is a power of two and it is kept at
+ * most half full. The keys themselves are stored in a single
+ * character arena, so adding a new key needs no allocation in most
+ * cases, and looking up an existing one needs none at all.
  */
 
-int igraph_i_trie_init_node(igraph_trie_node_t *t) { 
-  IGRAPH_STRVECTOR_INIT_FINALLY(&t->strs, 0);
-  IGRAPH_VECTOR_PTR_INIT_FINALLY(&t->children, 0);
-  IGRAPH_VECTOR_INIT_FINALLY(&t->values, 0);
-  IGRAPH_FINALLY_CLEAN(3);
-  return 0;
-}  
-
-void igraph_i_trie_destroy_node(igraph_trie_node_t *t, igraph_bool_t sfree);
+#define IGRAPH_I_TRIE_MIN_TABLE 16
 
 /**
  * \ingroup igraphtrie
- * \brief Creates a trie.
- * \return Error code: errors by igraph_strvector_init(),
- *         igraph_vector_ptr_init() and igraph_vector_init() might be returned.
+ * \brief The hash function of the keys (FNV-1a, not to be called directly).
  */
 
-int igraph_trie_init(igraph_trie_t *t, igraph_bool_t storekeys) {
-  t->maxvalue=-1;
-  t->storekeys=storekeys;
-  IGRAPH_CHECK(igraph_i_trie_init_node( (igraph_trie_node_t *)t ));
-  IGRAPH_FINALLY(igraph_i_trie_destroy_node, t);
-  if (storekeys) {
-    IGRAPH_CHECK(igraph_strvector_init(&t->keys, 0));
+static long int igraph_i_trie_hash(const char *key, long int length) {
+  unsigned long int h=2166136261UL;
+  long int i;
+  for (i=0; i<length; i++) {
+    h ^= (unsigned char) key[i];
+    h = (h * 16777619UL) & 0xffffffffUL;
   }
-
-  IGRAPH_FINALLY_CLEAN(1);
-  return 0;
+  return (long int) (h & 0x7fffffffUL);
 }
 
 /**
  * \ingroup igraphtrie
- * \brief Destroys a node of a trie (not to be called directly).
+ * \brief Looks up a key (not to be called directly).
+ *
+ * Returns the id of the key, or -1 if it is not in the trie. In the
+ * latter case \c slot is set to the empty slot where it should be
+ * inserted.
  */
 
-void igraph_i_trie_destroy_node(igraph_trie_node_t *t, igraph_bool_t sfree) {
-  long int i;
-  igraph_strvector_destroy(&t->strs);
-  for (i=0; i<igraph_vector_ptr_size(&t->children); i++) {
-    igraph_trie_node_t *child=VECTOR(t->children)[i];
-    if (child != 0) {
-      igraph_i_trie_destroy_node(child, 1);
+static long int igraph_i_trie_find(const igraph_trie_t *t, const char *key,
+				   long int length, long int hash, 
+				   long int *slot) {
+  long int mask=igraph_vector_long_size(&t->table)-1;
+  long int s=hash & mask, id;
+  while ( (id=VECTOR(t->table)[s]) != -1) {
+    long int off=VECTOR(t->offsets)[id];
+    if (VECTOR(t->hashes)[id] == hash &&
+	VECTOR(t->offsets)[id+1] - off - 1 == length &&
+	!memcmp(VECTOR(t->arena)+off, key, (size_t) length)) {
+      *slot=s;
+      return id;
     }
+    s = (s+1) & mask;
   }
-  igraph_vector_ptr_destroy(&t->children);
-  igraph_vector_destroy(&t->values);
-  if (sfree) { igraph_Free(t); }
+  *slot=s;
+  return -1;
 }
 
 /**
  * \ingroup igraphtrie
- * \brief Destroys a trie (frees allocated memory).
+ * \brief Rebuilds the hash table with a new size (not to be called directly).
+ *
+ * The trie is unchanged if there is not enough memory.
  */
 
-void igraph_trie_destroy(igraph_trie_t *t) {
-  if (t->storekeys) {
-    igraph_strvector_destroy(&t->keys);
+static int igraph_i_trie_rehash(igraph_trie_t *t, long int newsize) {
+  igraph_vector_long_t newtable;
+  long int i, n=igraph_vector_long_size(&t->hashes), mask=newsize-1;
+
+  IGRAPH_CHECK(igraph_vector_long_init(&newtable, newsize));
+  igraph_vector_long_fill(&newtable, -1);
+  for (i=0; i<n; i++) {
+    long int s=VECTOR(t->hashes)[i] & mask;
+    while (VECTOR(newtable)[s] != -1) {
+      s = (s+1) & mask;
+    }
+    VECTOR(newtable)[s]=i;
   }
-  igraph_i_trie_destroy_node( (igraph_trie_node_t*) t, 0);
+  igraph_vector_long_destroy(&t->table);
+  t->table=newtable;
+  return 0;
 }
 
-
 /**
  * \ingroup igraphtrie
- * \brief Internal helping function for igraph_trie_t
+ * \brief Makes room for at least \c size elements, doubling the 
+ * capacity (not to be called directly).
  */
 
-long int igraph_i_strdiff(const char *str, const char *key) {
-
-  long int diff=0;
-  while (key[diff] != '\0' && str[diff] != '\0' && str[diff]==key[diff]) {
-    diff++;
+static int igraph_i_trie_reserve_long(igraph_vector_long_t *v, long int size) {
+  long int cap=igraph_vector_long_capacity(v);
+  if (cap < size) {
+    IGRAPH_CHECK(igraph_vector_long_reserve(v, 2*cap > size ? 2*cap : size));
   }
-  return diff;
+  return 0;
 }
 
 /**
  * \ingroup igraphtrie
  * \brief Search/insert in a trie (not to be called directly).
  *
+ * If \c add is false, then a nonexistent key is not added, and -1 is
+ * returned as its id. The trie is unchanged if there is not enough
+ * memory to add the key.
+ *
  * @return Error code:
  *         - <b>IGRAPH_ENOMEM</b>: out of memory
  */
 
-int igraph_trie_get_node(igraph_trie_node_t *t, const char *key, 
-			 igraph_real_t newvalue, long int *id) {
-  char *str;
-  long int i;
-  igraph_bool_t add;
-
-  /* If newvalue is negative, we don't add the node if nonexistent, only check
-   * for its existence */
-  add = (newvalue>=0);
-
-  for (i=0; i<igraph_strvector_size(&t->strs); i++) {
-    long int diff;
-    igraph_strvector_get(&t->strs, i, &str);
-    diff=igraph_i_strdiff(str, key);
-    
-    if (diff == 0) {
-
-      /* ------------------------------------ */
-      /* No match, next */
-
-    } else if (str[diff]=='\0' && key[diff]=='\0') {
-
-      /* ------------------------------------ */
-      /* They are exactly the same */
-      if (VECTOR(t->values)[i] != -1) {
-	*id=(long int) VECTOR(t->values)[i];
-	return 0;
-      } else {
-	VECTOR(t->values)[i]=newvalue;
-	*id=(long int) newvalue;
-	return 0;
-      }
-
-    } else if (str[diff]=='\0') {
-
-      /* ------------------------------------ */
-      /* str is prefix of key, follow its link if there is one */
-      igraph_trie_node_t *node=VECTOR(t->children)[i];
-      if (node != 0) {
-	return igraph_trie_get_node(node, key+diff, newvalue, id);
-      } else if (add) {
-	igraph_trie_node_t *node=igraph_Calloc(1, igraph_trie_node_t);
-	if (node==0) {
-	  IGRAPH_ERROR("cannot add to trie", IGRAPH_ENOMEM);
-	}
-	IGRAPH_STRVECTOR_INIT_FINALLY(&node->strs, 1);
-	IGRAPH_VECTOR_PTR_INIT_FINALLY(&node->children, 1);
-	IGRAPH_VECTOR_INIT_FINALLY(&node->values, 1);
-	IGRAPH_CHECK(igraph_strvector_set(&node->strs, 0, key+diff));
-	VECTOR(node->children)[0]=0;
-	VECTOR(node->values)[0]=newvalue;
-
-	VECTOR(t->children)[i]=node;
-
-	*id=(long int) newvalue;
-	IGRAPH_FINALLY_CLEAN(3);
-	return 0;
-      } else {
-	*id=-1;
-	return 0;
-      }
-
-    } else if (key[diff]=='\0' && add) {
-
-      /* ------------------------------------ */
-      /* key is prefix of str, the node has to be cut */
-      char *str2;
-      
-      igraph_trie_node_t *node=igraph_Calloc(1, igraph_trie_node_t);
-      if (node==0) {
-	IGRAPH_ERROR("cannot add to trie", IGRAPH_ENOMEM);
-      }
-      IGRAPH_STRVECTOR_INIT_FINALLY(&node->strs, 1);
-      IGRAPH_VECTOR_PTR_INIT_FINALLY(&node->children, 1);
-      IGRAPH_VECTOR_INIT_FINALLY(&node->values, 1);
-      IGRAPH_CHECK(igraph_strvector_set(&node->strs, 0, str+diff));
-      
-      VECTOR(node->children)[0]=VECTOR(t->children)[i];
-      VECTOR(node->values)[0]=VECTOR(t->values)[i];
-
-      str2=strdup(str);
-      if (str2 == 0) {
-	IGRAPH_ERROR("cannot add to trie", IGRAPH_ENOMEM);
-      }
-      str2[diff]='\0';
-      IGRAPH_FINALLY(free, str2);
-      IGRAPH_CHECK(igraph_strvector_set(&t->strs, i, str2));
-      free(str2);
-      IGRAPH_FINALLY_CLEAN(4);
-      
-      VECTOR(t->values)[i]=newvalue;
-      VECTOR(t->children)[i]=node;
-      
-      *id=(long int) newvalue;
-      return 0;
-
-    } else if (add) {
-
-      /* ------------------------------------ */
-      /* the first diff characters match */
-      char *str2;
-
-      igraph_trie_node_t *node=igraph_Calloc(1, igraph_trie_node_t);
-      if (node==0) {
-	IGRAPH_ERROR("cannot add to trie", IGRAPH_ENOMEM);
-      }
-      IGRAPH_STRVECTOR_INIT_FINALLY(&node->strs, 2);
-      IGRAPH_VECTOR_PTR_INIT_FINALLY(&node->children, 2);
-      IGRAPH_VECTOR_INIT_FINALLY(&node->values, 2);
-      IGRAPH_CHECK(igraph_strvector_set(&node->strs, 0, str+diff));
-      IGRAPH_CHECK(igraph_strvector_set(&node->strs, 1, key+diff));
-      VECTOR(node->children)[0]=VECTOR(t->children)[i];
-      VECTOR(node->children)[1]=0;
-      VECTOR(node->values)[0]=VECTOR(t->values)[i];
-      VECTOR(node->values)[1]=newvalue;
-
-      str2=strdup(str);
-      if (str2 == 0) {
-	IGRAPH_ERROR("cannot add to trie", IGRAPH_ENOMEM);
-      }
-      str2[diff]='\0';
-      IGRAPH_FINALLY(free, str2);
-      IGRAPH_CHECK(igraph_strvector_set(&t->strs, i, str2));
-      free(str2);
-      IGRAPH_FINALLY_CLEAN(4);
-
-      VECTOR(t->values)[i]=-1;
-      VECTOR(t->children)[i]=node;
-      
-      *id=(long int) newvalue;
-      return 0;
-    } else {
-      
-      /* ------------------------------------------------- */
-      /* No match, but we requested not to add the new key */
-      *id=-1;
-      return 0;
-    }
+static int igraph_i_trie_get(igraph_trie_t *t, const char *key, 
+			     long int length, igraph_bool_t add, 
+			     long int *id) {
+  long int hash, slot, n, asize, acap;
+
+  hash=igraph_i_trie_hash(key, length);
+  *id=igraph_i_trie_find(t, key, length, hash, &slot);
+  if (*id >= 0 || !add) {
+    return 0;
   }
 
-  /* ------------------------------------ */
-  /* Nothing matches */
+  /* A new key, allocate everything first */
+  n=igraph_trie_size(t);
+  asize=igraph_vector_char_size(&t->arena);
+  acap=igraph_vector_char_capacity(&t->arena);
+  if (2*(n+1) > igraph_vector_long_size(&t->table)) {
+    IGRAPH_CHECK(igraph_i_trie_rehash(t, 
+			      2*igraph_vector_long_size(&t->table)));
+    igraph_i_trie_find(t, key, length, hash, &slot);
+  }
+  IGRAPH_CHECK(igraph_i_trie_reserve_long(&t->offsets, n+2));
+  IGRAPH_CHECK(igraph_i_trie_reserve_long(&t->hashes, n+1));
+  if (acap < asize+length+1) {
+    IGRAPH_CHECK(igraph_vector_char_reserve(&t->arena, 
+			    2*acap > asize+length+1 ? 2*acap : asize+length+1));
+  }
 
-  if (add) {
-    IGRAPH_CHECK(igraph_vector_ptr_reserve(&t->children, 
-					   igraph_vector_ptr_size(&t->children)+1));
-    IGRAPH_CHECK(igraph_vector_reserve(&t->values, igraph_vector_size(&t->values)+1));
-    IGRAPH_CHECK(igraph_strvector_add(&t->strs, key));
+  /* The capacity is already there, none of these allocate memory */
+  IGRAPH_CHECK(igraph_vector_char_resize(&t->arena, asize+length+1));
+  memcpy(VECTOR(t->arena)+asize, key, (size_t) length);
+  VECTOR(t->arena)[asize+length]='\0';
+  igraph_vector_long_push_back(&t->offsets, asize+length+1);
+  igraph_vector_long_push_back(&t->hashes, hash);
+  VECTOR(t->table)[slot]=n;
 
-    igraph_vector_ptr_push_back(&t->children, 0); /* allocated */
-    igraph_vector_push_back(&t->values, newvalue); /* allocated */
-    *id=(long int) newvalue;
-  } else {
-    *id=-1;
-  }
+  *id=n;
+  return 0;
+}
 
+/**
+ * \ingroup igraphtrie
+ * \brief Creates a trie.
+ *
+ * \param t Pointer to an uninitialized trie.
+ * \param storekeys Ignored. The keys are always stored, as the hash
+ *        table compares them on lookup, so igraph_trie_getkeys()
+ *        and igraph_trie_idx() work even if this is false. A trie
+ *        created with \c storekeys false used to keep only the
+ *        lookup structure, now it takes as much memory as one that
+ *        stores its keys.
+ *
+ * \return Error code: errors by igraph_vector_char_init(),
+ *         igraph_vector_long_init() and igraph_strvector_init() might
+ *         be returned.
+ */
+
+int igraph_trie_init(igraph_trie_t *t, igraph_bool_t storekeys) {
+  t->storekeys=storekeys;
+  IGRAPH_CHECK(igraph_vector_char_init(&t->arena, 0));
+  IGRAPH_FINALLY(igraph_vector_char_destroy, &t->arena);
+  IGRAPH_VECTOR_LONG_INIT_FINALLY(&t->offsets, 1);
+  IGRAPH_VECTOR_LONG_INIT_FINALLY(&t->hashes, 0);
+  IGRAPH_VECTOR_LONG_INIT_FINALLY(&t->table, IGRAPH_I_TRIE_MIN_TABLE);
+  igraph_vector_long_fill(&t->table, -1);
+  IGRAPH_CHECK(igraph_strvector_init(&t->keys, 0));
+
+  IGRAPH_FINALLY_CLEAN(4);
   return 0;
 }
 
+/**
+ * \ingroup igraphtrie
+ * \brief Destroys a trie (frees allocated memory).
+ */
+
+void igraph_trie_destroy(igraph_trie_t *t) {
+  igraph_strvector_destroy(&t->keys);
+  igraph_vector_long_destroy(&t->table);
+  igraph_vector_long_destroy(&t->hashes);
+  igraph_vector_long_destroy(&t->offsets);
+  igraph_vector_char_destroy(&t->arena);
+}
+
 /**
  * \ingroup igraphtrie
  * \brief Search/insert in a trie.
+ *
+ * The ids of the keys are consecutive integers, starting from zero,
+ * in the order of insertion.
  */
 
 int igraph_trie_get(igraph_trie_t *t, const char *key, long int *id) {
-  if (!t->storekeys) {
-    IGRAPH_CHECK(igraph_trie_get_node( (igraph_trie_node_t*) t, 
-				       key, t->maxvalue+1, id));
-    if (*id > t->maxvalue) {
-      t->maxvalue=*id;
-    }
-    return 0;
-  } else {
-    int ret;
-    igraph_error_handler_t *oldhandler;
-    oldhandler=igraph_set_error_handler(igraph_error_handler_ignore);
-    /* Add it to the string vector first, we can undo this later */
-    ret=igraph_strvector_add(&t->keys, key);
-    if (ret != 0) {
-      igraph_set_error_handler(oldhandler);
-      IGRAPH_ERROR("cannot get element from trie", ret);
-    }
-    ret = igraph_trie_get_node( (igraph_trie_node_t*) t,
-				key, t->maxvalue+1, id);
-    if (ret != 0) {
-      igraph_strvector_resize(&t->keys, igraph_strvector_size(&t->keys)-1);
-      igraph_set_error_handler(oldhandler);
-      IGRAPH_ERROR("cannot get element from trie", ret);
-    }
-    
-    /* everything is fine */
-    if (*id > t->maxvalue) {
-      t->maxvalue=*id;
-    } else {
-      igraph_strvector_resize(&t->keys, igraph_strvector_size(&t->keys)-1);
-    }
-    igraph_set_error_handler(oldhandler);    
-  }
-
+  IGRAPH_CHECK(igraph_i_trie_get(t, key, (long int) strlen(key), 1, id));
   return 0;
 }
 
@@ -329,24 +236,21 @@ int igraph_trie_get(igraph_trie_t *t, const char *key, long int *id) {
  * \ingroup igraphtrie
  * \brief Search/insert in a trie (for internal use).
  *
+ * The key is the first \c length characters of \c key, or up to the
+ * first zero character, whichever is shorter. It need not be zero
+ * terminated and it is not copied unless it is a new key.
+ *
  * @return Error code:
  *         - <b>IGRAPH_ENOMEM</b>: out of memory
  */
 
 int igraph_trie_get2(igraph_trie_t *t, const char *key, long int length,
 		     long int *id) {
-  char *tmp=igraph_Calloc(length+1, char);
-
-  if (tmp==0) {
-    IGRAPH_ERROR("Cannot get from trie", IGRAPH_ENOMEM);
+  const char *end=memchr(key, '\0', (size_t) length);
+  if (end) { 
+    length = end-key;
   }
-  
-  strncpy(tmp, key, length);
-  tmp[length]='\0';
-  IGRAPH_FINALLY(free, tmp);
-  IGRAPH_CHECK(igraph_trie_get(t, tmp, id));
-  igraph_Free(tmp);
-  IGRAPH_FINALLY_CLEAN(1);
+  IGRAPH_CHECK(igraph_i_trie_get(t, key, length, 1, id));
   return 0;
 }
 
@@ -358,18 +262,20 @@ int igraph_trie_get2(igraph_trie_t *t, const char *key, long int length,
  */
 
 int igraph_trie_check(igraph_trie_t *t, const char *key, long int *id) {
-  IGRAPH_CHECK(igraph_trie_get_node( (igraph_trie_node_t*) t, 
-				     key, -1, id));
+  IGRAPH_CHECK(igraph_i_trie_get(t, key, (long int) strlen(key), 0, id));
   return 0;
 }
 
 /**
  * \ingroup igraphtrie
  * \brief Get an element of a trie based on its index.
+ *
+ * The returned pointer points into the trie, it is invalidated when
+ * a new key is added.
  */
 
 void igraph_trie_idx(igraph_trie_t *t, long int idx, char **str) {
-  igraph_strvector_get(&t->keys, idx, str);
+  *str=VECTOR(t->arena)+VECTOR(t->offsets)[idx];
 }
 
 /**
@@ -378,12 +284,32 @@ void igraph_trie_idx(igraph_trie_t *t, long int idx, char **str) {
  */
 
 long int igraph_trie_size(igraph_trie_t *t) {
-  return t->maxvalue+1;
+  return igraph_vector_long_size(&t->offsets)-1;
 }
 
-/* Hmmm, very dirty.... */
+/**
+ * \ingroup igraphtrie
+ * \brief The keys of a trie, in the order of their ids.
+ *
+ * The string vector is owned by the trie and it is only updated by
+ * this function, so call it again after adding new keys.
+ */
 
 int igraph_trie_getkeys(igraph_trie_t *t, const igraph_strvector_t **strv) {
+  long int i, k=igraph_strvector_size(&t->keys), n=igraph_trie_size(t);
+  if (k < n) {
+    int ret=0;
+    IGRAPH_CHECK(igraph_strvector_resize(&t->keys, n));
+    for (i=k; i<n && !ret; i++) {
+      long int off=VECTOR(t->offsets)[i];
+      ret=igraph_strvector_set2(&t->keys, i, VECTOR(t->arena)+off,
+				(int) (VECTOR(t->offsets)[i+1]-off-1));
+    }
+    if (ret) {
+      igraph_strvector_resize(&t->keys, k); /* shrinks, does not fail */
+      IGRAPH_ERROR("Cannot get keys from trie", ret);
+    }
+  }
   *strv=&t->keys;
   return 0;
 }
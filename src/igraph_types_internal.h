@@ -161,25 +161,25 @@ int igraph_2wheap_check(igraph_2wheap_t *h);
 /**
  * Trie data type
  * \ingroup internal
+ *
+ * Despite its name this is a string interner: it assigns consecutive
+ * integer ids to strings. The keys are stored one after the other,
+ * zero terminated, in a single character arena, and they are looked
+ * up via an open addressing hash table of key ids.
  */
 
-typedef struct s_igraph_trie_node {
-  igraph_strvector_t strs;
-  igraph_vector_ptr_t children;
-  igraph_vector_t values;
-} igraph_trie_node_t;
-
 typedef struct s_igraph_trie {
-  igraph_strvector_t strs;
-  igraph_vector_ptr_t children;
-  igraph_vector_t values;
-  long int maxvalue;
+  igraph_vector_char_t arena;   /* the keys, zero terminated */
+  igraph_vector_long_t offsets; /* key i is at arena+offsets[i], size+1 elements */
+  igraph_vector_long_t hashes;  /* hash value of each key */
+  igraph_vector_long_t table;   /* key ids, -1 for empty slots */
   igraph_bool_t storekeys;
-  igraph_strvector_t keys;
+  igraph_strvector_t keys;      /* filled on demand, by igraph_trie_getkeys() */
 } igraph_trie_t;
 
-#define IGRAPH_TRIE_NULL { IGRAPH_STRVECTOR_NULL, IGRAPH_VECTOR_PTR_NULL, \
-                           IGRAPH_VECTOR_NULL, 0, 0, IGRAPH_STRVECTOR_NULL }
+#define IGRAPH_TRIE_NULL { IGRAPH_VECTOR_NULL, IGRAPH_VECTOR_NULL, \
+                           IGRAPH_VECTOR_NULL, IGRAPH_VECTOR_NULL, 0, \
+                           IGRAPH_STRVECTOR_NULL }
 #define IGRAPH_TRIE_INIT_FINALLY(tr, sk) \
   do { IGRAPH_CHECK(igraph_trie_init(tr, sk)); \
   IGRAPH_FINALLY(igraph_trie_destroy, tr); } while (0)
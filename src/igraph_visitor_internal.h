@@ -0,0 +1,73 @@
+/* -*- mode: C -*-  */
+/*
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301 USA
+
+*/
+
+#ifndef IGRAPH_VISITOR_INTERNAL_H
+#define IGRAPH_VISITOR_INTERNAL_H
+
+#include "igraph_visitor.h"
+#include "igraph_adjlist.h"
+
+#undef __BEGIN_DECLS
+#undef __END_DECLS
+#ifdef __cplusplus
+# define __BEGIN_DECLS extern "C" {
+# define __END_DECLS }
+#else
+# define __BEGIN_DECLS /* empty */
+# define __END_DECLS /* empty */
+#endif
+
+__BEGIN_DECLS
+
+/* Unweighted single source distances, for the functions that run a
+   BFS from many sources and only need the distances. The workspace
+   is reused for all sources: after igraph_i_bfs_engine_run()
+   'dist' holds the distance of every vertex from the source, or -1,
+   and the first 'nreached' elements of 'order' are the reached
+   vertices, in the order of their distance. The engine is selected
+   by igraph_set_bfs_engine(). */
+
+typedef struct igraph_i_bfs_engine_ws_t {
+  igraph_bfs_engine_t engine;
+  igraph_csr_t out, in;
+  igraph_bool_t in_init;
+  const igraph_csr_t *inp;	/* 'in' or 'out' for undirected searches */
+  long int no_of_slots;		/* sum of the degrees */
+  int *dist;
+  int *order;
+  unsigned char *frontier;	/* bitmap, for the bottom-up steps */
+  long int nreached;
+} igraph_i_bfs_engine_ws_t;
+
+igraph_bfs_engine_t igraph_i_bfs_engine_get(void);
+
+int igraph_i_bfs_engine_init(const igraph_t *graph,
+			     igraph_i_bfs_engine_ws_t *ws,
+			     igraph_neimode_t mode);
+void igraph_i_bfs_engine_destroy(igraph_i_bfs_engine_ws_t *ws);
+long int igraph_i_bfs_engine_run(igraph_i_bfs_engine_ws_t *ws, 
+				 long int source);
+
+__END_DECLS
+
+#endif
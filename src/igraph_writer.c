@@ -0,0 +1,294 @@
+/* -*- mode: C -*-  */
+/*
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301 USA
+
+*/
+
+#include "igraph_writer_internal.h"
+#include "igraph_memory.h"
+#include "igraph_error.h"
+#include "igraph_iterators.h"
+#include "igraph_interface.h"
+#include "config.h"
+
+#include <limits.h>
+#include <stdarg.h>
+#include <string.h>
+
+/* Integral values below this are written without calling snprintf,
+   they must fit into a long int and "%.15g" must print them exactly */
+
+#if LONG_MAX >= 1000000000000000L
+#define IGRAPH_I_WRITER_MAXEXACT 1e15
+#else
+#define IGRAPH_I_WRITER_MAXEXACT 1e9
+#endif
+
+int igraph_i_writer_init(igraph_i_writer_t *w, FILE *stream) {
+  w->stream=stream;
+  w->pos=0;
+  w->failed=0;
+  w->buf=igraph_Calloc(IGRAPH_I_WRITER_BUFSIZE, char);
+  if (!w->buf) {
+    IGRAPH_ERROR("Cannot allocate output buffer", IGRAPH_ENOMEM);
+  }
+  return 0;
+}
+
+void igraph_i_writer_destroy(igraph_i_writer_t *w) {
+  if (w->buf) {
+    igraph_Free(w->buf);
+  }
+}
+
+void igraph_i_writer_flush(igraph_i_writer_t *w) {
+  if (w->pos > 0 && !w->failed) {
+    if (fwrite(w->buf, 1, w->pos, w->stream) != w->pos) {
+      w->failed=1;
+    }
+  }
+  w->pos=0;
+}
+
+/* Writes out the buffer, and reports any write error that happened
+   since igraph_i_writer_init(). */
+
+int igraph_i_writer_finish(igraph_i_writer_t *w) {
+  igraph_i_writer_flush(w);
+  if (w->failed) {
+    IGRAPH_ERROR("Write failed", IGRAPH_EFILE);
+  }
+  return 0;
+}
+
+void igraph_i_writer_write(igraph_i_writer_t *w, const char *s, size_t len) {
+  if (w->pos + len > IGRAPH_I_WRITER_BUFSIZE) {
+    igraph_i_writer_flush(w);
+    if (len > IGRAPH_I_WRITER_BUFSIZE) {
+      if (!w->failed && fwrite(s, 1, len, w->stream) != len) {
+	w->failed=1;
+      }
+      return;
+    }
+  }
+  memcpy(w->buf + w->pos, s, len);
+  w->pos += len;
+}
+
+void igraph_i_writer_puts(igraph_i_writer_t *w, const char *s) {
+  igraph_i_writer_write(w, s, strlen(s));
+}
+
+void igraph_i_writer_long(igraph_i_writer_t *w, long int x) {
+  char digits[IGRAPH_I_WRITER_NUMSIZE];
+  unsigned long int u;
+  int n=0;
+
+  if (w->pos + IGRAPH_I_WRITER_NUMSIZE > IGRAPH_I_WRITER_BUFSIZE) {
+    igraph_i_writer_flush(w);
+  }
+  if (x < 0) {
+    w->buf[w->pos++] = '-';
+    u = 0UL - (unsigned long int) x;
+  } else {
+    u = (unsigned long int) x;
+  }
+  do {
+    digits[n++] = (char) ('0' + u % 10);
+    u /= 10;
+  } while (u != 0);
+  while (n > 0) {
+    w->buf[w->pos++] = digits[--n];
+  }
+}
+
+/* Same output as igraph_real_fprintf_precise() */
+
+void igraph_i_writer_real(igraph_i_writer_t *w, igraph_real_t x) {
+  int n;
+
+  if (x > -IGRAPH_I_WRITER_MAXEXACT && x < IGRAPH_I_WRITER_MAXEXACT) {
+    long int l=(long int) x;
+    if (l == x && (l != 0 || 1.0 / x > 0)) {
+      igraph_i_writer_long(w, l);
+      return;
+    }
+  }
+
+  if (w->pos + IGRAPH_I_WRITER_NUMSIZE > IGRAPH_I_WRITER_BUFSIZE) {
+    igraph_i_writer_flush(w);
+  }
+  n=igraph_real_snprintf_precise(w->buf + w->pos, IGRAPH_I_WRITER_NUMSIZE, x);
+  if (n < 0 || n >= IGRAPH_I_WRITER_NUMSIZE) {
+    w->failed=1;
+  } else {
+    w->pos += (size_t) n;
+  }
+}
+
+/* For the occasional header line, the text goes to the stream
+   directly, after the buffer. */
+
+void igraph_i_writer_printf(igraph_i_writer_t *w, const char *fmt, ...) {
+  va_list ap;
+  igraph_i_writer_flush(w);
+  va_start(ap, fmt);
+  if (!w->failed && vfprintf(w->stream, fmt, ap) < 0) {
+    w->failed=1;
+  }
+  va_end(ap);
+}
+
+int igraph_i_attr_column_init(igraph_i_attr_column_t *col,
+			      const igraph_t *graph,
+			      igraph_attribute_elemtype_t elemtype,
+			      const char *name,
+			      igraph_attribute_type_t type,
+			      long int chunk) {
+  col->graph=graph;
+  col->name=name;
+  col->elemtype=elemtype;
+  col->type=type;
+  col->size= elemtype==IGRAPH_ATTRIBUTE_VERTEX ? igraph_vcount(graph) :
+    igraph_ecount(graph);
+  col->chunk= chunk > 0 ? chunk : col->size;
+  col->start=col->end=0;
+
+  IGRAPH_VECTOR_INIT_FINALLY(&col->num, 0);
+  IGRAPH_CHECK(igraph_strvector_init(&col->str, 0));
+  IGRAPH_FINALLY(igraph_strvector_destroy, &col->str);
+  IGRAPH_CHECK(igraph_vector_bool_init(&col->log, 0));
+  IGRAPH_FINALLY_CLEAN(2);
+  return 0;
+}
+
+void igraph_i_attr_column_destroy(igraph_i_attr_column_t *col) {
+  igraph_vector_bool_destroy(&col->log);
+  igraph_strvector_destroy(&col->str);
+  igraph_vector_destroy(&col->num);
+}
+
+/* Makes sure that the value of element 'idx' is in the column. The
+   chunk that is queried starts at 'idx', so accessing the elements
+   in increasing order queries each value exactly once. */
+
+int igraph_i_attr_column_fetch(igraph_i_attr_column_t *col, long int idx) {
+  long int start=idx, end;
+
+  if (idx >= col->start && idx < col->end) {
+    return 0;
+  }
+
+  if (col->chunk >= col->size) {
+    start=0;
+  }
+  end = col->size - start > col->chunk ? start + col->chunk : col->size;
+
+  /* Note that igraph_vss_seq() includes its upper limit, but
+     igraph_ess_seq() does not */
+  if (col->elemtype == IGRAPH_ATTRIBUTE_VERTEX) {
+    igraph_vs_t vs=igraph_vss_seq((igraph_integer_t) start,
+				  (igraph_integer_t) end-1);
+    if (start == 0 && end == col->size) {
+      vs=igraph_vss_all();
+    }
+    switch (col->type) {
+    case IGRAPH_ATTRIBUTE_NUMERIC:
+      IGRAPH_CHECK(igraph_i_attribute_get_numeric_vertex_attr(col->graph,
+					      col->name, vs, &col->num));
+      break;
+    case IGRAPH_ATTRIBUTE_STRING:
+      IGRAPH_CHECK(igraph_i_attribute_get_string_vertex_attr(col->graph,
+					      col->name, vs, &col->str));
+      break;
+    case IGRAPH_ATTRIBUTE_BOOLEAN:
+      IGRAPH_CHECK(igraph_i_attribute_get_bool_vertex_attr(col->graph,
+					      col->name, vs, &col->log));
+      break;
+    default:
+      IGRAPH_ERROR("Unsupported attribute type", IGRAPH_EINVAL);
+    }
+  } else {
+    igraph_es_t es=igraph_ess_seq((igraph_integer_t) start,
+				  (igraph_integer_t) end);
+    if (start == 0 && end == col->size) {
+      es=igraph_ess_all(IGRAPH_EDGEORDER_ID);
+    }
+    switch (col->type) {
+    case IGRAPH_ATTRIBUTE_NUMERIC:
+      IGRAPH_CHECK(igraph_i_attribute_get_numeric_edge_attr(col->graph,
+					      col->name, es, &col->num));
+      break;
+    case IGRAPH_ATTRIBUTE_STRING:
+      IGRAPH_CHECK(igraph_i_attribute_get_string_edge_attr(col->graph,
+					      col->name, es, &col->str));
+      break;
+    case IGRAPH_ATTRIBUTE_BOOLEAN:
+      IGRAPH_CHECK(igraph_i_attribute_get_bool_edge_attr(col->graph,
+					      col->name, es, &col->log));
+      break;
+    default:
+      IGRAPH_ERROR("Unsupported attribute type", IGRAPH_EINVAL);
+    }
+  }
+
+  col->start=start;
+  col->end=end;
+  return 0;
+}
+
+/* One column for each attribute in 'names', the types are in
+   'types'. The columns of the attributes that are not numeric,
+   string or boolean are NULL. 'cols' must be an initialized, empty
+   pointer vector, destroy it with igraph_vector_ptr_destroy_all(),
+   even if this function fails. */
+
+int igraph_i_attr_columns_init(igraph_vector_ptr_t *cols,
+			       const igraph_t *graph,
+			       igraph_attribute_elemtype_t elemtype,
+			       const igraph_strvector_t *names,
+			       const igraph_vector_t *types,
+			       long int chunk) {
+  long int i, n=igraph_strvector_size(names);
+
+  IGRAPH_VECTOR_PTR_SET_ITEM_DESTRUCTOR(cols, igraph_i_attr_column_destroy);
+  IGRAPH_CHECK(igraph_vector_ptr_resize(cols, n));
+  igraph_vector_ptr_null(cols);
+
+  for (i=0; i<n; i++) {
+    igraph_attribute_type_t type=(igraph_attribute_type_t) VECTOR(*types)[i];
+    igraph_i_attr_column_t *col;
+    if (type != IGRAPH_ATTRIBUTE_NUMERIC && type != IGRAPH_ATTRIBUTE_STRING &&
+	type != IGRAPH_ATTRIBUTE_BOOLEAN) {
+      continue;
+    }
+    col=igraph_Calloc(1, igraph_i_attr_column_t);
+    if (!col) {
+      IGRAPH_ERROR("Cannot create attribute column", IGRAPH_ENOMEM);
+    }
+    IGRAPH_FINALLY(igraph_free, col);
+    IGRAPH_CHECK(igraph_i_attr_column_init(col, graph, elemtype,
+					   STR(*names, i), type, chunk));
+    VECTOR(*cols)[i]=col;
+    IGRAPH_FINALLY_CLEAN(1);
+  }
+
+  return 0;
+}
@@ -0,0 +1,143 @@
+/* -*- mode: C -*-  */
+/*
+   IGraph library.
+   Copyright (C) 2014  Gabor Csardi <csardi.gabor@gmail.com>
+   334 Harvard street, Cambridge, MA 02139 USA
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc.,  51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301 USA
+
+*/
+
+#ifndef IGRAPH_WRITER_INTERNAL_H
+#define IGRAPH_WRITER_INTERNAL_H
+
+#include "igraph_types.h"
+#include "igraph_datatype.h"
+#include "igraph_vector.h"
+#include "igraph_strvector.h"
+#include "igraph_vector_ptr.h"
+#include "igraph_attributes.h"
+
+#include <stdio.h>
+
+#undef __BEGIN_DECLS
+#undef __END_DECLS
+#ifdef __cplusplus
+# define __BEGIN_DECLS extern "C" {
+# define __END_DECLS }
+#else
+# define __BEGIN_DECLS /* empty */
+# define __END_DECLS /* empty */
+#endif
+
+__BEGIN_DECLS
+
+/*
+ * Buffered output for the graph writers. The text is formatted into
+ * a large buffer, which is written to the stream with fwrite when it
+ * is full. Write errors are remembered and reported by
+ * igraph_i_writer_finish(), so the put functions themselves do not
+ * return anything.
+ */
+
+#define IGRAPH_I_WRITER_BUFSIZE (1 << 20)
+
+/* Space that is always enough for a formatted number */
+#define IGRAPH_I_WRITER_NUMSIZE 64
+
+typedef struct igraph_i_writer_t {
+  FILE *stream;
+  char *buf;
+  size_t pos;
+  igraph_bool_t failed;
+} igraph_i_writer_t;
+
+int igraph_i_writer_init(igraph_i_writer_t *w, FILE *stream);
+void igraph_i_writer_destroy(igraph_i_writer_t *w);
+void igraph_i_writer_flush(igraph_i_writer_t *w);
+int igraph_i_writer_finish(igraph_i_writer_t *w);
+
+void igraph_i_writer_write(igraph_i_writer_t *w, const char *s, size_t len);
+void igraph_i_writer_puts(igraph_i_writer_t *w, const char *s);
+void igraph_i_writer_long(igraph_i_writer_t *w, long int x);
+void igraph_i_writer_real(igraph_i_writer_t *w, igraph_real_t x);
+void igraph_i_writer_printf(igraph_i_writer_t *w, const char *fmt, ...);
+
+#define IGRAPH_I_WRITER_PUTC(w, c) \
+  do { \
+    if ((w)->pos == IGRAPH_I_WRITER_BUFSIZE) { \
+      igraph_i_writer_flush(w); \
+    } \
+    (w)->buf[(w)->pos++] = (c); \
+  } while (0)
+
+/*
+ * The edge ids in IGRAPH_EDGEORDER_FROM order, without creating an
+ * edge iterator. This is the order of the out-index for directed
+ * graphs and the order of the in-index for undirected ones, as every
+ * undirected edge is stored with its smaller vertex id as 'to'.
+ */
+
+#define IGRAPH_I_EDGEORDER_FROM(graph, k) \
+  ((long int) VECTOR((graph)->directed ? (graph)->oi : (graph)->ii)[(k)])
+
+/*
+ * A vertex or edge attribute, queried from the attribute handler in
+ * chunks of consecutive ids, instead of one element at a time, or
+ * all elements at once.
+ */
+
+#define IGRAPH_I_ATTR_COLUMN_CHUNK (1 << 16)
+
+typedef struct igraph_i_attr_column_t {
+  const igraph_t *graph;
+  const char *name;
+  igraph_attribute_elemtype_t elemtype;
+  igraph_attribute_type_t type;
+  long int size, chunk;
+  long int start, end;
+  igraph_vector_t num;
+  igraph_strvector_t str;
+  igraph_vector_bool_t log;
+} igraph_i_attr_column_t;
+
+int igraph_i_attr_column_init(igraph_i_attr_column_t *col,
+			      const igraph_t *graph,
+			      igraph_attribute_elemtype_t elemtype,
+			      const char *name,
+			      igraph_attribute_type_t type,
+			      long int chunk);
+void igraph_i_attr_column_destroy(igraph_i_attr_column_t *col);
+int igraph_i_attr_column_fetch(igraph_i_attr_column_t *col, long int idx);
+int igraph_i_attr_columns_init(igraph_vector_ptr_t *cols,
+			       const igraph_t *graph,
+			       igraph_attribute_elemtype_t elemtype,
+			       const igraph_strvector_t *names,
+			       const igraph_vector_t *types,
+			       long int chunk);
+
+/* Call these only after igraph_i_attr_column_fetch() for 'idx' */
+
+#define IGRAPH_I_ATTR_COLUMN_NUM(col, idx) \
+  (VECTOR((col)->num)[(idx)-(col)->start])
+#define IGRAPH_I_ATTR_COLUMN_STR(col, idx) \
+  (STR((col)->str, (idx)-(col)->start))
+#define IGRAPH_I_ATTR_COLUMN_BOOL(col, idx) \
+  (VECTOR((col)->log)[(idx)-(col)->start])
+
+__END_DECLS
+
+#endif
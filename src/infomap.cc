@@ -30,21 +30,31 @@
 */
 
 #include <cmath>
+#include <new>
 #include "igraph_interface.h"
 #include "igraph_community.h"
 #include "igraph_interrupt_internal.h"
+#include "igraph_parallel_internal.h"
 
 
 #include "infomap_Node.h"
 #include "infomap_Greedy.h"
 
 /****************************************************************************/
-int infomap_partition(FlowGraph * fgraph, bool rcall) {
+/* Partitions fgraph, a graph of single vertex nodes, in place. The
+ * graph may share its nodes with another one (see the FlowGraph copy
+ * constructor), they are not modified. This function does not use the
+ * error stack, so that the trials of igraph_community_infomap_parallel()
+ * can call it from parallel threads. If rcall is false, the interruption
+ * handler is called after every iteration, and if the computation is
+ * interrupted, *interrupted is set and the partitioning stops. */
+int infomap_partition(FlowGraph * fgraph, bool rcall, igraph_rng_t * rng,
+		      volatile int * interrupted) {
   Greedy * greedy;
 
-  // save the original graph
+  // save the original graph, fgraph is a view of its nodes from now on
   FlowGraph * cpy_fgraph = new FlowGraph(fgraph);
-  IGRAPH_FINALLY(delete_FlowGraph, cpy_fgraph);
+  cpy_fgraph->take_nodes(fgraph);
   
   int Nnode = cpy_fgraph->Nnode; 
   // "real" number of vertex, ie. number of vertex of the graph	
@@ -67,7 +77,6 @@ int infomap_partition(FlowGraph * fgraph, bool rcall) {
       initial_move = new int[Nnode];    
       // new_cluster_id --> old_cluster_id (save curent clustering state)
       
-      IGRAPH_FINALLY(operator delete [], initial_move);
       initial_move_done = false;
       
       int *subMoveTo = NULL; // enventual new partitionment of original graph
@@ -79,8 +88,6 @@ int infomap_partition(FlowGraph * fgraph, bool rcall) {
 	subMoveTo = new int[Nnode];       
 	// vid_cpy_fgraph  --> new_cluster_id (new partition)
 
-	IGRAPH_FINALLY(operator delete [], subMoveTo);
-				
 	int subModIndex = 0;
 
 	for (int i=0 ; i < fgraph->Nnode ; i++) {
@@ -88,7 +95,6 @@ int infomap_partition(FlowGraph * fgraph, bool rcall) {
 	  int sub_Nnode = fgraph->node[i]->members.size();
 	  if (sub_Nnode > 1) { // If the module is not trivial
 	    int *sub_members  = new int[sub_Nnode];      // id_sub --> id
-	    IGRAPH_FINALLY(operator delete [], sub_members); 
 	    
 	    for (int j=0 ; j < sub_Nnode ; j++)
 	      sub_members[j] = fgraph->node[i]->members[j];
@@ -96,11 +102,10 @@ int infomap_partition(FlowGraph * fgraph, bool rcall) {
 	    // extraction of the subgraph
 	    FlowGraph *sub_fgraph = new FlowGraph(cpy_fgraph, sub_Nnode, 
 						  sub_members);
-	    IGRAPH_FINALLY(delete_FlowGraph, sub_fgraph);
 	    sub_fgraph->initiate();
 	    
 	    // recursif call of partitionment on the subgraph
-	    infomap_partition(sub_fgraph, true);
+	    infomap_partition(sub_fgraph, true, rng, interrupted);
 	    
 	    // Record membership changes
 	    for (int j=0; j < sub_fgraph->Nnode; j++) {
@@ -114,9 +119,7 @@ int infomap_partition(FlowGraph * fgraph, bool rcall) {
 	    }
 	    
 	    delete sub_fgraph;
-	    IGRAPH_FINALLY_CLEAN(1);
 	    delete [] sub_members;
-	    IGRAPH_FINALLY_CLEAN(1);
 	  } else{
 	    subMoveTo[fgraph->node[i]->members[0]] = subModIndex;
 	    initial_move[subModIndex] = i;
@@ -136,16 +139,13 @@ int infomap_partition(FlowGraph * fgraph, bool rcall) {
       
       fgraph->back_to(cpy_fgraph);
       if (subMoveTo) {
-	Greedy *cpy_greedy = new Greedy(fgraph);
-	IGRAPH_FINALLY(delete_Greedy, cpy_greedy);
+	Greedy *cpy_greedy = new Greedy(fgraph, rng);
 	
 	cpy_greedy->setMove(subMoveTo);
 	cpy_greedy->apply(false);
 	
 	delete_Greedy(cpy_greedy);
-	IGRAPH_FINALLY_CLEAN(1);
 	delete [] subMoveTo;
-	IGRAPH_FINALLY_CLEAN(1);
       }
     }
     /**********************************************************************/
@@ -155,8 +155,7 @@ int infomap_partition(FlowGraph * fgraph, bool rcall) {
     
     do {
       // greedy optimizing object creation
-      greedy = new Greedy(fgraph);
-      IGRAPH_FINALLY(delete_Greedy, greedy);
+      greedy = new Greedy(fgraph, rng);
       
       // Initial move to apply ?
       if (!initial_move_done && initial_move) {
@@ -193,22 +192,22 @@ int infomap_partition(FlowGraph * fgraph, bool rcall) {
       
       // destroy greedy object
       delete greedy;
-      IGRAPH_FINALLY_CLEAN(1);
       
     } while (oldCodeLength - newCodeLength >  1.0e-10); 
     // while there is some improvement
 		
     if (iteration > 0) {
       delete [] initial_move;
-      IGRAPH_FINALLY_CLEAN(1);
     }
     
     iteration++;
-    if (!rcall) IGRAPH_ALLOW_INTERRUPTION();
+    if (!rcall) {
+      IGRAPH_I_ALLOW_INTERRUPTION_PARALLEL(*interrupted);
+      if (*interrupted) break;
+    }
   } while (outer_oldCodeLength - newCodeLength > 1.0e-10);
   
   delete cpy_fgraph;
-  IGRAPH_FINALLY_CLEAN(1);
   return IGRAPH_SUCCESS;
 }
 
@@ -280,17 +279,26 @@ int igraph_community_infomap(const igraph_t * graph,
 	
   FlowGraph * cpy_fgraph ;
   double shortestCodeLength = 1000.0;
+  volatile int interrupted = 0;
   
   // create membership vector
   int Nnode = fgraph->Nnode;
   IGRAPH_CHECK(igraph_vector_resize(membership, Nnode));
   
+  RNG_BEGIN();
+
   for (int trial = 0; trial < nb_trials; trial++) {
+    // the trials share the nodes of fgraph
     cpy_fgraph = new FlowGraph(fgraph);
     IGRAPH_FINALLY(delete_FlowGraph, cpy_fgraph);
     
     //partition the network
-    IGRAPH_CHECK(infomap_partition(cpy_fgraph, false));
+    infomap_partition(cpy_fgraph, false, igraph_rng_default(), &interrupted);
+    if (interrupted) {
+      RNG_END();
+      IGRAPH_FINALLY_FREE();
+      return IGRAPH_INTERRUPTED;
+    }
     
     // if better than the better...
     if (cpy_fgraph->codeLength < shortestCodeLength) {
@@ -308,10 +316,195 @@ int igraph_community_infomap(const igraph_t * graph,
     delete_FlowGraph(cpy_fgraph);
     IGRAPH_FINALLY_CLEAN(1);
   }
+
+  RNG_END();
   
-  *codelength = (igraph_real_t) shortestCodeLength/log(2.0);
+  if (codelength) {
+    *codelength = (igraph_real_t) shortestCodeLength/log(2.0);
+  }
   
   delete fgraph;
   IGRAPH_FINALLY_CLEAN(1);
   return IGRAPH_SUCCESS;
 }
+
+/* Per-thread workspace of igraph_community_infomap_parallel() */
+
+typedef struct infomap_i_trials_t {
+  long int nthreads;      // number of initialized random number generators
+  igraph_rng_t *rngs;     // one per thread
+  int *membership;        // best partition found by each thread,
+  double *codeLength;     // its code length
+  long int *trial;        // and the trial that found it, or -1
+} infomap_i_trials_t;
+
+static void infomap_i_trials_destroy(infomap_i_trials_t *data) {
+  for (long int t=0; t < data->nthreads; t++) {
+    igraph_rng_destroy(&data->rngs[t]);
+  }
+  delete [] data->rngs;
+  delete [] data->membership;
+  delete [] data->codeLength;
+  delete [] data->trial;
+}
+
+/** 
+ * \function igraph_community_infomap_parallel
+ * \brief Infomap community structure with parallel trials
+ * 
+ * This function is the same as \ref igraph_community_infomap(), but
+ * the trials are run in parallel threads, if igraph was compiled with
+ * OpenMP support. Every trial has its own random number generator,
+ * seeded from the default one, and among the partitions with the
+ * shortest code length the one found by the first trial is returned,
+ * so the result does not depend on the number of threads. (It is
+ * different from the result of \ref igraph_community_infomap() for
+ * the same seed, though.) The trials share the input graph and the
+ * stationary distribution, so the memory needed grows with the number
+ * of threads, not with the number of trials.
+ * 
+ * \param graph The input graph.
+ * \param e_weights Numeric vector giving the weights of the edges. 
+ *     If it is a NULL pointer then all edges will have equal
+ *     weights. The weights are expected to be positive.
+ * \param v_weights Numeric vector giving the weights of the vertices. 
+ *     If it is a NULL pointer then all vertices will have equal
+ *     weights. The weights are expected to be positive.
+ * \param nb_trials The number of attempts to partition the network
+ *     (can be any integer value equal or larger than 1).
+ * \param membership Pointer to a vector. The membership vector is
+ *    stored here. 
+ * \param codelength Pointer to a real. If not NULL the code length of the
+ *     partition is stored here.
+ * \return Error code.
+ * 
+ * \sa \ref igraph_community_infomap().
+ * 
+ * Time complexity: O(T*C/p), T is the number of trials, p is the
+ * number of threads, at most T, and C is the time of a single trial.
+ * A trial consists of greedy optimization sweeps, each one takes
+ * O(|V|+|E| log|V|) time; the number of sweeps depends on the
+ * community structure of the graph, it is typically small. Computing
+ * the stationary distribution takes O(|V|+|E|) time for each step of
+ * the power iteration, once.
+ */
+int igraph_community_infomap_parallel(const igraph_t * graph,
+				      const igraph_vector_t *e_weights,
+				      const igraph_vector_t *v_weights,
+				      int nb_trials,
+				      igraph_vector_t *membership,
+				      igraph_real_t *codelength) {
+
+  infomap_i_trials_t data;
+  igraph_vector_t seeds;
+  volatile int interrupted = 0, nomem = 0;
+  long int nthreads, t, best;
+
+  if (nb_trials < 1) {
+    IGRAPH_ERROR("Invalid number of trials", IGRAPH_EINVAL);
+  }
+
+  FlowGraph * fgraph = new FlowGraph(graph, e_weights, v_weights);
+  IGRAPH_FINALLY(delete_FlowGraph, fgraph);
+	
+  // compute stationary distribution
+  fgraph->initiate();
+  
+  // create membership vector
+  int Nnode = fgraph->Nnode;
+  IGRAPH_CHECK(igraph_vector_resize(membership, Nnode));
+
+  // the seeds of the trials
+  IGRAPH_VECTOR_INIT_FINALLY(&seeds, nb_trials);
+  RNG_BEGIN();
+  for (int trial = 0; trial < nb_trials; trial++) {
+    VECTOR(seeds)[trial] = RNG_INT31();
+  }
+  RNG_END();
+
+  nthreads = IGRAPH_I_MAX_THREADS();
+  if (nthreads > nb_trials) { nthreads = nb_trials; }
+
+  data.nthreads = 0;
+  data.rngs = new igraph_rng_t[nthreads];
+  data.membership = new int[nthreads * (long int) Nnode];
+  data.codeLength = new double[nthreads];
+  data.trial = new long int[nthreads];
+  IGRAPH_FINALLY(infomap_i_trials_destroy, &data);
+  for (t=0; t < nthreads; t++) {
+    IGRAPH_CHECK(igraph_rng_init(&data.rngs[t], &igraph_rngtype_mt19937));
+    data.nthreads++;
+    data.trial[t] = -1;
+  }
+
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+  for (int trial = 0; trial < nb_trials; trial++) {
+    long int tid = IGRAPH_I_THREAD_NUM();
+    FlowGraph * cpy_fgraph = NULL;
+    bool partitioning = false;
+    if (interrupted || nomem) { continue; }
+
+    // an exception must not leave the parallel region, it is turned
+    // into an error code after it
+    try {
+      igraph_rng_seed(&data.rngs[tid], (unsigned long) VECTOR(seeds)[trial]);
+      cpy_fgraph = new FlowGraph(fgraph);
+      partitioning = true;
+      infomap_partition(cpy_fgraph, false, &data.rngs[tid], &interrupted);
+      partitioning = false;
+
+      if (!interrupted && 
+	  (data.trial[tid] < 0 || 
+	   cpy_fgraph->codeLength < data.codeLength[tid] ||
+	   (cpy_fgraph->codeLength == data.codeLength[tid] && 
+	    trial < data.trial[tid]))) {
+	int *tmembership = data.membership + tid * (long int) Nnode;
+	data.codeLength[tid] = cpy_fgraph->codeLength;
+	data.trial[tid] = trial;
+	for (int i=0 ; i < cpy_fgraph->Nnode ; i++) {
+	  int Nmembers = cpy_fgraph->node[i]->members.size();
+	  for (int k=0; k < Nmembers; k++) {
+	    tmembership[cpy_fgraph->node[i]->members[k]] = i;
+	  }
+	}
+      }
+    } catch (std::bad_alloc &) {
+      nomem = 1;
+    }
+
+    // the nodes of a graph are not consistent after a failed
+    // partitioning, so it is not freed then
+    if (!partitioning) { delete cpy_fgraph; }
+  }
+
+  if (nomem) {
+    IGRAPH_ERROR("Infomap community detection failed", IGRAPH_ENOMEM);
+  }
+  if (interrupted) {
+    IGRAPH_FINALLY_FREE();
+    return IGRAPH_INTERRUPTED;
+  }
+
+  // the best partition, the first trial wins the ties
+  best = -1;
+  for (t=0; t < nthreads; t++) {
+    if (data.trial[t] < 0) { continue; }
+    if (best < 0 || data.codeLength[t] < data.codeLength[best] ||
+	(data.codeLength[t] == data.codeLength[best] && 
+	 data.trial[t] < data.trial[best])) {
+      best = t;
+    }
+  }
+  for (int i=0; i < Nnode; i++) {
+    VECTOR(*membership)[i] = data.membership[best * (long int) Nnode + i];
+  }
+  if (codelength) {
+    *codelength = (igraph_real_t) data.codeLength[best]/log(2.0);
+  }
+
+  infomap_i_trials_destroy(&data);
+  igraph_vector_destroy(&seeds);
+  delete fgraph;
+  IGRAPH_FINALLY_CLEAN(3);
+  return IGRAPH_SUCCESS;
+}
@@ -30,6 +30,7 @@ void FlowGraph::init(int n, const igraph_vector_t *v_weights) {
   alpha = 0.15;
   beta  = 1.0 - alpha;
   Nnode = n;
+  ownNodes = true;
   node = new Node*[Nnode];
   if (v_weights) {
     for (int i=0;i<Nnode;i++) {
@@ -87,25 +88,17 @@ FlowGraph::FlowGraph(const igraph_t * graph,
   }
 }
 
+/** construct a graph that shares the nodes of the given graph, the
+    nodes are not copied, so they must not change while this graph
+    refers to them. The greedy optimization only reads the nodes of
+    its graph and replaces them in apply(), so several trials can
+    start from the same initiated graph.
+ */
 FlowGraph::FlowGraph(FlowGraph * fgraph) {
-  int n = fgraph->Nnode;
-  init(n, NULL);
-  for (int i=0; i<n; i++) {
-    cpyNode(node[i], fgraph->node[i]);
-  }
+  init(0, NULL);
+  back_to(fgraph);
   
   //XXX: quid de danglings et Ndanglings?
-  
-  alpha = fgraph->alpha ;
-  beta  = fgraph->beta ;
-  
-  exit = fgraph->exit;
-  exitFlow = fgraph->exitFlow;
-  exit_log_exit = fgraph->exit_log_exit;
-  size_log_size = fgraph->size_log_size ;
-  nodeSize_log_nodeSize = fgraph->nodeSize_log_nodeSize;
-  
-  codeLength = fgraph->codeLength;
 }
 
 /** construct a graph by extracting a subgraph from the given graph
@@ -174,10 +167,12 @@ FlowGraph::FlowGraph(FlowGraph * fgraph, int sub_Nnode, int * sub_members) {
 
 FlowGraph::~FlowGraph() {
   //printf("delete FlowGraph !\n");
-  for (int i=0;i<Nnode;i++) {
-    delete node[i];
+  if (ownNodes) {
+    for (int i=0;i<Nnode;i++) {
+      delete node[i];
+    }
+    delete [] node;
   }
-  delete [] node;
 }
 
 void delete_FlowGraph(FlowGraph *fgraph) {
@@ -192,12 +187,15 @@ void delete_FlowGraph(FlowGraph *fgraph) {
 void FlowGraph::swap(FlowGraph * fgraph) {
   Node ** node_tmp = fgraph->node;
   int Nnode_tmp    = fgraph->Nnode;
+  bool ownNodes_tmp = fgraph->ownNodes;
   
   fgraph->node = node;
   fgraph->Nnode = Nnode;
+  fgraph->ownNodes = ownNodes;
   
   node = node_tmp;
   Nnode = Nnode_tmp;
+  ownNodes = ownNodes_tmp;
   
   calibrate();
 }
@@ -371,21 +369,20 @@ void FlowGraph::calibrate() {
 }
 
 
-/* Restore the data from the given FlowGraph object
+/* Restore the data from the given FlowGraph object, the nodes are
+ * shared with it, not copied.
  */
 void FlowGraph::back_to(FlowGraph * fgraph) {
   // delete current nodes
-  for (int i=0 ; i<Nnode ; i++) { delete node[i]; }
-  delete [] node;
+  if (ownNodes) {
+    for (int i=0 ; i<Nnode ; i++) { delete node[i]; }
+    delete [] node;
+  }
   
+  // refer to the original ones
   Nnode = fgraph->Nnode;
-
-  // copy original ones
-  node = new Node*[Nnode];
-  for (int i=0;i<Nnode;i++) {
-    node[i] = new Node();
-    cpyNode(node[i], fgraph->node[i]);
-  }
+  node = fgraph->node;
+  ownNodes = false;
   
   // restore atributs
   alpha = fgraph->alpha ;
@@ -400,4 +397,10 @@ void FlowGraph::back_to(FlowGraph * fgraph) {
   codeLength = fgraph->codeLength;
 }
 
-
+/* Take over the ownership of the nodes of the given FlowGraph object,
+ * this graph must share them (see back_to()).
+ */
+void FlowGraph::take_nodes(FlowGraph * fgraph) {
+  ownNodes = fgraph->ownNodes;
+  fgraph->ownNodes = false;
+}
@@ -54,10 +54,12 @@ class FlowGraph{
   void calibrate();
 
   void back_to(FlowGraph * fgraph);
+  void take_nodes(FlowGraph * fgraph);
 
   /*************************************************************************/
   Node **node;
   int  Nnode;
+  bool ownNodes; // false if the nodes are shared with another graph
 
   double alpha,beta;
 
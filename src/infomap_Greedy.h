@@ -37,7 +37,7 @@
 
 class Greedy {
  public:
-  Greedy(FlowGraph * fgraph); 
+  Greedy(FlowGraph * fgraph, igraph_rng_t * rng); 
   // initialise les attributs par rapport au graph
 
   ~Greedy();
@@ -56,6 +56,7 @@ class Greedy {
   /**************************************************************************/
 
   FlowGraph * graph;
+  igraph_rng_t * rng; // random node and link order in optimize()
   int Nnode; 
   
   double exit;
@@ -60,10 +60,10 @@ PottsModel::PottsModel(network *n, unsigned int qvalue, int m) : acceptance(0)
 {
   DLList_Iter<NNode*> iter;
   NNode *n_cur;
-  unsigned int *i_ptr;
   net=n;
   q=qvalue;
   operation_mode=m;
+  rng=igraph_rng_default();
   k_max=0;
   //needed in calculating modularity
   Qa     =new double[q+1];
@@ -77,20 +77,18 @@ PottsModel::PottsModel(network *n, unsigned int qvalue, int m) : acceptance(0)
   num_of_links=net->link_list->Size();
   
   n_cur=iter.First(net->node_list);
-  //these lists are needed to keep track of spin states for parallel update mode
-  new_spins=new DL_Indexed_List<unsigned int*>();
-  previous_spins=new DL_Indexed_List<unsigned int*>();
+  //these arrays are needed to keep track of spin states for parallel update mode
+  new_spins=new unsigned int[num_of_nodes+1]();
+  previous_spins=new unsigned int[num_of_nodes+1]();
   while (!iter.End())
   {
     if (k_max<n_cur->Get_Degree()) k_max=n_cur->Get_Degree();
-    i_ptr=new unsigned int;
-    *i_ptr=0;
-    new_spins->Push(i_ptr);
-    i_ptr=new unsigned int;
-    *i_ptr=0;
-    previous_spins->Push(i_ptr);
     n_cur=iter.Next();
   }
+  //the heat bath sweeps work on a flat copy of the network
+  arrays=new NetArrays(net);
+  node_spin=new unsigned int[num_of_nodes+1];
+  node_degree=new double[num_of_nodes+1];
   return;
 }
 //#######################################################
@@ -98,13 +96,11 @@ PottsModel::PottsModel(network *n, unsigned int qvalue, int m) : acceptance(0)
 //########################################################
 PottsModel::~PottsModel()
 {
-  /* The DLItem destructor does not delete its item currently, 
-     because of some bad design. As a workaround, we delete them here
-     by hand */
-  new_spins->delete_items();
-  previous_spins->delete_items();
-  delete new_spins;
-  delete previous_spins;
+  delete [] new_spins;
+  delete [] previous_spins;
+  delete arrays;
+  delete [] node_spin;
+  delete [] node_degree;
   delete [] Qa;
   delete [] weights;
   delete [] color_field;
@@ -135,7 +131,7 @@ unsigned long PottsModel::assign_initial_conf(int spin)
   n_cur=iter.First(net->node_list);
   while (!iter.End())
   {
-    if (spin<0) s=RNG_INTEGER(1,q); else s=spin;
+    if (spin<0) s=igraph_rng_get_integer(rng,1,q); else s=spin;
     n_cur->Set_ClusterIndex(s);
       l_cur=l_iter.First(n_cur->Get_Links());
       sum_weight=0;
@@ -274,6 +270,22 @@ double PottsModel::calculate_genQ(double gamma)
   return Q;
 }
 //#######################################################################
+// The energy of the current spin states, for the Hamiltonian that is
+// sampled by the heat bath sweeps, i.e. the internal link weights and
+// the penalty term in color_field. Needs an up to date Qmatrix.
+//#######################################################################
+double PottsModel::calculate_Hamiltonian(double gamma, double prob)
+{
+  double e=0.0, p;
+  if (operation_mode==0) p=prob; else p=1.0/total_degree_sum;
+  for (unsigned int i=0; i<=q; i++)
+  {
+    e-=0.5*Qmatrix[i][i];
+    e+=0.5*gamma*p*color_field[i]*color_field[i];
+  }
+  return e;
+}
+//#######################################################################
 // This function calculates the Energy for the standard Hamiltonian
 // given a particular value of gamma and the current spin states
 // #####################################################################
@@ -326,6 +338,59 @@ double PottsModel::FindStartTemp(double gamma, double prob, double ts)
   return kT;
 }
 
+//##############################################################
+// Copies the spins and the degrees of the nodes into flat arrays,
+// the sweeps below work on these and on the array-backed links,
+// and write the changed spins back into the nodes.
+//##############################################################
+void PottsModel::load_spins(void)
+{
+  DLList_Iter<NNode*> iter;
+  NNode *n_cur;
+  unsigned long i=0;
+  n_cur=iter.First(net->node_list);
+  while (!iter.End())
+  {
+    node_spin[i]=n_cur->Get_ClusterIndex();
+    node_degree[i]=n_cur->Get_Weight();
+    i++;
+    n_cur=iter.Next();
+  }
+}
+//##############################################################
+// Moves node v from old_spin to new_spin, and updates the Q matrix
+//##############################################################
+void PottsModel::move_node(unsigned long v, unsigned int old_spin, unsigned int new_spin)
+{
+  unsigned long k, kend=arrays->start[v+1];
+  unsigned int s;
+  double w;
+  node_spin[v]=new_spin;
+  net->node_list->Get(v)->Set_ClusterIndex(new_spin);
+  for (k=arrays->start[v]; k<kend; k++)
+  {
+    w=arrays->weight[k];
+    s=node_spin[arrays->neighbour[k]];
+    Qmatrix[old_spin][s]-=w;
+    Qmatrix[new_spin][s]+=w;
+    Qmatrix[s][old_spin]-=w;
+    Qmatrix[s][new_spin]+=w;
+    Qa[old_spin]-=w;
+    Qa[new_spin]+=w;
+  }
+}
+//##############################################################
+// Weight of the links of node v to each spin state, in neighbours
+//##############################################################
+void PottsModel::count_neighbours(unsigned long v)
+{
+  unsigned long k, kend=arrays->start[v+1];
+  for (unsigned int i=0; i<=q; i++) neighbours[i]=0;
+  for (k=arrays->start[v]; k<kend; k++)
+  {
+    neighbours[node_spin[arrays->neighbour[k]]]+=arrays->weight[k];
+  }
+}
 //##############################################################
 //This function does a parallel update at zero T
 //Hence, it is really fast on easy problems
@@ -334,18 +399,13 @@ double PottsModel::FindStartTemp(double gamma, double prob, double ts)
 //##############################################################
 long PottsModel::HeatBathParallelLookupZeroTemp(double gamma, double prob, unsigned int max_sweeps)
 {
-  DLList_Iter<NNode*> iter, net_iter;
-  DLList_Iter<NLink*> l_iter;
-  DLList_Iter<unsigned int*> i_iter, i_iter2;
-  NNode *node, *n_cur;
-  NLink *l_cur;
-  unsigned int *SPIN, *P_SPIN, new_spin, spin_opt, old_spin, spin, sweep;
+  unsigned int new_spin, spin_opt, old_spin, spin, sweep;
   // long h; // degree;
-  unsigned long changes;
-  double h, delta=0, deltaE, deltaEmin, w, degree;
-  //HugeArray<double> neighbours;
+  unsigned long changes, v;
+  double h, delta=0, deltaE, deltaEmin, degree;
   bool cyclic=0;
   
+  load_spins();
   sweep=0;
   changes=1;  
   while (sweep<max_sweeps && changes)
@@ -354,30 +414,13 @@ long PottsModel::HeatBathParallelLookupZeroTemp(double gamma, double prob, unsig
     sweep++;
     changes=0;
     //Loop over all nodes
-    node=net_iter.First(net->node_list);
-    SPIN=i_iter.First(new_spins);
-    while (!net_iter.End())
+    for (v=0; v<num_of_nodes; v++)
     {
       // How many neigbors of each type?
-      // set them all zero
-      for (unsigned int i=0; i<=q; i++) neighbours[i]=0;
-      degree=node->Get_Weight();
-      //Loop over all links (=neighbours)
-      l_cur=l_iter.First(node->Get_Links());
-      while (!l_iter.End())
-      {
-        //printf("%s %s\n",node->Get_Name(),n_cur->Get_Name());
-	w=l_cur->Get_Weight();
-	if (node==l_cur->Get_Start()) {
-	  n_cur=l_cur->Get_End();
-	} else { 
-	  n_cur=l_cur->Get_Start(); 
-	}
-        neighbours[n_cur->Get_ClusterIndex()]+=w;
-        l_cur=l_iter.Next();
-      }
+      count_neighbours(v);
+      degree=node_degree[v];
       //Search optimal Spin      
-      old_spin=node->Get_ClusterIndex();
+      old_spin=node_spin[v];
       //degree=node->Get_Degree();
       switch (operation_mode) {
       case 0: { 
@@ -408,56 +451,30 @@ long PottsModel::HeatBathParallelLookupZeroTemp(double gamma, double prob, unsig
       } // for spin
 
      //Put optimal spin on list for later update 
-     *SPIN=spin_opt;     
-     node=net_iter.Next();
-     SPIN=i_iter.Next();
-    } // while !net_iter.End()
+     new_spins[v]=spin_opt;     
+    } // for v
 
     //-------------------------------
     //Now set all spins to new values
-    node=net_iter.First(net->node_list);
-    SPIN=i_iter.First(new_spins);
-    P_SPIN=i_iter2.First(previous_spins);    
-    while (!net_iter.End())
+    for (v=0; v<num_of_nodes; v++)
     {
-      old_spin=node->Get_ClusterIndex();
-      new_spin=*SPIN;
+      old_spin=node_spin[v];
+      new_spin=new_spins[v];
       if (new_spin!=old_spin) // Do we really have a change??
       {
         changes++;
-        node->Set_ClusterIndex(new_spin);
 	//this is important!!
 	//In Parallel update, there occur cyclic attractors of size two
 	//which then make the program run for ever
-        if (new_spin!=*P_SPIN) cyclic=false;
-        *P_SPIN=old_spin;
+        if (new_spin!=previous_spins[v]) cyclic=false;
+        previous_spins[v]=old_spin;
         color_field[old_spin]--;
         color_field[new_spin]++;
 
         //Qmatrix update
-        //iteration over all neighbours
-        l_cur=l_iter.First(node->Get_Links());
-        while (!l_iter.End())
-        {
-	   w=l_cur->Get_Weight();
-	   if (node==l_cur->Get_Start()) {
-	     n_cur=l_cur->Get_End();
-	   } else { 
-	     n_cur=l_cur->Get_Start(); 
-	   }
-          Qmatrix[old_spin][n_cur->Get_ClusterIndex()]-=w;
-          Qmatrix[new_spin][n_cur->Get_ClusterIndex()]+=w;
-          Qmatrix[n_cur->Get_ClusterIndex()][old_spin]-=w;
-          Qmatrix[n_cur->Get_ClusterIndex()][new_spin]+=w;
-          Qa[old_spin]-=w;
-          Qa[new_spin]+=w;
-          l_cur=l_iter.Next();
-        }  // while l_iter
+        move_node(v, old_spin, new_spin);
       }
-      node=net_iter.Next();
-      SPIN=i_iter.Next();
-      P_SPIN=i_iter2.Next();
-    } // while (!net_iter.End())
+    } // for v
   }  // while markov
 
   // In case of a cyclic attractor, we want to interrupt
@@ -476,17 +493,12 @@ long PottsModel::HeatBathParallelLookupZeroTemp(double gamma, double prob, unsig
 //###################################################################################
 double PottsModel::HeatBathLookupZeroTemp(double gamma, double prob, unsigned int max_sweeps)
 {
-  DLList_Iter<NNode*> iter;
-  DLList_Iter<NLink*> l_iter;
-  DLList_Iter<unsigned int*> i_iter, i_iter2;
-  NNode *node, *n_cur;
-  NLink *l_cur;
   unsigned int new_spin, spin_opt, old_spin, spin, sweep;
   long r;// degree;
   unsigned long changes;
-  double delta=0, h, deltaE, deltaEmin,w,degree;
-  //HugeArray<int> neighbours;
+  double delta=0, h, deltaE, deltaEmin,degree;
 
+  load_spins();
   sweep=0;
   changes=0;
   while (sweep<max_sweeps)
@@ -497,29 +509,13 @@ double PottsModel::HeatBathLookupZeroTemp(double gamma, double prob, unsigned in
     {
       r=-1;
       while ((r<0) || (r>(long)num_of_nodes-1))
-	r=RNG_INTEGER(0,num_of_nodes-1);
+	r=igraph_rng_get_integer(rng,0,num_of_nodes-1);
       /* r=long(double(num_of_nodes*double(rand())/double(RAND_MAX+1.0)));*/
-      node=net->node_list->Get(r);
       // Wir zaehlen, wieviele Nachbarn von jedem spin vorhanden sind
-      // erst mal alles Null setzen
-      for (unsigned int i=0; i<=q; i++) neighbours[i]=0;
-      degree=node->Get_Weight();
-      //Loop over all links (=neighbours)
-      l_cur=l_iter.First(node->Get_Links());
-      while (!l_iter.End())
-      {
-        //printf("%s %s\n",node->Get_Name(),n_cur->Get_Name());
-	w=l_cur->Get_Weight();
-	if (node==l_cur->Get_Start()) {
-	  n_cur=l_cur->Get_End();
-	} else { 
-	  n_cur=l_cur->Get_Start(); 
-	}
-        neighbours[n_cur->Get_ClusterIndex()]+=w;
-        l_cur=l_iter.Next();
-      }
+      count_neighbours(r);
+      degree=node_degree[r];
       //Search optimal Spin      
-      old_spin=node->Get_ClusterIndex();
+      old_spin=node_spin[r];
       //degree=node->Get_Degree();
       switch (operation_mode) {
       case 0: { 
@@ -555,29 +551,11 @@ double PottsModel::HeatBathLookupZeroTemp(double gamma, double prob, unsigned in
       if (new_spin!=old_spin) // Did we really change something??
       {
         changes++;
-        node->Set_ClusterIndex(new_spin);
         color_field[old_spin]-=delta;
         color_field[new_spin]+=delta;
 
         //Qmatrix update
-        //iteration over all neighbours
-        l_cur=l_iter.First(node->Get_Links());
-        while (!l_iter.End())
-        {
-	   w=l_cur->Get_Weight();
-	   if (node==l_cur->Get_Start()) {
-	     n_cur=l_cur->Get_End();
-	   } else { 
-	     n_cur=l_cur->Get_Start(); 
-	   }
-          Qmatrix[old_spin][n_cur->Get_ClusterIndex()]-=w;
-          Qmatrix[new_spin][n_cur->Get_ClusterIndex()]+=w;
-          Qmatrix[n_cur->Get_ClusterIndex()][old_spin]-=w;
-          Qmatrix[n_cur->Get_ClusterIndex()][new_spin]+=w;
-          Qa[old_spin]-=w;
-          Qa[new_spin]+=w;
-          l_cur=l_iter.Next();
-        }  // while l_iter
+        move_node(r, old_spin, new_spin);
        }
     } // for n
   }  // while markov
@@ -590,58 +568,31 @@ double PottsModel::HeatBathLookupZeroTemp(double gamma, double prob, unsigned in
 //#####################################################################################
 long PottsModel::HeatBathParallelLookup(double gamma, double prob, double kT, unsigned int max_sweeps)
 {
-  DLList_Iter<NNode*> iter, net_iter;
-  DLList_Iter<NLink*> l_iter;
-  DLList_Iter<unsigned int*> i_iter, i_iter2;
-  NNode *node, *n_cur;
-  NLink *l_cur;
   unsigned int new_spin, spin_opt, old_spin;
-  unsigned int *SPIN, *P_SPIN;
   unsigned int sweep;
   long max_q;
-  unsigned long changes, /*degree,*/ problemcount;
-  //HugeArray<int> neighbours;
-  double h, delta=0, norm, r, beta,minweight, prefac=0,w, degree;
+  unsigned long changes, /*degree,*/ problemcount, v;
+  double h, delta=0, norm, r, beta,minweight, prefac=0, degree;
   bool cyclic=0, found;
-  unsigned long num_of_nodes;
 
+  load_spins();
   sweep=0;
   changes=1;
-  num_of_nodes=net->node_list->Size();
   while (sweep<max_sweeps && changes)
   {
     cyclic=true;
     sweep++;
     changes=0;
     //Loop over all nodes
-    node=net_iter.First(net->node_list);
-    SPIN=i_iter.First(new_spins);
-    while (!net_iter.End())
+    for (v=0; v<num_of_nodes; v++)
     {
       // Initialize neighbours and weights
       problemcount=0;
-      for (unsigned int i=0; i<=q; i++) {
-        neighbours[i]=0;
-        weights[i]=0;
-      }
+      count_neighbours(v);
       norm=0.0;
-      degree=node->Get_Weight();
-      //Loop over all links (=neighbours)
-      l_cur=l_iter.First(node->Get_Links());
-      while (!l_iter.End())
-      {
-        //printf("%s %s\n",node->Get_Name(),n_cur->Get_Name());
-	w=l_cur->Get_Weight();
-	if (node==l_cur->Get_Start()) {
-	  n_cur=l_cur->Get_End();
-	} else { 
-	  n_cur=l_cur->Get_Start(); 
-	}
-        neighbours[n_cur->Get_ClusterIndex()]+=w;
-        l_cur=l_iter.Next();
-      }
+      degree=node_degree[v];
       //Search optimal Spin      
-      old_spin=node->Get_ClusterIndex();
+      old_spin=node_spin[v];
       //degree=node->Get_Degree();
       switch (operation_mode) {
       case 0: { 
@@ -678,7 +629,7 @@ long PottsModel::HeatBathParallelLookup(double gamma, double prob, double kT, un
       }   // for spin
 
      //now choose a new spin
-     r = RNG_UNIF(0, norm);
+     r = igraph_rng_get_unif(rng, 0, norm);
      /* norm*double(rand())/double(RAND_MAX + 1.0); */
      new_spin=1;
      found=false;
@@ -695,54 +646,27 @@ long PottsModel::HeatBathParallelLookup(double gamma, double prob, double kT, un
         problemcount++;
      }
      //Put new spin on list
-     *SPIN=spin_opt;
-
-     node=net_iter.Next();
-     SPIN=i_iter.Next();
-    } // while !net_iter.End()
+     new_spins[v]=spin_opt;
+    } // for v
 
     //-------------------------------
     //now update all spins
-    node=net_iter.First(net->node_list);
-    SPIN=i_iter.First(new_spins);
-    P_SPIN=i_iter2.First(previous_spins);
-    while (!net_iter.End())
+    for (v=0; v<num_of_nodes; v++)
     {
-      old_spin=node->Get_ClusterIndex();
-      new_spin=*SPIN;
+      old_spin=node_spin[v];
+      new_spin=new_spins[v];
       if (new_spin!=old_spin) // Did we really change something??
       {
         changes++;
-        node->Set_ClusterIndex(new_spin);
-        if (new_spin!=*P_SPIN) cyclic=false;
-        *P_SPIN=old_spin;
+        if (new_spin!=previous_spins[v]) cyclic=false;
+        previous_spins[v]=old_spin;
         color_field[old_spin]-=delta;
         color_field[new_spin]+=delta;
 
         //Qmatrix update
-        //iteration over all neighbours
-        l_cur=l_iter.First(node->Get_Links());
-        while (!l_iter.End())
-        {
-	   w=l_cur->Get_Weight();
-	   if (node==l_cur->Get_Start()) {
-	     n_cur=l_cur->Get_End();
-	   } else { 
-	     n_cur=l_cur->Get_Start(); 
-	   }
-          Qmatrix[old_spin][n_cur->Get_ClusterIndex()]-=w;
-          Qmatrix[new_spin][n_cur->Get_ClusterIndex()]+=w;
-          Qmatrix[n_cur->Get_ClusterIndex()][old_spin]-=w;
-          Qmatrix[n_cur->Get_ClusterIndex()][new_spin]+=w;
-          Qa[old_spin]-=w;
-          Qa[new_spin]+=w;
-          l_cur=l_iter.Next();
-        }  // while l_iter
+        move_node(v, old_spin, new_spin);
       }
-      node=net_iter.Next();
-      SPIN=i_iter.Next();
-      P_SPIN=i_iter2.Next();
-    } // while (!net_iter.End())
+    } // for v
 
   }  // while markov
   max_q=0;
@@ -764,20 +688,15 @@ long PottsModel::HeatBathParallelLookup(double gamma, double prob, double kT, un
 //##############################################################
 double PottsModel::HeatBathLookup(double gamma, double prob, double kT, unsigned int max_sweeps)
 {
-  DLList_Iter<NNode*> iter;
-  DLList_Iter<NLink*> l_iter;
-  DLList_Iter<unsigned int*> i_iter, i_iter2;
-  NNode *node, *n_cur;
-  NLink *l_cur;
   unsigned int new_spin, spin_opt, old_spin;
   unsigned int sweep;
   long max_q, rn;
   unsigned long changes, /*degree,*/ problemcount;
-  double degree,w, delta=0, h;
-  //HugeArray<int> neighbours;
+  double degree, delta=0, h;
   double norm, r, beta,minweight, prefac=0;
   bool found;
   long int num_of_nodes;
+  load_spins();
   sweep=0;
   changes=0;
   num_of_nodes=net->node_list->Size();
@@ -789,36 +708,18 @@ double PottsModel::HeatBathLookup(double gamma, double prob, double kT, unsigned
     {
       rn=-1;
       while ((rn<0) || (rn>num_of_nodes-1))
-	rn=RNG_INTEGER(0, num_of_nodes-1);
+	rn=igraph_rng_get_integer(rng, 0, num_of_nodes-1);
       /* rn=long(double(num_of_nodes*double(rand())/double(RAND_MAX+1.0))); */
         
-      node=net->node_list->Get(rn);
       // initialize the neighbours and the weights
       problemcount=0;
-      for (unsigned int i=0; i<=q; i++) {
-        neighbours[i]=0.0;
-        weights[i]=0.0;
-      }
+      count_neighbours(rn);
       norm=0.0;
-      degree=node->Get_Weight();
-      //Loop over all links (=neighbours)
-      l_cur=l_iter.First(node->Get_Links());
-      while (!l_iter.End())
-      {
-        //printf("%s %s\n",node->Get_Name(),n_cur->Get_Name());
-	w=l_cur->Get_Weight();
-	if (node==l_cur->Get_Start()) {
-	  n_cur=l_cur->Get_End();
-	} else { 
-	  n_cur=l_cur->Get_Start(); 
-	}
-        neighbours[n_cur->Get_ClusterIndex()]+=w;
-        l_cur=l_iter.Next();
-      }
+      degree=node_degree[rn];
       
       //Look for optimal spin
       
-      old_spin=node->Get_ClusterIndex();
+      old_spin=node_spin[rn];
       //degree=node->Get_Degree();
       switch (operation_mode) {
       case 0: { 
@@ -857,7 +758,7 @@ double PottsModel::HeatBathLookup(double gamma, double prob, double kT, unsigned
 
      //choose a new spin
 /*      r = norm*double(rand())/double(RAND_MAX + 1.0); */
-     r=RNG_UNIF(0, norm);
+     r=igraph_rng_get_unif(rng, 0, norm);
      new_spin=1;
      found=false;
      while (!found && new_spin<=q) {
@@ -878,29 +779,11 @@ double PottsModel::HeatBathLookup(double gamma, double prob, double kT, unsigned
     if (new_spin!=old_spin) // Did we really change something??
     {
         changes++;
-        node->Set_ClusterIndex(new_spin);
         color_field[old_spin]-=delta;
         color_field[new_spin]+=delta;
 
         //Qmatrix update
-        //iteration over all neighbours
-        l_cur=l_iter.First(node->Get_Links());
-        while (!l_iter.End())
-        {
-	   w=l_cur->Get_Weight();
-	   if (node==l_cur->Get_Start()) {
-	     n_cur=l_cur->Get_End();
-	   } else { 
-	     n_cur=l_cur->Get_Start(); 
-	   }
-          Qmatrix[old_spin][n_cur->Get_ClusterIndex()]-=w;
-          Qmatrix[new_spin][n_cur->Get_ClusterIndex()]+=w;
-          Qmatrix[n_cur->Get_ClusterIndex()][old_spin]-=w;
-          Qmatrix[n_cur->Get_ClusterIndex()][new_spin]+=w;
-          Qa[old_spin]-=w;
-          Qa[new_spin]+=w;
-          l_cur=l_iter.Next();
-        }  // while l_iter
+        move_node(rn, old_spin, new_spin);
       }
     } // for n
   }  // while markov
@@ -1597,6 +1480,9 @@ PottsModelN::PottsModelN(network *n, unsigned int num_communities, bool directed
 	is_init = false;
 	
 	num_nodes	= net->node_list->Size();
+	
+	//The flat copy of the links used in the sweeps
+	arrays		= new NetArrays(net);
 }
 //#######################################################
 //Destructor of PottsModel
@@ -1619,6 +1505,8 @@ PottsModelN::~PottsModelN()
 	
 	delete spin;
 	
+	delete arrays;
+	
 	return;
 }
 
@@ -1804,11 +1692,6 @@ double PottsModelN::HeatBathLookup(double gamma, double lambda, double t, unsign
 	#ifdef DEBUG
 	printf("Starting sweep at temperature %f.\n", t);
 	#endif
-	DLList_Iter<NNode*> iter;
-	DLList_Iter<NLink*> l_iter;
-	DLList_Iter<unsigned int*> i_iter, i_iter2;
-	NNode *node, *n_cur;
-	NLink *l_cur;
 	/* The new_spin contains the spin to which we will update,
 	 * the spin_opt is the optional spin we will consider and
 	 * the old_spin is the spin of the node we are currently
@@ -1821,6 +1704,7 @@ double PottsModelN::HeatBathLookup(double gamma, double lambda, double t, unsign
 	double exp_old_spin; //The expectation value for the old spin
 	double exp_spin; //The expectation value for the other spin(s)
 	int v; //The node we will be investigating
+	unsigned long k, kend; //Position in the flat link arrays
 	
 	//The variables required for the calculations
 	double delta_pos_out, delta_pos_in, delta_neg_out, delta_neg_in;
@@ -1856,8 +1740,6 @@ double PottsModelN::HeatBathLookup(double gamma, double lambda, double t, unsign
 			v = RNG_INTEGER(0, num_nodes-1);
 			//We will be investigating node v
 			
-			node=net->node_list->Get(v);
-			
 			/*******************************************/
 			// initialize the neighbours and the weights
 			problemcount=0;
@@ -1867,18 +1749,12 @@ double PottsModelN::HeatBathLookup(double gamma, double lambda, double t, unsign
 			}
 
 			//Loop over all links (=neighbours)
-			l_cur=l_iter.First(node->Get_Links());
-			while (!l_iter.End())
+			kend=arrays->start[v+1];
+			for (k=arrays->start[v]; k<kend; k++)
 			{
-				w=l_cur->Get_Weight();
-				if (node==l_cur->Get_Start()) {
-					n_cur=l_cur->Get_End();
-				} else { 
-					n_cur=l_cur->Get_Start(); 
-				}
+				w=arrays->weight[k];
 				//Add the link to the correct cluster
-				neighbours[spin[n_cur->Get_Index()]]+=w;
-				l_cur=l_iter.Next();
+				neighbours[spin[arrays->neighbour[k]]]+=w;
 			}
 			//We now have the weight of the (in and out) neighbours 
 			//in each cluster available to us.
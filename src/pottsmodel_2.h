@@ -50,6 +50,7 @@
 #include "igraph_types.h"
 #include "igraph_vector.h"
 #include "igraph_matrix.h"
+#include "igraph_random.h"
 
 #define qmax 500
 
@@ -57,10 +58,14 @@ class PottsModel {
   private:
   //  HugeArray<double> neg_gammalookup;
   //  HugeArray<double> pos_gammalookup;
-    DL_Indexed_List<unsigned int*> *new_spins;
-    DL_Indexed_List<unsigned int*> *previous_spins;
+    unsigned int *new_spins;
+    unsigned int *previous_spins;
     HugeArray<HugeArray<double>*> correlation;
     network *net;
+    NetArrays *arrays;
+    unsigned int *node_spin;
+    double *node_degree;
+    igraph_rng_t *rng;
     unsigned int q;
     unsigned int operation_mode;
     FILE *Qfile, *Magfile;
@@ -74,6 +79,9 @@ class PottsModel {
     double energy;
     double acceptance;
     double *neighbours;
+    void load_spins(void);
+    void move_node(unsigned long v, unsigned int old_spin, unsigned int new_spin);
+    void count_neighbours(unsigned long v);
   public:
     PottsModel(network *net, unsigned int q, int norm_by_degree);
     ~PottsModel();
@@ -83,6 +91,7 @@ class PottsModel {
     double initialize_Qmatrix(void);
     double calculate_Q(void);
     double calculate_genQ(double gamma);
+    double calculate_Hamiltonian(double gamma, double prob);
     double FindStartTemp(double gamma, double prob,  double ts);
     long   HeatBathParallelLookupZeroTemp(double gamma, double prob, unsigned int max_sweeps);
     double HeatBathLookupZeroTemp(double gamma, double prob, unsigned int max_sweeps);
@@ -98,6 +107,7 @@ class PottsModel {
 			 double kT, double gamma);
     long   WriteSoftClusters(char *filename, double threshold);
     double Get_Energy(void) { return energy;}
+    void Set_RNG(igraph_rng_t *r) { rng=r; }
     double FindCommunityFromStart(double gamma, double prob, char *nodename,
 				  igraph_vector_t *result, 
 				  igraph_real_t *cohesion,
@@ -115,6 +125,7 @@ class PottsModelN {
     DL_Indexed_List<unsigned int*> *previous_spins;
     HugeArray<HugeArray<double>*> correlation;
     network *net;
+    NetArrays *arrays; //Flat copy of the links, for the sweeps
 		
     unsigned int q; //number of communities
     double m_p; //number of positive ties (or sum of degrees), this equals the number of edges only if it is undirected and each edge has a weight of 1
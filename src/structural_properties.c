@@ -32,6 +32,8 @@
 #include "igraph_interface.h"
 #include "igraph_progress.h"
 #include "igraph_interrupt_internal.h"
+#include "igraph_parallel_internal.h"
+#include "igraph_visitor_internal.h"
 #include "igraph_centrality.h"
 #include "igraph_components.h"
 #include "igraph_constructors.h"
@@ -105,6 +107,9 @@ int igraph_diameter(const igraph_t *graph, igraph_integer_t *pres,
   igraph_vector_int_t *neis;
   igraph_neimode_t dirmode;
   igraph_adjlist_t allneis;
+  igraph_i_bfs_engine_ws_t engine;
+  igraph_bool_t use_engine=
+    igraph_i_bfs_engine_get() == IGRAPH_BFS_DIRECTION_OPTIMIZING;
   
   if (directed) { dirmode=IGRAPH_OUT; } else { dirmode=IGRAPH_ALL; }
   already_added=igraph_Calloc(no_of_nodes, long int);
@@ -114,39 +119,61 @@ int igraph_diameter(const igraph_t *graph, igraph_integer_t *pres,
   IGRAPH_FINALLY(igraph_free, already_added);
   IGRAPH_DQUEUE_INIT_FINALLY(&q, 100);
   
-  IGRAPH_CHECK(igraph_adjlist_init(graph, &allneis, dirmode));
-  IGRAPH_FINALLY(igraph_adjlist_destroy, &allneis);
+  if (use_engine) {
+    IGRAPH_CHECK(igraph_i_bfs_engine_init(graph, &engine, dirmode));
+    IGRAPH_FINALLY(igraph_i_bfs_engine_destroy, &engine);
+  } else {
+    IGRAPH_CHECK(igraph_adjlist_init(graph, &allneis, dirmode));
+    IGRAPH_FINALLY(igraph_adjlist_destroy, &allneis);
+  }
   
   for (i=0; i<no_of_nodes; i++) {
     nodes_reached=1;
-    IGRAPH_CHECK(igraph_dqueue_push(&q, i));
-    IGRAPH_CHECK(igraph_dqueue_push(&q, 0));
-    already_added[i]=i+1;
 
     IGRAPH_PROGRESS("Diameter: ", 100.0*i/no_of_nodes, NULL);
 
     IGRAPH_ALLOW_INTERRUPTION();
-    
-    while (!igraph_dqueue_empty(&q)) {
-      long int actnode=(long int) igraph_dqueue_pop(&q);
-      long int actdist=(long int) igraph_dqueue_pop(&q);
-      if (actdist>res) { 
-        res=actdist; 
-        from=i;
-        to=actnode;
+
+    if (use_engine) {
+      /* The first reached vertex among the farthest ones */
+      long int last;
+      nodes_reached=igraph_i_bfs_engine_run(&engine, i);
+      last=nodes_reached-1;
+      while (last > 0 && engine.dist[engine.order[last-1]] == 
+	     engine.dist[engine.order[nodes_reached-1]]) {
+	last--;
       }
-      
-      neis=igraph_adjlist_get(&allneis, actnode);
-      n=igraph_vector_int_size(neis);
-      for (j=0; j<n; j++) {
-	long int neighbor=(long int) VECTOR(*neis)[j];
-	if (already_added[neighbor] == i+1) { continue; }
-	already_added[neighbor]=i+1;
-	nodes_reached++;
-	IGRAPH_CHECK(igraph_dqueue_push(&q, neighbor));
-	IGRAPH_CHECK(igraph_dqueue_push(&q, actdist+1));
+      if (engine.dist[engine.order[last]] > res) {
+	res=engine.dist[engine.order[last]];
+	from=i;
+	to=engine.order[last];
       }
-    } /* while !igraph_dqueue_empty */
+    } else {
+      IGRAPH_CHECK(igraph_dqueue_push(&q, i));
+      IGRAPH_CHECK(igraph_dqueue_push(&q, 0));
+      already_added[i]=i+1;
+
+      while (!igraph_dqueue_empty(&q)) {
+	long int actnode=(long int) igraph_dqueue_pop(&q);
+	long int actdist=(long int) igraph_dqueue_pop(&q);
+	if (actdist>res) { 
+	  res=actdist; 
+	  from=i;
+	  to=actnode;
+	}
+      
+	neis=igraph_adjlist_get(&allneis, actnode);
+	n=igraph_vector_int_size(neis);
+	for (j=0; j<n; j++) {
+	  long int neighbor=(long int) VECTOR(*neis)[j];
+	  if (already_added[neighbor] == i+1) { continue; }
+	  already_added[neighbor]=i+1;
+	  nodes_reached++;
+	  IGRAPH_CHECK(igraph_dqueue_push(&q, neighbor));
+	  IGRAPH_CHECK(igraph_dqueue_push(&q, actdist+1));
+	}
+      } /* while !igraph_dqueue_empty */
+    }
     
     /* not connected, return largest possible */
     if (nodes_reached != no_of_nodes && !unconn) {
@@ -187,9 +214,13 @@ int igraph_diameter(const igraph_t *graph, igraph_integer_t *pres,
   }
   
   /* clean */
+  if (use_engine) {
+    igraph_i_bfs_engine_destroy(&engine);
+  } else {
+    igraph_adjlist_destroy(&allneis);
+  }
   igraph_Free(already_added);
   igraph_dqueue_destroy(&q);
-  igraph_adjlist_destroy(&allneis);
   IGRAPH_FINALLY_CLEAN(3);
 
   return 0;
@@ -232,6 +263,9 @@ int igraph_average_path_length(const igraph_t *graph, igraph_real_t *res,
   igraph_vector_int_t *neis;
   igraph_neimode_t dirmode;
   igraph_adjlist_t allneis;
+  igraph_i_bfs_engine_ws_t engine;
+  igraph_bool_t use_engine=
+    igraph_i_bfs_engine_get() == IGRAPH_BFS_DIRECTION_OPTIMIZING;
 
   *res=0;  
   if (directed) { dirmode=IGRAPH_OUT; } else { dirmode=IGRAPH_ALL; }
@@ -242,34 +276,48 @@ int igraph_average_path_length(const igraph_t *graph, igraph_real_t *res,
   IGRAPH_FINALLY(free, already_added); /* TODO: hack */
   IGRAPH_DQUEUE_INIT_FINALLY(&q, 100);
 
-  igraph_adjlist_init(graph, &allneis, dirmode);
-  IGRAPH_FINALLY(igraph_adjlist_destroy, &allneis);
+  if (use_engine) {
+    IGRAPH_CHECK(igraph_i_bfs_engine_init(graph, &engine, dirmode));
+    IGRAPH_FINALLY(igraph_i_bfs_engine_destroy, &engine);
+  } else {
+    igraph_adjlist_init(graph, &allneis, dirmode);
+    IGRAPH_FINALLY(igraph_adjlist_destroy, &allneis);
+  }
 
   for (i=0; i<no_of_nodes; i++) {
     nodes_reached=0;
-    IGRAPH_CHECK(igraph_dqueue_push(&q, i));
-    IGRAPH_CHECK(igraph_dqueue_push(&q, 0));
-    already_added[i]=i+1;
 
     IGRAPH_ALLOW_INTERRUPTION();
-    
-    while (!igraph_dqueue_empty(&q)) {
-      long int actnode=(long int) igraph_dqueue_pop(&q);
-      long int actdist=(long int) igraph_dqueue_pop(&q);
-    
-      neis=igraph_adjlist_get(&allneis, actnode);
-      n=igraph_vector_int_size(neis);
-      for (j=0; j<n; j++) {
-	long int neighbor=(long int) VECTOR(*neis)[j];
-	if (already_added[neighbor] == i+1) { continue; }
-	already_added[neighbor]=i+1;
-	nodes_reached++;
-	*res += actdist+1;
-	normfact+=1;
-	IGRAPH_CHECK(igraph_dqueue_push(&q, neighbor));
-	IGRAPH_CHECK(igraph_dqueue_push(&q, actdist+1));
+
+    if (use_engine) {
+      nodes_reached=igraph_i_bfs_engine_run(&engine, i) - 1;
+      for (j=1; j<=nodes_reached; j++) {
+	*res += engine.dist[engine.order[j]];
       }
-    } /* while !igraph_dqueue_empty */
+      normfact += nodes_reached;
+    } else {
+      IGRAPH_CHECK(igraph_dqueue_push(&q, i));
+      IGRAPH_CHECK(igraph_dqueue_push(&q, 0));
+      already_added[i]=i+1;
+
+      while (!igraph_dqueue_empty(&q)) {
+	long int actnode=(long int) igraph_dqueue_pop(&q);
+	long int actdist=(long int) igraph_dqueue_pop(&q);
+    
+	neis=igraph_adjlist_get(&allneis, actnode);
+	n=igraph_vector_int_size(neis);
+	for (j=0; j<n; j++) {
+	  long int neighbor=(long int) VECTOR(*neis)[j];
+	  if (already_added[neighbor] == i+1) { continue; }
+	  already_added[neighbor]=i+1;
+	  nodes_reached++;
+	  *res += actdist+1;
+	  normfact+=1;
+	  IGRAPH_CHECK(igraph_dqueue_push(&q, neighbor));
+	  IGRAPH_CHECK(igraph_dqueue_push(&q, actdist+1));
+	}
+      } /* while !igraph_dqueue_empty */
+    }
     
     /* not connected, return largest possible */
     if (!unconn) {
@@ -281,9 +329,13 @@ int igraph_average_path_length(const igraph_t *graph, igraph_real_t *res,
   *res /= normfact;
 
   /* clean */
+  if (use_engine) {
+    igraph_i_bfs_engine_destroy(&engine);
+  } else {
+    igraph_adjlist_destroy(&allneis);
+  }
   igraph_Free(already_added);
   igraph_dqueue_destroy(&q);
-  igraph_adjlist_destroy(&allneis);
   IGRAPH_FINALLY_CLEAN(3);
 
   return 0;
@@ -468,6 +520,9 @@ int igraph_shortest_paths(const igraph_t *graph, igraph_matrix_t *res,
   igraph_vit_t fromvit, tovit;
   igraph_real_t my_infinity=IGRAPH_INFINITY;
   igraph_vector_t indexv;
+  igraph_i_bfs_engine_ws_t engine;
+  igraph_bool_t use_engine=
+    igraph_i_bfs_engine_get() == IGRAPH_BFS_DIRECTION_OPTIMIZING;
 
   if (mode != IGRAPH_OUT && mode != IGRAPH_IN && 
       mode != IGRAPH_ALL) {
@@ -478,8 +533,13 @@ int igraph_shortest_paths(const igraph_t *graph, igraph_matrix_t *res,
   IGRAPH_FINALLY(igraph_vit_destroy, &fromvit);
   no_of_from=IGRAPH_VIT_SIZE(fromvit);
 
-  IGRAPH_CHECK(igraph_adjlist_init(graph, &adjlist, mode));
-  IGRAPH_FINALLY(igraph_adjlist_destroy, &adjlist);
+  if (use_engine) {
+    IGRAPH_CHECK(igraph_i_bfs_engine_init(graph, &engine, mode));
+    IGRAPH_FINALLY(igraph_i_bfs_engine_destroy, &engine);
+  } else {
+    IGRAPH_CHECK(igraph_adjlist_init(graph, &adjlist, mode));
+    IGRAPH_FINALLY(igraph_adjlist_destroy, &adjlist);
+  }
 
   already_counted=igraph_Calloc(no_of_nodes, long int);
   if (already_counted==0) {
@@ -512,6 +572,22 @@ int igraph_shortest_paths(const igraph_t *graph, igraph_matrix_t *res,
        !IGRAPH_VIT_END(fromvit); 
        IGRAPH_VIT_NEXT(fromvit), i++) {
     long int reached=0;
+
+    if (use_engine) {
+      long int k, nreached;
+      IGRAPH_ALLOW_INTERRUPTION();
+      nreached=igraph_i_bfs_engine_run(&engine, IGRAPH_VIT_GET(fromvit));
+      for (k=0; k<nreached; k++) {
+	long int v=engine.order[k];
+	if (all_to) {
+	  MATRIX(*res, i, v)=engine.dist[v];
+	} else if (VECTOR(indexv)[v]) {
+	  MATRIX(*res, i, (long int)(VECTOR(indexv)[v]-1)) = engine.dist[v];
+	}
+      }
+      continue;
+    }
+
     IGRAPH_CHECK(igraph_dqueue_push(&q, IGRAPH_VIT_GET(fromvit)));
     IGRAPH_CHECK(igraph_dqueue_push(&q, 0));
     already_counted[ (long int) IGRAPH_VIT_GET(fromvit) ] = i+1;
@@ -556,12 +632,111 @@ int igraph_shortest_paths(const igraph_t *graph, igraph_matrix_t *res,
   igraph_Free(already_counted);
   igraph_dqueue_destroy(&q);
   igraph_vit_destroy(&fromvit);
-  igraph_adjlist_destroy(&adjlist);
+  if (use_engine) {
+    igraph_i_bfs_engine_destroy(&engine);
+  } else {
+    igraph_adjlist_destroy(&adjlist);
+  }
   IGRAPH_FINALLY_CLEAN(4);
 
   return 0;
 }
 
+/**
+ * \ingroup structural
+ * \function igraph_shortest_paths_csr
+ * \brief Unweighted shortest path lengths on a CSR snapshot.
+ *
+ * This function does the same calculation as \ref
+ * igraph_shortest_paths(), from the given source vertices to all
+ * vertices, but it works on a read-only CSR snapshot of the graph,
+ * see \ref igraph_csr_init(). The paths follow the edges in the
+ * direction given by the mode of the snapshot.
+ * \param csr The CSR snapshot of the graph.
+ * \param res Pointer to an initialized matrix, it will be resized to
+ *        have a row for each source vertex, and a column for each
+ *        vertex of the graph. For the unreachable vertices
+ *        IGRAPH_INFINITY is returned.
+ * \param from Vector of the source vertex ids, or a null pointer to
+ *        use all vertices.
+ * \return Error code:
+ *        \clist
+ *        \cli IGRAPH_ENOMEM 
+ *           not enough memory for temporary data.
+ *        \cli IGRAPH_EINVVID
+ *           invalid vertex id passed.
+ *        \endclist
+ * 
+ * Time complexity: O(n(|V|+|E|)), n is the number of source
+ * vertices, |V| and |E| are the number of vertices and edges in the
+ * graph.
+ *
+ * \sa \ref igraph_shortest_paths() for the version that works on
+ * <type>igraph_t</type> objects.
+ */
+
+int igraph_shortest_paths_csr(const igraph_csr_t *csr, igraph_matrix_t *res,
+			      const igraph_vector_int_t *from) {
+
+  long int no_of_nodes=csr->length;
+  long int no_of_from= from ? igraph_vector_int_size(from) : no_of_nodes;
+  igraph_vector_int_t queue, dist;
+  int *q, *dd;
+  long int i, j;
+
+  if (from && no_of_from > 0 &&
+      (igraph_vector_int_min(from) < 0 || 
+       igraph_vector_int_max(from) >= no_of_nodes)) {
+    IGRAPH_ERROR("Invalid source vertex", IGRAPH_EINVVID);
+  }
+
+  IGRAPH_CHECK(igraph_vector_int_init(&queue, no_of_nodes));
+  IGRAPH_FINALLY(igraph_vector_int_destroy, &queue);
+  IGRAPH_CHECK(igraph_vector_int_init(&dist, no_of_nodes));
+  IGRAPH_FINALLY(igraph_vector_int_destroy, &dist);
+  IGRAPH_CHECK(igraph_matrix_resize(res, no_of_from, no_of_nodes));
+  igraph_matrix_fill(res, IGRAPH_INFINITY);
+
+  q=VECTOR(queue); dd=VECTOR(dist);
+  igraph_vector_int_fill(&dist, -1);
+
+  for (i=0; i<no_of_from; i++) {
+    long int source= from ? VECTOR(*from)[i] : i;
+    long int qhead=0, qtail=0;
+
+    IGRAPH_ALLOW_INTERRUPTION();
+
+    q[qtail++]=(int) source;
+    dd[source]=0;
+    while (qhead < qtail) {
+      long int act=q[qhead++];
+      int *neis=igraph_csr_neighbors(csr, act);
+      long int n=igraph_csr_degree(csr, act);
+      int actdist=dd[act]+1;
+      for (j=0; j<n; j++) {
+	long int nei=neis[j];
+	if (dd[nei] < 0) {
+	  dd[nei]=actdist;
+	  q[qtail++]=(int) nei;
+	}
+      }
+    }
+
+    /* Copy the distances and reset the reached vertices only */
+    for (j=0; j<qtail; j++) {
+      long int v=q[j];
+      MATRIX(*res, i, v) = dd[v];
+      dd[v] = -1;
+    }
+  }
+
+  igraph_vector_int_destroy(&dist);
+  igraph_vector_int_destroy(&queue);
+  IGRAPH_FINALLY_CLEAN(2);
+
+  return 0;
+}
+
 /**
  * \ingroup structural
  * \function igraph_get_shortest_paths
@@ -5510,7 +5685,7 @@ int igraph_shortest_paths_johnson(const igraph_t *graph,
       for (j=0, IGRAPH_VIT_RESET(tovit); j<nc; j++, IGRAPH_VIT_NEXT(tovit)) {
 	long int v2=IGRAPH_VIT_GET(tovit);
 	igraph_real_t sub=MATRIX(bfres, 0, v1) - MATRIX(bfres, 0, v2);
-	MATRIX(*res, i, v2) -= sub;
+	MATRIX(*res, i, j) -= sub;
       }
       igraph_vit_destroy(&tovit);
       IGRAPH_FINALLY_CLEAN(1);
@@ -5524,6 +5699,426 @@ int igraph_shortest_paths_johnson(const igraph_t *graph,
   return 0;
 }
 
+/* Potentials for reweighting a graph with negative edge weights, see
+   igraph_shortest_paths_johnson(). After the reweighting
+   w(u,v) + h(u) - h(v) is non-negative for every edge that is
+   followed from u to v in the given mode. */
+
+static int igraph_i_shortest_paths_potential(const igraph_t *graph,
+					     const igraph_vector_t *weights,
+					     igraph_neimode_t mode,
+					     igraph_vector_t *h) {
+  long int no_of_nodes=igraph_vcount(graph);
+  long int no_of_edges=igraph_ecount(graph);
+  igraph_t newgraph;
+  igraph_vector_t edges, newweights;
+  igraph_matrix_t bfres;
+  long int i, ptr;
+
+  IGRAPH_MATRIX_INIT_FINALLY(&bfres, 0, 0);
+  IGRAPH_VECTOR_INIT_FINALLY(&newweights, 0);
+
+  IGRAPH_CHECK(igraph_empty(&newgraph, (igraph_integer_t) no_of_nodes+1, 
+			    IGRAPH_DIRECTED));
+  IGRAPH_FINALLY(igraph_destroy, &newgraph);
+
+  /* A new vertex, with zero weight edges to (or, for IGRAPH_IN, from)
+     all the others */
+  IGRAPH_VECTOR_INIT_FINALLY(&edges, no_of_edges*2 + no_of_nodes*2);
+  igraph_get_edgelist(graph, &edges, /*bycol=*/ 0);
+  igraph_vector_resize(&edges, no_of_edges * 2 + no_of_nodes * 2);
+  for (i=0, ptr=no_of_edges*2; i<no_of_nodes; i++) {
+    VECTOR(edges)[ptr++] = mode==IGRAPH_OUT ? no_of_nodes : i;
+    VECTOR(edges)[ptr++] = mode==IGRAPH_OUT ? i : no_of_nodes;
+  }
+  IGRAPH_CHECK(igraph_add_edges(&newgraph, &edges, 0));
+  igraph_vector_destroy(&edges);
+  IGRAPH_FINALLY_CLEAN(1);
+
+  IGRAPH_CHECK(igraph_vector_reserve(&newweights, no_of_edges+no_of_nodes));
+  igraph_vector_update(&newweights, weights);
+  igraph_vector_resize(&newweights, no_of_edges+no_of_nodes);
+  for (i=no_of_edges; i<no_of_edges+no_of_nodes; i++) {
+    VECTOR(newweights)[i] = 0;
+  }
+
+  IGRAPH_CHECK(igraph_shortest_paths_bellman_ford(&newgraph, &bfres,
+				  igraph_vss_1((igraph_integer_t) no_of_nodes),
+				  igraph_vss_all(), &newweights, mode));
+
+  IGRAPH_CHECK(igraph_vector_resize(h, no_of_nodes));
+  for (i=0; i<no_of_nodes; i++) {
+    VECTOR(*h)[i] = MATRIX(bfres, 0, i);
+  }
+
+  igraph_destroy(&newgraph);
+  igraph_vector_destroy(&newweights);
+  igraph_matrix_destroy(&bfres);
+  IGRAPH_FINALLY_CLEAN(3);
+
+  return 0;
+}
+
+/* The maximum number of distances buffered by
+   igraph_shortest_paths_callback(), unless there are very long rows */
+#define IGRAPH_I_SP_CALLBACK_BUFFER (1L << 22)
+
+typedef struct igraph_i_sp_callback_ws_t {
+  igraph_real_t *dist;		/* IGRAPH_INFINITY if not reached */
+  int *order;			/* the reached vertices */
+  igraph_2wheap_t Q;
+  igraph_bool_t Q_init;
+} igraph_i_sp_callback_ws_t;
+
+typedef struct igraph_i_sp_callback_data_t {
+  igraph_csr_t csr;
+  igraph_bool_t csr_init;
+  const igraph_vector_t *weights;
+  igraph_vector_t potential;	/* empty, unless there are negative weights */
+  igraph_vector_t sources, targets;
+  long int *targetcount;	/* multiplicity of the vertices in 'to' */
+  igraph_bool_t all_to;
+  long int no_of_to;
+  long int nthreads;
+  igraph_i_sp_callback_ws_t *ws;
+  igraph_real_t *rows;
+} igraph_i_sp_callback_data_t;
+
+static void igraph_i_sp_callback_data_destroy(igraph_i_sp_callback_data_t *data) {
+  long int t;
+  for (t=0; t<data->nthreads && data->ws; t++) {
+    igraph_i_sp_callback_ws_t *ws=&data->ws[t];
+    igraph_Free(ws->dist);
+    igraph_Free(ws->order);
+    if (ws->Q_init) {
+      igraph_2wheap_destroy(&ws->Q);
+    }
+  }
+  igraph_Free(data->ws);
+  igraph_Free(data->rows);
+  igraph_Free(data->targetcount);
+  if (data->csr_init) {
+    igraph_csr_destroy(&data->csr);
+  }
+  igraph_vector_destroy(&data->targets);
+  igraph_vector_destroy(&data->sources);
+  igraph_vector_destroy(&data->potential);
+}
+
+/* Computes the distances from 'source' and writes them to 'row'. This
+   is called in a parallel region, it must not allocate memory or
+   report errors. */
+
+static void igraph_i_sp_callback_row(const igraph_i_sp_callback_data_t *data,
+				     igraph_i_sp_callback_ws_t *ws,
+				     long int source, igraph_real_t *row) {
+  const igraph_csr_t *csr=&data->csr;
+  long int no_of_nodes=csr->length;
+  igraph_real_t *dist=ws->dist;
+  int *order=ws->order;
+  long int nord=0, reached=0, j;
+  igraph_bool_t johnson=igraph_vector_size(&data->potential) > 0;
+  igraph_real_t *h=VECTOR(data->potential);
+
+  dist[source]=0.0;
+  order[nord++]=(int) source;
+
+  if (!data->weights) {
+    long int qhead=0;
+    reached += data->all_to ? 1 : data->targetcount[source];
+    while (qhead < nord && reached < data->no_of_to) {
+      long int act=order[qhead++];
+      int *neis=igraph_csr_neighbors(csr, act);
+      long int n=igraph_csr_degree(csr, act);
+      igraph_real_t actdist=dist[act]+1.0;
+      for (j=0; j<n; j++) {
+	long int nei=neis[j];
+	if (dist[nei] == IGRAPH_INFINITY) {
+	  dist[nei]=actdist;
+	  order[nord++]=(int) nei;
+	  reached += data->all_to ? 1 : data->targetcount[nei];
+	}
+      }
+    }
+  } else {
+    igraph_real_t *weights=VECTOR(*data->weights);
+    igraph_2wheap_t *Q=&ws->Q;
+
+    /* The heap has enough space reserved, so pushing cannot fail */
+    igraph_2wheap_push_with_index(Q, source, 0);
+    while (!igraph_2wheap_empty(Q)) {
+      long int minnei=igraph_2wheap_max_index(Q);
+      igraph_real_t mindist=-igraph_2wheap_delete_max(Q);
+      int *neis, *eids;
+      long int nlen;
+
+      reached += data->all_to ? 1 : data->targetcount[minnei];
+      if (reached == data->no_of_to) { break; }
+
+      neis=igraph_csr_neighbors(csr, minnei);
+      eids=igraph_csr_incident(csr, minnei);
+      nlen=igraph_csr_degree(csr, minnei);
+      for (j=0; j<nlen; j++) {
+	long int to=neis[j];
+	igraph_real_t w=weights[eids[j]];
+	igraph_real_t altdist;
+	if (johnson) {
+	  /* Might be slightly negative because of rounding */
+	  w += h[minnei] - h[to];
+	  if (w < 0) { w=0; }
+	}
+	altdist=mindist + w;
+	if (dist[to] == IGRAPH_INFINITY) {
+	  dist[to]=altdist;
+	  order[nord++]=(int) to;
+	  igraph_2wheap_push_with_index(Q, to, -altdist);
+	} else if (altdist < dist[to]) {
+	  dist[to]=altdist;
+	  igraph_2wheap_modify(Q, to, -altdist);
+	}
+      }
+    }
+
+    /* Stopped early, clear the heap without touching all vertices */
+    if (!igraph_2wheap_empty(Q)) {
+      long int k, size=igraph_2wheap_size(Q);
+      for (k=0; k<size; k++) {
+	VECTOR(Q->index2)[ VECTOR(Q->index)[k] ]=0;
+      }
+      igraph_vector_clear(&Q->data);
+      igraph_vector_long_clear(&Q->index);
+    }
+  }
+
+  /* Undo the reweighting, this is only needed for the reached vertices */
+  if (johnson) {
+    for (j=0; j<nord; j++) {
+      long int v=order[j];
+      dist[v] += h[v] - h[source];
+    }
+  }
+
+  if (data->all_to) {
+    for (j=0; j<no_of_nodes; j++) {
+      row[j]=IGRAPH_INFINITY;
+    }
+    for (j=0; j<nord; j++) {
+      long int v=order[j];
+      row[v]=dist[v];
+    }
+  } else {
+    igraph_real_t *targets=VECTOR(data->targets);
+    for (j=0; j<data->no_of_to; j++) {
+      row[j]=dist[(long int) targets[j]];
+    }
+  }
+
+  for (j=0; j<nord; j++) {
+    dist[order[j]]=IGRAPH_INFINITY;
+  }
+}
+
+/**
+ * \function igraph_shortest_paths_callback
+ * \brief Shortest path lengths from many sources, passed to a callback.
+ *
+ * This function calculates the same shortest path lengths as \ref
+ * igraph_shortest_paths(), \ref igraph_shortest_paths_dijkstra() or
+ * \ref igraph_shortest_paths_johnson(), but instead of collecting them
+ * into a matrix with a row for each source vertex, it hands the rows
+ * to a callback function, one by one. Only a small number of rows are
+ * stored at any time, so this function can calculate the distances
+ * from a very large number of sources, e.g. from all vertices of a
+ * large graph, if the rows are aggregated or written to a file by the
+ * callback.
+ *
+ * </para><para>
+ * If igraph was compiled with OpenMP support, then the rows are
+ * calculated in parallel, in blocks of a few rows per thread. The
+ * callback is always called from the calling thread, and in the order
+ * of the source vertices in \p from, so it may use any igraph
+ * function.
+ *
+ * \param graph The input graph.
+ * \param from The source vertices. A vertex might be given multiple
+ *    times, and then the callback is called for it multiple times.
+ * \param to The target vertices. A vertex might be given multiple
+ *    times.
+ * \param weights The edge weights, or a null pointer for unweighted
+ *    shortest paths. If there are negative weights, then Johnson's
+ *    reweighting is used, see \ref igraph_shortest_paths_johnson(); this
+ *    only works for directed graphs, if \p mode is \c IGRAPH_OUT or
+ *    \c IGRAPH_IN, and if there is no negative cycle.
+ * \param mode For directed graphs; whether to follow paths along edge
+ *    directions (\c IGRAPH_OUT), or the opposite (\c IGRAPH_IN), or
+ *    ignore edge directions completely (\c IGRAPH_ALL). It is ignored 
+ *    for undirected graphs.
+ * \param callback The function to call for each source vertex, see
+ *    \ref igraph_shortest_paths_handler_t.
+ * \param arg Extra argument to pass to the callback function.
+ * \return Error code.
+ *
+ * Time complexity: O(s(|V|+|E|)) for unweighted graphs, and
+ * O(s|E|log|V|+|V||E|) for weighted graphs, where s is the number of
+ * sources, |V| is the number of vertices, |E| the number of edges.
+ * (The O(|V||E|) term is for the Bellman-Ford algorithm and it is only
+ * needed if there are negative weights.) The search from a source
+ * stops when all vertices in \p to are reached.
+ *
+ * \example examples/simple/igraph_shortest_paths_callback.c
+ */
+
+int igraph_shortest_paths_callback(const igraph_t *graph,
+				   const igraph_vs_t from,
+				   const igraph_vs_t to,
+				   const igraph_vector_t *weights,
+				   igraph_neimode_t mode,
+				   igraph_shortest_paths_handler_t *callback,
+				   void *arg) {
+
+  long int no_of_nodes=igraph_vcount(graph);
+  long int no_of_edges=igraph_ecount(graph);
+  igraph_i_sp_callback_data_t data;
+  igraph_vit_t vit;
+  long int no_of_from, blocksize, block, i, t;
+
+  if (mode != IGRAPH_OUT && mode != IGRAPH_IN && mode != IGRAPH_ALL) {
+    IGRAPH_ERROR("Invalid mode argument", IGRAPH_EINVMODE);
+  }
+  if (!igraph_is_directed(graph)) {
+    mode=IGRAPH_ALL;
+  }
+  if (weights) {
+    if (igraph_vector_size(weights) != no_of_edges) {
+      IGRAPH_ERROR("Weight vector length does not match", IGRAPH_EINVAL);
+    }
+    if (no_of_edges > 0 && igraph_vector_min(weights) < 0 && 
+	mode == IGRAPH_ALL) {
+      IGRAPH_ERROR("Negative weights are not allowed for undirected paths",
+		   IGRAPH_EINVAL);
+    }
+  }
+
+  memset(&data, 0, sizeof(data));
+  data.weights=weights;
+  IGRAPH_VECTOR_INIT_FINALLY(&data.potential, 0);
+  IGRAPH_VECTOR_INIT_FINALLY(&data.sources, 0);
+  IGRAPH_VECTOR_INIT_FINALLY(&data.targets, 0);
+  IGRAPH_FINALLY_CLEAN(3);
+  IGRAPH_FINALLY(igraph_i_sp_callback_data_destroy, &data);
+
+  IGRAPH_CHECK(igraph_vit_create(graph, from, &vit));
+  IGRAPH_FINALLY(igraph_vit_destroy, &vit);
+  IGRAPH_CHECK(igraph_vit_as_vector(&vit, &data.sources));
+  igraph_vit_destroy(&vit);
+  IGRAPH_FINALLY_CLEAN(1);
+  no_of_from=igraph_vector_size(&data.sources);
+
+  if ( (data.all_to=igraph_vs_is_all(&to)) ) {
+    data.no_of_to=no_of_nodes;
+  } else {
+    IGRAPH_CHECK(igraph_vit_create(graph, to, &vit));
+    IGRAPH_FINALLY(igraph_vit_destroy, &vit);
+    IGRAPH_CHECK(igraph_vit_as_vector(&vit, &data.targets));
+    igraph_vit_destroy(&vit);
+    IGRAPH_FINALLY_CLEAN(1);
+    data.no_of_to=igraph_vector_size(&data.targets);
+    data.targetcount=igraph_Calloc(no_of_nodes > 0 ? no_of_nodes : 1, 
+				   long int);
+    if (!data.targetcount) {
+      IGRAPH_ERROR("Cannot calculate shortest paths", IGRAPH_ENOMEM);
+    }
+    for (i=0; i<data.no_of_to; i++) {
+      data.targetcount[(long int) VECTOR(data.targets)[i]] += 1;
+    }
+  }
+
+  if (no_of_from == 0) {
+    igraph_i_sp_callback_data_destroy(&data);
+    IGRAPH_FINALLY_CLEAN(1);
+    return 0;
+  }
+
+  if (weights && no_of_edges > 0 && igraph_vector_min(weights) < 0) {
+    IGRAPH_CHECK(igraph_i_shortest_paths_potential(graph, weights, mode,
+						   &data.potential));
+  }
+
+  IGRAPH_CHECK(igraph_csr_init(graph, &data.csr, mode));
+  data.csr_init=1;
+
+  /* A few rows per thread in each block, so that the threads that
+     finish early have something to do, but not too many if the rows
+     are long */
+  data.nthreads=IGRAPH_I_MAX_THREADS();
+  if (data.nthreads > no_of_from) {
+    data.nthreads=no_of_from;
+  }
+  blocksize=IGRAPH_I_SP_CALLBACK_BUFFER / (data.no_of_to > 0 ? data.no_of_to : 1);
+  if (blocksize > 4 * data.nthreads) {
+    blocksize=4 * data.nthreads;
+  }
+  if (blocksize < data.nthreads) {
+    blocksize=data.nthreads;
+  }
+
+  data.rows=igraph_Calloc(blocksize * data.no_of_to > 0 ? 
+			  blocksize * data.no_of_to : 1, igraph_real_t);
+  data.ws=igraph_Calloc(data.nthreads, igraph_i_sp_callback_ws_t);
+  if (!data.rows || !data.ws) {
+    IGRAPH_ERROR("Cannot calculate shortest paths", IGRAPH_ENOMEM);
+  }
+  for (t=0; t<data.nthreads; t++) {
+    igraph_i_sp_callback_ws_t *ws=&data.ws[t];
+    ws->dist=igraph_Calloc(no_of_nodes, igraph_real_t);
+    ws->order=igraph_Calloc(no_of_nodes, int);
+    if (!ws->dist || !ws->order) {
+      IGRAPH_ERROR("Cannot calculate shortest paths", IGRAPH_ENOMEM);
+    }
+    for (i=0; i<no_of_nodes; i++) {
+      ws->dist[i]=IGRAPH_INFINITY;
+    }
+    if (weights) {
+      /* Reserve the full size, so that the heap never needs to grow
+	 in the parallel part */
+      IGRAPH_CHECK(igraph_2wheap_init(&ws->Q, no_of_nodes));
+      ws->Q_init=1;
+      IGRAPH_CHECK(igraph_vector_reserve(&ws->Q.data, no_of_nodes));
+      IGRAPH_CHECK(igraph_vector_long_reserve(&ws->Q.index, no_of_nodes));
+    }
+  }
+
+  for (block=0; block < no_of_from; block += blocksize) {
+    long int nrows= no_of_from-block < blocksize ? no_of_from-block : blocksize;
+    long int k;
+
+    IGRAPH_ALLOW_INTERRUPTION();
+
+    /* Each row goes to its own slot, the schedule does not matter */
+#pragma omp parallel for num_threads((int) data.nthreads) schedule(dynamic, 1)
+    for (k=0; k<nrows; k++) {
+      igraph_i_sp_callback_row(&data, &data.ws[IGRAPH_I_THREAD_NUM()],
+			       (long int) VECTOR(data.sources)[block+k],
+			       data.rows + k * data.no_of_to);
+    }
+
+    for (k=0; k<nrows; k++) {
+      igraph_vector_t row;
+      igraph_vector_view(&row, data.rows + k * data.no_of_to, data.no_of_to);
+      if (!callback((igraph_integer_t) VECTOR(data.sources)[block+k],
+		    &row, arg)) {
+	block=no_of_from;
+	break;
+      }
+    }
+  }
+
+  igraph_i_sp_callback_data_destroy(&data);
+  IGRAPH_FINALLY_CLEAN(1);
+
+  return 0;
+}
+
 /**
  * \function igraph_unfold_tree
  * Unfolding a graph into a tree, by possibly multiplicating its vertices.
@@ -25,6 +25,7 @@
 #include "igraph_interface.h"
 #include "igraph_attributes.h"
 #include "igraph_memory.h"
+#include "igraph_qsort.h"
 #include <string.h>		/* memset & co. */
 #include "config.h"
 
@@ -223,6 +224,151 @@ int igraph_copy(igraph_t *to, const igraph_t *from) {
   return 0;
 }
 
+/* Helper functions for the incremental index update in
+   igraph_add_edges(). The order of the edges in 'oi' (and 'ii') is
+   by the primary key ('from' for 'oi', 'to' for 'ii'), then by the
+   secondary key, and finally by decreasing edge id, this is exactly
+   the order igraph_vector_order() creates. */
+
+typedef struct igraph_i_add_edges_cmp_data_t {
+  const igraph_real_t *key1, *key2;
+} igraph_i_add_edges_cmp_data_t;
+
+static int igraph_i_add_edges_cmp(void *extra, const void *a, 
+				  const void *b) {
+  igraph_i_add_edges_cmp_data_t *data=(igraph_i_add_edges_cmp_data_t*) extra;
+  long int ea=*(const long int*) a, eb=*(const long int*) b;
+  if (data->key1[ea] != data->key1[eb]) {
+    return data->key1[ea] < data->key1[eb] ? -1 : 1;
+  }
+  if (data->key2[ea] != data->key2[eb]) {
+    return data->key2[ea] < data->key2[eb] ? -1 : 1;
+  }
+  return ea < eb ? 1 : (ea > eb ? -1 : 0);
+}
+
+/* Sorts the ids of the new edges into the same order as the
+   comparison above, with two passes of counting sort for each index:
+   first by the secondary key, going backwards so that ties are in
+   decreasing id order, then stably by the primary key. This is
+   O(|V|+k) instead of O(k log k), so it is used when many edges are
+   added, e.g. by igraph_create(). Returns non-zero if the workspace
+   cannot be allocated, the caller falls back to sorting then. */
+
+#define IGRAPH_I_ADD_EDGES_COUNTING_SORT(k, n) ((n) <= 4 * (k))
+
+static int igraph_i_add_edges_counting_sort(long int *newoi, long int *newii,
+					    const igraph_real_t *from,
+					    const igraph_real_t *to,
+					    long int no_of_edges,
+					    long int edges_to_add,
+					    long int no_of_nodes) {
+  long int *count, *tmp;
+  long int i, v, pass;
+
+  count=igraph_Calloc(no_of_nodes+1, long int);
+  tmp=igraph_Calloc(edges_to_add > 0 ? edges_to_add : 1, long int);
+  if (count == 0 || tmp == 0) {
+    if (count) { igraph_Free(count); }
+    if (tmp) { igraph_Free(tmp); }
+    return 1;
+  }
+
+  for (pass=0; pass<2; pass++) {
+    const igraph_real_t *key1 = pass == 0 ? from : to;
+    const igraph_real_t *key2 = pass == 0 ? to : from;
+    long int *res = pass == 0 ? newoi : newii;
+
+    memset(count, 0, sizeof(long int) * (size_t) (no_of_nodes+1));
+    for (i=0; i<edges_to_add; i++) {
+      count[(long int) key2[no_of_edges+i]+1]++;
+    }
+    for (v=1; v<=no_of_nodes; v++) {
+      count[v] += count[v-1];
+    }
+    for (i=edges_to_add-1; i>=0; i--) {
+      long int e=no_of_edges+i;
+      tmp[count[(long int) key2[e]]++] = e;
+    }
+
+    memset(count, 0, sizeof(long int) * (size_t) (no_of_nodes+1));
+    for (i=0; i<edges_to_add; i++) {
+      count[(long int) key1[no_of_edges+i]+1]++;
+    }
+    for (v=1; v<=no_of_nodes; v++) {
+      count[v] += count[v-1];
+    }
+    for (i=0; i<edges_to_add; i++) {
+      long int e=tmp[i];
+      res[count[(long int) key1[e]]++] = e;
+    }
+  }
+
+  igraph_Free(count);
+  igraph_Free(tmp);
+  return 0;
+}
+
+/* Merges the sorted ids of the new edges into an existing edge index
+   and updates the corresponding start vector. 'index' must have
+   enough reserved space for all new edges, so this cannot fail. The
+   merge works backwards: the place of each new edge is found with a
+   binary search within the old edges having the same primary key,
+   and only the part of the index after the first new edge is moved,
+   in blocks. */
+
+static void igraph_i_add_edges_merge(igraph_vector_t *index, 
+				     igraph_vector_t *start,
+				     const igraph_vector_t *key1,
+				     const igraph_vector_t *key2,
+				     const long int *newidx,
+				     long int no_of_edges,
+				     long int edges_to_add,
+				     long int no_of_nodes) {
+  igraph_i_add_edges_cmp_data_t data;
+  long int i=no_of_edges-1, j=edges_to_add-1;
+  long int w=no_of_edges+edges_to_add-1;
+  long int v, p;
+  igraph_real_t *idx;
+
+  data.key1=VECTOR(*key1);
+  data.key2=VECTOR(*key2);
+
+  igraph_vector_resize(index, no_of_edges+edges_to_add); /* reserved */
+  idx=VECTOR(*index);
+  while (j >= 0) {
+    long int k1=(long int) data.key1[newidx[j]];
+    long int lo=(long int) VECTOR(*start)[k1];
+    long int hi=(long int) VECTOR(*start)[k1+1];
+    if (hi > i+1) { hi=i+1; }
+    if (lo > hi) { lo=hi; }
+    /* first old edge in [lo,hi) that sorts after the new edge */
+    while (lo < hi) {
+      long int mid=lo+(hi-lo)/2;
+      long int old=(long int) idx[mid];
+      if (igraph_i_add_edges_cmp(&data, &old, &newidx[j]) < 0) {
+	lo=mid+1;
+      } else {
+	hi=mid;
+      }
+    }
+    if (lo <= i) {
+      memmove(idx+w-(i-lo), idx+lo, (size_t) (i-lo+1) * sizeof(igraph_real_t));
+      w -= i-lo+1;
+      i = lo-1;
+    }
+    idx[w--] = newidx[j--];
+  }
+
+  /* start[v] is the number of edges with a smaller primary key */
+  for (v=0, p=0; v<=no_of_nodes; v++) {
+    while (p < edges_to_add && data.key1[newidx[p]] < v) {
+      p++;
+    }
+    VECTOR(*start)[v] += p;
+  }
+}
+
 /**
  * \ingroup interface
  * \function igraph_add_edges
@@ -236,6 +382,13 @@ int igraph_copy(igraph_t *to, const igraph_t *from) {
  * should contain even number of integer numbers between zero and the
  * number of vertices in the graph minus one (inclusive). If you also
  * want to add new vertices, call igraph_add_vertices() first.
+ * 
+ * </para><para>
+ * Only the new edges are sorted, and they are merged into the
+ * existing edge indices, so adding a small batch of edges to a large
+ * graph is much cheaper than rebuilding the indices. This makes it
+ * feasible to build a graph incrementally, by calling this function
+ * many times with smaller batches of edges.
  * \param graph The graph to which the edges will be added.
  * \param edges The edges themselves.
  * \param attr The attributes of the new edges, only used by high level
@@ -248,10 +401,13 @@ int igraph_copy(igraph_t *to, const igraph_t *from) {
  * This function invalidates all iterators.
  *
  * </para><para>
- * Time complexity: O(|V|+|E|) where
- * |V| is the number of vertices and
- * |E| is the number of
- * edges in the \em new, extended graph.
+ * Time complexity: O(k log k + |V| + s), where k is the number of
+ * edges to add, |V| is the number of vertices, and s is the number
+ * of existing index entries that sort after the first new edge; s is
+ * at most |E|, the number of edges in the original graph, and it
+ * only involves moving elements of the indices, no sorting. If k is
+ * at least a quarter of |V|, e.g. in igraph_create(), the new edges
+ * are sorted in linear time and the complexity is O(k + |V| + s).
  * 
  * \example examples/simple/igraph_add_edges.c
  */
@@ -259,10 +415,12 @@ int igraph_add_edges(igraph_t *graph, const igraph_vector_t *edges,
 		     void *attr) {
   long int no_of_edges=igraph_vector_size(&graph->from);
   long int edges_to_add=igraph_vector_size(edges)/2;
+  long int no_of_nodes=igraph_vcount(graph);
   long int i=0;
   igraph_error_handler_t *oldhandler;
   int ret1, ret2;
-  igraph_vector_t newoi, newii;
+  long int *newoi, *newii;
+  igraph_i_add_edges_cmp_data_t data;
   igraph_bool_t directed=igraph_is_directed(graph);
 
   if (igraph_vector_size(edges) % 2 != 0) {
@@ -271,7 +429,6 @@ int igraph_add_edges(igraph_t *graph, const igraph_vector_t *edges,
   if (!igraph_vector_isininterval(edges, 0, igraph_vcount(graph)-1)) {
     IGRAPH_ERROR("cannot add edges", IGRAPH_EINVVID);
   }
-
   /* from & to */
   IGRAPH_CHECK(igraph_vector_reserve(&graph->from, no_of_edges+edges_to_add));
   IGRAPH_CHECK(igraph_vector_reserve(&graph->to  , no_of_edges+edges_to_add));
@@ -289,25 +446,35 @@ int igraph_add_edges(igraph_t *graph, const igraph_vector_t *edges,
   /* disable the error handler temporarily */
   oldhandler=igraph_set_error_handler(igraph_error_handler_ignore);
     
-  /* oi & ii */
-  ret1=igraph_vector_init(&newoi, no_of_edges);
-  ret2=igraph_vector_init(&newii, no_of_edges);
-  if (ret1 != 0 || ret2 != 0) {
+  /* oi & ii, only the new edges are sorted */
+  ret1=igraph_vector_reserve(&graph->oi, no_of_edges+edges_to_add);
+  ret2=igraph_vector_reserve(&graph->ii, no_of_edges+edges_to_add);
+  newoi=igraph_Calloc(edges_to_add > 0 ? edges_to_add : 1, long int);
+  newii=igraph_Calloc(edges_to_add > 0 ? edges_to_add : 1, long int);
+  if (ret1 != 0 || ret2 != 0 || newoi == 0 || newii == 0) {
     igraph_vector_resize(&graph->from, no_of_edges); /* gets smaller */
     igraph_vector_resize(&graph->to, no_of_edges);   /* gets smaller */
+    if (newoi) { igraph_Free(newoi); }
+    if (newii) { igraph_Free(newii); }
     igraph_set_error_handler(oldhandler);
-    IGRAPH_ERROR("cannot add edges", IGRAPH_ERROR_SELECT_2(ret1, ret2));
-  }  
-  ret1=igraph_vector_order(&graph->from, &graph->to, &newoi, graph->n);
-  ret2=igraph_vector_order(&graph->to  , &graph->from, &newii, graph->n);
-  if (ret1 != 0 || ret2 != 0) {
-    igraph_vector_resize(&graph->from, no_of_edges);
-    igraph_vector_resize(&graph->to, no_of_edges);
-    igraph_vector_destroy(&newoi);
-    igraph_vector_destroy(&newii);
-    igraph_set_error_handler(oldhandler);
-    IGRAPH_ERROR("cannot add edges", IGRAPH_ERROR_SELECT_2(ret1, ret2));
+    IGRAPH_ERROR("cannot add edges", 
+		 IGRAPH_ERROR_SELECT_2(ret1, ret2) ? 
+		 IGRAPH_ERROR_SELECT_2(ret1, ret2) : IGRAPH_ENOMEM);
   }  
+  if (!IGRAPH_I_ADD_EDGES_COUNTING_SORT(edges_to_add, no_of_nodes) ||
+      igraph_i_add_edges_counting_sort(newoi, newii, VECTOR(graph->from),
+				       VECTOR(graph->to), no_of_edges,
+				       edges_to_add, no_of_nodes) != 0) {
+    for (i=0; i<edges_to_add; i++) {
+      newoi[i] = newii[i] = no_of_edges+i;
+    }
+    data.key1=VECTOR(graph->from); data.key2=VECTOR(graph->to);
+    igraph_qsort_r(newoi, (size_t) edges_to_add, sizeof(long int), &data,
+		   igraph_i_add_edges_cmp);
+    data.key1=VECTOR(graph->to); data.key2=VECTOR(graph->from);
+    igraph_qsort_r(newii, (size_t) edges_to_add, sizeof(long int), &data,
+		   igraph_i_add_edges_cmp);
+  }
 
   /* Attributes */
   if (graph->attr) { 
@@ -317,22 +484,22 @@ int igraph_add_edges(igraph_t *graph, const igraph_vector_t *edges,
     if (ret1 != 0) {
       igraph_vector_resize(&graph->from, no_of_edges);
       igraph_vector_resize(&graph->to, no_of_edges);
-      igraph_vector_destroy(&newoi);
-      igraph_vector_destroy(&newii);
+      igraph_Free(newoi);
+      igraph_Free(newii);
       igraph_set_error_handler(oldhandler);
       IGRAPH_ERROR("cannot add edges", ret1);
     }  
   }
   
-  /* os & is, its length does not change, error safe */
-  igraph_i_create_start(&graph->os, &graph->from, &newoi, graph->n);
-  igraph_i_create_start(&graph->is, &graph->to  , &newii, graph->n);
+  /* merge the new edges into oi & ii, update os & is, error safe */
+  igraph_i_add_edges_merge(&graph->oi, &graph->os, &graph->from, &graph->to,
+			   newoi, no_of_edges, edges_to_add, no_of_nodes);
+  igraph_i_add_edges_merge(&graph->ii, &graph->is, &graph->to, &graph->from,
+			   newii, no_of_edges, edges_to_add, no_of_nodes);
 
   /* everything went fine  */
-  igraph_vector_destroy(&graph->oi);
-  igraph_vector_destroy(&graph->ii);
-  graph->oi=newoi;
-  graph->ii=newii;
+  igraph_Free(newoi);
+  igraph_Free(newii);
   igraph_set_error_handler(oldhandler);
   
   return 0;
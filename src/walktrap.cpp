@@ -128,10 +128,68 @@ int igraph_community_walktrap(const igraph_t *graph,
 			      igraph_matrix_t *merges,
 			      igraph_vector_t *modularity, 
 			      igraph_vector_t *membership) {
+  return igraph_community_walktrap_bounded(graph, weights, steps, merges,
+					   modularity, membership,
+					   /*max_memory=*/ -1,
+					   /*computations=*/ 0,
+					   /*recomputations=*/ 0);
+}
+
+/** 
+ * \function igraph_community_walktrap_bounded
+ * \brief Walktrap community finding with bounded memory
+ * 
+ * This is the same algorithm as \ref igraph_community_walktrap(), but
+ * it can limit the memory used for storing the probability vectors of
+ * the communities, which is usually the bulk of the memory needed on
+ * large graphs. If the limit is reached, then the vectors that are
+ * least likely to be needed soon are deleted, and they are computed
+ * again, from random walks, when they are needed. This makes the
+ * algorithm slower, and since the recomputed vectors might slightly
+ * differ from the stored ones, because of rounding, the results might
+ * slightly differ, too.
+ *
+ * \param graph The input graph, edge directions are ignored.
+ * \param weights Numeric vector giving the weights of the edges, or
+ *     a NULL pointer, see \ref igraph_community_walktrap().
+ * \param steps Integer constant, the length of the random walks.
+ * \param merges Pointer to a matrix or NULL, the merges performed by
+ *     the algorithm, see \ref igraph_community_walktrap().
+ * \param modularity Pointer to a vector or NULL, the modularity score
+ *     after each merge.
+ * \param membership Pointer to a vector or NULL, the membership vector
+ *     corresponding to the maximal modularity score. If it is not a
+ *     NULL pointer, then neither \p modularity nor \p merges may be
+ *     NULL.
+ * \param max_memory The memory limit, in bytes, for the data of the
+ *     algorithm, including the graph, the communities and the
+ *     probability vectors. Negative values mean no limit.
+ * \param computations Pointer to an integer or NULL. If not NULL,
+ *     then the number of probability vectors computed from random
+ *     walks is stored here.
+ * \param recomputations Pointer to an integer or NULL. If not NULL,
+ *     then the number of probability vectors that were computed again,
+ *     after they were deleted because of the memory limit, is stored
+ *     here. This is included in \p computations.
+ * \return Error code.
+ * 
+ * Time complexity: the same as for \ref igraph_community_walktrap() if
+ * there is no memory limit.
+ */
+
+int igraph_community_walktrap_bounded(const igraph_t *graph, 
+				      const igraph_vector_t *weights,
+				      int steps,
+				      igraph_matrix_t *merges,
+				      igraph_vector_t *modularity, 
+				      igraph_vector_t *membership,
+				      igraph_real_t max_memory,
+				      igraph_integer_t *computations,
+				      igraph_integer_t *recomputations) {
 
   long int no_of_nodes=(long int)igraph_vcount(graph);
   int length=steps;
-  long max_memory=-1;
+  long memory_limit= max_memory < 0 ? -1 : long(max_memory);
 
   if (membership && !(modularity && merges)) {
     IGRAPH_ERROR("Cannot calculate membership without modularity or merges",
@@ -152,12 +210,15 @@ int igraph_community_walktrap(const igraph_t *graph,
     IGRAPH_CHECK(igraph_vector_resize(modularity, no_of_nodes));
 	igraph_vector_null(modularity);
   }
-  Communities C(G, length, max_memory, merges, modularity);
+  Communities C(G, length, memory_limit, merges, modularity);
   
   while (!C.H->is_empty()) {
     IGRAPH_ALLOW_INTERRUPTION();
     C.merge_nearest_communities();
   }
+
+  if (computations) { *computations=C.nb_computations; }
+  if (recomputations) { *recomputations=C.nb_recomputations; }
   
   delete G;
 
@@ -83,10 +83,55 @@ Neighbor::Neighbor() {
   heap_index = -1;
 }
 
+Probabilities_pool::Probabilities_pool(int nb_vertices) {
+  free_blocks = 0;
+  full_size = long(nb_vertices)*sizeof(float);
+  memory_cached = 0;
+  max_cached = 8*full_size;
+}
+
+Probabilities_pool::~Probabilities_pool() {
+  trim();
+}
+
+char* Probabilities_pool::allocate(long size) {
+  if((size != full_size) || !free_blocks)
+    return new char[size];
+  char* block = free_blocks;
+  free_blocks = *(char**)block;
+  memory_cached -= size;
+  return block;
+}
+
+void Probabilities_pool::release(char* block, long size) {
+  if((size != full_size) || (size < long(sizeof(char*))) || (memory_cached + size > max_cached)) {
+    delete[] block;
+    return;
+  }
+  *(char**)block = free_blocks;
+  free_blocks = block;
+  memory_cached += size;
+}
+
+void Probabilities_pool::trim() {
+  while(free_blocks) {
+    char* block = free_blocks;
+    free_blocks = *(char**)block;
+    delete[] block;
+  }
+  memory_cached = 0;
+}
+
+void Probabilities::allocate(int n, bool partial) {
+  long bytes = long(n)*(partial ? sizeof(float) + sizeof(int) : sizeof(float));
+  P = (float*)C->pool->allocate(bytes);
+  size = n;
+  vertices = partial ? (int*)(P + n) : 0;
+}
+
 Probabilities::~Probabilities() {
   C->memory_used -= memory();
-  if(P) delete[] P;
-  if(vertices) delete[] vertices;
+  C->pool->release((char*)P, memory() - sizeof(Probabilities));
 }
 
 Probabilities::Probabilities(int community) {
@@ -152,9 +197,7 @@ Probabilities::Probabilities(int community) {
   }
 
   if(nb_vertices1 > (G->nb_vertices/2)) {
-    P = new float[G->nb_vertices];
-    size = G->nb_vertices;
-    vertices = 0;
+    allocate(G->nb_vertices, false);
     if(nb_vertices1 == G->nb_vertices) {
       for(int i = 0; i < G->nb_vertices; i++)
 	P[i] = tmp_vector1[i]/sqrt(G->vertices[i].total_weight);
@@ -167,9 +210,7 @@ Probabilities::Probabilities(int community) {
     }
   }
   else {
-    P = new float[nb_vertices1];
-    size = nb_vertices1;
-    vertices = new int[nb_vertices1];
+    allocate(nb_vertices1, true);
     int j = 0;
     for(int i = 0; i < G->nb_vertices; i++) {
       if(id[i] == current_id) {
@@ -193,9 +234,7 @@ Probabilities::Probabilities(int community1, int community2) {
 
 
   if(P1->size == C->G->nb_vertices) {
-    P = new float[C->G->nb_vertices];
-    size = C->G->nb_vertices;
-    vertices = 0;
+    allocate(C->G->nb_vertices, false);
     
     if(P2->size == C->G->nb_vertices) {	// two full vectors
       for(int i = 0; i < C->G->nb_vertices; i++)
@@ -215,9 +254,7 @@ Probabilities::Probabilities(int community1, int community2) {
   }
   else {
     if(P2->size == C->G->nb_vertices) { // P1 partial vector, P2 full vector
-      P = new float[C->G->nb_vertices];
-      size = C->G->nb_vertices;
-      vertices = 0;
+      allocate(C->G->nb_vertices, false);
 
       int j = 0;
       for(int i = 0; i < P1->size; i++) {
@@ -265,18 +302,14 @@ Probabilities::Probabilities(int community1, int community2) {
       }
 
       if(nb_vertices1 > (C->G->nb_vertices/2)) {
-	P = new float[C->G->nb_vertices];
-	size = C->G->nb_vertices;
-	vertices = 0;
+	allocate(C->G->nb_vertices, false);
 	for(int i = 0; i < C->G->nb_vertices; i++)
 	  P[i] = 0.;
 	for(int i = 0; i < nb_vertices1; i++)
 	  P[vertices1[i]] = tmp_vector1[vertices1[i]];
       }
       else {
-	P = new float[nb_vertices1];
-	size = nb_vertices1;
-	vertices = new int[nb_vertices1];
+	allocate(nb_vertices1, true);
 	for(int i = 0; i < nb_vertices1; i++) {
 	  vertices[i] = vertices1[i];
 	  P[i] = tmp_vector1[vertices1[i]];
@@ -360,6 +393,7 @@ long Probabilities::memory() {
 
 Community::Community() {
   P = 0;
+  discarded = false;
   first_neighbor = 0;
   last_neighbor = 0;
   sub_community_of = -1;
@@ -380,6 +414,8 @@ Communities::Communities(Graph* graph, int random_walks_length,
 			 igraph_vector_t *pmodularity) {
   max_memory = m;
   memory_used = 0;
+  nb_computations = 0;
+  nb_recomputations = 0;
   G = graph;
   merges=pmerges;
   mergeidx=0;
@@ -394,6 +430,7 @@ Communities::Communities(Graph* graph, int random_walks_length,
   Probabilities::vertices1 = new int[G->nb_vertices];
   Probabilities::vertices2 = new int[G->nb_vertices];
   Probabilities::current_id = 0;
+  pool = new Probabilities_pool(G->nb_vertices);
 
   
   members = new int[G->nb_vertices];  
@@ -468,6 +505,7 @@ Communities::~Communities() {
   delete[] communities;
   delete H;
   if(min_delta_sigma) delete min_delta_sigma;
+  delete pool;
   
   delete[] Probabilities::tmp_vector1;
   delete[] Probabilities::tmp_vector2;
@@ -615,12 +653,17 @@ void Communities::update_neighbor(Neighbor* N, float new_delta_sigma) {
 }
 
 void Communities::manage_memory() {
+  if(memory_used + pool->memory_cached > max_memory)
+    pool->trim();
   while((memory_used > max_memory) && !min_delta_sigma->is_empty()) {
     int c = min_delta_sigma->get_max_community();
     delete communities[c].P;
     communities[c].P = 0;
+    communities[c].discarded = true;
     min_delta_sigma->remove_community(c);
   }  
+  if(memory_used + pool->memory_cached > max_memory)
+    pool->trim();
 }
 
 
@@ -830,10 +873,14 @@ double Communities::merge_nearest_communities() {
 double Communities::compute_delta_sigma(int community1, int community2) {
   if(!communities[community1].P) {
     communities[community1].P = new Probabilities(community1);
+    nb_computations++;
+    if(communities[community1].discarded) nb_recomputations++;
     if(max_memory != -1) min_delta_sigma->update(community1);
   }
   if(!communities[community2].P) {
     communities[community2].P = new Probabilities(community2);
+    nb_computations++;
+    if(communities[community2].discarded) nb_recomputations++;
     if(max_memory != -1) min_delta_sigma->update(community2);
   }
   
@@ -68,6 +68,29 @@ namespace igraph {
 namespace walktrap {
 
 class Communities;
+
+// The memory of the probability vectors. A vector is a single block,
+// the probabilities followed by the vertices for a partial vector. On
+// large graphs most vectors are full ones, which all have the same
+// size, so released full vectors are kept in a free list and reused,
+// instead of allocating and freeing every one of them.
+class Probabilities_pool {
+private:
+  char* free_blocks;			// the free list of the blocks of full vectors
+  long full_size;			// the size in Bytes of a full vector
+
+public:
+  long memory_cached;			// the memory in the free list (in Bytes)
+  long max_cached;			// never keep more than this in the free list
+
+  char* allocate(long size);		// get a block
+  void release(char* block, long size);	// put back a block
+  void trim();				// free the blocks in the free list
+
+  Probabilities_pool(int nb_vertices);
+  ~Probabilities_pool();
+};
+
 class Probabilities {
 public:
   static IGRAPH_THREAD_LOCAL float* tmp_vector1;	// 
@@ -83,8 +106,9 @@ public:
   
   int size;						    // number of probabilities stored
   int* vertices;					    // the vertices corresponding to the stored probabilities, 0 if all the probabilities are stored
-  float* P;						    // the probabilities
+  float* P;						    // the probabilities, also the start of the memory block
   
+  void allocate(int size, bool partial);		    // get the memory for P and vertices from the pool
   long memory();					    // the memory (in Bytes) used by the object
   double compute_distance(const Probabilities* P2) const;   // compute the squared distance r^2 between this probability vector and P2
   Probabilities(int community);				    // compute the probability vector of a community
@@ -106,6 +130,7 @@ public:
   int size;			// number of members of the community
   
   Probabilities* P;		// the probability vector, 0 if not stored.  
+  bool discarded;		// true if P was deleted by the memory management
 
 
   float sigma;			// sigma(C) of the community
@@ -136,6 +161,10 @@ private:
 public:
   
   long memory_used;				    // in bytes
+  Probabilities_pool* pool;			    // the memory of the probability vectors
+  long nb_computations;				    // the number of probability vectors computed by random walks
+  long nb_recomputations;			    // the number of those that were computed again after
+						    // the memory management deleted them
   Min_delta_sigma_heap* min_delta_sigma;    	    // the min delta_sigma of the community with a saved probability vector (for memory management)
   
   Graph* G;		    // the graph